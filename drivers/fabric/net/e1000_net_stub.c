@@ -1,16 +1,38 @@
 /**
  * @file e1000_net_stub.c
- * @brief Fabric e1000 PCI NIC backend (MVP: detect + publish netX)
+ * @brief Fabric e1000/e1000e PCI NIC backend
+ *
+ * Rings default to E1000_TX_DESC_COUNT/E1000_RX_DESC_COUNT descriptors
+ * (256..4096). Receive buffers are DMA-pool mbufs: a completed descriptor
+ * hands its mbuf to the stack and gets a fresh one, so frames are never
+ * copied on receive. Transmit copies into per-descriptor buffers and does
+ * not wait for the NIC; finished descriptors are reclaimed before the next
+ * send.
+ *
+ * Offloads: IPv4 header and TCP/UDP checksums on transmit through context
+ * descriptors (reloaded only when the layout changes), receive checksum
+ * results reported as BSD_CSUM_* flags in the mbuf, and TCP segmentation on
+ * 82571 and newer MACs (the 8254x parts keep it off as in FreeBSD em).
+ * Interrupts go through MSI when the function has it; the throttling rate
+ * (ITR) follows the traffic mix in e1000_itr_update(), and the receive and
+ * transmit delay timers batch completions further. The receive ring is one
+ * fabric queue context: with MSI a receive interrupt masks the receive
+ * causes and schedules the poll thread, which unmasks them once the ring
+ * is drained.
  */
 
 #include "../../../kernel/fabric/fabric.h"
 #include "../../../kernel/fabric/device/device.h"
 #include "../../../kernel/fabric/driver/driver.h"
+#include "../../../kernel/fabric/bus/pci.h"
 #include "../../../kernel/fabric/service/net_service.h"
+#include "../../../kernel/fabric/spin.h"
 #include "../../../kernel/net/net.h"
 #include "../../../kernel/net/socket.h"
+#include "../../../kernel/net/bsd_mbuf.h"
 #include "../../../kernel/common/heap.h"
 #include "../../../kernel/arch/config.h"
+#include "../../../kernel/arch/msi.h"
 #include "../../../kernel/arch/paging.h"
 #include "../../../kernel/arch/pmm.h"
 #include "../../../include/common.h"
@@ -28,13 +50,49 @@
 #define E1000_IF_MAX 4
 #define E1000_MMIO_SIZE 0x20000u
 #define E1000_MMIO_VIRT_BASE 0xFFFFFFFFC0000000ULL
-#define E1000_TX_DESC_COUNT 64u
-#define E1000_RX_DESC_COUNT 64u
+/* Ring sizes: 256..4096 descriptors, a multiple of 8 (TDLEN/RDLEN are 128-byte units). */
+#ifndef E1000_TX_DESC_COUNT
+#define E1000_TX_DESC_COUNT 256u
+#endif
+#ifndef E1000_RX_DESC_COUNT
+#define E1000_RX_DESC_COUNT 512u
+#endif
 #define E1000_RX_BUF_SIZE 2048u
 #define E1000_TX_BUF_SIZE 2048u
+#define E1000_RX_BATCH    64u        /* frames handed to the stack per lock hold */
+#define E1000_TX_WAIT_SPINS 200000u  /* bounded wait for ring space */
+
+_Static_assert(E1000_TX_DESC_COUNT >= 256u && E1000_TX_DESC_COUNT <= 4096u &&
+               (E1000_TX_DESC_COUNT % 8u) == 0, "E1000_TX_DESC_COUNT out of range");
+_Static_assert(E1000_RX_DESC_COUNT >= 256u && E1000_RX_DESC_COUNT <= 4096u &&
+               (E1000_RX_DESC_COUNT % 8u) == 0, "E1000_RX_DESC_COUNT out of range");
+_Static_assert(E1000_RX_BUF_SIZE <= BSD_MBUF_DATA_MAX, "RX buffers are mbuf payloads");
+
+/*
+ * Interrupt moderation. ITR is the minimum gap between interrupts in 256 ns
+ * units; the delay timers count 1.024 us. e1000_itr_update() picks one of
+ * three rates from the bytes and packets seen per E1000_ITR_WINDOW_US.
+ */
+#define E1000_ITR_WINDOW_US   1000u
+#define E1000_ITR_LOWEST      70000u  /* interrupts/s: small, sparse packets */
+#define E1000_ITR_LOW         20000u  /* mixed traffic, also the starting rate */
+#define E1000_ITR_BULK        4000u   /* large frames at high rate */
+#define E1000_RDTR_DELAY      32u
+#define E1000_RADV_DELAY      128u
+#define E1000_TIDV_DELAY      64u
+#define E1000_TADV_DELAY      128u
+
+#define E1000_IMS_RX      (E1000_IMS_RXT0 | E1000_IMS_RXDMT0 | E1000_IMS_RXO)
+#define E1000_IMS_DEFAULT (E1000_IMS_RX | E1000_IMS_TXDW | E1000_IMS_LSC)
 
 #define QEMU_GW_IP  0x0A000202u /* 10.0.2.2 */
 
+typedef enum {
+    E1000_LATENCY_LOWEST = 0,
+    E1000_LATENCY_LOW,
+    E1000_LATENCY_BULK
+} e1000_latency_t;
+
 typedef struct {
     int used;
     uint32_t index;
@@ -47,16 +105,39 @@ typedef struct {
     uint64_t tx_desc_phys;
     uint64_t rx_desc_phys;
     uint64_t tx_buf_phys;
-    uint64_t rx_buf_phys;
     struct e1000_tx_desc* tx_desc;
     struct e1000_rx_desc* rx_desc;
     uint8_t* tx_buf;
-    uint8_t* rx_buf;
+    bsd_mbuf_t** rx_mbuf;        /* mbuf behind each RX descriptor */
     uint32_t tx_count;
     uint32_t rx_count;
-    uint32_t rx_next;
     int hw_ready;
+
+    spinlock_t tx_lock;
+    uint32_t tx_next;            /* next descriptor to fill */
+    uint32_t tx_clean;           /* oldest descriptor not yet reclaimed */
+    uint32_t tx_avail;
+    uint32_t tx_ctx;             /* layout of the loaded checksum context, 0 = none */
+
+    spinlock_t rx_lock;
+    uint32_t rx_next;
+    bool rx_discard;             /* dropping the rest of an oversized frame */
+
+    int vector;                  /* MSI vector, negative when polled */
+    e1000_latency_t itr_class;
+    uint32_t itr_rate;           /* interrupts/s currently programmed */
+    uint64_t itr_stamp_us;
+    uint64_t itr_packets;
+    uint64_t itr_bytes;
+
+    uint64_t irqs;
+    uint64_t tx_contexts;
+    uint64_t tx_tso;
+    uint64_t rx_hw_csum;
+    uint64_t rx_nobuf;
+
     fabric_netif_t iface;
+    fabric_netif_queue_t rxq;
 } e1000_slot_t;
 
 static e1000_slot_t g_slots[E1000_IF_MAX];
@@ -186,48 +267,84 @@ static int e1000_alloc_dma_rings(e1000_slot_t* slot)
     const uint32_t tx_desc_bytes = E1000_TX_DESC_COUNT * (uint32_t)sizeof(struct e1000_tx_desc);
     const uint32_t rx_desc_bytes = E1000_RX_DESC_COUNT * (uint32_t)sizeof(struct e1000_rx_desc);
     const uint32_t tx_buf_bytes = E1000_TX_DESC_COUNT * E1000_TX_BUF_SIZE;
-    const uint32_t rx_buf_bytes = E1000_RX_DESC_COUNT * E1000_RX_BUF_SIZE;
 
     const uint32_t tx_desc_pages = (tx_desc_bytes + 4095u) / 4096u;
     const uint32_t rx_desc_pages = (rx_desc_bytes + 4095u) / 4096u;
     const uint32_t tx_buf_pages = (tx_buf_bytes + 4095u) / 4096u;
-    const uint32_t rx_buf_pages = (rx_buf_bytes + 4095u) / 4096u;
 
     slot->tx_desc_phys = pmm_alloc_pages(tx_desc_pages);
+    if (!slot->tx_desc_phys) {
+        return RDNX_E_NOMEM;
+    }
     slot->rx_desc_phys = pmm_alloc_pages(rx_desc_pages);
+    if (!slot->rx_desc_phys) {
+        goto fail_tx_desc;
+    }
     slot->tx_buf_phys = pmm_alloc_pages(tx_buf_pages);
-    slot->rx_buf_phys = pmm_alloc_pages(rx_buf_pages);
-    if (!slot->tx_desc_phys || !slot->rx_desc_phys || !slot->tx_buf_phys || !slot->rx_buf_phys) {
-        return RDNX_E_NOMEM;
+    if (!slot->tx_buf_phys) {
+        goto fail_rx_desc;
+    }
+    slot->rx_mbuf = (bsd_mbuf_t**)kcalloc(E1000_RX_DESC_COUNT, sizeof(bsd_mbuf_t*));
+    if (!slot->rx_mbuf) {
+        goto fail_tx_buf;
     }
 
     slot->tx_desc = (struct e1000_tx_desc*)ARCH_PHYS_TO_VIRT(slot->tx_desc_phys);
     slot->rx_desc = (struct e1000_rx_desc*)ARCH_PHYS_TO_VIRT(slot->rx_desc_phys);
     slot->tx_buf = (uint8_t*)ARCH_PHYS_TO_VIRT(slot->tx_buf_phys);
-    slot->rx_buf = (uint8_t*)ARCH_PHYS_TO_VIRT(slot->rx_buf_phys);
-    if (!slot->tx_desc || !slot->rx_desc || !slot->tx_buf || !slot->rx_buf) {
-        return RDNX_E_NOMEM;
+    if (!slot->tx_desc || !slot->rx_desc || !slot->tx_buf) {
+        goto fail_rx_mbuf;
     }
 
     memset(slot->tx_desc, 0, tx_desc_pages * 4096u);
     memset(slot->rx_desc, 0, rx_desc_pages * 4096u);
-    memset(slot->tx_buf, 0, tx_buf_pages * 4096u);
-    memset(slot->rx_buf, 0, rx_buf_pages * 4096u);
 
     slot->tx_count = E1000_TX_DESC_COUNT;
     slot->rx_count = E1000_RX_DESC_COUNT;
+    slot->tx_next = 0;
+    slot->tx_clean = 0;
+    slot->tx_avail = slot->tx_count - 1u;
+    slot->tx_ctx = 0;
     slot->rx_next = 0;
+    slot->rx_discard = false;
 
-    for (uint32_t i = 0; i < slot->tx_count; i++) {
-        slot->tx_desc[i].buffer_addr = (uint64_t)(slot->tx_buf_phys + (uint64_t)i * E1000_TX_BUF_SIZE);
-        slot->tx_desc[i].upper.data = E1000_TXD_STAT_DD;
-    }
+    /* Every RX descriptor owns a DMA-pool mbuf; the pool grows to cover the ring. */
+    (void)bsd_m_pool_reserve(slot->rx_count);
     for (uint32_t i = 0; i < slot->rx_count; i++) {
-        slot->rx_desc[i].buffer_addr = (uint64_t)(slot->rx_buf_phys + (uint64_t)i * E1000_RX_BUF_SIZE);
+        bsd_mbuf_t* m = bsd_m_gethdr(BSD_M_NOWAIT, BSD_MT_DATA);
+        uint64_t dma = bsd_m_dma_addr(m);
+        if (!dma) {
+            bsd_m_freem(m);
+            goto fail_rx_mbuf;
+        }
+        slot->rx_mbuf[i] = m;
+        slot->rx_desc[i].buffer_addr = dma;
         slot->rx_desc[i].status = 0;
     }
 
     return RDNX_OK;
+
+fail_rx_mbuf:
+    for (uint32_t i = 0; i < E1000_RX_DESC_COUNT; i++) {
+        if (slot->rx_mbuf[i]) {
+            bsd_m_freem(slot->rx_mbuf[i]);
+        }
+    }
+    kfree(slot->rx_mbuf);
+    slot->rx_mbuf = NULL;
+    slot->tx_desc = NULL;
+    slot->rx_desc = NULL;
+    slot->tx_buf = NULL;
+fail_tx_buf:
+    pmm_free_pages(slot->tx_buf_phys, tx_buf_pages);
+    slot->tx_buf_phys = 0;
+fail_rx_desc:
+    pmm_free_pages(slot->rx_desc_phys, rx_desc_pages);
+    slot->rx_desc_phys = 0;
+fail_tx_desc:
+    pmm_free_pages(slot->tx_desc_phys, tx_desc_pages);
+    slot->tx_desc_phys = 0;
+    return RDNX_E_NOMEM;
 }
 
 static int e1000_hw_enable_io(e1000_slot_t* slot)
@@ -241,6 +358,84 @@ static int e1000_hw_enable_io(e1000_slot_t* slot)
     return RDNX_OK;
 }
 
+static void e1000_itr_set(e1000_slot_t* slot, uint32_t rate)
+{
+    slot->itr_rate = rate;
+    E1000_WRITE_REG(&slot->hw, E1000_ITR, 1000000000u / (rate * 256u));
+}
+
+/*
+ * Adaptive interrupt throttling, after the Linux e1000 latency classes:
+ * sparse small packets want the lowest latency, a stream of full-size
+ * frames wants few interrupts. Called from RX and TX with the traffic of
+ * that pass; once per window the class is re-evaluated and the new rate
+ * blended in so a single burst does not swing it.
+ */
+static void e1000_itr_update(e1000_slot_t* slot, uint32_t packets, uint32_t bytes)
+{
+    __atomic_fetch_add(&slot->itr_packets, packets, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&slot->itr_bytes, bytes, __ATOMIC_RELAXED);
+
+    uint64_t now = console_get_uptime_us();
+    uint64_t stamp = __atomic_load_n(&slot->itr_stamp_us, __ATOMIC_RELAXED);
+    if (now - stamp < E1000_ITR_WINDOW_US ||
+        !__atomic_compare_exchange_n(&slot->itr_stamp_us, &stamp, now, false,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    uint64_t pk = __atomic_exchange_n(&slot->itr_packets, 0, __ATOMIC_RELAXED);
+    uint64_t by = __atomic_exchange_n(&slot->itr_bytes, 0, __ATOMIC_RELAXED);
+    e1000_latency_t cls = slot->itr_class;
+    if (pk == 0) {
+        return;
+    }
+    uint64_t per = by / pk;
+    switch (cls) {
+        case E1000_LATENCY_LOWEST:
+            if (by > 10000u) {
+                cls = (per > 8000u) ? E1000_LATENCY_BULK : E1000_LATENCY_LOW;
+            } else if (pk < 5u && by > 512u) {
+                cls = E1000_LATENCY_LOW;
+            }
+            break;
+        case E1000_LATENCY_LOW:
+            if (by > 10000u) {
+                if (per > 8000u || pk < 10u || per > 1200u) {
+                    cls = E1000_LATENCY_BULK;
+                } else if (pk > 35u) {
+                    cls = E1000_LATENCY_LOWEST;
+                }
+            } else if (per > 2000u) {
+                cls = E1000_LATENCY_BULK;
+            } else if (pk <= 2u && by < 512u) {
+                cls = E1000_LATENCY_LOWEST;
+            }
+            break;
+        case E1000_LATENCY_BULK:
+            if (by > 25000u) {
+                if (pk > 35u) {
+                    cls = E1000_LATENCY_LOW;
+                }
+            } else if (by < 6000u) {
+                cls = E1000_LATENCY_LOW;
+            }
+            break;
+    }
+    slot->itr_class = cls;
+
+    static const uint32_t rates[] = { E1000_ITR_LOWEST, E1000_ITR_LOW, E1000_ITR_BULK };
+    uint32_t target = rates[cls];
+    uint32_t cur = slot->itr_rate;
+    if (target > cur) {
+        /* Raise gradually; drop at once so bulk traffic settles quickly. */
+        target = (uint32_t)((10ull * target * cur) / (target + 9ull * cur));
+    }
+    if (target != cur) {
+        e1000_itr_set(slot, target);
+    }
+}
+
 static int e1000_hw_setup_queues(e1000_slot_t* slot)
 {
     if (!slot) {
@@ -274,72 +469,318 @@ static int e1000_hw_setup_queues(e1000_slot_t* slot)
     E1000_WRITE_REG(&slot->hw, E1000_RDH(0), 0);
     E1000_WRITE_REG(&slot->hw, E1000_RDT(0), slot->rx_count - 1u);
 
-    uint32_t rctl = E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SECRC | E1000_RCTL_SZ_2048;
+    /* Checksum the IPv4 header and TCP/UDP payload of every received frame. */
+    E1000_WRITE_REG(&slot->hw, E1000_RXCSUM, E1000_RXCSUM_IPOFL | E1000_RXCSUM_TUOFL);
+
+    E1000_WRITE_REG(&slot->hw, E1000_RDTR, E1000_RDTR_DELAY);
+    E1000_WRITE_REG(&slot->hw, E1000_RADV, E1000_RADV_DELAY);
+    E1000_WRITE_REG(&slot->hw, E1000_TIDV, E1000_TIDV_DELAY);
+    E1000_WRITE_REG(&slot->hw, E1000_TADV, E1000_TADV_DELAY);
+    slot->itr_class = E1000_LATENCY_LOW;
+    e1000_itr_set(slot, E1000_ITR_LOW);
+
+    uint32_t rctl = E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SECRC | E1000_RCTL_SZ_2048 |
+                    E1000_RCTL_RDMTS_HALF;
     E1000_WRITE_REG(&slot->hw, E1000_RCTL, rctl);
     (void)E1000_READ_REG(&slot->hw, E1000_STATUS);
     return RDNX_OK;
 }
 
-static int e1000_poll_rx_slot(e1000_slot_t* slot, fabric_netif_t* iface)
+/* BSD_CSUM_* flags for a completed RX descriptor. */
+static uint32_t e1000_rx_csum(uint8_t status, uint8_t errors)
 {
-    if (!slot || !iface || !slot->hw_ready || !slot->rx_desc || !slot->rx_buf) {
-        return RDNX_E_INVALID;
+    if (status & E1000_RXD_STAT_IXSM) {
+        return 0;
+    }
+    uint32_t flags = 0;
+    if (status & E1000_RXD_STAT_IPCS) {
+        flags |= BSD_CSUM_L3_CALC;
+        if ((errors & E1000_RXD_ERR_IPE) == 0) {
+            flags |= BSD_CSUM_L3_VALID;
+        }
     }
+    /* A TCP/UDP error is left for the stack to confirm in software. */
+    if ((status & (E1000_RXD_STAT_TCPCS | E1000_RXD_STAT_UDPCS)) &&
+        (errors & E1000_RXD_ERR_TCPE) == 0) {
+        flags |= BSD_CSUM_L4_CALC | BSD_CSUM_L4_VALID;
+    }
+    return flags;
+}
 
-    int delivered = 0;
-    for (uint32_t budget = 0; budget < slot->rx_count; budget++) {
+/*
+ * Take up to max (at most E1000_RX_BATCH) completed frames off the ring. Each delivered
+ * descriptor gets a new pool mbuf; when none is left the frame is dropped
+ * and its mbuf stays on the ring.
+ */
+static uint32_t e1000_rx_harvest(e1000_slot_t* slot, bsd_mbuf_t** out, uint32_t max)
+{
+    uint32_t n = 0;
+    uint32_t done = 0;
+    spinlock_lock(&slot->rx_lock);
+    while (n < max && done < slot->rx_count) {
         struct e1000_rx_desc* d = &slot->rx_desc[slot->rx_next];
-        if ((d->status & E1000_RXD_STAT_DD) == 0) {
+        uint8_t status = *(volatile uint8_t*)&d->status;
+        if ((status & E1000_RXD_STAT_DD) == 0) {
             break;
         }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
 
         uint16_t len = d->length;
-        if ((d->status & E1000_RXD_STAT_EOP) && len > 0 && len <= E1000_RX_BUF_SIZE) {
-            uint8_t* frame = slot->rx_buf + ((uint64_t)slot->rx_next * E1000_RX_BUF_SIZE);
-            (void)fabric_netif_rx_submit(iface, frame, len);
-            (void)net_ingress_frame(frame, len, iface);
-            delivered++;
+        uint8_t errors = d->errors;
+        bool eop = (status & E1000_RXD_STAT_EOP) != 0;
+        bool deliver = eop && !slot->rx_discard && len > 0 && len <= E1000_RX_BUF_SIZE &&
+                       (errors & E1000_RXD_ERR_FRAME_ERR_MASK) == 0;
+        slot->rx_discard = !eop;
+
+        if (deliver) {
+            bsd_mbuf_t* fresh = bsd_m_gethdr(BSD_M_NOWAIT, BSD_MT_DATA);
+            uint64_t dma = bsd_m_dma_addr(fresh);
+            if (dma) {
+                bsd_mbuf_t* m = slot->rx_mbuf[slot->rx_next];
+                m->m_len = len;
+                m->m_pkthdr.len = (int)len;
+                m->m_pkthdr.rcvif = &slot->iface;
+                m->m_pkthdr.csum_flags = e1000_rx_csum(status, errors);
+                if (m->m_pkthdr.csum_flags != 0) {
+                    slot->rx_hw_csum++;
+                }
+                out[n++] = m;
+                slot->rx_mbuf[slot->rx_next] = fresh;
+                d->buffer_addr = dma;
+            } else {
+                bsd_m_freem(fresh);
+                slot->rx_nobuf++;
+                slot->iface.stats.drops++;
+            }
         }
 
         d->status = 0;
         d->errors = 0;
         d->length = 0;
-        E1000_WRITE_REG(&slot->hw, E1000_RDT(0), slot->rx_next);
         slot->rx_next = (slot->rx_next + 1u) % slot->rx_count;
+        done++;
+    }
+    if (done > 0) {
+        /* Hand the whole batch back with one tail write. */
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        E1000_WRITE_REG(&slot->hw, E1000_RDT(0), (slot->rx_next + slot->rx_count - 1u) % slot->rx_count);
+    }
+    spinlock_unlock(&slot->rx_lock);
+    return n;
+}
+
+static int e1000_poll_rx_slot(e1000_slot_t* slot, fabric_netif_t* iface, uint32_t budget)
+{
+    if (!slot || !iface || !slot->hw_ready || !slot->rx_desc || !slot->rx_mbuf) {
+        return RDNX_E_INVALID;
+    }
+
+    int delivered = 0;
+    uint32_t bytes = 0;
+    bsd_mbuf_t* batch[E1000_RX_BATCH];
+    while (delivered < (int)budget) {
+        uint32_t want = budget - (uint32_t)delivered;
+        if (want > E1000_RX_BATCH) {
+            want = E1000_RX_BATCH;
+        }
+        uint32_t n = e1000_rx_harvest(slot, batch, want);
+        for (uint32_t i = 0; i < n; i++) {
+            bsd_mbuf_t* m = batch[i];
+            bytes += m->m_len;
+            if (fabric_netif_rx_submit(iface, bsd_mtod(m, const void*), m->m_len) != RDNX_OK) {
+                bsd_m_freem(m);
+                continue;
+            }
+            (void)net_ingress_mbuf(m);
+        }
+        delivered += (int)n;
+        if (n < want) {
+            break;
+        }
+    }
+    if (delivered > 0) {
+        e1000_itr_update(slot, (uint32_t)delivered, bytes);
     }
     return delivered;
 }
 
-static int e1000_tx_slot(e1000_slot_t* slot, const void* frame, uint32_t len)
+/* Advance tx_clean over descriptors the NIC has written back. */
+static void e1000_tx_reclaim_locked(e1000_slot_t* slot)
 {
-    if (!slot || !frame || len == 0 || len > E1000_TX_BUF_SIZE || !slot->hw_ready) {
+    while (slot->tx_avail < slot->tx_count - 1u) {
+        volatile struct e1000_tx_desc* d = &slot->tx_desc[slot->tx_clean];
+        if ((d->upper.fields.status & E1000_TXD_STAT_DD) == 0) {
+            break;
+        }
+        slot->tx_clean = (slot->tx_clean + 1u) % slot->tx_count;
+        slot->tx_avail++;
+    }
+}
+
+static bool e1000_tx_reserve_locked(e1000_slot_t* slot, uint32_t need)
+{
+    e1000_tx_reclaim_locked(slot);
+    for (uint32_t spins = E1000_TX_WAIT_SPINS; slot->tx_avail < need && spins > 0; spins--) {
+        __asm__ volatile("pause");
+        e1000_tx_reclaim_locked(slot);
+    }
+    return slot->tx_avail >= need;
+}
+
+static uint32_t e1000_tx_take_locked(e1000_slot_t* slot)
+{
+    uint32_t i = slot->tx_next;
+    slot->tx_next = (i + 1u) % slot->tx_count;
+    slot->tx_avail--;
+    return i;
+}
+
+/*
+ * Load a checksum/TSO context. Plain checksum contexts are only rewritten
+ * when the header layout changes; TSO needs one per packet for PAYLEN.
+ */
+static void e1000_tx_context_locked(e1000_slot_t* slot, const fabric_netif_tx_req_t* req)
+{
+    const bool tso = (req->flags & FABRIC_NETIF_TX_TSO) != 0;
+    const bool tcp = (req->flags & (FABRIC_NETIF_TX_CSUM_TCP | FABRIC_NETIF_TX_TSO)) != 0;
+    const uint32_t key = (req->flags << 24) | ((uint32_t)req->l3_off << 12) | req->l4_off;
+    if (!tso && key == slot->tx_ctx) {
+        return;
+    }
+
+    struct e1000_context_desc* c = (struct e1000_context_desc*)&slot->tx_desc[e1000_tx_take_locked(slot)];
+    c->lower_setup.ip_fields.ipcss = (uint8_t)req->l3_off;
+    c->lower_setup.ip_fields.ipcso = (uint8_t)(req->l3_off + 10u);      /* ip_sum */
+    c->lower_setup.ip_fields.ipcse = (uint16_t)(req->l4_off - 1u);
+    c->upper_setup.tcp_fields.tucss = (uint8_t)req->l4_off;
+    c->upper_setup.tcp_fields.tucso = (uint8_t)(req->l4_off + (tcp ? 16u : 6u));
+    c->upper_setup.tcp_fields.tucse = 0;                                   /* to the end */
+
+    uint32_t cmd = E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_C | E1000_TXD_CMD_RS | E1000_TXD_CMD_IP;
+    if (tcp) {
+        cmd |= E1000_TXD_CMD_TCP;
+    }
+    if (tso) {
+        const uint32_t hdr = (uint32_t)req->l4_off + req->l4_hdr_len;
+        cmd |= E1000_TXD_CMD_TSE | ((req->len - hdr) & 0xFFFFFu);
+        c->tcp_seg_setup.fields.hdr_len = (uint8_t)hdr;
+        c->tcp_seg_setup.fields.mss = req->mss;
+        slot->tx_tso++;
+    } else {
+        c->tcp_seg_setup.fields.hdr_len = 0;
+        c->tcp_seg_setup.fields.mss = 0;
+    }
+    c->cmd_and_length = cmd;
+    c->tcp_seg_setup.fields.status = 0;
+    slot->tx_ctx = tso ? 0 : key;
+    slot->tx_contexts++;
+}
+
+static int e1000_tx_slot(e1000_slot_t* slot, const fabric_netif_tx_req_t* req)
+{
+    if (!slot || !req || !req->frame || req->len == 0 || !slot->hw_ready) {
         return RDNX_E_INVALID;
     }
 
-    uint32_t tail = E1000_READ_REG(&slot->hw, E1000_TDT(0));
-    if (tail >= slot->tx_count) {
-        return RDNX_E_GENERIC;
+    const bool offload = req->flags != 0;
+    const bool tso = (req->flags & FABRIC_NETIF_TX_TSO) != 0;
+    const uint32_t ndesc = (req->len + E1000_TX_BUF_SIZE - 1u) / E1000_TX_BUF_SIZE;
+    if (!tso && ndesc > 1u) {
+        return RDNX_E_INVALID;
     }
 
-    struct e1000_tx_desc* d = &slot->tx_desc[tail];
-    if ((d->upper.data & E1000_TXD_STAT_DD) == 0) {
+    spinlock_lock(&slot->tx_lock);
+    if (!e1000_tx_reserve_locked(slot, ndesc + (offload ? 1u : 0u))) {
+        spinlock_unlock(&slot->tx_lock);
         return RDNX_E_BUSY;
     }
+    if (offload) {
+        e1000_tx_context_locked(slot, req);
+    }
 
-    uint8_t* txb = slot->tx_buf + ((uint64_t)tail * E1000_TX_BUF_SIZE);
-    memcpy(txb, frame, len);
-    d->lower.data = (len & 0xFFFFu) | E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS;
-    d->upper.data = 0;
+    uint8_t popts = 0;
+    if (req->flags & (FABRIC_NETIF_TX_CSUM_IP4 | FABRIC_NETIF_TX_TSO)) {
+        popts |= E1000_TXD_POPTS_IXSM;
+    }
+    if (req->flags & (FABRIC_NETIF_TX_CSUM_UDP | FABRIC_NETIF_TX_CSUM_TCP | FABRIC_NETIF_TX_TSO)) {
+        popts |= E1000_TXD_POPTS_TXSM;
+    }
 
-    tail = (tail + 1u) % slot->tx_count;
-    E1000_WRITE_REG(&slot->hw, E1000_TDT(0), tail);
+    const uint8_t* src = (const uint8_t*)req->frame;
+    uint32_t left = req->len;
+    for (uint32_t k = 0; k < ndesc; k++) {
+        uint32_t i = e1000_tx_take_locked(slot);
+        uint32_t chunk = (left < E1000_TX_BUF_SIZE) ? left : E1000_TX_BUF_SIZE;
+        uint8_t* txb = slot->tx_buf + ((uint64_t)i * E1000_TX_BUF_SIZE);
+        memcpy(txb, src, chunk);
+        if (tso && k == 0) {
+            /* Per-segment IP length and checksum come from the NIC. */
+            memset(txb + req->l3_off + 2u, 0, 2);
+            memset(txb + req->l3_off + 10u, 0, 2);
+        }
 
-    uint32_t spins = 200000u;
-    while ((d->upper.data & E1000_TXD_STAT_DD) == 0u && spins--) {
-        __asm__ volatile("pause");
+        uint32_t cmd = E1000_TXD_CMD_IFCS | E1000_TXD_CMD_RS | E1000_TXD_CMD_IDE;
+        if (k + 1u == ndesc) {
+            cmd |= E1000_TXD_CMD_EOP;
+        }
+        struct e1000_tx_desc* d = &slot->tx_desc[i];
+        d->buffer_addr = slot->tx_buf_phys + (uint64_t)i * E1000_TX_BUF_SIZE;
+        if (offload) {
+            struct e1000_data_desc* dd = (struct e1000_data_desc*)d;
+            dd->lower.data = chunk | cmd | E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D |
+                             (tso ? E1000_TXD_CMD_TSE : 0u);
+            dd->upper.data = 0;
+            dd->upper.fields.popts = popts;
+        } else {
+            d->lower.data = chunk | cmd;
+            d->upper.data = 0;
+        }
+        src += chunk;
+        left -= chunk;
+    }
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    E1000_WRITE_REG(&slot->hw, E1000_TDT(0), slot->tx_next);
+    spinlock_unlock(&slot->tx_lock);
+
+    e1000_itr_update(slot, 1u, req->len);
+    return RDNX_OK;
+}
+
+static void e1000_irq(int vector, void* arg)
+{
+    (void)vector;
+    e1000_slot_t* slot = (e1000_slot_t*)arg;
+    /* Reading ICR acknowledges every cause; the rings are drained by polling. */
+    uint32_t icr = E1000_READ_REG(&slot->hw, E1000_ICR);
+    if (icr != 0) {
+        slot->irqs++;
+    }
+    if (icr & E1000_IMS_RX) {
+        fabric_netif_queue_schedule(&slot->rxq);
+    }
+}
+
+static uint32_t e1000_rxq_poll(fabric_netif_queue_t* q, uint32_t budget)
+{
+    e1000_slot_t* slot = (e1000_slot_t*)q->context;
+    int n = e1000_poll_rx_slot(slot, q->iface, budget ? budget : FABRIC_NETIF_POLL_BUDGET);
+    return (n > 0) ? (uint32_t)n : 0u;
+}
+
+/* Mask or unmask the receive causes; unmasking reports a frame already waiting. */
+static bool e1000_rxq_irq_enable(fabric_netif_queue_t* q, bool on)
+{
+    e1000_slot_t* slot = (e1000_slot_t*)q->context;
+    if (!on) {
+        E1000_WRITE_REG(&slot->hw, E1000_IMC, E1000_IMS_RX);
+        return false;
     }
-    (void)e1000_poll_rx_slot(slot, &slot->iface);
-    return ((d->upper.data & E1000_TXD_STAT_DD) != 0u) ? RDNX_OK : RDNX_E_TIMEOUT;
+    E1000_WRITE_REG(&slot->hw, E1000_IMS, E1000_IMS_RX);
+    spinlock_lock(&slot->rx_lock);
+    uint8_t status = *(volatile uint8_t*)&slot->rx_desc[slot->rx_next].status;
+    spinlock_unlock(&slot->rx_lock);
+    return (status & E1000_RXD_STAT_DD) != 0;
 }
 
 static bool e1000_is_supported_device(uint16_t device_id)
@@ -363,7 +804,46 @@ static int e1000_net_tx(fabric_netif_t* iface, const void* frame, uint32_t len)
     if (!slot) {
         return RDNX_E_INVALID;
     }
-    return e1000_tx_slot(slot, frame, len);
+    fabric_netif_tx_req_t req;
+    memset(&req, 0, sizeof(req));
+    req.frame = frame;
+    req.len = len;
+    return e1000_tx_slot(slot, &req);
+}
+
+static int e1000_net_tx_offload(fabric_netif_t* iface, const fabric_netif_tx_req_t* req)
+{
+    if (!iface || !req) {
+        return RDNX_E_INVALID;
+    }
+    e1000_slot_t* slot = (e1000_slot_t*)iface->context;
+    if (!slot) {
+        return RDNX_E_INVALID;
+    }
+    return e1000_tx_slot(slot, req);
+}
+
+/* MSI when the function has it (82574L does, QEMU's 82540EM does not). */
+static void e1000_setup_irq(e1000_slot_t* slot)
+{
+    slot->vector = -1;
+    if (!msi_is_available() || pci_find_capability(slot->dev, PCI_CAP_ID_MSI) == 0) {
+        return;
+    }
+    int vector = msi_vector_alloc();
+    uint64_t addr = 0;
+    uint32_t data = 0;
+    if (vector >= 0 &&
+        msi_compose(vector, 0, &addr, &data) == RDNX_OK &&
+        fabric_request_irq(vector, e1000_irq, slot) == RDNX_OK &&
+        pci_msi_enable(slot->dev, addr, data) == RDNX_OK) {
+        slot->vector = vector;
+        (void)E1000_READ_REG(&slot->hw, E1000_ICR);
+        E1000_WRITE_REG(&slot->hw, E1000_IMS, E1000_IMS_DEFAULT);
+    } else if (vector >= 0) {
+        fabric_free_irq(vector, e1000_irq);
+        msi_vector_free(vector);
+    }
 }
 
 static int e1000_net_poll(fabric_netif_t* iface)
@@ -375,7 +855,7 @@ static int e1000_net_poll(fabric_netif_t* iface)
     if (!slot) {
         return RDNX_E_INVALID;
     }
-    return e1000_poll_rx_slot(slot, iface);
+    return e1000_poll_rx_slot(slot, iface, slot->rx_count);
 }
 
 static bool e1000_net_probe(fabric_device_t* dev)
@@ -416,7 +896,8 @@ static int e1000_net_attach(fabric_device_t* dev)
     static fabric_netif_ops_t ops = {
         .hdr = RDNX_ABI_INIT(fabric_netif_ops_t),
         .tx = e1000_net_tx,
-        .poll = e1000_net_poll
+        .poll = e1000_net_poll,
+        .tx_offload = e1000_net_tx_offload
     };
     static const char* ifnames[E1000_IF_MAX] = {
         "net0", "net1", "net2", "net3"
@@ -433,9 +914,18 @@ static int e1000_net_attach(fabric_device_t* dev)
     slot->dev = dev;
     slot->iface.hdr = RDNX_ABI_INIT(fabric_netif_t);
     slot->iface.name = ifnames[ifidx];
+    slot->vector = -1;
+    spinlock_init(&slot->tx_lock);
+    spinlock_init(&slot->rx_lock);
     if (e1000_hw_init(slot, dev) == RDNX_OK) {
         if (e1000_hw_setup_queues(slot) == RDNX_OK) {
             slot->hw_ready = 1;
+            slot->iface.caps = FABRIC_NETIF_CAP_TXCSUM_IP4 | FABRIC_NETIF_CAP_TXCSUM_L4 |
+                               FABRIC_NETIF_CAP_RXCSUM;
+            if (slot->hw.mac.type >= e1000_82571) {
+                slot->iface.caps |= FABRIC_NETIF_CAP_TSO4;
+            }
+            e1000_setup_irq(slot);
         } else {
             slot->hw_ready = 0;
             kputs("[E1000] queue setup failed\n");
@@ -459,15 +949,26 @@ static int e1000_net_attach(fabric_device_t* dev)
     slot->iface.ipv4_gateway = (ifidx == 0) ? QEMU_GW_IP : 0;    /* 10.0.2.2 */
     slot->iface.ops = &ops;
     slot->iface.context = slot;
+    if (slot->hw_ready) {
+        slot->rxq.iface = &slot->iface;
+        slot->rxq.vector = slot->vector;
+        slot->rxq.poll = e1000_rxq_poll;
+        slot->rxq.irq_enable = (slot->vector >= 0) ? e1000_rxq_irq_enable : NULL;
+        slot->rxq.context = slot;
+        slot->iface.rx_queues = 1;
+        slot->iface.tx_queues = 1;
+        slot->iface.rxq = &slot->rxq;
+    }
 
     if (fabric_netif_register(&slot->iface) != RDNX_OK) {
         memset(slot, 0, sizeof(*slot));
         return RDNX_E_GENERIC;
     }
 
-    fabric_log("[E1000] attached %s vendor=%x device=%x hw=%s\n",
+    fabric_log("[E1000] attached %s vendor=%x device=%x hw=%s rings=%u/%u caps=%x %s\n",
                slot->iface.name, dev->vendor_id, dev->device_id,
-               slot->hw_ready ? "real" : "fallback");
+               slot->hw_ready ? "real" : "fallback", slot->tx_count, slot->rx_count,
+               slot->iface.caps, (slot->vector >= 0) ? "msi" : "polled");
     return RDNX_OK;
 }
 
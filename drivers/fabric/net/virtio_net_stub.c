@@ -1,56 +1,564 @@
 /**
  * @file virtio_net_stub.c
- * @brief Fabric virtio-net stub driver (MVP bootstrap)
+ * @brief Fabric virtio-net driver with multiple queue pairs and RSS
+ *
+ * Each queue pair is a receive queue (2n) and a transmit queue (2n + 1);
+ * the control queue follows the last pair. Receive buffers are DMA-pool
+ * mbufs posted whole, so a frame is handed to the stack without a copy
+ * once the virtio-net header in front of it is stripped.
+ *
+ * With VIRTIO_NET_F_MQ the driver enables up to VNET_QUEUE_PAIRS_MAX pairs.
+ * Receive queue n is served by CPU n % cpu_count: it gets its own MSI-X
+ * vector aimed at that CPU and a fabric poll context that only that CPU
+ * runs. The vector only schedules the poll context; the queue's interrupt
+ * stays suppressed until a poll pass finds the ring drained. With
+ * VIRTIO_NET_F_RSS the device is programmed with the system Toeplitz key
+ * and an indirection table built by bsd_rss_getqueue(), so
+ * hardware steering agrees with software RPS; with
+ * VIRTIO_NET_F_HASH_REPORT the device hash becomes m_pkthdr.flowid and the
+ * stack does not hash again. Transmit uses the sending CPU's queue with
+ * completion interrupts suppressed; finished buffers are reclaimed on the
+ * next send.
  */
 
+#include "../virtio/virtio.h"
 #include "../../../kernel/fabric/fabric.h"
 #include "../../../kernel/fabric/device/device.h"
 #include "../../../kernel/fabric/driver/driver.h"
 #include "../../../kernel/fabric/service/net_service.h"
+#include "../../../kernel/fabric/spin.h"
 #include "../../../kernel/net/net.h"
 #include "../../../kernel/net/socket.h"
+#include "../../../kernel/net/bsd_mbuf.h"
+#include "../../../kernel/net/bsd_rss.h"
+#include "../../../kernel/core/cpu.h"
+#include "../../../kernel/core/memory.h"
+#include "../../../kernel/arch/config.h"
 #include "../../../include/common.h"
 #include "../../../include/console.h"
 #include "../../../include/error.h"
 #include <stdbool.h>
 #include <stdint.h>
 
-#define PCI_CLASS_NETWORK 0x02u
-#define VIRTIO_VENDOR_ID  0x1AF4u
-
 #define VIRTIO_NET_IF_MAX 4
 
-typedef struct {
+#ifndef VNET_QUEUE_PAIRS_MAX
+#define VNET_QUEUE_PAIRS_MAX 4u     /* each pair's receive queue takes one MSI vector */
+#endif
+#define VNET_RING_SIZE        256u
+#define VNET_CTRL_WAIT_MS     100u
+
+_Static_assert(VNET_QUEUE_PAIRS_MAX >= 1 && VNET_QUEUE_PAIRS_MAX <= FABRIC_NETIF_QUEUES_MAX,
+               "queue pairs must fit the fabric queue contexts");
+
+/* Feature bits. */
+#define VIRTIO_NET_F_MAC          5u
+#define VIRTIO_NET_F_CTRL_VQ      17u
+#define VIRTIO_NET_F_MQ           22u
+#define VIRTIO_NET_F_HASH_REPORT  57u
+#define VIRTIO_NET_F_RSS          60u
+
+/* struct virtio_net_config offsets. */
+#define VNET_CFG_MAC              0u
+#define VNET_CFG_MAX_PAIRS        8u
+#define VNET_CFG_RSS_MAX_KEY      17u
+#define VNET_CFG_RSS_MAX_INDIR    18u
+#define VNET_CFG_HASH_TYPES       20u
+
+/* Hash types (config supported_hash_types, RSS/hash commands). */
+#define VIRTIO_NET_HASH_TYPE_IPV4 (1u << 0)
+#define VIRTIO_NET_HASH_TYPE_TCPV4 (1u << 1)
+#define VIRTIO_NET_HASH_TYPE_UDPV4 (1u << 2)
+#define VNET_HASH_TYPES (VIRTIO_NET_HASH_TYPE_IPV4 | VIRTIO_NET_HASH_TYPE_TCPV4 | \
+                         VIRTIO_NET_HASH_TYPE_UDPV4)
+
+/* virtio_net_hdr_v1_hash.hash_report */
+enum {
+    VIRTIO_NET_HASH_REPORT_NONE  = 0,
+    VIRTIO_NET_HASH_REPORT_IPV4  = 1,
+    VIRTIO_NET_HASH_REPORT_TCPV4 = 2,
+    VIRTIO_NET_HASH_REPORT_UDPV4 = 3
+};
+
+/* Control queue. */
+#define VIRTIO_NET_CTRL_MQ                 4u
+#define VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET    0u
+#define VIRTIO_NET_CTRL_MQ_RSS_CONFIG      1u
+#define VIRTIO_NET_CTRL_MQ_HASH_CONFIG     2u
+#define VIRTIO_NET_OK                      0u
+
+typedef struct virtio_net_hdr {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+    uint16_t num_buffers;
+    /* VIRTIO_NET_F_HASH_REPORT only */
+    uint32_t hash_value;
+    uint16_t hash_report;
+    uint16_t padding;
+} __attribute__((packed)) virtio_net_hdr_t;
+
+#define VNET_HDR_LEN       12u
+#define VNET_HDR_HASH_LEN  20u
+
+_Static_assert(sizeof(virtio_net_hdr_t) == VNET_HDR_HASH_LEN, "virtio_net_hdr_v1_hash is 20 bytes");
+
+typedef struct vnet_slot vnet_slot_t;
+
+typedef struct vnet_rxq {
+    vnet_slot_t* slot;
+    virtqueue_t vq;
+    spinlock_t lock;
+    uint64_t nobuf;
+} vnet_rxq_t;
+
+typedef struct vnet_txq {
+    virtqueue_t vq;
+    spinlock_t lock;
+} vnet_txq_t;
+
+struct vnet_slot {
     int used;
     uint32_t index;
     fabric_device_t* dev;
     fabric_netif_t iface;
-} virtio_net_slot_t;
+    virtio_dev_t vdev;
+    bool hw_ready;
+    uint32_t hdr_len;
+    uint16_t pairs;
+    bool rss;                    /* device steers by our indirection table */
+    bool hash_report;            /* headers carry the device hash */
+    vnet_rxq_t rxq[VNET_QUEUE_PAIRS_MAX];
+    vnet_txq_t txq[VNET_QUEUE_PAIRS_MAX];
+    fabric_netif_queue_t rxq_ctx[VNET_QUEUE_PAIRS_MAX];
+    virtqueue_t ctrlq;
+    uint8_t* ctrl_page;          /* command header, data and ack */
+};
 
-static virtio_net_slot_t g_slots[VIRTIO_NET_IF_MAX];
+static vnet_slot_t g_slots[VIRTIO_NET_IF_MAX];
 static uint32_t g_next_index = 0;
 
-static int virtio_net_tx(fabric_netif_t* iface, const void* frame, uint32_t len)
+#define QEMU_GW_IP  0x0A000202u /* 10.0.2.2 */
+
+/* ============================================================================
+ * Receive
+ * ============================================================================ */
+
+static int vnet_rx_post(vnet_rxq_t* rxq, bsd_mbuf_t* m)
 {
-    if (!iface || !frame || len == 0) {
-        return RDNX_E_INVALID;
+    virtio_sg_t sg = { bsd_m_dma_addr(m), BSD_MBUF_DATA_MAX };
+    return virtqueue_add(&rxq->vq, &sg, 0, 1, m);
+}
+
+static void vnet_rx_fill(vnet_rxq_t* rxq)
+{
+    while (virtqueue_free(&rxq->vq) > 0) {
+        bsd_mbuf_t* m = bsd_m_gethdr(BSD_M_NOWAIT, BSD_MT_DATA);
+        if (!bsd_m_dma_addr(m)) {
+            bsd_m_freem(m);
+            rxq->nobuf++;
+            break;
+        }
+        if (vnet_rx_post(rxq, m) != RDNX_OK) {
+            bsd_m_freem(m);
+            break;
+        }
     }
-    (void)fabric_netif_rx_submit(iface, frame, len);
-    return (net_ingress_frame(frame, len, iface->context) == 0) ? RDNX_OK : RDNX_E_GENERIC;
+    virtqueue_kick(&rxq->vq);
 }
 
-static bool virtio_net_probe(fabric_device_t* dev)
+static uint16_t vnet_hashtype(uint16_t report)
 {
-    if (!dev) {
-        return false;
+    switch (report) {
+    case VIRTIO_NET_HASH_REPORT_NONE:
+        return BSD_M_HASHTYPE_NONE;
+    case VIRTIO_NET_HASH_REPORT_IPV4:
+        return BSD_M_HASHTYPE_IPV4;
+    case VIRTIO_NET_HASH_REPORT_TCPV4:
+        return BSD_M_HASHTYPE_TCP_IPV4;
+    case VIRTIO_NET_HASH_REPORT_UDPV4:
+        return BSD_M_HASHTYPE_UDP_IPV4;
+    default:
+        return BSD_M_HASHTYPE_OPAQUE;
     }
-    if (dev->class_code != PCI_CLASS_NETWORK) {
-        return false;
+}
+
+/* Take up to max completed buffers off the ring and repost the ring. */
+static uint32_t vnet_rx_harvest(vnet_rxq_t* rxq, bsd_mbuf_t** out, uint32_t max)
+{
+    vnet_slot_t* slot = rxq->slot;
+    uint32_t n = 0;
+    uint32_t len = 0;
+    spinlock_lock(&rxq->lock);
+    while (n < max) {
+        bsd_mbuf_t* m = (bsd_mbuf_t*)virtqueue_get(&rxq->vq, &len);
+        if (!m) {
+            break;
+        }
+        if (len <= slot->hdr_len || len > BSD_MBUF_DATA_MAX) {
+            slot->iface.stats.drops++;
+            bsd_m_freem(m);
+            continue;
+        }
+        const virtio_net_hdr_t* hdr = (const virtio_net_hdr_t*)m->m_dat;
+        if (slot->hash_report) {
+            m->m_pkthdr.hashtype = vnet_hashtype(hdr->hash_report);
+            m->m_pkthdr.flowid = hdr->hash_value;
+        }
+        m->m_data = m->m_dat + slot->hdr_len;
+        m->m_len = len - slot->hdr_len;
+        m->m_pkthdr.len = (int)m->m_len;
+        m->m_pkthdr.rcvif = &slot->iface;
+        out[n++] = m;
+    }
+    if (n > 0) {
+        vnet_rx_fill(rxq);
+    }
+    spinlock_unlock(&rxq->lock);
+    return n;
+}
+
+static uint32_t vnet_rxq_poll(fabric_netif_queue_t* q, uint32_t budget)
+{
+    vnet_rxq_t* rxq = (vnet_rxq_t*)q->context;
+    fabric_netif_t* iface = q->iface;
+    bsd_mbuf_t* batch[FABRIC_NETIF_POLL_BUDGET];
+    if (budget == 0) {
+        budget = FABRIC_NETIF_POLL_BUDGET;
+    }
+
+    uint32_t done = 0;
+    while (done < budget) {
+        uint32_t want = budget - done;
+        if (want > FABRIC_NETIF_POLL_BUDGET) {
+            want = FABRIC_NETIF_POLL_BUDGET;
+        }
+        uint32_t n = vnet_rx_harvest(rxq, batch, want);
+        for (uint32_t i = 0; i < n; i++) {
+            bsd_mbuf_t* m = batch[i];
+            if (fabric_netif_rx_submit(iface, bsd_mtod(m, const void*), m->m_len) != RDNX_OK) {
+                bsd_m_freem(m);
+                continue;
+            }
+            (void)net_ingress_mbuf(m);
+        }
+        done += n;
+        if (n < want) {
+            break;
+        }
     }
-    if (dev->vendor_id != VIRTIO_VENDOR_ID) {
+    return done;
+}
+
+static bool vnet_rxq_irq_enable(fabric_netif_queue_t* q, bool on)
+{
+    vnet_rxq_t* rxq = (vnet_rxq_t*)q->context;
+    if (!on) {
+        virtqueue_disable_cb(&rxq->vq);
         return false;
     }
-    return true;
+    spinlock_lock(&rxq->lock);
+    bool pending = virtqueue_enable_cb(&rxq->vq);
+    spinlock_unlock(&rxq->lock);
+    return pending;
+}
+
+/* Per-queue vector: mask it and leave the ring to the poll thread. */
+static void vnet_rxq_irq(virtqueue_t* vq)
+{
+    vnet_rxq_t* rxq = (vnet_rxq_t*)vq->priv;
+    fabric_netif_queue_schedule(&rxq->slot->rxq_ctx[rxq - rxq->slot->rxq]);
+}
+
+/* Shared vector: config changes and queues that did not get their own. */
+static void vnet_irq(virtio_dev_t* vdev)
+{
+    vnet_slot_t* slot = (vnet_slot_t*)vdev->priv;
+    for (uint32_t i = 0; i < slot->pairs; i++) {
+        if (slot->rxq[i].vq.vector < 0) {
+            fabric_netif_queue_schedule(&slot->rxq_ctx[i]);
+        }
+    }
+}
+
+/* ============================================================================
+ * Transmit
+ * ============================================================================ */
+
+static int vnet_tx(fabric_netif_t* iface, const void* frame, uint32_t len)
+{
+    vnet_slot_t* slot = iface ? (vnet_slot_t*)iface->context : NULL;
+    if (!slot || !frame || len == 0) {
+        return RDNX_E_INVALID;
+    }
+    if (!slot->hw_ready) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    if (len + slot->hdr_len > BSD_MBUF_DATA_MAX) {
+        return RDNX_E_INVALID;
+    }
+
+    bsd_mbuf_t* m = bsd_m_gethdr(BSD_M_NOWAIT, BSD_MT_DATA);
+    uint64_t dma = bsd_m_dma_addr(m);
+    if (!dma) {
+        bsd_m_freem(m);
+        return RDNX_E_NOMEM;
+    }
+    memset(m->m_dat, 0, slot->hdr_len);
+    memcpy(m->m_dat + slot->hdr_len, frame, len);
+
+    vnet_txq_t* txq = &slot->txq[cpu_get_id() % slot->pairs];
+    virtio_sg_t sg = { dma, slot->hdr_len + len };
+    spinlock_lock(&txq->lock);
+    bsd_mbuf_t* done;
+    while ((done = (bsd_mbuf_t*)virtqueue_get(&txq->vq, NULL)) != NULL) {
+        bsd_m_freem(done);
+    }
+    int rc = virtqueue_add(&txq->vq, &sg, 1, 0, m);
+    if (rc == RDNX_OK) {
+        virtqueue_kick(&txq->vq);
+    }
+    spinlock_unlock(&txq->lock);
+    if (rc != RDNX_OK) {
+        bsd_m_freem(m);
+    }
+    return rc;
+}
+
+/* ============================================================================
+ * Control queue
+ * ============================================================================ */
+
+/* Run one command synchronously; the device answers within VNET_CTRL_WAIT_MS. */
+static int vnet_ctrl_cmd(vnet_slot_t* slot, uint8_t cls, uint8_t cmd, const void* data, uint32_t len)
+{
+    if (!slot->ctrl_page || 2u + len + 1u > 4096u) {
+        return RDNX_E_INVALID;
+    }
+    uint8_t* p = slot->ctrl_page;
+    p[0] = cls;
+    p[1] = cmd;
+    memcpy(p + 2, data, len);
+    volatile uint8_t* ack = p + 2u + len;
+    *ack = 0xFFu;
+
+    const uint64_t phys = (uint64_t)ARCH_VIRT_TO_PHYS(p);
+    virtio_sg_t sg[2] = {
+        { phys, 2u + len },
+        { phys + 2u + len, 1u }
+    };
+    int rc = virtqueue_add(&slot->ctrlq, sg, 1, 1, slot);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    virtqueue_kick(&slot->ctrlq);
+    for (uint32_t ms = 0; ms < VNET_CTRL_WAIT_MS; ms++) {
+        if (virtqueue_get(&slot->ctrlq, NULL)) {
+            return (*ack == VIRTIO_NET_OK) ? RDNX_OK : RDNX_E_UNSUPPORTED;
+        }
+        virtio_udelay(1000);
+    }
+    return RDNX_E_TIMEOUT;
+}
+
+/*
+ * Program RSS: hash IPv4 and TCP/UDP over IPv4 with the system key and
+ * spread buckets over the receive queues the way RPS would.
+ */
+static int vnet_rss_config(vnet_slot_t* slot)
+{
+    uint32_t indir = virtio_cfg_read16(&slot->vdev, VNET_CFG_RSS_MAX_INDIR);
+    uint32_t keylen = virtio_cfg_read8(&slot->vdev, VNET_CFG_RSS_MAX_KEY);
+    uint32_t types = virtio_cfg_read32(&slot->vdev, VNET_CFG_HASH_TYPES) & VNET_HASH_TYPES;
+    if (indir > BSD_RSS_INDIR_SIZE) {
+        indir = BSD_RSS_INDIR_SIZE;
+    }
+    while (indir & (indir - 1u)) {
+        indir &= indir - 1u;
+    }
+    if (keylen > BSD_RSS_KEYLEN) {
+        keylen = BSD_RSS_KEYLEN;
+    }
+    if (indir == 0 || keylen == 0 || types == 0) {
+        return RDNX_E_UNSUPPORTED;
+    }
+
+    uint8_t buf[4 + 2 + 2 + 2 * BSD_RSS_INDIR_SIZE + 2 + 1 + BSD_RSS_KEYLEN];
+    uint32_t off = 0;
+    const uint16_t mask = (uint16_t)(indir - 1u);
+    const uint16_t unclassified = 0;
+    memcpy(buf + off, &types, 4);
+    off += 4;
+    memcpy(buf + off, &mask, 2);
+    off += 2;
+    memcpy(buf + off, &unclassified, 2);
+    off += 2;
+    for (uint32_t i = 0; i < indir; i++) {
+        uint16_t q = (uint16_t)bsd_rss_getqueue(i, slot->pairs);
+        memcpy(buf + off, &q, 2);
+        off += 2;
+    }
+    const uint16_t max_tx = slot->pairs;
+    memcpy(buf + off, &max_tx, 2);
+    off += 2;
+    buf[off++] = (uint8_t)keylen;
+    memcpy(buf + off, bsd_rss_key(), keylen);
+    off += keylen;
+    return vnet_ctrl_cmd(slot, VIRTIO_NET_CTRL_MQ, VIRTIO_NET_CTRL_MQ_RSS_CONFIG, buf, off);
+}
+
+/* Hash reporting without RSS: the device hashes but steering stays its own. */
+static int vnet_hash_config(vnet_slot_t* slot)
+{
+    uint32_t keylen = virtio_cfg_read8(&slot->vdev, VNET_CFG_RSS_MAX_KEY);
+    uint32_t types = virtio_cfg_read32(&slot->vdev, VNET_CFG_HASH_TYPES) & VNET_HASH_TYPES;
+    if (keylen > BSD_RSS_KEYLEN) {
+        keylen = BSD_RSS_KEYLEN;
+    }
+    if (keylen == 0 || types == 0) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    uint8_t buf[4 + 8 + 1 + BSD_RSS_KEYLEN];
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf, &types, 4);
+    buf[12] = (uint8_t)keylen;
+    memcpy(buf + 13, bsd_rss_key(), keylen);
+    return vnet_ctrl_cmd(slot, VIRTIO_NET_CTRL_MQ, VIRTIO_NET_CTRL_MQ_HASH_CONFIG, buf, 13u + keylen);
+}
+
+/*
+ * After DRIVER_OK: only queue pair 1 is live until the driver says
+ * otherwise. Falls back to fewer features rather than failing attach.
+ */
+static void vnet_configure_queues(vnet_slot_t* slot)
+{
+    if (!slot->ctrl_page) {
+        slot->pairs = 1;
+        slot->hash_report = false;
+        return;
+    }
+    if (slot->rss && vnet_rss_config(slot) != RDNX_OK) {
+        slot->rss = false;
+    }
+    if (!slot->rss && slot->pairs > 1) {
+        uint16_t pairs = slot->pairs;
+        if (vnet_ctrl_cmd(slot, VIRTIO_NET_CTRL_MQ, VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET,
+                          &pairs, sizeof(pairs)) != RDNX_OK) {
+            slot->pairs = 1;
+        }
+    }
+    if (slot->hash_report && !slot->rss && vnet_hash_config(slot) != RDNX_OK) {
+        slot->hash_report = false;
+    }
+}
+
+/* ============================================================================
+ * Attach
+ * ============================================================================ */
+
+static void vnet_release(vnet_slot_t* slot)
+{
+    for (uint32_t i = 0; i < VNET_QUEUE_PAIRS_MAX; i++) {
+        virtqueue_release_irq(&slot->rxq[i].vq);
+    }
+    virtio_fail(&slot->vdev);
+}
+
+static int vnet_hw_init(vnet_slot_t* slot, fabric_device_t* dev)
+{
+    virtio_dev_t* vdev = &slot->vdev;
+    const uint64_t wanted = (1ULL << VIRTIO_NET_F_MAC) | (1ULL << VIRTIO_NET_F_CTRL_VQ) |
+                            (1ULL << VIRTIO_NET_F_MQ) | (1ULL << VIRTIO_NET_F_HASH_REPORT) |
+                            (1ULL << VIRTIO_NET_F_RSS);
+    int rc = virtio_pci_init(vdev, dev);
+    if (rc == RDNX_OK) {
+        rc = virtio_negotiate(vdev, wanted);
+    }
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    vdev->priv = slot;
+
+    const bool ctrl = virtio_has_feature(vdev, VIRTIO_NET_F_CTRL_VQ);
+    uint32_t max_pairs = 1;
+    if (ctrl && (virtio_has_feature(vdev, VIRTIO_NET_F_MQ) || virtio_has_feature(vdev, VIRTIO_NET_F_RSS))) {
+        max_pairs = virtio_cfg_read16(vdev, VNET_CFG_MAX_PAIRS);
+        if (max_pairs == 0) {
+            max_pairs = 1;
+        }
+    }
+    slot->pairs = (uint16_t)((max_pairs < VNET_QUEUE_PAIRS_MAX) ? max_pairs : VNET_QUEUE_PAIRS_MAX);
+    slot->rss = ctrl && virtio_has_feature(vdev, VIRTIO_NET_F_RSS);
+    slot->hash_report = ctrl && virtio_has_feature(vdev, VIRTIO_NET_F_HASH_REPORT);
+    slot->hdr_len = slot->hash_report ? VNET_HDR_HASH_LEN : VNET_HDR_LEN;
+
+    for (uint32_t i = 0; i < VNET_QUEUE_PAIRS_MAX; i++) {
+        slot->rxq[i].vq.vector = -1;
+    }
+    virtio_setup_irq(vdev, vnet_irq);
+    const uint32_t ncpu = cpu_get_count() ? cpu_get_count() : 1u;
+    for (uint32_t i = 0; i < slot->pairs && rc == RDNX_OK; i++) {
+        vnet_rxq_t* rxq = &slot->rxq[i];
+        rxq->slot = slot;
+        spinlock_init(&rxq->lock);
+        spinlock_init(&slot->txq[i].lock);
+        rc = virtqueue_setup_irq(vdev, &rxq->vq, (uint16_t)(2u * i), VNET_RING_SIZE,
+                                 i % ncpu, vnet_rxq_irq, rxq);
+        if (rc == RDNX_OK) {
+            rc = virtqueue_setup(vdev, &slot->txq[i].vq, (uint16_t)(2u * i + 1u), VNET_RING_SIZE);
+        }
+        if (rc == RDNX_OK) {
+            slot->txq[i].vq.avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+        }
+    }
+    if (rc == RDNX_OK && ctrl) {
+        slot->ctrl_page = (uint8_t*)vmm_alloc_page(PAGE_FLAG_WRITABLE);
+        rc = slot->ctrl_page ? virtqueue_setup(vdev, &slot->ctrlq, (uint16_t)(2u * max_pairs), 8)
+                             : RDNX_E_NOMEM;
+    }
+    if (rc == RDNX_OK) {
+        /* Every receive descriptor owns a DMA-pool mbuf. */
+        (void)bsd_m_pool_reserve((uint32_t)slot->pairs * 2u * VNET_RING_SIZE);
+        for (uint32_t i = 0; i < slot->pairs; i++) {
+            vnet_rx_fill(&slot->rxq[i]);
+        }
+    }
+    if (rc != RDNX_OK) {
+        vnet_release(slot);
+        return rc;
+    }
+
+    virtio_driver_ok(vdev);
+    vnet_configure_queues(slot);
+
+    if (virtio_has_feature(vdev, VIRTIO_NET_F_MAC)) {
+        for (uint32_t i = 0; i < 6u; i++) {
+            slot->iface.mac[i] = virtio_cfg_read8(vdev, VNET_CFG_MAC + i);
+        }
+    }
+    for (uint32_t i = 0; i < slot->pairs; i++) {
+        fabric_netif_queue_t* q = &slot->rxq_ctx[i];
+        q->iface = &slot->iface;
+        q->index = (uint16_t)i;
+        q->cpu = (uint16_t)(i % ncpu);
+        q->vector = slot->rxq[i].vq.vector;
+        q->poll = vnet_rxq_poll;
+        /* Without MSI-X the queue is only ever polled. */
+        q->irq_enable = (vdev->vector >= 0) ? vnet_rxq_irq_enable : NULL;
+        q->context = &slot->rxq[i];
+    }
+    slot->iface.rx_queues = slot->pairs;
+    slot->iface.tx_queues = slot->pairs;
+    slot->iface.rxq = slot->rxq_ctx;
+    return RDNX_OK;
+}
+
+static bool virtio_net_probe(fabric_device_t* dev)
+{
+    return virtio_pci_device_type(dev) == VIRTIO_ID_NET;
 }
 
 static int virtio_net_attach(fabric_device_t* dev)
@@ -63,7 +571,7 @@ static int virtio_net_attach(fabric_device_t* dev)
         return RDNX_E_GENERIC;
     }
 
-    virtio_net_slot_t* slot = NULL;
+    vnet_slot_t* slot = NULL;
     for (uint32_t i = 0; i < VIRTIO_NET_IF_MAX; i++) {
         if (!g_slots[i].used) {
             slot = &g_slots[i];
@@ -76,7 +584,7 @@ static int virtio_net_attach(fabric_device_t* dev)
 
     static fabric_netif_ops_t ops = {
         .hdr = RDNX_ABI_INIT(fabric_netif_ops_t),
-        .tx = virtio_net_tx
+        .tx = vnet_tx
     };
     static const char* ifnames[VIRTIO_NET_IF_MAX] = {
         "eth0", "eth1", "eth2", "eth3"
@@ -99,18 +607,33 @@ static int virtio_net_attach(fabric_device_t* dev)
     slot->iface.mac[3] = 0xCC;
     slot->iface.mac[4] = 0x00;
     slot->iface.mac[5] = (uint8_t)(0x10 + ifidx);
+
+    int rc = vnet_hw_init(slot, dev);
+    slot->hw_ready = (rc == RDNX_OK);
+    if (!slot->hw_ready) {
+        fabric_log("[VNET] %s: init failed rc=%d\n", slot->iface.name, rc);
+    }
     slot->iface.mtu = NET_MAX_PACKET;
     slot->iface.flags = FABRIC_NETIF_F_BROADCAST;
+    slot->iface.ipv4_addr = (ifidx == 0) ? 0x0A00020Fu : 0;      /* 10.0.2.15 */
+    slot->iface.ipv4_netmask = (ifidx == 0) ? 0xFFFFFF00u : 0;   /* /24 */
+    slot->iface.ipv4_gateway = (ifidx == 0) ? QEMU_GW_IP : 0;    /* 10.0.2.2 */
     slot->iface.ops = &ops;
-    slot->iface.context = dev;
+    slot->iface.context = slot;
 
     if (fabric_netif_register(&slot->iface) != RDNX_OK) {
         memset(slot, 0, sizeof(*slot));
         return RDNX_E_GENERIC;
     }
 
-    fabric_log("[VNET] attached %s vendor=%x device=%x\n",
-               slot->iface.name, dev->vendor_id, dev->device_id);
+    uint32_t vectors = 0;
+    for (uint32_t i = 0; i < slot->pairs; i++) {
+        vectors += (slot->rxq[i].vq.vector >= 0) ? 1u : 0u;
+    }
+    fabric_log("[VNET] attached %s vendor=%x device=%x queues=%u rss=%u hash=%u vectors=%u %s\n",
+               slot->iface.name, dev->vendor_id, dev->device_id, slot->pairs,
+               slot->rss ? 1u : 0u, slot->hash_report ? 1u : 0u, vectors,
+               (slot->vdev.vector >= 0) ? "msix" : "polled");
     return RDNX_OK;
 }
 
@@ -133,7 +656,7 @@ static void virtio_net_detach(fabric_device_t* dev)
 }
 
 static fabric_driver_t g_driver = {
-    .name = "virtio-net-stub",
+    .name = "virtio-net",
     .probe = virtio_net_probe,
     .attach = virtio_net_attach,
     .publish = virtio_net_publish,
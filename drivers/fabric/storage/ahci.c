@@ -0,0 +1,1193 @@
+/**
+ * @file ahci.c
+ * @brief Fabric AHCI/SATA storage backend with native command queuing
+ *
+ * Every implemented port gets a command list, FIS receive area and 32
+ * command tables in DMA memory at attach time. Ports with an ATA disk are
+ * identified and published as block devices named ahci<C>p<P>.
+ *
+ * Disks that report NCQ use READ/WRITE FPDMA QUEUED with up to 32 tags in
+ * flight (min of HBA slots and the drive's queue depth); the others run
+ * one READ/WRITE DMA EXT at a time. All chunks of one request are issued
+ * with one PxSACT/PxCI write. Non-queued commands (IDENTIFY, FLUSH CACHE)
+ * freeze the port until the queue has drained.
+ *
+ * Data goes through a PRDT. Kernel buffers are physically contiguous in the
+ * physmap and take a single PRD. User buffers are bounced, like in the NVMe
+ * driver: one page for small transfers, otherwise separately allocated
+ * pages with one PRD each, so large bounces need no contiguous memory.
+ *
+ * Completion is interrupt driven through the HBA's MSI (one vector per
+ * controller) and polled when MSI is unavailable. Error recovery and
+ * hot-plug run in the ahcid thread: a task file error or a request timeout
+ * stops the port, fails every outstanding command and restarts it; a
+ * connect change identifies the new disk or marks the port removed. ahcid
+ * also rechecks link state once a second for HBAs that do not interrupt.
+ */
+
+#include "ahci.h"
+#include "../../../kernel/fabric/fabric.h"
+#include "../../../kernel/fabric/device/device.h"
+#include "../../../kernel/fabric/driver/driver.h"
+#include "../../../kernel/fabric/bus/pci.h"
+#include "../../../kernel/fabric/service/block_service.h"
+#include "../../../kernel/fabric/service/block_part.h"
+#include "../../../kernel/fabric/spin.h"
+#include "../../../kernel/common/heap.h"
+#include "../../../kernel/common/mutex.h"
+#include "../../../kernel/common/waitq.h"
+#include "../../../kernel/common/scheduler.h"
+#include "../../../kernel/common/preempt.h"
+#include "../../../kernel/core/memory.h"
+#include "../../../kernel/arch/config.h"
+#include "../../../kernel/arch/msi.h"
+#include "../../../include/common.h"
+#include "../../../include/console.h"
+#include "../../../include/error.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define AHCI_CTRL_MAX          2
+#define AHCI_PAGE_SIZE         4096u
+#define AHCI_SECTOR_SIZE       512u
+#define AHCI_MAX_XFER          (128u * 1024u)
+#define AHCI_PRDT_ENTRIES      (AHCI_MAX_XFER / AHCI_PAGE_SIZE + 1u)
+#define AHCI_CMD_TABLE_SIZE    768u    /* 0x80 + 33 PRDs, 128-byte aligned */
+#define AHCI_REQ_CHUNKS        8u
+#define AHCI_IO_TIMEOUT_MS     5000u
+#define AHCI_WAIT_SLICE_MS     20u
+#define AHCI_REG_TIMEOUT_MS    500u
+#define AHCI_HOTPLUG_PERIOD_MS 1000u
+
+_Static_assert(0x80u + AHCI_PRDT_ENTRIES * sizeof(ahci_prd_t) <= AHCI_CMD_TABLE_SIZE,
+               "command table holds the PRDT");
+_Static_assert(AHCI_CMD_TABLE_SIZE % 128u == 0, "command tables are 128-byte aligned");
+
+enum {
+    AHCI_BOUNCE_NONE = 0,
+    AHCI_BOUNCE_SMALL,      /* the slot's own page */
+    AHCI_BOUNCE_PAGES       /* one allocated page per PRD */
+};
+
+struct ahci_req;
+
+typedef struct ahci_slot {
+    struct ahci_req* req;   /* NULL once the owner gave up on it (timeout) */
+    uint8_t busy;
+    uint8_t done;
+    uint8_t failed;
+    uint8_t bounce;
+} ahci_slot_t;
+
+typedef struct ahci_port_stats {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t issues;        /* PxCI writes */
+    uint64_t errors;
+    uint64_t resets;
+} ahci_port_stats_t;
+
+struct ahci_ctrl;
+
+typedef struct ahci_port {
+    struct ahci_ctrl* ctrl;
+    uint32_t num;
+    volatile uint8_t* regs;
+    char name[12];
+    int present;            /* ATA disk identified and usable */
+    int registered;         /* block device registered; the name outlives an unplug */
+    bool ncq;
+    uint32_t depth;
+    uint32_t all_slots;     /* mask of the depth usable slots */
+    uint64_t sectors;
+    bool wcache;
+    ahci_cmd_hdr_t* clb;
+    uint8_t* fis;
+    uint8_t* tables;
+    uint8_t* small_bounce;
+    spinlock_t lock;
+    waitq_t slot_wq;
+    mutex_t excl;           /* serialises non-queued commands */
+    uint32_t slot_free;
+    uint32_t issued;        /* slots owned by the HBA */
+    uint8_t frozen;         /* no new submissions: recovery or a non-queued command */
+    volatile uint8_t need_reset;
+    volatile uint32_t events;   /* PxIS hot-plug/error bits left for ahcid */
+    ahci_slot_t slots[AHCI_MAX_SLOTS];
+    ahci_port_stats_t stats;
+    fabric_blockdev_t blockdev;
+    fabric_blockdev_ops_t blockops;
+} ahci_port_t;
+
+typedef struct ahci_ctrl {
+    int used;
+    uint32_t index;
+    fabric_device_t* dev;
+    volatile uint8_t* regs;
+    uint32_t cap;
+    uint32_t nslots;
+    int vector;             /* MSI vector, negative when polled */
+    ahci_port_t* ports[AHCI_MAX_PORTS];
+} ahci_ctrl_t;
+
+typedef struct ahci_req {
+    waitq_t wq;
+    volatile uint32_t pending;
+    uint8_t failed;
+} ahci_req_t;
+
+typedef struct ahci_chunk {
+    uint8_t slot;
+    uint8_t* user;          /* bounce copy-out target for reads, else NULL */
+    uint32_t bytes;
+} ahci_chunk_t;
+
+static ahci_ctrl_t g_ctrls[AHCI_CTRL_MAX];
+static waitq_t g_ahcid_wq;
+static thread_t* g_ahcid;
+
+static inline uint32_t ahci_rd(volatile uint8_t* base, uint32_t off)
+{
+    return *(volatile uint32_t*)(base + off);
+}
+
+static inline void ahci_wr(volatile uint8_t* base, uint32_t off, uint32_t value)
+{
+    *(volatile uint32_t*)(base + off) = value;
+}
+
+static void ahci_udelay(uint32_t us)
+{
+    /* A write to the POST port takes about a microsecond on PC hardware. */
+    for (uint32_t i = 0; i < us; i++) {
+        __asm__ volatile ("outb %%al, $0x80" : : "a"(0));
+    }
+}
+
+/* Poll until (reg & mask) == want, for at most ms milliseconds. */
+static int ahci_wait_reg(volatile uint8_t* base, uint32_t off, uint32_t mask, uint32_t want, uint32_t ms)
+{
+    for (uint32_t us = 0; us < ms * 1000u; us += 10u) {
+        if ((ahci_rd(base, off) & mask) == want) {
+            return RDNX_OK;
+        }
+        ahci_udelay(10);
+    }
+    return RDNX_E_TIMEOUT;
+}
+
+static inline uint64_t ahci_phys(const void* virt)
+{
+    return (uint64_t)ARCH_VIRT_TO_PHYS(virt);
+}
+
+/* Physmap addresses translate linearly; anything else needs a bounce. */
+static inline bool ahci_is_physmap(const void* p)
+{
+    uintptr_t v = (uintptr_t)p;
+    return v >= ARCH_KERNEL_VIRT_BASE && v < PCI_MMIO_VIRT_BASE;
+}
+
+static inline ahci_cmd_table_t* ahci_table(ahci_port_t* p, uint32_t slot)
+{
+    return (ahci_cmd_table_t*)(p->tables + slot * AHCI_CMD_TABLE_SIZE);
+}
+
+/* "ahci<C>p<P>" */
+static void ahci_port_name(char* out, uint32_t ctrl, uint32_t port)
+{
+    uint32_t i = 0;
+    memcpy(out, "ahci", 4);
+    i = 4;
+    out[i++] = (char)('0' + ctrl);
+    out[i++] = 'p';
+    if (port >= 10u) {
+        out[i++] = (char)('0' + port / 10u);
+    }
+    out[i++] = (char)('0' + port % 10u);
+    out[i] = '\0';
+}
+
+static void ahci_port_node_path(const ahci_port_t* p, char* out, size_t size)
+{
+    static const char prefix[] = "/fabric/services/";
+    size_t n = sizeof(prefix) - 1u;
+    size_t len = strlen(p->name);
+    if (n + len + 1u > size) {
+        out[0] = '\0';
+        return;
+    }
+    memcpy(out, prefix, n);
+    memcpy(out + n, p->name, len + 1u);
+}
+
+static void ahci_wake_ahcid(void)
+{
+    if (g_ahcid) {
+        (void)waitq_wake_one(&g_ahcid_wq);
+    }
+}
+
+/* ============================================================================
+ * Port engine
+ * ============================================================================ */
+
+static int ahci_port_stop(ahci_port_t* p)
+{
+    uint32_t cmd = ahci_rd(p->regs, AHCI_PX_CMD);
+    ahci_wr(p->regs, AHCI_PX_CMD, cmd & ~AHCI_PXCMD_ST);
+    return ahci_wait_reg(p->regs, AHCI_PX_CMD, AHCI_PXCMD_CR, 0, AHCI_REG_TIMEOUT_MS);
+}
+
+static int ahci_port_start(ahci_port_t* p)
+{
+    int rc = ahci_wait_reg(p->regs, AHCI_PX_TFD, AHCI_PXTFD_BSY | AHCI_PXTFD_DRQ, 0, AHCI_REG_TIMEOUT_MS);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    uint32_t cmd = ahci_rd(p->regs, AHCI_PX_CMD);
+    ahci_wr(p->regs, AHCI_PX_CMD, cmd | AHCI_PXCMD_FRE | AHCI_PXCMD_ST);
+    return RDNX_OK;
+}
+
+static bool ahci_port_link_up(const ahci_port_t* p)
+{
+    return AHCI_SSTS_DET(ahci_rd(p->regs, AHCI_PX_SSTS)) == AHCI_SSTS_DET_PRESENT;
+}
+
+/* COMRESET: kick the link when the device stays busy after a stop. */
+static void ahci_port_comreset(ahci_port_t* p)
+{
+    uint32_t sctl = ahci_rd(p->regs, AHCI_PX_SCTL) & ~0xFu;
+    ahci_wr(p->regs, AHCI_PX_SCTL, sctl | 0x1u);
+    ahci_udelay(1000);
+    ahci_wr(p->regs, AHCI_PX_SCTL, sctl);
+    (void)ahci_wait_reg(p->regs, AHCI_PX_SSTS, 0xFu, AHCI_SSTS_DET_PRESENT, AHCI_REG_TIMEOUT_MS);
+    ahci_wr(p->regs, AHCI_PX_SERR, 0xFFFFFFFFu);
+}
+
+/* Caller holds p->lock. Collect finished slots; hot-plug and errors go to ahcid. */
+static void ahci_port_reap_locked(ahci_port_t* p)
+{
+    uint32_t is = ahci_rd(p->regs, AHCI_PX_IS);
+    if (is) {
+        ahci_wr(p->regs, AHCI_PX_IS, is);
+    }
+    if (is & AHCI_PXIS_HOTPLUG) {
+        /* PCS stays set until SERR.DIAG.X is cleared. */
+        ahci_wr(p->regs, AHCI_PX_SERR, 0xFFFFFFFFu);
+    }
+    if (is & (AHCI_PXIS_HOTPLUG | AHCI_PXIS_ERROR)) {
+        p->events |= is & (AHCI_PXIS_HOTPLUG | AHCI_PXIS_ERROR);
+        if (is & AHCI_PXIS_ERROR) {
+            /* The queue is stuck until the port is restarted. */
+            p->need_reset = 1;
+            p->stats.errors++;
+        }
+        ahci_wake_ahcid();
+    }
+    if (!p->issued || p->need_reset) {
+        return;
+    }
+    uint32_t busy = ahci_rd(p->regs, AHCI_PX_CI);
+    if (p->ncq) {
+        busy |= ahci_rd(p->regs, AHCI_PX_SACT);
+    }
+    uint32_t done = p->issued & ~busy;
+    p->issued &= ~done;
+    while (done) {
+        uint32_t s = (uint32_t)__builtin_ctz(done);
+        done &= done - 1u;
+        ahci_slot_t* slot = &p->slots[s];
+        slot->done = 1;
+        p->stats.completed++;
+        ahci_req_t* req = slot->req;
+        if (req && req->pending > 0 && --req->pending == 0) {
+            (void)waitq_wake_one(&req->wq);
+        }
+    }
+}
+
+/* Fail everything the HBA owns; caller holds p->lock and the port is stopped. */
+static void ahci_port_fail_all_locked(ahci_port_t* p)
+{
+    uint32_t failed = p->issued;
+    p->issued = 0;
+    while (failed) {
+        uint32_t s = (uint32_t)__builtin_ctz(failed);
+        failed &= failed - 1u;
+        ahci_slot_t* slot = &p->slots[s];
+        slot->done = 1;
+        slot->failed = 1;
+        ahci_req_t* req = slot->req;
+        if (req) {
+            req->failed = 1;
+            if (req->pending > 0 && --req->pending == 0) {
+                (void)waitq_wake_one(&req->wq);
+            }
+        }
+    }
+}
+
+static void ahci_slot_free_bounce(ahci_port_t* p, uint32_t s)
+{
+    ahci_slot_t* slot = &p->slots[s];
+    if (slot->bounce == AHCI_BOUNCE_PAGES) {
+        ahci_cmd_table_t* t = ahci_table(p, s);
+        for (uint32_t i = 0; i < p->clb[s].prdtl; i++) {
+            uint64_t phys = (uint64_t)t->prdt[i].dba | ((uint64_t)t->prdt[i].dbau << 32);
+            vmm_free_page(ARCH_PHYS_TO_VIRT(phys));
+        }
+    }
+    slot->bounce = AHCI_BOUNCE_NONE;
+}
+
+/* Release slots abandoned by timed-out requests; caller holds p->lock. */
+static void ahci_port_release_orphans_locked(ahci_port_t* p)
+{
+    for (uint32_t s = 0; s < p->depth; s++) {
+        ahci_slot_t* slot = &p->slots[s];
+        if (slot->busy && !slot->req && slot->done) {
+            ahci_slot_free_bounce(p, s);
+            slot->busy = 0;
+            p->slot_free |= 1u << s;
+        }
+    }
+}
+
+static void ahci_irq(int vector, void* arg)
+{
+    (void)vector;
+    ahci_ctrl_t* c = (ahci_ctrl_t*)arg;
+    uint32_t is = ahci_rd(c->regs, AHCI_REG_IS);
+    uint32_t pending = is;
+    while (pending) {
+        uint32_t n = (uint32_t)__builtin_ctz(pending);
+        pending &= pending - 1u;
+        ahci_port_t* p = c->ports[n];
+        if (!p) {
+            continue;
+        }
+        irql_t irql = spinlock_lock_irqsave(&p->lock);
+        ahci_port_reap_locked(p);
+        spinlock_unlock_irqrestore(&p->lock, irql);
+    }
+    /* Port IS first, then the HBA summary bits. */
+    ahci_wr(c->regs, AHCI_REG_IS, is);
+}
+
+/* ============================================================================
+ * Waiting
+ * ============================================================================ */
+
+static bool ahci_can_sleep(const ahci_port_t* p)
+{
+    return p->ctrl->vector >= 0 && thread_get_current() != NULL && preemptible();
+}
+
+/*
+ * Wait until cond(p, arg) holds. Sleeps in short slices when the HBA has
+ * an interrupt (a wakeup racing the enqueue costs at most one slice),
+ * otherwise reaps the port by polling.
+ */
+static int ahci_wait(ahci_port_t* p, waitq_t* wq, bool (*cond)(ahci_port_t*, void*), void* arg,
+                     uint32_t timeout_ms)
+{
+    if (ahci_can_sleep(p)) {
+        uint64_t deadline = scheduler_get_ticks() + timeout_ms / SCHEDULER_TIME_SLICE_MS;
+        for (;;) {
+            irql_t irql = spinlock_lock_irqsave(&p->lock);
+            if (cond(p, arg)) {
+                spinlock_unlock_irqrestore(&p->lock, irql);
+                return RDNX_OK;
+            }
+            (void)waitq_enqueue(wq, thread_get_current());
+            spinlock_unlock_irqrestore(&p->lock, irql);
+            (void)waitq_wait(wq, AHCI_WAIT_SLICE_MS);
+            if (scheduler_get_ticks() > deadline) {
+                break;
+            }
+        }
+    } else {
+        for (uint32_t us = 0; us < timeout_ms * 1000u; us += 2u) {
+            irql_t irql = spinlock_lock_irqsave(&p->lock);
+            ahci_port_reap_locked(p);
+            bool ok = cond(p, arg);
+            spinlock_unlock_irqrestore(&p->lock, irql);
+            if (ok) {
+                return RDNX_OK;
+            }
+            ahci_udelay(2);
+        }
+    }
+    irql_t irql = spinlock_lock_irqsave(&p->lock);
+    bool ok = cond(p, arg);
+    spinlock_unlock_irqrestore(&p->lock, irql);
+    return ok ? RDNX_OK : RDNX_E_TIMEOUT;
+}
+
+static bool ahci_can_submit(ahci_port_t* p, void* arg)
+{
+    (void)arg;
+    return !p->present || (!p->frozen && p->slot_free != 0);
+}
+
+static bool ahci_port_idle(ahci_port_t* p, void* arg)
+{
+    (void)arg;
+    return p->issued == 0 && p->slot_free == p->all_slots;
+}
+
+static bool ahci_req_done(ahci_port_t* p, void* arg)
+{
+    (void)p;
+    return ((ahci_req_t*)arg)->pending == 0;
+}
+
+/* ============================================================================
+ * Command construction
+ * ============================================================================ */
+
+static void ahci_build_fis(ahci_cmd_table_t* t, uint8_t command, uint64_t lba, uint32_t sectors,
+                           int ncq_tag)
+{
+    ahci_fis_h2d_t* fis = (ahci_fis_h2d_t*)t->cfis;
+    memset(fis, 0, sizeof(*fis));
+    fis->type = AHCI_FIS_H2D;
+    fis->pm_c = AHCI_FIS_C;
+    fis->command = command;
+    fis->device = ATA_DEV_LBA;
+    fis->lba0 = (uint8_t)lba;
+    fis->lba1 = (uint8_t)(lba >> 8);
+    fis->lba2 = (uint8_t)(lba >> 16);
+    fis->lba3 = (uint8_t)(lba >> 24);
+    fis->lba4 = (uint8_t)(lba >> 32);
+    fis->lba5 = (uint8_t)(lba >> 40);
+    if (ncq_tag >= 0) {
+        /* FPDMA: sector count in the feature field, tag in count 7:3. */
+        fis->feature_lo = (uint8_t)sectors;
+        fis->feature_hi = (uint8_t)(sectors >> 8);
+        fis->count_lo = (uint8_t)(ncq_tag << 3);
+    } else {
+        fis->count_lo = (uint8_t)sectors;
+        fis->count_hi = (uint8_t)(sectors >> 8);
+    }
+}
+
+static void ahci_set_prd(ahci_prd_t* prd, uint64_t phys, uint32_t bytes)
+{
+    prd->dba = (uint32_t)phys;
+    prd->dbau = (uint32_t)(phys >> 32);
+    prd->rsvd = 0;
+    prd->dbc = bytes - 1u;
+}
+
+/*
+ * Point slot s at buf (bytes long). Kernel buffers take one PRD; user
+ * buffers are bounced (the write payload is copied in here).
+ */
+static int ahci_fill_prdt(ahci_port_t* p, uint32_t s, uint8_t* buf, uint32_t bytes, bool write)
+{
+    ahci_cmd_table_t* t = ahci_table(p, s);
+    ahci_slot_t* slot = &p->slots[s];
+    uint16_t n = 0;
+
+    if (bytes == 0) {
+        n = 0;
+    } else if (ahci_is_physmap(buf) && ((uintptr_t)buf & 1u) == 0) {
+        ahci_set_prd(&t->prdt[0], ahci_phys(buf), bytes);
+        n = 1;
+    } else if (bytes <= AHCI_PAGE_SIZE) {
+        uint8_t* page = p->small_bounce + s * AHCI_PAGE_SIZE;
+        if (write) {
+            memcpy(page, buf, bytes);
+        }
+        ahci_set_prd(&t->prdt[0], ahci_phys(page), bytes);
+        slot->bounce = AHCI_BOUNCE_SMALL;
+        n = 1;
+    } else {
+        for (uint32_t off = 0; off < bytes; off += AHCI_PAGE_SIZE) {
+            uint32_t len = (bytes - off < AHCI_PAGE_SIZE) ? bytes - off : AHCI_PAGE_SIZE;
+            uint8_t* page = (uint8_t*)vmm_alloc_page(PAGE_FLAG_WRITABLE);
+            if (!page) {
+                p->clb[s].prdtl = n;
+                slot->bounce = AHCI_BOUNCE_PAGES;
+                ahci_slot_free_bounce(p, s);
+                return RDNX_E_NOMEM;
+            }
+            if (write) {
+                memcpy(page, buf + off, len);
+            }
+            ahci_set_prd(&t->prdt[n++], ahci_phys(page), len);
+        }
+        slot->bounce = AHCI_BOUNCE_PAGES;
+    }
+    ahci_cmd_hdr_t* h = &p->clb[s];
+    h->flags = (uint16_t)(AHCI_HDR_CFL_H2D | AHCI_HDR_CLR_BUSY | (write ? AHCI_HDR_WRITE : 0u));
+    h->prdtl = n;
+    h->prdbc = 0;
+    return RDNX_OK;
+}
+
+static void ahci_copy_out(ahci_port_t* p, uint32_t s, uint8_t* user, uint32_t bytes)
+{
+    ahci_slot_t* slot = &p->slots[s];
+    if (slot->bounce == AHCI_BOUNCE_SMALL) {
+        memcpy(user, p->small_bounce + s * AHCI_PAGE_SIZE, bytes);
+    } else if (slot->bounce == AHCI_BOUNCE_PAGES) {
+        ahci_cmd_table_t* t = ahci_table(p, s);
+        uint32_t off = 0;
+        for (uint32_t i = 0; i < p->clb[s].prdtl && off < bytes; i++) {
+            uint64_t phys = (uint64_t)t->prdt[i].dba | ((uint64_t)t->prdt[i].dbau << 32);
+            uint32_t len = t->prdt[i].dbc + 1u;
+            memcpy(user + off, ARCH_PHYS_TO_VIRT(phys), len);
+            off += len;
+        }
+    }
+}
+
+static void ahci_slots_release(ahci_port_t* p, const ahci_chunk_t* chunks, uint32_t n, bool timed_out)
+{
+    irql_t irql = spinlock_lock_irqsave(&p->lock);
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t s = chunks[i].slot;
+        ahci_slot_t* slot = &p->slots[s];
+        if (timed_out && !slot->done) {
+            /* Still owned by the HBA: ahcid resets the port and frees it. */
+            slot->req = NULL;
+            p->need_reset = 1;
+            continue;
+        }
+        ahci_slot_free_bounce(p, s);
+        slot->req = NULL;
+        slot->busy = 0;
+        p->slot_free |= 1u << s;
+    }
+    (void)waitq_wake_all(&p->slot_wq);
+    spinlock_unlock_irqrestore(&p->lock, irql);
+    if (timed_out) {
+        ahci_wake_ahcid();
+    }
+}
+
+/* ============================================================================
+ * I/O path
+ * ============================================================================ */
+
+static int ahci_rw(ahci_port_t* p, bool write, uint64_t lba, uint32_t count, uint8_t* buf)
+{
+    const uint32_t max_sectors = AHCI_MAX_XFER / AHCI_SECTOR_SIZE;
+
+    while (count > 0) {
+        ahci_req_t req;
+        ahci_chunk_t chunks[AHCI_REQ_CHUNKS];
+        waitq_init(&req.wq, "ahci-req");
+        req.pending = 0;
+        req.failed = 0;
+
+        uint32_t want = (count + max_sectors - 1u) / max_sectors;
+        if (want > AHCI_REQ_CHUNKS) {
+            want = AHCI_REQ_CHUNKS;
+        }
+        if (!p->ncq) {
+            want = 1;
+        }
+        uint32_t n = 0;
+        for (;;) {
+            irql_t irql = spinlock_lock_irqsave(&p->lock);
+            if (!p->present) {
+                spinlock_unlock_irqrestore(&p->lock, irql);
+                return RDNX_E_NOTFOUND;
+            }
+            while (!p->frozen && n < want && p->slot_free) {
+                uint32_t s = (uint32_t)__builtin_ctz(p->slot_free);
+                p->slot_free &= ~(1u << s);
+                ahci_slot_t* slot = &p->slots[s];
+                slot->req = &req;
+                slot->busy = 1;
+                slot->done = 0;
+                slot->failed = 0;
+                slot->bounce = AHCI_BOUNCE_NONE;
+                chunks[n].slot = (uint8_t)s;
+                chunks[n].user = NULL;
+                chunks[n].bytes = 0;
+                n++;
+            }
+            spinlock_unlock_irqrestore(&p->lock, irql);
+            if (n > 0) {
+                break;
+            }
+            if (ahci_wait(p, &p->slot_wq, ahci_can_submit, NULL, AHCI_IO_TIMEOUT_MS) != RDNX_OK) {
+                return RDNX_E_TIMEOUT;
+            }
+        }
+
+        /* Build the commands outside the lock. */
+        uint32_t built = 0;
+        int rc = RDNX_OK;
+        for (; built < n; built++) {
+            ahci_chunk_t* ch = &chunks[built];
+            uint32_t sectors = (count > max_sectors) ? max_sectors : count;
+            uint32_t bytes = sectors * AHCI_SECTOR_SIZE;
+            rc = ahci_fill_prdt(p, ch->slot, buf, bytes, write);
+            if (rc != RDNX_OK) {
+                break;
+            }
+            if (!write && p->slots[ch->slot].bounce != AHCI_BOUNCE_NONE) {
+                ch->user = buf;
+            }
+            ch->bytes = bytes;
+            uint8_t op = p->ncq ? (write ? ATA_CMD_WRITE_FPDMA : ATA_CMD_READ_FPDMA)
+                                : (write ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT);
+            ahci_build_fis(ahci_table(p, ch->slot), op, lba, sectors, p->ncq ? (int)ch->slot : -1);
+            lba += sectors;
+            count -= sectors;
+            buf += bytes;
+        }
+        if (built < n) {
+            ahci_slots_release(p, chunks + built, n - built, false);
+            n = built;
+        }
+        if (n == 0) {
+            return rc;
+        }
+
+        /* All chunks go to the HBA with one SACT/CI write. */
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            mask |= 1u << chunks[i].slot;
+        }
+        irql_t irql = spinlock_lock_irqsave(&p->lock);
+        req.pending = n;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        if (p->ncq) {
+            ahci_wr(p->regs, AHCI_PX_SACT, mask);
+        }
+        ahci_wr(p->regs, AHCI_PX_CI, mask);
+        p->issued |= mask;
+        p->stats.submitted += n;
+        p->stats.issues++;
+        spinlock_unlock_irqrestore(&p->lock, irql);
+
+        if (ahci_wait(p, &req.wq, ahci_req_done, &req, AHCI_IO_TIMEOUT_MS) != RDNX_OK) {
+            ahci_slots_release(p, chunks, n, true);
+            fabric_log("[AHCI] %s: I/O timeout, resetting port\n", p->name);
+            return RDNX_E_TIMEOUT;
+        }
+        if (!req.failed) {
+            for (uint32_t i = 0; i < n; i++) {
+                if (chunks[i].user) {
+                    ahci_copy_out(p, chunks[i].slot, chunks[i].user, chunks[i].bytes);
+                }
+            }
+        }
+        ahci_slots_release(p, chunks, n, false);
+        if (req.failed) {
+            return RDNX_E_GENERIC;
+        }
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+    }
+    return RDNX_OK;
+}
+
+/*
+ * Run one non-queued command on slot 0 with the port frozen and drained.
+ * buf must be a kernel (physmap) buffer or NULL.
+ */
+static int ahci_exec_exclusive(ahci_port_t* p, uint8_t command, uint64_t lba, uint32_t sectors,
+                               void* buf, uint32_t bytes, bool write)
+{
+    mutex_lock(&p->excl);
+    irql_t irql = spinlock_lock_irqsave(&p->lock);
+    p->frozen = 1;
+    spinlock_unlock_irqrestore(&p->lock, irql);
+
+    int rc = ahci_wait(p, &p->slot_wq, ahci_port_idle, NULL, AHCI_IO_TIMEOUT_MS);
+    ahci_req_t req;
+    waitq_init(&req.wq, "ahci-req");
+    req.pending = 1;
+    req.failed = 0;
+    ahci_chunk_t ch = { 0, NULL, 0 };
+    if (rc == RDNX_OK) {
+        irql = spinlock_lock_irqsave(&p->lock);
+        p->slot_free &= ~1u;
+        p->slots[0].req = &req;
+        p->slots[0].busy = 1;
+        p->slots[0].done = 0;
+        p->slots[0].failed = 0;
+        p->slots[0].bounce = AHCI_BOUNCE_NONE;
+        spinlock_unlock_irqrestore(&p->lock, irql);
+
+        (void)ahci_fill_prdt(p, 0, (uint8_t*)buf, bytes, write);
+        ahci_build_fis(ahci_table(p, 0), command, lba, sectors, -1);
+        irql = spinlock_lock_irqsave(&p->lock);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        ahci_wr(p->regs, AHCI_PX_CI, 1u);
+        p->issued |= 1u;
+        p->stats.issues++;
+        spinlock_unlock_irqrestore(&p->lock, irql);
+
+        rc = ahci_wait(p, &req.wq, ahci_req_done, &req, AHCI_IO_TIMEOUT_MS);
+        ahci_slots_release(p, &ch, 1, rc != RDNX_OK);
+        if (rc == RDNX_OK && req.failed) {
+            rc = RDNX_E_GENERIC;
+        }
+    }
+
+    irql = spinlock_lock_irqsave(&p->lock);
+    p->frozen = 0;
+    (void)waitq_wake_all(&p->slot_wq);
+    spinlock_unlock_irqrestore(&p->lock, irql);
+    mutex_unlock(&p->excl);
+    return rc;
+}
+
+static ahci_port_t* ahci_port_of(fabric_blockdev_t* bdev)
+{
+    ahci_port_t* p = bdev ? (ahci_port_t*)bdev->context : NULL;
+    return (p && p->present) ? p : NULL;
+}
+
+static int ahci_block_read(fabric_blockdev_t* bdev, uint64_t lba, uint32_t count, void* out)
+{
+    if (!bdev || !out || count == 0) {
+        return RDNX_E_INVALID;
+    }
+    ahci_port_t* p = ahci_port_of(bdev);
+    if (!p) {
+        return RDNX_E_NOTFOUND;
+    }
+    return ahci_rw(p, false, lba, count, (uint8_t*)out);
+}
+
+static int ahci_block_write(fabric_blockdev_t* bdev, uint64_t lba, uint32_t count, const void* in)
+{
+    if (!bdev || !in || count == 0) {
+        return RDNX_E_INVALID;
+    }
+    ahci_port_t* p = ahci_port_of(bdev);
+    if (!p) {
+        return RDNX_E_NOTFOUND;
+    }
+    return ahci_rw(p, true, lba, count, (uint8_t*)(uintptr_t)in);
+}
+
+static int ahci_block_flush(fabric_blockdev_t* bdev)
+{
+    ahci_port_t* p = ahci_port_of(bdev);
+    if (!p) {
+        return bdev ? RDNX_E_NOTFOUND : RDNX_E_INVALID;
+    }
+    return ahci_exec_exclusive(p, ATA_CMD_FLUSH_CACHE_EXT, 0, 0, NULL, 0, false);
+}
+
+/* ============================================================================
+ * Port bring-up, hot-plug and recovery
+ * ============================================================================ */
+
+static int ahci_port_identify(ahci_port_t* p)
+{
+    uint16_t* id = (uint16_t*)vmm_alloc_page(PAGE_FLAG_WRITABLE);
+    if (!id) {
+        return RDNX_E_NOMEM;
+    }
+    /* Identify before NCQ is known: one slot, non-queued. */
+    p->ncq = false;
+    p->depth = 1;
+    p->all_slots = 1u;
+    p->slot_free = 1u;
+    int rc = ahci_exec_exclusive(p, ATA_CMD_IDENTIFY_DEVICE, 0, 0, id, 512u, false);
+    if (rc == RDNX_OK && !(id[ATA_ID_CMDSET_2] & (1u << 10))) {
+        rc = RDNX_E_UNSUPPORTED;    /* LBA48 only */
+    }
+    if (rc == RDNX_OK) {
+        p->sectors = (uint64_t)id[ATA_ID_LBA48_SECTORS] |
+                     ((uint64_t)id[ATA_ID_LBA48_SECTORS + 1u] << 16) |
+                     ((uint64_t)id[ATA_ID_LBA48_SECTORS + 2u] << 32) |
+                     ((uint64_t)id[ATA_ID_LBA48_SECTORS + 3u] << 48);
+        p->wcache = (id[ATA_ID_CMDSET_EN_1] & (1u << 5)) != 0;
+        uint32_t depth = 1;
+        if ((p->ctrl->cap & AHCI_CAP_SNCQ) && (id[ATA_ID_SATA_CAP] & (1u << 8))) {
+            depth = (id[ATA_ID_QUEUE_DEPTH] & 0x1Fu) + 1u;
+            if (depth > p->ctrl->nslots) {
+                depth = p->ctrl->nslots;
+            }
+            p->ncq = depth > 1u;
+        }
+        irql_t irql = spinlock_lock_irqsave(&p->lock);
+        p->depth = depth;
+        p->all_slots = (depth == 32u) ? 0xFFFFFFFFu : ((1u << depth) - 1u);
+        p->slot_free = p->all_slots;
+        spinlock_unlock_irqrestore(&p->lock, irql);
+
+        char model[41];
+        for (uint32_t i = 0; i < 20u; i++) {
+            model[2u * i] = (char)(id[ATA_ID_MODEL + i] >> 8);
+            model[2u * i + 1u] = (char)(id[ATA_ID_MODEL + i] & 0xFFu);
+        }
+        model[40] = '\0';
+        for (int i = 39; i >= 0 && (model[i] == ' ' || model[i] == '\0'); i--) {
+            model[i] = '\0';
+        }
+        fabric_log("[AHCI] %s: \"%s\" sectors=%llu (%llu MiB) ncq=%u depth=%u wcache=%u\n",
+                   p->name, model, (unsigned long long)p->sectors,
+                   (unsigned long long)((p->sectors * AHCI_SECTOR_SIZE) / (1024ULL * 1024ULL)),
+                   p->ncq ? 1u : 0u, depth, p->wcache ? 1u : 0u);
+    }
+    vmm_free_page(id);
+    return rc;
+}
+
+/* Start the engine on a linked port and identify its disk. */
+static int ahci_port_bringup(ahci_port_t* p)
+{
+    uint32_t sig = ahci_rd(p->regs, AHCI_PX_SIG);
+    if (sig != AHCI_SIG_ATA) {
+        return RDNX_E_UNSUPPORTED;   /* ATAPI, port multiplier, enclosure */
+    }
+    ahci_wr(p->regs, AHCI_PX_SERR, 0xFFFFFFFFu);
+    ahci_wr(p->regs, AHCI_PX_IS, 0xFFFFFFFFu);
+    int rc = ahci_port_start(p);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    p->present = 1;
+    rc = ahci_port_identify(p);
+    if (rc != RDNX_OK) {
+        p->present = 0;
+        return rc;
+    }
+    p->blockdev.sector_count = p->sectors;
+    p->blockdev.flags = p->wcache ? FABRIC_BLOCKDEV_F_WCACHE : 0u;
+    p->blockdev.queue_depth = p->depth;
+    return RDNX_OK;
+}
+
+static int ahci_port_register(ahci_port_t* p)
+{
+    if (p->registered) {
+        /* Re-attach: the new disk may differ in size and partition table. */
+        char path[FABRIC_NODE_PATH_MAX];
+        ahci_port_node_path(p, path, sizeof(path));
+        int rc = fabric_blockdev_rescan_partitions(&p->blockdev);
+        if (rc < 0) {
+            fabric_log("[AHCI] %s: partition rescan failed (%d)\n", p->name, rc);
+        }
+        return fabric_node_set_state(path, FABRIC_STATE_ACTIVE);
+    }
+    if (fabric_publish_service_node(p->name, "storage", p->ctrl->dev) != RDNX_OK) {
+        return RDNX_E_GENERIC;
+    }
+    p->registered = 1;
+    return fabric_blockdev_register(&p->blockdev);
+}
+
+/* Stop the port, fail what the HBA owned, restart it if the disk is still there. */
+static void ahci_port_recover(ahci_port_t* p, bool restart)
+{
+    irql_t irql = spinlock_lock_irqsave(&p->lock);
+    p->frozen = 1;
+    spinlock_unlock_irqrestore(&p->lock, irql);
+
+    if (ahci_port_stop(p) != RDNX_OK ||
+        (ahci_rd(p->regs, AHCI_PX_TFD) & (AHCI_PXTFD_BSY | AHCI_PXTFD_DRQ))) {
+        ahci_port_comreset(p);
+    }
+    ahci_wr(p->regs, AHCI_PX_SERR, 0xFFFFFFFFu);
+    ahci_wr(p->regs, AHCI_PX_IS, AHCI_PXIS_ERROR | AHCI_PXIS_COMPLETION);
+
+    irql = spinlock_lock_irqsave(&p->lock);
+    ahci_port_fail_all_locked(p);
+    ahci_port_release_orphans_locked(p);
+    p->need_reset = 0;
+    p->stats.resets++;
+    spinlock_unlock_irqrestore(&p->lock, irql);
+
+    if (restart && ahci_port_start(p) != RDNX_OK) {
+        restart = false;
+    }
+    irql = spinlock_lock_irqsave(&p->lock);
+    if (!restart) {
+        p->present = 0;
+    }
+    p->frozen = 0;
+    (void)waitq_wake_all(&p->slot_wq);
+    spinlock_unlock_irqrestore(&p->lock, irql);
+}
+
+static void ahci_port_service(ahci_port_t* p)
+{
+    irql_t irql = spinlock_lock_irqsave(&p->lock);
+    ahci_port_reap_locked(p);   /* polled HBAs report hot-plug here */
+    uint32_t events = p->events;
+    p->events = 0;
+    bool reset = p->need_reset != 0;
+    spinlock_unlock_irqrestore(&p->lock, irql);
+
+    bool link = ahci_port_link_up(p);
+    if (p->present && !link) {
+        ahci_port_recover(p, false);
+        fabric_log("[AHCI] %s: disk removed\n", p->name);
+        if (fabric_blockdev_drop_partitions(&p->blockdev) == RDNX_E_BUSY) {
+            fabric_log("[AHCI] %s: partition still open, kept until re-attach\n", p->name);
+        }
+        char path[FABRIC_NODE_PATH_MAX];
+        ahci_port_node_path(p, path, sizeof(path));
+        (void)fabric_node_set_state(path, FABRIC_STATE_REMOVED);
+        return;
+    }
+    if (reset && p->present) {
+        fabric_log("[AHCI] %s: recovering port (events %x)\n", p->name, events);
+        ahci_port_recover(p, true);
+        return;
+    }
+    if (!p->present && link && ((events & AHCI_PXIS_HOTPLUG) || !p->registered)) {
+        if (ahci_port_bringup(p) == RDNX_OK) {
+            fabric_log("[AHCI] %s: disk attached\n", p->name);
+            (void)ahci_port_register(p);
+        }
+    }
+}
+
+static void ahcid_main(void* arg)
+{
+    (void)arg;
+    for (;;) {
+        (void)waitq_wait(&g_ahcid_wq, AHCI_HOTPLUG_PERIOD_MS);
+        for (uint32_t c = 0; c < AHCI_CTRL_MAX; c++) {
+            if (!g_ctrls[c].used) {
+                continue;
+            }
+            for (uint32_t n = 0; n < AHCI_MAX_PORTS; n++) {
+                if (g_ctrls[c].ports[n]) {
+                    ahci_port_service(g_ctrls[c].ports[n]);
+                }
+            }
+        }
+    }
+}
+
+static int ahci_port_init(ahci_ctrl_t* c, uint32_t n)
+{
+    ahci_port_t* p = (ahci_port_t*)kmalloc(sizeof(*p));
+    if (!p) {
+        return RDNX_E_NOMEM;
+    }
+    memset(p, 0, sizeof(*p));
+    p->ctrl = c;
+    p->num = n;
+    p->regs = c->regs + AHCI_REG_PORTS + n * AHCI_PORT_STRIDE;
+    ahci_port_name(p->name, c->index, n);
+    spinlock_init(&p->lock);
+    waitq_init(&p->slot_wq, "ahci-slot");
+    mutex_init(&p->excl, "ahci-excl");
+
+    /* Command list (1 KiB) and FIS area (256 B) share a page. */
+    uint8_t* page = (uint8_t*)vmm_alloc_page(PAGE_FLAG_WRITABLE);
+    p->tables = (uint8_t*)vmm_alloc_pages((AHCI_MAX_SLOTS * AHCI_CMD_TABLE_SIZE) / AHCI_PAGE_SIZE,
+                                          PAGE_FLAG_WRITABLE);
+    p->small_bounce = (uint8_t*)vmm_alloc_pages(c->nslots, PAGE_FLAG_WRITABLE);
+    if (!page || !p->tables || !p->small_bounce) {
+        return RDNX_E_NOMEM;
+    }
+    p->clb = (ahci_cmd_hdr_t*)page;
+    p->fis = page + 1024u;
+    for (uint32_t s = 0; s < AHCI_MAX_SLOTS; s++) {
+        uint64_t ctba = ahci_phys(ahci_table(p, s));
+        p->clb[s].ctba = (uint32_t)ctba;
+        p->clb[s].ctbau = (uint32_t)(ctba >> 32);
+    }
+
+    (void)ahci_port_stop(p);
+    uint32_t cmd = ahci_rd(p->regs, AHCI_PX_CMD);
+    ahci_wr(p->regs, AHCI_PX_CMD, cmd & ~AHCI_PXCMD_FRE);
+    (void)ahci_wait_reg(p->regs, AHCI_PX_CMD, AHCI_PXCMD_FR, 0, AHCI_REG_TIMEOUT_MS);
+
+    uint64_t clb = ahci_phys(p->clb);
+    uint64_t fb = ahci_phys(p->fis);
+    ahci_wr(p->regs, AHCI_PX_CLB, (uint32_t)clb);
+    ahci_wr(p->regs, AHCI_PX_CLBU, (uint32_t)(clb >> 32));
+    ahci_wr(p->regs, AHCI_PX_FB, (uint32_t)fb);
+    ahci_wr(p->regs, AHCI_PX_FBU, (uint32_t)(fb >> 32));
+    ahci_wr(p->regs, AHCI_PX_SERR, 0xFFFFFFFFu);
+    ahci_wr(p->regs, AHCI_PX_IS, 0xFFFFFFFFu);
+    cmd = ahci_rd(p->regs, AHCI_PX_CMD) | AHCI_PXCMD_FRE;
+    if (c->cap & AHCI_CAP_SSS) {
+        cmd |= AHCI_PXCMD_SUD | AHCI_PXCMD_POD;
+    }
+    ahci_wr(p->regs, AHCI_PX_CMD, cmd);
+    ahci_wr(p->regs, AHCI_PX_IE, AHCI_PXIS_COMPLETION | AHCI_PXIS_ERROR | AHCI_PXIS_HOTPLUG);
+
+    p->blockops.hdr = RDNX_ABI_INIT(fabric_blockdev_ops_t);
+    p->blockops.read_sectors = ahci_block_read;
+    p->blockops.write_sectors = ahci_block_write;
+    p->blockops.flush = ahci_block_flush;
+    p->blockdev.hdr = RDNX_ABI_INIT(fabric_blockdev_t);
+    p->blockdev.name = p->name;
+    p->blockdev.sector_size = AHCI_SECTOR_SIZE;
+    p->blockdev.ops = &p->blockops;
+    p->blockdev.context = p;
+    c->ports[n] = p;
+
+    /* Give the PHY a moment to come up after spin-up. */
+    (void)ahci_wait_reg(p->regs, AHCI_PX_SSTS, 0xFu, AHCI_SSTS_DET_PRESENT, 10u);
+    if (ahci_port_link_up(p)) {
+        int rc = ahci_port_bringup(p);
+        if (rc != RDNX_OK && rc != RDNX_E_UNSUPPORTED) {
+            fabric_log("[AHCI] %s: bring-up failed rc=%d\n", p->name, rc);
+        }
+    }
+    return RDNX_OK;
+}
+
+/* ============================================================================
+ * Fabric driver glue
+ * ============================================================================ */
+
+static bool ahci_storage_probe(fabric_device_t* dev)
+{
+    if (!dev) {
+        return false;
+    }
+    return dev->class_code == PCI_CLASS_STORAGE &&
+           dev->subclass == PCI_SUBCLASS_SATA &&
+           dev->prog_if == PCI_PROGIF_AHCI;
+}
+
+static int ahci_storage_attach(fabric_device_t* dev)
+{
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    for (uint32_t i = 0; i < AHCI_CTRL_MAX; i++) {
+        ahci_ctrl_t* c = &g_ctrls[i];
+        if (c->used) {
+            continue;
+        }
+        memset(c, 0, sizeof(*c));
+        c->used = 1;
+        c->index = i;
+        c->dev = dev;
+        c->vector = -1;
+
+        uint64_t abar = pci_bar_address(dev, AHCI_ABAR);
+        c->regs = abar ? (volatile uint8_t*)pci_map_mmio(abar, AHCI_REG_PORTS + AHCI_MAX_PORTS * AHCI_PORT_STRIDE)
+                       : NULL;
+        if (!c->regs) {
+            fabric_log("[AHCI] ahci%u: no ABAR\n", i);
+            return RDNX_OK;
+        }
+        pci_enable_bus_master(dev);
+
+        /* HBA reset, then AHCI mode with interrupts off until the ports are set up. */
+        ahci_wr(c->regs, AHCI_REG_GHC, AHCI_GHC_AE);
+        ahci_wr(c->regs, AHCI_REG_GHC, AHCI_GHC_AE | AHCI_GHC_HR);
+        if (ahci_wait_reg(c->regs, AHCI_REG_GHC, AHCI_GHC_HR, 0, 1000u) != RDNX_OK) {
+            fabric_log("[AHCI] ahci%u: HBA reset timeout\n", i);
+            return RDNX_OK;
+        }
+        ahci_wr(c->regs, AHCI_REG_GHC, AHCI_GHC_AE);
+        c->cap = ahci_rd(c->regs, AHCI_REG_CAP);
+        c->nslots = AHCI_CAP_NCS(c->cap) + 1u;
+
+        if (msi_is_available()) {
+            int vector = msi_vector_alloc();
+            uint64_t addr = 0;
+            uint32_t data = 0;
+            if (vector >= 0 &&
+                msi_compose(vector, 0, &addr, &data) == RDNX_OK &&
+                fabric_request_irq(vector, ahci_irq, c) == RDNX_OK &&
+                pci_msi_enable(dev, addr, data) == RDNX_OK) {
+                c->vector = vector;
+            } else if (vector >= 0) {
+                fabric_free_irq(vector, ahci_irq);
+                msi_vector_free(vector);
+            }
+        }
+
+        uint32_t pi = ahci_rd(c->regs, AHCI_REG_PI);
+        uint32_t nports = 0;
+        for (uint32_t n = 0; n < AHCI_MAX_PORTS; n++) {
+            if ((pi & (1u << n)) && ahci_port_init(c, n) == RDNX_OK) {
+                nports++;
+            }
+        }
+        ahci_wr(c->regs, AHCI_REG_IS, 0xFFFFFFFFu);
+        if (c->vector >= 0) {
+            ahci_wr(c->regs, AHCI_REG_GHC, AHCI_GHC_AE | AHCI_GHC_IE);
+        }
+        fabric_log("[AHCI] attached ahci%u vendor=%x device=%x ports=%u slots=%u ncq=%u %s\n",
+                   i, dev->vendor_id, dev->device_id, nports, c->nslots,
+                   (c->cap & AHCI_CAP_SNCQ) ? 1u : 0u, (c->vector >= 0) ? "msi" : "polled");
+        return RDNX_OK;
+    }
+    return RDNX_E_BUSY;
+}
+
+static int ahci_storage_publish(fabric_device_t* dev)
+{
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    for (uint32_t i = 0; i < AHCI_CTRL_MAX; i++) {
+        ahci_ctrl_t* c = &g_ctrls[i];
+        if (!c->used || c->dev != dev) {
+            continue;
+        }
+        for (uint32_t n = 0; n < AHCI_MAX_PORTS; n++) {
+            ahci_port_t* p = c->ports[n];
+            if (p && p->present && ahci_port_register(p) != RDNX_OK) {
+                return RDNX_E_GENERIC;
+            }
+        }
+        return RDNX_OK;
+    }
+    return RDNX_E_NOTFOUND;
+}
+
+static void ahci_storage_detach(fabric_device_t* dev)
+{
+    (void)dev;
+}
+
+static fabric_driver_t g_driver = {
+    .name = "ahci-storage",
+    .probe = ahci_storage_probe,
+    .attach = ahci_storage_attach,
+    .publish = ahci_storage_publish,
+    .detach = ahci_storage_detach,
+    .suspend = NULL,
+    .resume = NULL
+};
+
+void ahci_storage_init(void)
+{
+    int rc = fabric_driver_register(&g_driver);
+    if (rc == RDNX_OK) {
+        kputs("[AHCI] driver registered\n");
+    } else {
+        kputs("[AHCI] driver register failed\n");
+    }
+}
+
+/* Hot-plug and error-recovery thread; needs the kernel task, so runs after fabric init. */
+void ahci_storage_start(void)
+{
+    if (g_ahcid || !g_ctrls[0].used) {
+        return;
+    }
+    task_t* kernel_task = task_get_current();
+    if (!kernel_task) {
+        return;
+    }
+    waitq_init(&g_ahcid_wq, "ahcid");
+    thread_t* t = thread_create(kernel_task, ahcid_main, NULL);
+    if (!t) {
+        return;
+    }
+    scheduler_set_bucket(t, SCHED_BUCKET_UTILITY);
+    g_ahcid = t;
+    scheduler_add_thread(t);
+}
@@ -0,0 +1,180 @@
+/**
+ * @file ahci.h
+ * @brief AHCI 1.3 HBA registers, command list structures and ATA opcodes
+ */
+
+#ifndef _RODNIX_DRIVERS_STORAGE_AHCI_H
+#define _RODNIX_DRIVERS_STORAGE_AHCI_H
+
+#include <stdint.h>
+
+#define PCI_CLASS_STORAGE      0x01u
+#define PCI_SUBCLASS_SATA      0x06u
+#define PCI_PROGIF_AHCI        0x01u
+
+#define AHCI_ABAR              5u      /* BAR holding the HBA registers */
+#define AHCI_MAX_PORTS         32u
+#define AHCI_MAX_SLOTS         32u
+
+/* Generic host control. */
+enum {
+    AHCI_REG_CAP  = 0x00,
+    AHCI_REG_GHC  = 0x04,
+    AHCI_REG_IS   = 0x08,
+    AHCI_REG_PI   = 0x0C,
+    AHCI_REG_VS   = 0x10,
+    AHCI_REG_CAP2 = 0x24,
+    AHCI_REG_PORTS = 0x100  /* port p registers at 0x100 + p * 0x80 */
+};
+
+#define AHCI_PORT_STRIDE       0x80u
+
+#define AHCI_CAP_NP(cap)       ((cap) & 0x1Fu)           /* ports - 1 */
+#define AHCI_CAP_NCS(cap)      (((cap) >> 8) & 0x1Fu)    /* command slots - 1 */
+#define AHCI_CAP_SSS           (1u << 27)                /* staggered spin-up */
+#define AHCI_CAP_SNCQ          (1u << 30)
+#define AHCI_CAP_S64A          (1u << 31)
+
+#define AHCI_GHC_HR            (1u << 0)
+#define AHCI_GHC_IE            (1u << 1)
+#define AHCI_GHC_AE            (1u << 31)
+
+/* Port registers (offsets inside a port's 0x80 window). */
+enum {
+    AHCI_PX_CLB  = 0x00,
+    AHCI_PX_CLBU = 0x04,
+    AHCI_PX_FB   = 0x08,
+    AHCI_PX_FBU  = 0x0C,
+    AHCI_PX_IS   = 0x10,
+    AHCI_PX_IE   = 0x14,
+    AHCI_PX_CMD  = 0x18,
+    AHCI_PX_TFD  = 0x20,
+    AHCI_PX_SIG  = 0x24,
+    AHCI_PX_SSTS = 0x28,
+    AHCI_PX_SCTL = 0x2C,
+    AHCI_PX_SERR = 0x30,
+    AHCI_PX_SACT = 0x34,
+    AHCI_PX_CI   = 0x38
+};
+
+#define AHCI_PXCMD_ST          (1u << 0)
+#define AHCI_PXCMD_SUD         (1u << 1)
+#define AHCI_PXCMD_POD         (1u << 2)
+#define AHCI_PXCMD_FRE         (1u << 4)
+#define AHCI_PXCMD_FR          (1u << 14)
+#define AHCI_PXCMD_CR          (1u << 15)
+
+#define AHCI_PXIS_DHRS         (1u << 0)   /* D2H register FIS */
+#define AHCI_PXIS_PSS          (1u << 1)   /* PIO setup FIS */
+#define AHCI_PXIS_DSS          (1u << 2)   /* DMA setup FIS */
+#define AHCI_PXIS_SDBS         (1u << 3)   /* set device bits FIS (NCQ completion) */
+#define AHCI_PXIS_DPS          (1u << 5)   /* descriptor processed */
+#define AHCI_PXIS_PCS          (1u << 6)   /* port connect change */
+#define AHCI_PXIS_PRCS         (1u << 22)  /* PhyRdy change */
+#define AHCI_PXIS_OFS          (1u << 24)  /* overflow */
+#define AHCI_PXIS_INFS         (1u << 26)  /* interface non-fatal */
+#define AHCI_PXIS_IFS          (1u << 27)  /* interface fatal */
+#define AHCI_PXIS_HBDS         (1u << 28)  /* host bus data error */
+#define AHCI_PXIS_HBFS         (1u << 29)  /* host bus fatal */
+#define AHCI_PXIS_TFES         (1u << 30)  /* task file error */
+
+#define AHCI_PXIS_HOTPLUG      (AHCI_PXIS_PCS | AHCI_PXIS_PRCS)
+#define AHCI_PXIS_ERROR        (AHCI_PXIS_TFES | AHCI_PXIS_HBFS | AHCI_PXIS_HBDS | \
+                                AHCI_PXIS_IFS | AHCI_PXIS_OFS)
+#define AHCI_PXIS_COMPLETION   (AHCI_PXIS_DHRS | AHCI_PXIS_PSS | AHCI_PXIS_DSS | \
+                                AHCI_PXIS_SDBS | AHCI_PXIS_DPS)
+
+#define AHCI_PXTFD_ERR         0x01u
+#define AHCI_PXTFD_DRQ         0x08u
+#define AHCI_PXTFD_BSY         0x80u
+
+#define AHCI_SSTS_DET(s)       ((s) & 0xFu)
+#define AHCI_SSTS_DET_PRESENT  0x3u        /* device present, PHY up */
+
+#define AHCI_SIG_ATA           0x00000101u
+#define AHCI_SIG_ATAPI         0xEB140101u
+
+/* Command header: one per slot in the 1 KiB command list. */
+typedef struct ahci_cmd_hdr {
+    uint16_t flags;         /* CFL 4:0, A 5, W 6, P 7, R 8, B 9, C 10, PMP 15:12 */
+    uint16_t prdtl;         /* PRDT entries */
+    volatile uint32_t prdbc;
+    uint32_t ctba;
+    uint32_t ctbau;
+    uint32_t rsvd[4];
+} __attribute__((packed)) ahci_cmd_hdr_t;
+
+#define AHCI_HDR_CFL_H2D       5u          /* FIS length in dwords */
+#define AHCI_HDR_WRITE         (1u << 6)
+#define AHCI_HDR_CLR_BUSY      (1u << 10)
+
+/* Physical region descriptor. */
+typedef struct ahci_prd {
+    uint32_t dba;
+    uint32_t dbau;
+    uint32_t rsvd;
+    uint32_t dbc;           /* byte count - 1 (21:0, even), I 31 */
+} __attribute__((packed)) ahci_prd_t;
+
+#define AHCI_PRD_MAX_BYTES     (4u * 1024u * 1024u)
+
+/* Host-to-device register FIS. */
+typedef struct ahci_fis_h2d {
+    uint8_t type;           /* 0x27 */
+    uint8_t pm_c;           /* bit 7: command (vs. control) */
+    uint8_t command;
+    uint8_t feature_lo;
+    uint8_t lba0;
+    uint8_t lba1;
+    uint8_t lba2;
+    uint8_t device;
+    uint8_t lba3;
+    uint8_t lba4;
+    uint8_t lba5;
+    uint8_t feature_hi;
+    uint8_t count_lo;
+    uint8_t count_hi;
+    uint8_t icc;
+    uint8_t control;
+    uint8_t rsvd[4];
+} __attribute__((packed)) ahci_fis_h2d_t;
+
+#define AHCI_FIS_H2D           0x27u
+#define AHCI_FIS_C             0x80u
+
+/* Command table: command FIS, ATAPI command, then the PRDT. */
+typedef struct ahci_cmd_table {
+    uint8_t cfis[64];
+    uint8_t acmd[16];
+    uint8_t rsvd[48];
+    ahci_prd_t prdt[];
+} __attribute__((packed)) ahci_cmd_table_t;
+
+_Static_assert(sizeof(ahci_cmd_hdr_t) == 32, "AHCI command header is 32 bytes");
+_Static_assert(sizeof(ahci_prd_t) == 16, "AHCI PRD is 16 bytes");
+_Static_assert(sizeof(ahci_fis_h2d_t) == 20, "H2D register FIS is 20 bytes");
+_Static_assert(sizeof(ahci_cmd_table_t) == 128, "PRDT starts at 0x80");
+
+/* ATA commands. */
+enum {
+    ATA_CMD_READ_DMA_EXT     = 0x25,
+    ATA_CMD_WRITE_DMA_EXT    = 0x35,
+    ATA_CMD_READ_FPDMA       = 0x60,   /* NCQ: tag in count 7:3, sectors in feature */
+    ATA_CMD_WRITE_FPDMA      = 0x61,
+    ATA_CMD_FLUSH_CACHE_EXT  = 0xEA,
+    ATA_CMD_IDENTIFY_DEVICE  = 0xEC
+};
+
+#define ATA_DEV_LBA            0x40u
+#define ATA_DEV_FUA            0x80u   /* FPDMA: forced unit access */
+
+/* IDENTIFY DEVICE word offsets. */
+#define ATA_ID_QUEUE_DEPTH     75u     /* 4:0 = max depth - 1 */
+#define ATA_ID_SATA_CAP        76u     /* bit 8: NCQ */
+#define ATA_ID_CMDSET_2        83u     /* bit 10: LBA48 */
+#define ATA_ID_CMDSET_EN_1     85u     /* bit 5: write cache enabled */
+#define ATA_ID_LBA48_SECTORS   100u    /* 4 words */
+#define ATA_ID_LBA28_SECTORS   60u     /* 2 words */
+#define ATA_ID_MODEL           27u     /* 20 words, byte-swapped ASCII */
+
+#endif /* _RODNIX_DRIVERS_STORAGE_AHCI_H */
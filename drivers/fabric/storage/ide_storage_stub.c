@@ -246,18 +246,31 @@ static int ide_block_write(fabric_blockdev_t* bdev, uint64_t lba, uint32_t count
             ide_io_wait(slot);
         }
 
-        /* Ensure data is committed before returning to upper layers. */
-        ide_outb((uint16_t)(slot->io_base + ATA_REG_COMMAND), ATA_CMD_CACHE_FLUSH);
-        if (ide_wait_ready(slot, false) != RDNX_OK) {
-            return RDNX_E_TIMEOUT;
-        }
-
         cur_lba += batch;
         remain -= batch;
     }
     return RDNX_OK;
 }
 
+static int ide_block_flush(fabric_blockdev_t* bdev)
+{
+    if (!bdev) {
+        return RDNX_E_INVALID;
+    }
+    ide_slot_t* slot = (ide_slot_t*)bdev->context;
+    if (!slot || !slot->present) {
+        return RDNX_E_NOTFOUND;
+    }
+    /* Write cache is drained only on request (fsync/sync/FUA), not per batch. */
+    ide_outb((uint16_t)(slot->io_base + ATA_REG_HDDEVSEL), slot->drive_head);
+    ide_io_wait(slot);
+    ide_outb((uint16_t)(slot->io_base + ATA_REG_COMMAND), ATA_CMD_CACHE_FLUSH);
+    if (ide_wait_ready(slot, false) != RDNX_OK) {
+        return RDNX_E_TIMEOUT;
+    }
+    return RDNX_OK;
+}
+
 static bool ide_storage_probe(fabric_device_t* dev)
 {
     if (!dev) {
@@ -284,11 +297,12 @@ static int ide_storage_attach(fabric_device_t* dev)
             g_slots[i].blockops.hdr = RDNX_ABI_INIT(fabric_blockdev_ops_t);
             g_slots[i].blockops.read_sectors = ide_block_read;
             g_slots[i].blockops.write_sectors = ide_block_write;
+            g_slots[i].blockops.flush = ide_block_flush;
             g_slots[i].blockdev.hdr = RDNX_ABI_INIT(fabric_blockdev_t);
             g_slots[i].blockdev.name = g_slots[i].disk_name;
             g_slots[i].blockdev.sector_size = 512;
             g_slots[i].blockdev.sector_count = 0;
-            g_slots[i].blockdev.flags = 0;
+            g_slots[i].blockdev.flags = FABRIC_BLOCKDEV_F_WCACHE;
             g_slots[i].blockdev.ops = &g_slots[i].blockops;
             g_slots[i].blockdev.context = &g_slots[i];
 
@@ -0,0 +1,1163 @@
+/**
+ * @file nvme.c
+ * @brief Fabric NVMe storage backend (admin queue + per-CPU I/O queue pairs)
+ *
+ * Each controller gets one admin queue pair, used polled at attach time,
+ * and up to NVME_IOQ_MAX I/O queue pairs: one per CPU, capped by what the
+ * controller grants. A caller submits on queue (cpu id % queue count), so
+ * CPUs never share a submission lock. Every I/O completion queue has its own
+ * MSI-X entry and vector; without MSI-X the queues are polled.
+ *
+ * Requests are split into chunks of at most the controller's MDTS (capped
+ * at NVME_MAX_XFER). All chunks of one request go out under a single SQ
+ * doorbell write, and the completion path writes the CQ doorbell once per
+ * reaped batch. Data pointers are PRPs, or a single SGL data block when the
+ * controller supports SGLs and the chunk is at least NVME_SGL_THRESHOLD.
+ * Every DMA region is physically contiguous: kernel buffers live in the
+ * physmap, and user buffers go through bounce pages because user pages can
+ * be COW-shared or reclaimed while the device writes to them.
+ *
+ * The fabric block interface is synchronous, so queue depth comes from
+ * several threads issuing I/O at once; each one sleeps on its own request
+ * until the interrupt handler has reaped all of its chunks.
+ *
+ * A request that times out is recovered by the thread that waited on it:
+ * it sends an Abort for each of its outstanding commands, and if they are
+ * not completed within NVME_ABORT_TIMEOUT_MS it resets the controller
+ * (CC.EN=0), fails every command issued on any queue, and re-creates the
+ * admin and I/O queues on the same memory. Submitters wait while the
+ * queues are frozen for the reset.
+ */
+
+#include "nvme.h"
+#include "../../../kernel/fabric/fabric.h"
+#include "../../../kernel/fabric/device/device.h"
+#include "../../../kernel/fabric/driver/driver.h"
+#include "../../../kernel/fabric/bus/pci.h"
+#include "../../../kernel/fabric/service/block_service.h"
+#include "../../../kernel/fabric/spin.h"
+#include "../../../kernel/common/waitq.h"
+#include "../../../kernel/common/scheduler.h"
+#include "../../../kernel/common/preempt.h"
+#include "../../../kernel/core/cpu.h"
+#include "../../../kernel/core/memory.h"
+#include "../../../kernel/arch/config.h"
+#include "../../../kernel/arch/msi.h"
+#include "../../../include/common.h"
+#include "../../../include/console.h"
+#include "../../../include/error.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NVME_CTRL_MAX          2
+#define NVME_IOQ_MAX           4u
+#define NVME_ADMIN_QSIZE       32u
+#define NVME_IO_QSIZE          128u
+#define NVME_IO_SLOTS          64u     /* commands in flight per queue, < NVME_IO_QSIZE */
+#define NVME_PAGE_SIZE         4096u
+#define NVME_MAX_XFER          (128u * 1024u)
+#define NVME_PRP_LIST_ENTRIES  64u     /* >= NVME_MAX_XFER / page + 1 */
+#define NVME_REQ_CHUNKS        8u      /* chunks submitted per doorbell */
+#define NVME_SGL_THRESHOLD     (32u * 1024u)
+#define NVME_IO_TIMEOUT_MS     5000u
+#define NVME_ABORT_TIMEOUT_MS  1000u
+#define NVME_WAIT_SLICE_MS     20u
+
+_Static_assert(NVME_IO_SLOTS <= 64u, "slot_free is a 64-bit map");
+_Static_assert(NVME_IO_SLOTS < NVME_IO_QSIZE, "in-flight commands must not fill the SQ");
+_Static_assert(NVME_PRP_LIST_ENTRIES * 8u * NVME_IO_SLOTS <= 8u * NVME_PAGE_SIZE,
+               "PRP lists are carved from eight pages");
+
+struct nvme_req;
+
+typedef struct nvme_slot {
+    struct nvme_req* req;   /* NULL once the owner gave up on it (timeout) */
+    void* bounce;           /* on-demand bounce for chunks above one page */
+    uint32_t bounce_pages;
+    uint16_t status;
+    uint8_t busy;
+    uint8_t issued;         /* written to the SQ; a reset fails it */
+    uint8_t done;
+} nvme_slot_t;
+
+typedef struct nvme_queue_stats {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t sq_doorbells;
+    uint64_t cq_doorbells;
+    uint64_t interrupts;
+    uint64_t aborts;
+    uint64_t resets;
+} nvme_queue_stats_t;
+
+typedef struct nvme_queue {
+    uint16_t qid;
+    uint16_t depth;
+    uint16_t nslots;
+    uint16_t sq_tail;
+    uint16_t sq_tail_rung;  /* last tail written to the doorbell */
+    uint16_t cq_head;
+    uint8_t cq_phase;
+    uint8_t frozen;         /* controller reset in progress: no submissions */
+    int vector;             /* MSI-X vector, negative when polled */
+    volatile nvme_sqe_t* sq;
+    volatile nvme_cqe_t* cq;
+    volatile uint32_t* sq_db;
+    volatile uint32_t* cq_db;
+    spinlock_t lock;
+    waitq_t slot_wq;
+    uint64_t slot_free;
+    nvme_slot_t slots[NVME_IO_SLOTS];
+    uint64_t* prp_lists;    /* NVME_PRP_LIST_ENTRIES per slot */
+    uint8_t* small_bounce;  /* one page per slot */
+    nvme_queue_stats_t stats;
+} nvme_queue_t;
+
+typedef struct nvme_req {
+    waitq_t wq;
+    volatile uint32_t pending;
+    uint16_t status;        /* first non-zero NVMe status of the request */
+} nvme_req_t;
+
+typedef struct nvme_chunk {
+    uint16_t slot;
+    uint8_t* user;          /* bounce copy-out target for reads, else NULL */
+    uint32_t bytes;
+} nvme_chunk_t;
+
+typedef struct {
+    int used;
+    int present;
+    fabric_device_t* dev;
+    char ctrl_name[8];
+    char disk_name[12];
+    volatile uint8_t* regs;
+    uint32_t db_stride;
+    uint32_t ready_timeout_ms;
+    uint32_t max_xfer;
+    uint32_t lba_shift;
+    uint32_t nsid;
+    uint64_t nsze;
+    bool sgl;
+    bool vwc;
+    bool msix_on;
+    pci_msix_t msix;
+    uint16_t admin_cid;
+    uint32_t recovering;    /* one timeout recovery at a time */
+    nvme_queue_t admin;
+    nvme_queue_t ioq[NVME_IOQ_MAX];
+    uint32_t nioq;
+    fabric_blockdev_t blockdev;
+    fabric_blockdev_ops_t blockops;
+} nvme_ctrl_t;
+
+static nvme_ctrl_t g_ctrls[NVME_CTRL_MAX];
+
+static inline uint32_t nvme_rd32(const nvme_ctrl_t* c, uint32_t off)
+{
+    return *(volatile const uint32_t*)(c->regs + off);
+}
+
+static inline void nvme_wr32(nvme_ctrl_t* c, uint32_t off, uint32_t value)
+{
+    *(volatile uint32_t*)(c->regs + off) = value;
+}
+
+static inline uint64_t nvme_rd64(const nvme_ctrl_t* c, uint32_t off)
+{
+    uint64_t lo = nvme_rd32(c, off);
+    uint64_t hi = nvme_rd32(c, off + 4u);
+    return lo | (hi << 32);
+}
+
+static inline void nvme_wr64(nvme_ctrl_t* c, uint32_t off, uint64_t value)
+{
+    nvme_wr32(c, off, (uint32_t)value);
+    nvme_wr32(c, off + 4u, (uint32_t)(value >> 32));
+}
+
+static void nvme_udelay(uint32_t us)
+{
+    /* A write to the POST port takes about a microsecond on PC hardware. */
+    for (uint32_t i = 0; i < us; i++) {
+        __asm__ volatile ("outb %%al, $0x80" : : "a"(0));
+    }
+}
+
+static inline uint16_t nvme_id16(const uint8_t* id, uint32_t off)
+{
+    return (uint16_t)(id[off] | ((uint16_t)id[off + 1u] << 8));
+}
+
+static inline uint32_t nvme_id32(const uint8_t* id, uint32_t off)
+{
+    return (uint32_t)nvme_id16(id, off) | ((uint32_t)nvme_id16(id, off + 2u) << 16);
+}
+
+static inline uint64_t nvme_id64(const uint8_t* id, uint32_t off)
+{
+    return (uint64_t)nvme_id32(id, off) | ((uint64_t)nvme_id32(id, off + 4u) << 32);
+}
+
+static inline uint64_t nvme_phys(const void* virt)
+{
+    return (uint64_t)ARCH_VIRT_TO_PHYS(virt);
+}
+
+/* Physmap addresses translate linearly; anything else needs a bounce. */
+static inline bool nvme_is_physmap(const void* p)
+{
+    uintptr_t v = (uintptr_t)p;
+    return v >= ARCH_KERNEL_VIRT_BASE && v < PCI_MMIO_VIRT_BASE;
+}
+
+static int nvme_wait_ready(nvme_ctrl_t* c, bool ready)
+{
+    for (uint32_t ms = 0; ms < c->ready_timeout_ms; ms++) {
+        uint32_t csts = nvme_rd32(c, NVME_REG_CSTS);
+        if (csts == 0xFFFFFFFFu || (csts & NVME_CSTS_CFS)) {
+            return RDNX_E_GENERIC;
+        }
+        if (((csts & NVME_CSTS_RDY) != 0) == ready) {
+            return RDNX_OK;
+        }
+        nvme_udelay(1000);
+    }
+    return RDNX_E_TIMEOUT;
+}
+
+static int nvme_queue_alloc(nvme_ctrl_t* c, nvme_queue_t* q, uint16_t qid, uint16_t depth)
+{
+    uint32_t sq_pages = (uint32_t)((depth * sizeof(nvme_sqe_t) + NVME_PAGE_SIZE - 1u) / NVME_PAGE_SIZE);
+    uint32_t cq_pages = (uint32_t)((depth * sizeof(nvme_cqe_t) + NVME_PAGE_SIZE - 1u) / NVME_PAGE_SIZE);
+
+    memset(q, 0, sizeof(*q));
+    q->qid = qid;
+    q->depth = depth;
+    q->cq_phase = 1;
+    q->vector = -1;
+    q->sq = (volatile nvme_sqe_t*)vmm_alloc_pages(sq_pages, PAGE_FLAG_WRITABLE);
+    q->cq = (volatile nvme_cqe_t*)vmm_alloc_pages(cq_pages, PAGE_FLAG_WRITABLE);
+    if (!q->sq || !q->cq) {
+        return RDNX_E_NOMEM;
+    }
+    uint32_t stride = 4u << c->db_stride;
+    q->sq_db = (volatile uint32_t*)(c->regs + NVME_REG_DBS + (2u * qid) * stride);
+    q->cq_db = (volatile uint32_t*)(c->regs + NVME_REG_DBS + (2u * qid + 1u) * stride);
+    spinlock_init(&q->lock);
+    waitq_init(&q->slot_wq, "nvme-slot");
+    if (qid == 0) {
+        return RDNX_OK;
+    }
+
+    q->nslots = (uint16_t)((depth - 1u < NVME_IO_SLOTS) ? depth - 1u : NVME_IO_SLOTS);
+    q->slot_free = (q->nslots == 64u) ? ~0ULL : ((1ULL << q->nslots) - 1u);
+    q->prp_lists = (uint64_t*)vmm_alloc_pages(8, PAGE_FLAG_WRITABLE);
+    q->small_bounce = (uint8_t*)vmm_alloc_pages(q->nslots, PAGE_FLAG_WRITABLE);
+    if (!q->prp_lists || !q->small_bounce) {
+        return RDNX_E_NOMEM;
+    }
+    return RDNX_OK;
+}
+
+/* Admin commands are issued one at a time during attach and polled. */
+static int nvme_admin_cmd(nvme_ctrl_t* c, nvme_sqe_t* cmd, uint32_t* out_result)
+{
+    nvme_queue_t* q = &c->admin;
+    irql_t irql = spinlock_lock_irqsave(&q->lock);
+    cmd->cid = ++c->admin_cid;
+    q->sq[q->sq_tail] = *cmd;
+    q->sq_tail = (uint16_t)((q->sq_tail + 1u) % q->depth);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    *q->sq_db = q->sq_tail;
+
+    int rc = RDNX_E_TIMEOUT;
+    for (uint32_t us = 0; us < NVME_IO_TIMEOUT_MS * 1000u; us++) {
+        volatile nvme_cqe_t* cqe = &q->cq[q->cq_head];
+        uint16_t st = cqe->status;
+        if ((st & NVME_CQE_PHASE) != q->cq_phase) {
+            nvme_udelay(1);
+            continue;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint16_t cid = cqe->cid;
+        uint32_t result = cqe->result;
+        if (++q->cq_head == q->depth) {
+            q->cq_head = 0;
+            q->cq_phase ^= 1u;
+        }
+        *q->cq_db = q->cq_head;
+        if (cid != cmd->cid) {
+            continue;
+        }
+        if (out_result) {
+            *out_result = result;
+        }
+        rc = NVME_CQE_STATUS(st) ? RDNX_E_GENERIC : RDNX_OK;
+        if (rc != RDNX_OK) {
+            fabric_log("[NVME] %s: admin opcode %x status %x\n",
+                       c->ctrl_name, cmd->opcode, NVME_CQE_STATUS(st));
+        }
+        break;
+    }
+    spinlock_unlock_irqrestore(&q->lock, irql);
+    return rc;
+}
+
+static int nvme_identify(nvme_ctrl_t* c, uint32_t nsid, uint32_t cns, void* page)
+{
+    nvme_sqe_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode = NVME_ADM_IDENTIFY;
+    cmd.nsid = nsid;
+    cmd.dptr[0] = nvme_phys(page);
+    cmd.cdw10 = cns;
+    return nvme_admin_cmd(c, &cmd, NULL);
+}
+
+/* ============================================================================
+ * I/O path
+ * ============================================================================ */
+
+/* Caller holds q->lock. Reaps every posted completion, one CQ doorbell write. */
+static uint32_t nvme_reap_locked(nvme_queue_t* q)
+{
+    uint32_t n = 0;
+    for (;;) {
+        volatile nvme_cqe_t* cqe = &q->cq[q->cq_head];
+        uint16_t st = cqe->status;
+        if ((st & NVME_CQE_PHASE) != q->cq_phase) {
+            break;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint16_t cid = cqe->cid;
+        if (cid < q->nslots && q->slots[cid].busy && !q->slots[cid].done) {
+            nvme_slot_t* s = &q->slots[cid];
+            s->status = NVME_CQE_STATUS(st);
+            s->done = 1;
+            nvme_req_t* req = s->req;
+            if (req) {
+                if (s->status && !req->status) {
+                    req->status = s->status;
+                }
+                if (req->pending > 0 && --req->pending == 0) {
+                    (void)waitq_wake_one(&req->wq);
+                }
+            } else {
+                /* Owner timed out and left: recycle the slot, leak its bounce. */
+                s->busy = 0;
+                q->slot_free |= 1ULL << cid;
+                (void)waitq_wake_all(&q->slot_wq);
+            }
+        }
+        if (++q->cq_head == q->depth) {
+            q->cq_head = 0;
+            q->cq_phase ^= 1u;
+        }
+        n++;
+    }
+    if (n) {
+        *q->cq_db = q->cq_head;
+        q->stats.cq_doorbells++;
+        q->stats.completed += n;
+    }
+    return n;
+}
+
+static void nvme_irq(int vector, void* arg)
+{
+    (void)vector;
+    nvme_queue_t* q = (nvme_queue_t*)arg;
+    irql_t irql = spinlock_lock_irqsave(&q->lock);
+    q->stats.interrupts++;
+    (void)nvme_reap_locked(q);
+    spinlock_unlock_irqrestore(&q->lock, irql);
+}
+
+static bool nvme_can_sleep(const nvme_queue_t* q)
+{
+    return q->vector >= 0 && thread_get_current() != NULL && preemptible();
+}
+
+/*
+ * Wait until cond(q, arg) holds. Sleeps in short slices when the queue has
+ * an interrupt (a wakeup racing the enqueue costs at most one slice),
+ * otherwise reaps the queue by polling.
+ */
+static int nvme_wait(nvme_queue_t* q, waitq_t* wq, bool (*cond)(nvme_queue_t*, void*), void* arg,
+                     uint32_t timeout_ms)
+{
+    if (nvme_can_sleep(q)) {
+        uint64_t deadline = scheduler_get_ticks() + timeout_ms / SCHEDULER_TIME_SLICE_MS;
+        for (;;) {
+            irql_t irql = spinlock_lock_irqsave(&q->lock);
+            if (cond(q, arg)) {
+                spinlock_unlock_irqrestore(&q->lock, irql);
+                return RDNX_OK;
+            }
+            (void)waitq_enqueue(wq, thread_get_current());
+            spinlock_unlock_irqrestore(&q->lock, irql);
+            (void)waitq_wait(wq, NVME_WAIT_SLICE_MS);
+            if (scheduler_get_ticks() > deadline) {
+                break;
+            }
+        }
+    } else {
+        for (uint32_t us = 0; us < timeout_ms * 1000u; us++) {
+            irql_t irql = spinlock_lock_irqsave(&q->lock);
+            (void)nvme_reap_locked(q);
+            bool ok = cond(q, arg);
+            spinlock_unlock_irqrestore(&q->lock, irql);
+            if (ok) {
+                return RDNX_OK;
+            }
+            nvme_udelay(1);
+        }
+    }
+    irql_t irql = spinlock_lock_irqsave(&q->lock);
+    bool ok = cond(q, arg);
+    spinlock_unlock_irqrestore(&q->lock, irql);
+    return ok ? RDNX_OK : RDNX_E_TIMEOUT;
+}
+
+static bool nvme_slot_available(nvme_queue_t* q, void* arg)
+{
+    (void)arg;
+    return !q->frozen && q->slot_free != 0;
+}
+
+static bool nvme_thawed(nvme_queue_t* q, void* arg)
+{
+    (void)arg;
+    return !q->frozen;
+}
+
+static bool nvme_req_done(nvme_queue_t* q, void* arg)
+{
+    (void)q;
+    return ((nvme_req_t*)arg)->pending == 0;
+}
+
+/* Take up to want free slots for req; caller holds q->lock. */
+static uint32_t nvme_slots_take_locked(nvme_queue_t* q, nvme_req_t* req, nvme_chunk_t* chunks, uint32_t want)
+{
+    uint32_t n = 0;
+    while (n < want && q->slot_free) {
+        uint16_t idx = (uint16_t)__builtin_ctzll(q->slot_free);
+        q->slot_free &= ~(1ULL << idx);
+        nvme_slot_t* s = &q->slots[idx];
+        s->req = req;
+        s->bounce = NULL;
+        s->bounce_pages = 0;
+        s->status = 0;
+        s->busy = 1;
+        s->issued = 0;
+        s->done = 0;
+        chunks[n].slot = idx;
+        chunks[n].user = NULL;
+        chunks[n].bytes = 0;
+        n++;
+    }
+    return n;
+}
+
+/* Point cmd at a physically contiguous region: one SGL data block or PRPs. */
+static void nvme_set_dptr(const nvme_ctrl_t* c, nvme_queue_t* q, uint16_t slot,
+                          nvme_sqe_t* cmd, uint64_t phys, uint32_t bytes)
+{
+    if (c->sgl && bytes >= NVME_SGL_THRESHOLD) {
+        nvme_sgl_desc_t* d = (nvme_sgl_desc_t*)&cmd->dptr[0];
+        cmd->flags |= NVME_SQE_PSDT_SGL;
+        d->addr = phys;
+        d->length = bytes;
+        d->type = NVME_SGL_DATA_BLOCK;
+        return;
+    }
+    uint32_t first = NVME_PAGE_SIZE - (uint32_t)(phys & (NVME_PAGE_SIZE - 1u));
+    cmd->dptr[0] = phys;
+    if (bytes <= first) {
+        return;
+    }
+    uint64_t next = (phys + first) & ~(uint64_t)(NVME_PAGE_SIZE - 1u);
+    if (bytes - first <= NVME_PAGE_SIZE) {
+        cmd->dptr[1] = next;
+        return;
+    }
+    uint64_t* list = q->prp_lists + (uint32_t)slot * NVME_PRP_LIST_ENTRIES;
+    uint32_t n = 0;
+    for (uint32_t off = first; off < bytes; off += NVME_PAGE_SIZE) {
+        list[n++] = next;
+        next += NVME_PAGE_SIZE;
+    }
+    cmd->dptr[1] = nvme_phys(list);
+}
+
+/* Give back the request's slots after its completions (or its timeout). */
+static void nvme_slots_release(nvme_queue_t* q, const nvme_chunk_t* chunks, uint32_t n, bool timed_out)
+{
+    irql_t irql = spinlock_lock_irqsave(&q->lock);
+    for (uint32_t i = 0; i < n; i++) {
+        nvme_slot_t* s = &q->slots[chunks[i].slot];
+        if (timed_out && !s->done) {
+            /* Still owned by the device: the reaper recycles it. */
+            s->req = NULL;
+            continue;
+        }
+        if (s->bounce) {
+            vmm_free_pages(s->bounce, s->bounce_pages);
+        }
+        s->bounce = NULL;
+        s->req = NULL;
+        s->busy = 0;
+        q->slot_free |= 1ULL << chunks[i].slot;
+    }
+    (void)waitq_wake_all(&q->slot_wq);
+    spinlock_unlock_irqrestore(&q->lock, irql);
+}
+
+static int nvme_ctrl_reset(nvme_ctrl_t* c);
+
+/*
+ * Timeout recovery for req: Abort each of its commands still owned by the
+ * device and give the controller NVME_ABORT_TIMEOUT_MS to complete them,
+ * then fall back to a controller reset. Only one thread recovers at a time;
+ * the others keep waiting for that reset to fail their requests. Returns
+ * RDNX_OK once the device owns none of req's chunks.
+ */
+static int nvme_recover(nvme_ctrl_t* c, nvme_queue_t* q, nvme_req_t* req,
+                        const nvme_chunk_t* chunks, uint32_t n)
+{
+    if (__atomic_exchange_n(&c->recovering, 1u, __ATOMIC_ACQ_REL)) {
+        return nvme_wait(q, &req->wq, nvme_req_done, req, NVME_IO_TIMEOUT_MS);
+    }
+
+    bool aborted = true;
+    for (uint32_t i = 0; i < n; i++) {
+        irql_t irql = spinlock_lock_irqsave(&q->lock);
+        bool owned = !q->slots[chunks[i].slot].done;
+        if (owned) {
+            q->stats.aborts++;
+        }
+        spinlock_unlock_irqrestore(&q->lock, irql);
+        if (!owned) {
+            continue;
+        }
+        nvme_sqe_t cmd;
+        uint32_t result = 1u;
+        memset(&cmd, 0, sizeof(cmd));
+        cmd.opcode = NVME_ADM_ABORT;
+        cmd.cdw10 = ((uint32_t)chunks[i].slot << 16) | q->qid;
+        /* Result bit 0 set: the controller did not abort the command. */
+        if (nvme_admin_cmd(c, &cmd, &result) != RDNX_OK || (result & 1u)) {
+            aborted = false;
+        }
+    }
+    int rc = aborted ? nvme_wait(q, &req->wq, nvme_req_done, req, NVME_ABORT_TIMEOUT_MS)
+                     : RDNX_E_TIMEOUT;
+    if (rc != RDNX_OK) {
+        fabric_log("[NVME] %s: abort failed on queue %u, resetting controller\n",
+                   c->ctrl_name, q->qid);
+        if (nvme_ctrl_reset(c) != RDNX_OK) {
+            fabric_log("[NVME] %s: controller reset failed, disk offline\n", c->ctrl_name);
+        }
+        irql_t irql = spinlock_lock_irqsave(&q->lock);
+        rc = nvme_req_done(q, req) ? RDNX_OK : RDNX_E_TIMEOUT;
+        spinlock_unlock_irqrestore(&q->lock, irql);
+    }
+    __atomic_store_n(&c->recovering, 0u, __ATOMIC_RELEASE);
+    return rc;
+}
+
+static nvme_queue_t* nvme_pick_queue(nvme_ctrl_t* c)
+{
+    return &c->ioq[cpu_get_id() % c->nioq];
+}
+
+/*
+ * Read/write/flush count blocks at lba. buf may be a user pointer, in which
+ * case data goes through bounce pages.
+ */
+static int nvme_rw(nvme_ctrl_t* c, uint8_t opcode, uint64_t lba, uint32_t count, uint8_t* buf)
+{
+    nvme_queue_t* q = nvme_pick_queue(c);
+    bool direct = (buf == NULL) || nvme_is_physmap(buf);
+    uint32_t max_blocks = c->max_xfer >> c->lba_shift;
+
+    do {
+        nvme_req_t req;
+        nvme_chunk_t chunks[NVME_REQ_CHUNKS];
+        waitq_init(&req.wq, "nvme-req");
+        req.pending = 0;
+        req.status = 0;
+
+        uint32_t want = (opcode == NVME_CMD_FLUSH) ? 1u : (count + max_blocks - 1u) / max_blocks;
+        if (want > NVME_REQ_CHUNKS) {
+            want = NVME_REQ_CHUNKS;
+        }
+        uint32_t n = 0;
+        for (;;) {
+            irql_t irql = spinlock_lock_irqsave(&q->lock);
+            n = q->frozen ? 0u : nvme_slots_take_locked(q, &req, chunks, want);
+            spinlock_unlock_irqrestore(&q->lock, irql);
+            if (n > 0) {
+                break;
+            }
+            if (nvme_wait(q, &q->slot_wq, nvme_slot_available, NULL, NVME_IO_TIMEOUT_MS) != RDNX_OK) {
+                return RDNX_E_TIMEOUT;
+            }
+        }
+
+        /* Build the commands outside the lock. */
+        nvme_sqe_t cmds[NVME_REQ_CHUNKS];
+        uint32_t built = 0;
+        int rc = RDNX_OK;
+        for (; built < n; built++) {
+            nvme_chunk_t* ch = &chunks[built];
+            nvme_slot_t* s = &q->slots[ch->slot];
+            nvme_sqe_t* cmd = &cmds[built];
+            memset(cmd, 0, sizeof(*cmd));
+            cmd->opcode = opcode;
+            cmd->cid = ch->slot;
+            cmd->nsid = c->nsid;
+            if (opcode == NVME_CMD_FLUSH) {
+                continue;
+            }
+            uint32_t blocks = (count > max_blocks) ? max_blocks : count;
+            uint32_t bytes = blocks << c->lba_shift;
+            uint8_t* dma = buf;
+            if (!direct) {
+                if (bytes <= NVME_PAGE_SIZE) {
+                    dma = q->small_bounce + (uint32_t)ch->slot * NVME_PAGE_SIZE;
+                } else {
+                    s->bounce_pages = (bytes + NVME_PAGE_SIZE - 1u) / NVME_PAGE_SIZE;
+                    s->bounce = vmm_alloc_pages(s->bounce_pages, PAGE_FLAG_WRITABLE);
+                    if (!s->bounce) {
+                        s->bounce_pages = 0;
+                        rc = RDNX_E_NOMEM;
+                        break;
+                    }
+                    dma = (uint8_t*)s->bounce;
+                }
+                if (opcode == NVME_CMD_WRITE) {
+                    memcpy(dma, buf, bytes);
+                } else {
+                    ch->user = buf;
+                }
+            }
+            ch->bytes = bytes;
+            nvme_set_dptr(c, q, ch->slot, cmd, nvme_phys(dma), bytes);
+            cmd->cdw10 = (uint32_t)lba;
+            cmd->cdw11 = (uint32_t)(lba >> 32);
+            cmd->cdw12 = blocks - 1u;    /* 0's based */
+            lba += blocks;
+            count -= blocks;
+            buf += bytes;
+        }
+        if (built == 0) {
+            nvme_slots_release(q, chunks, n, false);
+            return rc;
+        }
+        if (built < n) {
+            /* Out of bounce memory: send what was built, give the rest back. */
+            nvme_slots_release(q, chunks + built, n - built, false);
+            n = built;
+        }
+
+        /* Queue every chunk, then one doorbell write for the lot. */
+        irql_t irql = spinlock_lock_irqsave(&q->lock);
+        while (q->frozen) {
+            spinlock_unlock_irqrestore(&q->lock, irql);
+            if (nvme_wait(q, &q->slot_wq, nvme_thawed, NULL, NVME_IO_TIMEOUT_MS) != RDNX_OK) {
+                nvme_slots_release(q, chunks, n, false);
+                return RDNX_E_TIMEOUT;
+            }
+            irql = spinlock_lock_irqsave(&q->lock);
+        }
+        if (!c->present) {
+            /* The reset that thawed the queue could not revive the controller. */
+            spinlock_unlock_irqrestore(&q->lock, irql);
+            nvme_slots_release(q, chunks, n, false);
+            return RDNX_E_NOTFOUND;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            q->sq[q->sq_tail] = cmds[i];
+            q->sq_tail = (uint16_t)((q->sq_tail + 1u) % q->depth);
+            q->slots[chunks[i].slot].issued = 1;
+        }
+        req.pending += n;
+        q->stats.submitted += n;
+        if (q->sq_tail != q->sq_tail_rung) {
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            *q->sq_db = q->sq_tail;
+            q->sq_tail_rung = q->sq_tail;
+            q->stats.sq_doorbells++;
+        }
+        spinlock_unlock_irqrestore(&q->lock, irql);
+
+        if (nvme_wait(q, &req.wq, nvme_req_done, &req, NVME_IO_TIMEOUT_MS) != RDNX_OK) {
+            fabric_log("[NVME] %s: I/O timeout on queue %u, aborting\n", c->ctrl_name, q->qid);
+            /* Recovered chunks are done (aborted or failed); otherwise the device keeps them. */
+            bool recovered = nvme_recover(c, q, &req, chunks, n) == RDNX_OK;
+            nvme_slots_release(q, chunks, n, !recovered);
+            return RDNX_E_TIMEOUT;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            const nvme_chunk_t* ch = &chunks[i];
+            const nvme_slot_t* s = &q->slots[ch->slot];
+            if (ch->user && !req.status) {
+                const uint8_t* src = s->bounce ? (const uint8_t*)s->bounce
+                                               : q->small_bounce + (uint32_t)ch->slot * NVME_PAGE_SIZE;
+                memcpy(ch->user, src, ch->bytes);
+            }
+        }
+        nvme_slots_release(q, chunks, n, false);
+        if (req.status) {
+            fabric_log("[NVME] %s: opcode %x lba %llu status %x\n",
+                       c->ctrl_name, opcode, (unsigned long long)lba, req.status);
+            return RDNX_E_GENERIC;
+        }
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+    } while (opcode != NVME_CMD_FLUSH && count > 0);
+    return RDNX_OK;
+}
+
+static nvme_ctrl_t* nvme_ctrl_of(fabric_blockdev_t* bdev)
+{
+    nvme_ctrl_t* c = bdev ? (nvme_ctrl_t*)bdev->context : NULL;
+    return (c && c->present) ? c : NULL;
+}
+
+static int nvme_block_read(fabric_blockdev_t* bdev, uint64_t lba, uint32_t count, void* out)
+{
+    if (!bdev || !out || count == 0) {
+        return RDNX_E_INVALID;
+    }
+    nvme_ctrl_t* c = nvme_ctrl_of(bdev);
+    if (!c) {
+        return RDNX_E_NOTFOUND;
+    }
+    return nvme_rw(c, NVME_CMD_READ, lba, count, (uint8_t*)out);
+}
+
+static int nvme_block_write(fabric_blockdev_t* bdev, uint64_t lba, uint32_t count, const void* in)
+{
+    if (!bdev || !in || count == 0) {
+        return RDNX_E_INVALID;
+    }
+    nvme_ctrl_t* c = nvme_ctrl_of(bdev);
+    if (!c) {
+        return RDNX_E_NOTFOUND;
+    }
+    return nvme_rw(c, NVME_CMD_WRITE, lba, count, (uint8_t*)(uintptr_t)in);
+}
+
+static int nvme_block_flush(fabric_blockdev_t* bdev)
+{
+    nvme_ctrl_t* c = nvme_ctrl_of(bdev);
+    if (!c) {
+        return bdev ? RDNX_E_NOTFOUND : RDNX_E_INVALID;
+    }
+    return nvme_rw(c, NVME_CMD_FLUSH, 0, 0, NULL);
+}
+
+/* ============================================================================
+ * Controller bring-up
+ * ============================================================================ */
+
+/* Give q its own MSI-X entry and vector; the queue stays polled on failure. */
+static void nvme_queue_irq_setup(nvme_ctrl_t* c, nvme_queue_t* q)
+{
+    if (c->msix_on && q->qid < c->msix.entries) {
+        int vector = msi_vector_alloc();
+        uint64_t addr = 0;
+        uint32_t data = 0;
+        if (vector >= 0 &&
+            msi_compose(vector, (uint32_t)(q->qid - 1u), &addr, &data) == RDNX_OK &&
+            fabric_request_irq(vector, nvme_irq, q) == RDNX_OK) {
+            (void)pci_msix_set_entry(&c->msix, q->qid, addr, data);
+            q->vector = vector;
+        } else if (vector >= 0) {
+            msi_vector_free(vector);
+        }
+    }
+}
+
+static int nvme_create_io_queue(nvme_ctrl_t* c, nvme_queue_t* q)
+{
+    nvme_sqe_t cmd;
+    uint32_t cq_flags = NVME_QUEUE_PHYS_CONTIG;
+    if (q->vector >= 0) {
+        cq_flags |= NVME_CQ_IRQ_ENABLED;
+    }
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode = NVME_ADM_CREATE_CQ;
+    cmd.dptr[0] = nvme_phys((const void*)q->cq);
+    cmd.cdw10 = ((uint32_t)(q->depth - 1u) << 16) | q->qid;
+    cmd.cdw11 = ((uint32_t)q->qid << 16) | cq_flags;    /* interrupt vector = MSI-X entry qid */
+    int rc = nvme_admin_cmd(c, &cmd, NULL);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode = NVME_ADM_CREATE_SQ;
+    cmd.dptr[0] = nvme_phys((const void*)q->sq);
+    cmd.cdw10 = ((uint32_t)(q->depth - 1u) << 16) | q->qid;
+    cmd.cdw11 = ((uint32_t)q->qid << 16) | NVME_QUEUE_PHYS_CONTIG;
+    return nvme_admin_cmd(c, &cmd, NULL);
+}
+
+/* Point the controller at the admin queue and set CC.EN. */
+static int nvme_ctrl_enable(nvme_ctrl_t* c)
+{
+    nvme_wr32(c, NVME_REG_AQA, ((NVME_ADMIN_QSIZE - 1u) << 16) | (NVME_ADMIN_QSIZE - 1u));
+    nvme_wr64(c, NVME_REG_ASQ, nvme_phys((const void*)c->admin.sq));
+    nvme_wr64(c, NVME_REG_ACQ, nvme_phys((const void*)c->admin.cq));
+    nvme_wr32(c, NVME_REG_CC, NVME_CC_EN | NVME_CC_CSS_NVM | NVME_CC_MPS(12) | NVME_CC_AMS_RR |
+                              NVME_CC_IOSQES(6) | NVME_CC_IOCQES(4));
+    return nvme_wait_ready(c, true);
+}
+
+/* Ask for want I/O queue pairs; *out_nq is what the controller grants, capped at want. */
+static int nvme_set_num_queues(nvme_ctrl_t* c, uint32_t want, uint32_t* out_nq)
+{
+    nvme_sqe_t cmd;
+    uint32_t granted = 0;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode = NVME_ADM_SET_FEATURES;
+    cmd.cdw10 = NVME_FEAT_NUM_QUEUES;
+    cmd.cdw11 = ((want - 1u) << 16) | (want - 1u);
+    int rc = nvme_admin_cmd(c, &cmd, &granted);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    uint32_t nsq = (granted & 0xFFFFu) + 1u;
+    uint32_t ncq = (granted >> 16) + 1u;
+    uint32_t nq = want;
+    if (nsq < nq) {
+        nq = nsq;
+    }
+    if (ncq < nq) {
+        nq = ncq;
+    }
+    *out_nq = nq;
+    return RDNX_OK;
+}
+
+/* Caller holds q->lock with the controller disabled: fail what was issued, rewind the rings. */
+static void nvme_queue_reset_locked(nvme_queue_t* q)
+{
+    for (uint32_t i = 0; i < q->nslots; i++) {
+        nvme_slot_t* s = &q->slots[i];
+        if (!s->busy || !s->issued || s->done) {
+            continue;
+        }
+        s->status = NVME_SC_ABORT_SQ_DELETED;
+        s->done = 1;
+        nvme_req_t* req = s->req;
+        if (req) {
+            if (!req->status) {
+                req->status = s->status;
+            }
+            if (req->pending > 0 && --req->pending == 0) {
+                (void)waitq_wake_one(&req->wq);
+            }
+        } else {
+            /* Orphan of an earlier timeout: the device no longer owns its bounce. */
+            if (s->bounce) {
+                vmm_free_pages(s->bounce, s->bounce_pages);
+            }
+            s->bounce = NULL;
+            s->busy = 0;
+            q->slot_free |= 1ULL << i;
+        }
+    }
+    memset((void*)q->cq, 0, (size_t)q->depth * sizeof(nvme_cqe_t));
+    q->sq_tail = 0;
+    q->sq_tail_rung = 0;
+    q->cq_head = 0;
+    q->cq_phase = 1;
+}
+
+/*
+ * Controller-level reset: freeze the I/O queues, clear CC.EN, fail every
+ * issued command, then enable again and re-create the I/O queues on the
+ * same rings and vectors. On failure the disk is marked not present.
+ */
+static int nvme_ctrl_reset(nvme_ctrl_t* c)
+{
+    for (uint32_t i = 0; i < c->nioq; i++) {
+        nvme_queue_t* q = &c->ioq[i];
+        irql_t irql = spinlock_lock_irqsave(&q->lock);
+        q->frozen = 1;
+        q->stats.resets++;
+        spinlock_unlock_irqrestore(&q->lock, irql);
+    }
+
+    nvme_wr32(c, NVME_REG_CC, nvme_rd32(c, NVME_REG_CC) & ~NVME_CC_EN);
+    int rc = nvme_wait_ready(c, false);
+
+    for (uint32_t i = 0; i < c->nioq; i++) {
+        nvme_queue_t* q = &c->ioq[i];
+        irql_t irql = spinlock_lock_irqsave(&q->lock);
+        nvme_queue_reset_locked(q);
+        spinlock_unlock_irqrestore(&q->lock, irql);
+    }
+    irql_t irql = spinlock_lock_irqsave(&c->admin.lock);
+    nvme_queue_reset_locked(&c->admin);
+    spinlock_unlock_irqrestore(&c->admin.lock, irql);
+
+    if (rc == RDNX_OK) {
+        rc = nvme_ctrl_enable(c);
+    }
+    uint32_t nq = 0;
+    if (rc == RDNX_OK) {
+        rc = nvme_set_num_queues(c, c->nioq, &nq);
+    }
+    if (rc == RDNX_OK && nq < c->nioq) {
+        rc = RDNX_E_GENERIC;
+    }
+    for (uint32_t i = 0; rc == RDNX_OK && i < c->nioq; i++) {
+        rc = nvme_create_io_queue(c, &c->ioq[i]);
+    }
+    if (rc != RDNX_OK) {
+        c->present = 0;
+    }
+
+    for (uint32_t i = 0; i < c->nioq; i++) {
+        nvme_queue_t* q = &c->ioq[i];
+        irql = spinlock_lock_irqsave(&q->lock);
+        q->frozen = 0;
+        (void)waitq_wake_all(&q->slot_wq);
+        spinlock_unlock_irqrestore(&q->lock, irql);
+    }
+    fabric_log("[NVME] %s: controller reset %s\n", c->ctrl_name, (rc == RDNX_OK) ? "done" : "failed");
+    return rc;
+}
+
+static int nvme_ctrl_init(nvme_ctrl_t* c)
+{
+    uint64_t bar = pci_bar_address(c->dev, 0);
+    if (bar == 0) {
+        return RDNX_E_NOTFOUND;
+    }
+    c->regs = (volatile uint8_t*)pci_map_mmio(bar, 0x2000u);
+    if (!c->regs) {
+        return RDNX_E_GENERIC;
+    }
+    pci_enable_bus_master(c->dev);
+
+    uint64_t cap = nvme_rd64(c, NVME_REG_CAP);
+    if (NVME_CAP_MPSMIN(cap) != 0) {
+        return RDNX_E_UNSUPPORTED;    /* host pages are 4 KiB */
+    }
+    c->db_stride = NVME_CAP_DSTRD(cap);
+    c->ready_timeout_ms = (NVME_CAP_TO(cap) + 1u) * 500u;
+    uint32_t mqes = NVME_CAP_MQES(cap) + 1u;
+
+    nvme_wr32(c, NVME_REG_CC, nvme_rd32(c, NVME_REG_CC) & ~NVME_CC_EN);
+    int rc = nvme_wait_ready(c, false);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+
+    rc = nvme_queue_alloc(c, &c->admin, 0, NVME_ADMIN_QSIZE);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    rc = nvme_ctrl_enable(c);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+
+    uint8_t* id = (uint8_t*)vmm_alloc_pages(1, PAGE_FLAG_WRITABLE);
+    if (!id) {
+        return RDNX_E_NOMEM;
+    }
+    rc = nvme_identify(c, 0, NVME_IDENTIFY_CTRL, id);
+    if (rc == RDNX_OK) {
+        uint8_t mdts = id[NVME_ID_CTRL_MDTS];
+        c->max_xfer = NVME_MAX_XFER;
+        if (mdts != 0 && mdts < 6u && (NVME_PAGE_SIZE << mdts) < c->max_xfer) {
+            c->max_xfer = NVME_PAGE_SIZE << mdts;
+        }
+        c->vwc = (id[NVME_ID_CTRL_VWC] & 0x1u) != 0;
+        c->sgl = (nvme_id32(id, NVME_ID_CTRL_SGLS) & 0x3u) != 0;
+        c->nsid = (nvme_id32(id, NVME_ID_CTRL_NN) != 0) ? 1u : 0u;
+        char model[41];
+        memcpy(model, id + NVME_ID_CTRL_MN, 40);
+        model[40] = '\0';
+        for (int i = 39; i >= 0 && (model[i] == ' ' || model[i] == '\0'); i--) {
+            model[i] = '\0';
+        }
+        fabric_log("[NVME] %s: model \"%s\" mdts=%u vwc=%u sgl=%u\n",
+                   c->ctrl_name, model, mdts, c->vwc ? 1u : 0u, c->sgl ? 1u : 0u);
+    }
+    if (rc == RDNX_OK && c->nsid == 0) {
+        rc = RDNX_E_NOTFOUND;
+    }
+    if (rc == RDNX_OK) {
+        memset(id, 0, NVME_PAGE_SIZE);
+        rc = nvme_identify(c, c->nsid, NVME_IDENTIFY_NS, id);
+    }
+    if (rc == RDNX_OK) {
+        uint32_t fmt = id[NVME_ID_NS_FLBAS] & 0xFu;
+        c->nsze = nvme_id64(id, NVME_ID_NS_NSZE);
+        c->lba_shift = (nvme_id32(id, NVME_ID_NS_LBAF + fmt * 4u) >> 16) & 0xFFu;
+        if (c->nsze == 0 || c->lba_shift < 9u || c->lba_shift > 12u) {
+            rc = RDNX_E_UNSUPPORTED;
+        }
+    }
+    vmm_free_pages(id, 1);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+
+    /* One queue pair per CPU, as many as the controller grants. */
+    uint32_t want = cpu_get_count();
+    if (want == 0) {
+        want = 1;
+    }
+    if (want > NVME_IOQ_MAX) {
+        want = NVME_IOQ_MAX;
+    }
+    uint32_t nq = 0;
+    rc = nvme_set_num_queues(c, want, &nq);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+
+    c->msix_on = msi_is_available() && pci_msix_enable(c->dev, &c->msix) == RDNX_OK;
+    uint16_t depth = (uint16_t)((mqes < NVME_IO_QSIZE) ? mqes : NVME_IO_QSIZE);
+    for (uint32_t i = 0; i < nq; i++) {
+        nvme_queue_t* q = &c->ioq[i];
+        rc = nvme_queue_alloc(c, q, (uint16_t)(i + 1u), depth);
+        if (rc == RDNX_OK) {
+            nvme_queue_irq_setup(c, q);
+            rc = nvme_create_io_queue(c, q);
+        }
+        if (rc != RDNX_OK) {
+            break;
+        }
+        c->nioq++;
+    }
+    if (c->nioq == 0) {
+        return (rc != RDNX_OK) ? rc : RDNX_E_GENERIC;
+    }
+    return RDNX_OK;
+}
+
+/* ============================================================================
+ * Fabric driver glue
+ * ============================================================================ */
+
+static bool nvme_storage_probe(fabric_device_t* dev)
+{
+    if (!dev) {
+        return false;
+    }
+    return dev->class_code == PCI_CLASS_STORAGE &&
+           dev->subclass == PCI_SUBCLASS_NVM &&
+           dev->prog_if == PCI_PROGIF_NVME;
+}
+
+static int nvme_storage_attach(fabric_device_t* dev)
+{
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    for (uint32_t i = 0; i < NVME_CTRL_MAX; i++) {
+        nvme_ctrl_t* c = &g_ctrls[i];
+        if (c->used) {
+            continue;
+        }
+        memset(c, 0, sizeof(*c));
+        c->used = 1;
+        c->dev = dev;
+        memcpy(c->ctrl_name, (i == 0) ? "nvme0" : "nvme1", 6);
+        memcpy(c->disk_name, (i == 0) ? "nvme0n1" : "nvme1n1", 8);
+
+        int rc = nvme_ctrl_init(c);
+        if (rc != RDNX_OK) {
+            fabric_log("[NVME] %s: init failed rc=%d\n", c->ctrl_name, rc);
+            return RDNX_OK;
+        }
+        c->present = 1;
+        c->blockops.hdr = RDNX_ABI_INIT(fabric_blockdev_ops_t);
+        c->blockops.read_sectors = nvme_block_read;
+        c->blockops.write_sectors = nvme_block_write;
+        c->blockops.flush = nvme_block_flush;
+        c->blockdev.hdr = RDNX_ABI_INIT(fabric_blockdev_t);
+        c->blockdev.name = c->disk_name;
+        c->blockdev.sector_size = 1u << c->lba_shift;
+        c->blockdev.sector_count = c->nsze;
+        c->blockdev.flags = c->vwc ? FABRIC_BLOCKDEV_F_WCACHE : 0u;
+        c->blockdev.ops = &c->blockops;
+        c->blockdev.context = c;
+        c->blockdev.queue_depth = c->nioq * c->ioq[0].nslots;
+
+        fabric_log("[NVME] %s: blocks=%llu bs=%u (%llu MiB) ioq=%u depth=%u %s\n",
+                   c->disk_name,
+                   (unsigned long long)c->nsze,
+                   c->blockdev.sector_size,
+                   (unsigned long long)((c->nsze << c->lba_shift) / (1024ULL * 1024ULL)),
+                   c->nioq, c->ioq[0].nslots,
+                   (c->ioq[0].vector >= 0) ? "msi-x" : "polled");
+        fabric_log("[NVME] attached %s vendor=%x device=%x\n",
+                   c->ctrl_name, dev->vendor_id, dev->device_id);
+        return RDNX_OK;
+    }
+    return RDNX_E_BUSY;
+}
+
+static int nvme_storage_publish(fabric_device_t* dev)
+{
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    for (uint32_t i = 0; i < NVME_CTRL_MAX; i++) {
+        nvme_ctrl_t* c = &g_ctrls[i];
+        if (!c->used || c->dev != dev) {
+            continue;
+        }
+        if (fabric_publish_service_node(c->ctrl_name, "storage", dev) != RDNX_OK) {
+            return RDNX_E_GENERIC;
+        }
+        if (c->present) {
+            if (fabric_publish_service_node(c->disk_name, "storage", dev) != RDNX_OK) {
+                return RDNX_E_GENERIC;
+            }
+            (void)fabric_blockdev_register(&c->blockdev);
+        }
+        return RDNX_OK;
+    }
+    return RDNX_E_NOTFOUND;
+}
+
+static void nvme_storage_detach(fabric_device_t* dev)
+{
+    (void)dev;
+}
+
+static fabric_driver_t g_driver = {
+    .name = "nvme-storage",
+    .probe = nvme_storage_probe,
+    .attach = nvme_storage_attach,
+    .publish = nvme_storage_publish,
+    .detach = nvme_storage_detach,
+    .suspend = NULL,
+    .resume = NULL
+};
+
+void nvme_storage_init(void)
+{
+    int rc = fabric_driver_register(&g_driver);
+    if (rc == RDNX_OK) {
+        kputs("[NVME] driver registered\n");
+    } else {
+        kputs("[NVME] driver register failed\n");
+    }
+}
@@ -0,0 +1,132 @@
+/**
+ * @file nvme.h
+ * @brief NVMe controller registers, queue entries and command set (NVMe 1.4 subset)
+ */
+
+#ifndef _RODNIX_DRIVERS_STORAGE_NVME_H
+#define _RODNIX_DRIVERS_STORAGE_NVME_H
+
+#include <stdint.h>
+
+#define PCI_CLASS_STORAGE      0x01u
+#define PCI_SUBCLASS_NVM       0x08u
+#define PCI_PROGIF_NVME        0x02u
+
+/* Controller registers (BAR0). */
+enum {
+    NVME_REG_CAP   = 0x00,  /* 64-bit: capabilities */
+    NVME_REG_VS    = 0x08,
+    NVME_REG_INTMS = 0x0C,
+    NVME_REG_INTMC = 0x10,
+    NVME_REG_CC    = 0x14,
+    NVME_REG_CSTS  = 0x1C,
+    NVME_REG_AQA   = 0x24,
+    NVME_REG_ASQ   = 0x28,  /* 64-bit */
+    NVME_REG_ACQ   = 0x30,  /* 64-bit */
+    NVME_REG_DBS   = 0x1000 /* doorbells: SQ y tail at 2y, CQ y head at 2y+1 (x 4 << DSTRD) */
+};
+
+#define NVME_CAP_MQES(cap)   ((uint32_t)((cap) & 0xFFFFu))          /* max entries - 1 */
+#define NVME_CAP_TO(cap)     ((uint32_t)(((cap) >> 24) & 0xFFu))    /* 500 ms units */
+#define NVME_CAP_DSTRD(cap)  ((uint32_t)(((cap) >> 32) & 0xFu))
+#define NVME_CAP_MPSMIN(cap) ((uint32_t)(((cap) >> 48) & 0xFu))
+
+#define NVME_CC_EN           (1u << 0)
+#define NVME_CC_CSS_NVM      (0u << 4)
+#define NVME_CC_MPS(shift)   ((uint32_t)((shift) - 12u) << 7)
+#define NVME_CC_AMS_RR       (0u << 11)
+#define NVME_CC_SHN_NORMAL   (1u << 14)
+#define NVME_CC_IOSQES(s)    ((uint32_t)(s) << 16)
+#define NVME_CC_IOCQES(s)    ((uint32_t)(s) << 20)
+
+#define NVME_CSTS_RDY        (1u << 0)
+#define NVME_CSTS_CFS        (1u << 1)
+#define NVME_CSTS_SHST_MASK  (3u << 2)
+#define NVME_CSTS_SHST_DONE  (2u << 2)
+
+/* Submission queue entry (64 bytes). */
+typedef struct nvme_sqe {
+    uint8_t opcode;
+    uint8_t flags;      /* bits 7:6 PSDT: 0 PRP, 1 SGL (MPTR address) */
+    uint16_t cid;
+    uint32_t nsid;
+    uint64_t rsvd2;
+    uint64_t mptr;
+    uint64_t dptr[2];   /* PRP1/PRP2, or the first SGL descriptor */
+    uint32_t cdw10;
+    uint32_t cdw11;
+    uint32_t cdw12;
+    uint32_t cdw13;
+    uint32_t cdw14;
+    uint32_t cdw15;
+} __attribute__((packed)) nvme_sqe_t;
+
+/* Completion queue entry (16 bytes). */
+typedef struct nvme_cqe {
+    uint32_t result;
+    uint32_t rsvd;
+    uint16_t sq_head;
+    uint16_t sq_id;
+    uint16_t cid;
+    uint16_t status;    /* bit 0: phase tag, 15:1 status field */
+} __attribute__((packed)) nvme_cqe_t;
+
+/* SGL descriptor (16 bytes). */
+typedef struct nvme_sgl_desc {
+    uint64_t addr;
+    uint32_t length;
+    uint8_t rsvd[3];
+    uint8_t type;       /* descriptor type (7:4) and sub type (3:0) */
+} __attribute__((packed)) nvme_sgl_desc_t;
+
+_Static_assert(sizeof(nvme_sqe_t) == 64, "NVMe SQE is 64 bytes");
+_Static_assert(sizeof(nvme_cqe_t) == 16, "NVMe CQE is 16 bytes");
+_Static_assert(sizeof(nvme_sgl_desc_t) == 16, "NVMe SGL descriptor is 16 bytes");
+
+#define NVME_SQE_PSDT_SGL    (1u << 6)
+#define NVME_SGL_DATA_BLOCK  0x00u
+#define NVME_SGL_LAST_SEG    0x30u
+
+#define NVME_CQE_PHASE       0x1u
+#define NVME_CQE_STATUS(s)   ((uint16_t)((s) >> 1))
+#define NVME_SC_ABORT_SQ_DELETED 0x0008u  /* generic: command aborted due to SQ deletion */
+
+/* Admin opcodes. */
+enum {
+    NVME_ADM_DELETE_SQ   = 0x00,
+    NVME_ADM_CREATE_SQ   = 0x01,
+    NVME_ADM_DELETE_CQ   = 0x04,
+    NVME_ADM_CREATE_CQ   = 0x05,
+    NVME_ADM_IDENTIFY    = 0x06,
+    NVME_ADM_ABORT       = 0x08,
+    NVME_ADM_SET_FEATURES = 0x09
+};
+
+/* NVM command set opcodes. */
+enum {
+    NVME_CMD_FLUSH = 0x00,
+    NVME_CMD_WRITE = 0x01,
+    NVME_CMD_READ  = 0x02
+};
+
+#define NVME_IDENTIFY_NS     0x00u
+#define NVME_IDENTIFY_CTRL   0x01u
+#define NVME_FEAT_NUM_QUEUES 0x07u
+
+#define NVME_QUEUE_PHYS_CONTIG (1u << 0)
+#define NVME_CQ_IRQ_ENABLED    (1u << 1)
+
+/* Identify Controller byte offsets. */
+#define NVME_ID_CTRL_SN     4u     /* 20 bytes, ASCII */
+#define NVME_ID_CTRL_MN     24u    /* 40 bytes, ASCII */
+#define NVME_ID_CTRL_MDTS   77u    /* max transfer = 2^MDTS min pages, 0 = no limit */
+#define NVME_ID_CTRL_NN     516u   /* number of namespaces */
+#define NVME_ID_CTRL_VWC    525u   /* bit 0: volatile write cache present */
+#define NVME_ID_CTRL_SGLS   536u   /* bits 1:0 != 0: SGLs supported for NVM commands */
+
+/* Identify Namespace byte offsets. */
+#define NVME_ID_NS_NSZE     0u     /* 64-bit size in logical blocks */
+#define NVME_ID_NS_FLBAS    26u    /* bits 3:0: LBA format in use */
+#define NVME_ID_NS_LBAF     128u   /* 4-byte formats; LBADS in bits 23:16 */
+
+#endif /* _RODNIX_DRIVERS_STORAGE_NVME_H */
@@ -0,0 +1,530 @@
+/**
+ * @file virtio.c
+ * @brief Virtio 1.0 PCI transport and split virtqueues
+ *
+ * Only the modern (virtio 1.0) PCI transport is implemented: the common,
+ * notify and device configuration structures are found through the
+ * vendor-specific capabilities and mapped uncached. Transitional devices
+ * expose these as well, so QEMU's default virtio-*-pci devices work.
+ *
+ * A device gets one MSI-X vector shared by the config change interrupt and
+ * its queues; the driver's irq callback looks at all of them. Multi-queue
+ * drivers can give a queue its own vector, aimed at the CPU that serves
+ * the queue, with virtqueue_setup_irq(). Without MSI-X the driver polls
+ * its queues.
+ *
+ * Rings live in physically contiguous physmap pages. 64-bit registers are
+ * written as two 32-bit halves, which the spec allows and QEMU requires.
+ */
+
+#include "virtio.h"
+#include "../../../kernel/fabric/fabric.h"
+#include "../../../kernel/core/memory.h"
+#include "../../../kernel/arch/config.h"
+#include "../../../kernel/arch/msi.h"
+#include "../../../include/common.h"
+#include "../../../include/console.h"
+#include "../../../include/error.h"
+#include <stddef.h>
+
+#define VIRTIO_RESET_SPINS 1000000u
+
+/* Common config field offsets. */
+#define VCC(field) ((uint32_t)offsetof(virtio_pci_common_cfg_t, field))
+
+static inline volatile uint8_t* vcc_ptr(const virtio_dev_t* vdev, uint32_t off)
+{
+    return (volatile uint8_t*)vdev->common + off;
+}
+
+static inline uint8_t vcc_rd8(const virtio_dev_t* vdev, uint32_t off)
+{
+    return *vcc_ptr(vdev, off);
+}
+
+static inline void vcc_wr8(const virtio_dev_t* vdev, uint32_t off, uint8_t v)
+{
+    *vcc_ptr(vdev, off) = v;
+}
+
+static inline uint16_t vcc_rd16(const virtio_dev_t* vdev, uint32_t off)
+{
+    return *(volatile uint16_t*)vcc_ptr(vdev, off);
+}
+
+static inline void vcc_wr16(const virtio_dev_t* vdev, uint32_t off, uint16_t v)
+{
+    *(volatile uint16_t*)vcc_ptr(vdev, off) = v;
+}
+
+static inline uint32_t vcc_rd32(const virtio_dev_t* vdev, uint32_t off)
+{
+    return *(volatile uint32_t*)vcc_ptr(vdev, off);
+}
+
+static inline void vcc_wr32(const virtio_dev_t* vdev, uint32_t off, uint32_t v)
+{
+    *(volatile uint32_t*)vcc_ptr(vdev, off) = v;
+}
+
+static inline void vcc_wr64(const virtio_dev_t* vdev, uint32_t off, uint64_t v)
+{
+    vcc_wr32(vdev, off, (uint32_t)v);
+    vcc_wr32(vdev, off + 4u, (uint32_t)(v >> 32));
+}
+
+static inline uint64_t virtio_phys(const volatile void* virt)
+{
+    return (uint64_t)ARCH_VIRT_TO_PHYS((const void*)virt);
+}
+
+uint32_t virtio_pci_device_type(const fabric_device_t* dev)
+{
+    if (!dev || dev->vendor_id != VIRTIO_VENDOR_ID) {
+        return 0;
+    }
+    uint16_t id = dev->device_id;
+    if (id >= VIRTIO_PCI_MODERN_BASE && id < VIRTIO_PCI_MODERN_BASE + 0x40u) {
+        return (uint32_t)(id - VIRTIO_PCI_MODERN_BASE);
+    }
+    if (id < VIRTIO_PCI_LEGACY_FIRST || id > VIRTIO_PCI_LEGACY_LAST) {
+        return 0;
+    }
+    /* Transitional ids predate the type numbering. */
+    switch (id) {
+    case 0x1000u: return VIRTIO_ID_NET;
+    case 0x1001u: return VIRTIO_ID_BLOCK;
+    case 0x1003u: return VIRTIO_ID_CONSOLE;
+    case 0x1005u: return VIRTIO_ID_RNG;
+    default: return 0;
+    }
+}
+
+static void virtio_set_status(virtio_dev_t* vdev, uint8_t bits)
+{
+    vcc_wr8(vdev, VCC(device_status), (uint8_t)(vcc_rd8(vdev, VCC(device_status)) | bits));
+}
+
+int virtio_pci_init(virtio_dev_t* vdev, fabric_device_t* dev)
+{
+    if (!vdev || !dev) {
+        return RDNX_E_INVALID;
+    }
+    memset(vdev, 0, sizeof(*vdev));
+    vdev->pci = dev;
+    vdev->type = virtio_pci_device_type(dev);
+    vdev->vector = -1;
+
+    for (uint8_t cap = pci_find_next_capability(dev, 0, PCI_CAP_ID_VNDR); cap != 0;
+         cap = pci_find_next_capability(dev, cap, PCI_CAP_ID_VNDR)) {
+        uint32_t type = pci_config_read32(dev, cap) >> 24;
+        uint32_t bar = pci_config_read32(dev, (uint8_t)(cap + 4u)) & 0xFFu;
+        uint32_t off = pci_config_read32(dev, (uint8_t)(cap + 8u));
+        uint32_t len = pci_config_read32(dev, (uint8_t)(cap + 12u));
+        if (bar >= PCI_BAR_COUNT || len == 0) {
+            continue;
+        }
+        uint64_t base = pci_bar_address(dev, bar);
+        if (base == 0) {
+            continue;
+        }
+        /* The first capability of each type is the preferred one. */
+        switch (type) {
+        case VIRTIO_PCI_CAP_COMMON_CFG:
+            if (!vdev->common && len >= sizeof(virtio_pci_common_cfg_t)) {
+                vdev->common = (volatile virtio_pci_common_cfg_t*)pci_map_mmio(base + off, len);
+            }
+            break;
+        case VIRTIO_PCI_CAP_NOTIFY_CFG:
+            if (!vdev->notify_base) {
+                vdev->notify_mult = pci_config_read32(dev, (uint8_t)(cap + 16u));
+                vdev->notify_base = (volatile uint8_t*)pci_map_mmio(base + off, len);
+            }
+            break;
+        case VIRTIO_PCI_CAP_DEVICE_CFG:
+            if (!vdev->device_cfg) {
+                vdev->device_cfg = (volatile uint8_t*)pci_map_mmio(base + off, len);
+                vdev->device_cfg_len = len;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (!vdev->common || !vdev->notify_base) {
+        return RDNX_E_UNSUPPORTED;
+    }
+
+    pci_enable_bus_master(dev);
+    vcc_wr8(vdev, VCC(device_status), 0);
+    for (uint32_t i = 0; vcc_rd8(vdev, VCC(device_status)) != 0; i++) {
+        if (i == VIRTIO_RESET_SPINS) {
+            return RDNX_E_TIMEOUT;
+        }
+    }
+    virtio_set_status(vdev, VIRTIO_STATUS_ACKNOWLEDGE);
+    virtio_set_status(vdev, VIRTIO_STATUS_DRIVER);
+    return RDNX_OK;
+}
+
+int virtio_negotiate(virtio_dev_t* vdev, uint64_t wanted)
+{
+    vcc_wr32(vdev, VCC(device_feature_select), 0);
+    uint64_t offered = vcc_rd32(vdev, VCC(device_feature));
+    vcc_wr32(vdev, VCC(device_feature_select), 1);
+    offered |= (uint64_t)vcc_rd32(vdev, VCC(device_feature)) << 32;
+    if (!(offered & (1ULL << VIRTIO_F_VERSION_1))) {
+        virtio_set_status(vdev, VIRTIO_STATUS_FAILED);
+        return RDNX_E_UNSUPPORTED;
+    }
+
+    uint64_t features = (wanted & offered) | (1ULL << VIRTIO_F_VERSION_1);
+    vcc_wr32(vdev, VCC(driver_feature_select), 0);
+    vcc_wr32(vdev, VCC(driver_feature), (uint32_t)features);
+    vcc_wr32(vdev, VCC(driver_feature_select), 1);
+    vcc_wr32(vdev, VCC(driver_feature), (uint32_t)(features >> 32));
+    virtio_set_status(vdev, VIRTIO_STATUS_FEATURES_OK);
+    if (!(vcc_rd8(vdev, VCC(device_status)) & VIRTIO_STATUS_FEATURES_OK)) {
+        virtio_set_status(vdev, VIRTIO_STATUS_FAILED);
+        return RDNX_E_UNSUPPORTED;
+    }
+    vdev->features = features;
+    return RDNX_OK;
+}
+
+static void virtio_irq(int vector, void* arg)
+{
+    (void)vector;
+    virtio_dev_t* vdev = (virtio_dev_t*)arg;
+    if (vdev->irq) {
+        vdev->irq(vdev);
+    }
+}
+
+void virtio_setup_irq(virtio_dev_t* vdev, void (*irq)(virtio_dev_t* vdev))
+{
+    vdev->irq = irq;
+    if (!msi_is_available() || pci_msix_enable(vdev->pci, &vdev->msix) != RDNX_OK) {
+        return;
+    }
+    vdev->msix_on = true;
+    int vector = msi_vector_alloc();
+    uint64_t addr = 0;
+    uint32_t data = 0;
+    if (vector >= 0 &&
+        msi_compose(vector, 0, &addr, &data) == RDNX_OK &&
+        fabric_request_irq(vector, virtio_irq, vdev) == RDNX_OK) {
+        (void)pci_msix_set_entry(&vdev->msix, 0, addr, data);
+        vcc_wr16(vdev, VCC(msix_config), 0);
+        if (vcc_rd16(vdev, VCC(msix_config)) == 0) {
+            vdev->vector = vector;
+            vdev->msix_next = 1;
+            return;
+        }
+        fabric_free_irq(vector, virtio_irq);
+    }
+    if (vector >= 0) {
+        msi_vector_free(vector);
+    }
+    pci_msix_disable(vdev->pci, &vdev->msix);
+    vdev->msix_on = false;
+}
+
+void virtio_driver_ok(virtio_dev_t* vdev)
+{
+    virtio_set_status(vdev, VIRTIO_STATUS_DRIVER_OK);
+}
+
+void virtio_fail(virtio_dev_t* vdev)
+{
+    if (!vdev || !vdev->common) {
+        return;
+    }
+    virtio_set_status(vdev, VIRTIO_STATUS_FAILED);
+    if (vdev->vector >= 0) {
+        fabric_free_irq(vdev->vector, virtio_irq);
+        msi_vector_free(vdev->vector);
+        vdev->vector = -1;
+    }
+    if (vdev->msix_on) {
+        pci_msix_disable(vdev->pci, &vdev->msix);
+        vdev->msix_on = false;
+    }
+}
+
+void virtio_udelay(uint32_t us)
+{
+    /* A write to the POST port takes about a microsecond on PC hardware. */
+    for (uint32_t i = 0; i < us; i++) {
+        __asm__ volatile ("outb %%al, $0x80" : : "a"(0));
+    }
+}
+
+uint8_t virtio_cfg_read8(const virtio_dev_t* vdev, uint32_t off)
+{
+    if (!vdev->device_cfg || off + 1u > vdev->device_cfg_len) {
+        return 0;
+    }
+    return vdev->device_cfg[off];
+}
+
+uint16_t virtio_cfg_read16(const virtio_dev_t* vdev, uint32_t off)
+{
+    if (!vdev->device_cfg || off + 2u > vdev->device_cfg_len) {
+        return 0;
+    }
+    return *(volatile uint16_t*)(vdev->device_cfg + off);
+}
+
+uint32_t virtio_cfg_read32(const virtio_dev_t* vdev, uint32_t off)
+{
+    if (!vdev->device_cfg || off + 4u > vdev->device_cfg_len) {
+        return 0;
+    }
+    /* Retry across a config change (generation bump) for a consistent value. */
+    uint8_t gen;
+    uint32_t v;
+    do {
+        gen = vcc_rd8(vdev, VCC(config_generation));
+        v = *(volatile uint32_t*)(vdev->device_cfg + off);
+    } while (gen != vcc_rd8(vdev, VCC(config_generation)));
+    return v;
+}
+
+/* ============================================================================
+ * Split virtqueues
+ * ============================================================================ */
+
+/*
+ * Allocate and enable queue index. *msix_entry is the MSI-X entry to route
+ * the queue to; if the device refuses it, the queue goes to the shared
+ * vector instead and *msix_entry reports what is in effect.
+ */
+static int virtqueue_init(virtio_dev_t* vdev, virtqueue_t* vq, uint16_t index, uint16_t max_size,
+                          uint16_t* msix_entry)
+{
+    if (!vdev || !vq || index >= vcc_rd16(vdev, VCC(num_queues))) {
+        return RDNX_E_NOTFOUND;
+    }
+    vcc_wr16(vdev, VCC(queue_select), index);
+    uint16_t size = vcc_rd16(vdev, VCC(queue_size));
+    if (size == 0) {
+        return RDNX_E_NOTFOUND;
+    }
+    if (max_size > VIRTQ_SIZE_MAX || max_size == 0) {
+        max_size = VIRTQ_SIZE_MAX;
+    }
+    if (size > max_size) {
+        size = max_size;
+    }
+    /* Power of two, so ring positions wrap with the 16-bit indices. */
+    while (size & (size - 1u)) {
+        size &= (uint16_t)(size - 1u);
+    }
+
+    uint32_t avail_off = 16u * size;
+    uint32_t used_off = (avail_off + 6u + 2u * size + 3u) & ~3u;
+    uint32_t bytes = used_off + 6u + 8u * size;
+    uint32_t pages = (bytes + 4095u) / 4096u;
+    uint8_t* ring = (uint8_t*)vmm_alloc_pages(pages, PAGE_FLAG_WRITABLE);
+    void** cookies = (void**)kmalloc(sizeof(void*) * size);
+    if (!ring || !cookies) {
+        if (ring) {
+            vmm_free_pages(ring, pages);
+        }
+        kfree(cookies);
+        return RDNX_E_NOMEM;
+    }
+    memset(ring, 0, (size_t)pages * 4096u);
+    memset(cookies, 0, sizeof(void*) * size);
+
+    memset(vq, 0, sizeof(*vq));
+    vq->vdev = vdev;
+    vq->index = index;
+    vq->size = size;
+    vq->desc = (volatile vring_desc_t*)ring;
+    vq->avail = (volatile vring_avail_t*)(ring + avail_off);
+    vq->used = (volatile vring_used_t*)(ring + used_off);
+    vq->ring_pages = pages;
+    vq->cookies = cookies;
+    for (uint16_t i = 0; i < size; i++) {
+        vq->desc[i].next = (uint16_t)(i + 1u);
+    }
+    vq->free_head = 0;
+    vq->num_free = size;
+    vq->vector = -1;
+
+    const uint16_t shared = (vdev->vector >= 0) ? 0 : VIRTIO_MSI_NO_VECTOR;
+    vcc_wr16(vdev, VCC(queue_size), size);
+    vcc_wr16(vdev, VCC(queue_msix_vector), *msix_entry);
+    if (*msix_entry != shared && vcc_rd16(vdev, VCC(queue_msix_vector)) != *msix_entry) {
+        vcc_wr16(vdev, VCC(queue_msix_vector), shared);
+        *msix_entry = shared;
+    }
+    vcc_wr64(vdev, VCC(queue_desc), virtio_phys(vq->desc));
+    vcc_wr64(vdev, VCC(queue_driver), virtio_phys(vq->avail));
+    vcc_wr64(vdev, VCC(queue_device), virtio_phys(vq->used));
+    uint16_t notify_off = vcc_rd16(vdev, VCC(queue_notify_off));
+    vq->notify = (volatile uint16_t*)(vdev->notify_base + (uint32_t)notify_off * vdev->notify_mult);
+    vcc_wr16(vdev, VCC(queue_enable), 1);
+    return RDNX_OK;
+}
+
+int virtqueue_setup(virtio_dev_t* vdev, virtqueue_t* vq, uint16_t index, uint16_t max_size)
+{
+    uint16_t entry = (vdev && vdev->vector >= 0) ? 0 : VIRTIO_MSI_NO_VECTOR;
+    return virtqueue_init(vdev, vq, index, max_size, &entry);
+}
+
+static void virtqueue_irq(int vector, void* arg)
+{
+    (void)vector;
+    virtqueue_t* vq = (virtqueue_t*)arg;
+    if (vq->irq) {
+        vq->irq(vq);
+    }
+}
+
+int virtqueue_setup_irq(virtio_dev_t* vdev, virtqueue_t* vq, uint16_t index, uint16_t max_size,
+                        uint32_t cpu, void (*irq)(virtqueue_t* vq), void* priv)
+{
+    if (!vdev || !vdev->msix_on || vdev->vector < 0 || vdev->msix_next >= vdev->msix.entries) {
+        return virtqueue_setup(vdev, vq, index, max_size);
+    }
+    int vector = msi_vector_alloc();
+    uint64_t addr = 0;
+    uint32_t data = 0;
+    if (vector < 0 || msi_compose(vector, cpu, &addr, &data) != RDNX_OK) {
+        if (vector >= 0) {
+            msi_vector_free(vector);
+        }
+        return virtqueue_setup(vdev, vq, index, max_size);
+    }
+
+    const uint16_t entry = vdev->msix_next;
+    uint16_t got = entry;
+    int rc = virtqueue_init(vdev, vq, index, max_size, &got);
+    if (rc != RDNX_OK || got != entry) {
+        msi_vector_free(vector);
+        return rc;
+    }
+    vq->irq = irq;
+    vq->priv = priv;
+    if (fabric_request_irq(vector, virtqueue_irq, vq) != RDNX_OK) {
+        /* Back to the shared vector; the entry stays masked. */
+        vcc_wr16(vdev, VCC(queue_select), index);
+        vcc_wr16(vdev, VCC(queue_msix_vector), 0);
+        msi_vector_free(vector);
+        return RDNX_OK;
+    }
+    /* Unmask last: an interrupt raised while masked is held pending until now. */
+    (void)pci_msix_set_entry(&vdev->msix, entry, addr, data);
+    vdev->msix_next++;
+    vq->vector = vector;
+    vq->msix_entry = entry;
+    return RDNX_OK;
+}
+
+void virtqueue_release_irq(virtqueue_t* vq)
+{
+    if (!vq || vq->vector < 0) {
+        return;
+    }
+    pci_msix_mask_entry(&vq->vdev->msix, vq->msix_entry, true);
+    fabric_free_irq(vq->vector, virtqueue_irq);
+    msi_vector_free(vq->vector);
+    vq->vector = -1;
+}
+
+int virtqueue_add(virtqueue_t* vq, const virtio_sg_t* sg, uint32_t out, uint32_t in, void* cookie)
+{
+    uint32_t n = out + in;
+    if (!vq || !sg || n == 0) {
+        return RDNX_E_INVALID;
+    }
+    if (n > vq->num_free) {
+        return RDNX_E_BUSY;
+    }
+    uint16_t head = vq->free_head;
+    uint16_t d = head;
+    uint16_t last = head;
+    for (uint32_t i = 0; i < n; i++) {
+        volatile vring_desc_t* desc = &vq->desc[d];
+        desc->addr = sg[i].phys;
+        desc->len = sg[i].len;
+        desc->flags = (uint16_t)(((i >= out) ? VRING_DESC_F_WRITE : 0u) |
+                                 ((i + 1u < n) ? VRING_DESC_F_NEXT : 0u));
+        last = d;
+        d = desc->next;
+    }
+    vq->free_head = vq->desc[last].next;
+    vq->num_free = (uint16_t)(vq->num_free - n);
+    vq->cookies[head] = cookie;
+    uint16_t slot = (uint16_t)(vq->avail->idx + vq->added);
+    vq->avail->ring[slot & (vq->size - 1u)] = head;
+    vq->added++;
+    return RDNX_OK;
+}
+
+void virtqueue_kick(virtqueue_t* vq)
+{
+    if (!vq || vq->added == 0) {
+        return;
+    }
+    /* Ring entries before the index; the index before reading the device's flags. */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    vq->avail->idx = (uint16_t)(vq->avail->idx + vq->added);
+    vq->added = 0;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!(vq->used->flags & VRING_USED_F_NO_NOTIFY)) {
+        *vq->notify = vq->index;
+    }
+}
+
+void* virtqueue_get(virtqueue_t* vq, uint32_t* len)
+{
+    if (!vq || vq->last_used == vq->used->idx) {
+        return NULL;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    volatile vring_used_elem_t* e = &vq->used->ring[vq->last_used & (vq->size - 1u)];
+    uint16_t head = (uint16_t)e->id;
+    if (len) {
+        *len = e->len;
+    }
+    vq->last_used++;
+    if (head >= vq->size) {
+        return NULL;
+    }
+    void* cookie = vq->cookies[head];
+    vq->cookies[head] = NULL;
+
+    uint16_t d = head;
+    uint16_t n = 1;
+    while (vq->desc[d].flags & VRING_DESC_F_NEXT) {
+        d = vq->desc[d].next;
+        n++;
+    }
+    vq->desc[d].next = vq->free_head;
+    vq->free_head = head;
+    vq->num_free = (uint16_t)(vq->num_free + n);
+    return cookie;
+}
+
+void virtqueue_disable_cb(virtqueue_t* vq)
+{
+    if (vq) {
+        vq->avail->flags = (uint16_t)(vq->avail->flags | VRING_AVAIL_F_NO_INTERRUPT);
+    }
+}
+
+bool virtqueue_enable_cb(virtqueue_t* vq)
+{
+    if (!vq) {
+        return false;
+    }
+    vq->avail->flags = (uint16_t)(vq->avail->flags & ~VRING_AVAIL_F_NO_INTERRUPT);
+    /* The flag store before the used index load, or a completion in between goes unseen. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return vq->used->idx != vq->last_used;
+}
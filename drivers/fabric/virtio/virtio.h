@@ -0,0 +1,223 @@
+/**
+ * @file virtio.h
+ * @brief Virtio 1.0 PCI transport and split virtqueues shared by the virtio drivers
+ */
+
+#ifndef _RODNIX_DRIVERS_VIRTIO_H
+#define _RODNIX_DRIVERS_VIRTIO_H
+
+#include "../../../kernel/fabric/device/device.h"
+#include "../../../kernel/fabric/bus/pci.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VIRTIO_VENDOR_ID           0x1AF4u
+#define VIRTIO_PCI_MODERN_BASE     0x1040u   /* device id = base + virtio id */
+#define VIRTIO_PCI_LEGACY_FIRST    0x1000u   /* transitional ids 0x1000..0x103F */
+#define VIRTIO_PCI_LEGACY_LAST     0x103Fu
+
+/* Virtio device types. */
+enum {
+    VIRTIO_ID_NET     = 1,
+    VIRTIO_ID_BLOCK   = 2,
+    VIRTIO_ID_CONSOLE = 3,
+    VIRTIO_ID_RNG     = 4
+};
+
+/* Device status. */
+#define VIRTIO_STATUS_ACKNOWLEDGE  0x01u
+#define VIRTIO_STATUS_DRIVER       0x02u
+#define VIRTIO_STATUS_DRIVER_OK    0x04u
+#define VIRTIO_STATUS_FEATURES_OK  0x08u
+#define VIRTIO_STATUS_NEEDS_RESET  0x40u
+#define VIRTIO_STATUS_FAILED       0x80u
+
+#define VIRTIO_F_VERSION_1         32u       /* feature bit numbers */
+
+/* struct virtio_pci_cap cfg_type. */
+enum {
+    VIRTIO_PCI_CAP_COMMON_CFG = 1,
+    VIRTIO_PCI_CAP_NOTIFY_CFG = 2,
+    VIRTIO_PCI_CAP_ISR_CFG    = 3,
+    VIRTIO_PCI_CAP_DEVICE_CFG = 4
+};
+
+/* Common configuration structure (BAR-relative, little-endian). */
+typedef struct virtio_pci_common_cfg {
+    uint32_t device_feature_select;
+    uint32_t device_feature;
+    uint32_t driver_feature_select;
+    uint32_t driver_feature;
+    uint16_t msix_config;
+    uint16_t num_queues;
+    uint8_t device_status;
+    uint8_t config_generation;
+    uint16_t queue_select;
+    uint16_t queue_size;
+    uint16_t queue_msix_vector;
+    uint16_t queue_enable;
+    uint16_t queue_notify_off;
+    uint64_t queue_desc;
+    uint64_t queue_driver;
+    uint64_t queue_device;
+} __attribute__((packed)) virtio_pci_common_cfg_t;
+
+#define VIRTIO_MSI_NO_VECTOR       0xFFFFu
+
+/* Split virtqueue layout. */
+typedef struct vring_desc {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed)) vring_desc_t;
+
+#define VRING_DESC_F_NEXT          0x1u
+#define VRING_DESC_F_WRITE         0x2u      /* device writes the buffer */
+
+typedef struct vring_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed)) vring_avail_t;
+
+#define VRING_AVAIL_F_NO_INTERRUPT 0x1u
+
+typedef struct vring_used_elem {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed)) vring_used_elem_t;
+
+typedef struct vring_used {
+    uint16_t flags;
+    uint16_t idx;
+    vring_used_elem_t ring[];
+} __attribute__((packed)) vring_used_t;
+
+#define VRING_USED_F_NO_NOTIFY     0x1u
+
+_Static_assert(sizeof(virtio_pci_common_cfg_t) == 56, "virtio common cfg is 56 bytes");
+_Static_assert(sizeof(vring_desc_t) == 16, "vring descriptor is 16 bytes");
+
+#define VIRTQ_SIZE_MAX             256u
+
+struct virtio_dev;
+
+typedef struct virtqueue {
+    struct virtio_dev* vdev;
+    uint16_t index;
+    uint16_t size;
+    volatile vring_desc_t* desc;
+    volatile vring_avail_t* avail;
+    volatile vring_used_t* used;
+    volatile uint16_t* notify;
+    uint32_t ring_pages;
+    uint16_t free_head;
+    uint16_t num_free;
+    uint16_t last_used;
+    uint16_t added;             /* buffers made available since the last kick */
+    void** cookies;             /* per head descriptor */
+    int vector;                 /* own MSI-X vector, -1 when on the shared one */
+    uint16_t msix_entry;
+    void (*irq)(struct virtqueue* vq);
+    void* priv;
+} virtqueue_t;
+
+/* One buffer of a descriptor chain; physically contiguous. */
+typedef struct virtio_sg {
+    uint64_t phys;
+    uint32_t len;
+} virtio_sg_t;
+
+typedef struct virtio_dev {
+    fabric_device_t* pci;
+    uint32_t type;              /* VIRTIO_ID_* */
+    volatile virtio_pci_common_cfg_t* common;
+    volatile uint8_t* notify_base;
+    uint32_t notify_mult;
+    volatile uint8_t* device_cfg;
+    uint32_t device_cfg_len;
+    uint64_t features;          /* negotiated */
+    pci_msix_t msix;
+    bool msix_on;
+    int vector;                 /* config and shared queue vector (entry 0), -1 when polled */
+    uint16_t msix_next;         /* next MSI-X entry for a per-queue vector */
+    void (*irq)(struct virtio_dev* vdev);
+    void* priv;
+} virtio_dev_t;
+
+/* Virtio device type of a PCI function, 0 when it is not a virtio device. */
+uint32_t virtio_pci_device_type(const fabric_device_t* dev);
+
+/*
+ * Locate the common/notify/device config structures, reset the device and
+ * set ACKNOWLEDGE | DRIVER. Fails with RDNX_E_UNSUPPORTED for legacy-only
+ * devices (no virtio vendor capabilities).
+ */
+int virtio_pci_init(virtio_dev_t* vdev, fabric_device_t* dev);
+/* Offer wanted & device features plus VERSION_1, then FEATURES_OK. */
+int virtio_negotiate(virtio_dev_t* vdev, uint64_t wanted);
+static inline bool virtio_has_feature(const virtio_dev_t* vdev, uint32_t bit)
+{
+    return (vdev->features & (1ULL << bit)) != 0;
+}
+/*
+ * Route config and queue interrupts through one MSI-X vector calling irq.
+ * Call before virtqueue_setup(); on failure the device stays polled.
+ * Queues set up with virtqueue_setup_irq() get their own vector instead.
+ */
+void virtio_setup_irq(virtio_dev_t* vdev, void (*irq)(virtio_dev_t* vdev));
+void virtio_driver_ok(virtio_dev_t* vdev);
+/* Mark the device FAILED and release the interrupt; queues stay allocated. */
+void virtio_fail(virtio_dev_t* vdev);
+
+/* Busy-wait for about us microseconds (bring-up polling without interrupts). */
+void virtio_udelay(uint32_t us);
+
+uint8_t virtio_cfg_read8(const virtio_dev_t* vdev, uint32_t off);
+uint16_t virtio_cfg_read16(const virtio_dev_t* vdev, uint32_t off);
+uint32_t virtio_cfg_read32(const virtio_dev_t* vdev, uint32_t off);
+
+/*
+ * Queue setup is only valid between virtio_negotiate() and
+ * virtio_driver_ok(). The size is the device maximum, capped at max_size
+ * and VIRTQ_SIZE_MAX. Returns RDNX_E_NOTFOUND when the queue does not exist.
+ */
+int virtqueue_setup(virtio_dev_t* vdev, virtqueue_t* vq, uint16_t index, uint16_t max_size);
+/*
+ * virtqueue_setup() plus a dedicated MSI-X vector aimed at cpu that calls
+ * irq(vq) with vq->priv = priv. Without MSI-X, a free vector or a free
+ * table entry the queue stays on the shared vector (vq->vector is -1) and
+ * the device irq callback has to service it.
+ */
+int virtqueue_setup_irq(virtio_dev_t* vdev, virtqueue_t* vq, uint16_t index, uint16_t max_size,
+                        uint32_t cpu, void (*irq)(virtqueue_t* vq), void* priv);
+/* Release a per-queue vector; the queue falls silent until reset. */
+void virtqueue_release_irq(virtqueue_t* vq);
+
+/*
+ * The queue functions do no locking: the driver serialises add/kick/get
+ * on one queue with its own lock.
+ *
+ * virtqueue_add() chains out driver-readable buffers followed by in
+ * device-writable ones; cookie (non-NULL) comes back from virtqueue_get().
+ * RDNX_E_BUSY when there are not enough free descriptors.
+ */
+int virtqueue_add(virtqueue_t* vq, const virtio_sg_t* sg, uint32_t out, uint32_t in, void* cookie);
+/* Publish added buffers and notify the device unless it asked not to be. */
+void virtqueue_kick(virtqueue_t* vq);
+/* Next completed chain: its cookie and the byte count the device wrote; NULL when none. */
+void* virtqueue_get(virtqueue_t* vq, uint32_t* len);
+/* Ask the device not to interrupt for this queue (a hint; spurious interrupts stay possible). */
+void virtqueue_disable_cb(virtqueue_t* vq);
+/*
+ * Ask for interrupts again. Returns true when completions are already
+ * waiting, which the device may not interrupt for: poll them instead.
+ */
+bool virtqueue_enable_cb(virtqueue_t* vq);
+static inline uint16_t virtqueue_free(const virtqueue_t* vq)
+{
+    return vq->num_free;
+}
+
+#endif /* _RODNIX_DRIVERS_VIRTIO_H */
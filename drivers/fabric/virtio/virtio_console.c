@@ -0,0 +1,619 @@
+/**
+ * @file virtio_console.c
+ * @brief Fabric virtio-console driver: multiport console and log channel
+ *
+ * With VIRTIO_CONSOLE_F_MULTIPORT the device has a control queue pair and
+ * an rx/tx queue pair per port; all of them are set up for the first
+ * VCON_PORT_MAX ports before DRIVER_OK, and ports become usable when the
+ * device announces them (DEVICE_ADD -> PORT_READY). Without MULTIPORT
+ * port 0 is the only port and is always open.
+ *
+ * The console port (CONSOLE_PORT, or port 0) is "hvc0": it mirrors the
+ * kernel console output and its input feeds InputCore like the serial
+ * port does. A port named VCON_LOG_NAME is the log channel and gets the
+ * same output with no "\n" translation, for capture into a host file.
+ *
+ * Output goes through a console sink. Bytes are staged in a page-sized tx
+ * slot and handed to the device as one descriptor at the end of every
+ * kputs/kprintf/console_write, or when the slot fills, instead of one
+ * UART register write per byte. The sink may run in interrupt or fault
+ * context, so it only trylocks and drops output (counted) when the lock
+ * is busy or the host has stopped reading.
+ *
+ * Everything else (control messages, rx, tx reclaim) runs in the vcond
+ * thread, woken by the MSI-X interrupt or every VCON_POLL_MS when the
+ * device has no interrupt. Until the scheduler runs, attach polls the
+ * control handshake directly.
+ */
+
+#include "virtio.h"
+#include "../../../kernel/fabric/fabric.h"
+#include "../../../kernel/fabric/driver/driver.h"
+#include "../../../kernel/fabric/spin.h"
+#include "../../../kernel/common/waitq.h"
+#include "../../../kernel/common/scheduler.h"
+#include "../../../kernel/core/memory.h"
+#include "../../../kernel/input/input.h"
+#include "../../../kernel/arch/config.h"
+#include "../../../include/common.h"
+#include "../../../include/console.h"
+#include "../../../include/error.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VCON_PORT_MAX          4u
+#define VCON_RX_BUFS           4u      /* per port, VCON_RX_BYTES each, one page */
+#define VCON_RX_BYTES          1024u
+#define VCON_TX_SLOTS          4u      /* per port, one page each */
+#define VCON_TX_BYTES          4096u
+#define VCON_CTRL_RX_BUFS      16u     /* VCON_CTRL_BYTES each, one page */
+#define VCON_CTRL_BYTES        256u
+#define VCON_CTRL_TX_SLOTS     16u
+#define VCON_POLL_MS           20u
+#define VCON_HANDSHAKE_MS      100u
+#define VCON_NAME_MAX          32u
+#define VCON_LOG_NAME          "rodnix.log"
+
+_Static_assert(VCON_RX_BUFS * VCON_RX_BYTES <= 4096u, "rx buffers share one page");
+_Static_assert(VCON_CTRL_RX_BUFS * VCON_CTRL_BYTES <= 4096u, "control rx buffers share one page");
+_Static_assert(VCON_TX_SLOTS < 32u && VCON_CTRL_TX_SLOTS < 32u, "free maps are 32-bit");
+
+/* Feature bits. */
+#define VIRTIO_CONSOLE_F_SIZE        0u
+#define VIRTIO_CONSOLE_F_MULTIPORT   1u
+
+/* struct virtio_console_config offsets. */
+#define VCON_CFG_MAX_NR_PORTS  4u
+
+/* Control message events. */
+enum {
+    VCON_DEVICE_READY  = 0,
+    VCON_DEVICE_ADD    = 1,
+    VCON_DEVICE_REMOVE = 2,
+    VCON_PORT_READY    = 3,
+    VCON_CONSOLE_PORT  = 4,
+    VCON_RESIZE        = 5,
+    VCON_PORT_OPEN     = 6,
+    VCON_PORT_NAME     = 7
+};
+
+typedef struct vcon_ctrl_msg {
+    uint32_t id;
+    uint16_t event;
+    uint16_t value;
+} __attribute__((packed)) vcon_ctrl_msg_t;
+
+typedef struct vcon_port {
+    uint32_t id;
+    bool present;               /* announced by the device */
+    bool console;               /* hvc0 */
+    bool log;                   /* VCON_LOG_NAME */
+    bool host_open;             /* host side connected */
+    char name[VCON_NAME_MAX];
+    virtqueue_t rxq;
+    virtqueue_t txq;
+    uint8_t* rx_page;
+    uint8_t* tx_pages;          /* VCON_TX_SLOTS contiguous pages */
+    uint32_t tx_free;           /* bit per free slot */
+    int tx_fill;                /* slot being filled, -1 none */
+    uint32_t tx_len;            /* bytes in the fill slot */
+    uint64_t tx_bytes;
+    uint64_t rx_bytes;
+    uint64_t dropped;
+} vcon_port_t;
+
+typedef struct vcon {
+    int used;
+    int present;
+    bool multiport;
+    uint32_t nports;
+    virtio_dev_t vdev;
+    spinlock_t lock;
+    virtqueue_t ctrl_rxq;
+    virtqueue_t ctrl_txq;
+    uint8_t* ctrl_rx_page;
+    vcon_ctrl_msg_t* ctrl_tx;   /* VCON_CTRL_TX_SLOTS messages, one page */
+    uint32_t ctrl_tx_free;
+    vcon_port_t ports[VCON_PORT_MAX];
+} vcon_t;
+
+static vcon_t g_vcon;
+static waitq_t g_vcond_wq;
+static thread_t* g_vcond;
+
+static inline uint64_t vcon_phys(const void* p)
+{
+    return (uint64_t)ARCH_VIRT_TO_PHYS(p);
+}
+
+static vcon_port_t* vcon_port(vcon_t* v, uint32_t id)
+{
+    return (id < v->nports) ? &v->ports[id] : NULL;
+}
+
+/* ============================================================================
+ * Queue helpers (caller holds v->lock)
+ * ============================================================================ */
+
+static void vcon_post_rx_locked(virtqueue_t* vq, uint8_t* page, uint32_t bytes, uint32_t idx)
+{
+    virtio_sg_t sg = { vcon_phys(page + idx * bytes), bytes };
+    /* The cookie is the buffer index + 1 (cookies are non-NULL). */
+    (void)virtqueue_add(vq, &sg, 0, 1, (void*)(uintptr_t)(idx + 1u));
+}
+
+static void vcon_send_ctrl_locked(vcon_t* v, uint32_t id, uint16_t event, uint16_t value)
+{
+    if (!v->multiport) {
+        return;
+    }
+    uint32_t len = 0;
+    void* done;
+    while ((done = virtqueue_get(&v->ctrl_txq, &len)) != NULL) {
+        v->ctrl_tx_free |= 1u << ((uint32_t)(uintptr_t)done - 1u);
+    }
+    if (v->ctrl_tx_free == 0) {
+        return;
+    }
+    uint32_t slot = (uint32_t)__builtin_ctz(v->ctrl_tx_free);
+    vcon_ctrl_msg_t* m = &v->ctrl_tx[slot];
+    m->id = id;
+    m->event = event;
+    m->value = value;
+    virtio_sg_t sg = { vcon_phys(m), sizeof(*m) };
+    if (virtqueue_add(&v->ctrl_txq, &sg, 1, 0, (void*)(uintptr_t)(slot + 1u)) == RDNX_OK) {
+        v->ctrl_tx_free &= ~(1u << slot);
+        virtqueue_kick(&v->ctrl_txq);
+    }
+}
+
+static void vcon_tx_reclaim_locked(vcon_port_t* p)
+{
+    uint32_t len = 0;
+    void* done;
+    while ((done = virtqueue_get(&p->txq, &len)) != NULL) {
+        p->tx_free |= 1u << ((uint32_t)(uintptr_t)done - 1u);
+    }
+}
+
+/* Hand the fill slot to the device. */
+static void vcon_tx_submit_locked(vcon_port_t* p)
+{
+    if (p->tx_fill < 0 || p->tx_len == 0) {
+        return;
+    }
+    uint32_t slot = (uint32_t)p->tx_fill;
+    virtio_sg_t sg = { vcon_phys(p->tx_pages + slot * VCON_TX_BYTES), p->tx_len };
+    if (virtqueue_add(&p->txq, &sg, 1, 0, (void*)(uintptr_t)(slot + 1u)) != RDNX_OK) {
+        /* Cannot happen with VCON_TX_SLOTS <= queue size; keep the data staged. */
+        return;
+    }
+    virtqueue_kick(&p->txq);
+    p->tx_bytes += p->tx_len;
+    p->tx_fill = -1;
+    p->tx_len = 0;
+}
+
+static bool vcon_port_writable(const vcon_t* v, const vcon_port_t* p)
+{
+    return p->present && (p->console || p->log) && (p->host_open || !v->multiport);
+}
+
+static void vcon_tx_put_locked(vcon_port_t* p, char c)
+{
+    if (p->tx_fill < 0) {
+        if (p->tx_free == 0) {
+            vcon_tx_reclaim_locked(p);
+        }
+        if (p->tx_free == 0) {
+            p->dropped++;
+            return;
+        }
+        p->tx_fill = __builtin_ctz(p->tx_free);
+        p->tx_free &= ~(1u << (uint32_t)p->tx_fill);
+        p->tx_len = 0;
+    }
+    p->tx_pages[(uint32_t)p->tx_fill * VCON_TX_BYTES + p->tx_len++] = (uint8_t)c;
+    if (p->tx_len == VCON_TX_BYTES) {
+        vcon_tx_submit_locked(p);
+    }
+}
+
+/* ============================================================================
+ * Console sink
+ * ============================================================================ */
+
+/* Raise IRQL and trylock: the sink can run under any lock, or from a fault. */
+static bool vcon_sink_lock(vcon_t* v, irql_t* old)
+{
+    *old = set_irql(IRQL_HIGH);
+    if (!spinlock_trylock(&v->lock)) {
+        set_irql(*old);
+        return false;
+    }
+    return true;
+}
+
+static void vcon_sink_unlock(vcon_t* v, irql_t old)
+{
+    spinlock_unlock(&v->lock);
+    set_irql(old);
+}
+
+static void vcon_sink_write(const char* buf, size_t len)
+{
+    vcon_t* v = &g_vcon;
+    if (!v->present) {
+        return;
+    }
+    irql_t old;
+    if (!vcon_sink_lock(v, &old)) {
+        for (uint32_t i = 0; i < v->nports; i++) {
+            if (vcon_port_writable(v, &v->ports[i])) {
+                v->ports[i].dropped += len;
+            }
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < v->nports; i++) {
+        vcon_port_t* p = &v->ports[i];
+        if (!vcon_port_writable(v, p)) {
+            continue;
+        }
+        for (size_t k = 0; k < len; k++) {
+            /* hvc0 is a terminal; the log channel is a byte stream. */
+            if (buf[k] == '\n' && p->console) {
+                vcon_tx_put_locked(p, '\r');
+            }
+            vcon_tx_put_locked(p, buf[k]);
+        }
+    }
+    vcon_sink_unlock(v, old);
+}
+
+static void vcon_sink_flush(void)
+{
+    vcon_t* v = &g_vcon;
+    if (!v->present) {
+        return;
+    }
+    irql_t old;
+    if (!vcon_sink_lock(v, &old)) {
+        return;
+    }
+    for (uint32_t i = 0; i < v->nports; i++) {
+        vcon_tx_submit_locked(&v->ports[i]);
+    }
+    vcon_sink_unlock(v, old);
+}
+
+static const console_sink_t g_vcon_sink = {
+    .write = vcon_sink_write,
+    .flush = vcon_sink_flush
+};
+
+/* ============================================================================
+ * Control and receive processing
+ * ============================================================================ */
+
+static void vcon_handle_ctrl_locked(vcon_t* v, const uint8_t* buf, uint32_t len)
+{
+    if (len < sizeof(vcon_ctrl_msg_t)) {
+        return;
+    }
+    vcon_ctrl_msg_t m;
+    memcpy(&m, buf, sizeof(m));
+    vcon_port_t* p = vcon_port(v, m.id);
+    switch (m.event) {
+    case VCON_DEVICE_ADD:
+        if (p) {
+            p->present = true;
+        }
+        vcon_send_ctrl_locked(v, m.id, VCON_PORT_READY, p ? 1u : 0u);
+        break;
+    case VCON_DEVICE_REMOVE:
+        if (p) {
+            p->present = false;
+            p->host_open = false;
+        }
+        break;
+    case VCON_CONSOLE_PORT:
+        if (p) {
+            p->console = true;
+            p->host_open = true;
+            memcpy(p->name, "hvc0", 5);
+            vcon_send_ctrl_locked(v, m.id, VCON_PORT_OPEN, 1);
+        }
+        break;
+    case VCON_PORT_OPEN:
+        if (p) {
+            p->host_open = (m.value != 0);
+        }
+        break;
+    case VCON_PORT_NAME:
+        if (p && !p->console) {
+            uint32_t n = len - (uint32_t)sizeof(m);
+            if (n >= VCON_NAME_MAX) {
+                n = VCON_NAME_MAX - 1u;
+            }
+            memcpy(p->name, buf + sizeof(m), n);
+            p->name[n] = '\0';
+            if (strcmp(p->name, VCON_LOG_NAME) == 0) {
+                p->log = true;
+                vcon_send_ctrl_locked(v, m.id, VCON_PORT_OPEN, 1);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Drain control messages, received bytes and tx completions. Console
+ * input is copied out and pushed to InputCore after the lock is dropped.
+ */
+static void vcon_service(vcon_t* v)
+{
+    uint8_t in[VCON_RX_BYTES];
+    uint32_t in_len = 0;
+    irql_t irql = spinlock_lock_irqsave(&v->lock);
+    uint32_t len = 0;
+    void* cookie;
+    if (v->multiport) {
+        bool reposted = false;
+        while ((cookie = virtqueue_get(&v->ctrl_rxq, &len)) != NULL) {
+            uint32_t idx = (uint32_t)(uintptr_t)cookie - 1u;
+            uint32_t n = (len < VCON_CTRL_BYTES) ? len : VCON_CTRL_BYTES;
+            vcon_handle_ctrl_locked(v, v->ctrl_rx_page + idx * VCON_CTRL_BYTES, n);
+            vcon_post_rx_locked(&v->ctrl_rxq, v->ctrl_rx_page, VCON_CTRL_BYTES, idx);
+            reposted = true;
+        }
+        if (reposted) {
+            virtqueue_kick(&v->ctrl_rxq);
+        }
+    }
+    for (uint32_t i = 0; i < v->nports; i++) {
+        vcon_port_t* p = &v->ports[i];
+        bool reposted = false;
+        while ((cookie = virtqueue_get(&p->rxq, &len)) != NULL) {
+            uint32_t idx = (uint32_t)(uintptr_t)cookie - 1u;
+            uint32_t n = (len < VCON_RX_BYTES) ? len : VCON_RX_BYTES;
+            p->rx_bytes += n;
+            /* Only hvc0 input goes anywhere; other ports are output channels. */
+            if (p->console || (!v->multiport && i == 0)) {
+                if (n > sizeof(in) - in_len) {
+                    n = (uint32_t)sizeof(in) - in_len;
+                }
+                memcpy(in + in_len, p->rx_page + idx * VCON_RX_BYTES, n);
+                in_len += n;
+            }
+            vcon_post_rx_locked(&p->rxq, p->rx_page, VCON_RX_BYTES, idx);
+            reposted = true;
+        }
+        if (reposted) {
+            virtqueue_kick(&p->rxq);
+        }
+        vcon_tx_reclaim_locked(p);
+    }
+    spinlock_unlock_irqrestore(&v->lock, irql);
+    for (uint32_t i = 0; i < in_len; i++) {
+        input_push_char((in[i] == '\r') ? (uint8_t)'\n' : in[i]);
+    }
+}
+
+static void vcon_irq(virtio_dev_t* vdev)
+{
+    (void)vdev;
+    if (g_vcond) {
+        (void)waitq_wake_one(&g_vcond_wq);
+    }
+}
+
+static void vcond_main(void* arg)
+{
+    vcon_t* v = (vcon_t*)arg;
+    for (;;) {
+        (void)waitq_wait(&g_vcond_wq, VCON_POLL_MS);
+        vcon_service(v);
+    }
+}
+
+/* ============================================================================
+ * Bring-up
+ * ============================================================================ */
+
+static int vcon_port_init(vcon_t* v, uint32_t id)
+{
+    vcon_port_t* p = &v->ports[id];
+    memset(p, 0, sizeof(*p));
+    p->id = id;
+    p->tx_fill = -1;
+    /* Port 0 uses queues 0/1; port n > 0 uses 2n + 2 / 2n + 3 (2/3 are control). */
+    uint16_t rxq = (uint16_t)((id == 0) ? 0u : 2u * id + 2u);
+    int rc = virtqueue_setup(&v->vdev, &p->rxq, rxq, 16);
+    if (rc == RDNX_OK) {
+        rc = virtqueue_setup(&v->vdev, &p->txq, (uint16_t)(rxq + 1u), 16);
+    }
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    p->rx_page = (uint8_t*)vmm_alloc_page(PAGE_FLAG_WRITABLE);
+    p->tx_pages = (uint8_t*)vmm_alloc_pages(VCON_TX_SLOTS, PAGE_FLAG_WRITABLE);
+    if (!p->rx_page || !p->tx_pages) {
+        return RDNX_E_NOMEM;
+    }
+    p->tx_free = (1u << VCON_TX_SLOTS) - 1u;
+    for (uint32_t i = 0; i < VCON_RX_BUFS; i++) {
+        vcon_post_rx_locked(&p->rxq, p->rx_page, VCON_RX_BYTES, i);
+    }
+    return RDNX_OK;
+}
+
+static int vcon_init(vcon_t* v, fabric_device_t* dev)
+{
+    int rc = virtio_pci_init(&v->vdev, dev);
+    if (rc == RDNX_OK) {
+        rc = virtio_negotiate(&v->vdev, 1ULL << VIRTIO_CONSOLE_F_MULTIPORT);
+    }
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    v->vdev.priv = v;
+    v->multiport = virtio_has_feature(&v->vdev, VIRTIO_CONSOLE_F_MULTIPORT);
+    v->nports = 1;
+    if (v->multiport) {
+        uint32_t max = virtio_cfg_read32(&v->vdev, VCON_CFG_MAX_NR_PORTS);
+        v->nports = (max == 0) ? 1u : (max < VCON_PORT_MAX ? max : VCON_PORT_MAX);
+    }
+    virtio_setup_irq(&v->vdev, vcon_irq);
+
+    rc = vcon_port_init(v, 0);
+    if (rc == RDNX_OK && v->multiport) {
+        rc = virtqueue_setup(&v->vdev, &v->ctrl_rxq, 2, 32);
+        if (rc == RDNX_OK) {
+            rc = virtqueue_setup(&v->vdev, &v->ctrl_txq, 3, 32);
+        }
+        v->ctrl_rx_page = (uint8_t*)vmm_alloc_page(PAGE_FLAG_WRITABLE);
+        v->ctrl_tx = (vcon_ctrl_msg_t*)vmm_alloc_page(PAGE_FLAG_WRITABLE);
+        if (rc == RDNX_OK && (!v->ctrl_rx_page || !v->ctrl_tx)) {
+            rc = RDNX_E_NOMEM;
+        }
+        v->ctrl_tx_free = (1u << VCON_CTRL_TX_SLOTS) - 1u;
+        for (uint32_t i = 0; rc == RDNX_OK && i < VCON_CTRL_RX_BUFS; i++) {
+            vcon_post_rx_locked(&v->ctrl_rxq, v->ctrl_rx_page, VCON_CTRL_BYTES, i);
+        }
+        for (uint32_t id = 1; rc == RDNX_OK && id < v->nports; id++) {
+            rc = vcon_port_init(v, id);
+        }
+    }
+    if (rc != RDNX_OK) {
+        virtio_fail(&v->vdev);
+        return rc;
+    }
+    virtio_driver_ok(&v->vdev);
+
+    irql_t irql = spinlock_lock_irqsave(&v->lock);
+    if (v->multiport) {
+        virtqueue_kick(&v->ctrl_rxq);
+    } else {
+        /* Single-port devices have no handshake: port 0 is the console. */
+        v->ports[0].present = true;
+        v->ports[0].console = true;
+        v->ports[0].host_open = true;
+        memcpy(v->ports[0].name, "hvc0", 5);
+    }
+    for (uint32_t i = 0; i < v->nports; i++) {
+        virtqueue_kick(&v->ports[i].rxq);
+    }
+    vcon_send_ctrl_locked(v, 0, VCON_DEVICE_READY, 1);
+    spinlock_unlock_irqrestore(&v->lock, irql);
+    return RDNX_OK;
+}
+
+static bool virtio_console_probe(fabric_device_t* dev)
+{
+    return virtio_pci_device_type(dev) == VIRTIO_ID_CONSOLE;
+}
+
+static int virtio_console_attach(fabric_device_t* dev)
+{
+    vcon_t* v = &g_vcon;
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    if (v->used) {
+        return RDNX_E_BUSY;
+    }
+    memset(v, 0, sizeof(*v));
+    v->used = 1;
+    spinlock_init(&v->lock);
+    int rc = vcon_init(v, dev);
+    if (rc != RDNX_OK) {
+        fabric_log("[VCON] init failed rc=%d\n", rc);
+        return RDNX_OK;
+    }
+    /* The device answers DEVICE_READY with DEVICE_ADD/CONSOLE_PORT/PORT_NAME. */
+    for (uint32_t ms = 0; v->multiport && ms < VCON_HANDSHAKE_MS; ms++) {
+        vcon_service(v);
+        virtio_udelay(1000);
+    }
+    v->present = 1;
+    (void)console_register_sink(&g_vcon_sink);
+
+    fabric_log("[VCON] attached vendor=%x device=%x ports=%u multiport=%u %s\n",
+               dev->vendor_id, dev->device_id, v->nports, v->multiport ? 1u : 0u,
+               (v->vdev.vector >= 0) ? "msix" : "polled");
+    for (uint32_t i = 0; i < v->nports; i++) {
+        vcon_port_t* p = &v->ports[i];
+        if (p->present) {
+            fabric_log("[VCON] port %u %s%s%s\n", i, p->name[0] ? p->name : "(unnamed)",
+                       p->console ? " console" : "", p->log ? " log" : "");
+        }
+    }
+    return RDNX_OK;
+}
+
+static int virtio_console_publish(fabric_device_t* dev)
+{
+    vcon_t* v = &g_vcon;
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    if (!v->present || v->vdev.pci != dev) {
+        return RDNX_E_NOTFOUND;
+    }
+    for (uint32_t i = 0; i < v->nports; i++) {
+        vcon_port_t* p = &v->ports[i];
+        if (p->present && p->name[0] &&
+            fabric_publish_service_node(p->name, "console", dev) != RDNX_OK) {
+            return RDNX_E_GENERIC;
+        }
+    }
+    return RDNX_OK;
+}
+
+static void virtio_console_detach(fabric_device_t* dev)
+{
+    (void)dev;
+}
+
+static fabric_driver_t g_driver = {
+    .name = "virtio-console",
+    .probe = virtio_console_probe,
+    .attach = virtio_console_attach,
+    .publish = virtio_console_publish,
+    .detach = virtio_console_detach,
+    .suspend = NULL,
+    .resume = NULL
+};
+
+void virtio_console_init(void)
+{
+    int rc = fabric_driver_register(&g_driver);
+    if (rc == 0) {
+        kputs("[VCON] driver registered\n");
+    } else {
+        kputs("[VCON] driver register failed\n");
+    }
+}
+
+/* Start vcond once the scheduler runs; called from kernel main after rcu_start(). */
+void virtio_console_start(void)
+{
+    if (g_vcond || !g_vcon.present) {
+        return;
+    }
+    task_t* kernel_task = task_get_current();
+    if (!kernel_task) {
+        return;
+    }
+    waitq_init(&g_vcond_wq, "vcond");
+    thread_t* t = thread_create(kernel_task, vcond_main, &g_vcon);
+    if (!t) {
+        return;
+    }
+    scheduler_set_bucket(t, SCHED_BUCKET_UTILITY);
+    g_vcond = t;
+    scheduler_add_thread(t);
+}
@@ -0,0 +1,189 @@
+/**
+ * @file virtio_rng.c
+ * @brief Fabric virtio-rng driver: hardware entropy for the kernel pool
+ *
+ * The device has a single request queue; every device-writable buffer
+ * comes back filled with random bytes. The driver keeps at most one
+ * VRNG_BUF_BYTES request in flight. It is registered as a pool source:
+ * the pool pulls while unseeded and on its reseed interval, and each
+ * completion is hashed into the pool with full credit. Attach waits a
+ * bounded time for the first completion so the pool is seeded before
+ * userland starts.
+ */
+
+#include "virtio.h"
+#include "../../../kernel/fabric/fabric.h"
+#include "../../../kernel/fabric/driver/driver.h"
+#include "../../../kernel/fabric/spin.h"
+#include "../../../kernel/common/random.h"
+#include "../../../kernel/core/memory.h"
+#include "../../../kernel/arch/config.h"
+#include "../../../include/common.h"
+#include "../../../include/console.h"
+#include "../../../include/error.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VRNG_MAX               2u
+#define VRNG_BUF_BYTES         64u
+#define VRNG_SEED_WAIT_MS      200u
+
+typedef struct vrng {
+    int used;
+    int present;
+    char name[8];               /* "vrng<N>" */
+    virtio_dev_t vdev;
+    virtqueue_t vq;
+    spinlock_t lock;
+    uint8_t* buf;               /* one physmap page */
+    bool busy;                  /* request in flight */
+    uint64_t bytes;
+} vrng_t;
+
+static vrng_t g_vrng[VRNG_MAX];
+
+/*
+ * Reap a completion into the pool and, when asked, post a new request.
+ * Safe from the interrupt handler and from pool pulls.
+ */
+static void vrng_service(vrng_t* r, bool request)
+{
+    uint8_t data[VRNG_BUF_BYTES];
+    uint32_t got = 0;
+    irql_t irql = spinlock_lock_irqsave(&r->lock);
+    uint32_t len = 0;
+    while (virtqueue_get(&r->vq, &len)) {
+        r->busy = false;
+        got = (len < VRNG_BUF_BYTES) ? len : VRNG_BUF_BYTES;
+        memcpy(data, r->buf, got);
+        r->bytes += got;
+    }
+    if (request && !r->busy) {
+        virtio_sg_t sg = { (uint64_t)ARCH_VIRT_TO_PHYS(r->buf), VRNG_BUF_BYTES };
+        if (virtqueue_add(&r->vq, &sg, 0, 1, r) == RDNX_OK) {
+            r->busy = true;
+            virtqueue_kick(&r->vq);
+        }
+    }
+    spinlock_unlock_irqrestore(&r->lock, irql);
+    if (got > 0) {
+        random_add_entropy(data, got, got * 8u);
+        memset(data, 0, sizeof(data));
+    }
+}
+
+static void vrng_irq(virtio_dev_t* vdev)
+{
+    vrng_t* r = (vrng_t*)vdev->priv;
+    /* Keep the request loop going only until the pool is seeded. */
+    vrng_service(r, !random_is_seeded());
+}
+
+static void vrng_pull(void* ctx)
+{
+    vrng_service((vrng_t*)ctx, true);
+}
+
+static bool virtio_rng_probe(fabric_device_t* dev)
+{
+    return virtio_pci_device_type(dev) == VIRTIO_ID_RNG;
+}
+
+static int vrng_init(vrng_t* r, fabric_device_t* dev)
+{
+    int rc = virtio_pci_init(&r->vdev, dev);
+    if (rc == RDNX_OK) {
+        rc = virtio_negotiate(&r->vdev, 0);
+    }
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    r->vdev.priv = r;
+    virtio_setup_irq(&r->vdev, vrng_irq);
+    rc = virtqueue_setup(&r->vdev, &r->vq, 0, 8);
+    if (rc == RDNX_OK) {
+        r->buf = (uint8_t*)vmm_alloc_page(PAGE_FLAG_WRITABLE);
+        rc = r->buf ? RDNX_OK : RDNX_E_NOMEM;
+    }
+    if (rc != RDNX_OK) {
+        virtio_fail(&r->vdev);
+        return rc;
+    }
+    virtio_driver_ok(&r->vdev);
+    return RDNX_OK;
+}
+
+static int virtio_rng_attach(fabric_device_t* dev)
+{
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    for (uint32_t i = 0; i < VRNG_MAX; i++) {
+        vrng_t* r = &g_vrng[i];
+        if (r->used) {
+            continue;
+        }
+        memset(r, 0, sizeof(*r));
+        r->used = 1;
+        memcpy(r->name, "vrng0", 6);
+        r->name[4] = (char)('0' + i);
+        spinlock_init(&r->lock);
+
+        int rc = vrng_init(r, dev);
+        if (rc != RDNX_OK) {
+            fabric_log("[VRNG] %s: init failed rc=%d\n", r->name, rc);
+            return RDNX_OK;
+        }
+        r->present = 1;
+        (void)random_register_source(r->name, vrng_pull, r);
+        /* Interrupts may not be delivered yet: poll for the first batch. */
+        for (uint32_t ms = 0; ms < VRNG_SEED_WAIT_MS && !random_is_seeded(); ms++) {
+            vrng_service(r, true);
+            virtio_udelay(1000);
+        }
+        fabric_log("[VRNG] attached %s vendor=%x device=%x %s seeded=%u\n",
+                   r->name, dev->vendor_id, dev->device_id,
+                   (r->vdev.vector >= 0) ? "msix" : "polled",
+                   random_is_seeded() ? 1u : 0u);
+        return RDNX_OK;
+    }
+    return RDNX_E_BUSY;
+}
+
+static int virtio_rng_publish(fabric_device_t* dev)
+{
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    for (uint32_t i = 0; i < VRNG_MAX; i++) {
+        if (g_vrng[i].present && g_vrng[i].vdev.pci == dev) {
+            return fabric_publish_service_node(g_vrng[i].name, "rng", dev);
+        }
+    }
+    return RDNX_E_NOTFOUND;
+}
+
+static void virtio_rng_detach(fabric_device_t* dev)
+{
+    (void)dev;
+}
+
+static fabric_driver_t g_driver = {
+    .name = "virtio-rng",
+    .probe = virtio_rng_probe,
+    .attach = virtio_rng_attach,
+    .publish = virtio_rng_publish,
+    .detach = virtio_rng_detach,
+    .suspend = NULL,
+    .resume = NULL
+};
+
+void virtio_rng_init(void)
+{
+    int rc = fabric_driver_register(&g_driver);
+    if (rc == 0) {
+        kputs("[VRNG] driver registered\n");
+    } else {
+        kputs("[VRNG] driver register failed\n");
+    }
+}
@@ -117,8 +117,12 @@ int memcmp(const void* ptr1, const void* ptr2, size_t size);
  * Utility macros
  * ============================================================================ */
 
+#ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
 #define ABS(x) ((x) < 0 ? -(x) : (x))
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
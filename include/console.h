@@ -125,6 +125,31 @@ void console_set_bg_color(uint8_t color);
  */
 void console_reset_color(void);
 
+/**
+ * Write raw bytes to the serial port only (no VGA, no log prefix);
+ * "\n" becomes "\r\n". For bulk machine-readable output such as
+ * profile dumps.
+ */
+void console_serial_write(const char* buf, size_t len);
+
+/**
+ * Additional console output device. write() gets every byte that goes to
+ * the serial port, untranslated; flush() marks the end of a kputs/kprintf
+ * or console_write. Both may run in interrupt context or from a fault
+ * handler: they must not block, sleep or print.
+ */
+typedef struct console_sink {
+    void (*write)(const char* buf, size_t len);
+    void (*flush)(void);
+} console_sink_t;
+
+int console_register_sink(const console_sink_t* sink);
+
+/**
+ * Write len bytes as kputc() would, flushing sinks once at the end.
+ */
+void console_write(const char* buf, size_t len);
+
 /* Log prefix control */
 void console_set_log_prefix_enabled(bool enabled);
 
@@ -6,6 +6,9 @@
 #define KMOD_IMAGE_MAGIC "RDKMOD1"
 #define KMOD_IMAGE_MAGIC_LEN 7u
 
+#define KMOD_NAME_MAX     32u
+#define KMOD_SYM_NAME_MAX 60u
+
 typedef struct kmod_image_header {
     char magic[8];
     char name[32];
@@ -17,4 +20,41 @@ typedef struct kmod_image_header {
     uint32_t reserved1;
 } kmod_image_header_t;
 
+/*
+ * Exported symbol, one per EXPORT_SYMBOL() in section .kmod_ksymtab. The
+ * kernel's table sits between __kmod_ksymtab_start/__kmod_ksymtab_end;
+ * a module's table is read from its own .kmod_ksymtab after relocation.
+ * crc is the symbol version: CRC-32 of the normalised C declaration,
+ * generated into KSYMCRC_<sym> by scripts/mkksymvers.py.
+ */
+typedef struct kmod_symbol {
+    const char* name;
+    const void* addr;
+    uint32_t crc;
+    uint32_t reserved;
+} kmod_symbol_t;
+
+/*
+ * Version of every symbol a module imports, section .rodnix_versions.
+ * scripts/kmodpost.py generates these from the module's undefined symbols;
+ * the loader refuses to bind a symbol whose export carries another CRC.
+ */
+typedef struct kmod_modversion {
+    uint32_t crc;
+    char name[KMOD_SYM_NAME_MAX];
+} kmod_modversion_t;
+
+/* Module this one imports from, section .rodnix_deps (also from kmodpost). */
+typedef struct kmod_dep {
+    char name[KMOD_NAME_MAX];
+} kmod_dep_t;
+
+/* KSYMCRC_<sym> comes from the symvers header of the exporting side. */
+#define EXPORT_SYMBOL(sym)                                                     \
+    static const char __kstrtab_##sym[] = #sym;                                \
+    __attribute__((used, section(".kmod_ksymtab"), aligned(8)))                \
+    static const kmod_symbol_t __ksymtab_##sym = {                             \
+        __kstrtab_##sym, (const void*)&sym, KSYMCRC_##sym, 0u                  \
+    }
+
 #endif /* _RODNIX_KMOD_ABI_H */
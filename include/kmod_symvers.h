@@ -0,0 +1,30 @@
+/* Auto-generated by scripts/mkksymvers.py from kernel EXPORT_SYMBOL()s. Do not edit. */
+#ifndef _RODNIX_KMOD_SYMVERS_H
+#define _RODNIX_KMOD_SYMVERS_H
+
+/* void*kcalloc(size_t count,size_t size) */
+#define KSYMCRC_kcalloc 0x95e1382fu
+/* void kfree(void*ptr) */
+#define KSYMCRC_kfree 0x708c9e07u
+/* void*kmalloc(size_t size) */
+#define KSYMCRC_kmalloc 0xe78814c3u
+/* void kprintf(const char*fmt,...) */
+#define KSYMCRC_kprintf 0x06160aa0u
+/* void kputc(char c) */
+#define KSYMCRC_kputc 0x091ca8cfu
+/* void kputs(const char*str) */
+#define KSYMCRC_kputs 0x6566adc7u
+/* int memcmp(const void*ptr1,const void*ptr2,size_t size) */
+#define KSYMCRC_memcmp 0xac47c2d2u
+/* void*memcpy(void*dest,const void*src,size_t size) */
+#define KSYMCRC_memcpy 0x13b8bd7cu
+/* void*memset(void*ptr,int value,size_t size) */
+#define KSYMCRC_memset 0xa2e6e895u
+/* int strcmp(const char*s1,const char*s2) */
+#define KSYMCRC_strcmp 0xe1e1dafdu
+/* size_t strlen(const char*str) */
+#define KSYMCRC_strlen 0x243fd372u
+/* char*strncpy(char*dest,const char*src,size_t n) */
+#define KSYMCRC_strncpy 0xc123f01fu
+
+#endif /* _RODNIX_KMOD_SYMVERS_H */
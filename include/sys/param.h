@@ -3,9 +3,16 @@
 
 #include <sys/types.h>
 
+/* Kernel headers may already define these (PAGE_MASK there is ~(PAGE_SIZE - 1)). */
+#ifndef PAGE_SIZE
 #define PAGE_SIZE 4096
+#endif
+#ifndef PAGE_MASK
 #define PAGE_MASK (PAGE_SIZE - 1)
+#endif
+#ifndef PAGE_SHIFT
 #define PAGE_SHIFT 12
+#endif
 
 #ifndef MIN
 #define MIN(_a,_b) ((_a) < (_b) ? (_a) : (_b))
@@ -5,6 +5,18 @@
 #include "../../include/common.h"
 #include "../../include/console.h"
 
+static inline void rodnix_compat_delay(uint32_t us)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    /* A write to the POST port takes about a microsecond on PC hardware. */
+    for (uint32_t i = 0; i < us; i++) {
+        __asm__ volatile ("outb %%al, $0x80" : : "a"(0));
+    }
+#else
+    (void)us;
+#endif
+}
+
 #define bzero(_p,_n) memset((_p), 0, (_n))
 #define bcopy(_s,_d,_n) memmove((_d), (_s), (_n))
 
@@ -12,7 +24,7 @@
 #define device_printf(_dev, _fmt, ...) kprintf(_fmt, ##__VA_ARGS__)
 
 #define panic(_fmt, ...) kprintf("panic: " _fmt "\n", ##__VA_ARGS__)
-#define DELAY(_us) do { (void)(_us); } while (0)
+#define DELAY(_us) rodnix_compat_delay((uint32_t)(_us))
 #define pause(_wchan, _ticks) do { (void)(_wchan); (void)(_ticks); } while (0)
 
 #ifndef min
@@ -22,6 +34,8 @@
 #define max(_a,_b) ((_a) > (_b) ? (_a) : (_b))
 #endif
 
-#define KASSERT(_cond, _msg) do { if (!(_cond)) { kprintf("KASSERT: %s\n", (_msg)); } } while (0)
+/* _msg is a parenthesized printf argument list, as in FreeBSD. */
+#define KASSERT(_cond, _msg) \
+    do { if (!(_cond)) { kprintf("KASSERT: "); kprintf _msg; kprintf("\n"); } } while (0)
 
 #endif
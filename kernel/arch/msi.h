@@ -0,0 +1,15 @@
+/**
+ * @file arch/msi.h
+ * @brief Common entry point for message-signalled interrupt helpers.
+ */
+
+#ifndef _RODNIX_ARCH_MSI_H
+#define _RODNIX_ARCH_MSI_H
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include "x86_64/msi.h"
+#else
+#error "MSI interface is not wired for this target yet"
+#endif
+
+#endif /* _RODNIX_ARCH_MSI_H */
@@ -379,3 +379,37 @@ uint64_t cpu_get_time(void)
     __asm__ volatile ("rdtsc" : "=a"(eax), "=d"(edx));
     return ((uint64_t)edx << 32) | eax;
 }
+
+/* CPUID.1:ECX.RDRAND[bit 30], CPUID.7.0:EBX.RDSEED[bit 18]. */
+#define CPU_FEATURE_ECX_RDRAND (1u << 30)
+#define CPU_FEATURE_EBX7_RDSEED (1u << 18)
+/* Both instructions may transiently fail (CF=0); Intel recommends 10 retries. */
+#define CPU_RANDOM_RETRIES 10
+
+bool cpu_get_random(uint64_t* out, bool seed)
+{
+    if (!out || !cpu_initialized) {
+        return false;
+    }
+    if (seed ? !(cpu_info_cache.ext_features_ebx & CPU_FEATURE_EBX7_RDSEED)
+             : !(cpu_info_cache.features_ecx & CPU_FEATURE_ECX_RDRAND)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < CPU_RANDOM_RETRIES; i++) {
+        uint64_t v;
+        uint8_t ok;
+        if (seed) {
+            __asm__ volatile ("rdseed %0; setc %1" : "=r"(v), "=qm"(ok) : : "cc");
+        } else {
+            __asm__ volatile ("rdrand %0; setc %1" : "=r"(v), "=qm"(ok) : : "cc");
+        }
+        if (ok) {
+            *out = v;
+            return true;
+        }
+        if (seed) {
+            cpu_pause();
+        }
+    }
+    return false;
+}
@@ -61,6 +61,7 @@ typedef struct {
 
 static gdt_table_t gdt;
 static tss64_t tss;
+static uint8_t nmi_stack[8192] __attribute__((aligned(16)));
 uint64_t g_tss_rsp0_shadow = 0;
 
 static void gdt_set_entry(gdt_entry_t* e, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran)
@@ -96,6 +97,7 @@ void gdt_init(void)
     gdt_set_entry(&gdt.ucode, 0, 0, 0xFA, 0xA0);
 
     tss.iomap_base = (uint16_t)sizeof(tss);
+    tss.ist1 = (uint64_t)(uintptr_t)(nmi_stack + sizeof(nmi_stack));
     gdt_set_tss(&gdt.tss, (uint64_t)(uintptr_t)&tss, sizeof(tss) - 1);
 
     gdt_ptr_t gdt_ptr;
@@ -9,6 +9,9 @@
 #define GDT_USER_CS   0x20
 #define GDT_TSS_SEL   0x28
 
+/* IST slot for NMIs: the PMU profiler NMI may hit the SYSCALL entry before it switches stacks. */
+#define GDT_IST_NMI   1
+
 void gdt_init(void);
 void tss_set_rsp0(uint64_t rsp0);
 extern uint64_t g_tss_rsp0_shadow;
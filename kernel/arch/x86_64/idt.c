@@ -10,6 +10,8 @@
 
 #include "types.h"
 #include "config.h"
+#include "gdt.h"
+#include "msi.h"
 #include "../../../include/debug.h"
 #include <stddef.h>
 #include <stdbool.h>
@@ -109,6 +111,23 @@ extern void irq13(void);
 extern void irq14(void);
 extern void irq15(void);
 extern void isr128(void);
+extern void isr129(void);
+extern void msi0(void);
+extern void msi1(void);
+extern void msi2(void);
+extern void msi3(void);
+extern void msi4(void);
+extern void msi5(void);
+extern void msi6(void);
+extern void msi7(void);
+extern void msi8(void);
+extern void msi9(void);
+extern void msi10(void);
+extern void msi11(void);
+extern void msi12(void);
+extern void msi13(void);
+extern void msi14(void);
+extern void msi15(void);
 
 /* ============================================================================
  * Internal Helper Functions
@@ -201,7 +220,7 @@ int idt_init(void)
     __asm__ volatile ("" ::: "memory");
     idt_set_entry(0, (uint64_t)isr0, 0x08, IDT_TYPE_INTERRUPT_GATE, 0);
     idt_set_entry(1, (uint64_t)isr1, 0x08, IDT_TYPE_INTERRUPT_GATE, 0);
-    idt_set_entry(2, (uint64_t)isr2, 0x08, IDT_TYPE_INTERRUPT_GATE, 0);
+    idt_set_entry(2, (uint64_t)isr2, 0x08, IDT_TYPE_INTERRUPT_GATE, GDT_IST_NMI);
     idt_set_entry(3, (uint64_t)isr3, 0x08, IDT_TYPE_INTERRUPT_GATE, 0);
     idt_set_entry(4, (uint64_t)isr4, 0x08, IDT_TYPE_INTERRUPT_GATE, 0);
     idt_set_entry(5, (uint64_t)isr5, 0x08, IDT_TYPE_INTERRUPT_GATE, 0);
@@ -259,6 +278,21 @@ int idt_init(void)
     __asm__ volatile ("" ::: "memory");
     idt_set_entry(128, (uint64_t)isr128, 0x08, IDT_TYPE_TRAP_GATE_USER, 0);
     __asm__ volatile ("" ::: "memory");
+
+    /* Step 4.2: Reschedule vector for preemption points (0x81, kernel only) */
+    idt_set_entry(129, (uint64_t)isr129, 0x08, IDT_TYPE_INTERRUPT_GATE, 0);
+
+    /* Step 4.3: MSI/MSI-X vectors (msi.h) */
+    {
+        static void (* const msi_stubs[MSI_VECTOR_COUNT])(void) = {
+            msi0, msi1, msi2, msi3, msi4, msi5, msi6, msi7,
+            msi8, msi9, msi10, msi11, msi12, msi13, msi14, msi15
+        };
+        for (uint32_t i = 0; i < MSI_VECTOR_COUNT; i++) {
+            idt_set_entry((uint8_t)(MSI_VECTOR_BASE + i), (uint64_t)msi_stubs[i], 0x08,
+                          IDT_TYPE_INTERRUPT_GATE, 0);
+        }
+    }
     
     /* Step 5: Load IDT */
     kputs("[IDT-5] Load IDT\n");
@@ -15,6 +15,7 @@
 #include "pic.h"
 #include "apic.h"
 #include "interrupt_frame.h"
+#include "../../common/lattrace.h"
 #include <stddef.h>
 #include <stdbool.h>
 
@@ -241,11 +242,17 @@ irql_t set_irql(irql_t new_level)
     
     /* Enable interrupts only at PASSIVE level */
     if (new_level == IRQL_PASSIVE) {
+        if (old_level != IRQL_PASSIVE) {
+            lattrace_section_end(LAT_IRQSOFF);
+        }
         __asm__ volatile ("sti");
         __asm__ volatile ("" ::: "memory"); /* Memory barrier */
     } else {
         __asm__ volatile ("cli");
         __asm__ volatile ("" ::: "memory"); /* Memory barrier */
+        if (old_level == IRQL_PASSIVE) {
+            lattrace_section_begin(LAT_IRQSOFF, (uintptr_t)__builtin_return_address(0));
+        }
     }
     
     return old_level;
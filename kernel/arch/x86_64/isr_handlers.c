@@ -16,6 +16,12 @@
 #include "../../common/scheduler.h"
 #include "../../common/syscall.h"
 #include "../../common/tracev2.h"
+#include "../../common/rusage.h"
+#include "../../common/cgroup.h"
+#include "../../common/prof.h"
+#include "../../common/rcu.h"
+#include "../../common/preempt.h"
+#include "../../common/random.h"
 #include "../../linux/linux_compat.h"
 #include "../../core/task.h"
 #include "../../vm/vm_fault.h"
@@ -24,6 +30,7 @@
 #include "config.h"
 #include "pic.h"
 #include "apic.h"
+#include "msi.h"
 #include "syscall_fast.h"
 #include <stddef.h>
 
@@ -234,6 +241,16 @@ static interrupt_frame_t* interrupt_dispatch(interrupt_frame_t* regs)
     if (vector == SYSCALL_VECTOR) {
         return handle_syscall(regs);
     }
+
+    /* preempt_enable()/cond_resched(): switch without charging a tick. */
+    if (vector == PREEMPT_RESCHED_VECTOR) {
+        return scheduler_switch_from_irq(regs);
+    }
+
+    /* Profiler counter overflow (PMI delivered as NMI); other NMIs fall through. */
+    if (vector == 2 && prof_nmi(regs)) {
+        return regs;
+    }
     
     /* Handle IRQ (32-47) - PIC IRQs are mapped to these vectors */
     if (vector >= 32 && vector < 48) {
@@ -246,6 +263,7 @@ static interrupt_frame_t* interrupt_dispatch(interrupt_frame_t* regs)
             return regs;
         }
         
+        preempt_irq_enter();
         /* Call registered handler if available */
         if (interrupt_handlers[vector]) {
             interrupt_context_t ctx;
@@ -271,23 +289,59 @@ static interrupt_frame_t* interrupt_dispatch(interrupt_frame_t* regs)
         }
         
         irq_send_eoi(irq);
+        random_add_interrupt(vector, regs->rip);
         if (vector == 32) {
-            /* Timer tick drives preemption */
+            /* Timer tick drives time slicing */
+            prof_timer_tick(regs);
+            rcu_note_tick();
             scheduler_tick();
-            regs = scheduler_switch_from_irq(regs);
         }
-        return regs;
+        preempt_irq_exit();
+        /*
+         * Preempt at IRQ exit: a thread woken by this IRQ or an expired
+         * quantum switches now unless the interrupted thread has
+         * preemption disabled.
+         */
+        return scheduler_switch_from_irq(regs);
     }
     
+    /* MSI/MSI-X: edge-triggered, no I/O APIC pin to mask, LAPIC EOI only. */
+    if (msi_vector_is_msi(vector)) {
+        preempt_irq_enter();
+        if (interrupt_handlers[vector]) {
+            interrupt_context_t ctx;
+            ctx.pc = regs->rip;
+            ctx.sp = 0;
+            ctx.flags = regs->rflags;
+            ctx.error_code = regs->err_code;
+            ctx.vector = vector;
+            ctx.type = INTERRUPT_TYPE_IRQ;
+            ctx.arch_specific = (void*)regs;
+            interrupt_handlers[vector](&ctx);
+        }
+        apic_send_eoi();
+        random_add_interrupt(vector, regs->rip);
+        preempt_irq_exit();
+        return scheduler_switch_from_irq(regs);
+    }
+
     /* Handle exception (0-31) */
     if (vector < 32) {
         if (vector == 14) {
             uint64_t cr2 = 0;
             __asm__ volatile ("mov %%cr2, %0" : "=r"(cr2));
             task_t* task = task_get_current();
-            if (vm_fault_handle(task, cr2, regs->err_code, regs->rip) == RDNX_OK) {
+            thread_t* thr = ((regs->cs & 3u) != 0) ? thread_get_current() : NULL;
+            rusage_kernel_enter(thr);
+            int fault_rc = vm_fault_handle(task, cr2, regs->err_code, regs->rip);
+            rusage_kernel_exit(thr);
+            if (fault_rc == RDNX_OK) {
                 return regs;
             }
+            if (fault_rc == RDNX_E_NOMEM && thr) {
+                /* memory.max or the PMM is exhausted: kill the faulting task. */
+                cgroup_mem_oom(task);
+            }
             if (task && task_get_abi(task) == TASK_ABI_LINUX) {
                 linux_compat_trace_dump_recent();
             }
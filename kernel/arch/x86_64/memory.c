@@ -11,6 +11,7 @@
 #include "../../core/memory.h"
 #include "../../core/boot.h"
 #include "../../common/tracev2.h"
+#include "../../common/kasan.h"
 #include "../../../include/console.h"
 #include "../../../include/debug.h"
 #include "types.h"
@@ -216,6 +217,25 @@ int memory_init(void)
     /* Drop low identity map: lower half becomes user-only */
     paging_disable_identity_map();
 
+#ifdef CONFIG_KASAN
+    /* KASAN shadow for the physmap, itself inside the physmap; before the heap poisons it. */
+    {
+        extern uint64_t pmm_alloc_pages(uint32_t count);
+        extern void pmm_free_pages(uint64_t phys, uint32_t count);
+        uint32_t shadow_pages = (uint32_t)((physmap_max >> KASAN_SHADOW_SHIFT) / PAGE_SIZE);
+        uint64_t shadow_phys = pmm_alloc_pages(shadow_pages);
+        if (shadow_phys && shadow_phys + (uint64_t)shadow_pages * PAGE_SIZE <= physmap_max) {
+            kasan_init(X86_64_PHYS_TO_VIRT(shadow_phys), (uintptr_t)X86_64_PHYS_TO_VIRT(0),
+                       (uintptr_t)X86_64_PHYS_TO_VIRT(physmap_max));
+        } else {
+            if (shadow_phys) {
+                pmm_free_pages(shadow_phys, shadow_pages);
+            }
+            kputs("[KASAN] no shadow inside the physmap, running unchecked\n");
+        }
+    }
+#endif
+
     /* Initialize simple kernel heap */
     extern int heap_init(size_t initial_pages);
     if (heap_init(16) != 0) {
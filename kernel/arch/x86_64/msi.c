@@ -0,0 +1,66 @@
+/**
+ * @file msi.c
+ * @brief MSI/MSI-X vector allocation and message composition
+ *
+ * Vectors MSI_VECTOR_BASE..+MSI_VECTOR_COUNT have their own IDT stubs
+ * (isr_stubs.S) and are dispatched like legacy IRQs, except that the EOI
+ * goes to the local APIC only. Allocation is a lock-free bitmap: drivers
+ * take vectors at attach time and rarely give them back.
+ *
+ * Messages always target the local APIC of the CPU that composes them:
+ * application processors are not brought up, so every queue interrupt
+ * lands on the boot CPU whatever cpu the caller asks for.
+ */
+
+#include "msi.h"
+#include "apic.h"
+#include "../../../include/error.h"
+
+static volatile uint32_t msi_used;
+
+_Static_assert(MSI_VECTOR_COUNT <= 32u, "msi_used is a 32-bit map");
+
+bool msi_is_available(void)
+{
+    return apic_is_available();
+}
+
+int msi_vector_alloc(void)
+{
+    if (!msi_is_available()) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    for (uint32_t i = 0; i < MSI_VECTOR_COUNT; i++) {
+        uint32_t bit = 1u << i;
+        if ((__atomic_fetch_or(&msi_used, bit, __ATOMIC_ACQ_REL) & bit) == 0) {
+            return (int)(MSI_VECTOR_BASE + i);
+        }
+    }
+    return RDNX_E_BUSY;
+}
+
+void msi_vector_free(int vector)
+{
+    if (!msi_vector_is_msi((uint32_t)vector)) {
+        return;
+    }
+    __atomic_fetch_and(&msi_used, ~(1u << ((uint32_t)vector - MSI_VECTOR_BASE)), __ATOMIC_RELEASE);
+}
+
+bool msi_vector_is_msi(uint32_t vector)
+{
+    return vector >= MSI_VECTOR_BASE && vector < MSI_VECTOR_BASE + MSI_VECTOR_COUNT;
+}
+
+int msi_compose(int vector, uint32_t cpu, uint64_t* out_addr, uint32_t* out_data)
+{
+    (void)cpu;
+    if (!out_addr || !out_data || !msi_vector_is_msi((uint32_t)vector)) {
+        return RDNX_E_INVALID;
+    }
+    /* Redirection hint 0, destination mode physical. */
+    *out_addr = (uint64_t)MSI_ADDR_BASE | ((uint64_t)apic_get_lapic_id() << MSI_ADDR_DEST_SHIFT);
+    /* Trigger mode edge, delivery mode fixed. */
+    *out_data = (uint32_t)vector;
+    return RDNX_OK;
+}
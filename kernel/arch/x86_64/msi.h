@@ -0,0 +1,32 @@
+/**
+ * @file msi.h
+ * @brief Message-signalled interrupt vectors (MSI/MSI-X) for x86_64
+ *
+ * A small fixed range of IDT vectors is set aside for MSI/MSI-X. A driver
+ * allocates a vector, hooks it with fabric_request_irq() and programs the
+ * address/data pair from msi_compose() into the device. The dispatcher
+ * sends a local APIC EOI for these vectors; the I/O APIC is not involved.
+ */
+
+#ifndef _RODNIX_ARCH_X86_64_MSI_H
+#define _RODNIX_ARCH_X86_64_MSI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MSI_VECTOR_BASE  0x50u
+#define MSI_VECTOR_COUNT 16u
+
+#define MSI_ADDR_BASE    0xFEE00000u
+#define MSI_ADDR_DEST_SHIFT 12
+
+/* True when message-signalled interrupts can be delivered (local APIC up). */
+bool msi_is_available(void);
+/* Reserve a free MSI vector; negative RDNX_E_* when the range is used up. */
+int msi_vector_alloc(void);
+void msi_vector_free(int vector);
+bool msi_vector_is_msi(uint32_t vector);
+/* Fixed delivery, edge triggered, physical destination = cpu's local APIC. */
+int msi_compose(int vector, uint32_t cpu, uint64_t* out_addr, uint32_t* out_data);
+
+#endif /* _RODNIX_ARCH_X86_64_MSI_H */
@@ -1069,6 +1069,45 @@ uint64_t paging_get_physical_pml4(uint64_t pml4_phys, uint64_t virt)
     return (pte & PTE_ADDR_MASK_4KB) | (virt & PAGE_OFFSET_MASK);
 }
 
+uint64_t paging_pte_clear_bits_pml4(uint64_t pml4_phys, uint64_t virt, uint64_t bits)
+{
+    if (!pml4_phys) {
+        return 0;
+    }
+    uint64_t* pml4 = (uint64_t*)X86_64_PHYS_TO_VIRT(pml4_phys);
+    if (!pml4) {
+        return 0;
+    }
+
+    uint64_t pml4_entry = pml4[paging_get_pml4_index(virt)];
+    if (!(pml4_entry & PTE_PRESENT)) {
+        return 0;
+    }
+    uint64_t* pdpt = paging_get_pdpt(pml4_entry);
+    uint64_t pdpt_entry = pdpt[paging_get_pdpt_index(virt)];
+    if (!(pdpt_entry & PTE_PRESENT)) {
+        return 0;
+    }
+    uint64_t* pd = paging_get_pd(pdpt_entry);
+    uint64_t pd_entry = pd[paging_get_pd_index(virt)];
+    if (!(pd_entry & PTE_PRESENT) || (pd_entry & PTE_SIZE_2MB)) {
+        return 0;
+    }
+    uint64_t* pt = paging_get_pt(pd_entry);
+    uint64_t* ptep = &pt[paging_get_pt_index(virt)];
+    uint64_t pte = *ptep;
+    if (!(pte & PTE_PRESENT)) {
+        return 0;
+    }
+    if (pte & bits) {
+        *ptep = pte & ~bits;
+        if (current_pml4_phys == pml4_phys) {
+            paging_flush_tlb((void*)virt);
+        }
+    }
+    return pte;
+}
+
 /**
  * @function paging_map_page_2mb
  * @brief Map a 2MB page (large page)
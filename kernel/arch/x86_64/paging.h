@@ -36,6 +36,9 @@ int paging_unmap_page_pml4(uint64_t pml4_phys, uint64_t virt);
 uint64_t paging_get_physical(uint64_t virt);
 uint64_t paging_get_physical_pml4(uint64_t pml4_phys, uint64_t virt);
 
+/* Clear bits (e.g. PTE_ACCESSED) in a 4KB user PTE; returns the PTE before the change, 0 if unmapped. */
+uint64_t paging_pte_clear_bits_pml4(uint64_t pml4_phys, uint64_t virt, uint64_t bits);
+
 /* User address space helpers */
 uint64_t paging_create_user_pml4(void);
 int paging_map_page_4kb_pml4(uint64_t pml4_phys, uint64_t virt, uint64_t phys, uint64_t flags);
@@ -15,6 +15,7 @@
 #include "../../../include/debug.h"
 #include "../../../include/error.h"
 #include "../../core/memory.h"
+#include "../../common/kasan.h"
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -851,6 +852,7 @@ uint64_t pmm_alloc_page_in_zone(pmm_zone_t zone)
 
     uint64_t phys = pmm_index_to_page(index);
     pmm_zero_page(phys);
+    kasan_unpoison_pages(X86_64_PHYS_TO_VIRT(phys), 1);
 
     if (index < pmm_state.pages_count) {
         pmm_state.pages[index].state = PMM_PAGE_USED;
@@ -897,6 +899,7 @@ void pmm_free_page(uint64_t phys)
             }
         }
         pmm_freelist_insert(zone, index, 1);
+        kasan_poison_pages(X86_64_PHYS_TO_VIRT(phys), 1);
     }
 }
 
@@ -959,6 +962,7 @@ uint64_t pmm_alloc_pages_in_zone(pmm_zone_t zone, uint32_t count)
             for (uint32_t p = 0; p < count; p++) {
                 pmm_zero_page(phys + (uint64_t)p * PAGE_SIZE);
             }
+            kasan_unpoison_pages(X86_64_PHYS_TO_VIRT(phys), count);
 
             return pmm_index_to_page(start);
         }
@@ -1014,6 +1018,7 @@ uint64_t pmm_alloc_pages_in_zone(pmm_zone_t zone, uint32_t count)
     for (uint32_t p = 0; p < count; p++) {
         pmm_zero_page(phys + (uint64_t)p * PAGE_SIZE);
     }
+    kasan_unpoison_pages(X86_64_PHYS_TO_VIRT(phys), count);
 
     /* Re-sync free-list metadata after bitmap fallback allocation. */
     pmm_rebuild_free_lists();
@@ -0,0 +1,226 @@
+/**
+ * @file pmu.c
+ * @brief x86_64 performance counters and frame-pointer unwinder for the profiler
+ *
+ * Uses Intel architectural performance monitoring (CPUID.0AH, version 2+):
+ * general-purpose counter 0 counts unhalted core cycles and is preloaded
+ * with -period, so its overflow raises a PMI; the LAPIC LVT performance
+ * counter entry delivers the PMI as an NMI, which lets samples land inside
+ * IRQL_HIGH sections too. The CPU masks LVTPC on every PMI, so the ack path
+ * re-arms it together with the counter.
+ *
+ * Stacks are walked through saved rbp chains (kernel and userland are built
+ * with -fno-omit-frame-pointer). A sample taken in the kernel on behalf of a
+ * user thread (syscall, fault, IRQ) also walks the user stack, starting from
+ * the user trap frame at the top of the thread's kernel stack (TSS rsp0):
+ * both the SYSCALL entry and the ring-3 interrupt stubs build the same
+ * interrupt_frame_t there. Every frame read goes through the page
+ * tables of the current CR3 and the kernel direct map instead of
+ * dereferencing the address, so a garbage rbp cannot fault inside the NMI.
+ */
+
+#include "../../common/prof.h"
+#include "../../../include/error.h"
+#include "interrupt_frame.h"
+#include "lapic_access.h"
+#include "lapic_regs.h"
+#include "paging.h"
+#include "config.h"
+#include "gdt.h"
+#include <stddef.h>
+
+#define MSR_PERFEVTSEL0        0x186
+#define MSR_PMC0               0x0C1
+#define MSR_PERF_GLOBAL_STATUS 0x38E
+#define MSR_PERF_GLOBAL_CTRL   0x38F
+#define MSR_PERF_GLOBAL_OVF    0x390
+
+#define EVTSEL_CORE_CYCLES 0x003Cu   /* UnHalted Core Cycles, umask 0 */
+#define EVTSEL_USR (1u << 16)
+#define EVTSEL_OS  (1u << 17)
+#define EVTSEL_INT (1u << 20)
+#define EVTSEL_EN  (1u << 22)
+
+#define LVT_DELIVERY_NMI 0x400u
+#define LVT_MASKED       0x10000u
+
+#define PMU_KERNEL_MIN 0xFFFF800000000000ULL
+#define PMU_USER_MAX   0x0000800000000000ULL
+
+static prof_arch_info_t pmu_info;
+static int pmu_usable = 0;
+static uint64_t pmu_period = 0;
+
+static inline void pmu_cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx)
+{
+    uint32_t a, b, c, d;
+    __asm__ volatile ("cpuid"
+                      : "=a"(a), "=b"(b), "=c"(c), "=d"(d)
+                      : "a"(leaf), "c"(0));
+    *eax = a;
+    *ebx = b;
+    *ecx = c;
+    *edx = d;
+}
+
+static inline uint64_t pmu_rdmsr(uint32_t msr)
+{
+    uint32_t lo;
+    uint32_t hi;
+    __asm__ volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | (uint64_t)lo;
+}
+
+static inline void pmu_wrmsr(uint32_t msr, uint64_t value)
+{
+    uint32_t lo = (uint32_t)(value & 0xFFFFFFFFu);
+    uint32_t hi = (uint32_t)(value >> 32);
+    __asm__ volatile ("wrmsr" : : "a"(lo), "d"(hi), "c"(msr));
+}
+
+int prof_arch_pmu_probe(prof_arch_info_t* out)
+{
+    uint32_t max_leaf, ebx, ecx, edx, eax;
+    pmu_cpuid(0, &max_leaf, &ebx, &ecx, &edx);
+    pmu_info.version = 0;
+    pmu_info.counters = 0;
+    pmu_info.width = 0;
+    pmu_usable = 0;
+    if (max_leaf >= 0x0A) {
+        pmu_cpuid(0x0A, &eax, &ebx, &ecx, &edx);
+        pmu_info.version = eax & 0xFFu;
+        pmu_info.counters = (eax >> 8) & 0xFFu;
+        pmu_info.width = (eax >> 16) & 0xFFu;
+        uint32_t ebx_len = (eax >> 24) & 0xFFu;
+        /* EBX bit 0 set means the core-cycles event is NOT available. */
+        int cycles_ok = ebx_len > 0 && !(ebx & 1u);
+        /* Version 1 has no global control/status MSRs: not worth a second path. */
+        pmu_usable = pmu_info.version >= 2 && pmu_info.counters > 0 && cycles_ok &&
+                     lapic_access_ready();
+    }
+    if (out) {
+        *out = pmu_info;
+        if (!pmu_usable) {
+            out->version = 0;
+        }
+    }
+    return pmu_usable ? RDNX_OK : RDNX_E_UNSUPPORTED;
+}
+
+static void pmu_arm(void)
+{
+    pmu_wrmsr(MSR_PMC0, (uint64_t)(-(int64_t)pmu_period));
+    lapic_access_write(APIC_LVT_PERF, LVT_DELIVERY_NMI);
+}
+
+int prof_arch_pmu_start(uint64_t period)
+{
+    if (!pmu_usable || period == 0 || period > PROF_MAX_PERIOD) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    pmu_period = period;
+    pmu_wrmsr(MSR_PERF_GLOBAL_CTRL, 0);
+    pmu_wrmsr(MSR_PERFEVTSEL0, 0);
+    pmu_wrmsr(MSR_PERF_GLOBAL_OVF, 1);
+    pmu_arm();
+    pmu_wrmsr(MSR_PERFEVTSEL0, EVTSEL_CORE_CYCLES | EVTSEL_USR | EVTSEL_OS | EVTSEL_INT | EVTSEL_EN);
+    pmu_wrmsr(MSR_PERF_GLOBAL_CTRL, 1);
+    return RDNX_OK;
+}
+
+void prof_arch_pmu_stop(void)
+{
+    if (!pmu_usable) {
+        return;
+    }
+    pmu_wrmsr(MSR_PERF_GLOBAL_CTRL, 0);
+    pmu_wrmsr(MSR_PERFEVTSEL0, 0);
+    pmu_wrmsr(MSR_PERF_GLOBAL_OVF, 1);
+    lapic_access_write(APIC_LVT_PERF, LVT_DELIVERY_NMI | LVT_MASKED);
+}
+
+int prof_arch_pmu_ack(void)
+{
+    if (!pmu_usable || !(pmu_rdmsr(MSR_PERF_GLOBAL_STATUS) & 1u)) {
+        return 0;
+    }
+    pmu_arm();
+    pmu_wrmsr(MSR_PERF_GLOBAL_OVF, 1);
+    return 1;
+}
+
+static int pmu_read_word(uint64_t pml4, uint64_t va, uint64_t* out)
+{
+    if (va & 7u) {
+        return 0;
+    }
+    uint64_t phys = paging_get_physical_pml4(pml4, va);
+    if (!phys) {
+        return 0;
+    }
+    *out = *(volatile uint64_t*)X86_64_PHYS_TO_VIRT(phys);
+    return 1;
+}
+
+/* Walk an rbp chain, appending return addresses; stays on one side of the canonical hole. */
+static uint32_t pmu_walk(uint64_t pml4, uint64_t rip, uint64_t rbp, int kernel,
+                         uint64_t* ips, uint32_t max)
+{
+    uint32_t n = 0;
+    if (max == 0) {
+        return 0;
+    }
+    ips[n++] = rip;
+    while (n < max) {
+        if (kernel ? rbp < PMU_KERNEL_MIN : (rbp == 0 || rbp >= PMU_USER_MAX)) {
+            break;
+        }
+        uint64_t next = 0;
+        uint64_t ret = 0;
+        if (!pmu_read_word(pml4, rbp, &next) || !pmu_read_word(pml4, rbp + 8, &ret)) {
+            break;
+        }
+        if (ret == 0 || (kernel ? ret < PMU_KERNEL_MIN : ret >= PMU_USER_MAX)) {
+            break;
+        }
+        ips[n++] = ret;
+        /* Frames grow towards higher addresses while unwinding. */
+        if (next <= rbp) {
+            break;
+        }
+        rbp = next;
+    }
+    return n;
+}
+
+void prof_arch_unwind(const void* arch_frame, prof_sample_t* s)
+{
+    const interrupt_frame_t* f = (const interrupt_frame_t*)arch_frame;
+    uint64_t cr3;
+    __asm__ volatile ("mov %%cr3, %0" : "=r"(cr3));
+    uint64_t pml4 = cr3 & ~0xFFFull;
+
+    if ((f->cs & 3u) == 0) {
+        uint32_t nk = pmu_walk(pml4, f->rip, f->rbp, 1, s->ips, PROF_MAX_DEPTH);
+        s->nr_kernel = (uint16_t)nk;
+        s->nr_user = 0;
+        if (nk >= PROF_MAX_DEPTH || g_tss_rsp0_shadow < PMU_KERNEL_MIN) {
+            return;
+        }
+        uint64_t uf = (g_tss_rsp0_shadow & ~0xFull) - sizeof(interrupt_frame_t);
+        uint64_t ucs = 0, urip = 0, urbp = 0;
+        if (!pmu_read_word(pml4, uf + offsetof(interrupt_frame_t, cs), &ucs) ||
+            !pmu_read_word(pml4, uf + offsetof(interrupt_frame_t, rip), &urip) ||
+            !pmu_read_word(pml4, uf + offsetof(interrupt_frame_t, rbp), &urbp)) {
+            return;
+        }
+        /* Kernel threads have no user frame there: the stale slot fails these checks. */
+        if ((ucs & 3u) != 3u || urip == 0 || urip >= PMU_USER_MAX) {
+            return;
+        }
+        s->nr_user = (uint16_t)pmu_walk(pml4, urip, urbp, 0, &s->ips[nk], PROF_MAX_DEPTH - nk);
+        return;
+    }
+    s->nr_kernel = 0;
+    s->nr_user = (uint16_t)pmu_walk(pml4, f->rip, f->rbp, 0, s->ips, PROF_MAX_DEPTH);
+}
@@ -2,6 +2,9 @@
 #include "interrupt_frame.h"
 #include "../../common/syscall.h"
 #include "../../core/task.h"
+#include "../../common/rusage.h"
+#include "../../common/preempt.h"
+#include "../../common/lattrace.h"
 
 extern void x86_64_syscall_fast_entry(void);
 uint64_t g_syscall_user_rsp_shadow = 0;
@@ -80,10 +83,25 @@ uint64_t x86_64_syscall_dispatch_frame(interrupt_frame_t* frame, int fast_entry)
     cur = thread_get_current();
     prev_arch = NULL;
     if (cur) {
+        rusage_kernel_enter(cur);
         prev_arch = cur->arch_specific;
         cur->arch_specific = frame;
     }
 
+    /*
+     * SFMASK enters with IF=0. Under preempt=full the handler runs with
+     * IRQs on like the int 0x80 trap gate, so it can be preempted; under
+     * preempt=voluntary it keeps IF=0 and is traced as one IRQ-off section
+     * cut at cond_resched().
+     */
+    if (fast_entry) {
+        if (preempt_get_mode() == PREEMPT_MODE_FULL) {
+            __asm__ volatile ("sti" ::: "memory");
+        } else {
+            lattrace_section_begin(LAT_IRQSOFF, (uintptr_t)frame->rip);
+        }
+    }
+
     /* Keep one ABI mapping for both entries: nr=rax, a1..a3=rdi/rsi/rdx, a4..a6=r10/r8/r9. */
     ret = syscall_dispatch(frame->rax,
                            frame->rdi,
@@ -96,6 +114,16 @@ uint64_t x86_64_syscall_dispatch_frame(interrupt_frame_t* frame, int fast_entry)
     if (cur) {
         cur->arch_specific = prev_arch;
     }
+    /* Return to user mode is always a preemption point. */
+    cond_resched();
+    if (cur) {
+        rusage_kernel_exit(cur);
+    }
+    if (fast_entry) {
+        /* SYSRET needs IF=0 until the user stack is back. */
+        __asm__ volatile ("cli" ::: "memory");
+        lattrace_section_end(LAT_IRQSOFF);
+    }
     frame->rax = ret;
     return ret;
 }
@@ -0,0 +1,751 @@
+/**
+ * @file cgroup.c
+ * @brief Hierarchical task groups: CPU weight/quota, memory limit, I/O weight
+ *
+ * Groups live in a fixed table; slot 0 is the root and is never limited.
+ * A group stays allocated while anything references it (attached tasks,
+ * vm_maps and inodes holding memory charges, child groups), so cgdestroy
+ * only unlinks it from the namespace.
+ *
+ * CPU: QoS buckets stay strictly ordered; inside a bucket the run queue
+ * picks the thread whose group lags furthest behind its weighted share
+ * (per-level virtual runtime, tasks attached directly to a group compete
+ * with its children at weight 100). A quota throttles the group and all its
+ * descendants until the next period once it has run cpu_quota_ticks.
+ *
+ * I/O: the block layer charges bytes to the caller's group; the syscall
+ * path then delays a group that is ahead of an active sibling, which turns
+ * io_weight into a proportional share of device throughput.
+ */
+
+#include "cgroup.h"
+#include "scheduler.h"
+#include "../core/interrupts.h"
+#include "../fabric/spin.h"
+#include "../unix/unix_layer.h"
+#include "../../include/common.h"
+#include "../../include/console.h"
+#include "../../include/error.h"
+#include <stddef.h>
+
+#define CGROUP_TICK_US ((uint64_t)SCHEDULER_TIME_SLICE_MS * 1000ULL)
+#define CGROUP_PERIOD_MAX_US 1000000ULL
+#define CGROUP_VSCALE ((uint64_t)CGROUP_WEIGHT_DEFAULT * 1024ULL)
+#define CGROUP_IDLE_TICKS 10ULL             /* not charged for this long = idle */
+#define CGROUP_CPU_SLACK (2ULL * 1024ULL)   /* two ticks at the default weight */
+#define CGROUP_IO_SECTOR 512ULL
+#define CGROUP_IO_SLACK (512ULL * 1024ULL)  /* 256 KiB at the default weight */
+#define CGROUP_IO_MAX_DELAY_TICKS 20u
+#define CGROUP_PAGE_SIZE 4096ULL
+#define CGROUP_SIGKILL 9u
+
+static cgroup_t cgroup_table[CGROUP_MAX];
+static int cgroup_inited = 0;
+static uint32_t cgroup_nr_used = 0;
+static uint32_t cgroup_nr_quota = 0;
+
+static spinlock_t cgroup_spin;
+
+static inline irql_t cgroup_lock(void)
+{
+    return spinlock_lock_irqsave(&cgroup_spin);
+}
+
+static inline void cgroup_unlock(irql_t old)
+{
+    spinlock_unlock_irqrestore(&cgroup_spin, old);
+}
+
+static uint64_t cgroup_us_to_ticks(uint64_t us)
+{
+    uint64_t ticks = (us + CGROUP_TICK_US - 1u) / CGROUP_TICK_US;
+    return ticks ? ticks : 1u;
+}
+
+static void cgroup_init_slot(cgroup_t* cg, uint32_t id)
+{
+    memset(cg, 0, sizeof(*cg));
+    cg->id = id;
+    cg->used = 1;
+    cg->refs = 1; /* namespace reference, dropped by cgroup_destroy */
+    cg->cpu_weight = CGROUP_WEIGHT_DEFAULT;
+    cg->cpu_period_ticks = cgroup_us_to_ticks(CGROUP_PERIOD_DEFAULT_US);
+    cg->mem_max_pages = CGROUP_UNLIMITED;
+    cg->io_weight = CGROUP_WEIGHT_DEFAULT;
+}
+
+static void cgroup_init_once(void)
+{
+    if (cgroup_inited) {
+        return;
+    }
+    memset(cgroup_table, 0, sizeof(cgroup_table));
+    cgroup_init_slot(&cgroup_table[0], CGROUP_ROOT_ID);
+    cgroup_table[0].name[0] = '/';
+    cgroup_nr_used = 1;
+    cgroup_nr_quota = 0;
+    cgroup_inited = 1;
+}
+
+cgroup_t* cgroup_root(void)
+{
+    cgroup_init_once();
+    return &cgroup_table[0];
+}
+
+cgroup_t* cgroup_of(const task_t* task)
+{
+    if (task && task->cgroup) {
+        return task->cgroup;
+    }
+    return cgroup_root();
+}
+
+static cgroup_t* cgroup_lookup(uint32_t id)
+{
+    cgroup_init_once();
+    if (id >= CGROUP_MAX || !cgroup_table[id].used) {
+        return NULL;
+    }
+    return &cgroup_table[id];
+}
+
+void cgroup_get(cgroup_t* cg)
+{
+    if (!cg) {
+        return;
+    }
+    irql_t old = cgroup_lock();
+    cg->refs++;
+    cgroup_unlock(old);
+}
+
+void cgroup_put(cgroup_t* cg)
+{
+    if (!cg) {
+        return;
+    }
+    irql_t old = cgroup_lock();
+    while (cg) {
+        if (cg->refs > 0) {
+            cg->refs--;
+        }
+        if (cg->refs != 0 || !cg->dying || cg->id == CGROUP_ROOT_ID) {
+            break;
+        }
+        /* Last reference to an unlinked group: free the slot, drop the parent. */
+        cgroup_t* parent = cg->parent;
+        if (cg->cpu_quota_ticks && cgroup_nr_quota > 0) {
+            cgroup_nr_quota--;
+        }
+        if (parent && parent->nr_children > 0) {
+            parent->nr_children--;
+        }
+        memset(cg, 0, sizeof(*cg));
+        if (cgroup_nr_used > 0) {
+            cgroup_nr_used--;
+        }
+        cg = parent;
+    }
+    cgroup_unlock(old);
+}
+
+/* ============================================================================
+ * Namespace
+ * ============================================================================ */
+
+static int cgroup_name_ok(const char* name)
+{
+    if (!name || !name[0]) {
+        return 0;
+    }
+    size_t len = 0;
+    for (; name[len]; len++) {
+        char c = name[len];
+        int ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                 (c >= '0' && c <= '9') || c == '.' || c == '_' || c == '-';
+        if (!ok || len + 1 >= CGROUP_NAME_MAX) {
+            return 0;
+        }
+    }
+    return !(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')));
+}
+
+int cgroup_create(uint32_t parent_id, const char* name, uint32_t* out_id)
+{
+    if (!cgroup_name_ok(name)) {
+        return RDNX_E_INVALID;
+    }
+    irql_t old = cgroup_lock();
+    cgroup_t* parent = cgroup_lookup(parent_id);
+    if (!parent || parent->dying) {
+        cgroup_unlock(old);
+        return RDNX_E_NOTFOUND;
+    }
+    if (parent->depth + 1u > CGROUP_DEPTH_MAX) {
+        cgroup_unlock(old);
+        return RDNX_E_INVALID;
+    }
+    cgroup_t* slot = NULL;
+    for (uint32_t i = 1; i < CGROUP_MAX; i++) {
+        cgroup_t* cg = &cgroup_table[i];
+        if (!cg->used) {
+            if (!slot) {
+                slot = cg;
+            }
+            continue;
+        }
+        if (cg->parent == parent && !cg->dying && strcmp(cg->name, name) == 0) {
+            cgroup_unlock(old);
+            return RDNX_E_BUSY;
+        }
+    }
+    if (!slot) {
+        cgroup_unlock(old);
+        return RDNX_E_NOMEM;
+    }
+    cgroup_init_slot(slot, (uint32_t)(slot - cgroup_table));
+    strncpy(slot->name, name, sizeof(slot->name) - 1);
+    slot->parent = parent;
+    slot->depth = (uint8_t)(parent->depth + 1u);
+    parent->refs++;
+    parent->nr_children++;
+    cgroup_nr_used++;
+    if (out_id) {
+        *out_id = slot->id;
+    }
+    cgroup_unlock(old);
+    return RDNX_OK;
+}
+
+typedef struct cgroup_count_ctx {
+    const cgroup_t* cg;
+    uint32_t n;
+} cgroup_count_ctx_t;
+
+static void cgroup_count_one(task_t* task, void* arg)
+{
+    cgroup_count_ctx_t* ctx = (cgroup_count_ctx_t*)arg;
+    if (cgroup_of(task) != ctx->cg || task->exited ||
+        task->state == TASK_STATE_ZOMBIE || task->state == TASK_STATE_DEAD) {
+        return;
+    }
+    ctx->n++;
+}
+
+/* Live (not exited) tasks attached to cg; zombies only pin the slot. */
+static uint32_t cgroup_live_tasks(const cgroup_t* cg)
+{
+    cgroup_count_ctx_t ctx;
+    ctx.cg = cg;
+    ctx.n = 0;
+    (void)task_foreach(cgroup_count_one, &ctx);
+    return ctx.n;
+}
+
+int cgroup_destroy(uint32_t id)
+{
+    if (id == CGROUP_ROOT_ID) {
+        return RDNX_E_DENIED;
+    }
+    cgroup_t* cg = cgroup_lookup(id);
+    if (!cg || cg->dying) {
+        return RDNX_E_NOTFOUND;
+    }
+    if (cgroup_live_tasks(cg) != 0) {
+        return RDNX_E_BUSY;
+    }
+    irql_t old = cgroup_lock();
+    for (uint32_t i = 1; i < CGROUP_MAX; i++) {
+        if (cgroup_table[i].used && cgroup_table[i].parent == cg && !cgroup_table[i].dying) {
+            cgroup_unlock(old);
+            return RDNX_E_BUSY;
+        }
+    }
+    cg->dying = 1;
+    if (cg->throttled) {
+        cg->throttled = 0;
+    }
+    cgroup_unlock(old);
+    cgroup_put(cg);
+    return RDNX_OK;
+}
+
+int cgroup_attach(task_t* task, uint32_t id)
+{
+    if (!task) {
+        return RDNX_E_INVALID;
+    }
+    irql_t old = cgroup_lock();
+    cgroup_t* cg = cgroup_lookup(id);
+    if (!cg || cg->dying) {
+        cgroup_unlock(old);
+        return RDNX_E_NOTFOUND;
+    }
+    cgroup_t* prev = task->cgroup;
+    if (prev == cg) {
+        cgroup_unlock(old);
+        return RDNX_OK;
+    }
+    cg->refs++;
+    task->cgroup = cg;
+    cgroup_unlock(old);
+    /* Memory already charged stays with the previous group until freed. */
+    cgroup_put(prev);
+    return RDNX_OK;
+}
+
+int cgroup_set(uint32_t id, uint32_t key, uint64_t value)
+{
+    if (id == CGROUP_ROOT_ID) {
+        return RDNX_E_INVALID;
+    }
+    irql_t old = cgroup_lock();
+    cgroup_t* cg = cgroup_lookup(id);
+    if (!cg || cg->dying) {
+        cgroup_unlock(old);
+        return RDNX_E_NOTFOUND;
+    }
+    int rc = RDNX_OK;
+    switch (key) {
+    case CGROUP_KEY_CPU_WEIGHT:
+    case CGROUP_KEY_IO_WEIGHT:
+        if (value < CGROUP_WEIGHT_MIN || value > CGROUP_WEIGHT_MAX) {
+            rc = RDNX_E_INVALID;
+        } else if (key == CGROUP_KEY_CPU_WEIGHT) {
+            cg->cpu_weight = (uint32_t)value;
+        } else {
+            cg->io_weight = (uint32_t)value;
+        }
+        break;
+    case CGROUP_KEY_CPU_MAX: {
+        uint64_t quota = (value >= CGROUP_UNLIMITED) ? 0 : cgroup_us_to_ticks(value);
+        if (value == 0) {
+            rc = RDNX_E_INVALID;
+            break;
+        }
+        if (quota && !cg->cpu_quota_ticks) {
+            cgroup_nr_quota++;
+        } else if (!quota && cg->cpu_quota_ticks && cgroup_nr_quota > 0) {
+            cgroup_nr_quota--;
+        }
+        cg->cpu_quota_ticks = quota;
+        cg->cpu_period_start = scheduler_get_ticks();
+        cg->cpu_period_used = 0;
+        cg->throttled = 0;
+        break;
+    }
+    case CGROUP_KEY_CPU_PERIOD:
+        if (value < CGROUP_TICK_US || value > CGROUP_PERIOD_MAX_US) {
+            rc = RDNX_E_INVALID;
+            break;
+        }
+        cg->cpu_period_ticks = cgroup_us_to_ticks(value);
+        cg->cpu_period_start = scheduler_get_ticks();
+        cg->cpu_period_used = 0;
+        cg->throttled = 0;
+        break;
+    case CGROUP_KEY_MEM_MAX:
+        /* Lowering below current usage only makes further charges fail. */
+        cg->mem_max_pages = (value >= CGROUP_UNLIMITED) ? CGROUP_UNLIMITED
+                                                        : value / CGROUP_PAGE_SIZE;
+        break;
+    default:
+        rc = RDNX_E_INVALID;
+        break;
+    }
+    cgroup_unlock(old);
+    return rc;
+}
+
+int cgroup_get_stat(uint32_t id, cgroup_stat_t* out)
+{
+    if (!out) {
+        return RDNX_E_INVALID;
+    }
+    cgroup_t* cg = cgroup_lookup(id);
+    if (!cg) {
+        return RDNX_E_NOTFOUND;
+    }
+    uint32_t live = cgroup_live_tasks(cg);
+    memset(out, 0, sizeof(*out));
+    irql_t old = cgroup_lock();
+    out->id = cg->id;
+    out->parent_id = cg->parent ? cg->parent->id : CGROUP_ROOT_ID;
+    out->depth = cg->depth;
+    out->nr_tasks = live;
+    out->nr_children = cg->nr_children;
+    out->dying = cg->dying;
+    memcpy(out->name, cg->name, sizeof(out->name));
+    out->cpu_weight = cg->cpu_weight;
+    out->io_weight = cg->io_weight;
+    out->cpu_max_us = cg->cpu_quota_ticks ? cg->cpu_quota_ticks * CGROUP_TICK_US : CGROUP_UNLIMITED;
+    out->cpu_period_us = cg->cpu_period_ticks * CGROUP_TICK_US;
+    out->cpu_usage_us = cg->cpu_ticks * CGROUP_TICK_US;
+    out->cpu_nr_periods = cg->cpu_nr_periods;
+    out->cpu_nr_throttled = cg->cpu_nr_throttled;
+    out->cpu_throttled_us = cg->cpu_throttled_ticks * CGROUP_TICK_US;
+    out->mem_max_bytes = (cg->mem_max_pages == CGROUP_UNLIMITED) ? CGROUP_UNLIMITED
+                                                                 : cg->mem_max_pages * CGROUP_PAGE_SIZE;
+    out->mem_bytes = cg->mem_pages * CGROUP_PAGE_SIZE;
+    out->mem_anon_bytes = cg->mem_anon_pages * CGROUP_PAGE_SIZE;
+    out->mem_file_bytes = cg->mem_file_pages * CGROUP_PAGE_SIZE;
+    out->mem_peak_bytes = cg->mem_peak_pages * CGROUP_PAGE_SIZE;
+    out->mem_failcnt = cg->mem_failcnt;
+    out->mem_oom_kills = cg->mem_oom_kills;
+    out->io_read_bytes = cg->io_read_bytes;
+    out->io_write_bytes = cg->io_write_bytes;
+    out->io_delay_us = cg->io_delay_ticks * CGROUP_TICK_US;
+    cgroup_unlock(old);
+    return RDNX_OK;
+}
+
+/* ============================================================================
+ * Task lifecycle
+ * ============================================================================ */
+
+void cgroup_task_init(task_t* task)
+{
+    if (!task) {
+        return;
+    }
+    cgroup_t* root = cgroup_root();
+    cgroup_get(root);
+    task->cgroup = root;
+}
+
+void cgroup_task_inherit(task_t* child, const task_t* parent)
+{
+    if (!child || !parent) {
+        return;
+    }
+    (void)cgroup_attach(child, cgroup_of(parent)->id);
+}
+
+void cgroup_task_exit(task_t* task)
+{
+    if (!task || !task->cgroup) {
+        return;
+    }
+    cgroup_t* cg = task->cgroup;
+    task->cgroup = NULL;
+    cgroup_put(cg);
+}
+
+/* ============================================================================
+ * CPU
+ * ============================================================================ */
+
+int cgroup_sched_active(void)
+{
+    return cgroup_nr_used > 1;
+}
+
+int cgroup_sched_tick(task_t* cur, uint64_t now)
+{
+    if (!cgroup_inited) {
+        return 0;
+    }
+    int resched = 0;
+    if (cur) {
+        cgroup_t* g = cgroup_of(cur);
+        g->cpu_self_vruntime += CGROUP_VSCALE / CGROUP_WEIGHT_DEFAULT;
+        g->cpu_self_last_tick = now;
+        for (cgroup_t* a = g; a; a = a->parent) {
+            a->cpu_ticks++;
+            a->cpu_last_tick = now;
+            if (a->parent) {
+                a->cpu_vruntime += CGROUP_VSCALE / a->cpu_weight;
+            }
+            if (a->cpu_quota_ticks) {
+                a->cpu_period_used++;
+                if (!a->throttled && a->cpu_period_used >= a->cpu_quota_ticks) {
+                    a->throttled = 1;
+                    a->cpu_nr_throttled++;
+                    resched = 1;
+                }
+            }
+        }
+    }
+    if (cgroup_nr_quota == 0) {
+        return resched;
+    }
+    for (uint32_t i = 1; i < CGROUP_MAX; i++) {
+        cgroup_t* a = &cgroup_table[i];
+        if (!a->used || !a->cpu_quota_ticks) {
+            continue;
+        }
+        if (a->throttled) {
+            a->cpu_throttled_ticks++;
+        }
+        if (now - a->cpu_period_start >= a->cpu_period_ticks) {
+            if (a->cpu_period_used) {
+                a->cpu_nr_periods++;
+            }
+            a->cpu_period_start = now;
+            a->cpu_period_used = 0;
+            if (a->throttled) {
+                a->throttled = 0;
+                resched = 1;
+            }
+        }
+    }
+    return resched;
+}
+
+int cgroup_sched_throttled(const task_t* task)
+{
+    if (cgroup_nr_quota == 0) {
+        return 0;
+    }
+    for (const cgroup_t* a = cgroup_of(task); a; a = a->parent) {
+        if (a->throttled) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int cgroup_sched_before(const task_t* a, const task_t* b)
+{
+    cgroup_t* xa = cgroup_of(a);
+    cgroup_t* xb = cgroup_of(b);
+    if (xa == xb) {
+        return 0;
+    }
+    /* Climb to the common ancestor, remembering which child each side came from. */
+    cgroup_t* ca = NULL;
+    cgroup_t* cb = NULL;
+    while (xa->depth > xb->depth) {
+        ca = xa;
+        xa = xa->parent;
+    }
+    while (xb->depth > xa->depth) {
+        cb = xb;
+        xb = xb->parent;
+    }
+    while (xa != xb) {
+        ca = xa;
+        xa = xa->parent;
+        cb = xb;
+        xb = xb->parent;
+    }
+    uint64_t va = ca ? ca->cpu_vruntime : xa->cpu_self_vruntime;
+    uint64_t vb = cb ? cb->cpu_vruntime : xb->cpu_self_vruntime;
+    return va < vb;
+}
+
+/* Smallest vruntime among the entities of p that ran recently. */
+static int cgroup_cpu_level_min(const cgroup_t* p, uint64_t now, uint64_t* out)
+{
+    int found = 0;
+    uint64_t min = 0;
+    if (now - p->cpu_self_last_tick <= CGROUP_IDLE_TICKS) {
+        min = p->cpu_self_vruntime;
+        found = 1;
+    }
+    for (uint32_t i = 1; i < CGROUP_MAX; i++) {
+        const cgroup_t* c = &cgroup_table[i];
+        if (!c->used || c->parent != p || now - c->cpu_last_tick > CGROUP_IDLE_TICKS) {
+            continue;
+        }
+        if (!found || c->cpu_vruntime < min) {
+            min = c->cpu_vruntime;
+            found = 1;
+        }
+    }
+    *out = min;
+    return found;
+}
+
+static void cgroup_cpu_place(uint64_t* vruntime, const cgroup_t* level, uint64_t now)
+{
+    uint64_t min = 0;
+    if (!cgroup_cpu_level_min(level, now, &min)) {
+        return;
+    }
+    uint64_t floor = (min > CGROUP_CPU_SLACK) ? min - CGROUP_CPU_SLACK : 0;
+    if (*vruntime < floor) {
+        *vruntime = floor;
+    }
+}
+
+void cgroup_sched_enqueue(const task_t* task)
+{
+    if (!cgroup_sched_active()) {
+        return;
+    }
+    uint64_t now = scheduler_get_ticks();
+    cgroup_t* g = cgroup_of(task);
+    if (now - g->cpu_self_last_tick > CGROUP_IDLE_TICKS) {
+        cgroup_cpu_place(&g->cpu_self_vruntime, g, now);
+        g->cpu_self_last_tick = now;
+    }
+    for (cgroup_t* a = g; a->parent; a = a->parent) {
+        if (now - a->cpu_last_tick > CGROUP_IDLE_TICKS) {
+            cgroup_cpu_place(&a->cpu_vruntime, a->parent, now);
+            a->cpu_last_tick = now;
+        }
+    }
+}
+
+/* ============================================================================
+ * Memory
+ * ============================================================================ */
+
+int cgroup_mem_charge(cgroup_t* cg, uint64_t pages, int kind)
+{
+    if (!cg || pages == 0) {
+        return RDNX_OK;
+    }
+    irql_t old = cgroup_lock();
+    for (cgroup_t* a = cg; a; a = a->parent) {
+        if (a->mem_max_pages != CGROUP_UNLIMITED &&
+            (pages > a->mem_max_pages || a->mem_pages > a->mem_max_pages - pages)) {
+            a->mem_failcnt++;
+            cgroup_unlock(old);
+            return RDNX_E_NOMEM;
+        }
+    }
+    for (cgroup_t* a = cg; a; a = a->parent) {
+        a->mem_pages += pages;
+        if (kind == CGROUP_MEM_FILE) {
+            a->mem_file_pages += pages;
+        } else {
+            a->mem_anon_pages += pages;
+        }
+        if (a->mem_pages > a->mem_peak_pages) {
+            a->mem_peak_pages = a->mem_pages;
+        }
+    }
+    cgroup_unlock(old);
+    return RDNX_OK;
+}
+
+static inline void cgroup_sub(uint64_t* v, uint64_t n)
+{
+    *v = (*v > n) ? *v - n : 0;
+}
+
+void cgroup_mem_uncharge(cgroup_t* cg, uint64_t pages, int kind)
+{
+    if (!cg || pages == 0) {
+        return;
+    }
+    irql_t old = cgroup_lock();
+    for (cgroup_t* a = cg; a; a = a->parent) {
+        cgroup_sub(&a->mem_pages, pages);
+        if (kind == CGROUP_MEM_FILE) {
+            cgroup_sub(&a->mem_file_pages, pages);
+        } else {
+            cgroup_sub(&a->mem_anon_pages, pages);
+        }
+    }
+    cgroup_unlock(old);
+}
+
+void cgroup_mem_oom(task_t* task)
+{
+    cgroup_t* g = cgroup_of(task);
+    cgroup_t* limiting = NULL;
+    irql_t old = cgroup_lock();
+    for (cgroup_t* a = g; a; a = a->parent) {
+        if (a->mem_max_pages != CGROUP_UNLIMITED && a->mem_pages >= a->mem_max_pages) {
+            limiting = a;
+            break;
+        }
+    }
+    if (limiting) {
+        limiting->mem_oom_kills++;
+    }
+    cgroup_unlock(old);
+    kprintf("[CGROUP] oom: killing pid %llu (%s), group %s\n",
+            (unsigned long long)(task ? task->task_id : 0),
+            (task && task->comm[0]) ? task->comm : "?",
+            limiting ? limiting->name : "(global)");
+    (void)unix_proc_exit(128u + CGROUP_SIGKILL);
+}
+
+/* ============================================================================
+ * Block I/O
+ * ============================================================================ */
+
+/* Smallest io_vtime among recently active siblings of c (excluding c). */
+static int cgroup_io_sibling_min(const cgroup_t* c, uint64_t now, uint64_t* out)
+{
+    int found = 0;
+    uint64_t min = 0;
+    for (uint32_t i = 1; i < CGROUP_MAX; i++) {
+        const cgroup_t* s = &cgroup_table[i];
+        if (!s->used || s == c || s->parent != c->parent ||
+            now - s->io_last_tick > CGROUP_IDLE_TICKS) {
+            continue;
+        }
+        if (!found || s->io_vtime < min) {
+            min = s->io_vtime;
+            found = 1;
+        }
+    }
+    *out = min;
+    return found;
+}
+
+void cgroup_io_charge(int write, uint64_t bytes)
+{
+    if (!cgroup_inited || bytes == 0) {
+        return;
+    }
+    task_t* task = task_get_current();
+    uint64_t now = scheduler_get_ticks();
+    uint64_t sectors = (bytes + CGROUP_IO_SECTOR - 1u) / CGROUP_IO_SECTOR;
+    irql_t old = cgroup_lock();
+    for (cgroup_t* a = cgroup_of(task); a; a = a->parent) {
+        if (write) {
+            a->io_write_bytes += bytes;
+        } else {
+            a->io_read_bytes += bytes;
+        }
+        if (!a->parent) {
+            continue;
+        }
+        uint64_t min = 0;
+        if (now - a->io_last_tick > CGROUP_IDLE_TICKS && cgroup_io_sibling_min(a, now, &min) &&
+            a->io_vtime < min) {
+            a->io_vtime = min;
+        }
+        a->io_vtime += sectors * CGROUP_VSCALE / a->io_weight;
+        a->io_last_tick = now;
+    }
+    cgroup_unlock(old);
+}
+
+static int cgroup_io_ahead(const cgroup_t* g, uint64_t now)
+{
+    for (const cgroup_t* a = g; a && a->parent; a = a->parent) {
+        uint64_t min = 0;
+        if (cgroup_io_sibling_min(a, now, &min) && a->io_vtime > min + CGROUP_IO_SLACK) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void cgroup_io_balance(void)
+{
+    if (!cgroup_sched_active()) {
+        return;
+    }
+    cgroup_t* g = cgroup_of(task_get_current());
+    for (uint32_t i = 0; i < CGROUP_IO_MAX_DELAY_TICKS; i++) {
+        irql_t old = cgroup_lock();
+        int ahead = cgroup_io_ahead(g, scheduler_get_ticks());
+        if (ahead) {
+            g->io_delay_ticks++;
+        }
+        cgroup_unlock(old);
+        if (!ahead) {
+            return;
+        }
+        scheduler_sleep(SCHEDULER_TIME_SLICE_MS);
+    }
+}
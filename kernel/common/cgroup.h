@@ -0,0 +1,150 @@
+/**
+ * @file cgroup.h
+ * @brief Hierarchical task groups: CPU weight/quota, memory limit, I/O weight
+ */
+
+#ifndef _RODNIX_COMMON_CGROUP_H
+#define _RODNIX_COMMON_CGROUP_H
+
+#include "../core/task.h"
+#include <stdint.h>
+
+#define CGROUP_MAX 16
+#define CGROUP_NAME_MAX 16
+#define CGROUP_DEPTH_MAX 4          /* root = 0 */
+#define CGROUP_ROOT_ID 0u
+
+#define CGROUP_WEIGHT_MIN 1u
+#define CGROUP_WEIGHT_DEFAULT 100u
+#define CGROUP_WEIGHT_MAX 10000u
+#define CGROUP_PERIOD_DEFAULT_US 100000ULL
+#define CGROUP_UNLIMITED 0x7fffffffffffffffULL
+
+/* cgset() keys. */
+enum {
+    CGROUP_KEY_CPU_WEIGHT = 1, /* 1..10000, default 100 */
+    CGROUP_KEY_CPU_MAX    = 2, /* quota in us per period; CGROUP_UNLIMITED = no quota */
+    CGROUP_KEY_CPU_PERIOD = 3, /* us, rounded to scheduler ticks */
+    CGROUP_KEY_MEM_MAX    = 4, /* bytes, rounded down to pages */
+    CGROUP_KEY_IO_WEIGHT  = 5, /* 1..10000, default 100 */
+};
+
+enum {
+    CGROUP_MEM_ANON = 0, /* resident user mappings (vm_map) */
+    CGROUP_MEM_FILE = 1, /* in-memory file data (inode->data) */
+};
+
+typedef struct cgroup {
+    uint32_t id;
+    uint8_t used;
+    uint8_t dying;             /* removed from the namespace, waiting for refs == 0 */
+    uint8_t depth;
+    uint8_t throttled;         /* CPU quota exhausted in the current period */
+    char name[CGROUP_NAME_MAX];
+    struct cgroup* parent;
+    uint32_t refs;             /* tasks, charged vm_maps/inodes, child groups */
+    uint32_t nr_children;
+
+    /* CPU: weight-proportional share inside a QoS bucket + bandwidth quota. */
+    uint32_t cpu_weight;
+    uint64_t cpu_quota_ticks;  /* 0 = unlimited */
+    uint64_t cpu_period_ticks;
+    uint64_t cpu_period_start;
+    uint64_t cpu_period_used;
+    uint64_t cpu_vruntime;     /* this group as an entity of its parent */
+    uint64_t cpu_self_vruntime;/* tasks attached directly to this group */
+    uint64_t cpu_last_tick;    /* last tick this group (as an entity) was charged */
+    uint64_t cpu_self_last_tick;
+    uint64_t cpu_ticks;
+    uint64_t cpu_nr_periods;
+    uint64_t cpu_nr_throttled;
+    uint64_t cpu_throttled_ticks;
+
+    /* Memory, in pages; charges propagate to every ancestor. */
+    uint64_t mem_max_pages;
+    uint64_t mem_pages;
+    uint64_t mem_anon_pages;
+    uint64_t mem_file_pages;
+    uint64_t mem_peak_pages;
+    uint64_t mem_failcnt;
+    uint64_t mem_oom_kills;
+
+    /* Block I/O: weight-proportional device time, paid back after the syscall. */
+    uint32_t io_weight;
+    uint64_t io_vtime;
+    uint64_t io_last_tick;
+    uint64_t io_read_bytes;
+    uint64_t io_write_bytes;
+    uint64_t io_delay_ticks;
+} cgroup_t;
+
+/* Snapshot for cgstat(); mirrors rodnix_cgstat_t. */
+typedef struct cgroup_stat {
+    uint32_t id;
+    uint32_t parent_id;
+    uint32_t depth;
+    uint32_t nr_tasks;
+    uint32_t nr_children;
+    uint32_t dying;
+    char name[CGROUP_NAME_MAX];
+    uint32_t cpu_weight;
+    uint32_t io_weight;
+    uint64_t cpu_max_us;
+    uint64_t cpu_period_us;
+    uint64_t cpu_usage_us;
+    uint64_t cpu_nr_periods;
+    uint64_t cpu_nr_throttled;
+    uint64_t cpu_throttled_us;
+    uint64_t mem_max_bytes;
+    uint64_t mem_bytes;
+    uint64_t mem_anon_bytes;
+    uint64_t mem_file_bytes;
+    uint64_t mem_peak_bytes;
+    uint64_t mem_failcnt;
+    uint64_t mem_oom_kills;
+    uint64_t io_read_bytes;
+    uint64_t io_write_bytes;
+    uint64_t io_delay_us;
+} cgroup_stat_t;
+
+cgroup_t* cgroup_root(void);
+cgroup_t* cgroup_of(const task_t* task);
+void cgroup_get(cgroup_t* cg);
+void cgroup_put(cgroup_t* cg);
+
+/* Namespace management (cgcreate/cgdestroy/cgattach/cgset/cgstat). */
+int cgroup_create(uint32_t parent_id, const char* name, uint32_t* out_id);
+int cgroup_destroy(uint32_t id);
+int cgroup_attach(task_t* task, uint32_t id);
+int cgroup_set(uint32_t id, uint32_t key, uint64_t value);
+int cgroup_get_stat(uint32_t id, cgroup_stat_t* out);
+
+/* Task lifecycle: new tasks start in root, fork/spawn inherit the group. */
+void cgroup_task_init(task_t* task);
+void cgroup_task_inherit(task_t* child, const task_t* parent);
+void cgroup_task_exit(task_t* task);
+
+/*
+ * Scheduler hooks. While only the root group exists the run queues keep
+ * their plain FIFO order; the tick hook still counts root CPU usage.
+ */
+int cgroup_sched_active(void);
+/* Per tick: charge cur (may be NULL), roll quota periods; 1 = reschedule. */
+int cgroup_sched_tick(task_t* cur, uint64_t now);
+int cgroup_sched_throttled(const task_t* task);
+/* 1 if a's group is further behind its fair share than b's. */
+int cgroup_sched_before(const task_t* a, const task_t* b);
+/* A thread became runnable: do not let an idle group bank CPU time. */
+void cgroup_sched_enqueue(const task_t* task);
+
+/* Memory: charge/uncharge pages to cg and its ancestors. */
+int cgroup_mem_charge(cgroup_t* cg, uint64_t pages, int kind);
+void cgroup_mem_uncharge(cgroup_t* cg, uint64_t pages, int kind);
+/* User page fault could not be satisfied: kill the task (does not return). */
+void cgroup_mem_oom(task_t* task);
+
+/* Block I/O: charge from the block layer, balance with no locks held. */
+void cgroup_io_charge(int write, uint64_t bytes);
+void cgroup_io_balance(void);
+
+#endif /* _RODNIX_COMMON_CGROUP_H */
@@ -6,6 +6,7 @@
 #include "../../include/console.h"
 #include "startup_trace.h"
 #include "bootlog.h"
+#include "kmod.h"
 #include <stdarg.h>
 
 /* Simple VGA text mode implementation */
@@ -23,6 +24,11 @@
 
 static bool serial_enabled = false;
 
+/* Extra output devices that mirror the serial port (virtio-console). */
+#define CONSOLE_SINK_MAX 2
+static const console_sink_t* console_sinks[CONSOLE_SINK_MAX];
+static volatile uint32_t console_sink_batch = 0;  /* >0 inside kputs/kprintf/console_write */
+
 /* VGA cursor control ports */
 #define VGA_CRTC_INDEX  0x3D4
 #define VGA_CRTC_DATA   0x3D5
@@ -367,6 +373,59 @@ static void serial_write_char(char c)
     outb(SERIAL_COM1_BASE + SERIAL_DATA, (uint8_t)c);
 }
 
+void console_serial_write(const char* buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] == '\n') {
+            serial_write_char('\r');
+        }
+        serial_write_char(buf[i]);
+    }
+}
+
+int console_register_sink(const console_sink_t* sink)
+{
+    if (!sink || !sink->write) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < CONSOLE_SINK_MAX; i++) {
+        if (!console_sinks[i]) {
+            console_sinks[i] = sink;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Serial ("\n" -> "\r\n") plus every sink (raw bytes). */
+static void console_mirror_char(char c)
+{
+    if (c == '\n') {
+        serial_write_char('\r');
+    }
+    serial_write_char(c);
+    for (uint32_t i = 0; i < CONSOLE_SINK_MAX; i++) {
+        const console_sink_t* sink = console_sinks[i];
+        if (sink) {
+            sink->write(&c, 1);
+        }
+    }
+}
+
+/* End of a write: sinks that batch may hand their data to the device now. */
+static void console_sinks_flush(void)
+{
+    if (console_sink_batch != 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < CONSOLE_SINK_MAX; i++) {
+        const console_sink_t* sink = console_sinks[i];
+        if (sink && sink->flush) {
+            sink->flush();
+        }
+    }
+}
+
 static bool line_matches_prefix(const char* s, const char* p)
 {
     if (!s || !p) {
@@ -649,7 +708,29 @@ static void scroll_screen(void)
     }
 }
 
+static void console_putc(char c);
+
 void kputc(char c)
+{
+    console_putc(c);
+    console_sinks_flush();
+}
+EXPORT_SYMBOL(kputc);
+
+void console_write(const char* buf, size_t len)
+{
+    if (!buf) {
+        return;
+    }
+    console_sink_batch++;
+    for (size_t i = 0; i < len; i++) {
+        console_putc(buf[i]);
+    }
+    console_sink_batch--;
+    console_sinks_flush();
+}
+
+static void console_putc(char c)
 {
     /* Allow minimal ANSI cursor/clear control for userspace shell UX. */
     if (console_handle_ansi_char(c)) {
@@ -663,11 +744,8 @@ void kputc(char c)
         log_at_line_start = false;
     }
 
-    /* Mirror output to serial for logging */
-    if (c == '\n') {
-        serial_write_char('\r');
-    }
-    serial_write_char(c);
+    /* Mirror output to serial (and sinks) for logging */
+    console_mirror_char(c);
 
     /* Handle backspace */
     if (c == '\b') {
@@ -760,10 +838,7 @@ void kputs(const char* str)
         
         while (*str && safe_row < VGA_HEIGHT) {
             /* Still mirror to serial in the safe path */
-            if (*str == '\n') {
-                serial_write_char('\r');
-            }
-            serial_write_char(*str);
+            console_mirror_char(*str);
             if (*str == '\n') {
                 safe_col = 0;
                 safe_row++;
@@ -784,14 +859,18 @@ void kputs(const char* str)
     }
     
     kputs_in_progress = true;
+    console_sink_batch++;
     while (*str) {
         kputc(*str);
         str++;
     }
+    console_sink_batch--;
     kputs_in_progress = false;
+    console_sinks_flush();
     /* Force immediate output - no buffering */
     __asm__ volatile ("" ::: "memory");
 }
+EXPORT_SYMBOL(kputs);
 
 void console_set_log_prefix_enabled(bool enabled)
 {
@@ -849,13 +928,23 @@ void kprintf(const char* fmt, ...)
     kvprintf(fmt, args);
     va_end(args);
 }
+EXPORT_SYMBOL(kprintf);
+
+static void console_vprintf(const char* fmt, va_list args);
 
 void kvprintf(const char* fmt, va_list args)
 {
     if (!console_verbose_mode() && fmt && line_filter_is_noisy_prefix(fmt)) {
         return;
     }
+    console_sink_batch++;
+    console_vprintf(fmt, args);
+    console_sink_batch--;
+    console_sinks_flush();
+}
 
+static void console_vprintf(const char* fmt, va_list args)
+{
     while (*fmt) {
         if (*fmt == '%') {
             fmt++;
@@ -1,6 +1,6 @@
 /**
  * @file elf.h
- * @brief Minimal ELF64 definitions for userland loader
+ * @brief Minimal ELF64 definitions for the userland and module loaders
  */
 
 #ifndef _RODNIX_COMMON_ELF_H
@@ -21,7 +21,28 @@
 #define SHT_NOBITS 8
 #define SHT_REL 9
 #define SHN_UNDEF 0
+#define SHN_ABS 0xfff1
+#define SHN_COMMON 0xfff2
+#define SHF_WRITE 0x1
 #define SHF_ALLOC 0x2
+#define SHF_EXECINSTR 0x4
+
+#define STB_LOCAL 0
+#define STB_GLOBAL 1
+#define STB_WEAK 2
+#define ELF64_ST_BIND(i) ((i) >> 4)
+
+#define ELF64_R_SYM(i) ((uint32_t)((i) >> 32))
+#define ELF64_R_TYPE(i) ((uint32_t)(i))
+
+/* x86_64 relocations the module loader handles. */
+#define R_X86_64_NONE 0
+#define R_X86_64_64 1
+#define R_X86_64_PC32 2
+#define R_X86_64_PLT32 4
+#define R_X86_64_32 10
+#define R_X86_64_32S 11
+#define R_X86_64_PC64 24
 
 #define ET_EXEC 2
 #define EM_X86_64 62
@@ -88,4 +109,10 @@ typedef struct {
     uint64_t st_size;
 } elf64_sym_t;
 
+typedef struct {
+    uint64_t r_offset;
+    uint64_t r_info;
+    int64_t r_addend;
+} elf64_rela_t;
+
 #endif /* _RODNIX_COMMON_ELF_H */
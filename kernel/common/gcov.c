@@ -0,0 +1,376 @@
+/**
+ * @file gcov.c
+ * @brief Profile counters for PGO builds: registration and serial dump
+ *
+ * The compiler side of -fprofile-arcs is a gcov_info per object, linked
+ * into a list by __gcov_init() from the object's constructor. The layout
+ * of gcov_info and the .gcda encoding follow the GCC version building the
+ * kernel (the same scheme Linux uses in kernel/gcov/gcc_4_7.c); only arc
+ * counters are generated, which is all -fprofile-use needs for block and
+ * branch probabilities and function ordering.
+ *
+ * Nothing here is instrumented (see the Makefile) so the dump does not
+ * change the counters it is writing out. Each line goes out with interrupts
+ * masked; gcov_lock keeps whole records from interleaving when a preempted
+ * process and the kernel dump write at the same time.
+ */
+
+#include "gcov.h"
+#include "mutex.h"
+#include "../core/interrupts.h"
+#include "../../include/console.h"
+#include "../../include/error.h"
+
+#define GCOV_DATA_MAGIC  0x67636461u   /* "gcda" */
+#define GCOV_TAG_FUNCTION 0x01000000u
+#define GCOV_TAG_COUNTER_BASE 0x01a10000u
+#define GCOV_TAG_OBJECT_SUMMARY 0xa1000000u
+
+#if __GNUC__ >= 12
+#define GCOV_UNIT_SIZE 4   /* record lengths in bytes */
+#else
+#define GCOV_UNIT_SIZE 1   /* record lengths in 32-bit words */
+#endif
+
+#if __GNUC__ >= 14
+#define GCOV_COUNTERS 9
+#elif __GNUC__ >= 10
+#define GCOV_COUNTERS 8
+#elif __GNUC__ >= 7
+#define GCOV_COUNTERS 9
+#else
+#define GCOV_COUNTERS 10
+#endif
+
+typedef struct gcov_sink {
+    uint8_t line[GCOV_LINE_BYTES];
+    uint32_t fill;
+    uint32_t sum;
+    size_t total;
+    int emit;       /* 0: only count bytes */
+} gcov_sink_t;
+
+static const char gcov_hex[] = "0123456789abcdef";
+static mutex_t gcov_lock;
+
+static void gcov_put_str(const char* s)
+{
+    size_t n = 0;
+    while (s[n]) {
+        n++;
+    }
+    console_serial_write(s, n);
+}
+
+static void gcov_put_hex(uint64_t v)
+{
+    char buf[17];
+    int i = 16;
+    buf[i] = '\0';
+    do {
+        buf[--i] = gcov_hex[v & 0xfu];
+        v >>= 4;
+    } while (v && i > 0);
+    gcov_put_str(&buf[i]);
+}
+
+static void gcov_put_dec(uint64_t v)
+{
+    char buf[21];
+    int i = 20;
+    buf[i] = '\0';
+    do {
+        buf[--i] = (char)('0' + v % 10u);
+        v /= 10u;
+    } while (v && i > 0);
+    gcov_put_str(&buf[i]);
+}
+
+static void gcov_sink_flush(gcov_sink_t* s)
+{
+    if (!s->emit || s->fill == 0) {
+        s->fill = 0;
+        return;
+    }
+    char text[8 + GCOV_LINE_BYTES * 2 + 2];
+    uint32_t n = 0;
+    const char* prefix = "[GCOV] D ";
+    while (prefix[n]) {
+        text[n] = prefix[n];
+        n++;
+    }
+    for (uint32_t i = 0; i < s->fill; i++) {
+        text[n++] = gcov_hex[s->line[i] >> 4];
+        text[n++] = gcov_hex[s->line[i] & 0xfu];
+    }
+    text[n++] = '\n';
+    /* One line at a time with interrupts off: nothing else lands mid-line. */
+    irql_t old = set_irql(IRQL_HIGH);
+    console_serial_write(text, n);
+    (void)set_irql(old);
+    s->fill = 0;
+}
+
+static void gcov_sink_bytes(gcov_sink_t* s, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    s->total += len;
+    if (!s->emit) {
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        s->sum += p[i];
+        s->line[s->fill++] = p[i];
+        if (s->fill == GCOV_LINE_BYTES) {
+            gcov_sink_flush(s);
+        }
+    }
+}
+
+static void gcov_frame_begin(size_t len, const char* path)
+{
+    irql_t old = set_irql(IRQL_HIGH);
+    gcov_put_str("[GCOV] BEGIN ");
+    gcov_put_dec(len);
+    gcov_put_str(" ");
+    gcov_put_str(path);
+    gcov_put_str("\n");
+    (void)set_irql(old);
+}
+
+static void gcov_frame_end(gcov_sink_t* s)
+{
+    gcov_sink_flush(s);
+    irql_t old = set_irql(IRQL_HIGH);
+    gcov_put_str("[GCOV] END ");
+    gcov_put_hex(s->sum);
+    gcov_put_str("\n");
+    (void)set_irql(old);
+}
+
+int gcov_emit(const char* path, const void* data, size_t len)
+{
+    if (!path || !path[0] || (!data && len) || len > GCOV_EMIT_MAX) {
+        return RDNX_E_INVALID;
+    }
+    gcov_sink_t s = {0};
+    s.emit = 1;
+    mutex_lock(&gcov_lock);
+    gcov_frame_begin(len, path);
+    gcov_sink_bytes(&s, data, len);
+    gcov_frame_end(&s);
+    mutex_unlock(&gcov_lock);
+    return RDNX_OK;
+}
+
+#ifdef CONFIG_GCOV
+
+typedef int64_t gcov_type;
+
+struct gcov_info;
+
+typedef struct gcov_ctr_info {
+    unsigned int num;
+    gcov_type* values;
+} gcov_ctr_info_t;
+
+typedef struct gcov_fn_info {
+    const struct gcov_info* key;
+    unsigned int ident;
+    unsigned int lineno_checksum;
+    unsigned int cfg_checksum;
+    gcov_ctr_info_t ctrs[];
+} gcov_fn_info_t;
+
+typedef struct gcov_info {
+    unsigned int version;
+    struct gcov_info* next;
+    unsigned int stamp;
+#if __GNUC__ >= 12
+    unsigned int checksum;
+#endif
+    const char* filename;
+    void (*merge[GCOV_COUNTERS])(gcov_type*, unsigned int);
+    unsigned int n_functions;
+    gcov_fn_info_t** functions;
+} gcov_info_t;
+
+typedef void (*gcov_ctor_t)(void);
+
+/* link.ld: .init_array/.ctors of every object. */
+extern gcov_ctor_t __ctors_start[];
+extern gcov_ctor_t __ctors_end[];
+
+static gcov_info_t* gcov_list = NULL;
+static uint32_t gcov_objects = 0;
+
+void __gcov_init(gcov_info_t* info);
+void __gcov_exit(void);
+void __gcov_merge_add(gcov_type* counters, unsigned int n);
+
+void __gcov_init(gcov_info_t* info)
+{
+    if (!info) {
+        return;
+    }
+    info->next = gcov_list;
+    gcov_list = info;
+    gcov_objects++;
+}
+
+/* Called from the objects' destructors, which the kernel never runs. */
+void __gcov_exit(void)
+{
+}
+
+/* Merging happens on the host (gcda_extract.py); only the address is used. */
+void __gcov_merge_add(gcov_type* counters, unsigned int n)
+{
+    (void)counters;
+    (void)n;
+}
+
+void gcov_init(void)
+{
+    mutex_init(&gcov_lock, "gcov");
+    for (gcov_ctor_t* c = __ctors_start; c < __ctors_end; c++) {
+        if (*c && *c != (gcov_ctor_t)(intptr_t)-1) {
+            (*c)();
+        }
+    }
+}
+
+uint32_t gcov_object_count(void)
+{
+    return gcov_objects;
+}
+
+static void gcov_u32(gcov_sink_t* s, uint32_t v)
+{
+    gcov_sink_bytes(s, &v, sizeof(v));
+}
+
+static void gcov_u64(gcov_sink_t* s, uint64_t v)
+{
+    gcov_u32(s, (uint32_t)v);
+    gcov_u32(s, (uint32_t)(v >> 32));
+}
+
+static void gcov_convert(gcov_sink_t* s, const gcov_info_t* info)
+{
+    gcov_u32(s, GCOV_DATA_MAGIC);
+    gcov_u32(s, info->version);
+    gcov_u32(s, info->stamp);
+#if __GNUC__ >= 12
+    gcov_u32(s, info->checksum);
+#endif
+#if __GNUC__ >= 9
+    /* Object summary: one run, largest arc counter. */
+    uint64_t sum_max = 0;
+    for (unsigned int f = 0; f < info->n_functions; f++) {
+        const gcov_fn_info_t* fn = info->functions[f];
+        if (!fn || fn->key != info || !info->merge[0]) {
+            continue;
+        }
+        for (unsigned int i = 0; i < fn->ctrs[0].num; i++) {
+            uint64_t v = (uint64_t)fn->ctrs[0].values[i];
+            sum_max = v > sum_max ? v : sum_max;
+        }
+    }
+    gcov_u32(s, GCOV_TAG_OBJECT_SUMMARY);
+    gcov_u32(s, 2u * GCOV_UNIT_SIZE);
+    gcov_u32(s, 1u);
+    gcov_u32(s, (uint32_t)sum_max);
+#endif
+    for (unsigned int f = 0; f < info->n_functions; f++) {
+        const gcov_fn_info_t* fn = info->functions[f];
+        gcov_u32(s, GCOV_TAG_FUNCTION);
+        /* Functions emitted by another object (COMDAT) get an empty record. */
+        if (!fn || fn->key != info) {
+            gcov_u32(s, 0u);
+            continue;
+        }
+        gcov_u32(s, 3u * GCOV_UNIT_SIZE);
+        gcov_u32(s, fn->ident);
+        gcov_u32(s, fn->lineno_checksum);
+        gcov_u32(s, fn->cfg_checksum);
+        const gcov_ctr_info_t* ctr = fn->ctrs;
+        for (unsigned int t = 0; t < GCOV_COUNTERS; t++) {
+            if (!info->merge[t]) {
+                continue;
+            }
+            gcov_u32(s, GCOV_TAG_COUNTER_BASE + (t << 17));
+            gcov_u32(s, ctr->num * 2u * GCOV_UNIT_SIZE);
+            for (unsigned int i = 0; i < ctr->num; i++) {
+                gcov_u64(s, (uint64_t)ctr->values[i]);
+            }
+            ctr++;
+        }
+    }
+}
+
+int gcov_dump(void)
+{
+    uint32_t n = 0;
+    mutex_lock(&gcov_lock);
+    for (const gcov_info_t* info = gcov_list; info; info = info->next) {
+        gcov_sink_t s = {0};
+        gcov_convert(&s, info);
+        size_t len = s.total;
+        s.total = 0;
+        s.emit = 1;
+        gcov_frame_begin(len, info->filename);
+        gcov_convert(&s, info);
+        gcov_frame_end(&s);
+        n++;
+    }
+    mutex_unlock(&gcov_lock);
+    return (int)n;
+}
+
+int gcov_reset(void)
+{
+    for (gcov_info_t* info = gcov_list; info; info = info->next) {
+        for (unsigned int f = 0; f < info->n_functions; f++) {
+            gcov_fn_info_t* fn = info->functions[f];
+            if (!fn || fn->key != info) {
+                continue;
+            }
+            gcov_ctr_info_t* ctr = fn->ctrs;
+            for (unsigned int t = 0; t < GCOV_COUNTERS; t++) {
+                if (!info->merge[t]) {
+                    continue;
+                }
+                for (unsigned int i = 0; i < ctr->num; i++) {
+                    ctr->values[i] = 0;
+                }
+                ctr++;
+            }
+        }
+    }
+    return RDNX_OK;
+}
+
+#else /* !CONFIG_GCOV */
+
+void gcov_init(void)
+{
+    mutex_init(&gcov_lock, "gcov");
+}
+
+uint32_t gcov_object_count(void)
+{
+    return 0;
+}
+
+int gcov_dump(void)
+{
+    return RDNX_E_UNSUPPORTED;
+}
+
+int gcov_reset(void)
+{
+    return RDNX_E_UNSUPPORTED;
+}
+
+#endif /* CONFIG_GCOV */
@@ -0,0 +1,45 @@
+/**
+ * @file gcov.h
+ * @brief Profile counters for PGO builds (PGO=gen)
+ *
+ * With PGO=gen every kernel object is compiled with -fprofile-arcs and
+ * registers its counters through a constructor that gcov_init() runs at
+ * boot. gcov_dump() serialises each object to the .gcda format GCC reads
+ * with -fprofile-use and writes it to the serial port as text records:
+ *
+ *   [GCOV] BEGIN <bytes> <path of the .gcda>
+ *   [GCOV] D <hex>            (up to GCOV_LINE_BYTES bytes per line)
+ *   [GCOV] END <sum>          (32-bit sum of all bytes, hex)
+ *
+ * scripts/pgo/gcda_extract.py turns a serial log back into .gcda files.
+ * Userland profiles (libc/gcov.c) go through the same framing via
+ * gcov(GCOV_OP_EMIT). Without PGO=gen there are no counters and dump and
+ * reset return RDNX_E_UNSUPPORTED.
+ */
+
+#ifndef _RODNIX_COMMON_GCOV_H
+#define _RODNIX_COMMON_GCOV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GCOV_LINE_BYTES 48
+#define GCOV_EMIT_MAX   (4u * 1024u * 1024u)
+#define GCOV_PATH_MAX   256
+
+/* gcov() ops. */
+enum {
+    GCOV_OP_INFO  = 1,   /* number of instrumented kernel objects */
+    GCOV_OP_DUMP  = 2,   /* write all kernel objects to serial (root) */
+    GCOV_OP_RESET = 3,   /* zero all kernel counters (root) */
+    GCOV_OP_EMIT  = 4,   /* frame a userland .gcda image on serial */
+};
+
+/* Run the profile constructors (PGO=gen only) and set up the dump lock. */
+void gcov_init(void);
+uint32_t gcov_object_count(void);
+int gcov_dump(void);
+int gcov_reset(void);
+int gcov_emit(const char* path, const void* data, size_t len);
+
+#endif /* _RODNIX_COMMON_GCOV_H */
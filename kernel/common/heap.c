@@ -1,34 +1,58 @@
 /**
  * @file heap.c
  * @brief Simple kernel heap allocator
+ *
+ * With KASAN=1 every block header also carries a kasan_meta_t and acts as
+ * the left redzone of its block; kmalloc() adds at least KASAN_HEAP_REDZONE
+ * bytes after the caller's size as the right redzone. kfree() poisons the
+ * block and parks it in a FIFO quarantine; only blocks pushed out of it by
+ * KASAN_QUARANTINE_BYTES newer ones return to the free list, so a stale
+ * pointer keeps hitting poisoned memory for a while. This file is not
+ * instrumented: it reads headers and free blocks by design.
  */
 
 #include "heap.h"
+#include "kasan.h"
+#include "kmod.h"
+#include "scheduler.h"
 #include "../../include/common.h"
+#include "../../include/console.h"
 #include "../../include/debug.h"
 #include "../../include/error.h"
 #include "../core/memory.h"
 #include "../core/config.h"
 #include "../core/interrupts.h"
+#include "../fabric/spin.h"
 
 typedef struct heap_block {
     size_t size;
     bool free;
+#ifdef CONFIG_KASAN
+    bool quarantined;
+#endif
     struct heap_block* next;
     struct heap_block* prev;
+#ifdef CONFIG_KASAN
+    struct heap_block* qnext;
+    kasan_meta_t meta;
+#endif
 } heap_block_t;
 
+_Static_assert((sizeof(heap_block_t) % 16u) == 0, "heap header keeps blocks 16-byte aligned");
+
 static heap_block_t* heap_head = NULL;
 static heap_block_t* heap_tail = NULL;
+/* Zero-initialized ticket lock: usable before heap_init(). IRQ-safe, ISRs allocate too. */
+static spinlock_t heap_spin;
 
 static inline irql_t heap_lock(void)
 {
-    return set_irql(IRQL_HIGH);
+    return spinlock_lock_irqsave(&heap_spin);
 }
 
 static inline void heap_unlock(irql_t old)
 {
-    (void)set_irql(old);
+    spinlock_unlock_irqrestore(&heap_spin, old);
 }
 
 static bool heap_block_in_list(const heap_block_t* needle)
@@ -55,6 +79,67 @@ static size_t heap_align(size_t size)
     return ALIGN_UP(size, align);
 }
 
+static void heap_merge_if_possible(heap_block_t* block);
+
+#ifdef CONFIG_KASAN
+
+#define KASAN_HEAP_REDZONE      16u
+#define KASAN_QUARANTINE_BYTES  (1024u * 1024u)
+
+static heap_block_t* heap_q_head = NULL;
+static heap_block_t* heap_q_tail = NULL;
+static size_t heap_q_bytes = 0;
+static uint32_t heap_q_count = 0;
+static irql_t heap_debug_irql;
+
+/* Header is the left redzone, then the caller's bytes, then the right redzone. */
+static void heap_kasan_alloc(heap_block_t* block, size_t req)
+{
+    uint8_t* data = (uint8_t*)block + sizeof(heap_block_t);
+    size_t valid = ALIGN_UP(req, KASAN_GRANULE);
+    block->quarantined = false;
+    block->qnext = NULL;
+    block->meta.req = req;
+    block->meta.alloc_ticks = scheduler_get_ticks();
+    block->meta.free_depth = 0;
+    block->meta.leak = 0;
+    kasan_poison(block, sizeof(heap_block_t), KASAN_HEAP_LEFT);
+    kasan_unpoison(data, req);
+    kasan_poison(data + valid, block->size - valid, KASAN_HEAP_RIGHT);
+}
+
+static void heap_quarantine_put(heap_block_t* block)
+{
+    block->quarantined = true;
+    block->qnext = NULL;
+    kasan_poison((uint8_t*)block + sizeof(heap_block_t), block->size, KASAN_HEAP_FREED);
+    if (heap_q_tail) {
+        heap_q_tail->qnext = block;
+    } else {
+        heap_q_head = block;
+    }
+    heap_q_tail = block;
+    heap_q_bytes += sizeof(heap_block_t) + block->size;
+    heap_q_count++;
+
+    while (heap_q_head && heap_q_bytes > KASAN_QUARANTINE_BYTES) {
+        heap_block_t* old = heap_q_head;
+        heap_q_head = old->qnext;
+        if (!heap_q_head) {
+            heap_q_tail = NULL;
+        }
+        heap_q_bytes -= sizeof(heap_block_t) + old->size;
+        heap_q_count--;
+        old->quarantined = false;
+        old->qnext = NULL;
+        old->free = true;
+        kasan_poison(old, sizeof(heap_block_t) + old->size, KASAN_HEAP_UNUSED);
+        heap_merge_if_possible(old);
+    }
+}
+
+#endif /* CONFIG_KASAN */
+
 static void heap_insert_block(heap_block_t* block)
 {
     block->next = NULL;
@@ -154,6 +239,9 @@ static heap_block_t* heap_grow(size_t min_size)
     block->free = true;
     block->next = NULL;
     block->prev = NULL;
+#ifdef CONFIG_KASAN
+    kasan_poison(mem, pages * PAGE_SIZE, KASAN_HEAP_UNUSED);
+#endif
     heap_insert_block(block);
 
     if (block->prev && block->prev->free) {
@@ -177,6 +265,7 @@ int heap_init(size_t initial_pages)
     if (initial_pages == 0) {
         initial_pages = 16;
     }
+    spinlock_init(&heap_spin);
 
     void* mem = vmm_alloc_pages((uint32_t)initial_pages, PAGE_FLAG_WRITABLE);
     if (!mem) {
@@ -190,6 +279,9 @@ int heap_init(size_t initial_pages)
     block->free = true;
     block->next = NULL;
     block->prev = NULL;
+#ifdef CONFIG_KASAN
+    kasan_poison(mem, initial_pages * PAGE_SIZE, KASAN_HEAP_UNUSED);
+#endif
     heap_head = block;
     heap_tail = block;
 
@@ -204,7 +296,11 @@ void* kmalloc(size_t size)
         return NULL;
     }
 
+#ifdef CONFIG_KASAN
+    size_t aligned = heap_align(size + KASAN_HEAP_REDZONE);
+#else
     size_t aligned = heap_align(size);
+#endif
     heap_block_t* block = heap_find_fit(aligned);
     if (!block) {
         block = heap_grow(aligned);
@@ -217,9 +313,14 @@ void* kmalloc(size_t size)
     heap_split_block(block, aligned);
     block->free = false;
     void* ptr = (uint8_t*)block + sizeof(heap_block_t);
+#ifdef CONFIG_KASAN
+    block->meta.alloc_depth = kasan_save_stack(block->meta.alloc_ips, KASAN_STACK_DEPTH, 0);
+    heap_kasan_alloc(block, size);
+#endif
     heap_unlock(old);
     return ptr;
 }
+EXPORT_SYMBOL(kmalloc);
 
 void kfree(void* ptr)
 {
@@ -234,14 +335,26 @@ void kfree(void* ptr)
         heap_unlock(old);
         PANIC("kfree: invalid pointer %p block=%p ra=%p", ptr, block, __builtin_return_address(0));
     }
+#ifdef CONFIG_KASAN
+    if (block->free || block->quarantined) {
+        kasan_meta_t meta = block->meta;
+        heap_unlock(old);
+        kasan_report_free(ptr, block->free ? NULL : &meta, (uintptr_t)__builtin_return_address(0));
+        PANIC("kfree: double free ptr=%p block=%p ra=%p", ptr, block, __builtin_return_address(0));
+    }
+    block->meta.free_depth = kasan_save_stack(block->meta.free_ips, KASAN_STACK_DEPTH, 0);
+    heap_quarantine_put(block);
+#else
     if (block->free) {
         heap_unlock(old);
         PANIC("kfree: double free ptr=%p block=%p ra=%p", ptr, block, __builtin_return_address(0));
     }
     block->free = true;
     heap_merge_if_possible(block);
+#endif
     heap_unlock(old);
 }
+EXPORT_SYMBOL(kfree);
 
 void* kcalloc(size_t count, size_t size)
 {
@@ -261,6 +374,7 @@ void* kcalloc(size_t count, size_t size)
     memset(mem, 0, total);
     return mem;
 }
+EXPORT_SYMBOL(kcalloc);
 
 void* krealloc(void* ptr, size_t new_size)
 {
@@ -273,6 +387,17 @@ void* krealloc(void* ptr, size_t new_size)
     }
 
     heap_block_t* block = (heap_block_t*)((uint8_t*)ptr - sizeof(heap_block_t));
+#ifdef CONFIG_KASAN
+    /* Always move, so stale pointers to the old block hit the quarantine. */
+    size_t old_size = block->meta.req;
+    void* moved = kmalloc(new_size);
+    if (!moved) {
+        return NULL;
+    }
+    memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+    kfree(ptr);
+    return moved;
+#else
     if (block->size >= new_size) {
         heap_split_block(block, new_size);
         return ptr;
@@ -285,4 +410,88 @@ void* krealloc(void* ptr, size_t new_size)
     memcpy(new_mem, ptr, block->size);
     kfree(ptr);
     return new_mem;
+#endif
 }
+
+#ifdef CONFIG_KASAN
+
+void heap_kasan_describe(uintptr_t addr)
+{
+    irql_t old = heap_lock();
+    heap_block_t* hit = NULL;
+    for (heap_block_t* cur = heap_head; cur; cur = cur->next) {
+        uintptr_t lo = (uintptr_t)cur;
+        if (addr >= lo && addr < lo + sizeof(heap_block_t) + cur->size) {
+            hit = cur;
+            break;
+        }
+    }
+    /* A hit in a header is most likely an overflow off the end of the block before it. */
+    if (hit && addr < (uintptr_t)hit + sizeof(heap_block_t) && hit->prev && !hit->prev->free &&
+        (uintptr_t)hit->prev + sizeof(heap_block_t) + hit->prev->size == (uintptr_t)hit) {
+        hit = hit->prev;
+    }
+    if (!hit || hit->free) {
+        heap_unlock(old);
+        kprintf("[KASAN] %p is not inside an allocated heap block\n", (void*)addr);
+        return;
+    }
+    kasan_meta_t meta = hit->meta;
+    bool quarantined = hit->quarantined;
+    uintptr_t data = (uintptr_t)hit + sizeof(heap_block_t);
+    heap_unlock(old);
+
+    if (addr < data) {
+        kprintf("[KASAN] %p is %u bytes to the left of %u-byte object %p\n", (void*)addr,
+                (unsigned)(data - addr), (unsigned)meta.req, (void*)data);
+    } else if (addr >= data + meta.req) {
+        kprintf("[KASAN] %p is %u bytes to the right of %u-byte object %p\n", (void*)addr,
+                (unsigned)(addr - data - meta.req), (unsigned)meta.req, (void*)data);
+    } else {
+        kprintf("[KASAN] %p is %u bytes inside %u-byte object %p\n", (void*)addr,
+                (unsigned)(addr - data), (unsigned)meta.req, (void*)data);
+    }
+    kasan_print_stack("allocated by", meta.alloc_ips, meta.alloc_depth);
+    if (quarantined) {
+        kasan_print_stack("freed by", meta.free_ips, meta.free_depth);
+    }
+}
+
+void heap_kasan_stats(kasan_stats_t* out)
+{
+    irql_t old = heap_lock();
+    for (heap_block_t* cur = heap_head; cur; cur = cur->next) {
+        if (!cur->free && !cur->quarantined) {
+            out->heap_objects++;
+            out->heap_bytes += cur->meta.req;
+        }
+    }
+    out->quarantine_bytes = heap_q_bytes;
+    out->quarantine_objects = heap_q_count;
+    heap_unlock(old);
+}
+
+uint32_t heap_objects_begin(heap_object_t* out, uint32_t max)
+{
+    heap_debug_irql = heap_lock();
+    uint32_t n = 0;
+    for (heap_block_t* cur = heap_head; cur; cur = cur->next) {
+        if (cur->free || cur->quarantined) {
+            continue;
+        }
+        if (n < max) {
+            out[n].start = (uintptr_t)cur + sizeof(heap_block_t);
+            out[n].size = cur->meta.req;
+            out[n].meta = &cur->meta;
+        }
+        n++;
+    }
+    return n;
+}
+
+void heap_objects_end(void)
+{
+    heap_unlock(heap_debug_irql);
+}
+
+#endif /* CONFIG_KASAN */
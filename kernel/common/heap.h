@@ -15,4 +15,23 @@ void kfree(void* ptr);
 void* kcalloc(size_t count, size_t size);
 void* krealloc(void* ptr, size_t new_size);
 
+#ifdef CONFIG_KASAN
+#include "kasan.h"
+
+/* Live (allocated, not quarantined) block, as listed for kmemleak. */
+typedef struct heap_object {
+    uintptr_t start;
+    size_t size;
+    kasan_meta_t* meta;
+} heap_object_t;
+
+/*
+ * Lock the heap and list up to `max` live blocks; returns how many there
+ * are, which may exceed `max`. The heap stays locked, interrupts masked,
+ * until heap_objects_end(): nothing in between may allocate or free.
+ */
+uint32_t heap_objects_begin(heap_object_t* out, uint32_t max);
+void heap_objects_end(void);
+#endif
+
 #endif /* _RODNIX_COMMON_HEAP_H */
@@ -26,10 +26,12 @@ static port_t* port_table[IPC_MAX_PORTS];
 
 /*
  * LOCKING: g_port_table_lock (spinlock_t)
- *   Protects: port_table[], next_port_id, and port->ref_count mutations.
+ *   Protects: port_table[] updates and the final ref_count drop.
+ *   Lookups are lock-free (RCU): port_table[] slots are published with
+ *   rcu_assign_pointer, port_lookup_ref takes a reference with an atomic
+ *   increment-if-nonzero, and a port whose count reached zero is unpublished
+ *   under the lock and freed by call_rcu once no reader can still see it.
  *   Lock order: g_port_table_lock -> ipc_queue_t.lock (never reverse).
- *   Holders: port_allocate, port_deallocate, port_insert_send_right,
- *            port_insert_receive_right, ipc_send (refcount bump+push sequence).
  */
 static spinlock_t g_port_table_lock;
 
@@ -251,12 +253,22 @@ port_t* port_allocate(port_type_t type)
 
     int idx = port_table_index(port->port_id);
     if (idx >= 0) {
-        port_table[idx] = port;
+        spinlock_lock(&g_port_table_lock);
+        rcu_assign_pointer(port_table[idx], port);
+        spinlock_unlock(&g_port_table_lock);
     }
     
     return port;
 }
 
+static void port_free_rcu(rcu_head_t* head)
+{
+    port_t* port = rcu_entry(head, port_t, rcu);
+    ipc_queue_destroy((ipc_queue_t*)port->queue);
+    port->queue = NULL;
+    kfree(port);
+}
+
 void port_deallocate(port_t* port)
 {
     if (!port) {
@@ -265,32 +277,32 @@ void port_deallocate(port_t* port)
 
     spinlock_lock(&g_port_table_lock);
 
-    if (port->ref_count == 0) {
-        /* Underflow guard: caller has a bug. */
-        spinlock_unlock(&g_port_table_lock);
-        return;
-    }
-
-    port->ref_count--;
-    bool do_free = (port->ref_count == 0);
+    uint32_t ref = __atomic_load_n(&port->ref_count, __ATOMIC_RELAXED);
+    do {
+        if (ref == 0) {
+            /* Underflow guard: caller has a bug. */
+            spinlock_unlock(&g_port_table_lock);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&port->ref_count, &ref, ref - 1u, false,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    bool do_free = (ref == 1u);
 
     if (do_free) {
         port->active = false;
         int idx = port_table_index(port->port_id);
         if (idx >= 0 && port_table[idx] == port) {
-            port_table[idx] = NULL;
+            rcu_assign_pointer(port_table[idx], NULL);
         }
     }
 
     spinlock_unlock(&g_port_table_lock);
 
     if (do_free) {
-        /* Wake waiters and destroy queue outside the lock:
-         * waitq_wake_all and ipc_queue_destroy may acquire other locks. */
+        /* Wake waiters outside the lock; lock-free lookups may still hold
+         * the pointer, so the queue and the port go after a grace period. */
         waitq_wake_all(&port->waiters);
-        ipc_queue_destroy((ipc_queue_t*)port->queue);
-        port->queue = NULL;
-        kfree(port);
+        call_rcu(&port->rcu, port_free_rcu);
     }
 }
 
@@ -318,7 +330,29 @@ port_t* port_lookup(uint64_t port_id)
     if (idx < 0) {
         return NULL;
     }
-    return port_table[idx];
+    return rcu_dereference(port_table[idx]);
+}
+
+port_t* port_lookup_ref(uint64_t port_id)
+{
+    rcu_read_lock();
+    port_t* port = port_lookup(port_id);
+    if (port) {
+        uint32_t ref = __atomic_load_n(&port->ref_count, __ATOMIC_RELAXED);
+        for (;;) {
+            if (ref == 0 || !port->active) {
+                /* Lost the race with the last port_deallocate. */
+                port = NULL;
+                break;
+            }
+            if (__atomic_compare_exchange_n(&port->ref_count, &ref, ref + 1u, false,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+    }
+    rcu_read_unlock();
+    return port;
 }
 
 int port_insert_send_right(task_t* task, port_t* port)
@@ -330,7 +364,7 @@ int port_insert_send_right(task_t* task, port_t* port)
     /* TODO: Task port namespaces not implemented */
     (void)task;
     port->rights |= PORT_RIGHT_SEND;
-    port->ref_count++;
+    __atomic_fetch_add(&port->ref_count, 1u, __ATOMIC_RELAXED);
     return 0;
 }
 
@@ -343,7 +377,7 @@ int port_insert_receive_right(task_t* task, port_t* port)
     /* TODO: Task port namespaces not implemented */
     port->owner = task;
     port->rights |= PORT_RIGHT_RECEIVE;
-    port->ref_count++;
+    __atomic_fetch_add(&port->ref_count, 1u, __ATOMIC_RELAXED);
     return 0;
 }
 
@@ -373,34 +407,28 @@ int ipc_send(port_t* port, ipc_message_t* message, uint64_t timeout)
     if (!port->queue) {
         return RDNX_E_INVALID;
     }
-    /* Hold g_port_table_lock across validate-bump-push to prevent races
-     * with concurrent port_deallocate calls.  Rollback on any failure. */
-    spinlock_lock(&g_port_table_lock);
+    /* Each carried port gets a reference for the message; a port that is
+     * concurrently losing its last reference fails the lookup. Roll back on
+     * any failure. */
+    port_t* carried[IPC_MAX_PORTS_PER_MSG];
     uint32_t bumped = 0;
     for (uint32_t i = 0; i < message->port_count; i++) {
-        port_t* p = port_lookup(message->ports[i]);
-        if (!p || !p->active) {
-            /* Roll back refs already bumped in this loop */
+        port_t* p = port_lookup_ref(message->ports[i]);
+        if (!p) {
             for (uint32_t j = 0; j < bumped; j++) {
-                port_t* q = port_lookup(message->ports[j]);
-                if (q) q->ref_count--;
+                port_deallocate(carried[j]);
             }
-            spinlock_unlock(&g_port_table_lock);
             return RDNX_E_INVALID;
         }
-        p->ref_count++;
-        bumped++;
+        carried[bumped++] = p;
     }
     int qrc = ipc_queue_push((ipc_queue_t*)port->queue, message);
     if (qrc != 0) {
         for (uint32_t i = 0; i < bumped; i++) {
-            port_t* p = port_lookup(message->ports[i]);
-            if (p) p->ref_count--;
+            port_deallocate(carried[i]);
         }
-        spinlock_unlock(&g_port_table_lock);
         return RDNX_E_BUSY;
     }
-    spinlock_unlock(&g_port_table_lock);
 
     (void)waitq_wake_one(&port->waiters);
     ipc_wake_port_sets_for_port(port);
@@ -10,6 +10,7 @@
 
 #include "../core/task.h"
 #include "waitq.h"
+#include "rcu.h"
 #include "../../include/abi.h"
 #include <stdint.h>
 #include <stddef.h>
@@ -46,9 +47,10 @@ typedef struct port {
     task_t* owner;            /* Owning task */
     thread_t* owner_thread;   /* Owning thread (best-effort) */
     waitq_t waiters;          /* Blocked receiver wait queue */
-    uint32_t ref_count;       /* Reference count */
+    uint32_t ref_count;       /* Reference count (atomic) */
     void* queue;              /* Message queue */
     bool active;              /* Is port active */
+    rcu_head_t rcu;           /* Deferred free after the last reference */
 } port_t;
 
 /* ============================================================================
@@ -113,9 +115,19 @@ void port_deallocate(port_t* port);
  * Get port by ID
  * @param port_id Port identifier
  * @return Pointer to port or NULL if not found
+ *
+ * Lock-free: the caller must be inside rcu_read_lock(), and the port is
+ * only guaranteed to stay allocated until rcu_read_unlock().
  */
 port_t* port_lookup(uint64_t port_id);
 
+/**
+ * Get port by ID and take a reference
+ * @param port_id Port identifier
+ * @return Referenced active port (drop with port_deallocate) or NULL
+ */
+port_t* port_lookup_ref(uint64_t port_id);
+
 /**
  * Insert send right into task
  * @param task Target task
@@ -0,0 +1,357 @@
+/**
+ * @file kasan.c
+ * @brief Kernel address sanitizer: shadow memory, access checks, reports
+ *
+ * The shadow is one flat array covering the physmap window handed to
+ * kasan_init(); the heap and the PMM live there, so the kernel image,
+ * kmalloc blocks, kernel stacks and pages are all covered. Everything
+ * else passes the checks unseen.
+ *
+ * Nothing here is instrumented (see the Makefile): the checks must not
+ * check themselves. Reports are serialised by kasan_report_spin and turn
+ * all checks off while they print, because the console is instrumented.
+ *
+ * Stacks are walked through the rbp chain like lattrace.c does, bounded
+ * to 16KB above the starting frame and to the covered range, so a broken
+ * chain ends the walk instead of faulting.
+ */
+
+#include "kasan.h"
+#include "../core/interrupts.h"
+#include "../fabric/spin.h"
+#include "../../include/console.h"
+#include "../../include/debug.h"
+#include "../../include/error.h"
+
+#ifdef CONFIG_KASAN
+
+#define KASAN_UNWIND_SPAN 0x4000u
+
+static uint8_t* kasan_shadow = NULL;
+static uintptr_t kasan_start = 0;
+static uintptr_t kasan_end = 0;
+static volatile int kasan_on = 0;
+static volatile int kasan_in_report = 0;
+static volatile int kasan_expected = 0;
+static spinlock_t kasan_report_spin;
+static uint64_t kasan_reports = 0;
+static uint64_t kasan_bugs[KASAN_BUG_KINDS];
+
+static const char* const kasan_bug_names[KASAN_BUG_KINDS] = {
+    "slab-out-of-bounds",
+    "use-after-free",
+    "page-use-after-free",
+    "wild-heap-access",
+    "double-free",
+};
+
+void kasan_init(void* shadow, uintptr_t start, uintptr_t end)
+{
+    if (!shadow || end <= start) {
+        return;
+    }
+    spinlock_init(&kasan_report_spin);
+    kasan_shadow = (uint8_t*)shadow;
+    kasan_start = start;
+    kasan_end = end;
+    __asm__ volatile ("" ::: "memory");
+    kasan_on = 1;
+    kprintf("[KASAN] shadow %p covers %p..%p (%llu KB)\n", shadow, (void*)start, (void*)end,
+            (unsigned long long)(((end - start) >> KASAN_SHADOW_SHIFT) / 1024u));
+}
+
+bool kasan_ready(void)
+{
+    return kasan_on != 0;
+}
+
+void kasan_expect_reports(bool on)
+{
+    kasan_expected = on ? 1 : 0;
+}
+
+static inline uint8_t* kasan_shadow_of(uintptr_t addr)
+{
+    return &kasan_shadow[(addr - kasan_start) >> KASAN_SHADOW_SHIFT];
+}
+
+void kasan_poison(const void* addr, size_t size, uint8_t value)
+{
+    uintptr_t a = (uintptr_t)addr;
+    uintptr_t e = a + size;
+    if (!kasan_on || size == 0 || e <= kasan_start || a >= kasan_end) {
+        return;
+    }
+    if (a < kasan_start) {
+        a = kasan_start;
+    }
+    if (e > kasan_end || e < a) {
+        e = kasan_end;
+    }
+    uint8_t* s = kasan_shadow_of(a & ~(uintptr_t)(KASAN_GRANULE - 1u));
+    uint8_t* se = kasan_shadow_of((e + KASAN_GRANULE - 1u) & ~(uintptr_t)(KASAN_GRANULE - 1u));
+    while (s < se) {
+        *s++ = value;
+    }
+}
+
+void kasan_unpoison(const void* addr, size_t size)
+{
+    uintptr_t a = (uintptr_t)addr;
+    if (!kasan_on || size == 0 || a < kasan_start || a >= kasan_end) {
+        return;
+    }
+    if (size > kasan_end - a) {
+        size = kasan_end - a;
+    }
+    uint8_t* s = kasan_shadow_of(a);
+    for (size_t i = 0; i < (size >> KASAN_SHADOW_SHIFT); i++) {
+        s[i] = 0;
+    }
+    if (size & (KASAN_GRANULE - 1u)) {
+        s[size >> KASAN_SHADOW_SHIFT] = (uint8_t)(size & (KASAN_GRANULE - 1u));
+    }
+}
+
+uint8_t kasan_save_stack(uint64_t* ips, uint32_t max, uint32_t skip)
+{
+    uintptr_t rbp = (uintptr_t)__builtin_frame_address(0);
+    uintptr_t lo = rbp;
+    uintptr_t hi = rbp + KASAN_UNWIND_SPAN;
+    if (hi > kasan_end || rbp < kasan_start) {
+        hi = rbp + 16u;
+    }
+    uint32_t n = 0;
+    while (n < max && rbp >= lo && rbp + 16u <= hi && (rbp & 7u) == 0) {
+        uintptr_t next = ((const uintptr_t*)rbp)[0];
+        uintptr_t ret = ((const uintptr_t*)rbp)[1];
+        if (ret == 0) {
+            break;
+        }
+        if (skip) {
+            skip--;
+        } else {
+            ips[n++] = (uint64_t)ret;
+        }
+        if (next <= rbp) {
+            break;
+        }
+        rbp = next;
+    }
+    return (uint8_t)n;
+}
+
+void kasan_print_stack(const char* what, const uint64_t* ips, uint32_t n)
+{
+    kprintf("[KASAN] %s:\n", what);
+    if (n == 0) {
+        kputs("[KASAN]   (no frames)\n");
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        kprintf("[KASAN]   #%u %p\n", i, (void*)(uintptr_t)ips[i]);
+    }
+}
+
+/* Sixteen shadow bytes around the bad one, the bad one in brackets. */
+static void kasan_print_shadow(uintptr_t addr)
+{
+    static const char hex[] = "0123456789abcdef";
+    uintptr_t row = (addr & ~(uintptr_t)(KASAN_GRANULE * 16u - 1u));
+    if (row < kasan_start) {
+        row = kasan_start;
+    }
+    char line[16 * 4 + 1];
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < 16u; i++) {
+        uintptr_t g = row + (uintptr_t)i * KASAN_GRANULE;
+        if (g >= kasan_end) {
+            break;
+        }
+        uint8_t v = *kasan_shadow_of(g);
+        bool bad = (addr >= g && addr < g + KASAN_GRANULE);
+        line[k++] = bad ? '[' : ' ';
+        line[k++] = hex[v >> 4];
+        line[k++] = hex[v & 0xFu];
+        line[k++] = bad ? ']' : ' ';
+    }
+    line[k] = '\0';
+    kprintf("[KASAN] shadow at %p:%s\n", (void*)row, line);
+}
+
+static void kasan_report_begin(uint32_t kind, irql_t* old)
+{
+    *old = spinlock_lock_irqsave(&kasan_report_spin);
+    kasan_in_report = 1;
+    kasan_reports++;
+    kasan_bugs[kind]++;
+}
+
+static void kasan_report_end(irql_t old)
+{
+    kasan_in_report = 0;
+    spinlock_unlock_irqrestore(&kasan_report_spin, old);
+}
+
+static uint32_t kasan_classify(uint8_t shadow)
+{
+    switch (shadow) {
+    case KASAN_HEAP_FREED:
+        return KASAN_BUG_UAF;
+    case KASAN_PAGE_FREE:
+        return KASAN_BUG_PAGE_UAF;
+    case KASAN_HEAP_UNUSED:
+        return KASAN_BUG_WILD;
+    default:
+        return KASAN_BUG_OOB;   /* redzones and partial granules */
+    }
+}
+
+static void kasan_report(uintptr_t bad, size_t size, bool write, uintptr_t ip, uint8_t shadow)
+{
+    uint32_t kind = kasan_classify(shadow);
+    irql_t old;
+    kasan_report_begin(kind, &old);
+    if (kasan_reports <= KASAN_REPORT_MAX) {
+        /* Start at the instrumented caller, whatever got inlined or tail-called above it. */
+        uint64_t ips[KASAN_STACK_DEPTH + 4u];
+        uint32_t n = kasan_save_stack(ips, KASAN_STACK_DEPTH + 4u, 0);
+        uint32_t first = 0;
+        while (first < n && ips[first] != (uint64_t)ip) {
+            first++;
+        }
+        if (first == n) {
+            first = 0;
+        }
+        n -= first;
+        if (n > KASAN_STACK_DEPTH) {
+            n = KASAN_STACK_DEPTH;
+        }
+        kputs("[KASAN] ==================================================\n");
+        kprintf("[KASAN] %s: %s at ip %p\n", kasan_expected ? "self-test" : "BUG",
+                kasan_bug_names[kind], (void*)ip);
+        kprintf("[KASAN] %s of size %u at addr %p\n", write ? "write" : "read",
+                (unsigned)size, (void*)bad);
+        kasan_print_stack("access stack", ips + first, n);
+        if (kind == KASAN_BUG_PAGE_UAF) {
+            kprintf("[KASAN] page %p was freed to the PMM\n", (void*)(bad & ~(uintptr_t)0xFFFu));
+        } else {
+            heap_kasan_describe(bad);
+        }
+        kasan_print_shadow(bad);
+        kputs("[KASAN] ==================================================\n");
+    }
+    kasan_report_end(old);
+}
+
+void kasan_report_free(const void* ptr, const kasan_meta_t* meta, uintptr_t ip)
+{
+    irql_t old;
+    kasan_report_begin(KASAN_BUG_DOUBLE_FREE, &old);
+    uint64_t ips[KASAN_STACK_DEPTH];
+    uint32_t n = kasan_save_stack(ips, KASAN_STACK_DEPTH, 1u);
+    kputs("[KASAN] ==================================================\n");
+    kprintf("[KASAN] BUG: double-free of %p at ip %p\n", ptr, (void*)ip);
+    kasan_print_stack("free stack", ips, n);
+    if (meta) {
+        kprintf("[KASAN] object size %u\n", (unsigned)meta->req);
+        kasan_print_stack("allocated by", meta->alloc_ips, meta->alloc_depth);
+        kasan_print_stack("first freed by", meta->free_ips, meta->free_depth);
+    }
+    kputs("[KASAN] ==================================================\n");
+    kasan_report_end(old);
+}
+
+void kasan_check(uintptr_t addr, size_t size, bool write, uintptr_t ip)
+{
+    if (!kasan_on || kasan_in_report || size == 0) {
+        return;
+    }
+    uintptr_t last = addr + size - 1u;
+    if (addr < kasan_start || last >= kasan_end || last < addr) {
+        return;
+    }
+    for (uintptr_t g = addr & ~(uintptr_t)(KASAN_GRANULE - 1u); g <= last; g += KASAN_GRANULE) {
+        int8_t s = (int8_t)*kasan_shadow_of(g);
+        if (s == 0) {
+            continue;
+        }
+        uintptr_t from = g > addr ? g : addr;
+        uintptr_t to = (g + KASAN_GRANULE - 1u) < last ? (g + KASAN_GRANULE - 1u) : last;
+        if (s > 0) {
+            /* Partial granule: the first s bytes are valid. */
+            if ((to - g) < (uintptr_t)s) {
+                continue;
+            }
+            from = from > g + (uintptr_t)s ? from : g + (uintptr_t)s;
+        }
+        kasan_report(from, size, write, ip, (uint8_t)s);
+        return;
+    }
+}
+
+int kasan_get_stats(kasan_stats_t* out)
+{
+    if (!out) {
+        return RDNX_E_INVALID;
+    }
+    for (size_t i = 0; i < sizeof(*out); i++) {
+        ((uint8_t*)out)[i] = 0;
+    }
+    out->enabled = kasan_on ? 1u : 0u;
+    out->shadow_start = kasan_start;
+    out->shadow_end = kasan_end;
+    out->shadow_bytes = (kasan_end - kasan_start) >> KASAN_SHADOW_SHIFT;
+    out->reports = kasan_reports;
+    for (uint32_t i = 0; i < KASAN_BUG_KINDS; i++) {
+        out->bugs[i] = kasan_bugs[i];
+    }
+    heap_kasan_stats(out);
+    return RDNX_OK;
+}
+
+/* Compiler entry points (outline instrumentation, -fsanitize=kernel-address). */
+#define KASAN_DEFINE_ACCESS(n)                                              \
+    void __asan_load##n##_noabort(uintptr_t addr);                          \
+    void __asan_load##n##_noabort(uintptr_t addr)                           \
+    {                                                                       \
+        kasan_check(addr, n, false, (uintptr_t)__builtin_return_address(0)); \
+    }                                                                       \
+    void __asan_store##n##_noabort(uintptr_t addr);                         \
+    void __asan_store##n##_noabort(uintptr_t addr)                          \
+    {                                                                       \
+        kasan_check(addr, n, true, (uintptr_t)__builtin_return_address(0)); \
+    }
+
+KASAN_DEFINE_ACCESS(1)
+KASAN_DEFINE_ACCESS(2)
+KASAN_DEFINE_ACCESS(4)
+KASAN_DEFINE_ACCESS(8)
+KASAN_DEFINE_ACCESS(16)
+
+void __asan_loadN_noabort(uintptr_t addr, size_t size);
+void __asan_loadN_noabort(uintptr_t addr, size_t size)
+{
+    kasan_check(addr, size, false, (uintptr_t)__builtin_return_address(0));
+}
+
+void __asan_storeN_noabort(uintptr_t addr, size_t size);
+void __asan_storeN_noabort(uintptr_t addr, size_t size)
+{
+    kasan_check(addr, size, true, (uintptr_t)__builtin_return_address(0));
+}
+
+/* Only needed with stack instrumentation, which the kernel leaves off. */
+void __asan_handle_no_return(void);
+void __asan_handle_no_return(void)
+{
+}
+
+#else /* !CONFIG_KASAN */
+
+int kasan_get_stats(kasan_stats_t* out)
+{
+    (void)out;
+    return RDNX_E_UNSUPPORTED;
+}
+
+#endif /* CONFIG_KASAN */
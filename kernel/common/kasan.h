@@ -0,0 +1,127 @@
+/**
+ * @file kasan.h
+ * @brief Kernel address sanitizer (KASAN=1 builds)
+ *
+ * With KASAN=1 the kernel is compiled with -fsanitize=kernel-address in
+ * outline mode: every load and store calls __asan_{load,store}N_noabort(),
+ * which checks one shadow byte per 8-byte granule of the physmap:
+ *
+ *   0             all 8 bytes accessible
+ *   1..7          only the first N bytes accessible
+ *   KASAN_*       poisoned; the value says why (redzone, freed, ...)
+ *
+ * The heap (heap.c) poisons a redzone on both sides of every kmalloc
+ * block, keeps freed blocks poisoned in a quarantine before reusing them
+ * and records allocation and free stacks in the block header; the PMM
+ * poisons pages it frees. A bad access prints a report with the access,
+ * allocation and free stacks and execution continues.
+ *
+ * Addresses outside the covered range (user space, the module area, MMIO)
+ * and every access before kasan_init() are not checked. Without KASAN=1
+ * the hooks below compile away and kasan_get_stats() and the self-test
+ * return RDNX_E_UNSUPPORTED.
+ */
+
+#ifndef _RODNIX_COMMON_KASAN_H
+#define _RODNIX_COMMON_KASAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define KASAN_SHADOW_SHIFT  3
+#define KASAN_GRANULE       (1u << KASAN_SHADOW_SHIFT)
+#define KASAN_STACK_DEPTH   8
+#define KASAN_REPORT_MAX    64      /* printed reports; later ones are only counted */
+
+/* Shadow values of poisoned granules. */
+#define KASAN_PAGE_FREE     0xFFu   /* page returned to the PMM */
+#define KASAN_HEAP_FREED    0xFDu   /* kfree()d block in quarantine */
+#define KASAN_HEAP_UNUSED   0xFCu   /* heap free list, never handed out as is */
+#define KASAN_HEAP_RIGHT    0xFBu   /* redzone after a kmalloc block */
+#define KASAN_HEAP_LEFT     0xFAu   /* block header, redzone before a block */
+
+/* kasan() ops; all of them need root. */
+enum {
+    KASAN_OP_INFO       = 1,    /* kasan_stats_t */
+    KASAN_OP_SELFTEST   = 2,    /* run kasan_selftest() */
+    KASAN_OP_LEAK_SCAN  = 3,    /* kmemleak_scan() into a record array */
+    KASAN_OP_LEAK_CLEAR = 4,    /* kmemleak_clear() */
+};
+
+#define KASAN_LEAK_SCAN_MAX 256u   /* records per kasan(KASAN_OP_LEAK_SCAN) call */
+
+/* Report kinds, as counted in kasan_stats_t. */
+enum {
+    KASAN_BUG_OOB = 0,          /* heap out-of-bounds (either redzone) */
+    KASAN_BUG_UAF,              /* heap use-after-free */
+    KASAN_BUG_PAGE_UAF,         /* access to a freed page */
+    KASAN_BUG_WILD,             /* heap memory that is not allocated */
+    KASAN_BUG_DOUBLE_FREE,      /* kfree() of a freed block */
+    KASAN_BUG_KINDS
+};
+
+/* Allocation record kept in every kmalloc block header. */
+typedef struct kasan_meta {
+    size_t req;                         /* bytes asked for */
+    uint64_t alloc_ticks;
+    uint64_t alloc_ips[KASAN_STACK_DEPTH];
+    uint64_t free_ips[KASAN_STACK_DEPTH];
+    uint8_t alloc_depth;
+    uint8_t free_depth;
+    uint8_t leak;                       /* kmemleak state, see kmemleak.c */
+    uint8_t reserved[5];
+} kasan_meta_t;
+
+typedef struct kasan_stats {
+    uint64_t enabled;
+    uint64_t shadow_start;              /* covered range */
+    uint64_t shadow_end;
+    uint64_t shadow_bytes;
+    uint64_t reports;
+    uint64_t bugs[KASAN_BUG_KINDS];
+    uint64_t quarantine_bytes;
+    uint64_t quarantine_objects;
+    uint64_t heap_objects;              /* live kmalloc blocks */
+    uint64_t heap_bytes;                /* bytes asked for by live blocks */
+} kasan_stats_t;
+
+int kasan_get_stats(kasan_stats_t* out);
+/* Instrumented self-test (kasan_test.c): 0 if every bad access was caught. */
+int kasan_selftest(void);
+
+#ifdef CONFIG_KASAN
+
+/* Cover [start, end) with the zeroed shadow at `shadow` ((end - start) / 8 bytes). */
+void kasan_init(void* shadow, uintptr_t start, uintptr_t end);
+bool kasan_ready(void);
+/* Poison [addr, addr + size), rounded out to granules. */
+void kasan_poison(const void* addr, size_t size, uint8_t value);
+/* Make [addr, addr + size) accessible; addr must be granule-aligned. */
+void kasan_unpoison(const void* addr, size_t size);
+void kasan_check(uintptr_t addr, size_t size, bool write, uintptr_t ip);
+/* Return addresses of the callers, `skip` frames above the caller. */
+uint8_t kasan_save_stack(uint64_t* ips, uint32_t max, uint32_t skip);
+void kasan_print_stack(const char* what, const uint64_t* ips, uint32_t n);
+/* Self-test reports say "self-test:" instead of "BUG:", so CI logs stay clean. */
+void kasan_expect_reports(bool on);
+/* Double or invalid kfree(): report with the object's stacks, then panic. */
+void kasan_report_free(const void* ptr, const kasan_meta_t* meta, uintptr_t ip);
+
+/* heap.c: describe the block around a bad address in a report. */
+void heap_kasan_describe(uintptr_t addr);
+void heap_kasan_stats(kasan_stats_t* out);
+
+#define kasan_poison_pages(virt, count) \
+    kasan_poison((virt), (size_t)(count) * PAGE_SIZE, KASAN_PAGE_FREE)
+#define kasan_unpoison_pages(virt, count) \
+    kasan_unpoison((virt), (size_t)(count) * PAGE_SIZE)
+
+#else
+
+#define kasan_poison_pages(virt, count) ((void)(virt), (void)(count))
+#define kasan_unpoison_pages(virt, count) ((void)(virt), (void)(count))
+
+#endif /* CONFIG_KASAN */
+
+#endif /* _RODNIX_COMMON_KASAN_H */
@@ -0,0 +1,268 @@
+/**
+ * @file kmemleak.c
+ * @brief Unreferenced kmalloc block scanner
+ *
+ * The whole scan runs with the heap locked (heap_objects_begin()), so no
+ * block can appear, move or vanish under it; the price is that kmalloc()
+ * on every CPU waits for the scan. The block list is copied into pages
+ * taken straight from the PMM, sorted by address and searched with a
+ * binary search per scanned word; the same pages hold the stack of blocks
+ * still to scan. Per-block state lives in kasan_meta_t.leak.
+ *
+ * Not instrumented (see the Makefile): the scan reads every word of the
+ * roots and blocks, redzones and padding included.
+ */
+
+#include "kmemleak.h"
+#include "heap.h"
+#include "scheduler.h"
+#include "../core/config.h"
+#include "../core/memory.h"
+#include "../fabric/spin.h"
+#include "../../include/common.h"
+#include "../../include/console.h"
+#include "../../include/error.h"
+
+#ifdef CONFIG_KASAN
+
+#define KMEMLEAK_SEEN     0x1u   /* referenced, current scan */
+#define KMEMLEAK_REPORTED 0x2u   /* already printed on the console */
+#define KMEMLEAK_IGNORED  0x4u   /* live at kmemleak_clear() */
+
+#define KMEMLEAK_SLACK    256u   /* room for blocks allocated while sizing */
+#define KMEMLEAK_RETRIES  4
+
+typedef struct kmemleak_root {
+    uintptr_t start;
+    size_t size;
+} kmemleak_root_t;
+
+/* link.ld */
+extern char __data_start[];
+extern char __data_end[];
+extern char __bss_start[];
+extern char __bss_end[];
+
+static kmemleak_root_t kml_roots[KMEMLEAK_ROOTS_MAX];
+static spinlock_t kml_root_spin;
+
+typedef struct kml_scan {
+    heap_object_t* objs;
+    uint32_t* stack;
+    uint32_t n;
+    uint32_t sp;
+    uint32_t pages;
+    uintptr_t lo;
+    uintptr_t hi;
+} kml_scan_t;
+
+void kmemleak_add_root(const void* start, size_t size)
+{
+    if (!start || size == 0) {
+        return;
+    }
+    irql_t old = spinlock_lock_irqsave(&kml_root_spin);
+    for (uint32_t i = 0; i < KMEMLEAK_ROOTS_MAX; i++) {
+        if (kml_roots[i].size == 0) {
+            kml_roots[i].start = (uintptr_t)start;
+            kml_roots[i].size = size;
+            spinlock_unlock_irqrestore(&kml_root_spin, old);
+            return;
+        }
+    }
+    spinlock_unlock_irqrestore(&kml_root_spin, old);
+    kprintf("[KMEMLEAK] root table full, %p not scanned\n", start);
+}
+
+void kmemleak_remove_root(const void* start)
+{
+    irql_t old = spinlock_lock_irqsave(&kml_root_spin);
+    for (uint32_t i = 0; i < KMEMLEAK_ROOTS_MAX; i++) {
+        if (kml_roots[i].start == (uintptr_t)start) {
+            kml_roots[i].start = 0;
+            kml_roots[i].size = 0;
+        }
+    }
+    spinlock_unlock_irqrestore(&kml_root_spin, old);
+}
+
+/*
+ * Size the scratch pages, then list the live blocks into them with the
+ * heap locked. On success the heap stays locked until kml_end().
+ */
+static int kml_begin(kml_scan_t* s)
+{
+    for (int attempt = 0; attempt < KMEMLEAK_RETRIES; attempt++) {
+        uint32_t want = heap_objects_begin(NULL, 0);
+        heap_objects_end();
+        uint32_t cap = want + KMEMLEAK_SLACK;
+        size_t bytes = (size_t)cap * (sizeof(heap_object_t) + sizeof(uint32_t));
+        s->pages = (uint32_t)(ALIGN_UP(bytes, PAGE_SIZE) / PAGE_SIZE);
+        s->objs = (heap_object_t*)vmm_alloc_pages(s->pages, PAGE_FLAG_WRITABLE);
+        if (!s->objs) {
+            return RDNX_E_NOMEM;
+        }
+        s->stack = (uint32_t*)(s->objs + cap);
+        s->n = heap_objects_begin(s->objs, cap);
+        if (s->n <= cap) {
+            s->sp = 0;
+            return RDNX_OK;
+        }
+        heap_objects_end();
+        vmm_free_pages(s->objs, s->pages);
+    }
+    return RDNX_E_BUSY;
+}
+
+static void kml_end(kml_scan_t* s)
+{
+    heap_objects_end();
+    vmm_free_pages(s->objs, s->pages);
+}
+
+static void kml_sort(kml_scan_t* s)
+{
+    static const uint32_t gaps[] = { 1750u, 701u, 301u, 132u, 57u, 23u, 10u, 4u, 1u };
+    for (uint32_t g = 0; g < sizeof(gaps) / sizeof(gaps[0]); g++) {
+        uint32_t gap = gaps[g];
+        for (uint32_t i = gap; i < s->n; i++) {
+            heap_object_t tmp = s->objs[i];
+            uint32_t j = i;
+            while (j >= gap && s->objs[j - gap].start > tmp.start) {
+                s->objs[j] = s->objs[j - gap];
+                j -= gap;
+            }
+            s->objs[j] = tmp;
+        }
+    }
+    s->lo = s->n ? s->objs[0].start : 0;
+    s->hi = s->n ? s->objs[s->n - 1u].start + s->objs[s->n - 1u].size : 0;
+}
+
+static void kml_scan_range(kml_scan_t* s, uintptr_t start, size_t size)
+{
+    uintptr_t p = ALIGN_UP(start, sizeof(uintptr_t));
+    uintptr_t end = start + size;
+    for (; p + sizeof(uintptr_t) <= end; p += sizeof(uintptr_t)) {
+        uintptr_t v = *(const volatile uintptr_t*)p;
+        if (v < s->lo || v >= s->hi) {
+            continue;
+        }
+        uint32_t lo = 0;
+        uint32_t hi = s->n;
+        while (hi - lo > 1u) {
+            uint32_t mid = lo + (hi - lo) / 2u;
+            if (s->objs[mid].start <= v) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        heap_object_t* o = &s->objs[lo];
+        if (v < o->start || v >= o->start + o->size || (o->meta->leak & KMEMLEAK_SEEN)) {
+            continue;
+        }
+        o->meta->leak |= KMEMLEAK_SEEN;
+        s->stack[s->sp++] = lo;
+    }
+}
+
+int kmemleak_scan(kmemleak_record_t* out, uint32_t max)
+{
+    if (!kasan_ready()) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    if (max && !out) {
+        return RDNX_E_INVALID;
+    }
+    kml_scan_t s;
+    int rc = kml_begin(&s);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    kml_sort(&s);
+    for (uint32_t i = 0; i < s.n; i++) {
+        s.objs[i].meta->leak &= (uint8_t)~KMEMLEAK_SEEN;
+    }
+
+    kml_scan_range(&s, (uintptr_t)__data_start, (size_t)(__data_end - __data_start));
+    kml_scan_range(&s, (uintptr_t)__bss_start, (size_t)(__bss_end - __bss_start));
+    irql_t old = spinlock_lock_irqsave(&kml_root_spin);
+    for (uint32_t i = 0; i < KMEMLEAK_ROOTS_MAX; i++) {
+        if (kml_roots[i].size) {
+            kml_scan_range(&s, kml_roots[i].start, kml_roots[i].size);
+        }
+    }
+    spinlock_unlock_irqrestore(&kml_root_spin, old);
+    while (s.sp) {
+        heap_object_t* o = &s.objs[s.stack[--s.sp]];
+        kml_scan_range(&s, o->start, o->size);
+    }
+
+    uint64_t now = scheduler_get_ticks();
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < s.n; i++) {
+        kasan_meta_t* m = s.objs[i].meta;
+        if ((m->leak & (KMEMLEAK_SEEN | KMEMLEAK_IGNORED)) || now - m->alloc_ticks < KMEMLEAK_MIN_AGE_TICKS) {
+            continue;
+        }
+        if (found < max) {
+            kmemleak_record_t* r = &out[found];
+            r->addr = s.objs[i].start;
+            r->size = s.objs[i].size;
+            r->age_ticks = now - m->alloc_ticks;
+            r->flags = (m->leak & KMEMLEAK_REPORTED) ? 0u : KMEMLEAK_REC_NEW;
+            r->depth = m->alloc_depth;
+            for (uint32_t k = 0; k < KASAN_STACK_DEPTH; k++) {
+                r->ips[k] = k < m->alloc_depth ? m->alloc_ips[k] : 0;
+            }
+            m->leak |= KMEMLEAK_REPORTED;
+        }
+        found++;
+    }
+    kml_end(&s);
+
+    /* Print outside the heap lock; blocks beyond `max` wait for the next scan. */
+    for (uint32_t i = 0; i < found && i < max; i++) {
+        if (!(out[i].flags & KMEMLEAK_REC_NEW)) {
+            continue;
+        }
+        kprintf("[KMEMLEAK] unreferenced object %p size %u age %llu ticks\n", (void*)(uintptr_t)out[i].addr,
+                (unsigned)out[i].size, (unsigned long long)out[i].age_ticks);
+        kasan_print_stack("allocated by", out[i].ips, out[i].depth);
+    }
+    return (int)found;
+}
+
+int kmemleak_clear(void)
+{
+    if (!kasan_ready()) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    kml_scan_t s;
+    int rc = kml_begin(&s);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    for (uint32_t i = 0; i < s.n; i++) {
+        s.objs[i].meta->leak |= KMEMLEAK_IGNORED;
+    }
+    kml_end(&s);
+    return RDNX_OK;
+}
+
+#else /* !CONFIG_KASAN */
+
+int kmemleak_scan(kmemleak_record_t* out, uint32_t max)
+{
+    (void)out;
+    (void)max;
+    return RDNX_E_UNSUPPORTED;
+}
+
+int kmemleak_clear(void)
+{
+    return RDNX_E_UNSUPPORTED;
+}
+
+#endif /* CONFIG_KASAN */
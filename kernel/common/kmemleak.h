@@ -0,0 +1,53 @@
+/**
+ * @file kmemleak.h
+ * @brief Unreferenced kmalloc block scanner (KASAN=1 builds)
+ *
+ * A scan marks every live kmalloc block that a pointer-sized, aligned word
+ * in a root refers to (start or interior), then scans the marked blocks
+ * the same way until nothing new is found. Roots are the kernel's .data
+ * and .bss plus ranges registered with kmemleak_add_root() (module data).
+ * Kernel stacks are kmalloc blocks reachable from their threads, so they
+ * are scanned as ordinary blocks. A block nothing refers to and older than
+ * KMEMLEAK_MIN_AGE_TICKS is reported, on the console the first time it
+ * is seen and in the caller's buffer on every scan.
+ *
+ * Pointers kept only in PMM pages, in physical form or in user memory
+ * are invisible to the scan, so a report is a lead, not a verdict.
+ */
+
+#ifndef _RODNIX_COMMON_KMEMLEAK_H
+#define _RODNIX_COMMON_KMEMLEAK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "kasan.h"
+
+#define KMEMLEAK_MIN_AGE_TICKS 500u     /* 5 s at 100 Hz */
+#define KMEMLEAK_ROOTS_MAX     32u
+
+#define KMEMLEAK_REC_NEW       0x1u     /* first scan to find this block */
+
+/* One unreferenced block; mirrors rodnix_kmemleak_record_t. */
+typedef struct kmemleak_record {
+    uint64_t addr;
+    uint64_t size;
+    uint64_t age_ticks;
+    uint32_t flags;
+    uint32_t depth;
+    uint64_t ips[KASAN_STACK_DEPTH];
+} kmemleak_record_t;
+
+/* Scan; fill up to `max` records and return the number of unreferenced blocks. */
+int kmemleak_scan(kmemleak_record_t* out, uint32_t max);
+/* Never report the blocks that are live now. */
+int kmemleak_clear(void);
+
+#ifdef CONFIG_KASAN
+void kmemleak_add_root(const void* start, size_t size);
+void kmemleak_remove_root(const void* start);
+#else
+#define kmemleak_add_root(start, size) ((void)(start), (void)(size))
+#define kmemleak_remove_root(start) ((void)(start))
+#endif
+
+#endif /* _RODNIX_COMMON_KMEMLEAK_H */
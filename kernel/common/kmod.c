@@ -1,24 +1,93 @@
+/**
+ * @file kmod.c
+ * @brief Kernel module registry and ELF module loader
+ *
+ * Loading a module, in order: read the file, check the ELF and the
+ * .rodnix_mod header, load missing .rodnix_deps from KMOD_PATH, lay the
+ * SHF_ALLOC sections out as three page-aligned groups (text, rodata, data)
+ * in fresh module-area pages mapped RW, bind undefined symbols through
+ * ksymtab with version checks, apply RELA relocations, then drop write
+ * access from text and rodata and execute access from everything but text.
+ * Only after that are the module's own exports published and its init run.
+ *
+ * Registry lookups by name go through a small hash; a slot is committed
+ * only once its module loaded, so a failed load leaves nothing behind.
+ * Unloaded slots stay listed and are reused when the module comes back.
+ * g_kmod_lock serialises load and unload, including the nested loads of
+ * dependencies; module init/fini run under it and must not load modules.
+ */
+
 #include "kmod.h"
 
 #include "../../include/common.h"
+#include "../../include/console.h"
 #include "../../include/error.h"
+#include "../core/config.h"
+#include "../core/memory.h"
 #include "../fs/vfs.h"
 #include "elf.h"
 #include "heap.h"
+#include "kmemleak.h"
+#include "ksymtab.h"
+#include "mutex.h"
+
+#define KMOD_IMAGE_MAX (1024u * 1024u)
+#define KMOD_MEM_MAX   (16u * 1024u * 1024u)
+#define KMOD_HASH_SIZE 64u
 
 typedef struct {
     int used;
     kmod_info_t info;
-    void* image_mem;
-    uint64_t image_mem_size;
+    uint64_t base;              /* module area mapping, 0 for header-only images */
+    uint32_t pages;
+    uint32_t refcount;
+    uint64_t data;              /* RW segment, registered as a kmemleak root */
     int (*mod_init)(void);
     void (*mod_fini)(void);
+    uint8_t deps[KMOD_DEPS_MAX];
+    int hash_next;
 } kmod_slot_t;
 
+/* Groups of SHF_ALLOC sections, each mapped with its own protection. */
+enum {
+    KMOD_SEG_TEXT = 0,
+    KMOD_SEG_RO   = 1,
+    KMOD_SEG_RW   = 2,
+    KMOD_SEG_COUNT
+};
+
+typedef struct {
+    const uint8_t* image;
+    uint64_t size;
+    const elf64_ehdr_t* eh;
+    const elf64_shdr_t* sh;
+    const elf64_sym_t* syms;
+    uint64_t nsyms;
+    const char* strtab;
+    uint64_t strtab_size;
+    int sym_sec;
+    const kmod_modversion_t* versions;
+    uint32_t nversions;
+    const kmod_dep_t* deps;
+    uint32_t ndeps;
+    int ksymtab_sec;
+    uint64_t* sec_addr;         /* runtime address per section, 0 if not loaded */
+    uint64_t* sym_addr;         /* resolved value per symbol */
+    uint64_t seg_off[KMOD_SEG_COUNT];
+    uint64_t seg_size[KMOD_SEG_COUNT];
+    uint8_t providers[KMOD_DEPS_MAX];
+    uint32_t nproviders;
+} kmod_elf_t;
+
 static kmod_slot_t g_kmods[KMOD_MAX];
 static uint32_t g_kmod_count = 0;
+static int g_kmod_hash[KMOD_HASH_SIZE];
+static uint8_t g_kmod_area_map[KMOD_AREA_PAGES / 8u];
+static mutex_t g_kmod_lock;
 static int g_kmod_inited = 0;
 
+static int kmod_load_locked(const char* path, uint32_t depth);
+
 static void kmod_copy_text(char* dst, uint32_t cap, const char* src)
 {
     if (!dst || cap == 0) {
@@ -32,47 +101,71 @@ static void kmod_copy_text(char* dst, uint32_t cap, const char* src)
     dst[cap - 1u] = '\0';
 }
 
+static int kmod_terminated(const char* s, uint32_t cap)
+{
+    for (uint32_t i = 0; i < cap; i++) {
+        if (s[i] == '\0') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t kmod_name_hash(const char* name)
+{
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h & (KMOD_HASH_SIZE - 1u);
+}
+
 static int kmod_find_slot(const char* name)
 {
     if (!name || !name[0]) {
         return -1;
     }
-    for (uint32_t i = 0; i < g_kmod_count; i++) {
-        if (g_kmods[i].used && strcmp(g_kmods[i].info.name, name) == 0) {
-            return (int)i;
+    for (int i = g_kmod_hash[kmod_name_hash(name)]; i >= 0; i = g_kmods[i].hash_next) {
+        if (strcmp(g_kmods[i].info.name, name) == 0) {
+            return i;
         }
     }
     return -1;
 }
 
-static int kmod_add_slot(const char* name,
-                         const char* kind,
-                         const char* version,
-                         uint32_t flags,
-                         uint8_t builtin,
-                         uint8_t loaded,
-                         void* image_mem,
-                         uint64_t image_mem_size,
-                         int (*mod_init)(void),
-                         void (*mod_fini)(void))
+/* Slot for a module about to be loaded: its old slot, or the next free one. */
+static int kmod_pick_slot(const char* name)
+{
+    int idx = kmod_find_slot(name);
+    if (idx >= 0) {
+        return (g_kmods[idx].info.loaded || g_kmods[idx].info.builtin) ? RDNX_E_BUSY : idx;
+    }
+    return (g_kmod_count < KMOD_MAX) ? (int)g_kmod_count : RDNX_E_BUSY;
+}
+
+static void kmod_commit_slot(int idx,
+                             const char* name,
+                             const char* kind,
+                             const char* version,
+                             uint32_t flags,
+                             uint8_t builtin)
 {
-    if (g_kmod_count >= KMOD_MAX) {
-        return RDNX_E_BUSY;
+    kmod_slot_t* slot = &g_kmods[idx];
+    if ((uint32_t)idx == g_kmod_count) {
+        slot->used = 1;
+        memset(&slot->info, 0, sizeof(slot->info));
+        kmod_copy_text(slot->info.name, sizeof(slot->info.name), name);
+        uint32_t h = kmod_name_hash(slot->info.name);
+        slot->hash_next = g_kmod_hash[h];
+        g_kmod_hash[h] = idx;
+        g_kmod_count++;
     }
-    kmod_slot_t* slot = &g_kmods[g_kmod_count++];
-    slot->used = 1;
-    memset(&slot->info, 0, sizeof(slot->info));
-    kmod_copy_text(slot->info.name, sizeof(slot->info.name), name);
     kmod_copy_text(slot->info.kind, sizeof(slot->info.kind), kind ? kind : "misc");
     kmod_copy_text(slot->info.version, sizeof(slot->info.version), version ? version : "0");
     slot->info.flags = flags;
     slot->info.builtin = builtin;
-    slot->info.loaded = loaded;
-    slot->image_mem = image_mem;
-    slot->image_mem_size = image_mem_size;
-    slot->mod_init = mod_init;
-    slot->mod_fini = mod_fini;
-    return RDNX_OK;
+    slot->info.loaded = 1u;
 }
 
 static int kmod_validate_header(const kmod_image_header_t* hdr)
@@ -83,258 +176,535 @@ static int kmod_validate_header(const kmod_image_header_t* hdr)
     if (memcmp(hdr->magic, KMOD_IMAGE_MAGIC, KMOD_IMAGE_MAGIC_LEN) != 0) {
         return RDNX_E_INVALID;
     }
-    if (hdr->name[0] == '\0') {
+    if (hdr->name[0] == '\0' || !kmod_terminated(hdr->name, sizeof(hdr->name))) {
         return RDNX_E_INVALID;
     }
     return RDNX_OK;
 }
 
-static int kmod_parse_elf_module(const uint8_t* image,
-                                 uint64_t size,
-                                 kmod_image_header_t* out_hdr,
-                                 void** out_image_mem,
-                                 uint64_t* out_image_mem_size,
-                                 int (**out_init)(void),
-                                 void (**out_fini)(void))
+/* ============================================================================
+ * Module area
+ * ============================================================================ */
+
+static uint64_t kmod_area_alloc(uint32_t pages)
 {
-    if (!image || !out_hdr || !out_image_mem || !out_image_mem_size || !out_init || !out_fini) {
-        return RDNX_E_INVALID;
+    uint32_t run = 0;
+    for (uint32_t i = 0; i < KMOD_AREA_PAGES; i++) {
+        if (g_kmod_area_map[i / 8u] & (1u << (i % 8u))) {
+            run = 0;
+            continue;
+        }
+        if (++run == pages) {
+            uint32_t first = i + 1u - pages;
+            for (uint32_t j = first; j <= i; j++) {
+                g_kmod_area_map[j / 8u] |= (uint8_t)(1u << (j % 8u));
+            }
+            return KMOD_AREA_BASE + (uint64_t)first * PAGE_SIZE;
+        }
+    }
+    return 0;
+}
+
+static void kmod_area_free(uint64_t base, uint32_t pages)
+{
+    uint32_t first = (uint32_t)((base - KMOD_AREA_BASE) / PAGE_SIZE);
+    for (uint32_t j = first; j < first + pages; j++) {
+        g_kmod_area_map[j / 8u] &= (uint8_t)~(1u << (j % 8u));
     }
-    *out_image_mem = NULL;
-    *out_image_mem_size = 0;
-    *out_init = NULL;
-    *out_fini = NULL;
+}
+
+static void kmod_unmap(uint64_t base, uint32_t pages)
+{
+    for (uint32_t i = 0; i < pages; i++) {
+        uint64_t va = base + (uint64_t)i * PAGE_SIZE;
+        uint64_t phys = page_get_physical(va);
+        (void)page_unmap(va);
+        if (phys) {
+            pmm_free_page(phys & ~(uint64_t)(PAGE_SIZE - 1));
+        }
+    }
+    kmod_area_free(base, pages);
+}
+
+/* Back the range with zeroed pages, mapped RW+NX until kmod_protect(). */
+static uint64_t kmod_map(uint32_t pages)
+{
+    uint64_t base = kmod_area_alloc(pages);
+    if (!base) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < pages; i++) {
+        uint64_t va = base + (uint64_t)i * PAGE_SIZE;
+        uint64_t phys = pmm_alloc_page();
+        if (!phys || page_map(va, phys, PAGE_FLAG_PRESENT | PAGE_FLAG_WRITABLE, PAGE_TYPE_4KB) != 0) {
+            if (phys) {
+                pmm_free_page(phys);
+            }
+            kmod_unmap(base, i);
+            kmod_area_free(base, pages);
+            return 0;
+        }
+        memset((void*)(uintptr_t)va, 0, PAGE_SIZE);
+    }
+    return base;
+}
+
+static void kmod_protect(uint64_t start, uint64_t size, uint64_t flags)
+{
+    for (uint64_t off = 0; off < size; off += PAGE_SIZE) {
+        uint64_t phys = page_get_physical(start + off);
+        (void)page_map(start + off, phys & ~(uint64_t)(PAGE_SIZE - 1), flags, PAGE_TYPE_4KB);
+    }
+}
+
+/* ============================================================================
+ * ELF modules
+ * ============================================================================ */
 
-    const elf64_ehdr_t* eh = (const elf64_ehdr_t*)image;
-    if (eh->e_magic != ELF_MAGIC ||
+static int kmod_sec_in_image(const kmod_elf_t* m, const elf64_shdr_t* sec)
+{
+    if (sec->sh_type == SHT_NOBITS || sec->sh_size == 0) {
+        return 1;
+    }
+    return sec->sh_offset < m->size && sec->sh_size <= m->size - sec->sh_offset;
+}
+
+static int kmod_elf_open(kmod_elf_t* m, kmod_image_header_t* out_hdr)
+{
+    const elf64_ehdr_t* eh = (const elf64_ehdr_t*)m->image;
+    if (m->size < sizeof(*eh) ||
+        eh->e_magic != ELF_MAGIC ||
         eh->e_class != ELFCLASS64 ||
         eh->e_data != ELFDATA2LSB ||
-        eh->e_type != ET_REL) {
+        eh->e_type != ET_REL ||
+        eh->e_machine != EM_X86_64) {
         return RDNX_E_INVALID;
     }
-    if (eh->e_shoff == 0 || eh->e_shnum == 0 || eh->e_shentsize != sizeof(elf64_shdr_t)) {
+    if (eh->e_shoff == 0 || eh->e_shnum == 0 || eh->e_shentsize != sizeof(elf64_shdr_t) ||
+        eh->e_shstrndx >= eh->e_shnum) {
         return RDNX_E_INVALID;
     }
-    if (eh->e_shstrndx >= eh->e_shnum) {
-        return RDNX_E_INVALID;
-    }
-
     uint64_t sht_end = eh->e_shoff + ((uint64_t)eh->e_shnum * sizeof(elf64_shdr_t));
-    if (sht_end > size) {
+    if (eh->e_shoff >= m->size || sht_end > m->size) {
         return RDNX_E_INVALID;
     }
-    const elf64_shdr_t* sh = (const elf64_shdr_t*)(image + eh->e_shoff);
-    const elf64_shdr_t* shstr = &sh[eh->e_shstrndx];
-    if (shstr->sh_type != SHT_STRTAB ||
-        shstr->sh_offset >= size ||
-        (shstr->sh_offset + shstr->sh_size) > size) {
+    m->eh = eh;
+    m->sh = (const elf64_shdr_t*)(m->image + eh->e_shoff);
+    const elf64_shdr_t* shstr = &m->sh[eh->e_shstrndx];
+    if (shstr->sh_type != SHT_STRTAB || !kmod_sec_in_image(m, shstr)) {
         return RDNX_E_INVALID;
     }
-    const char* shstrtab = (const char*)(image + shstr->sh_offset);
+    const char* shstrtab = (const char*)(m->image + shstr->sh_offset);
 
     int mod_sec = -1;
-    int sym_sec = -1;
+    m->sym_sec = -1;
+    m->ksymtab_sec = -1;
     for (uint16_t i = 0; i < eh->e_shnum; i++) {
-        const elf64_shdr_t* sec = &sh[i];
-        if (sec->sh_name < shstr->sh_size) {
-            const char* sec_name = shstrtab + sec->sh_name;
-            if (strcmp(sec_name, ".rodnix_mod") == 0) {
-                mod_sec = (int)i;
-            }
+        const elf64_shdr_t* sec = &m->sh[i];
+        if (!kmod_sec_in_image(m, sec)) {
+            return RDNX_E_INVALID;
         }
         if (sec->sh_type == SHT_SYMTAB) {
-            sym_sec = (int)i;
+            m->sym_sec = (int)i;
+        }
+        if (sec->sh_name >= shstr->sh_size) {
+            continue;
+        }
+        const char* sec_name = shstrtab + sec->sh_name;
+        if (strcmp(sec_name, ".rodnix_mod") == 0) {
+            mod_sec = (int)i;
+        } else if (strcmp(sec_name, ".rodnix_versions") == 0 && sec->sh_type == SHT_PROGBITS) {
+            m->versions = (const kmod_modversion_t*)(m->image + sec->sh_offset);
+            m->nversions = (uint32_t)(sec->sh_size / sizeof(kmod_modversion_t));
+        } else if (strcmp(sec_name, ".rodnix_deps") == 0 && sec->sh_type == SHT_PROGBITS) {
+            m->deps = (const kmod_dep_t*)(m->image + sec->sh_offset);
+            m->ndeps = (uint32_t)(sec->sh_size / sizeof(kmod_dep_t));
+        } else if (strcmp(sec_name, ".kmod_ksymtab") == 0 && (sec->sh_flags & SHF_ALLOC)) {
+            m->ksymtab_sec = (int)i;
         }
     }
     if (mod_sec < 0) {
         return RDNX_E_NOTFOUND;
     }
-
-    const elf64_shdr_t* ms = &sh[mod_sec];
-    if (ms->sh_offset >= size ||
-        (ms->sh_offset + ms->sh_size) > size ||
-        ms->sh_size < sizeof(kmod_image_header_t)) {
+    const elf64_shdr_t* ms = &m->sh[mod_sec];
+    if (ms->sh_type == SHT_NOBITS || ms->sh_size < sizeof(kmod_image_header_t)) {
         return RDNX_E_INVALID;
     }
-    memcpy(out_hdr, image + ms->sh_offset, sizeof(kmod_image_header_t));
+    memcpy(out_hdr, m->image + ms->sh_offset, sizeof(kmod_image_header_t));
     int rc = kmod_validate_header(out_hdr);
     if (rc != RDNX_OK) {
         return rc;
     }
 
-    for (uint16_t i = 0; i < eh->e_shnum; i++) {
-        const elf64_shdr_t* sec = &sh[i];
-        if ((sec->sh_type == SHT_RELA || sec->sh_type == SHT_REL) &&
-            sec->sh_size != 0 &&
-            sec->sh_info < eh->e_shnum &&
-            (sh[sec->sh_info].sh_flags & SHF_ALLOC)) {
-            return RDNX_E_UNSUPPORTED;
+    if (m->sym_sec >= 0) {
+        const elf64_shdr_t* ss = &m->sh[m->sym_sec];
+        if (ss->sh_entsize != sizeof(elf64_sym_t) || ss->sh_link >= eh->e_shnum ||
+            m->sh[ss->sh_link].sh_type != SHT_STRTAB) {
+            return RDNX_E_INVALID;
         }
+        m->syms = (const elf64_sym_t*)(m->image + ss->sh_offset);
+        m->nsyms = ss->sh_size / sizeof(elf64_sym_t);
+        m->strtab = (const char*)(m->image + m->sh[ss->sh_link].sh_offset);
+        m->strtab_size = m->sh[ss->sh_link].sh_size;
     }
+    return RDNX_OK;
+}
 
-    uint64_t* sec_runtime = (uint64_t*)kmalloc((uint64_t)eh->e_shnum * sizeof(uint64_t));
-    if (!sec_runtime) {
-        return RDNX_E_NOMEM;
+static int kmod_load_deps(const kmod_elf_t* m, uint32_t depth)
+{
+    for (uint32_t i = 0; i < m->ndeps; i++) {
+        const char* dep = m->deps[i].name;
+        if (!kmod_terminated(dep, sizeof(m->deps[i].name)) || !dep[0] ||
+            dep[0] == '.' || strchr(dep, '/')) {
+            return RDNX_E_INVALID;
+        }
+        int idx = kmod_find_slot(dep);
+        if (idx >= 0 && g_kmods[idx].info.loaded) {
+            continue;
+        }
+        /* Also stops dependency cycles. */
+        if (depth >= KMOD_DEP_DEPTH_MAX) {
+            kprintf("kmod: dependency chain too deep at %s\n", dep);
+            return RDNX_E_BUSY;
+        }
+        char path[sizeof(KMOD_PATH) + KMOD_NAME_MAX + 4];
+        size_t n = strlen(KMOD_PATH);
+        memcpy(path, KMOD_PATH, n);
+        path[n++] = '/';
+        size_t dl = strlen(dep);
+        memcpy(path + n, dep, dl);
+        memcpy(path + n + dl, ".ko", 4);
+        int rc = kmod_load_locked(path, depth + 1u);
+        if (rc != RDNX_OK) {
+            kprintf("kmod: cannot load dependency %s (rc=%d)\n", dep, rc);
+            return rc;
+        }
     }
-    memset(sec_runtime, 0, (uint64_t)eh->e_shnum * sizeof(uint64_t));
+    return RDNX_OK;
+}
 
-    uint64_t total = 0;
-    for (uint16_t i = 0; i < eh->e_shnum; i++) {
-        const elf64_shdr_t* sec = &sh[i];
+static uint32_t kmod_sec_seg(const elf64_shdr_t* sec)
+{
+    if (sec->sh_flags & SHF_EXECINSTR) {
+        return KMOD_SEG_TEXT;
+    }
+    return (sec->sh_flags & SHF_WRITE) ? KMOD_SEG_RW : KMOD_SEG_RO;
+}
+
+/* Offsets of every SHF_ALLOC section inside its group; returns total pages. */
+static int kmod_elf_layout(kmod_elf_t* m, uint32_t* out_pages)
+{
+    uint64_t cursor[KMOD_SEG_COUNT] = {0, 0, 0};
+    for (uint16_t i = 0; i < m->eh->e_shnum; i++) {
+        const elf64_shdr_t* sec = &m->sh[i];
         if ((sec->sh_flags & SHF_ALLOC) == 0 || sec->sh_size == 0) {
             continue;
         }
         uint64_t align = sec->sh_addralign ? sec->sh_addralign : 1u;
-        uint64_t aligned = (total + align - 1u) & ~(align - 1u);
-        if (aligned < total) {
-            kfree(sec_runtime);
+        if ((align & (align - 1u)) != 0 || align > PAGE_SIZE) {
             return RDNX_E_INVALID;
         }
-        total = aligned + sec->sh_size;
-        if (total > (16u * 1024u * 1024u)) {
-            kfree(sec_runtime);
+        uint32_t seg = kmod_sec_seg(sec);
+        uint64_t off = (cursor[seg] + align - 1u) & ~(align - 1u);
+        if (sec->sh_size > KMOD_MEM_MAX || off + sec->sh_size > KMOD_MEM_MAX) {
             return RDNX_E_NOMEM;
         }
+        m->sec_addr[i] = off;       /* made absolute by kmod_elf_place() */
+        cursor[seg] = off + sec->sh_size;
     }
-
-    void* image_mem = NULL;
-    if (total > 0) {
-        image_mem = kmalloc((size_t)total);
-        if (!image_mem) {
-            kfree(sec_runtime);
-            return RDNX_E_NOMEM;
-        }
-        memset(image_mem, 0, (size_t)total);
+    uint64_t total = 0;
+    for (uint32_t s = 0; s < KMOD_SEG_COUNT; s++) {
+        m->seg_off[s] = total;
+        m->seg_size[s] = (cursor[s] + PAGE_SIZE - 1u) & ~(uint64_t)(PAGE_SIZE - 1);
+        total += m->seg_size[s];
+    }
+    if (total > KMOD_MEM_MAX) {
+        return RDNX_E_NOMEM;
     }
+    *out_pages = (uint32_t)(total / PAGE_SIZE);
+    return RDNX_OK;
+}
 
-    uint64_t cursor = 0;
-    for (uint16_t i = 0; i < eh->e_shnum; i++) {
-        const elf64_shdr_t* sec = &sh[i];
+static void kmod_elf_place(kmod_elf_t* m, uint64_t base)
+{
+    for (uint16_t i = 0; i < m->eh->e_shnum; i++) {
+        const elf64_shdr_t* sec = &m->sh[i];
         if ((sec->sh_flags & SHF_ALLOC) == 0 || sec->sh_size == 0) {
             continue;
         }
-        uint64_t align = sec->sh_addralign ? sec->sh_addralign : 1u;
-        cursor = (cursor + align - 1u) & ~(align - 1u);
-        sec_runtime[i] = (uint64_t)(uintptr_t)image_mem + cursor;
+        m->sec_addr[i] += base + m->seg_off[kmod_sec_seg(sec)];
         if (sec->sh_type != SHT_NOBITS) {
-            if (sec->sh_offset >= size || (sec->sh_offset + sec->sh_size) > size) {
-                if (image_mem) {
-                    kfree(image_mem);
-                }
-                kfree(sec_runtime);
-                return RDNX_E_INVALID;
-            }
-            memcpy((void*)(uintptr_t)sec_runtime[i], image + sec->sh_offset, (size_t)sec->sh_size);
+            memcpy((void*)(uintptr_t)m->sec_addr[i], m->image + sec->sh_offset, (size_t)sec->sh_size);
         }
-        cursor += sec->sh_size;
     }
+}
 
-    if (sym_sec >= 0) {
-        const elf64_shdr_t* ss = &sh[sym_sec];
-        if (ss->sh_entsize != sizeof(elf64_sym_t) ||
-            ss->sh_offset >= size ||
-            (ss->sh_offset + ss->sh_size) > size ||
-            ss->sh_link >= eh->e_shnum) {
-            if (image_mem) {
-                kfree(image_mem);
-            }
-            kfree(sec_runtime);
-            return RDNX_E_INVALID;
+static const kmod_modversion_t* kmod_find_version(const kmod_elf_t* m, const char* name)
+{
+    for (uint32_t i = 0; i < m->nversions; i++) {
+        if (strncmp(m->versions[i].name, name, KMOD_SYM_NAME_MAX) == 0) {
+            return &m->versions[i];
         }
-        const elf64_shdr_t* strsec = &sh[ss->sh_link];
-        if (strsec->sh_type != SHT_STRTAB ||
-            strsec->sh_offset >= size ||
-            (strsec->sh_offset + strsec->sh_size) > size) {
-            if (image_mem) {
-                kfree(image_mem);
-            }
-            kfree(sec_runtime);
-            return RDNX_E_INVALID;
+    }
+    return NULL;
+}
+
+static int kmod_add_provider(kmod_elf_t* m, int owner)
+{
+    for (uint32_t i = 0; i < m->nproviders; i++) {
+        if (m->providers[i] == (uint8_t)owner) {
+            return RDNX_OK;
         }
+    }
+    if (m->nproviders >= KMOD_DEPS_MAX) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    m->providers[m->nproviders++] = (uint8_t)owner;
+    return RDNX_OK;
+}
 
-        const elf64_sym_t* syms = (const elf64_sym_t*)(image + ss->sh_offset);
-        uint64_t sym_count = ss->sh_size / sizeof(elf64_sym_t);
-        const char* strtab = (const char*)(image + strsec->sh_offset);
-        for (uint64_t i = 0; i < sym_count; i++) {
-            const elf64_sym_t* sym = &syms[i];
-            if (sym->st_name >= strsec->sh_size) {
-                continue;
-            }
-            if (sym->st_shndx == SHN_UNDEF || sym->st_shndx >= eh->e_shnum) {
-                continue;
+/* Resolve every symbol; imports must carry the CRC their export has. */
+static int kmod_elf_bind(kmod_elf_t* m, const char* modname)
+{
+    for (uint64_t i = 1; i < m->nsyms; i++) {
+        const elf64_sym_t* sym = &m->syms[i];
+        const char* nm = (sym->st_name < m->strtab_size) ? m->strtab + sym->st_name : "";
+        if (sym->st_shndx == SHN_ABS) {
+            m->sym_addr[i] = sym->st_value;
+            continue;
+        }
+        if (sym->st_shndx == SHN_COMMON) {
+            kprintf("kmod: %s: common symbol %s (build with -fno-common)\n", modname, nm);
+            return RDNX_E_UNSUPPORTED;
+        }
+        if (sym->st_shndx != SHN_UNDEF) {
+            if (sym->st_shndx >= m->eh->e_shnum) {
+                return RDNX_E_INVALID;
             }
-            if (sec_runtime[sym->st_shndx] == 0) {
+            m->sym_addr[i] = m->sec_addr[sym->st_shndx] + sym->st_value;
+            continue;
+        }
+        if (!nm[0]) {
+            continue;
+        }
+        int owner = KSYMTAB_KERNEL;
+        const kmod_symbol_t* ks = ksymtab_lookup(nm, &owner);
+        if (!ks) {
+            if (ELF64_ST_BIND(sym->st_info) == STB_WEAK) {
+                m->sym_addr[i] = 0;
                 continue;
             }
-            const char* nm = strtab + sym->st_name;
-            uint64_t addr = sec_runtime[sym->st_shndx] + sym->st_value;
-            if (strcmp(nm, "rodnix_kmod_init") == 0) {
-                *out_init = (int (*)(void))(uintptr_t)addr;
-            } else if (strcmp(nm, "rodnix_kmod_fini") == 0) {
-                *out_fini = (void (*)(void))(uintptr_t)addr;
+            kprintf("kmod: %s: unknown symbol %s\n", modname, nm);
+            return RDNX_E_NOTFOUND;
+        }
+        const kmod_modversion_t* ver = kmod_find_version(m, nm);
+        if (!ver) {
+            kprintf("kmod: %s: no version for %s\n", modname, nm);
+            return RDNX_E_INVALID;
+        }
+        if (ver->crc != ks->crc) {
+            kprintf("kmod: %s: disagrees about version of symbol %s\n", modname, nm);
+            return RDNX_E_INVALID;
+        }
+        if (owner != KSYMTAB_KERNEL) {
+            int rc = kmod_add_provider(m, owner);
+            if (rc != RDNX_OK) {
+                return rc;
             }
         }
+        m->sym_addr[i] = (uint64_t)(uintptr_t)ks->addr;
     }
-
-    kfree(sec_runtime);
-    *out_image_mem = image_mem;
-    *out_image_mem_size = total;
     return RDNX_OK;
 }
 
-int kmod_init(void)
+static int kmod_elf_relocate(kmod_elf_t* m)
 {
-    for (uint32_t i = 0; i < KMOD_MAX; i++) {
-        g_kmods[i].used = 0;
-        memset(&g_kmods[i].info, 0, sizeof(g_kmods[i].info));
-        g_kmods[i].image_mem = NULL;
-        g_kmods[i].image_mem_size = 0;
-        g_kmods[i].mod_init = NULL;
-        g_kmods[i].mod_fini = NULL;
+    for (uint16_t s = 0; s < m->eh->e_shnum; s++) {
+        const elf64_shdr_t* rs = &m->sh[s];
+        if ((rs->sh_type != SHT_RELA && rs->sh_type != SHT_REL) || rs->sh_size == 0) {
+            continue;
+        }
+        if (rs->sh_info >= m->eh->e_shnum) {
+            return RDNX_E_INVALID;
+        }
+        const elf64_shdr_t* target = &m->sh[rs->sh_info];
+        if ((target->sh_flags & SHF_ALLOC) == 0) {
+            continue;   /* debug info */
+        }
+        if (rs->sh_type == SHT_REL) {
+            return RDNX_E_UNSUPPORTED;
+        }
+        if ((int)rs->sh_link != m->sym_sec || rs->sh_entsize != sizeof(elf64_rela_t)) {
+            return RDNX_E_INVALID;
+        }
+        const elf64_rela_t* rel = (const elf64_rela_t*)(m->image + rs->sh_offset);
+        uint64_t count = rs->sh_size / sizeof(elf64_rela_t);
+        for (uint64_t r = 0; r < count; r++) {
+            uint32_t type = ELF64_R_TYPE(rel[r].r_info);
+            uint32_t symi = ELF64_R_SYM(rel[r].r_info);
+            if (type == R_X86_64_NONE) {
+                continue;
+            }
+            uint32_t width = (type == R_X86_64_64 || type == R_X86_64_PC64) ? 8u : 4u;
+            if (symi >= m->nsyms || rel[r].r_offset > target->sh_size ||
+                target->sh_size - rel[r].r_offset < width) {
+                return RDNX_E_INVALID;
+            }
+            uint64_t p = m->sec_addr[rs->sh_info] + rel[r].r_offset;
+            uint64_t v = m->sym_addr[symi] + (uint64_t)rel[r].r_addend;
+            switch (type) {
+            case R_X86_64_64:
+                *(uint64_t*)(uintptr_t)p = v;
+                break;
+            case R_X86_64_PC64:
+                *(uint64_t*)(uintptr_t)p = v - p;
+                break;
+            case R_X86_64_PC32:
+            case R_X86_64_PLT32: {
+                int64_t d = (int64_t)(v - p);
+                if (d != (int64_t)(int32_t)d) {
+                    return RDNX_E_INVALID;
+                }
+                *(uint32_t*)(uintptr_t)p = (uint32_t)d;
+                break;
+            }
+            case R_X86_64_32:
+                if (v != (uint64_t)(uint32_t)v) {
+                    return RDNX_E_INVALID;
+                }
+                *(uint32_t*)(uintptr_t)p = (uint32_t)v;
+                break;
+            case R_X86_64_32S:
+                if ((int64_t)v != (int64_t)(int32_t)v) {
+                    return RDNX_E_INVALID;
+                }
+                *(uint32_t*)(uintptr_t)p = (uint32_t)v;
+                break;
+            default:
+                return RDNX_E_UNSUPPORTED;
+            }
+        }
     }
-    g_kmod_count = 0;
-    g_kmod_inited = 1;
     return RDNX_OK;
 }
 
-int kmod_register_builtin(const char* name, const char* kind, const char* version, uint32_t flags)
+static int kmod_load_elf(const uint8_t* image, uint64_t size, uint32_t depth)
 {
-    if (!g_kmod_inited || !name || !name[0]) {
-        return RDNX_E_INVALID;
+    kmod_elf_t m;
+    memset(&m, 0, sizeof(m));
+    m.image = image;
+    m.size = size;
+    kmod_image_header_t hdr;
+    int rc = kmod_elf_open(&m, &hdr);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    rc = kmod_pick_slot(hdr.name);
+    if (rc < 0) {
+        return rc;
+    }
+    rc = kmod_load_deps(&m, depth);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    /* Dependencies took slots of their own. */
+    int idx = kmod_pick_slot(hdr.name);
+    if (idx < 0) {
+        return idx;
     }
 
-    int idx = kmod_find_slot(name);
-    if (idx >= 0) {
-        g_kmods[idx].info.builtin = 1u;
-        g_kmods[idx].info.loaded = 1u;
-        return RDNX_OK;
+    m.sec_addr = (uint64_t*)kcalloc(m.eh->e_shnum, sizeof(uint64_t));
+    m.sym_addr = (uint64_t*)kcalloc(m.nsyms ? m.nsyms : 1u, sizeof(uint64_t));
+    if (!m.sec_addr || !m.sym_addr) {
+        kfree(m.sec_addr);
+        kfree(m.sym_addr);
+        return RDNX_E_NOMEM;
+    }
+    uint32_t pages = 0;
+    uint64_t base = 0;
+    rc = kmod_elf_layout(&m, &pages);
+    if (rc == RDNX_OK && pages) {
+        base = kmod_map(pages);
+        rc = base ? RDNX_OK : RDNX_E_NOMEM;
+    }
+    if (rc == RDNX_OK) {
+        kmod_elf_place(&m, base);
+        rc = kmod_elf_bind(&m, hdr.name);
+    }
+    if (rc == RDNX_OK) {
+        rc = kmod_elf_relocate(&m);
     }
-    return kmod_add_slot(name, kind, version, flags, 1u, 1u, NULL, 0, NULL, NULL);
-}
 
-int kmod_get_info(uint32_t index, kmod_info_t* out)
-{
-    if (!out || index >= g_kmod_count || !g_kmods[index].used) {
-        return RDNX_E_NOTFOUND;
+    int (*mod_init)(void) = NULL;
+    void (*mod_fini)(void) = NULL;
+    const kmod_symbol_t* exports = NULL;
+    uint32_t nexports = 0;
+    if (rc == RDNX_OK) {
+        for (uint64_t i = 1; i < m.nsyms; i++) {
+            const elf64_sym_t* sym = &m.syms[i];
+            if (sym->st_shndx == SHN_UNDEF || sym->st_name >= m.strtab_size) {
+                continue;
+            }
+            const char* nm = m.strtab + sym->st_name;
+            if (strcmp(nm, "rodnix_kmod_init") == 0) {
+                mod_init = (int (*)(void))(uintptr_t)m.sym_addr[i];
+            } else if (strcmp(nm, "rodnix_kmod_fini") == 0) {
+                mod_fini = (void (*)(void))(uintptr_t)m.sym_addr[i];
+            }
+        }
+        if (m.ksymtab_sec >= 0) {
+            exports = (const kmod_symbol_t*)(uintptr_t)m.sec_addr[m.ksymtab_sec];
+            nexports = (uint32_t)(m.sh[m.ksymtab_sec].sh_size / sizeof(kmod_symbol_t));
+        }
+        /* W^X: text RO+X, rodata RO, data stays RW; all but text NX. */
+        kmod_protect(base + m.seg_off[KMOD_SEG_TEXT], m.seg_size[KMOD_SEG_TEXT],
+                     PAGE_FLAG_PRESENT | PAGE_FLAG_EXECUTE);
+        kmod_protect(base + m.seg_off[KMOD_SEG_RO], m.seg_size[KMOD_SEG_RO], PAGE_FLAG_PRESENT);
+        /* Module globals may hold the only pointer to what init allocates. */
+        kmemleak_add_root((const void*)(uintptr_t)(base + m.seg_off[KMOD_SEG_RW]), m.seg_size[KMOD_SEG_RW]);
+        rc = ksymtab_add(exports, nexports, idx);
+        if (rc == RDNX_E_BUSY) {
+            kprintf("kmod: %s: exports a symbol that already exists\n", hdr.name);
+        }
+    }
+    if (rc == RDNX_OK && mod_init && mod_init() != 0) {
+        ksymtab_remove_owner(idx);
+        rc = RDNX_E_GENERIC;
+    }
+    kfree(m.sec_addr);
+    kfree(m.sym_addr);
+    if (rc != RDNX_OK) {
+        if (base) {
+            kmemleak_remove_root((const void*)(uintptr_t)(base + m.seg_off[KMOD_SEG_RW]));
+            kmod_unmap(base, pages);
+        }
+        return rc;
     }
-    *out = g_kmods[index].info;
-    return RDNX_OK;
-}
 
-uint32_t kmod_count(void)
-{
-    return g_kmod_count;
+    kmod_commit_slot(idx, hdr.name, hdr.kind, hdr.version, hdr.flags, 0u);
+    kmod_slot_t* slot = &g_kmods[idx];
+    slot->base = base;
+    slot->pages = pages;
+    slot->data = base ? base + m.seg_off[KMOD_SEG_RW] : 0;
+    slot->mod_init = mod_init;
+    slot->mod_fini = mod_fini;
+    slot->refcount = 0;
+    for (uint32_t i = 0; i < m.nproviders; i++) {
+        kmod_slot_t* p = &g_kmods[m.providers[i]];
+        slot->deps[i] = m.providers[i];
+        p->refcount++;
+        p->info.refs = (uint8_t)(p->refcount > 255u ? 255u : p->refcount);
+    }
+    slot->info.ndeps = (uint8_t)m.nproviders;
+    slot->info.refs = 0;
+    return RDNX_OK;
 }
 
-int kmod_load(const char* path)
+static int kmod_load_locked(const char* path, uint32_t depth)
 {
-    if (!g_kmod_inited || !path || !path[0]) {
-        return RDNX_E_INVALID;
-    }
-
     vfs_stat_t st;
     int rc = vfs_stat(path, &st);
-    if (rc != RDNX_OK || st.size == 0 || st.size > (1024u * 1024u)) {
+    if (rc != RDNX_OK || st.size == 0 || st.size > KMOD_IMAGE_MAX) {
         return (rc == RDNX_OK) ? RDNX_E_INVALID : rc;
     }
 
@@ -356,82 +726,140 @@ int kmod_load(const char* path)
         return RDNX_E_INVALID;
     }
 
-    kmod_image_header_t hdr;
-    memset(&hdr, 0, sizeof(hdr));
-    void* mod_image_mem = NULL;
-    uint64_t mod_image_mem_size = 0;
-    int (*mod_init)(void) = NULL;
-    void (*mod_fini)(void) = NULL;
     if ((uint64_t)n >= sizeof(kmod_image_header_t) &&
         memcmp(image, KMOD_IMAGE_MAGIC, KMOD_IMAGE_MAGIC_LEN) == 0) {
+        /* Header-only registration image (scripts/mkkmod.py). */
+        kmod_image_header_t hdr;
         memcpy(&hdr, image, sizeof(hdr));
         rc = kmod_validate_header(&hdr);
+        int idx = (rc == RDNX_OK) ? kmod_pick_slot(hdr.name) : rc;
+        if (idx >= 0) {
+            kmod_commit_slot(idx, hdr.name, hdr.kind, hdr.version, hdr.flags, 0u);
+            g_kmods[idx].base = 0;
+            g_kmods[idx].pages = 0;
+            g_kmods[idx].mod_init = NULL;
+            g_kmods[idx].mod_fini = NULL;
+            g_kmods[idx].info.ndeps = 0;
+        }
+        rc = (idx >= 0) ? RDNX_OK : idx;
     } else {
-        rc = kmod_parse_elf_module(image,
-                                   (uint64_t)n,
-                                   &hdr,
-                                   &mod_image_mem,
-                                   &mod_image_mem_size,
-                                   &mod_init,
-                                   &mod_fini);
+        rc = kmod_load_elf(image, (uint64_t)n, depth);
     }
     kfree(image);
+    return rc;
+}
+
+int kmod_init(void)
+{
+    for (uint32_t i = 0; i < KMOD_MAX; i++) {
+        memset(&g_kmods[i], 0, sizeof(g_kmods[i]));
+        g_kmods[i].hash_next = -1;
+    }
+    for (uint32_t i = 0; i < KMOD_HASH_SIZE; i++) {
+        g_kmod_hash[i] = -1;
+    }
+    memset(g_kmod_area_map, 0, sizeof(g_kmod_area_map));
+    g_kmod_count = 0;
+    mutex_init(&g_kmod_lock, "kmod");
+    int rc = ksymtab_init();
     if (rc != RDNX_OK) {
         return rc;
     }
+    g_kmod_inited = 1;
+    return RDNX_OK;
+}
 
-    int idx = kmod_find_slot(hdr.name);
-    if (idx >= 0) {
-        if (mod_image_mem) {
-            kfree(mod_image_mem);
-        }
-        return RDNX_E_BUSY;
+int kmod_register_builtin(const char* name, const char* kind, const char* version, uint32_t flags)
+{
+    if (!g_kmod_inited || !name || !name[0]) {
+        return RDNX_E_INVALID;
     }
 
-    if (mod_init) {
-        int init_rc = mod_init();
-        if (init_rc != 0) {
-            if (mod_image_mem) {
-                kfree(mod_image_mem);
-            }
-            return RDNX_E_GENERIC;
-        }
+    mutex_lock(&g_kmod_lock);
+    int idx = kmod_find_slot(name);
+    if (idx >= 0) {
+        g_kmods[idx].info.builtin = 1u;
+        g_kmods[idx].info.loaded = 1u;
+        mutex_unlock(&g_kmod_lock);
+        return RDNX_OK;
     }
-
-    return kmod_add_slot(hdr.name,
-                         hdr.kind,
-                         hdr.version,
-                         hdr.flags,
-                         0u,
-                         1u,
-                         mod_image_mem,
-                         mod_image_mem_size,
-                         mod_init,
-                         mod_fini);
+    int rc = RDNX_E_BUSY;
+    if (g_kmod_count < KMOD_MAX) {
+        kmod_commit_slot((int)g_kmod_count, name, kind, version, flags, 1u);
+        rc = RDNX_OK;
+    }
+    mutex_unlock(&g_kmod_lock);
+    return rc;
 }
 
-int kmod_unload(const char* name)
+int kmod_get_info(uint32_t index, kmod_info_t* out)
 {
-    int idx = kmod_find_slot(name);
-    if (idx < 0) {
+    if (!out || index >= g_kmod_count || !g_kmods[index].used) {
         return RDNX_E_NOTFOUND;
     }
-    if (g_kmods[idx].info.builtin) {
-        return RDNX_E_DENIED;
+    *out = g_kmods[index].info;
+    return RDNX_OK;
+}
+
+uint32_t kmod_count(void)
+{
+    return g_kmod_count;
+}
+
+int kmod_load(const char* path)
+{
+    if (!g_kmod_inited || !path || !path[0]) {
+        return RDNX_E_INVALID;
     }
-    if (!g_kmods[idx].info.loaded) {
+    mutex_lock(&g_kmod_lock);
+    int rc = kmod_load_locked(path, 0);
+    mutex_unlock(&g_kmod_lock);
+    return rc;
+}
+
+int kmod_unload(const char* name)
+{
+    if (!g_kmod_inited) {
         return RDNX_E_INVALID;
     }
-    if (g_kmods[idx].mod_fini) {
-        g_kmods[idx].mod_fini();
+    mutex_lock(&g_kmod_lock);
+    int idx = kmod_find_slot(name);
+    int rc = RDNX_OK;
+    if (idx < 0) {
+        rc = RDNX_E_NOTFOUND;
+    } else if (g_kmods[idx].info.builtin) {
+        rc = RDNX_E_DENIED;
+    } else if (!g_kmods[idx].info.loaded) {
+        rc = RDNX_E_INVALID;
+    } else if (g_kmods[idx].refcount) {
+        rc = RDNX_E_BUSY;
     }
-    if (g_kmods[idx].image_mem) {
-        kfree(g_kmods[idx].image_mem);
-        g_kmods[idx].image_mem = NULL;
-        g_kmods[idx].image_mem_size = 0;
+    if (rc != RDNX_OK) {
+        mutex_unlock(&g_kmod_lock);
+        return rc;
     }
-    g_kmods[idx].mod_init = NULL;
-    g_kmods[idx].mod_fini = NULL;
-    g_kmods[idx].info.loaded = 0u;
+
+    kmod_slot_t* slot = &g_kmods[idx];
+    if (slot->mod_fini) {
+        slot->mod_fini();
+    }
+    ksymtab_remove_owner(idx);
+    for (uint32_t i = 0; i < slot->info.ndeps; i++) {
+        kmod_slot_t* p = &g_kmods[slot->deps[i]];
+        p->refcount--;
+        p->info.refs = (uint8_t)(p->refcount > 255u ? 255u : p->refcount);
+    }
+    if (slot->base) {
+        kmemleak_remove_root((const void*)(uintptr_t)slot->data);
+        kmod_unmap(slot->base, slot->pages);
+    }
+    slot->base = 0;
+    slot->data = 0;
+    slot->pages = 0;
+    slot->mod_init = NULL;
+    slot->mod_fini = NULL;
+    slot->info.ndeps = 0u;
+    slot->info.loaded = 0u;
+    mutex_unlock(&g_kmod_lock);
     return RDNX_OK;
 }
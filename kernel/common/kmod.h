@@ -1,10 +1,37 @@
+/**
+ * @file kmod.h
+ * @brief Kernel module registry and ELF module loader
+ *
+ * Loadable modules are ET_REL objects with a .rodnix_mod header. The
+ * loader lays their sections out in the module area with W^X protection
+ * (text RO+X, rodata RO+NX, data RW+NX), applies RELA relocations and
+ * binds undefined symbols through the export hash table (ksymtab.h), after
+ * checking each import's version CRC against the export. Modules named in
+ * .rodnix_deps are loaded on demand from KMOD_PATH/<name>.ko. A module
+ * holds a reference on every module it binds to, and a module with
+ * references cannot be unloaded.
+ *
+ * EXPORT_SYMBOL() (kmod_abi.h) publishes a kernel or module symbol; the
+ * KSYMCRC_* versions of kernel exports come from kmod_symvers.h, which
+ * scripts/mkksymvers.py regenerates on every build.
+ */
+
 #ifndef _RODNIX_KMOD_H
 #define _RODNIX_KMOD_H
 
 #include <stdint.h>
 #include "../../include/kmod_abi.h"
+#include "../../include/kmod_symvers.h"
 
 #define KMOD_MAX 32
+#define KMOD_DEPS_MAX 8          /* modules one module may bind to */
+#define KMOD_DEP_DEPTH_MAX 4     /* nested on-demand dependency loads */
+#define KMOD_PATH "/lib/modules"
+
+/* Module area: 4KB-mapped, inside the top 2GB so -mcmodel=kernel
+ * relocations reach the kernel, above the physmap and below MMIO. */
+#define KMOD_AREA_BASE  0xFFFFFFFFA0000000ull
+#define KMOD_AREA_PAGES 16384u   /* 64MB */
 
 typedef struct kmod_info {
     char name[32];
@@ -13,8 +40,8 @@ typedef struct kmod_info {
     uint32_t flags;
     uint8_t builtin;
     uint8_t loaded;
-    uint8_t reserved0;
-    uint8_t reserved1;
+    uint8_t refs;       /* loaded modules bound to this one (saturates) */
+    uint8_t ndeps;      /* modules this one is bound to */
 } kmod_info_t;
 
 int kmod_init(void);
@@ -0,0 +1,137 @@
+/**
+ * @file ksymtab.c
+ * @brief Exported symbol hash table
+ *
+ * Chained hash over FNV-1a of the symbol name. Every ksymtab_add() call
+ * allocates one block of nodes, so removing a module's exports unlinks
+ * and frees exactly the block it added.
+ */
+
+#include "ksymtab.h"
+#include "heap.h"
+#include "../../include/common.h"
+#include "../../include/error.h"
+
+typedef struct ksym_node {
+    const kmod_symbol_t* sym;
+    struct ksym_node* next;
+    int owner;
+} ksym_node_t;
+
+typedef struct ksym_block {
+    struct ksym_block* next;
+    int owner;
+    uint32_t count;
+    ksym_node_t nodes[];
+} ksym_block_t;
+
+/* link.ld */
+extern const kmod_symbol_t __kmod_ksymtab_start[];
+extern const kmod_symbol_t __kmod_ksymtab_end[];
+
+static ksym_node_t* ksym_buckets[KSYMTAB_BUCKETS];
+static ksym_block_t* ksym_blocks = NULL;
+static uint32_t ksym_total = 0;
+
+static uint32_t ksym_hash(const char* name)
+{
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h & (KSYMTAB_BUCKETS - 1u);
+}
+
+const kmod_symbol_t* ksymtab_lookup(const char* name, int* out_owner)
+{
+    if (!name || !name[0]) {
+        return NULL;
+    }
+    for (ksym_node_t* n = ksym_buckets[ksym_hash(name)]; n; n = n->next) {
+        if (strcmp(n->sym->name, name) == 0) {
+            if (out_owner) {
+                *out_owner = n->owner;
+            }
+            return n->sym;
+        }
+    }
+    return NULL;
+}
+
+int ksymtab_add(const kmod_symbol_t* syms, uint32_t count, int owner)
+{
+    if (count == 0) {
+        return RDNX_OK;
+    }
+    if (!syms) {
+        return RDNX_E_INVALID;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!syms[i].name || !syms[i].name[0] || ksymtab_lookup(syms[i].name, NULL)) {
+            return syms[i].name ? RDNX_E_BUSY : RDNX_E_INVALID;
+        }
+        for (uint32_t j = 0; j < i; j++) {
+            if (strcmp(syms[i].name, syms[j].name) == 0) {
+                return RDNX_E_BUSY;
+            }
+        }
+    }
+    ksym_block_t* b = (ksym_block_t*)kmalloc(sizeof(*b) + (size_t)count * sizeof(ksym_node_t));
+    if (!b) {
+        return RDNX_E_NOMEM;
+    }
+    b->owner = owner;
+    b->count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t h = ksym_hash(syms[i].name);
+        b->nodes[i].sym = &syms[i];
+        b->nodes[i].owner = owner;
+        b->nodes[i].next = ksym_buckets[h];
+        ksym_buckets[h] = &b->nodes[i];
+    }
+    b->next = ksym_blocks;
+    ksym_blocks = b;
+    ksym_total += count;
+    return RDNX_OK;
+}
+
+void ksymtab_remove_owner(int owner)
+{
+    ksym_block_t** link = &ksym_blocks;
+    while (*link) {
+        ksym_block_t* b = *link;
+        if (b->owner != owner) {
+            link = &b->next;
+            continue;
+        }
+        for (uint32_t i = 0; i < b->count; i++) {
+            ksym_node_t** pn = &ksym_buckets[ksym_hash(b->nodes[i].sym->name)];
+            while (*pn && *pn != &b->nodes[i]) {
+                pn = &(*pn)->next;
+            }
+            if (*pn) {
+                *pn = b->nodes[i].next;
+            }
+        }
+        ksym_total -= b->count;
+        *link = b->next;
+        kfree(b);
+    }
+}
+
+uint32_t ksymtab_count(void)
+{
+    return ksym_total;
+}
+
+int ksymtab_init(void)
+{
+    for (uint32_t i = 0; i < KSYMTAB_BUCKETS; i++) {
+        ksym_buckets[i] = NULL;
+    }
+    ksym_blocks = NULL;
+    ksym_total = 0;
+    uint32_t n = (uint32_t)(__kmod_ksymtab_end - __kmod_ksymtab_start);
+    return ksymtab_add(__kmod_ksymtab_start, n, KSYMTAB_KERNEL);
+}
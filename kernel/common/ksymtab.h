@@ -0,0 +1,29 @@
+/**
+ * @file ksymtab.h
+ * @brief Hash table of exported symbols for the module loader
+ *
+ * Holds the kernel's own exports (section .kmod_ksymtab, linked between
+ * __kmod_ksymtab_start and __kmod_ksymtab_end) and the exports of loaded
+ * modules, keyed by name. Each entry remembers its owner: KSYMTAB_KERNEL
+ * or the kmod slot index, so the loader can take references on providers
+ * and drop a module's exports when it goes away. All calls except lookup
+ * during boot are made with the kmod lock held.
+ */
+
+#ifndef _RODNIX_COMMON_KSYMTAB_H
+#define _RODNIX_COMMON_KSYMTAB_H
+
+#include <stdint.h>
+#include "../../include/kmod_abi.h"
+
+#define KSYMTAB_KERNEL  (-1)
+#define KSYMTAB_BUCKETS 256u    /* power of two */
+
+int ksymtab_init(void);
+/* RDNX_E_BUSY if a name is already exported; nothing is added then. */
+int ksymtab_add(const kmod_symbol_t* syms, uint32_t count, int owner);
+void ksymtab_remove_owner(int owner);
+const kmod_symbol_t* ksymtab_lookup(const char* name, int* out_owner);
+uint32_t ksymtab_count(void);
+
+#endif /* _RODNIX_COMMON_KSYMTAB_H */
@@ -0,0 +1,189 @@
+/**
+ * @file lattrace.c
+ * @brief Latency tracer: worst preempt-off and IRQ-off sections
+ *
+ * Each CPU has at most one open section per kind; nested opens are
+ * ignored, so a section runs from the outermost begin to the matching
+ * end. Closing one costs a TSC read and two counters; only a new maximum
+ * walks the stack. The hooks sit below the lock primitives, so nothing
+ * here may take a spinlock or go through set_irql(): the record update
+ * masks interrupts with cli directly.
+ *
+ * The stack is walked through the rbp chain of the current kernel stack
+ * and stays within the thread's stack bounds; without a thread (boot, or
+ * a section closed on a foreign stack) only the immediate caller is kept.
+ */
+
+#include "lattrace.h"
+#include "preempt.h"
+#include "rusage.h"
+#include "../core/cpu.h"
+#include "../core/task.h"
+#include "../../include/common.h"
+#include <stddef.h>
+
+typedef struct lat_open {
+    uint64_t start;
+    uintptr_t ip;
+    uint32_t open;
+} lat_open_t;
+
+typedef struct lat_kind {
+    uint64_t sections;
+    uint64_t total_cycles;
+    uint64_t max_cycles;
+    lattrace_record_t worst;
+} lat_kind_t;
+
+volatile uint32_t lattrace_enabled = 0;
+
+static lat_open_t lat_open[LATTRACE_MAX_CPUS][LAT_KINDS];
+static lat_kind_t lat_kinds[LAT_KINDS];
+
+static inline lat_open_t* lat_this_cpu(uint32_t kind)
+{
+    uint32_t cpu = cpu_get_id();
+    return &lat_open[cpu < LATTRACE_MAX_CPUS ? cpu : 0][kind];
+}
+
+static inline uint64_t lat_irq_save(void)
+{
+    uint64_t flags;
+    __asm__ volatile ("pushfq; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void lat_irq_restore(uint64_t flags)
+{
+    if (flags & 0x200u) {
+        __asm__ volatile ("sti" ::: "memory");
+    }
+}
+
+static uint32_t lat_unwind(uint64_t* ips, uint32_t max)
+{
+    uintptr_t rbp = (uintptr_t)__builtin_frame_address(0);
+    thread_t* t = thread_get_current();
+    uintptr_t lo = t ? (uintptr_t)t->stack : 0;
+    uintptr_t hi = lo + (t ? t->stack_size : 0);
+    if (!t || !t->stack || rbp < lo || rbp >= hi) {
+        ips[0] = (uint64_t)(uintptr_t)__builtin_return_address(0);
+        return 1;
+    }
+    uint32_t n = 0;
+    while (n < max && rbp >= lo && rbp + 16u <= hi && (rbp & 7u) == 0) {
+        uintptr_t next = ((const uintptr_t*)rbp)[0];
+        uintptr_t ret = ((const uintptr_t*)rbp)[1];
+        if (ret == 0) {
+            break;
+        }
+        ips[n++] = (uint64_t)ret;
+        /* Frames grow towards higher addresses while unwinding. */
+        if (next <= rbp) {
+            break;
+        }
+        rbp = next;
+    }
+    return n;
+}
+
+void lattrace_begin(uint32_t kind, uintptr_t ip)
+{
+    if (kind >= LAT_KINDS) {
+        return;
+    }
+    lat_open_t* o = lat_this_cpu(kind);
+    if (o->open) {
+        return;
+    }
+    o->ip = ip;
+    o->start = cpu_get_time();
+    o->open = 1;
+}
+
+void lattrace_end(uint32_t kind)
+{
+    if (kind >= LAT_KINDS) {
+        return;
+    }
+    lat_open_t* o = lat_this_cpu(kind);
+    if (!o->open) {
+        return;
+    }
+    uint64_t cycles = cpu_get_time() - o->start;
+    o->open = 0;
+    lat_kind_t* k = &lat_kinds[kind];
+    __atomic_fetch_add(&k->sections, 1u, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&k->total_cycles, cycles, __ATOMIC_RELAXED);
+    if (cycles <= __atomic_load_n(&k->max_cycles, __ATOMIC_RELAXED)) {
+        return;
+    }
+    uint64_t flags = lat_irq_save();
+    if (cycles > k->max_cycles) {
+        k->max_cycles = cycles;
+        lattrace_record_t* r = &k->worst;
+        task_t* task = task_get_current();
+        r->start_ip = (uint64_t)o->ip;
+        r->pid = task ? (uint32_t)task->task_id : 0;
+        for (uint32_t i = 0; i < sizeof(r->comm); i++) {
+            r->comm[i] = task ? task->comm[i] : 0;
+        }
+        r->comm[sizeof(r->comm) - 1] = 0;
+        r->nr_ips = lat_unwind(r->ips, LATTRACE_MAX_DEPTH);
+    }
+    lat_irq_restore(flags);
+}
+
+void lattrace_switch(void)
+{
+    for (uint32_t kind = 0; kind < LAT_KINDS; kind++) {
+        lat_this_cpu(kind)->open = 0;
+    }
+}
+
+void lattrace_reset(void)
+{
+    uint64_t flags = lat_irq_save();
+    memset(lat_kinds, 0, sizeof(lat_kinds));
+    lat_irq_restore(flags);
+}
+
+void lattrace_start(void)
+{
+    uint64_t flags = lat_irq_save();
+    memset(lat_open, 0, sizeof(lat_open));
+    lattrace_enabled = 1;
+    lat_irq_restore(flags);
+}
+
+void lattrace_stop(void)
+{
+    lattrace_enabled = 0;
+}
+
+void lattrace_snapshot(lattrace_report_t* out)
+{
+    if (!out) {
+        return;
+    }
+    preempt_stats_t ps;
+    preempt_get_stats(&ps);
+    memset(out, 0, sizeof(*out));
+    out->enabled = lattrace_enabled;
+    out->preempt_mode = (uint32_t)preempt_get_mode();
+    out->involuntary = ps.involuntary;
+    out->deferred = ps.deferred;
+    out->enable_resched = ps.enable_resched;
+    out->cond_resched = ps.cond_resched;
+    out->atomic_sleeps = ps.atomic_sleeps;
+
+    uint64_t flags = lat_irq_save();
+    for (uint32_t kind = 0; kind < LAT_KINDS; kind++) {
+        const lat_kind_t* k = &lat_kinds[kind];
+        out->sections[kind] = k->sections;
+        out->total_ns[kind] = rusage_cycles_to_ns(k->total_cycles);
+        out->worst[kind] = k->worst;
+        out->worst[kind].max_ns = rusage_cycles_to_ns(k->max_cycles);
+    }
+    lat_irq_restore(flags);
+}
@@ -0,0 +1,86 @@
+/**
+ * @file lattrace.h
+ * @brief Latency tracer: worst preempt-off and IRQ-off sections
+ *
+ * While enabled (boot token "lattrace=1" or lattrace(START)), every
+ * preempt-off section (preempt count 0 -> n -> 0) and IRQ-off section
+ * (IRQL raised, interrupt handler, SYSCALL handler under
+ * "preempt=voluntary") is timed. The longest one of each kind keeps the
+ * call site that opened it and a kernel stack taken where it closed.
+ * cond_resched() and context switches cut open sections, so a section
+ * measures the stretch between two points where the CPU could switch.
+ */
+
+#ifndef _RODNIX_COMMON_LATTRACE_H
+#define _RODNIX_COMMON_LATTRACE_H
+
+#include <stdint.h>
+
+#define LATTRACE_MAX_DEPTH 16
+#define LATTRACE_MAX_CPUS 8
+
+enum {
+    LAT_PREEMPTOFF = 0,
+    LAT_IRQSOFF    = 1,
+    LAT_KINDS      = 2,
+};
+
+/* lattrace() ops. */
+enum {
+    LATTRACE_OP_READ  = 1,
+    LATTRACE_OP_START = 2,
+    LATTRACE_OP_STOP  = 3,
+    LATTRACE_OP_RESET = 4,
+};
+
+/* Worst section of one kind; mirrors rodnix_lat_record_t. */
+typedef struct lattrace_record {
+    uint64_t max_ns;
+    uint64_t start_ip;          /* where the section was opened */
+    uint32_t pid;
+    uint32_t nr_ips;
+    char comm[16];
+    uint64_t ips[LATTRACE_MAX_DEPTH];   /* stack where it closed, innermost first */
+} lattrace_record_t;
+
+/* Tracer and preemption report; mirrors rodnix_lattrace_t. */
+typedef struct lattrace_report {
+    uint32_t enabled;
+    uint32_t preempt_mode;      /* PREEMPT_MODE_* */
+    uint64_t sections[LAT_KINDS];
+    uint64_t total_ns[LAT_KINDS];
+    uint64_t involuntary;
+    uint64_t deferred;
+    uint64_t enable_resched;
+    uint64_t cond_resched;
+    uint64_t atomic_sleeps;
+    lattrace_record_t worst[LAT_KINDS];
+} lattrace_report_t;
+
+extern volatile uint32_t lattrace_enabled;
+
+void lattrace_begin(uint32_t kind, uintptr_t ip);
+void lattrace_end(uint32_t kind);
+/* Close without recording: the section spans a context switch. */
+void lattrace_switch(void);
+
+static inline void lattrace_section_begin(uint32_t kind, uintptr_t ip)
+{
+    if (lattrace_enabled) {
+        lattrace_begin(kind, ip);
+    }
+}
+
+static inline void lattrace_section_end(uint32_t kind)
+{
+    if (lattrace_enabled) {
+        lattrace_end(kind);
+    }
+}
+
+void lattrace_start(void);
+void lattrace_stop(void);
+void lattrace_reset(void);
+void lattrace_snapshot(lattrace_report_t* out);
+
+#endif /* _RODNIX_COMMON_LATTRACE_H */
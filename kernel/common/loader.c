@@ -531,6 +531,7 @@ int loader_execve_ex(const char* path,
     if (cur && cur->task) {
         cur->task->address_space = (void*)(uintptr_t)img.pml4_phys;
         task_set_abi(cur->task, (task_abi_t)img.abi);
+        task_set_comm(cur->task, path);
         if (vm_task_prepare_exec(cur->task, img.pml4_phys) == RDNX_OK) {
             for (uint32_t i = 0; i < img.seg_count; i++) {
                 const loader_segment_t* s = &img.segs[i];
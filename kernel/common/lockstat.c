@@ -0,0 +1,494 @@
+/**
+ * @file lockstat.c
+ * @brief Lock classes, contention statistics and lockdep-style order checks
+ *
+ * A lock class groups every lock initialised at one site (spinlock_init()
+ * stringifies its argument, waitq_init() passes the queue name), so the
+ * statistics and the dependency graph stay small and meaningful: all IPC
+ * port queues share "&q->lock", the ext2 lock is "&g_ext2_rw_lock".
+ *
+ * Statistics (CONFIG_LOCKSTAT) are TSC cycles per class: acquisitions,
+ * contended acquisitions and spin time, hold time, and the busiest call
+ * sites (space-saving replacement of the least-used slot). Wait queues
+ * report sleeps, wakeups, timeouts and time slept.
+ *
+ * Lockdep (CONFIG_LOCKDEP) keeps a per-CPU stack of held spinlocks and a
+ * class graph: taking B while holding A records A -> B. If B already
+ * reaches A the order is inverted somewhere and the pair is reported once
+ * on the console, before the acquisition spins. Re-acquiring a held lock
+ * is reported as a self-deadlock. Same-class nesting of different locks is
+ * not an error (classes are per init site).
+ *
+ * Hooks run inside spinlock_lock() from any context, including ISRs, so
+ * they never take locks: counters are atomic, and the graph and held
+ * stacks are updated with interrupts disabled through pushfq/popfq rather
+ * than set_irql(), which would re-enable interrupts inside an ISR.
+ */
+
+#include "lockstat.h"
+#include "rusage.h"
+#include "../core/cpu.h"
+#include "../../include/common.h"
+#include "../../include/console.h"
+#include <stddef.h>
+
+#ifdef CONFIG_LOCK_CLASSES
+
+#define LOCKDEP_MAX_CPUS 8
+
+struct lock_class {
+    char name[LOCK_CLASS_NAME_MAX];
+    uint32_t id;
+    uint32_t kind;
+    uint64_t acquired;
+    uint64_t contended;
+    uint64_t spin_cycles;
+    uint64_t spin_max;
+    uint64_t hold_cycles;
+    uint64_t hold_max;
+    uint64_t waits;
+    uint64_t wakeups;
+    uint64_t timeouts;
+    uint64_t wait_cycles;
+    uint64_t wait_max;
+    uint32_t violations;
+    uint64_t site_ip[LOCK_CLASS_SITES];
+    uint64_t site_acquired[LOCK_CLASS_SITES];
+    uint64_t site_contended[LOCK_CLASS_SITES];
+};
+
+typedef struct held_lock {
+    struct lock_class* cls;
+    const void* lock;
+    uintptr_t ip;
+} held_lock_t;
+
+static struct lock_class lock_classes[LOCK_CLASS_MAX];
+static volatile uint32_t lock_class_count = 0;
+
+#ifdef CONFIG_LOCKDEP
+_Static_assert((LOCK_CLASS_MAX % 64u) == 0, "lockdep class sets are whole uint64_t words");
+#define LOCKDEP_SET_WORDS (LOCK_CLASS_MAX / 64u)
+
+typedef struct lockdep_set {
+    uint64_t w[LOCKDEP_SET_WORDS];
+} lockdep_set_t;
+
+static lockdep_set_t lockdep_after[LOCK_CLASS_MAX];     /* bit b: b taken while holding a */
+static lockdep_set_t lockdep_reported[LOCK_CLASS_MAX];
+static uintptr_t lockdep_edge_ip[LOCK_CLASS_MAX][LOCK_CLASS_MAX];
+static held_lock_t lockdep_held[LOCKDEP_MAX_CPUS][LOCKDEP_HELD_MAX];
+static volatile uint32_t lockdep_depth[LOCKDEP_MAX_CPUS];
+static int lockdep_overflow_reported = 0;
+#endif
+
+static inline uint64_t lockstat_irq_save(void)
+{
+    uint64_t rflags;
+    __asm__ volatile ("pushfq; popq %0; cli" : "=r"(rflags) :: "memory");
+    return rflags;
+}
+
+static inline void lockstat_irq_restore(uint64_t rflags)
+{
+    __asm__ volatile ("pushq %0; popfq" :: "r"(rflags) : "memory", "cc");
+}
+
+#ifdef CONFIG_LOCKSTAT
+static void lockstat_max(uint64_t* slot, uint64_t v)
+{
+    uint64_t cur = __atomic_load_n(slot, __ATOMIC_RELAXED);
+    while (v > cur &&
+           !__atomic_compare_exchange_n(slot, &cur, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+#endif
+
+static void lockstat_name_from_ip(char* out, uintptr_t ip)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char* prefix = "lock@";
+    size_t n = 0;
+    while (prefix[n]) {
+        out[n] = prefix[n];
+        n++;
+    }
+    for (int shift = 60; shift >= 0 && n + 1 < LOCK_CLASS_NAME_MAX; shift -= 4) {
+        out[n++] = hex[(ip >> shift) & 0xF];
+    }
+    out[n] = '\0';
+}
+
+struct lock_class* lock_class_get(const char* name, uint32_t kind, uintptr_t ip)
+{
+    char buf[LOCK_CLASS_NAME_MAX];
+    if (!name) {
+        lockstat_name_from_ip(buf, ip);
+        name = buf;
+    }
+    uint64_t flags = lockstat_irq_save();
+    uint32_t n = lock_class_count;
+    for (uint32_t i = 0; i < n; i++) {
+        if (lock_classes[i].kind == kind &&
+            strncmp(lock_classes[i].name, name, LOCK_CLASS_NAME_MAX - 1) == 0) {
+            lockstat_irq_restore(flags);
+            return &lock_classes[i];
+        }
+    }
+    struct lock_class* cls = NULL;
+    if (n < LOCK_CLASS_MAX) {
+        cls = &lock_classes[n];
+        memset(cls, 0, sizeof(*cls));
+        strncpy(cls->name, name, LOCK_CLASS_NAME_MAX - 1);
+        cls->id = n;
+        cls->kind = kind;
+        __asm__ volatile ("" ::: "memory");
+        lock_class_count = n + 1;
+    }
+    lockstat_irq_restore(flags);
+    if (!cls) {
+        static int warned = 0;
+        if (!warned) {
+            warned = 1;
+            kprintf("[LOCKSTAT] WARNING: lock class table full (LOCK_CLASS_MAX %u): '%s' and any\n"
+                    "[LOCKSTAT] later class get no statistics and no lockdep checks; raise LOCK_CLASS_MAX\n",
+                    (unsigned)LOCK_CLASS_MAX, name);
+        }
+    }
+    return cls;
+}
+
+#ifdef CONFIG_LOCKDEP
+static inline int lockdep_set_test(const lockdep_set_t* s, uint32_t b)
+{
+    return (s->w[b / 64u] >> (b % 64u)) & 1u;
+}
+
+static inline void lockdep_set_add(lockdep_set_t* s, uint32_t b)
+{
+    s->w[b / 64u] |= 1ull << (b % 64u);
+}
+
+/* Is `to` reachable from `from` in the class graph? Iterative over bitmasks. */
+static int lockdep_reaches(uint32_t from, uint32_t to)
+{
+    lockdep_set_t seen = { { 0 } };
+    lockdep_set_t frontier = { { 0 } };
+    lockdep_set_add(&seen, from);
+    lockdep_set_add(&frontier, from);
+    for (;;) {
+        lockdep_set_t next = { { 0 } };
+        for (uint32_t w = 0; w < LOCKDEP_SET_WORDS; w++) {
+            uint64_t bits = frontier.w[w];
+            while (bits) {
+                uint32_t i = w * 64u + (uint32_t)__builtin_ctzll(bits);
+                bits &= bits - 1;
+                for (uint32_t k = 0; k < LOCKDEP_SET_WORDS; k++) {
+                    next.w[k] |= lockdep_after[i].w[k];
+                }
+            }
+        }
+        if (lockdep_set_test(&next, to)) {
+            return 1;
+        }
+        uint64_t any = 0;
+        for (uint32_t w = 0; w < LOCKDEP_SET_WORDS; w++) {
+            frontier.w[w] = next.w[w] & ~seen.w[w];
+            seen.w[w] |= next.w[w];
+            any |= frontier.w[w];
+        }
+        if (!any) {
+            return 0;
+        }
+    }
+}
+
+static void lockdep_report_inversion(struct lock_class* held, struct lock_class* cls, uintptr_t ip, uintptr_t held_ip)
+{
+    kprintf("[LOCKDEP] possible deadlock: acquiring '%s' at %p while holding '%s' (taken at %p)\n",
+            cls->name, (void*)ip, held->name, (void*)held_ip);
+    if (lockdep_set_test(&lockdep_after[cls->id], held->id)) {
+        kprintf("[LOCKDEP]   reverse order '%s' -> '%s' first seen at %p\n",
+                cls->name, held->name, (void*)lockdep_edge_ip[cls->id][held->id]);
+    } else {
+        kprintf("[LOCKDEP]   '%s' already reaches '%s' through other classes\n",
+                cls->name, held->name);
+    }
+    held->violations++;
+    cls->violations++;
+}
+#endif
+
+void lockdep_acquire(struct lock_class* cls, const void* lock, uintptr_t ip, int trylock)
+{
+#ifdef CONFIG_LOCKDEP
+    uint32_t cpu = cpu_get_id();
+    if (!cls || cpu >= LOCKDEP_MAX_CPUS) {
+        return;
+    }
+    uint64_t flags = lockstat_irq_save();
+    uint32_t depth = lockdep_depth[cpu];
+    for (uint32_t i = 0; i < depth && i < LOCKDEP_HELD_MAX; i++) {
+        held_lock_t* h = &lockdep_held[cpu][i];
+        if (h->lock == lock && !trylock) {
+            kprintf("[LOCKDEP] recursive locking of '%s' at %p, already held from %p\n",
+                    cls->name, (void*)ip, (void*)h->ip);
+            cls->violations++;
+            continue;
+        }
+        if (trylock || h->cls == cls) {
+            continue;
+        }
+        uint32_t a = h->cls->id;
+        uint32_t b = cls->id;
+        if (lockdep_set_test(&lockdep_after[a], b)) {
+            continue;
+        }
+        if (lockdep_reaches(b, a)) {
+            if (!lockdep_set_test(&lockdep_reported[a], b)) {
+                lockdep_set_add(&lockdep_reported[a], b);
+                lockdep_report_inversion(h->cls, cls, ip, h->ip);
+            }
+            continue;
+        }
+        lockdep_set_add(&lockdep_after[a], b);
+        lockdep_edge_ip[a][b] = ip;
+    }
+    if (depth < LOCKDEP_HELD_MAX) {
+        lockdep_held[cpu][depth].cls = cls;
+        lockdep_held[cpu][depth].lock = lock;
+        lockdep_held[cpu][depth].ip = ip;
+    } else if (!lockdep_overflow_reported) {
+        lockdep_overflow_reported = 1;
+        kprintf("[LOCKDEP] held-lock stack overflow (%u) at '%s'\n",
+                (unsigned)LOCKDEP_HELD_MAX, cls->name);
+    }
+    lockdep_depth[cpu] = depth + 1;
+    lockstat_irq_restore(flags);
+#else
+    (void)cls;
+    (void)lock;
+    (void)ip;
+    (void)trylock;
+#endif
+}
+
+void lockdep_release(struct lock_class* cls, const void* lock)
+{
+#ifdef CONFIG_LOCKDEP
+    uint32_t cpu = cpu_get_id();
+    if (!cls || cpu >= LOCKDEP_MAX_CPUS) {
+        return;
+    }
+    uint64_t flags = lockstat_irq_save();
+    uint32_t depth = lockdep_depth[cpu];
+    uint32_t top = depth < LOCKDEP_HELD_MAX ? depth : LOCKDEP_HELD_MAX;
+    if (depth > LOCKDEP_HELD_MAX) {
+        /* Entries past the stack were never stored: just unwind the count. */
+        lockdep_depth[cpu] = depth - 1;
+        lockstat_irq_restore(flags);
+        return;
+    }
+    for (uint32_t i = top; i > 0; i--) {
+        if (lockdep_held[cpu][i - 1].lock != lock) {
+            continue;
+        }
+        for (uint32_t j = i; j < top; j++) {
+            lockdep_held[cpu][j - 1] = lockdep_held[cpu][j];
+        }
+        lockdep_depth[cpu] = depth - 1;
+        lockstat_irq_restore(flags);
+        return;
+    }
+    lockstat_irq_restore(flags);
+    kprintf("[LOCKDEP] releasing '%s' that is not held\n", cls->name);
+#else
+    (void)cls;
+    (void)lock;
+#endif
+}
+
+#ifdef CONFIG_LOCKSTAT
+static void lockstat_site(struct lock_class* cls, uintptr_t ip, int contended)
+{
+    uint32_t victim = 0;
+    for (uint32_t i = 0; i < LOCK_CLASS_SITES; i++) {
+        if (cls->site_ip[i] == ip) {
+            __atomic_fetch_add(&cls->site_acquired[i], 1, __ATOMIC_RELAXED);
+            if (contended) {
+                __atomic_fetch_add(&cls->site_contended[i], 1, __ATOMIC_RELAXED);
+            }
+            return;
+        }
+        if (cls->site_acquired[i] < cls->site_acquired[victim]) {
+            victim = i;
+        }
+    }
+    /* Space-saving: the newcomer inherits the evicted count as an upper bound. */
+    cls->site_ip[victim] = ip;
+    cls->site_acquired[victim]++;
+    if (contended) {
+        cls->site_contended[victim]++;
+    }
+}
+#endif
+
+void lockstat_acquired(struct lock_class* cls, uintptr_t ip, int contended, uint64_t spin_cycles)
+{
+#ifdef CONFIG_LOCKSTAT
+    if (!cls) {
+        return;
+    }
+    __atomic_fetch_add(&cls->acquired, 1, __ATOMIC_RELAXED);
+    if (contended) {
+        __atomic_fetch_add(&cls->contended, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&cls->spin_cycles, spin_cycles, __ATOMIC_RELAXED);
+        lockstat_max(&cls->spin_max, spin_cycles);
+    }
+    lockstat_site(cls, ip, contended);
+#else
+    (void)cls;
+    (void)ip;
+    (void)contended;
+    (void)spin_cycles;
+#endif
+}
+
+void lockstat_released(struct lock_class* cls, uint64_t hold_cycles)
+{
+#ifdef CONFIG_LOCKSTAT
+    if (!cls) {
+        return;
+    }
+    __atomic_fetch_add(&cls->hold_cycles, hold_cycles, __ATOMIC_RELAXED);
+    lockstat_max(&cls->hold_max, hold_cycles);
+#else
+    (void)cls;
+    (void)hold_cycles;
+#endif
+}
+
+void lockstat_waited(struct lock_class* cls, uintptr_t ip, uint64_t wait_cycles, int timed_out)
+{
+#ifdef CONFIG_LOCKSTAT
+    if (!cls) {
+        return;
+    }
+    __atomic_fetch_add(&cls->waits, 1, __ATOMIC_RELAXED);
+    if (timed_out) {
+        __atomic_fetch_add(&cls->timeouts, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&cls->wait_cycles, wait_cycles, __ATOMIC_RELAXED);
+    lockstat_max(&cls->wait_max, wait_cycles);
+    lockstat_site(cls, ip, 1);
+#else
+    (void)cls;
+    (void)ip;
+    (void)wait_cycles;
+    (void)timed_out;
+#endif
+}
+
+void lockstat_woken(struct lock_class* cls, uint32_t count)
+{
+#ifdef CONFIG_LOCKSTAT
+    if (cls && count) {
+        __atomic_fetch_add(&cls->wakeups, count, __ATOMIC_RELAXED);
+    }
+#else
+    (void)cls;
+    (void)count;
+#endif
+}
+
+uint32_t lockstat_features(void)
+{
+    uint32_t f = 0;
+#ifdef CONFIG_LOCKSTAT
+    f |= LOCKSTAT_F_STATS;
+#endif
+#ifdef CONFIG_LOCKDEP
+    f |= LOCKSTAT_F_LOCKDEP;
+#endif
+    return f;
+}
+
+uint32_t lockstat_snapshot(lockstat_info_t* out, uint32_t first, uint32_t max)
+{
+    uint32_t n = lock_class_count;
+    uint32_t copied = 0;
+    if (!out) {
+        return 0;
+    }
+    for (uint32_t i = first; i < n && copied < max; i++) {
+        const struct lock_class* c = &lock_classes[i];
+        lockstat_info_t* o = &out[copied++];
+        memset(o, 0, sizeof(*o));
+        strncpy(o->name, c->name, sizeof(o->name) - 1);
+        o->id = c->id;
+        o->kind = c->kind;
+        o->acquired = c->acquired;
+        o->contended = c->contended;
+        o->spin_ns = rusage_cycles_to_ns(c->spin_cycles);
+        o->spin_max_ns = rusage_cycles_to_ns(c->spin_max);
+        o->hold_ns = rusage_cycles_to_ns(c->hold_cycles);
+        o->hold_max_ns = rusage_cycles_to_ns(c->hold_max);
+        o->waits = c->waits;
+        o->wakeups = c->wakeups;
+        o->timeouts = c->timeouts;
+        o->wait_ns = rusage_cycles_to_ns(c->wait_cycles);
+        o->wait_max_ns = rusage_cycles_to_ns(c->wait_max);
+#ifdef CONFIG_LOCKDEP
+        for (uint32_t w = 0; w < LOCKDEP_SET_WORDS; w++) {
+            o->deps += (uint32_t)__builtin_popcountll(lockdep_after[i].w[w]);
+        }
+#endif
+        o->violations = c->violations;
+        for (uint32_t s = 0; s < LOCK_CLASS_SITES; s++) {
+            o->site_ip[s] = c->site_ip[s];
+            o->site_acquired[s] = c->site_acquired[s];
+            o->site_contended[s] = c->site_contended[s];
+        }
+    }
+    return copied;
+}
+
+void lockstat_reset(void)
+{
+    uint32_t n = lock_class_count;
+    uint64_t flags = lockstat_irq_save();
+    for (uint32_t i = 0; i < n; i++) {
+        struct lock_class* c = &lock_classes[i];
+        /* Statistics only: the dependency graph and violation counts persist. */
+        c->acquired = c->contended = 0;
+        c->spin_cycles = c->spin_max = 0;
+        c->hold_cycles = c->hold_max = 0;
+        c->waits = c->wakeups = c->timeouts = 0;
+        c->wait_cycles = c->wait_max = 0;
+        memset(c->site_ip, 0, sizeof(c->site_ip));
+        memset(c->site_acquired, 0, sizeof(c->site_acquired));
+        memset(c->site_contended, 0, sizeof(c->site_contended));
+    }
+    lockstat_irq_restore(flags);
+}
+
+#else /* !CONFIG_LOCK_CLASSES */
+
+uint32_t lockstat_features(void)
+{
+    return 0;
+}
+
+uint32_t lockstat_snapshot(lockstat_info_t* out, uint32_t first, uint32_t max)
+{
+    (void)out;
+    (void)first;
+    (void)max;
+    return 0;
+}
+
+void lockstat_reset(void)
+{
+}
+
+#endif /* CONFIG_LOCK_CLASSES */
@@ -0,0 +1,87 @@
+/**
+ * @file lockstat.h
+ * @brief Lock classes, contention statistics and lock-order validation
+ *
+ * Build with LOCKSTAT=1 (CONFIG_LOCKSTAT) for acquisition/contention/hold
+ * statistics of spinlocks and wait queues, LOCKDEP=1 (CONFIG_LOCKDEP) for
+ * lock-order checking. Both hang off named lock classes; with neither set
+ * the hooks compile out and spinlock_t stays a single word.
+ */
+
+#ifndef _RODNIX_COMMON_LOCKSTAT_H
+#define _RODNIX_COMMON_LOCKSTAT_H
+
+#include <stdint.h>
+
+#if defined(CONFIG_LOCKSTAT) || defined(CONFIG_LOCKDEP)
+#define CONFIG_LOCK_CLASSES 1
+#endif
+
+/*
+ * One class per init site: the tree has about 38 spinlock and 20 wait
+ * queue/mutex classes, so 128 leaves room to grow. Lockdep's class sets are
+ * LOCK_CLASS_MAX bits wide; lock_class_get() reports the first class that
+ * does not fit, and that lock goes unchecked from then on.
+ */
+#define LOCK_CLASS_MAX 128
+#define LOCK_CLASS_NAME_MAX 32
+#define LOCK_CLASS_SITES 4     /* call sites tracked per class */
+#define LOCKDEP_HELD_MAX 16    /* nesting depth per CPU */
+
+enum {
+    LOCK_KIND_SPIN  = 1,
+    LOCK_KIND_WAITQ = 2,
+};
+
+/* lockstat() ops and the feature mask returned by LOCKSTAT_OP_INFO. */
+enum {
+    LOCKSTAT_OP_INFO  = 1,
+    LOCKSTAT_OP_READ  = 2,
+    LOCKSTAT_OP_RESET = 3,
+};
+#define LOCKSTAT_F_STATS 0x1u
+#define LOCKSTAT_F_LOCKDEP 0x2u
+
+/* One class as exported to userland; mirrors rodnix_lockstat_t. Times in ns. */
+typedef struct lockstat_info {
+    char name[LOCK_CLASS_NAME_MAX];
+    uint32_t id;
+    uint32_t kind;
+    uint64_t acquired;
+    uint64_t contended;
+    uint64_t spin_ns;
+    uint64_t spin_max_ns;
+    uint64_t hold_ns;
+    uint64_t hold_max_ns;
+    uint64_t waits;          /* wait queues: sleeps, wakeups, timeouts */
+    uint64_t wakeups;
+    uint64_t timeouts;
+    uint64_t wait_ns;
+    uint64_t wait_max_ns;
+    uint32_t deps;           /* lockdep: classes taken while holding this one */
+    uint32_t violations;     /* lockdep: order inversions reported against it */
+    uint64_t site_ip[LOCK_CLASS_SITES];
+    uint64_t site_acquired[LOCK_CLASS_SITES];
+    uint64_t site_contended[LOCK_CLASS_SITES];
+} lockstat_info_t;
+
+struct lock_class;
+
+/* Find or create the class for name (copied); NULL name derives one from ip. */
+struct lock_class* lock_class_get(const char* name, uint32_t kind, uintptr_t ip);
+
+/* Spinlock hooks (kernel/fabric/spin.c). */
+void lockdep_acquire(struct lock_class* cls, const void* lock, uintptr_t ip, int trylock);
+void lockdep_release(struct lock_class* cls, const void* lock);
+void lockstat_acquired(struct lock_class* cls, uintptr_t ip, int contended, uint64_t spin_cycles);
+void lockstat_released(struct lock_class* cls, uint64_t hold_cycles);
+
+/* Wait queue hooks (kernel/common/waitq.c). */
+void lockstat_waited(struct lock_class* cls, uintptr_t ip, uint64_t wait_cycles, int timed_out);
+void lockstat_woken(struct lock_class* cls, uint32_t count);
+
+uint32_t lockstat_features(void);
+uint32_t lockstat_snapshot(lockstat_info_t* out, uint32_t first, uint32_t max);
+void lockstat_reset(void);
+
+#endif /* _RODNIX_COMMON_LOCKSTAT_H */
@@ -0,0 +1,281 @@
+/**
+ * @file locktest.c
+ * @brief Boot-time lock self-test: throughput, fairness, mutual exclusion
+ *
+ * Runs LOCKTEST_THREADS kernel threads against one lock for LOCKTEST_PHASE_MS
+ * per primitive and prints, per phase, acquisitions per second, the spread
+ * of per-thread acquisition counts (fairness = min/max) and the number of
+ * mutual-exclusion violations seen inside the critical section, which must
+ * be zero. The first phase is a bare test-and-set lock as the baseline the
+ * ticket lock is measured against; it disables preemption around the
+ * section like spinlock_t does, so the two differ only in the lock word.
+ *
+ * A held spinlock or rwlock is never preempted, so on one CPU those phases
+ * never contend: they measure the uncontended acquire/release path, and
+ * the _irqsave phase adds the cost of masking the timer. Fairness and
+ * ticket-versus-barging behaviour need cross-CPU contention; boot with
+ * QEMU_SMP=4 once APs are brought up. On one CPU only the seqlock (a
+ * reader preempted mid-read retries) and the mutex (a sleeping lock whose
+ * holder can be preempted) see contention.
+ */
+
+#include "locktest.h"
+#include "mutex.h"
+#include "preempt.h"
+#include "scheduler.h"
+#include "rusage.h"
+#include "../fabric/spin.h"
+#include "../fabric/rwlock.h"
+#include "../core/cpu.h"
+#include "../../include/console.h"
+#include <stddef.h>
+
+#define LOCKTEST_THREADS 4
+#define LOCKTEST_PHASE_MS 1000u
+#define LOCKTEST_HOLD_SPINS 64u    /* work inside the critical section */
+#define LOCKTEST_IDLE_SPINS 256u   /* work between acquisitions */
+
+enum {
+    LT_TAS = 0,
+    LT_TICKET,
+    LT_TICKET_IRQ,
+    LT_RWLOCK,
+    LT_SEQLOCK,
+    LT_MUTEX,
+    LT_PHASES,
+};
+
+static const char* const lt_phase_names[LT_PHASES] = {
+    "tas", "ticket", "ticket-irqsave", "rwlock", "seqlock", "mutex",
+};
+
+typedef struct {
+    uint64_t ops;      /* lock acquisitions (rwlock/seqlock: reads, or writes for thread 0) */
+    uint64_t retries;  /* seqlock read retries */
+} __attribute__((aligned(64))) lt_counter_t;
+
+static lt_counter_t lt_count[LOCKTEST_THREADS];
+static volatile uint32_t lt_phase;
+static volatile uint32_t lt_stop;
+static volatile uint32_t lt_done;
+static volatile uint32_t lt_inside;
+static volatile uint32_t lt_errors;
+static volatile uint64_t lt_pair[2];   /* seqlock payload: both halves always equal */
+
+static volatile uint32_t lt_tas;
+static spinlock_t lt_spin;
+static rwlock_t lt_rw;
+static seqlock_t lt_seq;
+static mutex_t lt_mutex;
+
+static void lt_delay(uint32_t spins)
+{
+    for (uint32_t i = 0; i < spins; i++) {
+        __asm__ volatile ("pause");
+    }
+}
+
+/* Body of an exclusive section: anyone else inside is a violation. */
+static void lt_exclusive(void)
+{
+    if (__atomic_add_fetch(&lt_inside, 1u, __ATOMIC_RELAXED) != 1u) {
+        __atomic_fetch_add(&lt_errors, 1u, __ATOMIC_RELAXED);
+    }
+    lt_delay(LOCKTEST_HOLD_SPINS);
+    __atomic_sub_fetch(&lt_inside, 1u, __ATOMIC_RELAXED);
+}
+
+/* Body of a read section: readers may overlap each other, never the writer. */
+static void lt_shared(void)
+{
+    if (__atomic_load_n(&lt_inside, __ATOMIC_RELAXED) & RWLOCK_WRITER) {
+        __atomic_fetch_add(&lt_errors, 1u, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&lt_inside, 1u, __ATOMIC_RELAXED);
+    lt_delay(LOCKTEST_HOLD_SPINS);
+    __atomic_sub_fetch(&lt_inside, 1u, __ATOMIC_RELAXED);
+}
+
+static void lt_rw_writer(void)
+{
+    if (__atomic_fetch_or(&lt_inside, RWLOCK_WRITER, __ATOMIC_RELAXED) != 0) {
+        __atomic_fetch_add(&lt_errors, 1u, __ATOMIC_RELAXED);
+    }
+    lt_delay(LOCKTEST_HOLD_SPINS);
+    __atomic_fetch_and(&lt_inside, ~RWLOCK_WRITER, __ATOMIC_RELAXED);
+}
+
+static void lt_iteration(uint32_t id, lt_counter_t* c)
+{
+    switch (lt_phase) {
+    case LT_TAS:
+        preempt_disable();
+        while (__sync_lock_test_and_set(&lt_tas, 1)) {
+            __asm__ volatile ("pause");
+        }
+        lt_exclusive();
+        __sync_lock_release(&lt_tas);
+        preempt_enable();
+        break;
+    case LT_TICKET:
+        spinlock_lock(&lt_spin);
+        lt_exclusive();
+        spinlock_unlock(&lt_spin);
+        break;
+    case LT_TICKET_IRQ: {
+        irql_t irql = spinlock_lock_irqsave(&lt_spin);
+        lt_exclusive();
+        spinlock_unlock_irqrestore(&lt_spin, irql);
+        break;
+    }
+    case LT_RWLOCK:
+        if (id == 0) {
+            rwlock_write_lock(&lt_rw);
+            lt_rw_writer();
+            rwlock_write_unlock(&lt_rw);
+        } else {
+            rwlock_read_lock(&lt_rw);
+            lt_shared();
+            rwlock_read_unlock(&lt_rw);
+        }
+        break;
+    case LT_SEQLOCK:
+        if (id == 0) {
+            seqlock_write_begin(&lt_seq);
+            lt_pair[0]++;
+            lt_delay(LOCKTEST_HOLD_SPINS);
+            lt_pair[1]++;
+            seqlock_write_end(&lt_seq);
+        } else {
+            uint64_t a, b;
+            for (;;) {
+                uint32_t seq = seqlock_read_begin(&lt_seq);
+                a = lt_pair[0];
+                lt_delay(LOCKTEST_HOLD_SPINS);
+                b = lt_pair[1];
+                if (!seqlock_read_retry(&lt_seq, seq)) {
+                    break;
+                }
+                c->retries++;
+            }
+            if (a != b) {
+                __atomic_fetch_add(&lt_errors, 1u, __ATOMIC_RELAXED);
+            }
+        }
+        break;
+    case LT_MUTEX:
+        mutex_lock(&lt_mutex);
+        lt_exclusive();
+        mutex_unlock(&lt_mutex);
+        break;
+    default:
+        break;
+    }
+    c->ops++;
+}
+
+static void lt_worker(void* arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    lt_counter_t* c = &lt_count[id];
+    while (!lt_stop) {
+        lt_iteration(id, c);
+        lt_delay(LOCKTEST_IDLE_SPINS);
+    }
+    __atomic_fetch_add(&lt_done, 1u, __ATOMIC_RELEASE);
+    scheduler_exit_current();
+}
+
+static void lt_report(uint32_t phase, uint64_t elapsed_ns)
+{
+    uint64_t ms = elapsed_ns / 1000000u;
+    if (ms == 0) {
+        ms = 1;
+    }
+    /* Fairness is compared among threads doing the same thing. */
+    uint32_t first = (phase == LT_RWLOCK || phase == LT_SEQLOCK) ? 1u : 0u;
+    uint64_t total = 0, min = UINT64_MAX, max = 0, retries = 0;
+    for (uint32_t i = first; i < LOCKTEST_THREADS; i++) {
+        uint64_t ops = lt_count[i].ops;
+        total += ops;
+        retries += lt_count[i].retries;
+        min = ops < min ? ops : min;
+        max = ops > max ? ops : max;
+    }
+    uint64_t fair = max ? (min * 100u) / max : 0;
+    kprintf("[LOCKTEST] %s: %llu acq/s  min/max %llu/%llu (fair %llu%%)",
+            lt_phase_names[phase], (unsigned long long)(total * 1000u / ms),
+            (unsigned long long)min, (unsigned long long)max, (unsigned long long)fair);
+    if (first) {
+        kprintf("  writes/s %llu", (unsigned long long)(lt_count[0].ops * 1000u / ms));
+    }
+    if (phase == LT_SEQLOCK) {
+        kprintf("  retries %llu", (unsigned long long)retries);
+    }
+    kprintf("  errors %u\n", (unsigned)lt_errors);
+}
+
+static void lt_main(void* arg)
+{
+    (void)arg;
+    task_t* task = task_get_current();
+    uint32_t failures = 0;
+    spinlock_init(&lt_spin);
+    rwlock_init(&lt_rw);
+    seqlock_init(&lt_seq);
+    mutex_init(&lt_mutex, "locktest");
+    kprintf("[LOCKTEST] %u threads, %u ms per phase, %u cpu(s)\n",
+            (unsigned)LOCKTEST_THREADS, (unsigned)LOCKTEST_PHASE_MS, (unsigned)cpu_get_count());
+
+    for (uint32_t phase = 0; phase < LT_PHASES; phase++) {
+        for (uint32_t i = 0; i < LOCKTEST_THREADS; i++) {
+            lt_count[i].ops = 0;
+            lt_count[i].retries = 0;
+        }
+        lt_inside = 0;
+        lt_errors = 0;
+        lt_stop = 0;
+        lt_done = 0;
+        lt_phase = phase;
+        uint32_t started = 0;
+        for (uint32_t i = 0; i < LOCKTEST_THREADS; i++) {
+            thread_t* t = task ? thread_create(task, lt_worker, (void*)(uintptr_t)i) : NULL;
+            if (!t) {
+                break;
+            }
+            scheduler_add_thread(t);
+            started++;
+        }
+        uint64_t t0 = cpu_get_time();
+        scheduler_sleep(LOCKTEST_PHASE_MS);
+        lt_stop = 1;
+        uint64_t elapsed = rusage_cycles_to_ns(cpu_get_time() - t0);
+        while (__atomic_load_n(&lt_done, __ATOMIC_ACQUIRE) < started) {
+            scheduler_sleep(SCHEDULER_TIME_SLICE_MS);
+        }
+        if (started < LOCKTEST_THREADS) {
+            kprintf("[LOCKTEST] %s: only %u of %u threads started\n",
+                    lt_phase_names[phase], (unsigned)started, (unsigned)LOCKTEST_THREADS);
+            failures++;
+            continue;
+        }
+        lt_report(phase, elapsed);
+        failures += lt_errors ? 1u : 0u;
+    }
+    kprintf("[LOCKTEST] %s\n", failures ? "FAIL" : "PASS");
+    scheduler_exit_current();
+}
+
+void locktest_start(void)
+{
+    task_t* task = task_get_current();
+    if (!task) {
+        return;
+    }
+    thread_t* t = thread_create(task, lt_main, NULL);
+    if (!t) {
+        kputs("[LOCKTEST] thread_create failed\n");
+        return;
+    }
+    scheduler_add_thread(t);
+}
@@ -0,0 +1,12 @@
+/**
+ * @file locktest.h
+ * @brief Boot-time lock self-test (boot arg "locktest=1")
+ */
+
+#ifndef _RODNIX_COMMON_LOCKTEST_H
+#define _RODNIX_COMMON_LOCKTEST_H
+
+/* Spawn the self-test coordinator thread; results go to the console as [LOCKTEST] lines. */
+void locktest_start(void);
+
+#endif /* _RODNIX_COMMON_LOCKTEST_H */
@@ -0,0 +1,130 @@
+/**
+ * @file mutex.c
+ * @brief Sleeping mutexes with adaptive spinning
+ *
+ * The state word follows the classic three-state futex mutex: the fast
+ * paths are a single compare-and-swap, and unlock only takes the wait
+ * queue lock when the word says a sleeper may exist. A thread that has
+ * slept re-takes the mutex as MUTEX_CONTENDED, because other sleepers may
+ * still be queued behind it.
+ *
+ * Sleepers queue on the wait queue under wait_lock with IRQL raised, then
+ * drop both and call waitq_wait(): an unlock that dequeues them in between
+ * makes waitq_wait() return at once, so no wakeup is lost.
+ */
+
+#include "mutex.h"
+#include "scheduler.h"
+#include "../core/cpu.h"
+#include "../../include/debug.h"
+#include <stddef.h>
+
+void mutex_init(mutex_t* m, const char* name)
+{
+    if (!m) {
+        return;
+    }
+    m->state = MUTEX_UNLOCKED;
+    m->owner = NULL;
+    spinlock_init_named(&m->wait_lock, name);
+    waitq_init(&m->waiters, name);
+}
+
+static inline bool mutex_cas(mutex_t* m, uint32_t from, uint32_t to)
+{
+    return __atomic_compare_exchange_n(&m->state, &from, to, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+/*
+ * Spin while the owner is running elsewhere; true if the mutex was seen
+ * free. Pointless on one CPU: a running owner there would be us.
+ */
+static bool mutex_spin_on_owner(mutex_t* m)
+{
+    if (cpu_get_count() < 2) {
+        return false;
+    }
+    for (uint32_t i = 0; i < MUTEX_SPIN_MAX; i++) {
+        if (__atomic_load_n(&m->state, __ATOMIC_RELAXED) == MUTEX_UNLOCKED) {
+            return true;
+        }
+        thread_t* owner = m->owner;
+        if (owner && owner->state != THREAD_STATE_RUNNING) {
+            return false;
+        }
+        __asm__ volatile ("pause");
+    }
+    return false;
+}
+
+static void mutex_lock_slow(mutex_t* m, thread_t* self)
+{
+    if (mutex_spin_on_owner(m) && mutex_cas(m, MUTEX_UNLOCKED, MUTEX_LOCKED)) {
+        return;
+    }
+    if (!self) {
+        /* Before the scheduler runs there is nobody to sleep as. */
+        while (!mutex_cas(m, MUTEX_UNLOCKED, MUTEX_LOCKED)) {
+            __asm__ volatile ("pause");
+        }
+        return;
+    }
+    for (;;) {
+        irql_t irql = spinlock_lock_irqsave(&m->wait_lock);
+        if (__atomic_exchange_n(&m->state, MUTEX_CONTENDED, __ATOMIC_ACQUIRE) == MUTEX_UNLOCKED) {
+            spinlock_unlock_irqrestore(&m->wait_lock, irql);
+            return;
+        }
+        (void)waitq_enqueue(&m->waiters, self);
+        spinlock_unlock_irqrestore(&m->wait_lock, irql);
+        (void)waitq_wait(&m->waiters, 0);
+    }
+}
+
+void mutex_lock(mutex_t* m)
+{
+    if (!m) {
+        return;
+    }
+    thread_t* self = thread_get_current();
+    PANIC_IF(self && m->owner == self, "mutex_lock: recursive lock of %s",
+             m->waiters.name ? m->waiters.name : "mutex");
+    if (!mutex_cas(m, MUTEX_UNLOCKED, MUTEX_LOCKED)) {
+        mutex_lock_slow(m, self);
+    }
+    m->owner = self;
+}
+
+bool mutex_trylock(mutex_t* m)
+{
+    if (!m || !mutex_cas(m, MUTEX_UNLOCKED, MUTEX_LOCKED)) {
+        return false;
+    }
+    m->owner = thread_get_current();
+    return true;
+}
+
+void mutex_unlock(mutex_t* m)
+{
+    if (!m) {
+        return;
+    }
+    m->owner = NULL;
+    if (__atomic_exchange_n(&m->state, MUTEX_UNLOCKED, __ATOMIC_RELEASE) != MUTEX_CONTENDED) {
+        return;
+    }
+    irql_t irql = spinlock_lock_irqsave(&m->wait_lock);
+    (void)waitq_wake_one(&m->waiters);
+    spinlock_unlock_irqrestore(&m->wait_lock, irql);
+}
+
+bool mutex_is_locked(const mutex_t* m)
+{
+    return m && __atomic_load_n(&m->state, __ATOMIC_RELAXED) != MUTEX_UNLOCKED;
+}
+
+bool mutex_owned(const mutex_t* m)
+{
+    return m && m->owner != NULL && m->owner == thread_get_current();
+}
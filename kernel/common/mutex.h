@@ -0,0 +1,42 @@
+/**
+ * @file mutex.h
+ * @brief Sleeping mutexes with adaptive spinning
+ *
+ * For sections that may run long or block (I/O, allocation, copyin): a
+ * contended locker first spins while the owner is running on another CPU,
+ * since the owner is then likely to release soon, and otherwise sleeps on
+ * the mutex wait queue. Thread context only -- never from an ISR or with a
+ * spinlock held. Not recursive.
+ */
+
+#ifndef _RODNIX_COMMON_MUTEX_H
+#define _RODNIX_COMMON_MUTEX_H
+
+#include "waitq.h"
+#include "../fabric/spin.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct mutex {
+    volatile uint32_t state;   /* MUTEX_UNLOCKED / MUTEX_LOCKED / MUTEX_CONTENDED */
+    thread_t* volatile owner;
+    spinlock_t wait_lock;      /* orders sleepers against the unlock wakeup */
+    waitq_t waiters;
+} mutex_t;
+
+enum {
+    MUTEX_UNLOCKED  = 0,
+    MUTEX_LOCKED    = 1,
+    MUTEX_CONTENDED = 2,   /* locked, and there may be sleepers to wake */
+};
+
+#define MUTEX_SPIN_MAX 4096u   /* pause iterations spent on a running owner */
+
+void mutex_init(mutex_t* m, const char* name);
+void mutex_lock(mutex_t* m);
+bool mutex_trylock(mutex_t* m);
+void mutex_unlock(mutex_t* m);
+bool mutex_is_locked(const mutex_t* m);
+bool mutex_owned(const mutex_t* m);
+
+#endif /* _RODNIX_COMMON_MUTEX_H */
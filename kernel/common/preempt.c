@@ -0,0 +1,193 @@
+/**
+ * @file preempt.c
+ * @brief Preempt counts, preemption points and preemption statistics
+ *
+ * The count lives in the thread, so a thread switched away from inside a
+ * preempt-off section (it blocked -- a bug, reported once) takes its count
+ * along and the next thread starts clean. Before the first thread runs the
+ * boot context uses preempt_boot_count. Interrupts only adjust the count
+ * of the thread they interrupted and restore it before returning, so the
+ * read-modify-write here needs no atomics.
+ *
+ * A switch is requested through PREEMPT_RESCHED_VECTOR, which enters the
+ * scheduler like the timer does but without charging a tick.
+ */
+
+#include "preempt.h"
+#include "lattrace.h"
+#include "scheduler.h"
+#include "../core/task.h"
+#include "../../include/console.h"
+#include <stddef.h>
+
+static volatile uint32_t preempt_boot_count = 0;
+static int preempt_mode = PREEMPT_MODE_FULL;
+static preempt_stats_t preempt_stats;
+static bool preempt_warned_underflow = false;
+static bool preempt_warned_atomic = false;
+
+static inline volatile uint32_t* preempt_count_ptr(void)
+{
+    thread_t* t = thread_get_current();
+    return t ? &t->preempt_count : &preempt_boot_count;
+}
+
+static inline bool preempt_irqs_on(void)
+{
+    uint64_t flags;
+    __asm__ volatile ("pushfq; pop %0" : "=r"(flags));
+    return (flags & 0x200u) != 0;
+}
+
+void preempt_disable_at(uintptr_t ip)
+{
+    volatile uint32_t* pc = preempt_count_ptr();
+    uint32_t old = *pc;
+    *pc = old + 1u;
+    __asm__ volatile ("" ::: "memory");
+    if (old == 0) {
+        lattrace_section_begin(LAT_PREEMPTOFF, ip);
+    }
+}
+
+void preempt_disable(void)
+{
+    preempt_disable_at((uintptr_t)__builtin_return_address(0));
+}
+
+/* Drop one level; true when the count reached zero. */
+static bool preempt_count_dec(uintptr_t ip)
+{
+    __asm__ volatile ("" ::: "memory");
+    volatile uint32_t* pc = preempt_count_ptr();
+    uint32_t old = *pc;
+    if ((old & PREEMPT_MASK) == 0) {
+        if (!preempt_warned_underflow) {
+            preempt_warned_underflow = true;
+            kprintf("[PREEMPT] preempt_enable() without preempt_disable() at %p\n", (void*)ip);
+        }
+        return false;
+    }
+    *pc = old - 1u;
+    if (old != 1u) {
+        return false;
+    }
+    lattrace_section_end(LAT_PREEMPTOFF);
+    return true;
+}
+
+void preempt_enable_no_resched(void)
+{
+    (void)preempt_count_dec((uintptr_t)__builtin_return_address(0));
+}
+
+void preempt_enable(void)
+{
+    if (!preempt_count_dec((uintptr_t)__builtin_return_address(0))) {
+        return;
+    }
+    /*
+     * With IRQs masked the caller may still rely on not being switched
+     * (raised IRQL, SYSCALL under preempt=voluntary): leave the pending
+     * reschedule to the next preemption point.
+     */
+    if (preempt_irqs_on() && scheduler_need_resched()) {
+        preempt_stats.enable_resched++;
+        scheduler_ast_check();
+    }
+}
+
+uint32_t preempt_count(void)
+{
+    return *preempt_count_ptr();
+}
+
+bool preemptible(void)
+{
+    return preempt_count() == 0 && preempt_irqs_on();
+}
+
+bool in_hardirq(void)
+{
+    return (preempt_count() & PREEMPT_HARDIRQ_MASK) != 0;
+}
+
+void cond_resched(void)
+{
+    if (preempt_count() != 0) {
+        return;
+    }
+    /* A preemption point ends the IRQ-off stretch of a voluntary SYSCALL. */
+    bool irqs_off = !preempt_irqs_on();
+    if (irqs_off) {
+        lattrace_section_end(LAT_IRQSOFF);
+    }
+    if (scheduler_need_resched()) {
+        preempt_stats.cond_resched++;
+        scheduler_ast_check();
+    }
+    if (irqs_off) {
+        lattrace_section_begin(LAT_IRQSOFF, (uintptr_t)__builtin_return_address(0));
+    }
+}
+
+void preempt_irq_enter(void)
+{
+    volatile uint32_t* pc = preempt_count_ptr();
+    *pc += PREEMPT_HARDIRQ_OFFSET;
+    lattrace_section_begin(LAT_IRQSOFF, (uintptr_t)__builtin_return_address(0));
+}
+
+void preempt_irq_exit(void)
+{
+    lattrace_section_end(LAT_IRQSOFF);
+    volatile uint32_t* pc = preempt_count_ptr();
+    if (*pc & PREEMPT_HARDIRQ_MASK) {
+        *pc -= PREEMPT_HARDIRQ_OFFSET;
+    }
+}
+
+bool preempt_switch_allowed(const thread_t* cur)
+{
+    if (!cur || cur->preempt_count == 0) {
+        return true;
+    }
+    preempt_stats.deferred++;
+    return false;
+}
+
+void preempt_note_switch(const thread_t* prev, bool voluntary)
+{
+    if (prev) {
+        if (!voluntary) {
+            preempt_stats.involuntary++;
+        } else if (prev->preempt_count & PREEMPT_MASK) {
+            preempt_stats.atomic_sleeps++;
+            if (!preempt_warned_atomic) {
+                preempt_warned_atomic = true;
+                kprintf("[PREEMPT] tid %llu blocked with preempt_count %u\n",
+                        (unsigned long long)prev->thread_id, (unsigned)prev->preempt_count);
+            }
+        }
+    }
+    lattrace_switch();
+}
+
+void preempt_set_mode(int mode)
+{
+    if (mode == PREEMPT_MODE_VOLUNTARY || mode == PREEMPT_MODE_FULL) {
+        preempt_mode = mode;
+    }
+}
+
+int preempt_get_mode(void)
+{
+    return preempt_mode;
+}
+
+void preempt_get_stats(preempt_stats_t* out)
+{
+    if (out) {
+        *out = preempt_stats;
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * @file preempt.h
+ * @brief Kernel preemption control: preempt counts and preemption points
+ *
+ * Every thread carries a preempt count. Spinlocks, rwlocks and RCU read
+ * sections raise it, interrupt handlers add PREEMPT_HARDIRQ_OFFSET for
+ * their duration. The scheduler only switches away from a running thread
+ * at IRQ exit while the count is zero; a reschedule requested inside a
+ * preempt-off section is carried out by the preempt_enable() that closes
+ * it.
+ *
+ * Long loops that run in thread context and hold no spinlock call
+ * cond_resched() every so often, which is also where the voluntary model
+ * (boot token "preempt=voluntary", SYSCALL handlers with IRQs masked)
+ * switches. The default "preempt=full" runs syscall handlers with IRQs on,
+ * so any point with a zero count is a preemption point.
+ */
+
+#ifndef _RODNIX_COMMON_PREEMPT_H
+#define _RODNIX_COMMON_PREEMPT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+#define PREEMPT_MASK           0x0000FFFFu   /* preempt_disable() nesting */
+#define PREEMPT_HARDIRQ_OFFSET 0x00010000u
+#define PREEMPT_HARDIRQ_MASK   0x00FF0000u
+
+/* Software interrupt that switches the current thread synchronously. */
+#define PREEMPT_RESCHED_VECTOR 0x81
+
+enum {
+    PREEMPT_MODE_VOLUNTARY = 1,   /* switch at IRQ exit (IRQs on), blocking and cond_resched() */
+    PREEMPT_MODE_FULL      = 2,   /* and in SYSCALL handlers, which run with IRQs on */
+};
+
+typedef struct preempt_stats {
+    uint64_t involuntary;       /* running threads switched away (IRQ exit, preemption points) */
+    uint64_t deferred;          /* IRQ-exit switches refused: preempt count > 0 */
+    uint64_t enable_resched;    /* switches from preempt_enable() */
+    uint64_t cond_resched;      /* switches from cond_resched() and syscall exit */
+    uint64_t atomic_sleeps;     /* threads that blocked with preemption disabled */
+} preempt_stats_t;
+
+void preempt_disable(void);
+void preempt_disable_at(uintptr_t ip);
+void preempt_enable(void);
+void preempt_enable_no_resched(void);
+uint32_t preempt_count(void);
+
+/* Thread context with preemption on: sleeping and switching are allowed. */
+bool preemptible(void);
+bool in_hardirq(void);
+
+/*
+ * Preemption point for long kernel loops: switches if a reschedule is
+ * pending. No-op with a spinlock held or in an interrupt handler.
+ */
+void cond_resched(void);
+
+/* Around IRQ handlers (arch dispatcher): hardirq count and IRQ-off tracing. */
+void preempt_irq_enter(void);
+void preempt_irq_exit(void);
+
+/* Scheduler hooks: may cur be switched away now; account a switch. */
+bool preempt_switch_allowed(const struct thread* cur);
+void preempt_note_switch(const struct thread* prev, bool voluntary);
+
+void preempt_set_mode(int mode);
+int preempt_get_mode(void);
+void preempt_get_stats(preempt_stats_t* out);
+
+#endif /* _RODNIX_COMMON_PREEMPT_H */
@@ -0,0 +1,249 @@
+/**
+ * @file prof.c
+ * @brief Sampling profiler core: per-CPU sample rings, start/stop, drain
+ *
+ * Samples are taken from interrupt context: on the PMU overflow NMI when the
+ * CPU has architectural performance monitoring (kernel/arch/x86_64/pmu.c),
+ * otherwise from the timer interrupt every `period` ticks. The interrupted
+ * context is unwound by the architecture code (frame pointers) and the
+ * sample is pushed into a per-CPU single-producer ring. The producer is the
+ * sampling interrupt on that CPU and never takes locks (an NMI can hit any
+ * code, including the reader); the only consumer is prof_read() under
+ * prof_spin, which also serialises start/stop/status across CPUs. A full
+ * ring drops the sample and counts it.
+ */
+
+#include "prof.h"
+#include "heap.h"
+#include "../core/cpu.h"
+#include "../core/interrupts.h"
+#include "../core/task.h"
+#include "../fabric/spin.h"
+#include "../../include/common.h"
+#include "../../include/error.h"
+#include <stddef.h>
+
+typedef struct prof_ring {
+    prof_sample_t* buf;
+    volatile uint32_t head;  /* written by the sampling interrupt */
+    volatile uint32_t tail;  /* written by prof_read() */
+    uint64_t ticks;          /* timer mode: ticks since the last sample */
+} prof_ring_t;
+
+static prof_ring_t prof_rings[PROF_MAX_CPUS];
+static volatile uint32_t prof_mode = PROF_MODE_OFF;
+static uint64_t prof_period = 0;
+static volatile uint64_t prof_samples = 0;
+static volatile uint64_t prof_dropped = 0;
+static prof_arch_info_t prof_pmu;
+static int prof_pmu_probed = 0;
+static spinlock_t prof_spin;
+
+static uint32_t prof_ncpus(void)
+{
+    uint32_t n = cpu_get_count();
+    if (n == 0) {
+        n = 1;
+    }
+    return n > PROF_MAX_CPUS ? PROF_MAX_CPUS : n;
+}
+
+static int prof_alloc_rings(void)
+{
+    uint32_t n = prof_ncpus();
+    for (uint32_t i = 0; i < n; i++) {
+        if (prof_rings[i].buf) {
+            continue;
+        }
+        prof_rings[i].buf = (prof_sample_t*)kmalloc(sizeof(prof_sample_t) * PROF_RING_SAMPLES);
+        if (!prof_rings[i].buf) {
+            return RDNX_E_NOMEM;
+        }
+        prof_rings[i].head = 0;
+        prof_rings[i].tail = 0;
+    }
+    return RDNX_OK;
+}
+
+int prof_start(uint32_t flags, uint64_t period)
+{
+    if (!prof_pmu_probed) {
+        if (prof_arch_pmu_probe(&prof_pmu) != RDNX_OK) {
+            memset(&prof_pmu, 0, sizeof(prof_pmu));
+        }
+        prof_pmu_probed = 1;
+    }
+
+    irql_t old = spinlock_lock_irqsave(&prof_spin);
+    if (prof_mode != PROF_MODE_OFF) {
+        spinlock_unlock_irqrestore(&prof_spin, old);
+        return RDNX_E_BUSY;
+    }
+    int rc = prof_alloc_rings();
+    if (rc != RDNX_OK) {
+        spinlock_unlock_irqrestore(&prof_spin, old);
+        return rc;
+    }
+    for (uint32_t i = 0; i < PROF_MAX_CPUS; i++) {
+        prof_rings[i].head = 0;
+        prof_rings[i].tail = 0;
+        prof_rings[i].ticks = 0;
+    }
+    prof_samples = 0;
+    prof_dropped = 0;
+
+    uint32_t mode = PROF_MODE_TIMER;
+    if (!(flags & PROF_F_TIMER) && prof_pmu.version > 0) {
+        mode = PROF_MODE_PMU;
+    }
+    if (mode == PROF_MODE_PMU) {
+        if (period == 0) {
+            period = PROF_DEFAULT_PERIOD;
+        }
+        if (period > PROF_MAX_PERIOD) {
+            period = PROF_MAX_PERIOD;
+        }
+        if (period < 1000) {
+            /* Shorter periods turn the machine into an NMI storm. */
+            period = 1000;
+        }
+        prof_period = period;
+        prof_mode = PROF_MODE_PMU;
+        if (prof_arch_pmu_start(period) != RDNX_OK) {
+            mode = PROF_MODE_TIMER;
+            period = 0;
+        }
+    }
+    if (mode == PROF_MODE_TIMER) {
+        prof_period = period ? period : 1;
+        prof_mode = PROF_MODE_TIMER;
+    }
+    spinlock_unlock_irqrestore(&prof_spin, old);
+    return RDNX_OK;
+}
+
+int prof_stop(void)
+{
+    irql_t old = spinlock_lock_irqsave(&prof_spin);
+    if (prof_mode == PROF_MODE_PMU) {
+        prof_arch_pmu_stop();
+    }
+    prof_mode = PROF_MODE_OFF;
+    spinlock_unlock_irqrestore(&prof_spin, old);
+    return RDNX_OK;
+}
+
+void prof_get_status(prof_status_t* out)
+{
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (!prof_pmu_probed) {
+        if (prof_arch_pmu_probe(&prof_pmu) != RDNX_OK) {
+            memset(&prof_pmu, 0, sizeof(prof_pmu));
+        }
+        prof_pmu_probed = 1;
+    }
+    irql_t old = spinlock_lock_irqsave(&prof_spin);
+    out->mode = prof_mode;
+    out->running = prof_mode != PROF_MODE_OFF;
+    out->cpus = prof_ncpus();
+    out->pmu_version = prof_pmu.version;
+    out->pmu_counters = prof_pmu.counters;
+    out->pmu_width = prof_pmu.width;
+    out->period = prof_period;
+    out->samples = prof_samples;
+    out->dropped = prof_dropped;
+    for (uint32_t i = 0; i < PROF_MAX_CPUS; i++) {
+        out->pending += (uint32_t)(prof_rings[i].head - prof_rings[i].tail);
+    }
+    spinlock_unlock_irqrestore(&prof_spin, old);
+}
+
+uint32_t prof_read(prof_sample_t* out, uint32_t max)
+{
+    uint32_t copied = 0;
+    if (!out) {
+        return 0;
+    }
+    irql_t old = spinlock_lock_irqsave(&prof_spin);
+    for (uint32_t i = 0; i < PROF_MAX_CPUS && copied < max; i++) {
+        prof_ring_t* r = &prof_rings[i];
+        if (!r->buf) {
+            continue;
+        }
+        uint32_t tail = r->tail;
+        uint32_t head = r->head;
+        __asm__ volatile ("" ::: "memory");
+        while (tail != head && copied < max) {
+            memcpy(&out[copied++], &r->buf[tail % PROF_RING_SAMPLES], sizeof(prof_sample_t));
+            tail++;
+        }
+        __asm__ volatile ("" ::: "memory");
+        r->tail = tail;
+    }
+    spinlock_unlock_irqrestore(&prof_spin, old);
+    return copied;
+}
+
+void prof_sample(const void* arch_frame)
+{
+    uint32_t cpu = cpu_get_id();
+    if (cpu >= PROF_MAX_CPUS) {
+        return;
+    }
+    prof_ring_t* r = &prof_rings[cpu];
+    if (!r->buf) {
+        return;
+    }
+    uint32_t head = r->head;
+    if (head - r->tail >= PROF_RING_SAMPLES) {
+        prof_dropped++;
+        return;
+    }
+    prof_sample_t* s = &r->buf[head % PROF_RING_SAMPLES];
+    task_t* task = task_get_current();
+    s->pid = task ? (uint32_t)task->task_id : 0;
+    for (uint32_t i = 0; i < PROF_COMM_MAX; i++) {
+        s->comm[i] = task ? task->comm[i] : 0;
+    }
+    s->comm[PROF_COMM_MAX - 1] = 0;
+    s->nr_kernel = 0;
+    s->nr_user = 0;
+    prof_arch_unwind(arch_frame, s);
+    if (s->nr_kernel + s->nr_user == 0) {
+        return;
+    }
+    __asm__ volatile ("" ::: "memory");
+    r->head = head + 1;
+    prof_samples++;
+}
+
+void prof_timer_tick(const void* arch_frame)
+{
+    if (prof_mode != PROF_MODE_TIMER) {
+        return;
+    }
+    uint32_t cpu = cpu_get_id();
+    if (cpu >= PROF_MAX_CPUS) {
+        return;
+    }
+    if (++prof_rings[cpu].ticks < prof_period) {
+        return;
+    }
+    prof_rings[cpu].ticks = 0;
+    prof_sample(arch_frame);
+}
+
+int prof_nmi(const void* arch_frame)
+{
+    if (prof_mode != PROF_MODE_PMU) {
+        return 0;
+    }
+    if (!prof_arch_pmu_ack()) {
+        return 0;
+    }
+    prof_sample(arch_frame);
+    return 1;
+}
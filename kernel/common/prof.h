@@ -0,0 +1,83 @@
+/**
+ * @file prof.h
+ * @brief Sampling profiler: PMU overflow NMI or timer-tick samples with call stacks
+ */
+
+#ifndef _RODNIX_COMMON_PROF_H
+#define _RODNIX_COMMON_PROF_H
+
+#include <stdint.h>
+
+#define PROF_MAX_CPUS 8
+#define PROF_MAX_DEPTH 24          /* kernel + user frames per sample */
+#define PROF_RING_SAMPLES 1024     /* per CPU */
+#define PROF_COMM_MAX 16
+#define PROF_DEFAULT_PERIOD 10000000ULL  /* unhalted core cycles between PMU samples */
+#define PROF_MAX_PERIOD 0x7fffffffULL    /* PMC writes are sign-extended from 32 bits */
+
+enum {
+    PROF_MODE_OFF   = 0,
+    PROF_MODE_PMU   = 1, /* counter overflow delivered as NMI */
+    PROF_MODE_TIMER = 2, /* every period-th scheduler tick */
+};
+
+/* profctl() ops and flags. */
+enum {
+    PROF_OP_START  = 1,
+    PROF_OP_STOP   = 2,
+    PROF_OP_STATUS = 3,
+};
+#define PROF_F_TIMER 0x1u  /* do not use the PMU even if present */
+
+/* One sample: ips[0..nr_kernel) kernel frames, then nr_user user frames; leaf first. */
+typedef struct prof_sample {
+    uint32_t pid;
+    uint16_t nr_kernel;
+    uint16_t nr_user;
+    char comm[PROF_COMM_MAX];
+    uint64_t ips[PROF_MAX_DEPTH];
+} prof_sample_t;
+
+/* Mirrors rodnix_profstat_t. */
+typedef struct prof_status {
+    uint32_t mode;
+    uint32_t running;
+    uint32_t cpus;
+    uint32_t pmu_version;    /* CPUID.0AH architectural perfmon version, 0 = none */
+    uint32_t pmu_counters;
+    uint32_t pmu_width;
+    uint64_t period;         /* cycles (PMU) or ticks (timer) */
+    uint64_t samples;
+    uint64_t dropped;        /* ring full */
+    uint64_t pending;        /* buffered, not read yet */
+} prof_status_t;
+
+int prof_start(uint32_t flags, uint64_t period);
+int prof_stop(void);
+void prof_get_status(prof_status_t* out);
+/* Drain buffered samples of all CPUs into out; returns the number copied. */
+uint32_t prof_read(prof_sample_t* out, uint32_t max);
+
+/* Sample the interrupted context; arch_frame is the trap frame. NMI-safe. */
+void prof_sample(const void* arch_frame);
+/* Timer interrupt hook (timer mode). */
+void prof_timer_tick(const void* arch_frame);
+/* NMI hook: 1 if the NMI was a profiling counter overflow. */
+int prof_nmi(const void* arch_frame);
+
+/* Architecture side (kernel/arch/<arch>/pmu.c). */
+typedef struct prof_arch_info {
+    uint32_t version;
+    uint32_t counters;
+    uint32_t width;
+} prof_arch_info_t;
+
+int prof_arch_pmu_probe(prof_arch_info_t* out);
+int prof_arch_pmu_start(uint64_t period);
+void prof_arch_pmu_stop(void);
+/* Counter overflowed: rearm it; 0 if the NMI was not ours. */
+int prof_arch_pmu_ack(void);
+/* Fill ips/nr_kernel/nr_user from the trap frame. */
+void prof_arch_unwind(const void* arch_frame, prof_sample_t* s);
+
+#endif /* _RODNIX_COMMON_PROF_H */
@@ -0,0 +1,759 @@
+/**
+ * @file random.c
+ * @brief Kernel entropy pool, ChaCha20 CRNG and getrandom()
+ *
+ * Input pool: a running BLAKE2s hash. Extraction finalises a copy of it
+ * into a 32-byte seed and replaces the pool with a value derived from that
+ * seed (the ratchet). Sources are pulled while the pool is unseeded and
+ * every RANDOM_RESEED_MS after that; a blocked reader also times its own
+ * hashing with the TSC (jitter) and pulls again on every wait slice.
+ *
+ * CRNG: the base key is a pool extraction (plus RDRAND, uncredited) taken
+ * when the pool becomes seeded, every RANDOM_CRNG_RESEED_MS after that and
+ * every second before it. Each change bumps a generation number. A CPU
+ * whose key is from an older generation derives a new one from the base
+ * key under g_crng_lock; otherwise output is produced from the per-CPU key
+ * with only local interrupts disabled. Fast key erasure: the first ChaCha20
+ * block of every request replaces the key, the rest of the request is
+ * generated outside the critical section from the old key, which then
+ * exists only on the caller's stack and is wiped.
+ *
+ * Locks are taken with pushfq/cli/popfq rather than set_irql(): the
+ * u32/u64 helpers and interrupt mixing run inside ISRs, where set_irql()
+ * would re-enable interrupts.
+ */
+
+#include "random.h"
+#include "scheduler.h"
+#include "waitq.h"
+#include "preempt.h"
+#include "../core/cpu.h"
+#include "../core/task.h"
+#include "../fabric/spin.h"
+#include "../../include/common.h"
+#include "../../include/console.h"
+#include "../../include/error.h"
+
+#define RANDOM_WAIT_SLICE_MS        20u
+#define RANDOM_CRNG_EARLY_RESEED_MS 1000u
+#define RANDOM_IRQ_FOLD             64u      /* interrupts per fast pool fold */
+#define RANDOM_IRQ_FOLD_US          1000000u /* fold interval once seeded */
+#define RANDOM_JITTER_SAMPLES       64u
+#define RANDOM_HW_WORDS             4u       /* 64-bit RDSEED/RDRAND words per mix */
+
+/* ============================================================================
+ * BLAKE2s-256 (RFC 7693)
+ * ============================================================================ */
+
+typedef struct blake2s_state {
+    uint32_t h[8];
+    uint32_t t[2];
+    uint8_t buf[64];
+    uint32_t buflen;
+} blake2s_state_t;
+
+static const uint32_t g_blake2s_iv[8] = {
+    0x6A09E667u, 0xBB67AE85u, 0x3C6EF372u, 0xA54FF53Au,
+    0x510E527Fu, 0x9B05688Cu, 0x1F83D9ABu, 0x5BE0CD19u
+};
+
+static const uint8_t g_blake2s_sigma[10][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+    { 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+    { 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+    { 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+    { 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+    { 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+    { 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+    { 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+    { 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 }
+};
+
+static inline uint32_t ror32(uint32_t v, uint32_t n)
+{
+    return (v >> n) | (v << (32u - n));
+}
+
+static inline uint32_t le32_load(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#define B2S_G(a, b, c, d, x, y)          \
+    do {                                 \
+        v[a] = v[a] + v[b] + (x);        \
+        v[d] = ror32(v[d] ^ v[a], 16);   \
+        v[c] = v[c] + v[d];              \
+        v[b] = ror32(v[b] ^ v[c], 12);   \
+        v[a] = v[a] + v[b] + (y);        \
+        v[d] = ror32(v[d] ^ v[a], 8);    \
+        v[c] = v[c] + v[d];              \
+        v[b] = ror32(v[b] ^ v[c], 7);    \
+    } while (0)
+
+static void blake2s_compress(blake2s_state_t* s, const uint8_t* block, bool last)
+{
+    uint32_t m[16];
+    uint32_t v[16];
+    for (uint32_t i = 0; i < 16; i++) {
+        m[i] = le32_load(block + i * 4u);
+    }
+    for (uint32_t i = 0; i < 8; i++) {
+        v[i] = s->h[i];
+        v[i + 8] = g_blake2s_iv[i];
+    }
+    v[12] ^= s->t[0];
+    v[13] ^= s->t[1];
+    if (last) {
+        v[14] = ~v[14];
+    }
+    for (uint32_t r = 0; r < 10; r++) {
+        const uint8_t* sg = g_blake2s_sigma[r];
+        B2S_G(0, 4, 8, 12, m[sg[0]], m[sg[1]]);
+        B2S_G(1, 5, 9, 13, m[sg[2]], m[sg[3]]);
+        B2S_G(2, 6, 10, 14, m[sg[4]], m[sg[5]]);
+        B2S_G(3, 7, 11, 15, m[sg[6]], m[sg[7]]);
+        B2S_G(0, 5, 10, 15, m[sg[8]], m[sg[9]]);
+        B2S_G(1, 6, 11, 12, m[sg[10]], m[sg[11]]);
+        B2S_G(2, 7, 8, 13, m[sg[12]], m[sg[13]]);
+        B2S_G(3, 4, 9, 14, m[sg[14]], m[sg[15]]);
+    }
+    for (uint32_t i = 0; i < 8; i++) {
+        s->h[i] ^= v[i] ^ v[i + 8];
+    }
+}
+
+static void blake2s_add_count(blake2s_state_t* s, uint32_t n)
+{
+    s->t[0] += n;
+    if (s->t[0] < n) {
+        s->t[1]++;
+    }
+}
+
+static void blake2s_update(blake2s_state_t* s, const void* data, size_t len)
+{
+    const uint8_t* in = (const uint8_t*)data;
+    while (len > 0) {
+        /* The last block is compressed by final(), so only flush when more input follows. */
+        if (s->buflen == sizeof(s->buf)) {
+            blake2s_add_count(s, sizeof(s->buf));
+            blake2s_compress(s, s->buf, false);
+            s->buflen = 0;
+        }
+        uint32_t take = (uint32_t)sizeof(s->buf) - s->buflen;
+        if (take > len) {
+            take = (uint32_t)len;
+        }
+        memcpy(s->buf + s->buflen, in, take);
+        s->buflen += take;
+        in += take;
+        len -= take;
+    }
+}
+
+/* Keyed when key_len > 0 (at most 32 bytes); output is always 32 bytes. */
+static void blake2s_init(blake2s_state_t* s, const uint8_t* key, uint32_t key_len)
+{
+    memset(s, 0, sizeof(*s));
+    memcpy(s->h, g_blake2s_iv, sizeof(s->h));
+    s->h[0] ^= 0x01010000u | (key_len << 8) | 32u;
+    if (key_len > 0) {
+        memcpy(s->buf, key, key_len);
+        s->buflen = sizeof(s->buf);
+    }
+}
+
+static void blake2s_final(blake2s_state_t* s, uint8_t out[32])
+{
+    blake2s_add_count(s, s->buflen);
+    memset(s->buf + s->buflen, 0, sizeof(s->buf) - s->buflen);
+    blake2s_compress(s, s->buf, true);
+    for (uint32_t i = 0; i < 8; i++) {
+        out[i * 4u + 0] = (uint8_t)s->h[i];
+        out[i * 4u + 1] = (uint8_t)(s->h[i] >> 8);
+        out[i * 4u + 2] = (uint8_t)(s->h[i] >> 16);
+        out[i * 4u + 3] = (uint8_t)(s->h[i] >> 24);
+    }
+}
+
+/* Wipe key material; the empty asm keeps the stores from being elided. */
+static void random_wipe(void* p, size_t len)
+{
+    memset(p, 0, len);
+    __asm__ volatile ("" : : "r"(p) : "memory");
+}
+
+static inline uint64_t random_irq_save(void)
+{
+    uint64_t rflags;
+    __asm__ volatile ("pushfq; popq %0; cli" : "=r"(rflags) :: "memory");
+    return rflags;
+}
+
+static inline void random_irq_restore(uint64_t rflags)
+{
+    __asm__ volatile ("pushq %0; popfq" :: "r"(rflags) : "memory", "cc");
+}
+
+/* ============================================================================
+ * ChaCha20 block function (RFC 8439); words 12-13 are a 64-bit block counter
+ * ============================================================================ */
+
+#define CHACHA_STATE_WORDS 16u
+#define CHACHA_BLOCK_SIZE  64u
+#define CHACHA_KEY_SIZE    32u
+
+static inline uint32_t rol32(uint32_t v, uint32_t n)
+{
+    return (v << n) | (v >> (32u - n));
+}
+
+static inline void le32_store(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+#define CHACHA_QR(a, b, c, d)                               \
+    do {                                                    \
+        x[a] += x[b]; x[d] = rol32(x[d] ^ x[a], 16);        \
+        x[c] += x[d]; x[b] = rol32(x[b] ^ x[c], 12);        \
+        x[a] += x[b]; x[d] = rol32(x[d] ^ x[a], 8);         \
+        x[c] += x[d]; x[b] = rol32(x[b] ^ x[c], 7);         \
+    } while (0)
+
+static void chacha20_init(uint32_t st[CHACHA_STATE_WORDS], const uint8_t key[CHACHA_KEY_SIZE])
+{
+    st[0] = 0x61707865u;   /* "expand 32-byte k" */
+    st[1] = 0x3320646Eu;
+    st[2] = 0x79622D32u;
+    st[3] = 0x6B206574u;
+    for (uint32_t i = 0; i < 8; i++) {
+        st[4 + i] = le32_load(key + i * 4u);
+    }
+    st[12] = 0;
+    st[13] = 0;
+    st[14] = 0;
+    st[15] = 0;
+}
+
+/* One 64-byte keystream block; advances the block counter. */
+static void chacha20_block(uint32_t st[CHACHA_STATE_WORDS], uint8_t out[CHACHA_BLOCK_SIZE])
+{
+    uint32_t x[CHACHA_STATE_WORDS];
+    memcpy(x, st, sizeof(x));
+    for (uint32_t r = 0; r < 10; r++) {
+        CHACHA_QR(0, 4, 8, 12);
+        CHACHA_QR(1, 5, 9, 13);
+        CHACHA_QR(2, 6, 10, 14);
+        CHACHA_QR(3, 7, 11, 15);
+        CHACHA_QR(0, 5, 10, 15);
+        CHACHA_QR(1, 6, 11, 12);
+        CHACHA_QR(2, 7, 8, 13);
+        CHACHA_QR(3, 4, 9, 14);
+    }
+    for (uint32_t i = 0; i < CHACHA_STATE_WORDS; i++) {
+        le32_store(out + i * 4u, x[i] + st[i]);
+    }
+    if (++st[12] == 0) {
+        st[13]++;
+    }
+    random_wipe(x, sizeof(x));
+}
+
+/*
+ * Fast key erasure: block 0 under key replaces key and supplies up to
+ * 32 bytes of output; st is left keyed with the old key at block 1 for
+ * the rest of the request.
+ */
+static void crng_fast_key_erasure(uint8_t key[CHACHA_KEY_SIZE],
+                                  uint32_t st[CHACHA_STATE_WORDS],
+                                  uint8_t* data,
+                                  size_t len)
+{
+    uint8_t first[CHACHA_BLOCK_SIZE];
+    chacha20_init(st, key);
+    chacha20_block(st, first);
+    memcpy(key, first, CHACHA_KEY_SIZE);
+    if (len > 0) {
+        memcpy(data, first + CHACHA_KEY_SIZE, len);
+    }
+    random_wipe(first, sizeof(first));
+}
+
+/* ============================================================================
+ * Input pool
+ * ============================================================================ */
+
+typedef struct random_source {
+    const char* name;
+    random_pull_fn pull;
+    void* ctx;
+} random_source_t;
+
+/* Per-CPU interrupt timing accumulator (SipHash rounds, as in Linux fast_mix). */
+typedef struct random_fast_pool {
+    uint64_t s[4];
+    uint32_t count;
+    uint64_t last_fold_us;
+} __attribute__((aligned(64))) random_fast_pool_t;
+
+static spinlock_t g_pool_lock;
+static blake2s_state_t g_pool;
+static uint32_t g_credited_bits;        /* towards RANDOM_SEED_BITS */
+static volatile bool g_seeded;
+static uint64_t g_last_pull_us;
+static random_source_t g_sources[RANDOM_SOURCE_MAX];
+static uint32_t g_source_count;
+static waitq_t g_seed_wq;
+static bool g_ready;
+static random_fast_pool_t g_fast_pools[RANDOM_MAX_CPUS];
+
+/* ============================================================================
+ * CRNG state
+ * ============================================================================ */
+
+typedef struct crng_base {
+    spinlock_t lock;
+    uint8_t key[CHACHA_KEY_SIZE];
+    uint64_t generation;        /* bumped on every reseed; 0 is never current */
+    uint64_t birth_us;
+    bool reseed_pending;        /* pool just became seeded */
+} crng_base_t;
+
+/* Touched only by its own CPU with interrupts disabled. */
+typedef struct crng_cpu {
+    uint8_t key[CHACHA_KEY_SIZE];
+    uint64_t generation;
+    uint8_t batch[CHACHA_KEY_SIZE + CHACHA_BLOCK_SIZE];   /* random_get_u32/u64 */
+    uint32_t batch_pos;
+    uint64_t batch_generation;
+} __attribute__((aligned(64))) crng_cpu_t;
+
+static crng_base_t g_crng;
+static crng_cpu_t g_crng_cpus[RANDOM_MAX_CPUS];
+
+/* Hash into the pool; caller holds g_pool_lock. True when this input completed the seed. */
+static bool random_mix_locked(const void* buf, size_t len, uint32_t bits)
+{
+    uint64_t tsc = cpu_get_time();
+    blake2s_update(&g_pool, &tsc, sizeof(tsc));
+    blake2s_update(&g_pool, buf, len);
+    if (g_seeded || bits == 0) {
+        return false;
+    }
+    g_credited_bits += bits;
+    if (g_credited_bits < RANDOM_SEED_BITS) {
+        return false;
+    }
+    g_seeded = true;
+    __atomic_store_n(&g_crng.reseed_pending, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void random_seeded_wake(void)
+{
+    (void)waitq_wake_all(&g_seed_wq);
+}
+
+/* Mix up to RANDOM_HW_WORDS words from the CPU generator; returns how many it gave. */
+static uint32_t random_mix_cpu(bool seed, uint32_t bits_per_word)
+{
+    uint64_t hw[RANDOM_HW_WORDS];
+    uint32_t n = 0;
+    while (n < RANDOM_HW_WORDS && cpu_get_random(&hw[n], seed)) {
+        n++;
+    }
+    if (n > 0) {
+        random_add_entropy(hw, n * sizeof(hw[0]), n * bits_per_word);
+        random_wipe(hw, sizeof(hw));
+    }
+    return n;
+}
+
+void random_init(void)
+{
+    if (g_ready) {
+        return;
+    }
+    spinlock_init(&g_pool_lock);
+    spinlock_init(&g_crng.lock);
+    waitq_init(&g_seed_wq, "random-seed");
+    blake2s_init(&g_pool, NULL, 0);
+    /* Boot-time jitter and the wall clock: distinguish boots, credit nothing. */
+    uint64_t boot[3] = { cpu_get_time(), console_get_realtime_us(), console_get_uptime_us() };
+    blake2s_update(&g_pool, boot, sizeof(boot));
+    g_ready = true;
+    /* RDSEED is conditioned entropy and is credited; RDRAND is a DRBG and is not. */
+    uint32_t seeded_words = random_mix_cpu(true, 64u);
+    uint32_t drbg_words = random_mix_cpu(false, 0u);
+    /* First base key; output stays "insecure" until the pool is seeded. */
+    __atomic_store_n(&g_crng.reseed_pending, true, __ATOMIC_RELEASE);
+    kprintf("[RANDOM] rdseed=%u rdrand=%u seeded=%u\n",
+            seeded_words > 0 ? 1u : 0u, drbg_words > 0 ? 1u : 0u, g_seeded ? 1u : 0u);
+}
+
+void random_add_entropy(const void* buf, size_t len, uint32_t bits)
+{
+    if (!g_ready || !buf || len == 0) {
+        return;
+    }
+    if (bits > len * 8u) {
+        bits = (uint32_t)(len * 8u);
+    }
+    uint64_t flags = random_irq_save();
+    spinlock_lock(&g_pool_lock);
+    bool woke = random_mix_locked(buf, len, bits);
+    spinlock_unlock(&g_pool_lock);
+    random_irq_restore(flags);
+    if (woke) {
+        random_seeded_wake();
+    }
+}
+
+#define SIPROUND(v)                                                   \
+    do {                                                              \
+        v[0] += v[1]; v[1] = (v[1] << 13) | (v[1] >> 51); v[1] ^= v[0]; \
+        v[0] = (v[0] << 32) | (v[0] >> 32);                           \
+        v[2] += v[3]; v[3] = (v[3] << 16) | (v[3] >> 48); v[3] ^= v[2]; \
+        v[0] += v[3]; v[3] = (v[3] << 21) | (v[3] >> 43); v[3] ^= v[0]; \
+        v[2] += v[1]; v[1] = (v[1] << 17) | (v[1] >> 47); v[1] ^= v[2]; \
+        v[2] = (v[2] << 32) | (v[2] >> 32);                           \
+    } while (0)
+
+void random_add_interrupt(uint32_t vector, uint64_t ip)
+{
+    if (!g_ready) {
+        return;
+    }
+    uint32_t cpu = cpu_get_id();
+    if (cpu >= RANDOM_MAX_CPUS) {
+        return;
+    }
+    random_fast_pool_t* fp = &g_fast_pools[cpu];
+    uint64_t a = cpu_get_time() ^ ((uint64_t)vector << 48);
+    fp->s[3] ^= a;
+    SIPROUND(fp->s);
+    fp->s[0] ^= a;
+    fp->s[3] ^= ip;
+    SIPROUND(fp->s);
+    fp->s[0] ^= ip;
+    if (++fp->count < RANDOM_IRQ_FOLD) {
+        return;
+    }
+    uint64_t now = console_get_uptime_us();
+    if (g_seeded && now - fp->last_fold_us < RANDOM_IRQ_FOLD_US) {
+        return;
+    }
+    if (!spinlock_trylock(&g_pool_lock)) {
+        return;
+    }
+    bool woke = random_mix_locked(fp->s, sizeof(fp->s), 1u);
+    spinlock_unlock(&g_pool_lock);
+    fp->count = 0;
+    fp->last_fold_us = now;
+    if (woke) {
+        random_seeded_wake();
+    }
+}
+
+int random_register_source(const char* name, random_pull_fn pull, void* ctx)
+{
+    if (!pull) {
+        return RDNX_E_INVALID;
+    }
+    uint64_t flags = random_irq_save();
+    spinlock_lock(&g_pool_lock);
+    if (g_source_count >= RANDOM_SOURCE_MAX) {
+        spinlock_unlock(&g_pool_lock);
+        random_irq_restore(flags);
+        return RDNX_E_BUSY;
+    }
+    random_source_t* s = &g_sources[g_source_count];
+    s->name = name;
+    s->pull = pull;
+    s->ctx = ctx;
+    __atomic_store_n(&g_source_count, g_source_count + 1u, __ATOMIC_RELEASE);
+    spinlock_unlock(&g_pool_lock);
+    random_irq_restore(flags);
+    kprintf("[RANDOM] source %s registered\n", name ? name : "?");
+    /* Seed as soon as a source shows up. */
+    pull(ctx);
+    return RDNX_OK;
+}
+
+bool random_is_seeded(void)
+{
+    return g_seeded;
+}
+
+static void random_pull_sources(bool force)
+{
+    uint64_t now = console_get_uptime_us();
+    if (!force && g_seeded && now - g_last_pull_us < (uint64_t)RANDOM_RESEED_MS * 1000u) {
+        return;
+    }
+    g_last_pull_us = now;
+    uint32_t n = __atomic_load_n(&g_source_count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < n; i++) {
+        g_sources[i].pull(g_sources[i].ctx);
+    }
+}
+
+/*
+ * Time RANDOM_JITTER_SAMPLES hash compressions with the TSC. Each delta
+ * that differs from the previous one is a sample of execution jitter
+ * (caches, interrupts, SMIs, the hypervisor); credit one bit per eight of
+ * them, so a perfectly regular counter earns nothing.
+ */
+static void random_jitter_collect(void)
+{
+    uint64_t samples[RANDOM_JITTER_SAMPLES];
+    blake2s_state_t scratch;
+    blake2s_init(&scratch, NULL, 0);
+    uint64_t prev_delta = 0;
+    uint32_t changes = 0;
+    for (uint32_t i = 0; i < RANDOM_JITTER_SAMPLES; i++) {
+        uint64_t t0 = cpu_get_time();
+        memcpy(scratch.buf, &t0, sizeof(t0));
+        blake2s_compress(&scratch, scratch.buf, false);
+        uint64_t delta = cpu_get_time() - t0;
+        samples[i] = t0 ^ (delta << 40);
+        if (i > 0 && delta != prev_delta) {
+            changes++;
+        }
+        prev_delta = delta;
+    }
+    random_add_entropy(samples, sizeof(samples), changes / 8u);
+    random_wipe(&scratch, sizeof(scratch));
+}
+
+static int random_wait_seeded(void)
+{
+    thread_t* self = thread_get_current();
+    if (!self || !preemptible()) {
+        return RDNX_E_BUSY;
+    }
+    for (;;) {
+        random_pull_sources(true);
+        random_jitter_collect();
+        uint64_t flags = random_irq_save();
+        spinlock_lock(&g_pool_lock);
+        if (g_seeded) {
+            spinlock_unlock(&g_pool_lock);
+            random_irq_restore(flags);
+            return RDNX_OK;
+        }
+        (void)waitq_enqueue(&g_seed_wq, self);
+        spinlock_unlock(&g_pool_lock);
+        random_irq_restore(flags);
+        (void)waitq_wait(&g_seed_wq, RANDOM_WAIT_SLICE_MS);
+    }
+}
+
+/* Finalise the pool into seed and ratchet it forward. */
+static void random_extract_seed(uint8_t seed[32])
+{
+    static const uint8_t ratchet_tag = 0xFF;
+    blake2s_state_t tmp;
+    uint64_t tsc = cpu_get_time();
+    uint64_t flags = random_irq_save();
+    spinlock_lock(&g_pool_lock);
+    blake2s_update(&g_pool, &tsc, sizeof(tsc));
+    memcpy(&tmp, &g_pool, sizeof(tmp));
+    blake2s_final(&tmp, seed);
+    uint8_t next[32];
+    blake2s_init(&tmp, seed, 32u);
+    blake2s_update(&tmp, &ratchet_tag, 1u);
+    blake2s_final(&tmp, next);
+    blake2s_init(&g_pool, NULL, 0);
+    blake2s_update(&g_pool, next, sizeof(next));
+    spinlock_unlock(&g_pool_lock);
+    random_irq_restore(flags);
+    random_wipe(next, sizeof(next));
+    random_wipe(&tmp, sizeof(tmp));
+}
+
+/* ============================================================================
+ * CRNG
+ * ============================================================================ */
+
+static void crng_reseed(void)
+{
+    uint8_t key[CHACHA_KEY_SIZE];
+    (void)random_mix_cpu(false, 0u);
+    random_extract_seed(key);
+    uint64_t flags = random_irq_save();
+    spinlock_lock(&g_crng.lock);
+    memcpy(g_crng.key, key, sizeof(key));
+    g_crng.birth_us = console_get_uptime_us();
+    uint64_t next = g_crng.generation + 1u;
+    __atomic_store_n(&g_crng.generation, next ? next : 1u, __ATOMIC_RELEASE);
+    spinlock_unlock(&g_crng.lock);
+    random_irq_restore(flags);
+    random_wipe(key, sizeof(key));
+}
+
+static void crng_maybe_reseed(void)
+{
+    if (!g_ready) {
+        return;
+    }
+    if (__atomic_exchange_n(&g_crng.reseed_pending, false, __ATOMIC_ACQ_REL)) {
+        crng_reseed();
+        return;
+    }
+    uint64_t interval_ms = g_seeded ? RANDOM_CRNG_RESEED_MS : RANDOM_CRNG_EARLY_RESEED_MS;
+    uint64_t birth = __atomic_load_n(&g_crng.birth_us, __ATOMIC_RELAXED);
+    if (console_get_uptime_us() - birth >= interval_ms * 1000u) {
+        crng_reseed();
+    }
+}
+
+/*
+ * Key st for one request and take up to 32 bytes of data from its first
+ * block. Interrupts are disabled by the caller; the per-CPU key is
+ * refreshed from the base key when its generation is stale.
+ */
+static void crng_make_state_cpu(crng_cpu_t* c, uint32_t st[CHACHA_STATE_WORDS], uint8_t* data, size_t len)
+{
+    uint64_t gen = __atomic_load_n(&g_crng.generation, __ATOMIC_ACQUIRE);
+    if (c->generation != gen) {
+        spinlock_lock(&g_crng.lock);
+        crng_fast_key_erasure(g_crng.key, st, c->key, CHACHA_KEY_SIZE);
+        c->generation = g_crng.generation;
+        spinlock_unlock(&g_crng.lock);
+    }
+    crng_fast_key_erasure(c->key, st, data, len);
+}
+
+static void crng_make_state(uint32_t st[CHACHA_STATE_WORDS], uint8_t* data, size_t len)
+{
+    crng_maybe_reseed();
+    uint64_t flags = random_irq_save();
+    uint32_t cpu = cpu_get_id();
+    if (cpu < RANDOM_MAX_CPUS) {
+        crng_make_state_cpu(&g_crng_cpus[cpu], st, data, len);
+    } else {
+        /* No per-CPU slot: draw from the base key directly. */
+        spinlock_lock(&g_crng.lock);
+        crng_fast_key_erasure(g_crng.key, st, data, len);
+        spinlock_unlock(&g_crng.lock);
+    }
+    random_irq_restore(flags);
+}
+
+static void crng_fill(void* buf, size_t len)
+{
+    uint32_t st[CHACHA_STATE_WORDS];
+    uint8_t block[CHACHA_BLOCK_SIZE];
+    uint8_t* out = (uint8_t*)buf;
+    size_t first = len < CHACHA_KEY_SIZE ? len : CHACHA_KEY_SIZE;
+    /* The first block is drawn with interrupts off: only block is written there. */
+    crng_make_state(st, block, first);
+    memcpy(out, block, first);
+    size_t done = first;
+    while (done < len) {
+        size_t n = len - done;
+        if (n > CHACHA_BLOCK_SIZE) {
+            n = CHACHA_BLOCK_SIZE;
+        }
+        chacha20_block(st, block);
+        memcpy(out + done, block, n);
+        done += n;
+    }
+    random_wipe(st, sizeof(st));
+    random_wipe(block, sizeof(block));
+}
+
+int random_get_bytes(void* buf, size_t len, uint32_t flags)
+{
+    if ((flags & ~RANDOM_F_MASK) != 0 || (!buf && len > 0)) {
+        return RDNX_E_INVALID;
+    }
+    if ((flags & (RANDOM_F_INSECURE | RANDOM_F_RANDOM)) == (RANDOM_F_INSECURE | RANDOM_F_RANDOM)) {
+        return RDNX_E_INVALID;
+    }
+    if (!g_ready) {
+        return RDNX_E_BUSY;
+    }
+    if (len > RANDOM_GET_MAX) {
+        len = RANDOM_GET_MAX;
+    }
+    random_pull_sources(!g_seeded);
+    if (!g_seeded && !(flags & RANDOM_F_INSECURE)) {
+        if (flags & RANDOM_F_NONBLOCK) {
+            return RDNX_E_BUSY;
+        }
+        int rc = random_wait_seeded();
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+    }
+    if (len > 0) {
+        crng_fill(buf, len);
+    }
+    return (int)len;
+}
+
+/* Take n bytes from this CPU's batch, refilling it from the per-CPU key. */
+static void crng_batch_take(void* out, uint32_t n)
+{
+    crng_maybe_reseed();
+    uint64_t flags = random_irq_save();
+    uint32_t cpu = cpu_get_id();
+    if (cpu >= RANDOM_MAX_CPUS) {
+        random_irq_restore(flags);
+        crng_fill(out, n);
+        return;
+    }
+    crng_cpu_t* c = &g_crng_cpus[cpu];
+    uint64_t gen = __atomic_load_n(&g_crng.generation, __ATOMIC_ACQUIRE);
+    if (c->batch_generation != gen || c->batch_pos + n > sizeof(c->batch)) {
+        uint32_t st[CHACHA_STATE_WORDS];
+        crng_make_state_cpu(c, st, c->batch, CHACHA_KEY_SIZE);
+        chacha20_block(st, c->batch + CHACHA_KEY_SIZE);
+        random_wipe(st, sizeof(st));
+        c->batch_pos = 0;
+        c->batch_generation = gen;
+    }
+    memcpy(out, c->batch + c->batch_pos, n);
+    /* Handed-out bytes must not stay behind for a later state compromise. */
+    memset(c->batch + c->batch_pos, 0, n);
+    c->batch_pos += n;
+    random_irq_restore(flags);
+}
+
+uint32_t random_get_u32(void)
+{
+    uint32_t v;
+    crng_batch_take(&v, sizeof(v));
+    return v;
+}
+
+uint64_t random_get_u64(void)
+{
+    uint64_t v;
+    crng_batch_take(&v, sizeof(v));
+    return v;
+}
+
+uint32_t random_get_below(uint32_t bound)
+{
+    if (bound == 0) {
+        return 0;
+    }
+    /* Lemire: multiply-shift with rejection of the biased low range. */
+    uint64_t m = (uint64_t)random_get_u32() * bound;
+    if ((uint32_t)m < bound) {
+        uint32_t threshold = (uint32_t)(-bound) % bound;
+        while ((uint32_t)m < threshold) {
+            m = (uint64_t)random_get_u32() * bound;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
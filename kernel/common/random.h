@@ -0,0 +1,73 @@
+/**
+ * @file random.h
+ * @brief Kernel entropy pool, ChaCha20 CRNG and getrandom()
+ *
+ * Hardware sources (virtio-rng, RDSEED), interrupt timing and device data
+ * are hashed into a BLAKE2s input pool. Input credited with entropy counts
+ * towards the seed threshold; once RANDOM_SEED_BITS have been credited the
+ * pool stays seeded. The pool only keys the CRNG: a base ChaCha20 key that
+ * is re-derived from the pool on seeding and every RANDOM_CRNG_RESEED_MS,
+ * and per-CPU keys derived from it. Every output call overwrites the key
+ * it used (fast key erasure), so a later state compromise does not reveal
+ * earlier output.
+ */
+
+#ifndef _RODNIX_COMMON_RANDOM_H
+#define _RODNIX_COMMON_RANDOM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RANDOM_SEED_BITS     256u
+#define RANDOM_SOURCE_MAX    4u
+#define RANDOM_MAX_CPUS      8u
+#define RANDOM_GET_MAX       (1u << 20)      /* bytes per getrandom() call */
+#define RANDOM_RESEED_MS     300000u         /* ask sources again after this */
+#define RANDOM_CRNG_RESEED_MS 60000u         /* new base key from the pool */
+
+/* getrandom() flags; values match Linux GRND_*. */
+#define RANDOM_F_NONBLOCK    0x1u   /* fail with RDNX_E_BUSY instead of waiting for the seed */
+#define RANDOM_F_RANDOM      0x2u   /* accepted; there is a single pool */
+#define RANDOM_F_INSECURE    0x4u   /* return output even before the pool is seeded */
+#define RANDOM_F_MASK        (RANDOM_F_NONBLOCK | RANDOM_F_RANDOM | RANDOM_F_INSECURE)
+
+/*
+ * Asks a hardware source for more input. Called with no locks held, from
+ * thread context or early boot; the source answers later through
+ * random_add_entropy(), possibly from its interrupt handler.
+ */
+typedef void (*random_pull_fn)(void* ctx);
+
+/* Call after cpu_init(): seeds from RDSEED (credited) and RDRAND (not credited). */
+void random_init(void);
+/* Hash len bytes into the pool and credit bits of entropy (0 for device data). */
+void random_add_entropy(const void* buf, size_t len, uint32_t bits);
+/*
+ * Interrupt timing: called by the interrupt dispatcher with interrupts
+ * disabled. Mixes into a per-CPU fast pool and folds it into the input
+ * pool (one bit of credit) every 64 interrupts, at most once a second
+ * after seeding. Never spins on the pool lock.
+ */
+void random_add_interrupt(uint32_t vector, uint64_t ip);
+int random_register_source(const char* name, random_pull_fn pull, void* ctx);
+bool random_is_seeded(void);
+/*
+ * Fill buf with len bytes. buf is only written with interrupts enabled,
+ * but it must be a kernel buffer or a user range the caller has checked.
+ * Waits for the seed unless RANDOM_F_NONBLOCK or RANDOM_F_INSECURE is given. Returns len, RDNX_E_BUSY when unseeded and
+ * not allowed to wait, RDNX_E_INVALID on unknown flags.
+ */
+int random_get_bytes(void* buf, size_t len, uint32_t flags);
+
+/*
+ * Kernel-internal values from a per-CPU batch: no shared lock, callable
+ * from any context including interrupt handlers. Never blocks; before the
+ * pool is seeded the output is only as good as the boot inputs.
+ */
+uint32_t random_get_u32(void);
+uint64_t random_get_u64(void);
+/* Uniform value in [0, bound); 0 when bound is 0. */
+uint32_t random_get_below(uint32_t bound);
+
+#endif /* _RODNIX_COMMON_RANDOM_H */
@@ -0,0 +1,225 @@
+/**
+ * @file rcu.c
+ * @brief Read-copy-update: lock-free readers, deferred reclamation
+ *
+ * Each CPU keeps a read-side nesting depth and a quiescent-state counter.
+ * The counter advances on a timer tick that interrupts the CPU outside any
+ * read section and on every context switch -- both points where no reader
+ * can be running there, since readers run with preemption disabled and may
+ * not sleep. Interrupt entry and iretq serialize, so a reader's nesting
+ * store is visible before the tick that samples it, and readers need no
+ * fence.
+ *
+ * A grace period snapshots every other CPU's counter and waits for each to
+ * move. The calling CPU is quiescent by definition (synchronize_rcu() may
+ * not be called from a read section), so with a single CPU the grace period
+ * is immediate: any reader that could hold an old pointer has finished.
+ *
+ * call_rcu() appends to one queue; the "rcud" kernel thread detaches the
+ * whole queue as a batch, waits a grace period and invokes it.
+ */
+
+#include "rcu.h"
+#include "preempt.h"
+#include "waitq.h"
+#include "scheduler.h"
+#include "../core/cpu.h"
+#include "../fabric/spin.h"
+#include "../../include/console.h"
+#include "../../include/debug.h"
+#include "../../include/common.h"
+#include "../../include/error.h"
+#include <stddef.h>
+
+typedef struct rcu_cpu {
+    volatile uint32_t nesting;
+    volatile uint64_t qs_count;
+} __attribute__((aligned(64))) rcu_cpu_t;
+
+static rcu_cpu_t rcu_cpus[RCU_MAX_CPUS];
+
+/* Callback queue: rcu_cb_lock, taken with IRQL raised (call_rcu is ISR-safe). */
+static spinlock_t rcu_cb_lock;
+static rcu_head_t* rcu_cb_head = NULL;
+static rcu_head_t** rcu_cb_tail = &rcu_cb_head;
+static uint64_t rcu_cb_pending = 0;
+
+static waitq_t rcu_wq;
+static thread_t* rcu_thread = NULL;
+static rcu_stats_t rcu_stats;
+static bool rcu_warned_sleep = false;
+
+static inline rcu_cpu_t* rcu_this_cpu(void)
+{
+    uint32_t cpu = cpu_get_id();
+    return &rcu_cpus[cpu < RCU_MAX_CPUS ? cpu : 0];
+}
+
+static uint32_t rcu_cpu_count(void)
+{
+    uint32_t n = cpu_get_count();
+    if (n == 0) {
+        return 1;
+    }
+    return n > RCU_MAX_CPUS ? RCU_MAX_CPUS : n;
+}
+
+void rcu_read_lock(void)
+{
+    preempt_disable_at((uintptr_t)__builtin_return_address(0));
+    rcu_this_cpu()->nesting++;
+    __asm__ volatile ("" ::: "memory");
+}
+
+void rcu_read_unlock(void)
+{
+    __asm__ volatile ("" ::: "memory");
+    rcu_cpu_t* c = rcu_this_cpu();
+    PANIC_IF(c->nesting == 0, "rcu_read_unlock: not in a read-side section");
+    c->nesting--;
+    preempt_enable();
+}
+
+bool rcu_read_lock_held(void)
+{
+    return rcu_this_cpu()->nesting != 0;
+}
+
+void rcu_note_tick(void)
+{
+    rcu_cpu_t* c = rcu_this_cpu();
+    if (c->nesting == 0) {
+        c->qs_count++;
+    }
+}
+
+void rcu_note_context_switch(void)
+{
+    rcu_cpu_t* c = rcu_this_cpu();
+    if (c->nesting != 0) {
+        /* The outgoing thread slept inside a read section: its readers are unprotected. */
+        rcu_stats.sleep_in_reader++;
+        if (!rcu_warned_sleep) {
+            rcu_warned_sleep = true;
+            kputs("[RCU] context switch inside rcu_read_lock() section\n");
+        }
+        return;
+    }
+    c->qs_count++;
+}
+
+void synchronize_rcu(void)
+{
+    PANIC_IF(rcu_read_lock_held(), "synchronize_rcu: called inside a read-side section");
+    /* Order the caller's unlink before sampling the other CPUs. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint32_t self = cpu_get_id();
+    uint32_t ncpu = rcu_cpu_count();
+    uint64_t snap[RCU_MAX_CPUS];
+    for (uint32_t i = 0; i < ncpu; i++) {
+        snap[i] = rcu_cpus[i].qs_count;
+    }
+    for (uint32_t i = 0; i < ncpu; i++) {
+        if (i == self) {
+            continue;
+        }
+        while (rcu_cpus[i].qs_count == snap[i]) {
+            if (thread_get_current()) {
+                scheduler_sleep(SCHEDULER_TIME_SLICE_MS);
+            } else {
+                __asm__ volatile ("pause");
+            }
+        }
+    }
+    rcu_stats.grace_periods++;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void call_rcu(rcu_head_t* head, rcu_callback_t func)
+{
+    if (!head || !func) {
+        return;
+    }
+    head->next = NULL;
+    head->func = func;
+    irql_t irql = spinlock_lock_irqsave(&rcu_cb_lock);
+    bool was_empty = (rcu_cb_head == NULL);
+    *rcu_cb_tail = head;
+    rcu_cb_tail = &head->next;
+    rcu_cb_pending++;
+    rcu_stats.callbacks_queued++;
+    if (was_empty && rcu_thread) {
+        (void)waitq_wake_one(&rcu_wq);
+    }
+    spinlock_unlock_irqrestore(&rcu_cb_lock, irql);
+}
+
+static uint32_t rcu_process_batch(void)
+{
+    irql_t irql = spinlock_lock_irqsave(&rcu_cb_lock);
+    rcu_head_t* list = rcu_cb_head;
+    rcu_cb_head = NULL;
+    rcu_cb_tail = &rcu_cb_head;
+    rcu_cb_pending = 0;
+    spinlock_unlock_irqrestore(&rcu_cb_lock, irql);
+    if (!list) {
+        return 0;
+    }
+
+    synchronize_rcu();
+    uint32_t n = 0;
+    while (list) {
+        rcu_head_t* next = list->next;
+        list->func(list);
+        list = next;
+        if (++n % RCU_BATCH_MAX == 0) {
+            scheduler_yield();
+        }
+    }
+    rcu_stats.callbacks_invoked += n;
+    rcu_stats.batches++;
+    return n;
+}
+
+static void rcu_thread_main(void* arg)
+{
+    (void)arg;
+    for (;;) {
+        (void)waitq_wait(&rcu_wq, RCU_IDLE_MS);
+        while (rcu_process_batch() != 0) {
+        }
+    }
+}
+
+void rcu_start(void)
+{
+    if (rcu_thread) {
+        return;
+    }
+    task_t* kernel_task = task_get_current();
+    if (!kernel_task) {
+        return;
+    }
+    spinlock_init(&rcu_cb_lock);
+    waitq_init(&rcu_wq, "rcud");
+    thread_t* t = thread_create(kernel_task, rcu_thread_main, NULL);
+    if (!t) {
+        return;
+    }
+    scheduler_set_bucket(t, SCHED_BUCKET_UTILITY);
+    rcu_thread = t;
+    scheduler_add_thread(t);
+}
+
+int rcu_get_stats(rcu_stats_t* out)
+{
+    if (!out) {
+        return RDNX_E_INVALID;
+    }
+    irql_t irql = spinlock_lock_irqsave(&rcu_cb_lock);
+    *out = rcu_stats;
+    out->callbacks_pending = rcu_cb_pending;
+    spinlock_unlock_irqrestore(&rcu_cb_lock, irql);
+    return RDNX_OK;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file rcu.h
+ * @brief Read-copy-update: lock-free readers, deferred reclamation
+ *
+ * Quiescent-state based RCU for read-mostly structures. Readers bracket a
+ * lookup with rcu_read_lock()/rcu_read_unlock(), load shared pointers with
+ * rcu_dereference() and take no lock. Writers serialize among themselves
+ * with an ordinary lock, publish with rcu_assign_pointer(), unlink, and free
+ * the old object only after a grace period -- synchronously with
+ * synchronize_rcu() or asynchronously with call_rcu().
+ *
+ * A read-side section must not block or sleep; rcu_read_lock() disables
+ * preemption (preempt.h), so the scheduler does not switch away from it. A CPU passes through a quiescent state on
+ * every timer tick that finds it outside a read section and on every
+ * context switch. Sections nest, and may be entered from interrupt context.
+ */
+
+#ifndef _RODNIX_COMMON_RCU_H
+#define _RODNIX_COMMON_RCU_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RCU_MAX_CPUS 8
+#define RCU_IDLE_MS 100         /* callback thread poll period with nothing queued */
+#define RCU_BATCH_MAX 1024u     /* callbacks invoked per grace period before yielding */
+
+struct rcu_head;
+typedef void (*rcu_callback_t)(struct rcu_head* head);
+
+/* Embed in the object; recover it in the callback with rcu_entry(). */
+typedef struct rcu_head {
+    struct rcu_head* next;
+    rcu_callback_t func;
+} rcu_head_t;
+
+#define rcu_entry(head, type, member) ((type*)(void*)((char*)(head) - offsetof(type, member)))
+
+typedef struct rcu_stats {
+    uint64_t grace_periods;
+    uint64_t callbacks_queued;
+    uint64_t callbacks_invoked;
+    uint64_t callbacks_pending;
+    uint64_t batches;
+    uint64_t sleep_in_reader;   /* voluntary switches inside a read section (bugs) */
+} rcu_stats_t;
+
+/* Publish/consume a pointer that readers traverse without a lock. */
+#define rcu_dereference(p) __atomic_load_n(&(p), __ATOMIC_CONSUME)
+#define rcu_assign_pointer(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+void rcu_read_lock(void);
+void rcu_read_unlock(void);
+bool rcu_read_lock_held(void);
+
+/* Wait until every reader that might see a just-unlinked object is done. Thread context. */
+void synchronize_rcu(void);
+/* Run func(head) after a grace period, on the RCU thread. Any context. */
+void call_rcu(rcu_head_t* head, rcu_callback_t func);
+
+void rcu_start(void);
+int rcu_get_stats(rcu_stats_t* out);
+
+/* Scheduler and timer hooks. */
+void rcu_note_tick(void);
+void rcu_note_context_switch(void);
+
+#endif /* _RODNIX_COMMON_RCU_H */
@@ -0,0 +1,78 @@
+/**
+ * @file rculist.h
+ * @brief RCU variants of the <sys/queue.h> LIST macros and hash helpers
+ *
+ * Writers hold the structure's own lock and use the _RCU insert/remove
+ * macros; readers walk with LIST_FOREACH_RCU inside rcu_read_lock(). A
+ * removed element keeps its le_next, so a reader standing on it still
+ * reaches the rest of the list; it may be freed or reinserted only after a
+ * grace period (call_rcu/synchronize_rcu). le_prev is writer-only.
+ *
+ * An RCU hash table is an array of LIST_HEADs indexed by one of the hashes
+ * below masked to a power-of-two bucket count.
+ */
+
+#ifndef _RODNIX_COMMON_RCULIST_H
+#define _RODNIX_COMMON_RCULIST_H
+
+#include "rcu.h"
+#include "../../include/bsd/sys/queue.h"
+#include <stdint.h>
+
+#define LIST_FIRST_RCU(head) rcu_dereference(LIST_FIRST((head)))
+#define LIST_NEXT_RCU(elm, field) rcu_dereference(LIST_NEXT((elm), field))
+
+#define LIST_FOREACH_RCU(var, head, field)				\
+	for ((var) = LIST_FIRST_RCU((head));				\
+	    (var);							\
+	    (var) = LIST_NEXT_RCU((var), field))
+
+/* elm is fully initialized before the release store makes it reachable. */
+#define LIST_INSERT_HEAD_RCU(head, elm, field) do {			\
+	LIST_NEXT((elm), field) = LIST_FIRST((head));			\
+	(elm)->field.le_prev = &LIST_FIRST((head));			\
+	if (LIST_FIRST((head)) != NULL)					\
+		LIST_FIRST((head))->field.le_prev =			\
+		    &LIST_NEXT((elm), field);				\
+	rcu_assign_pointer(LIST_FIRST((head)), (elm));			\
+} while (0)
+
+#define LIST_INSERT_AFTER_RCU(listelm, elm, field) do {		\
+	LIST_NEXT((elm), field) = LIST_NEXT((listelm), field);		\
+	(elm)->field.le_prev = &LIST_NEXT((listelm), field);		\
+	if (LIST_NEXT((listelm), field) != NULL)			\
+		LIST_NEXT((listelm), field)->field.le_prev =		\
+		    &LIST_NEXT((elm), field);				\
+	rcu_assign_pointer(LIST_NEXT((listelm), field), (elm));	\
+} while (0)
+
+/* Unlink without poisoning le_next: readers may still be standing on elm. */
+#define LIST_REMOVE_RCU(elm, field) do {				\
+	if (LIST_NEXT((elm), field) != NULL)				\
+		LIST_NEXT((elm), field)->field.le_prev =		\
+		    (elm)->field.le_prev;				\
+	rcu_assign_pointer(*(elm)->field.le_prev,			\
+	    LIST_NEXT((elm), field));					\
+	(elm)->field.le_prev = NULL;					\
+} while (0)
+
+/* FNV-1a; callers mask the result with (buckets - 1). */
+static inline uint32_t rcu_hash_str(const char* s)
+{
+    uint32_t h = 2166136261u;
+    while (s && *s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static inline uint32_t rcu_hash_u64(uint64_t v)
+{
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    return (uint32_t)v;
+}
+
+#endif /* _RODNIX_COMMON_RCULIST_H */
@@ -0,0 +1,365 @@
+/**
+ * @file rusage.c
+ * @brief Per-thread/per-task resource accounting and resource limits
+ *
+ * Counters live in thread_t::ru and are written only on behalf of the
+ * running thread (syscall entry/exit, faults, I/O, the scheduler at switch);
+ * readers sum them under rusage_spin (irqsave), which keeps exiting threads
+ * from folding into the totals mid-snapshot on any CPU. CPU time is kept in raw TSC cycles; conversion to nanoseconds
+ * happens on query, using cpu_get_frequency() or, when the CPU does not
+ * report it (QEMU without CPUID 0x15/0x16), a rate calibrated lazily against
+ * the uptime clock.
+ */
+
+#include "rusage.h"
+#include "../core/cpu.h"
+#include "../core/interrupts.h"
+#include "../fabric/spin.h"
+#include "../../include/console.h"
+#include "../../include/error.h"
+#include <stddef.h>
+
+#define RUSAGE_SIGXCPU 24u
+#define RUSAGE_SIGKILL 9u
+#define RUSAGE_CALIB_MIN_US 100000ULL   /* freeze the calibrated rate after 100 ms */
+#define RUSAGE_FALLBACK_HZ 1000000000ULL
+
+static uint64_t rusage_tsc_hz = 0;
+static uint64_t rusage_calib_tsc = 0;
+static uint64_t rusage_calib_us = 0;
+static int rusage_calib_started = 0;
+
+/*
+ * Guards folding thread counters into task totals (exit, getrusage, reap),
+ * which read other threads' counters from any CPU.
+ */
+static spinlock_t rusage_spin;
+
+static inline irql_t rusage_lock(void)
+{
+    return spinlock_lock_irqsave(&rusage_spin);
+}
+
+static inline void rusage_unlock(irql_t old)
+{
+    spinlock_unlock_irqrestore(&rusage_spin, old);
+}
+
+/* a * b / c; exact as long as b * c fits in 64 bits. */
+static uint64_t rusage_muldiv(uint64_t a, uint64_t b, uint64_t c)
+{
+    if (c == 0) {
+        return 0;
+    }
+    return (a / c) * b + ((a % c) * b) / c;
+}
+
+static void rusage_calib_start(void)
+{
+    if (rusage_calib_started) {
+        return;
+    }
+    rusage_calib_started = 1;
+    rusage_tsc_hz = cpu_get_frequency();
+    rusage_calib_tsc = cpu_get_time();
+    rusage_calib_us = console_get_uptime_us();
+}
+
+static uint64_t rusage_hz(void)
+{
+    if (rusage_tsc_hz) {
+        return rusage_tsc_hz;
+    }
+    rusage_calib_start();
+    uint64_t dus = console_get_uptime_us() - rusage_calib_us;
+    uint64_t dtsc = cpu_get_time() - rusage_calib_tsc;
+    if (dus == 0 || dtsc == 0) {
+        return RUSAGE_FALLBACK_HZ;
+    }
+    uint64_t hz = rusage_muldiv(dtsc, 1000000ULL, dus);
+    if (dus >= RUSAGE_CALIB_MIN_US) {
+        rusage_tsc_hz = hz;
+    }
+    return hz ? hz : RUSAGE_FALLBACK_HZ;
+}
+
+uint64_t rusage_cycles_to_ns(uint64_t cycles)
+{
+    return rusage_muldiv(cycles, 1000000000ULL, rusage_hz());
+}
+
+static void rusage_add(task_rusage_t* dst, const task_rusage_t* src)
+{
+    dst->utime_cycles += src->utime_cycles;
+    dst->stime_cycles += src->stime_cycles;
+    dst->minflt += src->minflt;
+    dst->majflt += src->majflt;
+    dst->nvcsw += src->nvcsw;
+    dst->nivcsw += src->nivcsw;
+    dst->read_bytes += src->read_bytes;
+    dst->write_bytes += src->write_bytes;
+    if (src->maxrss_pages > dst->maxrss_pages) {
+        dst->maxrss_pages = src->maxrss_pages;
+    }
+}
+
+static void rusage_zero(task_rusage_t* ru)
+{
+    ru->utime_cycles = 0;
+    ru->stime_cycles = 0;
+    ru->minflt = 0;
+    ru->majflt = 0;
+    ru->nvcsw = 0;
+    ru->nivcsw = 0;
+    ru->read_bytes = 0;
+    ru->write_bytes = 0;
+    ru->maxrss_pages = 0;
+}
+
+void rusage_task_init(task_t* task)
+{
+    if (!task) {
+        return;
+    }
+    rusage_calib_start();
+    rusage_zero(&task->ru_exited);
+    rusage_zero(&task->ru_children);
+    for (int i = 0; i < TASK_RLIMIT_COUNT; i++) {
+        task->rlimits[i].cur = TASK_RLIM_INFINITY;
+        task->rlimits[i].max = TASK_RLIM_INFINITY;
+    }
+    task->rlimits[TASK_RLIMIT_NOFILE].cur = TASK_MAX_FD;
+    task->rlimits[TASK_RLIMIT_NOFILE].max = TASK_MAX_FD;
+    task->rlim_cpu_next = 0;
+    task->maxrss_pages = 0;
+}
+
+void rusage_task_inherit(task_t* child, const task_t* parent)
+{
+    if (!child || !parent) {
+        return;
+    }
+    for (int i = 0; i < TASK_RLIMIT_COUNT; i++) {
+        child->rlimits[i] = parent->rlimits[i];
+    }
+    for (size_t i = 0; i < TASK_COMM_MAX; i++) {
+        child->comm[i] = parent->comm[i];
+    }
+}
+
+void rusage_thread_init(thread_t* thread)
+{
+    if (!thread) {
+        return;
+    }
+    rusage_zero(&thread->ru);
+    thread->ru_stamp = cpu_get_time();
+}
+
+void rusage_thread_exit(thread_t* thread)
+{
+    if (!thread || !thread->task) {
+        return;
+    }
+    irql_t old = rusage_lock();
+    rusage_add(&thread->task->ru_exited, &thread->ru);
+    rusage_zero(&thread->ru);
+    rusage_unlock(old);
+}
+
+static void rusage_charge(thread_t* thread, int to_user)
+{
+    uint64_t now = cpu_get_time();
+    uint64_t delta = now - thread->ru_stamp;
+    thread->ru_stamp = now;
+    if (to_user) {
+        thread->ru.utime_cycles += delta;
+    } else {
+        thread->ru.stime_cycles += delta;
+    }
+}
+
+void rusage_kernel_enter(thread_t* thread)
+{
+    if (!thread) {
+        return;
+    }
+    /* Only this CPU charges a running thread: keep its tick out, no global lock per syscall. */
+    irql_t old = set_irql(IRQL_HIGH);
+    rusage_charge(thread, 1);
+    (void)set_irql(old);
+}
+
+void rusage_kernel_exit(thread_t* thread)
+{
+    if (!thread) {
+        return;
+    }
+    irql_t old = set_irql(IRQL_HIGH);
+    rusage_charge(thread, 0);
+    (void)set_irql(old);
+}
+
+/*
+ * RLIMIT_CPU: the signal is only posted here; like every other signal it is
+ * delivered at the task's next syscall checkpoint.
+ */
+static void rusage_check_cpu_limit(task_t* task)
+{
+    uint64_t soft = task->rlimits[TASK_RLIMIT_CPU].cur;
+    uint64_t hard = task->rlimits[TASK_RLIMIT_CPU].max;
+    if (soft == TASK_RLIM_INFINITY && hard == TASK_RLIM_INFINITY) {
+        return;
+    }
+    task_rusage_t ru;
+    rusage_task_sum(task, &ru);
+    uint64_t secs = rusage_cycles_to_ns(ru.utime_cycles + ru.stime_cycles) / 1000000000ULL;
+    if (hard != TASK_RLIM_INFINITY && secs >= hard) {
+        task->sig_pending = RUSAGE_SIGKILL;
+        return;
+    }
+    if (soft != TASK_RLIM_INFINITY && secs >= soft) {
+        uint64_t next = task->rlim_cpu_next ? task->rlim_cpu_next : soft;
+        if (secs >= next) {
+            task->sig_pending = RUSAGE_SIGXCPU;
+            task->rlim_cpu_next = secs + 1;
+        }
+    }
+}
+
+void rusage_switch(thread_t* prev, thread_t* next, int from_user, int voluntary)
+{
+    if (prev) {
+        rusage_charge(prev, from_user);
+        if (voluntary) {
+            prev->ru.nvcsw++;
+        } else {
+            prev->ru.nivcsw++;
+        }
+        if (prev->task && !voluntary) {
+            rusage_check_cpu_limit(prev->task);
+        }
+    }
+    if (next) {
+        next->ru_stamp = cpu_get_time();
+    }
+}
+
+void rusage_fault(task_t* task, int major)
+{
+    thread_t* cur = thread_get_current();
+    task_rusage_t* ru = NULL;
+    if (cur && cur->task == task) {
+        ru = &cur->ru;
+    } else if (task) {
+        ru = &task->ru_exited;
+    }
+    if (!ru) {
+        return;
+    }
+    if (major) {
+        ru->majflt++;
+    } else {
+        ru->minflt++;
+    }
+}
+
+void rusage_io(int write, uint64_t bytes)
+{
+    thread_t* cur = thread_get_current();
+    if (!cur) {
+        return;
+    }
+    if (write) {
+        cur->ru.write_bytes += bytes;
+    } else {
+        cur->ru.read_bytes += bytes;
+    }
+}
+
+void rusage_rss_update(task_t* task, uint64_t resident_pages)
+{
+    if (task && resident_pages > task->maxrss_pages) {
+        task->maxrss_pages = resident_pages;
+    }
+}
+
+void rusage_task_sum(const task_t* task, task_rusage_t* out)
+{
+    if (!out) {
+        return;
+    }
+    rusage_zero(out);
+    if (!task) {
+        return;
+    }
+    irql_t old = rusage_lock();
+    *out = task->ru_exited;
+    const thread_t* t;
+    TAILQ_FOREACH(t, &task->threads, task_link) {
+        rusage_add(out, &t->ru);
+    }
+    if (task->maxrss_pages > out->maxrss_pages) {
+        out->maxrss_pages = task->maxrss_pages;
+    }
+    rusage_unlock(old);
+}
+
+void rusage_reap_child(task_t* parent, const task_t* child)
+{
+    if (!parent || !child) {
+        return;
+    }
+    task_rusage_t ru;
+    rusage_task_sum(child, &ru);
+    irql_t old = rusage_lock();
+    rusage_add(&parent->ru_children, &ru);
+    rusage_add(&parent->ru_children, &child->ru_children);
+    rusage_unlock(old);
+}
+
+uint64_t rusage_rlimit_cur(const task_t* task, int resource)
+{
+    if (!task || resource < 0 || resource >= TASK_RLIMIT_COUNT) {
+        return TASK_RLIM_INFINITY;
+    }
+    return task->rlimits[resource].cur;
+}
+
+int rusage_getrlimit(const task_t* task, int resource, task_rlimit_t* out)
+{
+    if (!task || !out || resource < 0 || resource >= TASK_RLIMIT_COUNT) {
+        return RDNX_E_INVALID;
+    }
+    *out = task->rlimits[resource];
+    return RDNX_OK;
+}
+
+int rusage_setrlimit(task_t* task, int resource, const task_rlimit_t* lim)
+{
+    if (!task || !lim || resource < 0 || resource >= TASK_RLIMIT_COUNT) {
+        return RDNX_E_INVALID;
+    }
+    task_rlimit_t want = *lim;
+    if (want.cur > TASK_RLIM_INFINITY) {
+        want.cur = TASK_RLIM_INFINITY;
+    }
+    if (want.max > TASK_RLIM_INFINITY) {
+        want.max = TASK_RLIM_INFINITY;
+    }
+    if (want.cur > want.max) {
+        return RDNX_E_INVALID;
+    }
+    if (want.max > task->rlimits[resource].max && task->euid != 0) {
+        return RDNX_E_DENIED;
+    }
+    if (resource == TASK_RLIMIT_NOFILE && want.max > TASK_MAX_FD &&
+        want.max != TASK_RLIM_INFINITY) {
+        return RDNX_E_INVALID;
+    }
+    task->rlimits[resource] = want;
+    if (resource == TASK_RLIMIT_CPU) {
+        task->rlim_cpu_next = 0;
+    }
+    return RDNX_OK;
+}
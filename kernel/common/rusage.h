@@ -0,0 +1,49 @@
+/**
+ * @file rusage.h
+ * @brief Per-thread/per-task resource accounting and resource limits
+ */
+
+#ifndef _RODNIX_COMMON_RUSAGE_H
+#define _RODNIX_COMMON_RUSAGE_H
+
+#include "../core/task.h"
+#include <stdint.h>
+
+enum {
+    RUSAGE_WHO_SELF = 0,
+    RUSAGE_WHO_CHILDREN = -1,
+    RUSAGE_WHO_THREAD = 1
+};
+
+void rusage_task_init(task_t* task);
+void rusage_task_inherit(task_t* child, const task_t* parent);
+void rusage_thread_init(thread_t* thread);
+/* Fold a dying thread's counters into its task (thread_destroy, reaper). */
+void rusage_thread_exit(thread_t* thread);
+
+/*
+ * CPU time: the interval since thread->ru_stamp is charged to user time on
+ * kernel entry from user mode and to system time on return to user mode.
+ */
+void rusage_kernel_enter(thread_t* thread);
+void rusage_kernel_exit(thread_t* thread);
+/* Context switch: charge prev (user or system by from_user), stamp next. */
+void rusage_switch(thread_t* prev, thread_t* next, int from_user, int voluntary);
+
+void rusage_fault(task_t* task, int major);
+void rusage_io(int write, uint64_t bytes);
+void rusage_rss_update(task_t* task, uint64_t resident_pages);
+
+/* Self usage: ru_exited + live threads; maxrss from task->maxrss_pages. */
+void rusage_task_sum(const task_t* task, task_rusage_t* out);
+/* Called by waitpid: add child self + children usage to parent->ru_children. */
+void rusage_reap_child(task_t* parent, const task_t* child);
+
+uint64_t rusage_cycles_to_ns(uint64_t cycles);
+
+uint64_t rusage_rlimit_cur(const task_t* task, int resource);
+int rusage_getrlimit(const task_t* task, int resource, task_rlimit_t* out);
+int rusage_setrlimit(task_t* task, int resource, const task_rlimit_t* lim);
+
+
+#endif /* _RODNIX_COMMON_RUSAGE_H */
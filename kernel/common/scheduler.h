@@ -37,6 +37,15 @@ typedef enum {
     SCHED_POLICY_CFS,         /* Completely Fair Scheduler */
 } sched_policy_t;
 
+/* Per-thread scheduling parameters (sched_setattr / sched_getattr). */
+typedef struct sched_params {
+    uint32_t policy;           /* SCHED_OTHER / SCHED_FIFO / SCHED_RR / SCHED_DEADLINE */
+    uint32_t priority;         /* 1..99 for FIFO/RR, 0 otherwise */
+    uint64_t runtime_ns;       /* SCHED_DEADLINE only */
+    uint64_t deadline_ns;
+    uint64_t period_ns;        /* 0 = same as deadline */
+} sched_params_t;
+
 /* ============================================================================
  * Scheduler statistics
  * ============================================================================ */
@@ -64,6 +73,14 @@ typedef struct {
     uint32_t timed_waiters;
 } scheduler_waitq_stats_t;
 
+typedef struct {
+    uint64_t rt_throttled;     /* FIFO/RR/DEADLINE hit the SCHED_RT_RUNTIME_PCT window */
+    uint64_t dl_throttled;     /* DEADLINE threads out of budget until the next period */
+    uint64_t dl_misses;        /* DEADLINE jobs still running past their deadline */
+    uint64_t pi_boosts;        /* priority raised through a PI futex */
+    uint32_t dl_bw_ppm;        /* admitted DEADLINE bandwidth, parts per million */
+} scheduler_rt_stats_t;
+
 /* ============================================================================
  * Initialization
  * ============================================================================ */
@@ -180,6 +197,36 @@ void scheduler_set_priority(thread_t* thread, uint8_t priority);
  */
 int scheduler_set_policy(sched_policy_t policy);
 
+/**
+ * Set a thread's policy and priority / deadline parameters. FIFO and RR
+ * run above every QoS bucket, DEADLINE above FIFO/RR (earliest deadline
+ * first); DEADLINE is admitted only while the total runtime/period stays
+ * within SCHED_DL_BW_PCT.
+ * @return RDNX_OK, RDNX_E_INVALID for bad parameters, RDNX_E_BUSY when
+ *         DEADLINE admission fails
+ */
+int scheduler_setattr(thread_t* thread, const sched_params_t* params);
+
+/**
+ * Read a thread's policy and parameters.
+ */
+int scheduler_getattr(const thread_t* thread, sched_params_t* params);
+
+/**
+ * Real-time level a thread donates through priority inheritance:
+ * 0 for SCHED_OTHER, 1..99 for FIFO/RR (including its own inherited
+ * level), 100 for DEADLINE.
+ */
+int scheduler_pi_level(const thread_t* thread);
+
+/**
+ * Set the level a thread inherits from PI futex waiters (0 = none) and
+ * move it to the matching ready queue.
+ */
+void scheduler_pi_set(thread_t* thread, int level);
+
+int scheduler_get_rt_stats(scheduler_rt_stats_t* stats);
+
 /**
  * Assign a QoS bucket to a thread.
  * Must be called before scheduler_add_thread() to take effect;
@@ -207,10 +254,17 @@ void scheduler_set_tick_rate(uint32_t hz);
 
 /**
  * Check pending reschedule at safe points (AST-like)
- * Should be called from non-IRQ context
+ * Should be called from non-IRQ context; switches right away through
+ * PREEMPT_RESCHED_VECTOR when the current thread is preemptible.
  */
 void scheduler_ast_check(void);
 
+/**
+ * A reschedule is pending (wakeup, expired quantum) and the scheduler is
+ * not already running.
+ */
+bool scheduler_need_resched(void);
+
 /**
  * Switch from IRQ context if a reschedule is pending.
  * @param frame Pointer to interrupt frame
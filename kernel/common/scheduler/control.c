@@ -28,6 +28,8 @@ static void scheduler_yield_internal(bool irq_context)
     if (!scheduler_running) {
         return;
     }
+    /* RT: в хвост своего уровня; DEADLINE: до следующего периода */
+    sched_rt_yield(thread_get_current());
     /* Request preemption on next timer interrupt */
     resched_pending = true;
 }
@@ -98,6 +100,7 @@ void scheduler_unblock(thread_t* thread)
         if (stats.blocked_tasks > 0) {
             stats.blocked_tasks--;
         }
+        sched_rt_wake(thread);
         ready_enqueue(thread);
     } else {
         DEBUG_WARN("unblock: thread %llu state=%d", (unsigned long long)thread->thread_id, thread->state);
@@ -126,6 +129,7 @@ void scheduler_wake(thread_t* thread)
             stats.blocked_tasks--;
         }
         scheduler_thread_set_state(thread, THREAD_STATE_READY, "scheduler_wake_blocked");
+        sched_rt_wake(thread);
         ready_enqueue(thread);
         resched_pending = true;
         return;
@@ -150,6 +154,7 @@ void scheduler_exit_current(void)
     }
 
     scheduler_exit_wake_joiner(cur);
+    sched_rt_exit(cur);
     scheduler_thread_set_state(cur, THREAD_STATE_DEAD, "scheduler_exit_current");
     tracev2_emit(TR2_CAT_SCHED, TR2_EV_SCHED_EXIT,
                  cur->thread_id,
@@ -41,5 +41,6 @@ void scheduler_debug_dump(void)
         }
         kprintf("[SCHED] q%d count=%u\n", q, count);
     }
+    sched_rt_debug_dump();
     kputs("[SCHED] --------------\n");
 }
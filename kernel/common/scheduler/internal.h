@@ -16,7 +16,21 @@
 #define PENALTY_MAX 32
 #define PENALTY_STEP_TICKS 4
 
-#define REALTIME_QUANTUM_TICKS 1
+/* Real-time классы (rt.c). */
+#define SCHED_RT_LEVELS      (SCHED_RT_PRIO_MAX + 2) /* 1..99 FIFO/RR, 100 — наследие от DEADLINE */
+#define SCHED_RT_PI_DEADLINE (SCHED_RT_PRIO_MAX + 1)
+#define SCHED_RR_QUANTUM_MS  100
+#define SCHED_RT_RUNTIME_PCT 95   /* доля CPU для FIFO/RR/DEADLINE в окне 1 с */
+#define SCHED_DL_BW_PCT      95   /* предел суммы runtime/period при допуске DEADLINE */
+#define SCHED_DL_BW_SHIFT    20
+
+/* thread_rt_t.rq_kind */
+enum {
+    SCHED_RQ_NONE   = 0,
+    SCHED_RQ_BUCKET = 1,
+    SCHED_RQ_RT     = 2,
+    SCHED_RQ_DL     = 3,
+};
 
 /* Per-bucket quantum: множитель на ticks_per_slice.
  * INTERACTIVE — короче (отзывчивость), BACKGROUND — длиннее (меньше переключений). */
@@ -38,6 +52,7 @@ extern uint32_t ticks_until_preempt;
 extern uint32_t ticks_per_slice;
 extern volatile bool resched_pending;
 extern uint64_t sched_ticks;
+extern uint32_t sched_tick_hz;
 
 TAILQ_HEAD(ready_queue_head, thread);
 extern struct ready_queue_head ready_queues[READY_QUEUE_LEVELS];
@@ -50,6 +65,8 @@ void scheduler_thread_set_state(thread_t* thread, thread_state_t new_state, cons
 void scheduler_task_set_state(task_t* task, task_state_t new_state, const char* reason);
 
 void ready_enqueue(thread_t* thread);
+void ready_enqueue_preempted(thread_t* thread);
+void ready_remove(thread_t* thread);
 thread_t* ready_dequeue(void);
 int ready_queue_index_for_thread(const thread_t* thread);
 bool ready_thread_is_queued(const thread_t* thread);
@@ -59,6 +76,19 @@ int thread_effective_priority(const thread_t* thread);
 void scheduler_reset_timeslice(const thread_t* thread);
 void scheduler_update_tss(thread_t* thread);
 
+void sched_rt_init(void);
+bool sched_rt_thread(const thread_t* thread);
+int sched_rt_level(const thread_t* thread);
+void sched_rt_enqueue(thread_t* thread, bool head);
+void sched_rt_remove(thread_t* thread);
+thread_t* sched_rt_dequeue(void);
+bool sched_rt_tick(thread_t* cur);
+void sched_rt_wake(thread_t* thread);
+void sched_rt_yield(thread_t* cur);
+void sched_rt_switch(thread_t* prev, thread_t* next);
+void sched_rt_exit(thread_t* thread);
+void sched_rt_debug_dump(void);
+
 uint32_t scheduler_reap_queue_len(void);
 void scheduler_reap_enqueue(thread_t* dead_thread);
 void scheduler_reap_dead_threads(void);
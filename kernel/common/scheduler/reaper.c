@@ -1,6 +1,7 @@
 #include "internal.h"
 #include "../heap.h"
 #include "../tracev2.h"
+#include "../rusage.h"
 #include "../../unix/unix_layer.h"
 #include "../../core/interrupts.h"
 #include "../../../include/error.h"
@@ -118,6 +119,7 @@ void scheduler_reap_dead_threads(void)
         dead->reap_queued = 0;
         task_t* owner = dead->task;
         if (owner) {
+            rusage_thread_exit(dead);
             TAILQ_REMOVE(&owner->threads, dead, task_link);
         }
         if (owner && owner->thread_count > 0) {
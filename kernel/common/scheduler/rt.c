@@ -0,0 +1,500 @@
+#include "internal.h"
+#include "../rusage.h"
+#include "../../core/cpu.h"
+#include "../../core/interrupts.h"
+#include "../../fabric/spin.h"
+#include "../../../include/console.h"
+#include "../../../include/error.h"
+
+/*
+ * Real-time классы над QoS-бакетами.
+ *
+ * SCHED_DEADLINE — EDF: очередь отсортирована по абсолютному дедлайну,
+ * бюджет списывается по TSC при переключении и на тике; исчерпавший бюджет
+ * поток остаётся в очереди с dl_throttled до начала следующего периода.
+ * Допуск: сумма runtime/period всех DEADLINE-потоков <= SCHED_DL_BW_PCT.
+ *
+ * SCHED_FIFO / SCHED_RR — очередь на каждый уровень 1..99 и битовая карта
+ * непустых уровней. Вытесненный поток возвращается в голову своей очереди,
+ * в хвост — только после sched_yield или конца кванта RR. Уровень потока —
+ * максимум из своего и унаследованного через PI futex (pi_prio).
+ *
+ * Чтобы зациклившийся RT-поток не забрал систему целиком, RT и DEADLINE
+ * вместе получают не более SCHED_RT_RUNTIME_PCT тиков в окне в 1 с; до
+ * конца окна остаток отдаётся бакетам.
+ */
+
+static struct ready_queue_head rt_queues[SCHED_RT_LEVELS];
+static uint64_t rt_bitmap[2];
+static struct ready_queue_head dl_queue;
+
+static uint64_t dl_bw_used = 0;      /* сумма runtime/period, фикс. точка SCHED_DL_BW_SHIFT */
+static uint32_t rt_window_pos = 0;
+static uint32_t rt_window_used = 0;
+static bool rt_throttled = false;
+static scheduler_rt_stats_t rt_stats;
+
+/*
+ * rt_spin защищает RT/DL-очереди, rt_bitmap, RT-окно, dl_bw_used, rt_stats
+ * и поля thread->rt потоков этого класса. Все точки входа ниже берут его
+ * сами: setattr и PI-буст приходят из контекста потока с любого CPU, тик и
+ * переключение — из прерывания; irqsave не пускает тик этого CPU внутрь.
+ * ready_remove/ready_enqueue сами заходят в sched_rt_remove/enqueue, поэтому
+ * вызываются без rt_spin.
+ */
+static spinlock_t rt_spin;
+
+static inline irql_t rt_lock(void)
+{
+    return spinlock_lock_irqsave(&rt_spin);
+}
+
+static inline void rt_unlock(irql_t old)
+{
+    spinlock_unlock_irqrestore(&rt_spin, old);
+}
+
+void sched_rt_init(void)
+{
+    spinlock_init(&rt_spin);
+    for (int i = 0; i < SCHED_RT_LEVELS; i++) {
+        TAILQ_INIT(&rt_queues[i]);
+    }
+    TAILQ_INIT(&dl_queue);
+    rt_bitmap[0] = 0;
+    rt_bitmap[1] = 0;
+    dl_bw_used = 0;
+    rt_window_pos = 0;
+    rt_window_used = 0;
+    rt_throttled = false;
+}
+
+static inline uint64_t sched_clock_ns(void)
+{
+    return rusage_cycles_to_ns(cpu_get_time());
+}
+
+static inline uint64_t dl_bw(uint64_t runtime, uint64_t period)
+{
+    return period ? (runtime << SCHED_DL_BW_SHIFT) / period : 0;
+}
+
+static inline uint16_t rr_quantum_ticks(void)
+{
+    uint32_t t = (sched_tick_hz * SCHED_RR_QUANTUM_MS + 999u) / 1000u;
+    return (uint16_t)(t ? t : 1u);
+}
+
+bool sched_rt_thread(const thread_t* thread)
+{
+    return thread && (thread->rt.policy != SCHED_OTHER || thread->rt.pi_prio != 0);
+}
+
+int sched_rt_level(const thread_t* thread)
+{
+    int level = 0;
+    if (thread->rt.policy == SCHED_FIFO || thread->rt.policy == SCHED_RR) {
+        level = thread->rt.prio;
+    }
+    if (thread->rt.pi_prio > level) {
+        level = thread->rt.pi_prio;
+    }
+    return level;
+}
+
+/* Новый период DEADLINE-потока, начиная с now. */
+static void dl_replenish(thread_t* t, uint64_t now)
+{
+    t->rt.dl_abs_deadline = now + t->rt.dl_deadline;
+    t->rt.dl_next_period = now + t->rt.dl_period;
+    t->rt.dl_budget = (int64_t)t->rt.dl_runtime;
+    t->rt.dl_throttled = 0;
+}
+
+static void dl_insert(thread_t* t)
+{
+    thread_t* it;
+    TAILQ_FOREACH(it, &dl_queue, sched_link) {
+        if (t->rt.dl_abs_deadline < it->rt.dl_abs_deadline) {
+            TAILQ_INSERT_BEFORE(it, t, sched_link);
+            return;
+        }
+    }
+    TAILQ_INSERT_TAIL(&dl_queue, t, sched_link);
+}
+
+void sched_rt_enqueue(thread_t* thread, bool head)
+{
+    irql_t old = rt_lock();
+    if (thread->rt.policy == SCHED_DEADLINE) {
+        dl_insert(thread);
+        thread->rt.rq_kind = SCHED_RQ_DL;
+        thread->rt.rq_level = 0;
+        rt_unlock(old);
+        return;
+    }
+    int level = sched_rt_level(thread);
+    if (head) {
+        TAILQ_INSERT_HEAD(&rt_queues[level], thread, sched_link);
+    } else {
+        TAILQ_INSERT_TAIL(&rt_queues[level], thread, sched_link);
+    }
+    rt_bitmap[level >> 6] |= 1ULL << (level & 63);
+    thread->rt.rq_kind = SCHED_RQ_RT;
+    thread->rt.rq_level = (uint8_t)level;
+    rt_unlock(old);
+}
+
+static void rt_remove_locked(thread_t* thread)
+{
+    if (thread->rt.rq_kind == SCHED_RQ_DL) {
+        TAILQ_REMOVE(&dl_queue, thread, sched_link);
+    } else if (thread->rt.rq_kind == SCHED_RQ_RT) {
+        int level = thread->rt.rq_level;
+        TAILQ_REMOVE(&rt_queues[level], thread, sched_link);
+        if (TAILQ_EMPTY(&rt_queues[level])) {
+            rt_bitmap[level >> 6] &= ~(1ULL << (level & 63));
+        }
+    }
+    thread->rt.rq_kind = SCHED_RQ_NONE;
+}
+
+void sched_rt_remove(thread_t* thread)
+{
+    irql_t old = rt_lock();
+    rt_remove_locked(thread);
+    rt_unlock(old);
+}
+
+thread_t* sched_rt_dequeue(void)
+{
+    thread_t* t = NULL;
+    irql_t old = rt_lock();
+    if (rt_throttled) {
+        rt_unlock(old);
+        return NULL;
+    }
+    thread_t* it;
+    TAILQ_FOREACH(it, &dl_queue, sched_link) {
+        if (!it->rt.dl_throttled) {
+            t = it;
+            break;
+        }
+    }
+    for (int w = 1; w >= 0 && !t; w--) {
+        if (rt_bitmap[w]) {
+            int level = w * 64 + 63 - __builtin_clzll(rt_bitmap[w]);
+            t = TAILQ_FIRST(&rt_queues[level]);
+        }
+    }
+    if (t) {
+        rt_remove_locked(t);
+    }
+    rt_unlock(old);
+    return t;
+}
+
+/* Списать время, проработанное DEADLINE-потоком с последнего учёта. */
+static void dl_charge(thread_t* t, uint64_t now)
+{
+    static uint64_t dl_stamp = 0;
+    if (t && t->rt.policy == SCHED_DEADLINE && dl_stamp && now > dl_stamp) {
+        t->rt.dl_budget -= (int64_t)(now - dl_stamp);
+    }
+    dl_stamp = now;
+}
+
+static void dl_throttle(thread_t* t, uint64_t now)
+{
+    if (now >= t->rt.dl_next_period) {
+        dl_replenish(t, now);
+        return;
+    }
+    t->rt.dl_throttled = 1;
+    rt_stats.dl_throttled++;
+}
+
+bool sched_rt_tick(thread_t* cur)
+{
+    bool resched = false;
+    uint64_t now = sched_clock_ns();
+    irql_t old = rt_lock();
+
+    if (++rt_window_pos >= sched_tick_hz) {
+        rt_window_pos = 0;
+        rt_window_used = 0;
+        if (rt_throttled) {
+            rt_throttled = false;
+            resched = true;
+        }
+    }
+
+    /* Новый период для ждущих в очереди: переставить по новому дедлайну. */
+    thread_t* it;
+    thread_t* tmp;
+    TAILQ_FOREACH_SAFE(it, &dl_queue, sched_link, tmp) {
+        if (it->rt.dl_throttled && now >= it->rt.dl_next_period) {
+            TAILQ_REMOVE(&dl_queue, it, sched_link);
+            dl_replenish(it, now);
+            dl_insert(it);
+            resched = true;
+        }
+    }
+
+    if (!cur || cur->state != THREAD_STATE_RUNNING || !sched_rt_thread(cur)) {
+        rt_unlock(old);
+        return resched;
+    }
+    if (++rt_window_used >= (sched_tick_hz * SCHED_RT_RUNTIME_PCT) / 100u && !rt_throttled) {
+        rt_throttled = true;
+        rt_stats.rt_throttled++;
+        resched = true;
+    }
+    if (cur->rt.policy == SCHED_DEADLINE) {
+        dl_charge(cur, now);
+        if (now > cur->rt.dl_abs_deadline && cur->rt.dl_budget > 0) {
+            /* Работа не уложилась в дедлайн: начать новый период отсюда. */
+            cur->rt.dl_misses++;
+            rt_stats.dl_misses++;
+            dl_replenish(cur, now);
+            resched = true;
+        } else if (cur->rt.dl_budget <= 0) {
+            dl_throttle(cur, now);
+            resched = true;
+        }
+    } else if (cur->rt.policy == SCHED_RR) {
+        if (cur->rt.rr_ticks > 1) {
+            cur->rt.rr_ticks--;
+        } else {
+            cur->rt.rr_ticks = rr_quantum_ticks();
+            cur->rt.requeue_tail = 1;
+            resched = true;
+        }
+    }
+    rt_unlock(old);
+    return resched;
+}
+
+void sched_rt_wake(thread_t* thread)
+{
+    if (!thread || thread->rt.policy != SCHED_DEADLINE) {
+        return;
+    }
+    uint64_t now = sched_clock_ns();
+    irql_t old = rt_lock();
+    /* Проснулся после своего дедлайна: текущий период для него потерян. */
+    if (now >= thread->rt.dl_abs_deadline ||
+        (thread->rt.dl_throttled && now >= thread->rt.dl_next_period)) {
+        dl_replenish(thread, now);
+    }
+    rt_unlock(old);
+}
+
+void sched_rt_yield(thread_t* cur)
+{
+    if (!cur || !sched_rt_thread(cur)) {
+        return;
+    }
+    irql_t old = rt_lock();
+    if (cur->rt.policy == SCHED_DEADLINE) {
+        /* Работа периода закончена: остаток бюджета сгорает. */
+        cur->rt.dl_budget = 0;
+        dl_throttle(cur, sched_clock_ns());
+    } else {
+        cur->rt.requeue_tail = 1;
+    }
+    rt_unlock(old);
+}
+
+void sched_rt_switch(thread_t* prev, thread_t* next)
+{
+    uint64_t now = sched_clock_ns();
+    irql_t old = rt_lock();
+    dl_charge(prev, now);
+    if (prev && prev->rt.policy == SCHED_DEADLINE && prev->rt.dl_budget <= 0 &&
+        !prev->rt.dl_throttled) {
+        dl_throttle(prev, now);
+    }
+    rt_unlock(old);
+    (void)next;
+}
+
+void sched_rt_exit(thread_t* thread)
+{
+    if (!thread) {
+        return;
+    }
+    irql_t old = rt_lock();
+    if (thread->rt.policy == SCHED_DEADLINE) {
+        dl_bw_used -= dl_bw(thread->rt.dl_runtime, thread->rt.dl_period);
+        thread->rt.policy = SCHED_OTHER;
+    }
+    rt_unlock(old);
+}
+
+static int sched_params_check(const sched_params_t* p)
+{
+    switch (p->policy) {
+    case SCHED_OTHER:
+        return p->priority == 0 ? RDNX_OK : RDNX_E_INVALID;
+    case SCHED_FIFO:
+    case SCHED_RR:
+        return (p->priority >= SCHED_RT_PRIO_MIN && p->priority <= SCHED_RT_PRIO_MAX) ?
+               RDNX_OK : RDNX_E_INVALID;
+    case SCHED_DEADLINE: {
+        uint64_t period = p->period_ns ? p->period_ns : p->deadline_ns;
+        if (p->priority != 0 || p->runtime_ns < 1024u ||
+            p->runtime_ns > p->deadline_ns || p->deadline_ns > period ||
+            period > (1ULL << 40)) {
+            return RDNX_E_INVALID;
+        }
+        return RDNX_OK;
+    }
+    default:
+        return RDNX_E_INVALID;
+    }
+}
+
+int scheduler_setattr(thread_t* thread, const sched_params_t* params)
+{
+    if (!thread || !params) {
+        return RDNX_E_INVALID;
+    }
+    int rc = sched_params_check(params);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+
+    sched_params_t p = *params;
+    if (p.policy == SCHED_DEADLINE && p.period_ns == 0) {
+        p.period_ns = p.deadline_ns;
+    }
+    uint64_t new_bw = p.policy == SCHED_DEADLINE ? dl_bw(p.runtime_ns, p.period_ns) : 0;
+    uint64_t limit = ((uint64_t)SCHED_DL_BW_PCT << SCHED_DL_BW_SHIFT) / 100u;
+
+    /* Снять с очереди до rt_spin: ready_remove берёт его сам. */
+    bool queued = ready_thread_is_queued(thread);
+    if (queued) {
+        ready_remove(thread);
+    }
+    irql_t old = rt_lock();
+    uint64_t old_bw = thread->rt.policy == SCHED_DEADLINE ?
+                      dl_bw(thread->rt.dl_runtime, thread->rt.dl_period) : 0;
+    if (dl_bw_used - old_bw + new_bw > limit) {
+        rt_unlock(old);
+        if (queued) {
+            ready_enqueue(thread);
+        }
+        return RDNX_E_BUSY;
+    }
+    dl_bw_used = dl_bw_used - old_bw + new_bw;
+    thread->rt.policy = (uint8_t)p.policy;
+    thread->rt.prio = (uint8_t)p.priority;
+    thread->rt.requeue_tail = 0;
+    thread->rt.rr_ticks = rr_quantum_ticks();
+    thread->rt.dl_runtime = p.runtime_ns;
+    thread->rt.dl_deadline = p.deadline_ns;
+    thread->rt.dl_period = p.period_ns;
+    thread->rt.dl_misses = 0;
+    if (p.policy == SCHED_DEADLINE) {
+        dl_replenish(thread, sched_clock_ns());
+    }
+    thread->sched_class = p.policy == SCHED_OTHER ? SCHED_CLASS_TIMESHARE : SCHED_CLASS_REALTIME;
+    rt_unlock(old);
+    if (queued) {
+        ready_enqueue(thread);
+    }
+    resched_pending = true;
+    return RDNX_OK;
+}
+
+int scheduler_getattr(const thread_t* thread, sched_params_t* params)
+{
+    if (!thread || !params) {
+        return RDNX_E_INVALID;
+    }
+    irql_t old = rt_lock();
+    params->policy = thread->rt.policy;
+    params->priority = (thread->rt.policy == SCHED_FIFO || thread->rt.policy == SCHED_RR) ?
+                       thread->rt.prio : 0;
+    params->runtime_ns = thread->rt.dl_runtime;
+    params->deadline_ns = thread->rt.dl_deadline;
+    params->period_ns = thread->rt.dl_period;
+    rt_unlock(old);
+    return RDNX_OK;
+}
+
+int scheduler_pi_level(const thread_t* thread)
+{
+    if (!thread) {
+        return 0;
+    }
+    if (thread->rt.policy == SCHED_DEADLINE) {
+        return SCHED_RT_PI_DEADLINE;
+    }
+    return sched_rt_level(thread);
+}
+
+void scheduler_pi_set(thread_t* thread, int level)
+{
+    if (!thread) {
+        return;
+    }
+    if (level < 0) {
+        level = 0;
+    }
+    if (level > SCHED_RT_PI_DEADLINE) {
+        level = SCHED_RT_PI_DEADLINE;
+    }
+    if (thread->rt.pi_prio == (uint8_t)level) {
+        return;
+    }
+    bool queued = ready_thread_is_queued(thread);
+    if (queued) {
+        ready_remove(thread);
+    }
+    irql_t old = rt_lock();
+    if (level > thread->rt.pi_prio) {
+        rt_stats.pi_boosts++;
+    }
+    thread->rt.pi_prio = (uint8_t)level;
+    rt_unlock(old);
+    if (queued) {
+        ready_enqueue(thread);
+    }
+    resched_pending = true;
+}
+
+int scheduler_get_rt_stats(scheduler_rt_stats_t* out)
+{
+    if (!out) {
+        return RDNX_E_INVALID;
+    }
+    irql_t old = rt_lock();
+    *out = rt_stats;
+    out->dl_bw_ppm = (uint32_t)((dl_bw_used * 1000000u) >> SCHED_DL_BW_SHIFT);
+    rt_unlock(old);
+    return RDNX_OK;
+}
+
+void sched_rt_debug_dump(void)
+{
+    uint32_t rt = 0;
+    uint32_t dl = 0;
+    thread_t* it;
+    irql_t old = rt_lock();
+    for (int q = 0; q < SCHED_RT_LEVELS; q++) {
+        TAILQ_FOREACH(it, &rt_queues[q], sched_link) {
+            rt++;
+        }
+    }
+    TAILQ_FOREACH(it, &dl_queue, sched_link) {
+        dl++;
+    }
+    bool throttled = rt_throttled;
+    uint64_t bw = dl_bw_used;
+    rt_unlock(old);
+    kprintf("[SCHED] rt ready=%u dl ready=%u throttled=%d dl_bw_ppm=%u\n",
+            (unsigned)rt, (unsigned)dl, throttled ? 1 : 0,
+            (unsigned)((bw * 1000000u) >> SCHED_DL_BW_SHIFT));
+}
@@ -1,4 +1,5 @@
 #include "internal.h"
+#include "../cgroup.h"
 #include "../../arch/gdt.h"
 #include "../../../include/debug.h"
 
@@ -54,7 +55,8 @@ void scheduler_reset_timeslice(const thread_t* thread)
         return;
     }
     if (thread->sched_class == SCHED_CLASS_REALTIME) {
-        ticks_until_preempt = REALTIME_QUANTUM_TICKS;
+        /* FIFO/RR/DEADLINE режет по времени rt.c, общий квант им не нужен. */
+        ticks_until_preempt = ticks_per_slice;
         return;
     }
     uint32_t base = ticks_per_slice;
@@ -84,7 +86,7 @@ bool ready_thread_is_queued(const thread_t* thread)
     return thread && thread->ready_queued != 0;
 }
 
-void ready_enqueue(thread_t* thread)
+static void ready_enqueue_at(thread_t* thread, bool head)
 {
     if (!thread) {
         return;
@@ -94,20 +96,91 @@ void ready_enqueue(thread_t* thread)
         DEBUG_WARN("ready_enqueue: thread %llu already queued", (unsigned long long)thread->thread_id);
         return;
     }
-    int q = ready_queue_index_for_thread(thread);
-    if (q < 0 || q >= READY_QUEUE_LEVELS) {
-        q = (int)SCHED_BUCKET_DEFAULT;
+    if (sched_rt_thread(thread)) {
+        sched_rt_enqueue(thread, head);
+    } else {
+        int q = ready_queue_index_for_thread(thread);
+        if (q < 0 || q >= READY_QUEUE_LEVELS) {
+            q = (int)SCHED_BUCKET_DEFAULT;
+        }
+        cgroup_sched_enqueue(thread->task);
+        TAILQ_INSERT_TAIL(&ready_queues[q], thread, sched_link);
+        thread->rt.rq_kind = SCHED_RQ_BUCKET;
+        thread->rt.rq_level = (uint8_t)q;
     }
-    TAILQ_INSERT_TAIL(&ready_queues[q], thread, sched_link);
     thread->ready_queued = 1;
     stats.ready_tasks++;
 }
 
-/* Вспомогательная функция: извлечь первый поток из очереди q и обновить метрики. */
+void ready_enqueue(thread_t* thread)
+{
+    ready_enqueue_at(thread, false);
+}
+
+/*
+ * Вытесненный RT-поток возвращается в голову своего уровня (POSIX), в
+ * хвост — только после sched_yield или конца кванта RR.
+ */
+void ready_enqueue_preempted(thread_t* thread)
+{
+    if (!thread) {
+        return;
+    }
+    bool head = sched_rt_thread(thread) && !thread->rt.requeue_tail;
+    thread->rt.requeue_tail = 0;
+    ready_enqueue_at(thread, head);
+}
+
+static void ready_unlink(thread_t* thread)
+{
+    thread->sched_link.tqe_next = NULL;
+    thread->sched_link.tqe_prev = NULL;
+    thread->ready_queued = 0;
+    thread->rt.rq_kind = SCHED_RQ_NONE;
+    if (stats.ready_tasks > 0) {
+        stats.ready_tasks--;
+    }
+}
+
+/* Снять поток из любой ready-очереди (смена политики, наследование приоритета). */
+void ready_remove(thread_t* thread)
+{
+    if (!ready_thread_is_queued(thread)) {
+        return;
+    }
+    if (thread->rt.rq_kind == SCHED_RQ_BUCKET) {
+        TAILQ_REMOVE(&ready_queues[thread->rt.rq_level], thread, sched_link);
+    } else {
+        sched_rt_remove(thread);
+    }
+    ready_unlink(thread);
+}
+
+/*
+ * Выбор внутри бакета при наличии cgroup: пропустить потоки групп,
+ * исчерпавших квоту, и взять поток группы, сильнее всего отставшей от своей
+ * доли (при равенстве — первый по FIFO).
+ */
+static thread_t* pick_cgroup(struct ready_queue_head* queue)
+{
+    thread_t* best = NULL;
+    thread_t* it;
+    TAILQ_FOREACH(it, queue, sched_link) {
+        if (cgroup_sched_throttled(it->task)) {
+            continue;
+        }
+        if (!best || cgroup_sched_before(it->task, best->task)) {
+            best = it;
+        }
+    }
+    return best;
+}
+
+/* Вспомогательная функция: извлечь поток из очереди q и обновить метрики. */
 static thread_t* dequeue_from(int q)
 {
     struct ready_queue_head* queue = &ready_queues[q];
-    thread_t* thread = TAILQ_FIRST(queue);
+    thread_t* thread = cgroup_sched_active() ? pick_cgroup(queue) : TAILQ_FIRST(queue);
     if (!thread) {
         return NULL;
     }
@@ -116,18 +189,20 @@ static thread_t* dequeue_from(int q)
                    (unsigned long long)thread->thread_id, thread->state);
     }
     TAILQ_REMOVE(queue, thread, sched_link);
-    thread->sched_link.tqe_next = NULL;
-    thread->sched_link.tqe_prev = NULL;
-    thread->ready_queued = 0;
-    if (stats.ready_tasks > 0) {
-        stats.ready_tasks--;
-    }
+    ready_unlink(thread);
     bucket_last_run_tick[q] = sched_ticks;
     return thread;
 }
 
 thread_t* ready_dequeue(void)
 {
+    /* DEADLINE и FIFO/RR всегда впереди бакетов (если не исчерпано RT-окно). */
+    thread_t* rt = sched_rt_dequeue();
+    if (rt) {
+        ready_unlink(rt);
+        return rt;
+    }
+
     /* RR/FIFO: всё в DEFAULT-очереди */
     if (current_policy == SCHED_POLICY_RR || current_policy == SCHED_POLICY_FIFO) {
         return dequeue_from((int)SCHED_BUCKET_DEFAULT);
@@ -139,7 +214,10 @@ thread_t* ready_dequeue(void)
     for (int b = (int)SCHED_BUCKET_BACKGROUND; b < (int)SCHED_BUCKET_INTERACTIVE; b++) {
         if (!TAILQ_EMPTY(&ready_queues[b]) &&
             (sched_ticks - bucket_last_run_tick[b]) >= STARVATION_THRESHOLD_TICKS) {
-            return dequeue_from(b);
+            thread_t* t = dequeue_from(b);
+            if (t) {
+                return t;
+            }
         }
     }
 
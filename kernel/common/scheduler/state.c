@@ -12,6 +12,7 @@ uint32_t ticks_until_preempt = 1;
 uint32_t ticks_per_slice = 1;
 volatile bool resched_pending = false;
 uint64_t sched_ticks = 0;
+uint32_t sched_tick_hz = 100;
 
 struct ready_queue_head ready_queues[READY_QUEUE_LEVELS];
 
@@ -111,6 +112,7 @@ int scheduler_init(void)
         TAILQ_INIT(&ready_queues[i]);
         bucket_last_run_tick[i] = 0;
     }
+    sched_rt_init();
     waitq_init(&scheduler_sleep_waitq, "scheduler_sleep");
     ticks_per_slice = 1;
     ticks_until_preempt = ticks_per_slice;
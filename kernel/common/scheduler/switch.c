@@ -1,5 +1,8 @@
 #include "internal.h"
 #include "../tracev2.h"
+#include "../rusage.h"
+#include "../rcu.h"
+#include "../preempt.h"
 #include "../bootlog.h"
 #include "../../arch/paging.h"
 #include "../../../include/debug.h"
@@ -59,6 +62,14 @@ interrupt_frame_t* scheduler_switch_from_irq(interrupt_frame_t* frame)
         in_scheduler = false;
         return frame;
     }
+    /*
+     * Never preempt a thread inside a preempt-off section (spinlock, RCU
+     * reader); resched_pending stays set and preempt_enable() switches.
+     */
+    if (cur && cur->state == THREAD_STATE_RUNNING && !preempt_switch_allowed(cur)) {
+        in_scheduler = false;
+        return frame;
+    }
     resched_pending = false;
 
     if (!cur) {
@@ -79,9 +90,11 @@ interrupt_frame_t* scheduler_switch_from_irq(interrupt_frame_t* frame)
     }
 
     cur->context.stack_pointer = (uint64_t)(uintptr_t)frame;
+    /* Still RUNNING here means the quantum expired: an involuntary switch. */
+    int voluntary = (cur->state != THREAD_STATE_RUNNING);
     if (cur->state == THREAD_STATE_RUNNING) {
         scheduler_thread_set_state(cur, THREAD_STATE_READY, "switch_preempt");
-        ready_enqueue(cur);
+        ready_enqueue_preempted(cur);
     }
 
     thread_t* next = ready_dequeue();
@@ -101,6 +114,10 @@ interrupt_frame_t* scheduler_switch_from_irq(interrupt_frame_t* frame)
     }
 
     thread_t* prev = cur;
+    rcu_note_context_switch();
+    preempt_note_switch(prev, voluntary != 0);
+    sched_rt_switch(prev, next);
+    rusage_switch(prev, next, (frame->cs & 3u) != 0, voluntary);
     thread_set_current(next);
     if (next->task) {
         task_set_current(next->task);
@@ -1,4 +1,5 @@
 #include "internal.h"
+#include "../cgroup.h"
 
 void scheduler_tick(void)
 {
@@ -9,7 +10,12 @@ void scheduler_tick(void)
     sched_ticks++;
     waitq_tick(sched_ticks);
     thread_t* cur = thread_get_current();
-    if (cur && cur->state == THREAD_STATE_RUNNING) {
+    int running = (cur && cur->state == THREAD_STATE_RUNNING);
+    /* CPU-время и квоты cgroup; исчерпанная квота вытесняет текущий поток */
+    if (cgroup_sched_tick(running ? cur->task : NULL, sched_ticks)) {
+        resched_pending = true;
+    }
+    if (running) {
         cur->sched_usage = (cur->sched_usage * 7) / 8;
         cur->sched_usage++;
         /* Обновить CPU-счётчики группы (task_t.thread_group) */
@@ -26,6 +32,14 @@ void scheduler_tick(void)
         }
     }
 
+    /* FIFO/RR/DEADLINE: квант RR, бюджеты DEADLINE и RT-окно — в rt.c */
+    if (sched_rt_tick(running ? cur : NULL)) {
+        resched_pending = true;
+    }
+    if (running && cur->sched_class == SCHED_CLASS_REALTIME) {
+        return;
+    }
+
     if (ticks_until_preempt > 0) {
         ticks_until_preempt--;
     }
@@ -42,6 +56,7 @@ void scheduler_set_tick_rate(uint32_t hz)
         return;
     }
 
+    sched_tick_hz = hz;
     uint32_t ticks = (hz * SCHEDULER_TIME_SLICE_MS + 999) / 1000;
     if (ticks == 0) {
         ticks = 1;
@@ -52,11 +67,20 @@ void scheduler_set_tick_rate(uint32_t hz)
     }
 }
 
+bool scheduler_need_resched(void)
+{
+    return scheduler_running && resched_pending && !in_scheduler;
+}
+
 void scheduler_ast_check(void)
 {
-    if (!scheduler_running) {
+    if (!scheduler_need_resched()) {
         return;
     }
-
-    /* Preemption happens on timer IRQ; keep this as a no-op */
+    thread_t* cur = thread_get_current();
+    /* Not from an interrupt handler or a preempt-off section. */
+    if (!cur || cur->state != THREAD_STATE_RUNNING || cur->preempt_count != 0) {
+        return;
+    }
+    __asm__ volatile ("int $0x81" ::: "memory", "cc");
 }
@@ -882,13 +882,15 @@ static int shell_cmd_kmodls(int argc, char** argv)
         if (kmod_get_info(i, &mi) != RDNX_OK) {
             continue;
         }
-        kprintf("  %u: %s type=%s ver=%s %s %s\n",
+        kprintf("  %u: %s type=%s ver=%s %s %s refs=%u deps=%u\n",
                 (unsigned)i,
                 mi.name,
                 mi.kind,
                 mi.version,
                 mi.builtin ? "builtin" : "loadable",
-                mi.loaded ? "loaded" : "unloaded");
+                mi.loaded ? "loaded" : "unloaded",
+                (unsigned)mi.refs,
+                (unsigned)mi.ndeps);
     }
     return RDNX_OK;
 }
@@ -6,6 +6,7 @@
  */
 
 #include "../../include/common.h"
+#include "kmod.h"
 #include <stddef.h>
 
 /* ============================================================================
@@ -20,6 +21,7 @@ size_t strlen(const char* str)
     }
     return len;
 }
+EXPORT_SYMBOL(strlen);
 
 /* ============================================================================
  * String Copy
@@ -52,6 +54,7 @@ char* strncpy(char* dest, const char* src, size_t n)
     
     return dest;
 }
+EXPORT_SYMBOL(strncpy);
 
 /* ============================================================================
  * String Compare
@@ -65,6 +68,7 @@ int strcmp(const char* s1, const char* s2)
     }
     return (int)((unsigned char)*s1 - (unsigned char)*s2);
 }
+EXPORT_SYMBOL(strcmp);
 
 int strncmp(const char* s1, const char* s2, size_t n)
 {
@@ -139,6 +143,7 @@ void* memset(void* ptr, int value, size_t size)
     }
     return ptr;
 }
+EXPORT_SYMBOL(memset);
 
 void* memcpy(void* dest, const void* src, size_t size)
 {
@@ -151,6 +156,7 @@ void* memcpy(void* dest, const void* src, size_t size)
     
     return dest;
 }
+EXPORT_SYMBOL(memcpy);
 
 void* memmove(void* dest, const void* src, size_t size)
 {
@@ -185,4 +191,5 @@ int memcmp(const void* ptr1, const void* ptr2, size_t size)
     
     return 0;
 }
+EXPORT_SYMBOL(memcmp);
 
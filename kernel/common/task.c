@@ -11,7 +11,11 @@
 #include "../core/interrupts.h"
 #include "../fs/vfs.h"
 #include "../unix/unix_layer.h"
+#include "rusage.h"
+#include "cgroup.h"
+#include "rculist.h"
 #include "../../include/error.h"
+#include "../../include/common.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -34,10 +38,16 @@ static cpu_local_t g_cpu_locals[MAX_CPUS];
 
 /*
  * LOCKING: task registry — protected by IRQL_HIGH (task_registry_lock / task_registry_unlock).
- *   Protects: all_tasks_head, all_tasks_by_id, next_task_id, next_thread_id.
+ *   Protects: all_tasks_head, task_id_hash[] updates, next_task_id, next_thread_id,
+ *             every task's threads list and thread_count.
  *   Mechanism: raises IRQL to IRQL_HIGH (disables interrupts on UP), effectively
  *              acting as a spinlock on uniprocessor.
  *   Lock order: task_registry_lock -> (no inner locks; must NOT acquire ipc locks).
+ *   task_find_by_id walks task_id_hash[] under rcu_read_lock() and takes a
+ *   reference (ref_count, only if still non-zero) before leaving the read
+ *   section; the caller drops it with task_put(). task_destroy unlinks under
+ *   the lock, tears the task down and drops the creation reference; the last
+ *   task_put frees the task_t after a grace period (call_rcu).
  *
  * LOCKING: stack_cache — protected by IRQL_HIGH (task_stack_cache_lock / task_stack_cache_unlock).
  *   Protects: stack_cache[], stack_cache_count, stack_cache_hits, stack_cache_misses.
@@ -49,27 +59,13 @@ static cpu_local_t g_cpu_locals[MAX_CPUS];
 static uint64_t next_task_id = 1;
 static uint64_t next_thread_id = 1;
 static task_t* all_tasks_head = NULL;
-RB_HEAD(task_id_index, task);
-static int task_id_cmp(task_t* lhs, task_t* rhs)
+#define TASK_ID_HASH_BUCKETS 64   /* power of two */
+static LIST_HEAD(task_id_hash_head, task) task_id_hash[TASK_ID_HASH_BUCKETS];
+
+static inline struct task_id_hash_head* task_id_bucket(uint64_t task_id)
 {
-    if (lhs->task_id < rhs->task_id) {
-        return -1;
-    }
-    if (lhs->task_id > rhs->task_id) {
-        return 1;
-    }
-    return 0;
+    return &task_id_hash[rcu_hash_u64(task_id) & (TASK_ID_HASH_BUCKETS - 1)];
 }
-RB_PROTOTYPE_STATIC(task_id_index, task, task_id_link, task_id_cmp);
-#if defined(__GNUC__)
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
-#endif
-RB_GENERATE_STATIC(task_id_index, task, task_id_link, task_id_cmp);
-#if defined(__GNUC__)
-#pragma GCC diagnostic pop
-#endif
-static struct task_id_index all_tasks_by_id = RB_INITIALIZER(&all_tasks_by_id);
 
 static inline irql_t task_registry_lock(void)
 {
@@ -272,21 +268,26 @@ task_t* task_create(void)
             p[i] = 0;
         }
     }
+    task->comm[0] = '\0';
+    rusage_task_init(task);
+    cgroup_task_init(task);
     task->main_thread = NULL;
     TAILQ_INIT(&task->threads);
     task->thread_count = 0;
     task->ref_count = 1;
-    task->task_id_link.rbe_link[0] = NULL;
-    task->task_id_link.rbe_link[1] = NULL;
-    task->task_id_link.rbe_link[2] = NULL;
     task->next_all = all_tasks_head;
     all_tasks_head = task;
-    (void)RB_INSERT(task_id_index, &all_tasks_by_id, task);
+    LIST_INSERT_HEAD_RCU(task_id_bucket(task->task_id), task, task_id_link);
     task_registry_unlock(old);
     task->arch_specific = NULL;
     return task;
 }
 
+static void task_free_rcu(rcu_head_t* head)
+{
+    kfree(rcu_entry(head, task_t, rcu));
+}
+
 void task_destroy(task_t* task)
 {
     if (!task) {
@@ -303,7 +304,7 @@ void task_destroy(task_t* task)
             }
         }
     }
-    (void)RB_REMOVE(task_id_index, &all_tasks_by_id, task);
+    LIST_REMOVE_RCU(task, task_id_link);
     task_registry_unlock(old);
     /* Destroy all threads still attached to this task (P0-4).
      * The current thread is handled by the reaper and is not in the list
@@ -319,7 +320,28 @@ void task_destroy(task_t* task)
         }
     }
     vm_task_destroy(task);
-    kfree(task);
+    cgroup_task_exit(task);
+    /* Holders from task_find_by_id keep the (torn down) task_t alive. */
+    task_put(task);
+}
+
+task_t* task_get(task_t* task)
+{
+    if (task) {
+        __atomic_fetch_add(&task->ref_count, 1u, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+void task_put(task_t* task)
+{
+    if (!task) {
+        return;
+    }
+    if (__atomic_sub_fetch(&task->ref_count, 1u, __ATOMIC_ACQ_REL) == 0) {
+        /* A concurrent task_find_by_id may still be looking at it. */
+        call_rcu(&task->rcu, task_free_rcu);
+    }
 }
 
 task_t* task_find_by_id(uint64_t task_id)
@@ -327,10 +349,46 @@ task_t* task_find_by_id(uint64_t task_id)
     if (task_id == 0) {
         return NULL;
     }
-    task_t key = {0};
-    key.task_id = task_id;
+    task_t* found = NULL;
+    task_t* it;
+    rcu_read_lock();
+    LIST_FOREACH_RCU(it, task_id_bucket(task_id), task_id_link) {
+        if (it->task_id != task_id) {
+            continue;
+        }
+        uint32_t ref = __atomic_load_n(&it->ref_count, __ATOMIC_RELAXED);
+        while (ref != 0) {
+            if (__atomic_compare_exchange_n(&it->ref_count, &ref, ref + 1u, false,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                found = it;
+                break;
+            }
+        }
+        /* ref 0: lost the race with the last task_put. */
+        break;
+    }
+    rcu_read_unlock();
+    return found;
+}
+
+thread_t* thread_find_by_id(uint64_t thread_id, task_t** ref)
+{
+    *ref = NULL;
+    if (thread_id == 0) {
+        return NULL;
+    }
+    thread_t* found = NULL;
     irql_t old = task_registry_lock();
-    task_t* found = RB_FIND(task_id_index, &all_tasks_by_id, &key);
+    for (task_t* it = all_tasks_head; it && !found; it = it->next_all) {
+        thread_t* thr;
+        TAILQ_FOREACH(thr, &it->threads, task_link) {
+            if (thr->thread_id == thread_id) {
+                *ref = task_get(it);
+                found = thr;
+                break;
+            }
+        }
+    }
     task_registry_unlock(old);
     return found;
 }
@@ -377,12 +435,68 @@ uint32_t task_get_thread_count(const task_t* task)
     return task ? task->thread_count : 0;
 }
 
+int task_fd_limit(const task_t* task)
+{
+    if (!task) {
+        return TASK_MAX_FD;
+    }
+    uint64_t cur = task->rlimits[TASK_RLIMIT_NOFILE].cur;
+    return (cur < (uint64_t)TASK_MAX_FD) ? (int)cur : TASK_MAX_FD;
+}
+
+uint32_t task_count_by_uid(uint32_t uid)
+{
+    uint32_t n = 0;
+    irql_t old = task_registry_lock();
+    for (task_t* it = all_tasks_head; it; it = it->next_all) {
+        if (it->uid == uid && !it->exited && it->state != TASK_STATE_DEAD) {
+            n++;
+        }
+    }
+    task_registry_unlock(old);
+    return n;
+}
+
+uint32_t task_foreach(task_iter_fn_t fn, void* ctx)
+{
+    uint32_t n = 0;
+    irql_t old = task_registry_lock();
+    for (task_t* it = all_tasks_head; it; it = it->next_all) {
+        if (fn) {
+            fn(it, ctx);
+        }
+        n++;
+    }
+    task_registry_unlock(old);
+    return n;
+}
+
+void task_set_comm(task_t* task, const char* path)
+{
+    if (!task || !path) {
+        return;
+    }
+    const char* base = path;
+    for (const char* p = path; *p; p++) {
+        if (*p == '/' && p[1] != '\0') {
+            base = p + 1;
+        }
+    }
+    size_t i = 0;
+    while (base[i] && base[i] != '/' && i + 1 < TASK_COMM_MAX) {
+        task->comm[i] = base[i];
+        i++;
+    }
+    task->comm[i] = '\0';
+}
+
 int task_fd_alloc(task_t* task, void* handle)
 {
     if (!task || !handle) {
         return RDNX_E_INVALID;
     }
-    for (int i = 0; i < TASK_MAX_FD; i++) {
+    int limit = task_fd_limit(task);
+    for (int i = 0; i < limit; i++) {
         if (!task->fd_table[i]) {
             task->fd_table[i] = handle;
             task->fd_flags[i] = 0;
@@ -488,11 +602,16 @@ thread_t* thread_create(task_t* task, void (*entry)(void*), void* arg)
     thread->reap_queued = 0;
     thread->reap_after_tick = 0;
     thread->arch_specific = NULL;
+    thread->preempt_count = 0;
+    memset(&thread->rt, 0, sizeof(thread->rt));
+    rusage_thread_init(thread);
+    irql_t old = task_registry_lock();
     task->thread_count++;
     TAILQ_INSERT_TAIL(&task->threads, thread, task_link);
     if (!task->main_thread) {
         task->main_thread = thread;
     }
+    task_registry_unlock(old);
 
     return thread;
 }
@@ -560,11 +679,16 @@ thread_t* thread_create_user_clone(task_t* task, const interrupt_frame_t* frame)
     thread->reap_queued = 0;
     thread->reap_after_tick = 0;
     thread->arch_specific = NULL;
+    thread->preempt_count = 0;
+    memset(&thread->rt, 0, sizeof(thread->rt));
+    rusage_thread_init(thread);
+    irql_t old = task_registry_lock();
     task->thread_count++;
     TAILQ_INSERT_TAIL(&task->threads, thread, task_link);
     if (!task->main_thread) {
         task->main_thread = thread;
     }
+    task_registry_unlock(old);
 
     return thread;
 }
@@ -575,10 +699,13 @@ void thread_destroy(thread_t* thread)
         return;
     }
     if (thread->task) {
+        rusage_thread_exit(thread);
+        irql_t old = task_registry_lock();
         TAILQ_REMOVE(&thread->task->threads, thread, task_link);
         if (thread->task->thread_count > 0) {
             thread->task->thread_count--;
         }
+        task_registry_unlock(old);
     }
     if (thread->stack) {
         task_kernel_stack_retire(thread->stack, thread->stack_size);
@@ -231,9 +231,7 @@ int tty_console_write(const void* buffer, size_t size)
     if (!s) {
         return -1;
     }
-    for (size_t i = 0; i < size; i++) {
-        kputc(s[i]);
-    }
+    console_write(s, size);
     return (int)size;
 }
 
@@ -5,6 +5,9 @@
 
 #include "waitq.h"
 #include "scheduler.h"
+#ifdef CONFIG_LOCKSTAT
+#include "../core/cpu.h"
+#endif
 #include "../../include/error.h"
 #include <stddef.h>
 
@@ -68,6 +71,9 @@ void waitq_init(waitq_t* q, const char* name)
     TAILQ_INIT(&q->threads);
     q->name = name;
     q->count = 0;
+#ifdef CONFIG_LOCKSTAT
+    q->cls = lock_class_get(name, LOCK_KIND_WAITQ, (uintptr_t)__builtin_return_address(0));
+#endif
 }
 
 bool waitq_contains(const waitq_t* q, const thread_t* t)
@@ -141,6 +147,9 @@ thread_t* waitq_wake_one(waitq_t* q)
     if (!t) {
         return NULL;
     }
+#ifdef CONFIG_LOCKSTAT
+    lockstat_woken(q->cls, 1);
+#endif
     scheduler_wake(t);
     return t;
 }
@@ -175,8 +184,10 @@ uint32_t waitq_timed_count(void)
     return count;
 }
 
-int waitq_wait_until(waitq_t* q, uint64_t deadline_ticks)
+/* ip: the waiter's call site, for wait statistics. */
+static int waitq_wait_common(waitq_t* q, uint64_t deadline_ticks, uintptr_t ip)
 {
+    (void)ip;
     if (!q) {
         return RDNX_E_INVALID;
     }
@@ -197,6 +208,9 @@ int waitq_wait_until(waitq_t* q, uint64_t deadline_ticks)
         waitq_arm_timeout(self, deadline_ticks);
     }
 
+#ifdef CONFIG_LOCKSTAT
+    uint64_t wait_start = cpu_get_time();
+#endif
     while (waitq_contains(q, self)) {
         scheduler_block();
         /* Trigger immediate dispatch to avoid spinning in current context. */
@@ -209,12 +223,21 @@ int waitq_wait_until(waitq_t* q, uint64_t deadline_ticks)
 
     int ret = self->wait_timed_out ? RDNX_E_TIMEOUT : RDNX_OK;
     self->wait_timed_out = 0;
+#ifdef CONFIG_LOCKSTAT
+    lockstat_waited(q->cls, ip, cpu_get_time() - wait_start, ret == RDNX_E_TIMEOUT);
+#endif
     return ret;
 }
 
+int waitq_wait_until(waitq_t* q, uint64_t deadline_ticks)
+{
+    return waitq_wait_common(q, deadline_ticks, (uintptr_t)__builtin_return_address(0));
+}
+
 int waitq_wait(waitq_t* q, uint64_t timeout_ms)
 {
-    return waitq_wait_until(q, waitq_deadline_from_timeout_ms(timeout_ms));
+    return waitq_wait_common(q, waitq_deadline_from_timeout_ms(timeout_ms),
+                             (uintptr_t)__builtin_return_address(0));
 }
 
 void waitq_tick(uint64_t now_ticks)
@@ -7,6 +7,7 @@
 #define _RODNIX_COMMON_WAITQ_H
 
 #include "../core/task.h"
+#include "lockstat.h"
 #include "../../include/bsd/sys/queue.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -17,6 +18,9 @@ typedef struct waitq {
     struct waitq_thread_head threads;
     const char* name;
     uint32_t count;
+#ifdef CONFIG_LOCKSTAT
+    struct lock_class* cls;   /* sleep/wakeup statistics, see lockstat.c */
+#endif
 } waitq_t;
 
 void waitq_init(waitq_t* q, const char* name);
@@ -203,4 +203,12 @@ uint64_t cpu_get_frequency(void);
  */
 uint64_t cpu_get_time(void);
 
+/**
+ * Аппаратный генератор случайных чисел (RDSEED/RDRAND или аналог)
+ * @param out Куда записать 64 случайных бита
+ * @param seed true — источник энтропии (RDSEED), false — DRBG (RDRAND)
+ * @return false, если инструкции нет или она не выдала значение
+ */
+bool cpu_get_random(uint64_t* out, bool seed);
+
 #endif /* _RODNIX_CORE_CPU_H */
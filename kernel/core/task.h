@@ -10,12 +10,14 @@
 
 #include "arch_types.h"
 #include "cpu.h"
+#include "../common/rcu.h"
 #include <bsd/sys/queue.h>
 #include <bsd/sys/tree.h>
 #include <stdint.h>
 #include <stdbool.h>
 
 struct interrupt_frame;
+struct cgroup;
 
 /* ============================================================================
  * Состояние задачи
@@ -73,6 +75,40 @@ enum {
     SCHED_CLASS_REALTIME  = 1,
 };
 
+/*
+ * Политика потока (номера как в POSIX/Linux). FIFO/RR/DEADLINE работают
+ * выше QoS-бакетов и получают SCHED_CLASS_REALTIME: без boost/penalty.
+ */
+enum {
+    SCHED_OTHER    = 0,
+    SCHED_FIFO     = 1,
+    SCHED_RR       = 2,
+    SCHED_DEADLINE = 6,
+};
+
+#define SCHED_RT_PRIO_MIN 1
+#define SCHED_RT_PRIO_MAX 99
+
+/* Состояние real-time классов потока (kernel/common/scheduler/rt.c). */
+typedef struct thread_rt {
+    uint8_t policy;            /* SCHED_OTHER / SCHED_FIFO / SCHED_RR / SCHED_DEADLINE */
+    uint8_t prio;              /* статический приоритет FIFO/RR: 1..99 */
+    uint8_t pi_prio;           /* унаследован через PI futex (0 — нет), 100 — от DEADLINE */
+    uint8_t rq_kind;           /* в какой очереди стоит поток (SCHED_RQ_*) */
+    uint8_t rq_level;          /* уровень/бакет этой очереди */
+    uint8_t requeue_tail;      /* sched_yield / конец кванта RR: в хвост очереди */
+    uint8_t dl_throttled;      /* DEADLINE: бюджет исчерпан до следующего периода */
+    uint16_t rr_ticks;         /* остаток кванта RR */
+    uint64_t dl_runtime;       /* DEADLINE: бюджет, нс */
+    uint64_t dl_deadline;      /* относительный дедлайн, нс */
+    uint64_t dl_period;        /* период, нс */
+    uint64_t dl_abs_deadline;  /* абсолютный дедлайн по часам планировщика, нс */
+    uint64_t dl_next_period;   /* начало следующего периода, нс */
+    int64_t dl_budget;         /* остаток бюджета текущего периода, нс */
+    uint64_t dl_misses;        /* периоды, закончившиеся после дедлайна */
+    void* pi_blocked_on;       /* PI futex, которого ждёт поток */
+} thread_rt_t;
+
 /* ============================================================================
  * QoS bucket (иерархический планировщик v1)
  * Значение = индекс в ready_queues[]; выше — приоритетнее.
@@ -96,6 +132,52 @@ typedef struct {
     uint64_t last_run_tick;  /* последний тик, когда группа получила CPU */
 } thread_group_t;
 
+/* ============================================================================
+ * Учёт ресурсов (getrusage) и лимиты (getrlimit/setrlimit)
+ * ============================================================================ */
+
+/*
+ * Счётчики потока. Время хранится в тактах TSC и переводится в нс только
+ * при чтении (kernel/common/rusage.c); у задачи — сумма живых потоков плюс
+ * ru_exited (уже завершённые потоки).
+ */
+typedef struct task_rusage {
+    uint64_t utime_cycles;   /* время в user mode, такты TSC */
+    uint64_t stime_cycles;   /* время в ядре (syscall, fault), такты TSC */
+    uint64_t minflt;         /* page fault без чтения файла (zero-fill, COW, resident) */
+    uint64_t majflt;         /* page fault с заполнением из файла */
+    uint64_t nvcsw;          /* добровольные переключения (block/sleep/exit) */
+    uint64_t nivcsw;         /* вытеснения по кванту */
+    uint64_t read_bytes;     /* байты, прочитанные read() */
+    uint64_t write_bytes;    /* байты, записанные write() */
+    uint64_t maxrss_pages;   /* пик RSS (для сумм — максимум, не сумма) */
+} task_rusage_t;
+
+/* Номера ресурсов — как во FreeBSD (userland sys/resource.h). */
+enum {
+    TASK_RLIMIT_CPU     = 0,  /* секунды CPU: soft -> SIGXCPU, hard -> SIGKILL */
+    TASK_RLIMIT_FSIZE   = 1,
+    TASK_RLIMIT_DATA    = 2,  /* brk + анонимные mmap, байты */
+    TASK_RLIMIT_STACK   = 3,
+    TASK_RLIMIT_CORE    = 4,
+    TASK_RLIMIT_RSS     = 5,
+    TASK_RLIMIT_MEMLOCK = 6,
+    TASK_RLIMIT_NPROC   = 7,  /* процессы на реальный UID (fork/spawn) */
+    TASK_RLIMIT_NOFILE  = 8,  /* номер дескриптора < лимита */
+    TASK_RLIMIT_SBSIZE  = 9,
+    TASK_RLIMIT_AS      = 10, /* всё отображённое адресное пространство, байты */
+    TASK_RLIMIT_COUNT   = 11,
+};
+
+#define TASK_RLIM_INFINITY 0x7fffffffffffffffULL
+
+typedef struct task_rlimit {
+    uint64_t cur;
+    uint64_t max;
+} task_rlimit_t;
+
+#define TASK_COMM_MAX 16
+
 /* ============================================================================
  * Задача (адресное пространство + ресурсы)
  * ============================================================================ */
@@ -157,9 +239,17 @@ typedef struct task {
     uint32_t thread_count;     /* Количество потоков задачи */
     uint32_t ref_count;        /* Счетчик ссылок */
     struct task* next_all;     /* Связный список всех задач */
-    RB_ENTRY(task) task_id_link; /* Узел task_id-индекса */
+    LIST_ENTRY(task) task_id_link; /* Цепочка RCU-хеша task_id (task_find_by_id) */
+    rcu_head_t rcu;            /* Отложенное освобождение после task_destroy */
     void* arch_specific;       /* Архитектурно-зависимые данные */
     thread_group_t thread_group; /* CPU-учёт группы для планировщика */
+    char comm[TASK_COMM_MAX];  /* имя образа (basename пути exec) */
+    task_rusage_t ru_exited;   /* счётчики завершённых потоков */
+    task_rusage_t ru_children; /* дети, забранные waitpid (RUSAGE_CHILDREN) */
+    task_rlimit_t rlimits[TASK_RLIMIT_COUNT];
+    uint64_t rlim_cpu_next;    /* следующая секунда CPU для SIGXCPU */
+    uint64_t maxrss_pages;     /* пик vm_map->resident_pages (переживает exec) */
+    struct cgroup* cgroup;     /* группа ресурсов (kernel/common/cgroup.c), держит ссылку */
 } task_t;
 
 /* ============================================================================
@@ -201,6 +291,10 @@ typedef struct thread {
     uint8_t reap_queued;       /* Флаг: поток поставлен в очередь reap */
     uint64_t reap_after_tick;  /* Тик, после которого можно освобождать стек */
     void* arch_specific;       /* Архитектурно-зависимые данные */
+    task_rusage_t ru;          /* Учёт ресурсов потока (RUSAGE_THREAD) */
+    uint64_t ru_stamp;         /* TSC начала ещё не учтённого интервала */
+    volatile uint32_t preempt_count; /* Запрет вытеснения и вложенность IRQ (preempt.h) */
+    thread_rt_t rt;            /* FIFO/RR/DEADLINE и PI (scheduler/rt.c) */
 } thread_t;
 
 /* ============================================================================
@@ -214,11 +308,24 @@ typedef struct thread {
 task_t* task_create(void);
 
 /**
- * Удаление задачи
+ * Удаление задачи: снимает её с реестра, освобождает потоки, fd и VM и
+ * отпускает ссылку создания. Сам task_t живёт, пока держат ссылки
+ * task_find_by_id.
  * @param task Указатель на задачу
  */
 void task_destroy(task_t* task);
 
+/**
+ * Взять ссылку на task_t (NULL допустим)
+ * @return task
+ */
+task_t* task_get(task_t* task);
+
+/**
+ * Отпустить ссылку; последняя освобождает task_t после grace period
+ */
+void task_put(task_t* task);
+
 /**
  * Получение текущей задачи
  * @return Указатель на текущую задачу
@@ -253,6 +360,28 @@ task_abi_t task_get_abi(const task_t* task);
  */
 int task_fd_alloc(task_t* task, void* handle);
 
+/**
+ * Effective descriptor table size: min(RLIMIT_NOFILE soft limit, TASK_MAX_FD)
+ */
+int task_fd_limit(const task_t* task);
+
+/**
+ * Count live (not DEAD) tasks owned by a real UID (RLIMIT_NPROC)
+ */
+uint32_t task_count_by_uid(uint32_t uid);
+
+/**
+ * Call fn for every registered task with the registry lock (IRQL_HIGH) held
+ * @return number of tasks visited
+ */
+typedef void (*task_iter_fn_t)(task_t* task, void* ctx);
+uint32_t task_foreach(task_iter_fn_t fn, void* ctx);
+
+/**
+ * Set task->comm from the basename of an executable path
+ */
+void task_set_comm(task_t* task, const char* path);
+
 /**
  * Get handle by fd
  * @return handle or NULL
@@ -288,11 +417,25 @@ uint32_t task_get_thread_count(const task_t* task);
 
 /**
  * Find task by task_id.
+ * The task is returned with a reference taken inside the RCU read section;
+ * drop it with task_put(). The reference keeps the task_t alive, not the
+ * task: it may already be a zombie or torn down by task_destroy, so check
+ * state before using threads, fds or VM.
  * @param task_id Numeric task id
- * @return Pointer to task or NULL
+ * @return Referenced task or NULL
  */
 task_t* task_find_by_id(uint64_t task_id);
 
+/**
+ * Find thread by thread_id (the TID of gettid and PI futex words).
+ * On success *ref holds a reference to the owning task (drop with
+ * task_put()); the thread stays valid while it is on the task's list.
+ * @param thread_id Numeric thread id
+ * @param ref Out: referenced owning task or NULL
+ * @return Thread or NULL
+ */
+thread_t* thread_find_by_id(uint64_t thread_id, task_t** ref);
+
 typedef struct {
     uint32_t cache_count;
     uint32_t cache_capacity;
@@ -10,6 +10,8 @@
 #include "../fabric.h"
 #include "../device/device.h"
 #include "../../include/console.h"
+#include "../../arch/paging.h"
+#include "../../../include/error.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -33,6 +35,18 @@ static uint32_t pci_read_config(uint8_t bus, uint8_t device, uint8_t function, u
     return value;
 }
 
+static void pci_write_config(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset, uint32_t value)
+{
+    uint32_t address = (1UL << 31) |
+                       ((uint32_t)bus << 16) |
+                       ((uint32_t)device << 11) |
+                       ((uint32_t)function << 8) |
+                       (offset & 0xFC);
+
+    __asm__ volatile ("outl %%eax, %0" : : "Nd"((uint16_t)PCI_CONFIG_ADDRESS), "a"(address));
+    __asm__ volatile ("outl %%eax, %0" : : "Nd"((uint16_t)PCI_CONFIG_DATA), "a"(value));
+}
+
 static uint16_t pci_read_config16(uint8_t bus, uint8_t device, uint8_t function, uint8_t offset)
 {
     uint32_t v = pci_read_config(bus, device, function, (uint8_t)(offset & 0xFCu));
@@ -161,3 +175,230 @@ void pci_bus_init(void)
 {
     fabric_bus_register(&pci_bus);
 }
+
+/* ============================================================================
+ * Driver helpers: config access, BARs, MMIO and MSI-X
+ * ============================================================================ */
+
+#define PCI_COMMAND_MEMORY     0x0002u
+#define PCI_COMMAND_MASTER     0x0004u
+#define PCI_COMMAND_INTX_OFF   0x0400u
+#define PCI_STATUS_CAP_LIST    0x0010u
+#define PCI_CAP_PTR            0x34u
+
+#define PCI_MSI_CTRL_ENABLE    0x0001u
+#define PCI_MSI_CTRL_MME       0x0070u
+#define PCI_MSI_CTRL_64BIT     0x0080u
+
+#define PCI_MSIX_CTRL_ENABLE   0x8000u
+#define PCI_MSIX_CTRL_FMASK    0x4000u
+#define PCI_MSIX_CTRL_SIZE     0x07FFu
+#define PCI_MSIX_ENTRY_MASKED  0x1u
+
+static const pci_device_info_t* pci_info_of(const fabric_device_t* dev)
+{
+    return dev ? (const pci_device_info_t*)dev->bus_private : NULL;
+}
+
+uint32_t pci_config_read32(const fabric_device_t* dev, uint8_t offset)
+{
+    const pci_device_info_t* info = pci_info_of(dev);
+    if (!info) {
+        return 0xFFFFFFFFu;
+    }
+    return pci_read_config(info->bus, info->device, info->function, offset);
+}
+
+void pci_config_write32(const fabric_device_t* dev, uint8_t offset, uint32_t value)
+{
+    const pci_device_info_t* info = pci_info_of(dev);
+    if (!info) {
+        return;
+    }
+    pci_write_config(info->bus, info->device, info->function, offset, value);
+}
+
+uint8_t pci_find_capability(const fabric_device_t* dev, uint8_t cap_id)
+{
+    return pci_find_next_capability(dev, 0, cap_id);
+}
+
+uint8_t pci_find_next_capability(const fabric_device_t* dev, uint8_t after, uint8_t cap_id)
+{
+    const pci_device_info_t* info = pci_info_of(dev);
+    if (!info) {
+        return 0;
+    }
+    uint16_t status = pci_read_config16(info->bus, info->device, info->function, 0x06u);
+    if (!(status & PCI_STATUS_CAP_LIST)) {
+        return 0;
+    }
+    uint8_t off = (after != 0)
+        ? (uint8_t)(pci_read_config8(info->bus, info->device, info->function, (uint8_t)(after + 1u)) & 0xFCu)
+        : (uint8_t)(pci_read_config8(info->bus, info->device, info->function, PCI_CAP_PTR) & 0xFCu);
+    /* 48 hops bound a malformed (looping) list. */
+    for (uint32_t i = 0; i < 48u && off >= 0x40u; i++) {
+        uint8_t id = pci_read_config8(info->bus, info->device, info->function, off);
+        if (id == cap_id) {
+            return off;
+        }
+        off = (uint8_t)(pci_read_config8(info->bus, info->device, info->function, (uint8_t)(off + 1u)) & 0xFCu);
+    }
+    return 0;
+}
+
+uint64_t pci_bar_address(const fabric_device_t* dev, uint32_t bar)
+{
+    const pci_device_info_t* info = pci_info_of(dev);
+    if (!info || bar >= PCI_BAR_COUNT) {
+        return 0;
+    }
+    uint32_t lo = info->bars[bar];
+    if (lo & 0x1u) {
+        return 0;
+    }
+    uint64_t addr = (uint64_t)(lo & ~0xFu);
+    if (((lo >> 1) & 0x3u) == 0x2u && bar + 1u < PCI_BAR_COUNT) {
+        addr |= (uint64_t)info->bars[bar + 1u] << 32;
+    }
+    return addr;
+}
+
+void* pci_map_mmio(uint64_t phys, uint64_t size)
+{
+    if (phys == 0 || size == 0) {
+        return NULL;
+    }
+    uint64_t first = phys & ~0xFFFULL;
+    uint64_t last = (phys + size + 0xFFFULL) & ~0xFFFULL;
+    const uint64_t flags = (uint64_t)(PTE_PRESENT | PTE_RW | PTE_PCD | PTE_PWT);
+    for (uint64_t p = first; p < last; p += 0x1000u) {
+        if (paging_map_page_4kb(PCI_MMIO_VIRT_BASE + (p & PCI_MMIO_VIRT_MASK), p, flags) != 0) {
+            return NULL;
+        }
+    }
+    return (void*)(uintptr_t)(PCI_MMIO_VIRT_BASE + (phys & PCI_MMIO_VIRT_MASK));
+}
+
+void pci_enable_bus_master(const fabric_device_t* dev)
+{
+    uint32_t reg = pci_config_read32(dev, 0x04u);
+    /* Keep the upper (status) half zero: its bits are write-one-to-clear. */
+    uint16_t cmd = (uint16_t)(reg & 0xFFFFu);
+    cmd |= PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER | PCI_COMMAND_INTX_OFF;
+    pci_config_write32(dev, 0x04u, cmd);
+}
+
+int pci_msi_enable(const fabric_device_t* dev, uint64_t addr, uint32_t data)
+{
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSI);
+    if (cap == 0) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    uint32_t reg = pci_config_read32(dev, cap);
+    uint16_t ctrl = (uint16_t)(reg >> 16);
+    pci_config_write32(dev, cap, reg & ~((uint32_t)PCI_MSI_CTRL_ENABLE << 16));
+    pci_config_write32(dev, (uint8_t)(cap + 4u), (uint32_t)addr);
+    if (ctrl & PCI_MSI_CTRL_64BIT) {
+        pci_config_write32(dev, (uint8_t)(cap + 8u), (uint32_t)(addr >> 32));
+        pci_config_write32(dev, (uint8_t)(cap + 12u), data & 0xFFFFu);
+    } else if ((addr >> 32) != 0) {
+        return RDNX_E_UNSUPPORTED;
+    } else {
+        pci_config_write32(dev, (uint8_t)(cap + 8u), data & 0xFFFFu);
+    }
+    /* One message (MME = 0), then enable. */
+    ctrl = (uint16_t)((ctrl & ~PCI_MSI_CTRL_MME) | PCI_MSI_CTRL_ENABLE);
+    pci_config_write32(dev, cap, (reg & 0xFFFFu) | ((uint32_t)ctrl << 16));
+    return RDNX_OK;
+}
+
+void pci_msi_disable(const fabric_device_t* dev)
+{
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSI);
+    if (cap == 0) {
+        return;
+    }
+    uint32_t reg = pci_config_read32(dev, cap);
+    pci_config_write32(dev, cap, reg & ~((uint32_t)PCI_MSI_CTRL_ENABLE << 16));
+}
+
+static uint16_t pci_msix_ctrl(const fabric_device_t* dev, uint8_t cap)
+{
+    return (uint16_t)(pci_config_read32(dev, cap) >> 16);
+}
+
+static void pci_msix_set_ctrl(const fabric_device_t* dev, uint8_t cap, uint16_t ctrl)
+{
+    uint32_t reg = pci_config_read32(dev, cap);
+    pci_config_write32(dev, cap, (reg & 0xFFFFu) | ((uint32_t)ctrl << 16));
+}
+
+int pci_msix_enable(const fabric_device_t* dev, pci_msix_t* out)
+{
+    if (!dev || !out) {
+        return RDNX_E_INVALID;
+    }
+    uint8_t cap = pci_find_capability(dev, PCI_CAP_ID_MSIX);
+    if (cap == 0) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    uint16_t ctrl = pci_msix_ctrl(dev, cap);
+    uint16_t entries = (uint16_t)((ctrl & PCI_MSIX_CTRL_SIZE) + 1u);
+    uint32_t loc = pci_config_read32(dev, (uint8_t)(cap + 4u));
+    uint64_t bar = pci_bar_address(dev, loc & 0x7u);
+    if (bar == 0) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    volatile uint32_t* table = (volatile uint32_t*)pci_map_mmio(bar + (loc & ~0x7u), (uint64_t)entries * 16u);
+    if (!table) {
+        return RDNX_E_GENERIC;
+    }
+    /* Enable under the function mask, mask every entry, then lift the function mask. */
+    pci_msix_set_ctrl(dev, cap, (uint16_t)(ctrl | PCI_MSIX_CTRL_ENABLE | PCI_MSIX_CTRL_FMASK));
+    for (uint16_t i = 0; i < entries; i++) {
+        table[i * 4u + 3u] = PCI_MSIX_ENTRY_MASKED;
+    }
+    pci_msix_set_ctrl(dev, cap, (uint16_t)((ctrl | PCI_MSIX_CTRL_ENABLE) & ~PCI_MSIX_CTRL_FMASK));
+    out->table = table;
+    out->entries = entries;
+    out->cap = cap;
+    return RDNX_OK;
+}
+
+int pci_msix_set_entry(pci_msix_t* msix, uint16_t entry, uint64_t addr, uint32_t data)
+{
+    if (!msix || !msix->table || entry >= msix->entries) {
+        return RDNX_E_INVALID;
+    }
+    volatile uint32_t* e = &msix->table[entry * 4u];
+    e[3] = PCI_MSIX_ENTRY_MASKED;
+    e[0] = (uint32_t)addr;
+    e[1] = (uint32_t)(addr >> 32);
+    e[2] = data;
+    e[3] = 0;
+    return RDNX_OK;
+}
+
+void pci_msix_mask_entry(pci_msix_t* msix, uint16_t entry, bool masked)
+{
+    if (!msix || !msix->table || entry >= msix->entries) {
+        return;
+    }
+    msix->table[entry * 4u + 3u] = masked ? PCI_MSIX_ENTRY_MASKED : 0u;
+}
+
+void pci_msix_disable(const fabric_device_t* dev, pci_msix_t* msix)
+{
+    if (!dev || !msix || msix->cap == 0) {
+        return;
+    }
+    uint16_t ctrl = pci_msix_ctrl(dev, msix->cap);
+    pci_msix_set_ctrl(dev, msix->cap, (uint16_t)(ctrl & ~PCI_MSIX_CTRL_ENABLE));
+    msix->table = NULL;
+    msix->entries = 0;
+    msix->cap = 0;
+}
@@ -6,10 +6,20 @@
 #ifndef _RODNIX_FABRIC_BUS_PCI_H
 #define _RODNIX_FABRIC_BUS_PCI_H
 
+#include <stdbool.h>
 #include <stdint.h>
+#include "../device/device.h"
 
 #define PCI_BAR_COUNT 6u
 
+#define PCI_CAP_ID_MSI  0x05u
+#define PCI_CAP_ID_VNDR 0x09u
+#define PCI_CAP_ID_MSIX 0x11u
+
+/* Device MMIO is mapped uncached at PCI_MMIO_VIRT_BASE + (phys & PCI_MMIO_VIRT_MASK). */
+#define PCI_MMIO_VIRT_BASE 0xFFFFFFFFC0000000ULL
+#define PCI_MMIO_VIRT_MASK 0x3FFFFFFFULL
+
 typedef struct pci_device_info {
     uint8_t bus;
     uint8_t device;
@@ -21,6 +31,35 @@ typedef struct pci_device_info {
     uint32_t bars[PCI_BAR_COUNT];
 } pci_device_info_t;
 
+/* MSI-X table of one function; 16-byte entries: addr lo, addr hi, data, control. */
+typedef struct pci_msix {
+    volatile uint32_t* table;
+    uint16_t entries;
+    uint8_t cap;
+} pci_msix_t;
+
 void pci_bus_init(void);
 
+uint32_t pci_config_read32(const fabric_device_t* dev, uint8_t offset);
+void pci_config_write32(const fabric_device_t* dev, uint8_t offset, uint32_t value);
+/* Config-space offset of capability cap_id, 0 when absent. */
+uint8_t pci_find_capability(const fabric_device_t* dev, uint8_t cap_id);
+/* Next cap_id after offset after (0 = from the start), for repeated capabilities. */
+uint8_t pci_find_next_capability(const fabric_device_t* dev, uint8_t after, uint8_t cap_id);
+/* Memory BAR base (64-bit BARs take the next slot too), 0 for I/O or empty BARs. */
+uint64_t pci_bar_address(const fabric_device_t* dev, uint32_t bar);
+void* pci_map_mmio(uint64_t phys, uint64_t size);
+/* Memory decoding and bus mastering on, legacy INTx off. */
+void pci_enable_bus_master(const fabric_device_t* dev);
+
+/* Single-message MSI: program addr/data and enable. */
+int pci_msi_enable(const fabric_device_t* dev, uint64_t addr, uint32_t data);
+void pci_msi_disable(const fabric_device_t* dev);
+
+/* Enable MSI-X with every entry masked; entries are armed one by one. */
+int pci_msix_enable(const fabric_device_t* dev, pci_msix_t* out);
+int pci_msix_set_entry(pci_msix_t* msix, uint16_t entry, uint64_t addr, uint32_t data);
+void pci_msix_mask_entry(pci_msix_t* msix, uint16_t entry, bool masked);
+void pci_msix_disable(const fabric_device_t* dev, pci_msix_t* msix);
+
 #endif /* _RODNIX_FABRIC_BUS_PCI_H */
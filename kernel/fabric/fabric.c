@@ -8,6 +8,7 @@
 
 #include "fabric.h"
 #include "spin.h"
+#include "../common/rculist.h"
 #include "bus/bus.h"
 #include "bus/pci.h"
 #include "device/device.h"
@@ -26,6 +27,7 @@
 #define MAX_DEVICES  256
 #define MAX_SERVICES 64
 #define MAX_NODES    512
+#define NODE_HASH_BUCKETS 64   /* power of two */
 #define MAX_EVENT_LISTENERS 16
 #define MAX_EVENT_QUEUE 128
 
@@ -49,9 +51,18 @@ typedef struct fabric_node_entry {
     uint32_t flags;
     void* provider;
     int32_t parent_index;
+    LIST_ENTRY(fabric_node_entry) hash_link;   /* node_hash[] chain, by path */
 } fabric_node_entry_t;
 
+/*
+ * Nodes are never freed once added and their path never changes, so path
+ * lookups walk node_hash[] under rcu_read_lock() alone; insertion happens
+ * under fabric_lock and publishes a fully built entry. Fields other than
+ * the path (state, name, driver...) are still read and written under
+ * fabric_lock.
+ */
 static fabric_node_entry_t node_registry[MAX_NODES];
+static LIST_HEAD(fabric_node_hash_head, fabric_node_entry) node_hash[NODE_HASH_BUCKETS];
 static uint32_t node_count = 0;
 static uint64_t next_node_id = 1;
 
@@ -158,14 +169,16 @@ static const char* fabric_state_name(uint32_t state)
     }
 }
 
-static int32_t fabric_node_find_path_locked(const char* path)
+/* Caller holds fabric_lock or is inside rcu_read_lock(). */
+static int32_t fabric_node_find_path(const char* path)
 {
     if (!path) {
         return -1;
     }
-    for (uint32_t i = 0; i < MAX_NODES; i++) {
-        if (node_registry[i].used && strcmp(node_registry[i].path, path) == 0) {
-            return (int32_t)i;
+    fabric_node_entry_t* it;
+    LIST_FOREACH_RCU(it, &node_hash[rcu_hash_str(path) & (NODE_HASH_BUCKETS - 1)], hash_link) {
+        if (strcmp(it->path, path) == 0) {
+            return (int32_t)(it - node_registry);
         }
     }
     return -1;
@@ -194,7 +207,7 @@ static int32_t fabric_node_add_locked(const char* path,
                                       uint32_t flags,
                                       const char* provider_path)
 {
-    int32_t existing = fabric_node_find_path_locked(path);
+    int32_t existing = fabric_node_find_path(path);
     if (existing >= 0) {
         if (name && name[0]) {
             f_strcpy(node_registry[existing].name, FABRIC_NODE_NAME_MAX, name);
@@ -231,6 +244,8 @@ static int32_t fabric_node_add_locked(const char* path,
             node_registry[i].flags = flags;
             node_registry[i].provider = provider;
             node_registry[i].parent_index = parent_index;
+            LIST_INSERT_HEAD_RCU(&node_hash[rcu_hash_str(node_registry[i].path) & (NODE_HASH_BUCKETS - 1)],
+                                 &node_registry[i], hash_link);
             node_count++;
             return (int32_t)i;
         }
@@ -402,6 +417,9 @@ void fabric_init(void)
     for (uint32_t i = 0; i < MAX_NODES; i++) {
         node_registry[i].used = false;
     }
+    for (uint32_t i = 0; i < NODE_HASH_BUCKETS; i++) {
+        LIST_INIT(&node_hash[i]);
+    }
     for (uint32_t i = 0; i < MAX_IRQ_HANDLERS; i++) {
         irq_handlers[i].active = false;
     }
@@ -556,12 +574,18 @@ int fabric_node_set_state(const char* path, uint32_t state)
         return RDNX_E_INVALID;
     }
     bool changed = false;
-    spinlock_lock(&fabric_lock);
-    int32_t node_idx = fabric_node_find_path_locked(path);
+    /* Services re-announce their state often: settle the no-op case without the lock. */
+    rcu_read_lock();
+    int32_t node_idx = fabric_node_find_path(path);
+    bool same = node_idx >= 0 && node_registry[node_idx].state == state;
+    rcu_read_unlock();
     if (node_idx < 0) {
-        spinlock_unlock(&fabric_lock);
         return RDNX_E_NOTFOUND;
     }
+    if (same) {
+        return RDNX_OK;
+    }
+    spinlock_lock(&fabric_lock);
     if (node_registry[node_idx].state != state) {
         node_registry[node_idx].state = state;
         changed = true;
@@ -741,7 +765,7 @@ int fabric_device_publish(fabric_device_t *device)
     char path[FABRIC_NODE_PATH_MAX];
     const char* class_name = "device";
     const char* label = fabric_device_label(device);
-    int32_t parent_idx = fabric_node_find_path_locked("/fabric/devices/unknown");
+    int32_t parent_idx = fabric_node_find_path("/fabric/devices/unknown");
     f_strcpy(path, sizeof(path), "/fabric/devices/unknown/dev");
     char idx_tail[5];
     idx_tail[0] = f_hex_digit((uint8_t)((dev_index >> 4) & 0x0F));
@@ -753,15 +777,15 @@ int fabric_device_publish(fabric_device_t *device)
         const pci_device_info_t* pci = (const pci_device_info_t*)device->bus_private;
         fabric_build_pci_path(path, sizeof(path), pci);
         class_name = "pci";
-        parent_idx = fabric_node_find_path_locked("/fabric/devices/pci0");
+        parent_idx = fabric_node_find_path("/fabric/devices/pci0");
     } else if (f_starts_with(device->name, "ps2-")) {
         f_strcpy(path, sizeof(path), "/fabric/devices/platform/ps2kbd0");
         class_name = "input";
-        parent_idx = fabric_node_find_path_locked("/fabric/devices/platform");
+        parent_idx = fabric_node_find_path("/fabric/devices/platform");
     } else if (f_starts_with(device->name, "virt-")) {
         f_strcpy(path, sizeof(path), "/fabric/devices/virtual/dummy0");
         class_name = "virtual";
-        parent_idx = fabric_node_find_path_locked("/fabric/devices/virtual");
+        parent_idx = fabric_node_find_path("/fabric/devices/virtual");
     }
 
     int32_t node_idx = fabric_node_add_locked(path,
@@ -866,20 +890,20 @@ int fabric_service_publish(fabric_service_t *service)
     const char* node_class = "service";
     if (strcmp(service->name, "net.ifmgr") == 0) {
         f_strcpy(path, sizeof(path), "/fabric/subsystems/net/ifmgr");
-        parent_idx = fabric_node_find_path_locked("/fabric/subsystems/net");
+        parent_idx = fabric_node_find_path("/fabric/subsystems/net");
         node_type = "manager";
         node_class = "net";
         node_flags = 0x2u; /* internal */
     } else if (strcmp(service->name, "storage.blkmgr") == 0) {
         f_strcpy(path, sizeof(path), "/fabric/subsystems/storage/blkmgr");
-        parent_idx = fabric_node_find_path_locked("/fabric/subsystems/storage");
+        parent_idx = fabric_node_find_path("/fabric/subsystems/storage");
         node_type = "manager";
         node_class = "storage";
         node_flags = 0x2u; /* internal */
     } else {
         f_strcpy(path, sizeof(path), "/fabric/services/");
         f_append(path, sizeof(path), service->name);
-        parent_idx = fabric_node_find_path_locked("/fabric/services");
+        parent_idx = fabric_node_find_path("/fabric/services");
     }
     (void)fabric_node_add_locked(path,
                                  service->name,
@@ -954,8 +978,8 @@ int fabric_publish_service_node(const char* service_name, const char* kind, fabr
     provider_path[0] = '\0';
 
     spinlock_lock(&fabric_lock);
-    bool existed = (fabric_node_find_path_locked(path) >= 0);
-    int32_t parent_idx = fabric_node_find_path_locked("/fabric/services");
+    bool existed = (fabric_node_find_path(path) >= 0);
+    int32_t parent_idx = fabric_node_find_path("/fabric/services");
     int32_t provider_idx = fabric_node_find_provider_locked(provider_dev);
     if (provider_idx >= 0) {
         f_strcpy(provider_path, sizeof(provider_path), node_registry[provider_idx].path);
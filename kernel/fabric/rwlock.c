@@ -0,0 +1,203 @@
+/**
+ * @file rwlock.c
+ * @brief Reader-writer spinlocks and sequence locks for Fabric
+ */
+
+#include "rwlock.h"
+#include "../common/preempt.h"
+#include <stddef.h>
+
+void rwlock_init(rwlock_t* lock)
+{
+    if (!lock) {
+        return;
+    }
+    lock->state = 0;
+    lock->writers_waiting = 0;
+    __asm__ volatile ("" ::: "memory");
+}
+
+/* Lock-word operations; the public functions add the preempt count. */
+static bool rwlock_read_try(rwlock_t* lock)
+{
+    if (__atomic_load_n(&lock->writers_waiting, __ATOMIC_RELAXED) != 0) {
+        return false;
+    }
+    uint32_t old = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+    if (old & RWLOCK_WRITER) {
+        return false;
+    }
+    return __atomic_compare_exchange_n(&lock->state, &old, old + 1u, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static bool rwlock_write_try(rwlock_t* lock)
+{
+    uint32_t expected = 0;
+    return __atomic_compare_exchange_n(&lock->state, &expected, RWLOCK_WRITER, false,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+bool rwlock_read_trylock(rwlock_t* lock)
+{
+    if (!lock) {
+        return false;
+    }
+    preempt_disable_at((uintptr_t)__builtin_return_address(0));
+    if (!rwlock_read_try(lock)) {
+        preempt_enable_no_resched();
+        return false;
+    }
+    return true;
+}
+
+void rwlock_read_lock(rwlock_t* lock)
+{
+    if (!lock) {
+        return;
+    }
+    preempt_disable_at((uintptr_t)__builtin_return_address(0));
+    while (!rwlock_read_try(lock)) {
+        __asm__ volatile ("pause");
+    }
+}
+
+static inline void rwlock_read_release(rwlock_t* lock)
+{
+    __atomic_fetch_sub(&lock->state, 1u, __ATOMIC_RELEASE);
+}
+
+void rwlock_read_unlock(rwlock_t* lock)
+{
+    if (!lock) {
+        return;
+    }
+    rwlock_read_release(lock);
+    preempt_enable();
+}
+
+bool rwlock_write_trylock(rwlock_t* lock)
+{
+    if (!lock) {
+        return false;
+    }
+    preempt_disable_at((uintptr_t)__builtin_return_address(0));
+    if (!rwlock_write_try(lock)) {
+        preempt_enable_no_resched();
+        return false;
+    }
+    return true;
+}
+
+void rwlock_write_lock(rwlock_t* lock)
+{
+    if (!lock) {
+        return;
+    }
+    preempt_disable_at((uintptr_t)__builtin_return_address(0));
+    if (rwlock_write_try(lock)) {
+        return;
+    }
+    /* Announce ourselves so new readers hold off while the current ones drain. */
+    __atomic_fetch_add(&lock->writers_waiting, 1u, __ATOMIC_RELAXED);
+    while (!rwlock_write_try(lock)) {
+        __asm__ volatile ("pause");
+    }
+    __atomic_fetch_sub(&lock->writers_waiting, 1u, __ATOMIC_RELAXED);
+}
+
+static inline void rwlock_write_release(rwlock_t* lock)
+{
+    __atomic_store_n(&lock->state, 0u, __ATOMIC_RELEASE);
+}
+
+void rwlock_write_unlock(rwlock_t* lock)
+{
+    if (!lock) {
+        return;
+    }
+    rwlock_write_release(lock);
+    preempt_enable();
+}
+
+irql_t rwlock_read_lock_irqsave(rwlock_t* lock)
+{
+    irql_t old = set_irql(IRQL_HIGH);
+    rwlock_read_lock(lock);
+    return old;
+}
+
+void rwlock_read_unlock_irqrestore(rwlock_t* lock, irql_t old)
+{
+    if (lock) {
+        rwlock_read_release(lock);
+    }
+    (void)set_irql(old);
+    if (lock) {
+        preempt_enable();
+    }
+}
+
+irql_t rwlock_write_lock_irqsave(rwlock_t* lock)
+{
+    irql_t old = set_irql(IRQL_HIGH);
+    rwlock_write_lock(lock);
+    return old;
+}
+
+void rwlock_write_unlock_irqrestore(rwlock_t* lock, irql_t old)
+{
+    if (lock) {
+        rwlock_write_release(lock);
+    }
+    (void)set_irql(old);
+    if (lock) {
+        preempt_enable();
+    }
+}
+
+void seqlock_init(seqlock_t* sl)
+{
+    if (!sl) {
+        return;
+    }
+    sl->seq = 0;
+    spinlock_init(&sl->lock);
+}
+
+void seqlock_write_begin(seqlock_t* sl)
+{
+    if (!sl) {
+        return;
+    }
+    spinlock_lock(&sl->lock);
+    __atomic_store_n(&sl->seq, sl->seq + 1u, __ATOMIC_RELAXED);
+    /* Readers must see the odd sequence before any of the data stores. */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void seqlock_write_end(seqlock_t* sl)
+{
+    if (!sl) {
+        return;
+    }
+    __atomic_store_n(&sl->seq, sl->seq + 1u, __ATOMIC_RELEASE);
+    spinlock_unlock(&sl->lock);
+}
+
+irql_t seqlock_write_begin_irqsave(seqlock_t* sl)
+{
+    irql_t old = set_irql(IRQL_HIGH);
+    seqlock_write_begin(sl);
+    return old;
+}
+
+void seqlock_write_end_irqrestore(seqlock_t* sl, irql_t old)
+{
+    if (!sl) {
+        (void)set_irql(old);
+        return;
+    }
+    __atomic_store_n(&sl->seq, sl->seq + 1u, __ATOMIC_RELEASE);
+    spinlock_unlock_irqrestore(&sl->lock, old);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file rwlock.h
+ * @brief Reader-writer spinlocks and sequence locks for Fabric
+ *
+ * rwlock_t lets any number of readers in at once and prefers writers: once
+ * a writer is waiting, new readers back off until it is through, so a
+ * steady stream of readers cannot starve it. Read locks do not nest: a
+ * reader that re-takes the lock while a writer waits deadlocks.
+ *
+ * seqlock_t is for small, frequently read and rarely written data (clock
+ * pairs, counters): readers take no lock at all, they sample the sequence
+ * number, copy the data and retry if a writer ran in between. Writers are
+ * serialized by a ticket spinlock. Read sections must only copy -- they can
+ * observe a half-written state before the retry check rejects it.
+ *
+ * As with spinlock_t, holding either lock disables preemption, and the
+ * _irqsave variants raise IRQL to IRQL_HIGH and are required for data also
+ * touched from interrupt context.
+ */
+
+#ifndef _RODNIX_FABRIC_RWLOCK_H
+#define _RODNIX_FABRIC_RWLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "spin.h"
+
+#define RWLOCK_WRITER 0x80000000u   /* in rwlock_t.state; low bits count readers */
+
+typedef struct {
+    volatile uint32_t state;
+    volatile uint32_t writers_waiting;
+} rwlock_t;
+
+void rwlock_init(rwlock_t* lock);
+void rwlock_read_lock(rwlock_t* lock);
+void rwlock_read_unlock(rwlock_t* lock);
+bool rwlock_read_trylock(rwlock_t* lock);
+void rwlock_write_lock(rwlock_t* lock);
+void rwlock_write_unlock(rwlock_t* lock);
+bool rwlock_write_trylock(rwlock_t* lock);
+irql_t rwlock_read_lock_irqsave(rwlock_t* lock);
+void rwlock_read_unlock_irqrestore(rwlock_t* lock, irql_t old);
+irql_t rwlock_write_lock_irqsave(rwlock_t* lock);
+void rwlock_write_unlock_irqrestore(rwlock_t* lock, irql_t old);
+
+typedef struct {
+    volatile uint32_t seq;   /* odd while a writer is inside */
+    spinlock_t lock;
+} seqlock_t;
+
+void seqlock_init(seqlock_t* sl);
+void seqlock_write_begin(seqlock_t* sl);
+void seqlock_write_end(seqlock_t* sl);
+irql_t seqlock_write_begin_irqsave(seqlock_t* sl);
+void seqlock_write_end_irqrestore(seqlock_t* sl, irql_t old);
+
+/* Wait out a writer in progress and return the sequence to validate against. */
+static inline uint32_t seqlock_read_begin(const seqlock_t* sl)
+{
+    uint32_t seq;
+    while ((seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE)) & 1u) {
+        __asm__ volatile ("pause");
+    }
+    return seq;
+}
+
+/* True when a writer ran since seqlock_read_begin(): discard the copy and retry. */
+static inline bool seqlock_read_retry(const seqlock_t* sl, uint32_t start)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&sl->seq, __ATOMIC_RELAXED) != start;
+}
+
+#endif /* _RODNIX_FABRIC_RWLOCK_H */
@@ -0,0 +1,436 @@
+/**
+ * @file block_part.c
+ * @brief MBR/GPT partition tables and per-partition block devices
+ *
+ * When a whole disk registers, its partition table is read. Each partition
+ * becomes a child block device named <disk><N>, or <disk>p<N> when the disk
+ * name ends in a digit (disk0p1, nvme0n1p2). It is registered in the block
+ * registry and /dev and published as a fabric service node of kind
+ * "partition".
+ *
+ * A child's ops add the partition's start LBA and call the disk's driver
+ * directly on the caller's buffer, so partition I/O costs no extra copy.
+ * Bounds are checked against the child's length by fabric_blockdev_read/
+ * write before the ops run.
+ *
+ * Supported tables:
+ * - MBR primaries, plus logical partitions in an extended partition's EBR
+ *   chain (numbered from 5);
+ * - GPT behind a protective MBR. The primary header is used; the backup at
+ *   the last LBA is used when the primary fails its CRC.
+ *
+ * A rescan unregisters the old children first. It is refused while any of
+ * them is open or mounted.
+ */
+
+#include "block_part.h"
+#include "../fabric.h"
+#include "../spin.h"
+#include "../../common/heap.h"
+#include "../../common/mutex.h"
+#include "../../../include/common.h"
+#include "../../../include/error.h"
+#include <stdbool.h>
+
+#define PART_MBR_TABLE      446u
+#define PART_MBR_SIG        510u
+#define PART_MBR_ENTRY_SIZE 16u
+#define PART_TYPE_GPT_PROT  0xEEu
+#define PART_EBR_MAX        64u     /* links followed in an extended partition */
+
+#define GPT_HDR_MIN_SIZE    92u
+#define GPT_ENTRY_MIN_SIZE  128u
+#define GPT_ENTRIES_MAX_BYTES (64u * 1024u)
+
+typedef struct fabric_part {
+    fabric_blockdev_t blockdev;
+    fabric_blockdev_t* disk;
+    uint64_t start_lba;
+    uint32_t number;
+    char name[16];
+    struct fabric_part* next;
+} fabric_part_t;
+
+typedef struct part_scan {
+    fabric_blockdev_t* disk;
+    uint8_t* sector;        /* one disk sector of scratch */
+    uint32_t found;
+} part_scan_t;
+
+static mutex_t g_part_mutex;        /* serialises rescans */
+static spinlock_t g_part_lock;      /* protects g_parts */
+static fabric_part_t* g_parts = NULL;
+
+static int part_read(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, void* out)
+{
+    fabric_part_t* p = (fabric_part_t*)dev->context;
+    fabric_blockdev_t* disk = p->disk;
+    return disk->ops->read_sectors(disk, p->start_lba + lba, count, out);
+}
+
+static int part_write(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, const void* in)
+{
+    fabric_part_t* p = (fabric_part_t*)dev->context;
+    fabric_blockdev_t* disk = p->disk;
+    if (!disk->ops->write_sectors) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    int rc = disk->ops->write_sectors(disk, p->start_lba + lba, count, in);
+    if (rc == RDNX_OK) {
+        /* The disk's cache and read-ahead see this write as their own. */
+        if (disk->flags & FABRIC_BLOCKDEV_F_WCACHE) {
+            disk->wcache_dirty = 1;
+        }
+        __sync_fetch_and_add(&disk->write_gen, 1u);
+    }
+    return rc;
+}
+
+static int part_flush(fabric_blockdev_t* dev)
+{
+    fabric_part_t* p = (fabric_part_t*)dev->context;
+    return fabric_blockdev_flush(p->disk);
+}
+
+static const fabric_blockdev_ops_t g_part_ops = {
+    .hdr = RDNX_ABI_INIT(fabric_blockdev_ops_t),
+    .read_sectors = part_read,
+    .write_sectors = part_write,
+    .flush = part_flush
+};
+
+static inline uint32_t part_le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t part_le64(const uint8_t* p)
+{
+    return (uint64_t)part_le32(p) | ((uint64_t)part_le32(p + 4) << 32);
+}
+
+static uint32_t part_crc32(uint32_t crc, const uint8_t* data, size_t len)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint32_t b = 0; b < 8u; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static void part_make_name(char* out, size_t cap, const char* disk, uint32_t number)
+{
+    size_t len = strlen(disk);
+    char digits[4];
+    uint32_t nd = 0;
+    do {
+        digits[nd++] = (char)('0' + number % 10u);
+        number /= 10u;
+    } while (number > 0 && nd < sizeof(digits));
+    bool sep = len > 0 && disk[len - 1u] >= '0' && disk[len - 1u] <= '9';
+    if (len + (sep ? 1u : 0u) + nd + 1u > cap) {
+        out[0] = '\0';
+        return;
+    }
+    memcpy(out, disk, len);
+    if (sep) {
+        out[len++] = 'p';
+    }
+    while (nd > 0) {
+        out[len++] = digits[--nd];
+    }
+    out[len] = '\0';
+}
+
+static int part_read_sector(part_scan_t* s, uint64_t lba)
+{
+    if (lba >= s->disk->sector_count) {
+        return RDNX_E_INVALID;
+    }
+    return s->disk->ops->read_sectors(s->disk, lba, 1, s->sector);
+}
+
+/* Register partition `number` covering [start, start + count) of the disk. */
+static void part_add(part_scan_t* s, uint32_t number, uint64_t start, uint64_t count)
+{
+    fabric_blockdev_t* disk = s->disk;
+    if (s->found >= FABRIC_PART_MAX || count == 0 || start == 0 ||
+        start >= disk->sector_count || disk->sector_count - start < count) {
+        return;
+    }
+    fabric_part_t* p = (fabric_part_t*)kmalloc(sizeof(*p));
+    if (!p) {
+        return;
+    }
+    memset(p, 0, sizeof(*p));
+    part_make_name(p->name, sizeof(p->name), disk->name, number);
+    if (!p->name[0]) {
+        kfree(p);
+        return;
+    }
+    p->disk = disk;
+    p->start_lba = start;
+    p->number = number;
+    p->blockdev.hdr = RDNX_ABI_INIT(fabric_blockdev_t);
+    p->blockdev.name = p->name;
+    p->blockdev.sector_size = disk->sector_size;
+    p->blockdev.sector_count = count;
+    p->blockdev.flags = (disk->flags & (FABRIC_BLOCKDEV_F_READONLY | FABRIC_BLOCKDEV_F_WCACHE)) |
+                        FABRIC_BLOCKDEV_F_PARTITION;
+    p->blockdev.ops = &g_part_ops;
+    p->blockdev.context = p;
+    p->blockdev.queue_depth = disk->queue_depth;
+
+    if (fabric_blockdev_register(&p->blockdev) != RDNX_OK) {
+        kfree(p);
+        return;
+    }
+    (void)fabric_publish_service_node(p->name, "partition", NULL);
+    spinlock_lock(&g_part_lock);
+    p->next = g_parts;
+    g_parts = p;
+    spinlock_unlock(&g_part_lock);
+    s->found++;
+    fabric_log("[fabric-block] %s: partition %u start=%llu sectors=%llu\n",
+               disk->name, number, (unsigned long long)start, (unsigned long long)count);
+}
+
+static bool part_is_extended(uint8_t type)
+{
+    return type == 0x05u || type == 0x0Fu || type == 0x85u;
+}
+
+/* A boot sector with a signature is not necessarily an MBR: check the boot flags. */
+static bool part_mbr_valid(const uint8_t* sec)
+{
+    if (sec[PART_MBR_SIG] != 0x55u || sec[PART_MBR_SIG + 1u] != 0xAAu) {
+        return false;
+    }
+    for (uint32_t i = 0; i < 4u; i++) {
+        uint8_t status = sec[PART_MBR_TABLE + i * PART_MBR_ENTRY_SIZE];
+        if (status != 0x00u && status != 0x80u) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Logical partitions: each EBR holds one partition and a link to the next EBR. */
+static void part_scan_ebr(part_scan_t* s, uint64_t ext_start)
+{
+    uint64_t ebr = ext_start;
+    uint32_t number = 5;
+    for (uint32_t hops = 0; hops < PART_EBR_MAX; hops++) {
+        if (part_read_sector(s, ebr) != RDNX_OK || !part_mbr_valid(s->sector)) {
+            return;
+        }
+        const uint8_t* e0 = s->sector + PART_MBR_TABLE;
+        const uint8_t* e1 = e0 + PART_MBR_ENTRY_SIZE;
+        uint8_t next_type = e1[4];
+        uint64_t next = part_le32(e1 + 8);
+        if (e0[4] != 0) {
+            part_add(s, number++, ebr + part_le32(e0 + 8), part_le32(e0 + 12));
+        }
+        if (!part_is_extended(next_type) || next == 0) {
+            return;
+        }
+        ebr = ext_start + next;
+    }
+}
+
+/* Validate the GPT header at `lba` and register its entries; false if unusable. */
+static bool part_scan_gpt_at(part_scan_t* s, uint64_t lba)
+{
+    uint32_t ss = s->disk->sector_size;
+    if (part_read_sector(s, lba) != RDNX_OK || memcmp(s->sector, "EFI PART", 8) != 0) {
+        return false;
+    }
+    uint8_t* h = s->sector;
+    uint32_t hdr_size = part_le32(h + 12);
+    uint32_t hdr_crc = part_le32(h + 16);
+    if (hdr_size < GPT_HDR_MIN_SIZE || hdr_size > ss || part_le64(h + 24) != lba) {
+        return false;
+    }
+    h[16] = h[17] = h[18] = h[19] = 0;
+    if (part_crc32(0, h, hdr_size) != hdr_crc) {
+        return false;
+    }
+    uint64_t first_usable = part_le64(h + 40);
+    uint64_t last_usable = part_le64(h + 48);
+    uint64_t entries_lba = part_le64(h + 72);
+    uint32_t nentries = part_le32(h + 80);
+    uint32_t entry_size = part_le32(h + 84);
+    uint32_t entries_crc = part_le32(h + 88);
+    if (entry_size < GPT_ENTRY_MIN_SIZE || (entry_size % 8u) != 0 || nentries == 0 ||
+        (uint64_t)nentries * entry_size > GPT_ENTRIES_MAX_BYTES) {
+        return false;
+    }
+    uint32_t bytes = nentries * entry_size;
+    uint32_t sectors = (bytes + ss - 1u) / ss;
+    if (entries_lba >= s->disk->sector_count || s->disk->sector_count - entries_lba < sectors) {
+        return false;
+    }
+    uint8_t* tbl = (uint8_t*)kmalloc((size_t)sectors * ss);
+    if (!tbl) {
+        return false;
+    }
+    if (s->disk->ops->read_sectors(s->disk, entries_lba, sectors, tbl) != RDNX_OK ||
+        part_crc32(0, tbl, bytes) != entries_crc) {
+        kfree(tbl);
+        return false;
+    }
+    for (uint32_t i = 0; i < nentries && s->found < FABRIC_PART_MAX; i++) {
+        const uint8_t* e = tbl + (size_t)i * entry_size;
+        bool used = false;
+        for (uint32_t b = 0; b < 16u; b++) {
+            used = used || e[b] != 0;
+        }
+        uint64_t first = part_le64(e + 32);
+        uint64_t last = part_le64(e + 40);
+        if (!used || first > last || first < first_usable || last > last_usable) {
+            continue;
+        }
+        part_add(s, i + 1u, first, last - first + 1u);
+    }
+    kfree(tbl);
+    return true;
+}
+
+static void part_scan(part_scan_t* s)
+{
+    if (part_read_sector(s, 0) != RDNX_OK || !part_mbr_valid(s->sector)) {
+        return;
+    }
+    uint8_t table[4u * PART_MBR_ENTRY_SIZE];
+    memcpy(table, s->sector + PART_MBR_TABLE, sizeof(table));
+    for (uint32_t i = 0; i < 4u; i++) {
+        if (table[i * PART_MBR_ENTRY_SIZE + 4u] == PART_TYPE_GPT_PROT) {
+            if (!part_scan_gpt_at(s, 1)) {
+                fabric_log("[fabric-block] %s: primary GPT invalid, trying backup\n", s->disk->name);
+                (void)part_scan_gpt_at(s, s->disk->sector_count - 1u);
+            }
+            return;
+        }
+    }
+    for (uint32_t i = 0; i < 4u; i++) {
+        const uint8_t* e = table + i * PART_MBR_ENTRY_SIZE;
+        uint8_t type = e[4];
+        if (type == 0) {
+            continue;
+        }
+        if (part_is_extended(type)) {
+            part_scan_ebr(s, part_le32(e + 8));
+        } else {
+            part_add(s, i + 1u, part_le32(e + 8), part_le32(e + 12));
+        }
+    }
+}
+
+static void part_node_path(const fabric_part_t* p, char* out, size_t cap)
+{
+    static const char prefix[] = "/fabric/services/";
+    size_t n = sizeof(prefix) - 1u;
+    size_t len = strlen(p->name);
+    if (n + len + 1u > cap) {
+        out[0] = '\0';
+        return;
+    }
+    memcpy(out, prefix, n);
+    memcpy(out + n, p->name, len + 1u);
+}
+
+/* Unregister every partition of `disk`; caller holds g_part_mutex. */
+static int part_drop_all(fabric_blockdev_t* disk)
+{
+    spinlock_lock(&g_part_lock);
+    for (fabric_part_t* p = g_parts; p; p = p->next) {
+        if (p->disk == disk && p->blockdev.holders != 0) {
+            spinlock_unlock(&g_part_lock);
+            return RDNX_E_BUSY;
+        }
+    }
+    spinlock_unlock(&g_part_lock);
+
+    fabric_part_t** link = &g_parts;
+    for (;;) {
+        spinlock_lock(&g_part_lock);
+        while (*link && (*link)->disk != disk) {
+            link = &(*link)->next;
+        }
+        fabric_part_t* p = *link;
+        spinlock_unlock(&g_part_lock);
+        if (!p) {
+            return RDNX_OK;
+        }
+        /* Opened between the check and here: keep it and report busy. */
+        int rc = fabric_blockdev_unregister(&p->blockdev);
+        if (rc == RDNX_E_BUSY) {
+            return rc;
+        }
+        spinlock_lock(&g_part_lock);
+        *link = p->next;
+        spinlock_unlock(&g_part_lock);
+        char path[FABRIC_NODE_PATH_MAX];
+        part_node_path(p, path, sizeof(path));
+        (void)fabric_node_set_state(path, FABRIC_STATE_REMOVED);
+        kfree(p);
+    }
+}
+
+void fabric_part_init(void)
+{
+    mutex_init(&g_part_mutex, "blkpart");
+    spinlock_init(&g_part_lock);
+    g_parts = NULL;
+}
+
+int fabric_blockdev_rescan_partitions(fabric_blockdev_t* disk)
+{
+    if (!disk || (disk->flags & FABRIC_BLOCKDEV_F_PARTITION) || !disk->name ||
+        disk->sector_size < 512u || disk->sector_size > 4096u) {
+        return RDNX_E_INVALID;
+    }
+    mutex_lock(&g_part_mutex);
+    int rc = part_drop_all(disk);
+    if (rc != RDNX_OK) {
+        mutex_unlock(&g_part_mutex);
+        return rc;
+    }
+    part_scan_t s;
+    s.disk = disk;
+    s.found = 0;
+    s.sector = (uint8_t*)kmalloc(disk->sector_size);
+    if (!s.sector) {
+        mutex_unlock(&g_part_mutex);
+        return RDNX_E_NOMEM;
+    }
+    part_scan(&s);
+    kfree(s.sector);
+    mutex_unlock(&g_part_mutex);
+    return (int)s.found;
+}
+
+int fabric_blockdev_drop_partitions(fabric_blockdev_t* disk)
+{
+    if (!disk || (disk->flags & FABRIC_BLOCKDEV_F_PARTITION)) {
+        return RDNX_E_INVALID;
+    }
+    mutex_lock(&g_part_mutex);
+    int rc = part_drop_all(disk);
+    mutex_unlock(&g_part_mutex);
+    return rc;
+}
+
+void fabric_part_note_disk_write(fabric_blockdev_t* disk)
+{
+    spinlock_lock(&g_part_lock);
+    for (fabric_part_t* p = g_parts; p; p = p->next) {
+        if (p->disk == disk) {
+            __sync_fetch_and_add(&p->blockdev.write_gen, 1u);
+        }
+    }
+    spinlock_unlock(&g_part_lock);
+}
@@ -0,0 +1,28 @@
+/**
+ * @file block_part.h
+ * @brief MBR/GPT partition tables and per-partition block devices
+ */
+
+#ifndef _RODNIX_FABRIC_BLOCK_PART_H
+#define _RODNIX_FABRIC_BLOCK_PART_H
+
+#include "block_service.h"
+
+#define FABRIC_PART_MAX 16u         /* partitions published per disk */
+
+void fabric_part_init(void);
+/*
+ * Drop the disk's partition devices and re-read its partition table.
+ * Returns the number of partitions now registered, RDNX_E_BUSY when one of
+ * the old partitions is still open or mounted.
+ */
+int fabric_blockdev_rescan_partitions(fabric_blockdev_t* disk);
+/*
+ * Drop the disk's partition devices and their /dev nodes without reading the
+ * table again (the disk went away). RDNX_E_BUSY when one is still open.
+ */
+int fabric_blockdev_drop_partitions(fabric_blockdev_t* disk);
+/* A write to the whole disk went through; invalidate partition read-ahead. */
+void fabric_part_note_disk_write(fabric_blockdev_t* disk);
+
+#endif /* _RODNIX_FABRIC_BLOCK_PART_H */
@@ -7,7 +7,9 @@
 #include "../fabric.h"
 #include "../spin.h"
 #include "service.h"
+#include "block_part.h"
 #include "../../fs/devfs.h"
+#include "../../common/cgroup.h"
 #include "../../../include/common.h"
 #include "../../../include/error.h"
 
@@ -18,6 +20,7 @@ typedef struct {
     fabric_blockdev_t* (*device_get)(uint32_t index);
     int (*read)(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, void* out);
     int (*write)(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, const void* in);
+    int (*flush)(fabric_blockdev_t* dev);
 } fabric_block_service_ops_t;
 
 static spinlock_t g_block_lock;
@@ -50,13 +53,19 @@ static int block_service_write(fabric_blockdev_t* dev, uint64_t lba, uint32_t co
     return fabric_blockdev_write(dev, lba, count, in);
 }
 
+static int block_service_flush(fabric_blockdev_t* dev)
+{
+    return fabric_blockdev_flush(dev);
+}
+
 static fabric_block_service_ops_t g_ops = {
     .hdr = RDNX_ABI_INIT(fabric_block_service_ops_t),
     .register_device = block_service_register_device,
     .device_count = block_service_device_count,
     .device_get = block_service_device_get,
     .read = block_service_read,
-    .write = block_service_write
+    .write = block_service_write,
+    .flush = block_service_flush
 };
 
 static fabric_service_t g_service = {
@@ -76,6 +85,7 @@ int fabric_block_service_init(void)
         g_blockdevs[i] = NULL;
     }
     g_blockdev_count = 0;
+    fabric_part_init();
     if (fabric_service_publish(&g_service) != RDNX_OK) {
         return RDNX_E_GENERIC;
     }
@@ -108,6 +118,8 @@ int fabric_blockdev_register(fabric_blockdev_t* dev)
             return RDNX_E_BUSY;
         }
     }
+    dev->wcache_dirty = 0;
+    dev->holders = 0;
     g_blockdevs[g_blockdev_count++] = dev;
     spinlock_unlock(&g_block_lock);
     (void)devfs_register_blockdev(dev->name);
@@ -115,6 +127,37 @@ int fabric_blockdev_register(fabric_blockdev_t* dev)
                dev->name,
                (unsigned long long)dev->sector_count,
                dev->sector_size);
+    if (!(dev->flags & FABRIC_BLOCKDEV_F_PARTITION)) {
+        (void)fabric_blockdev_rescan_partitions(dev);
+    }
+    return RDNX_OK;
+}
+
+int fabric_blockdev_unregister(fabric_blockdev_t* dev)
+{
+    if (!dev) {
+        return RDNX_E_INVALID;
+    }
+    spinlock_lock(&g_block_lock);
+    uint32_t i = 0;
+    while (i < g_blockdev_count && g_blockdevs[i] != dev) {
+        i++;
+    }
+    if (i == g_blockdev_count) {
+        spinlock_unlock(&g_block_lock);
+        return RDNX_E_NOTFOUND;
+    }
+    if (dev->holders != 0) {
+        spinlock_unlock(&g_block_lock);
+        return RDNX_E_BUSY;
+    }
+    for (; i + 1u < g_blockdev_count; i++) {
+        g_blockdevs[i] = g_blockdevs[i + 1u];
+    }
+    g_blockdevs[--g_blockdev_count] = NULL;
+    spinlock_unlock(&g_block_lock);
+    (void)devfs_unregister_blockdev(dev->name);
+    fabric_log("[fabric-block] device unregistered: %s\n", dev->name);
     return RDNX_OK;
 }
 
@@ -154,6 +197,38 @@ fabric_blockdev_t* fabric_blockdev_find(const char* name)
     return NULL;
 }
 
+fabric_blockdev_t* fabric_blockdev_acquire(const char* name)
+{
+    if (!name || !name[0]) {
+        return NULL;
+    }
+    spinlock_lock(&g_block_lock);
+    for (uint32_t i = 0; i < g_blockdev_count; i++) {
+        fabric_blockdev_t* dev = g_blockdevs[i];
+        if (dev && dev->name && strcmp(dev->name, name) == 0) {
+            __sync_fetch_and_add(&dev->holders, 1u);
+            spinlock_unlock(&g_block_lock);
+            return dev;
+        }
+    }
+    spinlock_unlock(&g_block_lock);
+    return NULL;
+}
+
+void fabric_blockdev_retain(fabric_blockdev_t* dev)
+{
+    if (dev) {
+        __sync_fetch_and_add(&dev->holders, 1u);
+    }
+}
+
+void fabric_blockdev_release(fabric_blockdev_t* dev)
+{
+    if (dev && dev->holders > 0) {
+        __sync_fetch_and_sub(&dev->holders, 1u);
+    }
+}
+
 int fabric_blockdev_read(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, void* out)
 {
     if (!dev || !out || !dev->ops || !dev->ops->read_sectors || count == 0) {
@@ -162,7 +237,11 @@ int fabric_blockdev_read(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, v
     if (lba >= dev->sector_count || (dev->sector_count - lba) < count) {
         return RDNX_E_INVALID;
     }
-    return dev->ops->read_sectors(dev, lba, count, out);
+    int rc = dev->ops->read_sectors(dev, lba, count, out);
+    if (rc == RDNX_OK) {
+        cgroup_io_charge(0, (uint64_t)count * dev->sector_size);
+    }
+    return rc;
 }
 
 int fabric_blockdev_write(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, const void* in)
@@ -179,7 +258,81 @@ int fabric_blockdev_write(fabric_blockdev_t* dev, uint64_t lba, uint32_t count,
     if (lba >= dev->sector_count || (dev->sector_count - lba) < count) {
         return RDNX_E_INVALID;
     }
-    return dev->ops->write_sectors(dev, lba, count, in);
+    int rc = dev->ops->write_sectors(dev, lba, count, in);
+    if (rc == RDNX_OK && (dev->flags & FABRIC_BLOCKDEV_F_WCACHE)) {
+        dev->wcache_dirty = 1;
+    }
+    if (rc == RDNX_OK) {
+        __sync_fetch_and_add(&dev->write_gen, 1u);
+        if (!(dev->flags & FABRIC_BLOCKDEV_F_PARTITION)) {
+            /* Partitions alias the disk: drop their read-ahead copies too. */
+            fabric_part_note_disk_write(dev);
+        }
+        cgroup_io_charge(1, (uint64_t)count * dev->sector_size);
+    }
+    return rc;
+}
+
+static int blockdev_has_flush(const fabric_blockdev_t* dev)
+{
+    /* ops->flush was appended later; older drivers publish a shorter table. */
+    return dev->ops->hdr.size >= sizeof(fabric_blockdev_ops_t) && dev->ops->flush != NULL;
+}
+
+int fabric_blockdev_flush(fabric_blockdev_t* dev)
+{
+    if (!dev || !dev->ops) {
+        return RDNX_E_INVALID;
+    }
+    if (!(dev->flags & FABRIC_BLOCKDEV_F_WCACHE) || !blockdev_has_flush(dev)) {
+        return RDNX_OK;
+    }
+    /* Clear before flushing: writes racing with the flush re-mark the cache. */
+    if (__sync_lock_test_and_set(&dev->wcache_dirty, 0) == 0) {
+        return RDNX_OK;
+    }
+    int rc = dev->ops->flush(dev);
+    if (rc != RDNX_OK) {
+        dev->wcache_dirty = 1;
+    }
+    return rc;
+}
+
+int fabric_blockdev_write_req(fabric_blockdev_t* dev, uint64_t lba, uint32_t count,
+                              const void* in, uint32_t req_flags)
+{
+    if (req_flags & FABRIC_BLOCKDEV_REQ_PREFLUSH) {
+        int frc = fabric_blockdev_flush(dev);
+        if (frc != RDNX_OK) {
+            return frc;
+        }
+    }
+    int rc = fabric_blockdev_write(dev, lba, count, in);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    if (req_flags & FABRIC_BLOCKDEV_REQ_FUA) {
+        /* No native FUA in the current drivers: emulate as write + flush. */
+        rc = fabric_blockdev_flush(dev);
+    }
+    return rc;
+}
+
+int fabric_blockdev_sync_all(void)
+{
+    int result = RDNX_OK;
+    uint32_t count = fabric_blockdev_count();
+    for (uint32_t i = 0; i < count; i++) {
+        fabric_blockdev_t* dev = fabric_blockdev_get(i);
+        if (!dev) {
+            continue;
+        }
+        int rc = fabric_blockdev_flush(dev);
+        if (rc != RDNX_OK && result == RDNX_OK) {
+            result = rc;
+        }
+    }
+    return result;
 }
 
 int fabric_blockdev_get_info(uint32_t index, fabric_blockdev_info_t* out)
@@ -196,5 +349,6 @@ int fabric_blockdev_get_info(uint32_t index, fabric_blockdev_info_t* out)
     out->sector_size = dev->sector_size;
     out->sector_count = dev->sector_count;
     out->flags = dev->flags;
+    out->queue_depth = dev->queue_depth ? dev->queue_depth : 1u;
     return RDNX_OK;
 }
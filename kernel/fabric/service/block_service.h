@@ -9,11 +9,19 @@
 #include "../../../include/abi.h"
 #include <stdint.h>
 
-#define FABRIC_BLOCKDEV_MAX 16
+#define FABRIC_BLOCKDEV_MAX 32
 
 enum {
-    FABRIC_BLOCKDEV_F_READONLY = 1u << 0,
-    FABRIC_BLOCKDEV_F_SYSTEM   = 1u << 1
+    FABRIC_BLOCKDEV_F_READONLY  = 1u << 0,
+    FABRIC_BLOCKDEV_F_SYSTEM    = 1u << 1,
+    FABRIC_BLOCKDEV_F_WCACHE    = 1u << 2, /* volatile write cache, needs explicit flush */
+    FABRIC_BLOCKDEV_F_PARTITION = 1u << 3  /* child of a disk (block_part.c), never scanned itself */
+};
+
+/* Per-request flags for fabric_blockdev_write_req(). */
+enum {
+    FABRIC_BLOCKDEV_REQ_PREFLUSH = 1u << 0, /* flush cache before the write */
+    FABRIC_BLOCKDEV_REQ_FUA      = 1u << 1  /* data is durable when the call returns */
 };
 
 typedef struct fabric_blockdev fabric_blockdev_t;
@@ -22,6 +30,8 @@ typedef struct fabric_blockdev_ops {
     rdnx_abi_header_t hdr;
     int (*read_sectors)(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, void* out);
     int (*write_sectors)(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, const void* in);
+    /* Optional: drain the volatile write cache (ATA FLUSH CACHE, NVMe Flush). */
+    int (*flush)(fabric_blockdev_t* dev);
 } fabric_blockdev_ops_t;
 
 typedef struct fabric_blockdev_info {
@@ -29,6 +39,7 @@ typedef struct fabric_blockdev_info {
     uint32_t sector_size;
     uint64_t sector_count;
     uint32_t flags;
+    uint32_t queue_depth;
 } fabric_blockdev_info_t;
 
 struct fabric_blockdev {
@@ -39,6 +50,10 @@ struct fabric_blockdev {
     uint32_t flags;
     const fabric_blockdev_ops_t* ops;
     void* context;
+    volatile uint32_t wcache_dirty; /* writes accepted since the last flush */
+    volatile uint32_t write_gen;    /* bumped on every write; invalidates read-ahead copies */
+    uint32_t queue_depth;           /* commands the driver keeps in flight, 0 = one at a time */
+    volatile uint32_t holders;      /* open files and mounts; unregister fails while non-zero */
 };
 
 int fabric_block_service_init(void);
@@ -46,8 +61,18 @@ int fabric_blockdev_register(fabric_blockdev_t* dev);
 uint32_t fabric_blockdev_count(void);
 fabric_blockdev_t* fabric_blockdev_get(uint32_t index);
 fabric_blockdev_t* fabric_blockdev_find(const char* name);
+/* find() plus a hold that keeps the device registered until release(). */
+fabric_blockdev_t* fabric_blockdev_acquire(const char* name);
+void fabric_blockdev_retain(fabric_blockdev_t* dev);
+void fabric_blockdev_release(fabric_blockdev_t* dev);
+/* Drop a device from the registry and /dev; RDNX_E_BUSY while it is held. */
+int fabric_blockdev_unregister(fabric_blockdev_t* dev);
 int fabric_blockdev_read(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, void* out);
 int fabric_blockdev_write(fabric_blockdev_t* dev, uint64_t lba, uint32_t count, const void* in);
+int fabric_blockdev_write_req(fabric_blockdev_t* dev, uint64_t lba, uint32_t count,
+                              const void* in, uint32_t req_flags);
+int fabric_blockdev_flush(fabric_blockdev_t* dev);
+int fabric_blockdev_sync_all(void);
 int fabric_blockdev_get_info(uint32_t index, fabric_blockdev_info_t* out);
 
 #endif /* _RODNIX_FABRIC_BLOCK_SERVICE_H */
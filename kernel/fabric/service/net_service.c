@@ -7,9 +7,14 @@
 #include "../fabric.h"
 #include "../spin.h"
 #include "service.h"
+#include "../../core/cpu.h"
+#include "../../common/scheduler.h"
+#include "../../common/waitq.h"
 #include "../../../include/common.h"
 #include "../../../include/error.h"
 
+#define NETPOLLD_IDLE_MS 100u
+
 typedef struct {
     rdnx_abi_header_t hdr;
     int (*register_iface)(fabric_netif_t* iface);
@@ -25,6 +30,12 @@ static int g_event_subscribed = 0;
 static fabric_netif_t* g_ifaces[FABRIC_NETIF_MAX];
 static uint32_t g_iface_count = 0;
 
+/* NAPI poll thread; g_napi_lock guards queue state against interrupt handlers. */
+static spinlock_t g_napi_lock;
+static waitq_t g_napi_wq;
+static thread_t* g_napi_thread = NULL;
+static uint32_t g_napi_scheduled = 0;       /* queues with FABRIC_NETIF_QS_SCHED */
+
 static void net_interface_manager_event(const fabric_event_t* event, void* arg)
 {
     (void)arg;
@@ -106,6 +117,7 @@ int fabric_net_service_init(void)
         return RDNX_OK;
     }
     spinlock_init(&g_net_lock);
+    spinlock_init(&g_napi_lock);
     for (uint32_t i = 0; i < FABRIC_NETIF_MAX; i++) {
         g_ifaces[i] = NULL;
     }
@@ -194,6 +206,50 @@ int fabric_netif_tx(fabric_netif_t* iface, const void* frame, uint32_t len)
     return ret;
 }
 
+int fabric_netif_tx_offload(fabric_netif_t* iface, const fabric_netif_tx_req_t* req)
+{
+    if (!iface || !req || !req->frame || req->len == 0) {
+        return RDNX_E_INVALID;
+    }
+    if (req->flags == 0) {
+        return fabric_netif_tx(iface, req->frame, req->len);
+    }
+
+    uint32_t need = 0;
+    if (req->flags & FABRIC_NETIF_TX_CSUM_IP4) {
+        need |= FABRIC_NETIF_CAP_TXCSUM_IP4;
+    }
+    if (req->flags & (FABRIC_NETIF_TX_CSUM_UDP | FABRIC_NETIF_TX_CSUM_TCP)) {
+        need |= FABRIC_NETIF_CAP_TXCSUM_L4;
+    }
+    if (req->flags & FABRIC_NETIF_TX_TSO) {
+        need |= FABRIC_NETIF_CAP_TSO4;
+        if (req->mss == 0 || req->l4_hdr_len == 0 ||
+            (req->flags & FABRIC_NETIF_TX_CSUM_TCP) == 0) {
+            return RDNX_E_INVALID;
+        }
+    }
+    const uint32_t max = (req->flags & FABRIC_NETIF_TX_TSO) ? FABRIC_NET_TSO_MAX : FABRIC_NET_FRAME_MAX;
+    if (req->len > max || req->l3_off >= req->l4_off || req->l4_off >= req->len) {
+        return RDNX_E_INVALID;
+    }
+    if ((iface->flags & FABRIC_NETIF_F_UP) == 0) {
+        iface->stats.drops++;
+        return RDNX_E_DENIED;
+    }
+    if ((iface->caps & need) != need || !iface->ops || !iface->ops->tx_offload) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    int ret = iface->ops->tx_offload(iface, req);
+    if (ret == RDNX_OK) {
+        iface->stats.tx_frames++;
+        iface->stats.tx_bytes += req->len;
+        return RDNX_OK;
+    }
+    iface->stats.drops++;
+    return ret;
+}
+
 int fabric_netif_rx_submit(fabric_netif_t* iface, const void* frame, uint32_t len)
 {
     if (!iface || !frame || len == 0 || len > FABRIC_NET_FRAME_MAX) {
@@ -229,21 +285,297 @@ int fabric_netif_get_info(uint32_t index, fabric_netif_info_t* out)
     return RDNX_OK;
 }
 
-void fabric_netif_poll_all(void)
+static uint32_t net_snapshot(fabric_netif_t** ifaces)
 {
     spinlock_lock(&g_net_lock);
     uint32_t n = g_iface_count;
-    fabric_netif_t* ifaces[FABRIC_NETIF_MAX];
     for (uint32_t i = 0; i < n && i < FABRIC_NETIF_MAX; i++) {
         ifaces[i] = g_ifaces[i];
     }
     spinlock_unlock(&g_net_lock);
+    return (n < FABRIC_NETIF_MAX) ? n : FABRIC_NETIF_MAX;
+}
 
-    for (uint32_t i = 0; i < n && i < FABRIC_NETIF_MAX; i++) {
+static uint32_t net_queue_count(const fabric_netif_t* iface)
+{
+    if (!iface->rxq) {
+        return 0;
+    }
+    return (iface->rx_queues < FABRIC_NETIF_QUEUES_MAX) ? iface->rx_queues : FABRIC_NETIF_QUEUES_MAX;
+}
+
+static uint32_t net_budget(const fabric_netif_t* iface)
+{
+    uint32_t budget = __atomic_load_n(&iface->poll_budget, __ATOMIC_RELAXED);
+    return budget ? budget : FABRIC_NETIF_POLL_BUDGET;
+}
+
+static bool net_queue_local(const fabric_netif_queue_t* q, uint32_t cpu, uint32_t ncpu)
+{
+    return q->poll && (q->cpu == cpu || q->cpu >= ncpu);
+}
+
+/* Returns true when this call set the bit; the caller then owns the masking. */
+static bool net_queue_mark(fabric_netif_queue_t* q)
+{
+    irql_t irql = spinlock_lock_irqsave(&g_napi_lock);
+    bool first = (q->state & FABRIC_NETIF_QS_SCHED) == 0;
+    if (first) {
+        q->state |= FABRIC_NETIF_QS_SCHED;
+        g_napi_scheduled++;
+    }
+    spinlock_unlock_irqrestore(&g_napi_lock, irql);
+    return first;
+}
+
+void fabric_netif_poll_all(void)
+{
+    fabric_netif_t* ifaces[FABRIC_NETIF_MAX];
+    const uint32_t n = net_snapshot(ifaces);
+    const bool napi = __atomic_load_n(&g_napi_thread, __ATOMIC_ACQUIRE) != NULL;
+    const uint32_t cpu = cpu_get_id();
+    const uint32_t ncpu = cpu_get_count();
+    for (uint32_t i = 0; i < n; i++) {
         fabric_netif_t* iface = ifaces[i];
-        if (!iface || !iface->ops || !iface->ops->poll) {
+        if (!iface) {
+            continue;
+        }
+        const uint32_t nq = net_queue_count(iface);
+        if (nq > 0) {
+            const uint32_t budget = net_budget(iface);
+            for (uint32_t qi = 0; qi < nq; qi++) {
+                fabric_netif_queue_t* q = &iface->rxq[qi];
+                if (!net_queue_local(q, cpu, ncpu) || (napi && q->irq_enable)) {
+                    continue;
+                }
+                q->polls++;
+                q->rx_frames += q->poll(q, budget);
+            }
             continue;
         }
-        (void)iface->ops->poll(iface);
+        if (iface->ops && iface->ops->poll) {
+            (void)iface->ops->poll(iface);
+        }
+    }
+}
+
+uint32_t fabric_netif_busy_poll(void)
+{
+    fabric_netif_t* ifaces[FABRIC_NETIF_MAX];
+    const uint32_t n = net_snapshot(ifaces);
+    const uint32_t cpu = cpu_get_id();
+    const uint32_t ncpu = cpu_get_count();
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        fabric_netif_t* iface = ifaces[i];
+        if (!iface) {
+            continue;
+        }
+        const uint32_t nq = net_queue_count(iface);
+        if (nq == 0) {
+            if (iface->ops && iface->ops->poll) {
+                (void)iface->ops->poll(iface);
+            }
+            continue;
+        }
+        const uint32_t budget = net_budget(iface);
+        for (uint32_t qi = 0; qi < nq; qi++) {
+            fabric_netif_queue_t* q = &iface->rxq[qi];
+            if (!net_queue_local(q, cpu, ncpu)) {
+                continue;
+            }
+            uint32_t got = q->poll(q, budget);
+            q->busy_polls++;
+            q->rx_frames += got;
+            total += got;
+        }
+    }
+    return total;
+}
+
+void fabric_netif_queue_schedule(fabric_netif_queue_t* q)
+{
+    if (!q) {
+        return;
+    }
+    q->irqs++;
+    if (!q->poll || !q->irq_enable || !__atomic_load_n(&g_napi_thread, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    if (!net_queue_mark(q)) {
+        return;
+    }
+    (void)q->irq_enable(q, false);
+    irql_t irql = spinlock_lock_irqsave(&g_napi_lock);
+    (void)waitq_wake_one(&g_napi_wq);
+    spinlock_unlock_irqrestore(&g_napi_lock, irql);
+}
+
+/*
+ * One pass over the scheduled queues. A queue that fills its budget stays
+ * scheduled with its interrupt masked; one that comes back short has its
+ * interrupt re-armed, unless frames slipped in meanwhile. Returns true
+ * while any queue is still scheduled.
+ */
+static bool netpolld_pass(void)
+{
+    fabric_netif_t* ifaces[FABRIC_NETIF_MAX];
+    const uint32_t n = net_snapshot(ifaces);
+    bool again = false;
+    for (uint32_t i = 0; i < n; i++) {
+        fabric_netif_t* iface = ifaces[i];
+        if (!iface) {
+            continue;
+        }
+        const uint32_t nq = net_queue_count(iface);
+        const uint32_t budget = net_budget(iface);
+        for (uint32_t qi = 0; qi < nq; qi++) {
+            fabric_netif_queue_t* q = &iface->rxq[qi];
+            if (!q->poll || !q->irq_enable ||
+                (__atomic_load_n(&q->state, __ATOMIC_ACQUIRE) & FABRIC_NETIF_QS_SCHED) == 0) {
+                continue;
+            }
+            uint32_t got = q->poll(q, budget);
+            q->polls++;
+            q->rx_frames += got;
+            if (got >= budget) {
+                q->budget_hits++;
+                again = true;
+                continue;
+            }
+            irql_t irql = spinlock_lock_irqsave(&g_napi_lock);
+            q->state &= ~FABRIC_NETIF_QS_SCHED;
+            g_napi_scheduled--;
+            spinlock_unlock_irqrestore(&g_napi_lock, irql);
+            if (q->irq_enable(q, true)) {
+                /* Raced with the device: poll again rather than wait for an interrupt. */
+                if (net_queue_mark(q)) {
+                    (void)q->irq_enable(q, false);
+                }
+                again = true;
+                continue;
+            }
+            q->rearms++;
+        }
+    }
+    return again;
+}
+
+static void netpolld_main(void* arg)
+{
+    (void)arg;
+    thread_t* self = thread_get_current();
+    for (;;) {
+        if (netpolld_pass()) {
+            scheduler_yield();
+            continue;
+        }
+        /* Queue before the last look so a schedule in between is not lost. */
+        irql_t irql = spinlock_lock_irqsave(&g_napi_lock);
+        (void)waitq_enqueue(&g_napi_wq, self);
+        bool pending = g_napi_scheduled != 0;
+        if (pending) {
+            (void)waitq_remove(&g_napi_wq, self);
+        }
+        spinlock_unlock_irqrestore(&g_napi_lock, irql);
+        if (!pending) {
+            (void)waitq_wait(&g_napi_wq, NETPOLLD_IDLE_MS);
+        }
+    }
+}
+
+void fabric_netif_napi_start(void)
+{
+    if (g_napi_thread || !g_net_inited) {
+        return;
+    }
+    task_t* kernel_task = task_get_current();
+    if (!kernel_task) {
+        return;
+    }
+    waitq_init(&g_napi_wq, "netpolld");
+    thread_t* t = thread_create(kernel_task, netpolld_main, NULL);
+    if (!t) {
+        return;
+    }
+    scheduler_set_bucket(t, SCHED_BUCKET_UTILITY);
+    __atomic_store_n(&g_napi_thread, t, __ATOMIC_RELEASE);
+    /*
+     * Interrupts taken before now were only counted: give every
+     * interrupt-driven queue one pass so none waits on a ring that filled
+     * meanwhile.
+     */
+    fabric_netif_t* ifaces[FABRIC_NETIF_MAX];
+    const uint32_t n = net_snapshot(ifaces);
+    for (uint32_t i = 0; i < n; i++) {
+        const uint32_t nq = ifaces[i] ? net_queue_count(ifaces[i]) : 0u;
+        for (uint32_t qi = 0; qi < nq; qi++) {
+            fabric_netif_queue_t* q = &ifaces[i]->rxq[qi];
+            if (q->poll && q->irq_enable && net_queue_mark(q)) {
+                (void)q->irq_enable(q, false);
+            }
+        }
+    }
+    scheduler_add_thread(t);
+    fabric_log("[fabric-net] netpolld started\n");
+}
+
+int fabric_netif_set(uint32_t index, uint32_t key, uint64_t value)
+{
+    fabric_netif_t* iface = fabric_netif_get(index);
+    if (!iface) {
+        return RDNX_E_NOTFOUND;
+    }
+    switch (key) {
+    case FABRIC_NETIF_SET_POLL_BUDGET:
+        if (value > FABRIC_NETIF_BUDGET_MAX) {
+            return RDNX_E_INVALID;
+        }
+        __atomic_store_n(&iface->poll_budget, (uint32_t)value, __ATOMIC_RELAXED);
+        return RDNX_OK;
+    default:
+        return RDNX_E_UNSUPPORTED;
+    }
+}
+
+uint32_t fabric_netif_get_qstats(fabric_netif_qstat_t* out, uint32_t max, uint32_t* total)
+{
+    fabric_netif_t* ifaces[FABRIC_NETIF_MAX];
+    const uint32_t n = net_snapshot(ifaces);
+    uint32_t count = 0;
+    uint32_t copied = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        fabric_netif_t* iface = ifaces[i];
+        if (!iface) {
+            continue;
+        }
+        const uint32_t nq = net_queue_count(iface);
+        for (uint32_t qi = 0; qi < nq; qi++, count++) {
+            if (!out || copied >= max) {
+                continue;
+            }
+            const fabric_netif_queue_t* q = &iface->rxq[qi];
+            fabric_netif_qstat_t* st = &out[copied++];
+            memset(st, 0, sizeof(*st));
+            if (iface->name) {
+                strncpy(st->name, iface->name, sizeof(st->name) - 1);
+            }
+            st->queue = q->index;
+            st->cpu = q->cpu;
+            st->vector = q->vector;
+            st->budget = net_budget(iface);
+            st->flags = (q->irq_enable ? FABRIC_NETIF_QSTAT_NAPI : 0u) |
+                        ((q->state & FABRIC_NETIF_QS_SCHED) ? FABRIC_NETIF_QSTAT_SCHED : 0u);
+            st->irqs = q->irqs;
+            st->polls = q->polls;
+            st->rx_frames = q->rx_frames;
+            st->budget_hits = q->budget_hits;
+            st->rearms = q->rearms;
+            st->busy_polls = q->busy_polls;
+        }
+    }
+    if (total) {
+        *total = count;
     }
+    return copied;
 }
@@ -13,6 +13,10 @@
 
 #define FABRIC_NETIF_MAX 16
 #define FABRIC_NET_FRAME_MAX 2048
+#define FABRIC_NET_TSO_MAX   (14u + 65535u)   /* Ethernet header + largest IPv4 packet */
+#define FABRIC_NETIF_QUEUES_MAX 8
+#define FABRIC_NETIF_POLL_BUDGET 64u   /* default frames per queue per poll pass */
+#define FABRIC_NETIF_BUDGET_MAX  256u
 
 enum {
     FABRIC_NETIF_F_UP       = 1u << 0,
@@ -20,12 +24,117 @@ enum {
     FABRIC_NETIF_F_BROADCAST = 1u << 2
 };
 
+/* Offloads an interface implements (fabric_netif_t.caps). */
+enum {
+    FABRIC_NETIF_CAP_TXCSUM_IP4 = 1u << 0,  /* IPv4 header checksum on transmit */
+    FABRIC_NETIF_CAP_TXCSUM_L4  = 1u << 1,  /* TCP/UDP over IPv4 checksum on transmit */
+    FABRIC_NETIF_CAP_RXCSUM     = 1u << 2,  /* sets BSD_CSUM_* flags on received mbufs */
+    FABRIC_NETIF_CAP_TSO4       = 1u << 3   /* TCP segmentation over IPv4 */
+};
+
+/* Per-frame offload requests (fabric_netif_tx_req_t.flags). */
+enum {
+    FABRIC_NETIF_TX_CSUM_IP4 = 1u << 0,
+    FABRIC_NETIF_TX_CSUM_UDP = 1u << 1,
+    FABRIC_NETIF_TX_CSUM_TCP = 1u << 2,
+    FABRIC_NETIF_TX_TSO      = 1u << 3
+};
+
+/*
+ * A frame with offload work for the NIC. The caller leaves ip_sum at 0 for
+ * FABRIC_NETIF_TX_CSUM_IP4 and stores bsd_in_pseudo() over the L4 length
+ * in the TCP/UDP checksum field for FABRIC_NETIF_TX_CSUM_UDP/TCP. With
+ * FABRIC_NETIF_TX_TSO the frame is one TCP packet of up to
+ * FABRIC_NET_TSO_MAX bytes, the pseudo-header seed excludes the length,
+ * and the NIC cuts the payload into mss-byte segments, rewriting IP length,
+ * IP id, TCP sequence numbers and all checksums per segment.
+ */
+typedef struct fabric_netif_tx_req {
+    const void* frame;
+    uint32_t len;
+    uint32_t flags;      /* FABRIC_NETIF_TX_* */
+    uint16_t l3_off;     /* start of the IPv4 header */
+    uint16_t l4_off;     /* start of the TCP/UDP header */
+    uint16_t l4_hdr_len; /* TSO: TCP header length with options */
+    uint16_t mss;        /* TSO: payload bytes per segment */
+} fabric_netif_tx_req_t;
+
 typedef struct fabric_netif fabric_netif_t;
+typedef struct fabric_netif_queue fabric_netif_queue_t;
+
+/* fabric_netif_queue_t.state */
+enum {
+    FABRIC_NETIF_QS_SCHED = 1u << 0     /* poll pending, queue interrupt masked */
+};
+
+/*
+ * One receive queue. A multi-queue NIC spreads flows over its queues by
+ * RSS hash; each queue has its own interrupt vector aimed at cpu and is
+ * polled only on that CPU, so a flow stays on one CPU from the ring to the
+ * socket.
+ *
+ * Queues with irq_enable are interrupt driven (NAPI): the handler only
+ * calls fabric_netif_queue_schedule(), which masks the queue interrupt and
+ * wakes the poll thread. The thread polls up to the interface budget per
+ * pass and re-arms the interrupt once a pass comes back short.
+ * irq_enable(q, true) returns true when frames arrived while the interrupt
+ * was masked; the queue is then polled again instead of waiting for an
+ * interrupt that will not come. Queues without irq_enable are polled from
+ * fabric_netif_poll_all().
+ */
+struct fabric_netif_queue {
+    fabric_netif_t* iface;
+    uint16_t index;
+    uint16_t cpu;
+    int vector;                  /* own MSI-X vector, -1 when shared or polled */
+    /* Harvest up to budget frames; returns the number handled. */
+    uint32_t (*poll)(fabric_netif_queue_t* q, uint32_t budget);
+    bool (*irq_enable)(fabric_netif_queue_t* q, bool on);
+    void* context;
+    uint32_t state;              /* FABRIC_NETIF_QS_* */
+    uint64_t irqs;
+    uint64_t polls;
+    uint64_t rx_frames;
+    uint64_t budget_hits;        /* polls that used the whole budget */
+    uint64_t rearms;             /* interrupts re-enabled after the ring drained */
+    uint64_t busy_polls;         /* polls on behalf of busy-polling sockets */
+};
+
+/* Per-queue statistics as exported to userland (netqstat). */
+typedef struct fabric_netif_qstat {
+    char name[16];
+    uint16_t queue;
+    uint16_t cpu;
+    int32_t vector;
+    uint32_t budget;
+    uint32_t flags;              /* FABRIC_NETIF_QSTAT_* */
+    uint64_t irqs;
+    uint64_t polls;
+    uint64_t rx_frames;
+    uint64_t budget_hits;
+    uint64_t rearms;
+    uint64_t busy_polls;
+} fabric_netif_qstat_t;
+
+enum {
+    FABRIC_NETIF_QSTAT_NAPI  = 1u << 0, /* interrupt driven */
+    FABRIC_NETIF_QSTAT_SCHED = 1u << 1  /* poll pending right now */
+};
+
+_Static_assert(sizeof(fabric_netif_qstat_t) == 80, "fabric_netif_qstat_t ABI size mismatch");
+_Static_assert(offsetof(fabric_netif_qstat_t, irqs) == 32, "fabric_netif_qstat_t.irqs ABI mismatch");
+
+/* fabric_netif_set() keys. */
+enum {
+    FABRIC_NETIF_SET_POLL_BUDGET = 1    /* frames per queue per pass; 0 = default */
+};
 
 typedef struct fabric_netif_ops {
     rdnx_abi_header_t hdr;
     int (*tx)(fabric_netif_t* iface, const void* frame, uint32_t len);
     int (*poll)(fabric_netif_t* iface);
+    /* Optional; required for any FABRIC_NETIF_CAP_TX* / TSO bit in caps. */
+    int (*tx_offload)(fabric_netif_t* iface, const fabric_netif_tx_req_t* req);
 } fabric_netif_ops_t;
 
 typedef struct fabric_netif_stats {
@@ -65,6 +174,16 @@ struct fabric_netif {
     const fabric_netif_ops_t* ops;
     void* context;
     fabric_netif_stats_t stats;
+    uint32_t caps;               /* FABRIC_NETIF_CAP_* */
+    /*
+     * Multi-queue drivers set rxq to rx_queues poll contexts, which replace
+     * ops->poll. tx_queues is informational: drivers pick the transmit
+     * queue of the sending CPU themselves.
+     */
+    uint16_t rx_queues;
+    uint16_t tx_queues;
+    fabric_netif_queue_t* rxq;
+    uint32_t poll_budget;        /* frames per queue per pass; 0 = FABRIC_NETIF_POLL_BUDGET */
 };
 
 int fabric_net_service_init(void);
@@ -72,8 +191,37 @@ int fabric_netif_register(fabric_netif_t* iface);
 uint32_t fabric_netif_count(void);
 fabric_netif_t* fabric_netif_get(uint32_t index);
 int fabric_netif_tx(fabric_netif_t* iface, const void* frame, uint32_t len);
+/*
+ * Send with offloads. Requests without flags go through ops->tx; flags the
+ * interface does not advertise in caps fail with RDNX_E_UNSUPPORTED, so
+ * callers check caps and do the work in software instead.
+ */
+int fabric_netif_tx_offload(fabric_netif_t* iface, const fabric_netif_tx_req_t* req);
 int fabric_netif_rx_submit(fabric_netif_t* iface, const void* frame, uint32_t len);
 int fabric_netif_get_info(uint32_t index, fabric_netif_info_t* out);
+/*
+ * Poll every interface: ops->poll for devices without queue contexts, and
+ * the polled receive queues bound to the calling CPU (plus queues bound to
+ * CPUs that are not online). Interrupt-driven queues are left to the poll
+ * thread once it runs.
+ */
 void fabric_netif_poll_all(void);
+/*
+ * Busy poll for a waiting socket: poll this CPU's queues directly,
+ * interrupt-driven ones included, without touching their interrupt state.
+ * Returns the frames handled.
+ */
+uint32_t fabric_netif_busy_poll(void);
+/* Interrupt handler side of a NAPI queue; callable with interrupts disabled. */
+void fabric_netif_queue_schedule(fabric_netif_queue_t* q);
+/* Start the poll thread; until then interrupt-driven queues are polled like the rest. */
+void fabric_netif_napi_start(void);
+/* Tunables by interface index; RDNX_E_INVALID for values out of range. */
+int fabric_netif_set(uint32_t index, uint32_t key, uint64_t value);
+/*
+ * Copy up to max per-queue records, interfaces in registration order;
+ * *total gets the number of queues. Returns the number copied.
+ */
+uint32_t fabric_netif_get_qstats(fabric_netif_qstat_t* out, uint32_t max, uint32_t* total);
 
 #endif /* _RODNIX_FABRIC_NET_SERVICE_H */
@@ -1,39 +1,106 @@
 /**
  * @file spin.c
- * @brief Simple spinlock implementation for Fabric
+ * @brief Ticket spinlocks for Fabric
+ *
+ * The owner half is written only by the lock holder, so unlock is a plain
+ * release store; the next half is only ever incremented atomically. Both
+ * counters wrap at 16 bits, which bounds the number of simultaneous
+ * waiters to 65535 -- far beyond any CPU count we boot on.
+ *
+ * A held spinlock disables preemption: the holder is never switched away,
+ * so a waiter never spins on a lock whose owner is not running.
+ *
+ * With LOCKSTAT=1/LOCKDEP=1 every lock carries its class and the slow path
+ * reports contention, spin and hold times and lock order to
+ * kernel/common/lockstat.c; otherwise the hooks compile out.
  */
 
 #include "spin.h"
+#include "../common/preempt.h"
+#include <stddef.h>
+#ifdef CONFIG_LOCK_CLASSES
+#include "../core/cpu.h"
+#endif
 
-void spinlock_init(spinlock_t* lock)
+#define SPIN_TICKET_NEXT (1u << 16)   /* one ticket in the next half of .tickets */
+
+void (spinlock_init)(spinlock_t* lock)
+{
+    spinlock_init_named(lock, NULL);
+}
+
+void spinlock_init_named(spinlock_t* lock, const char* name)
 {
     if (!lock) {
         return;
     }
-    lock->locked = 0;
+    lock->tickets = 0;
+#ifdef CONFIG_LOCK_CLASSES
+    lock->cls = name ? lock_class_get(name, LOCK_KIND_SPIN, 0) : NULL;
+    lock->acquired_tsc = 0;
+#else
+    (void)name;
+#endif
     __asm__ volatile ("" ::: "memory");
 }
 
-void spinlock_lock(spinlock_t* lock)
+/* Take a ticket; returns true when it had to wait for earlier ones. */
+static inline bool spinlock_take_ticket(spinlock_t* lock)
 {
-    if (!lock) {
-        return;
+    uint32_t old = __atomic_fetch_add(&lock->tickets, SPIN_TICKET_NEXT, __ATOMIC_ACQUIRE);
+    uint16_t mine = (uint16_t)(old >> 16);
+    if ((uint16_t)old == mine) {
+        return false;
     }
-    
-    while (__sync_lock_test_and_set(&lock->locked, 1)) {
+    while (__atomic_load_n(&lock->ticket.owner, __ATOMIC_ACQUIRE) != mine) {
         __asm__ volatile ("pause");
     }
+    return true;
+}
+
+static inline void spinlock_lock_at(spinlock_t* lock, uintptr_t ip)
+{
+    preempt_disable_at(ip);
+#ifdef CONFIG_LOCK_CLASSES
+    if (!lock->cls) {
+        /* Statically zeroed lock that never went through spinlock_init(). */
+        lock->cls = lock_class_get(NULL, LOCK_KIND_SPIN, ip);
+    }
+    lockdep_acquire(lock->cls, lock, ip, 0);
+    uint64_t start = cpu_get_time();
+    bool contended = spinlock_take_ticket(lock);
+    lock->acquired_tsc = cpu_get_time();
+    lockstat_acquired(lock->cls, ip, contended ? 1 : 0, contended ? lock->acquired_tsc - start : 0);
+#else
+    (void)spinlock_take_ticket(lock);
+#endif
     __asm__ volatile ("" ::: "memory");
 }
 
+void spinlock_lock(spinlock_t* lock)
+{
+    if (!lock) {
+        return;
+    }
+    spinlock_lock_at(lock, (uintptr_t)__builtin_return_address(0));
+}
+
+static inline void spinlock_release(spinlock_t* lock)
+{
+#ifdef CONFIG_LOCK_CLASSES
+    lockstat_released(lock->cls, cpu_get_time() - lock->acquired_tsc);
+    lockdep_release(lock->cls, lock);
+#endif
+    __atomic_store_n(&lock->ticket.owner, (uint16_t)(lock->ticket.owner + 1u), __ATOMIC_RELEASE);
+}
+
 void spinlock_unlock(spinlock_t* lock)
 {
     if (!lock) {
         return;
     }
-    
-    __asm__ volatile ("" ::: "memory");
-    __sync_lock_release(&lock->locked);
+    spinlock_release(lock);
+    preempt_enable();
 }
 
 bool spinlock_trylock(spinlock_t* lock)
@@ -42,6 +109,52 @@ bool spinlock_trylock(spinlock_t* lock)
         return false;
     }
     
-    return __sync_lock_test_and_set(&lock->locked, 1) == 0;
+    uintptr_t ip = (uintptr_t)__builtin_return_address(0);
+    preempt_disable_at(ip);
+    uint32_t old = __atomic_load_n(&lock->tickets, __ATOMIC_RELAXED);
+    if ((uint16_t)old != (uint16_t)(old >> 16) ||
+        !__atomic_compare_exchange_n(&lock->tickets, &old, old + SPIN_TICKET_NEXT, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        preempt_enable_no_resched();
+        return false;
+    }
+#ifdef CONFIG_LOCK_CLASSES
+    if (!lock->cls) {
+        lock->cls = lock_class_get(NULL, LOCK_KIND_SPIN, ip);
+    }
+    lockdep_acquire(lock->cls, lock, ip, 1);
+    lock->acquired_tsc = cpu_get_time();
+    lockstat_acquired(lock->cls, ip, 0, 0);
+#endif
+    return true;
 }
 
+bool spinlock_is_locked(const spinlock_t* lock)
+{
+    if (!lock) {
+        return false;
+    }
+    uint32_t v = __atomic_load_n(&lock->tickets, __ATOMIC_RELAXED);
+    return (uint16_t)v != (uint16_t)(v >> 16);
+}
+
+irql_t spinlock_lock_irqsave(spinlock_t* lock)
+{
+    irql_t old = set_irql(IRQL_HIGH);
+    if (lock) {
+        spinlock_lock_at(lock, (uintptr_t)__builtin_return_address(0));
+    }
+    return old;
+}
+
+void spinlock_unlock_irqrestore(spinlock_t* lock, irql_t old)
+{
+    if (lock) {
+        spinlock_release(lock);
+    }
+    (void)set_irql(old);
+    /* After IRQL is back down, so a pending reschedule can happen here. */
+    if (lock) {
+        preempt_enable();
+    }
+}
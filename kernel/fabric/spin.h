@@ -1,6 +1,18 @@
 /**
  * @file spin.h
- * @brief Simple spinlock implementation for Fabric
+ * @brief Ticket spinlocks for Fabric
+ *
+ * A ticket lock hands the lock out in arrival order: lockers take the next
+ * ticket with one atomic add and spin until the owner counter reaches it,
+ * so a waiter cannot be starved by a luckier CPU re-taking the cache line.
+ *
+ * The plain lock/unlock pair does not touch IRQL. Data that is also used
+ * from interrupt context must go through the _irqsave variants, which raise
+ * IRQL to IRQL_HIGH before taking the lock and restore it after release.
+ *
+ * An all-zero spinlock_t is a valid unlocked lock, so a static lock can be
+ * taken before (or without) spinlock_init(); with lock classes enabled it is
+ * then classed by its first acquisition site instead of its name.
  */
 
 #ifndef _RODNIX_FABRIC_SPIN_H
@@ -8,15 +20,37 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "../common/lockstat.h"
+#include "../core/interrupts.h"
 
 typedef struct {
-    volatile uint32_t locked;
+    union {
+        volatile uint32_t tickets;    /* both halves, for trylock's compare-and-swap */
+        struct {
+            volatile uint16_t owner;  /* ticket being served */
+            volatile uint16_t next;   /* next ticket handed out */
+        } ticket;
+    };
+#ifdef CONFIG_LOCK_CLASSES
+    struct lock_class* cls;   /* lock class (init site); see kernel/common/lockstat.c */
+    uint64_t acquired_tsc;    /* hold time start */
+#endif
 } spinlock_t;
 
 void spinlock_init(spinlock_t* lock);
+void spinlock_init_named(spinlock_t* lock, const char* name);
 void spinlock_lock(spinlock_t* lock);
 void spinlock_unlock(spinlock_t* lock);
 bool spinlock_trylock(spinlock_t* lock);
+bool spinlock_is_locked(const spinlock_t* lock);
 
-#endif /* _RODNIX_FABRIC_SPIN_H */
+/* Raise IRQL to IRQL_HIGH, then lock; returns the IRQL to hand back on unlock. */
+irql_t spinlock_lock_irqsave(spinlock_t* lock);
+void spinlock_unlock_irqrestore(spinlock_t* lock, irql_t old);
+
+#ifdef CONFIG_LOCK_CLASSES
+/* Name the lock class after the init expression, e.g. "&g_ext2_rw_lock". */
+#define spinlock_init(lock) spinlock_init_named((lock), #lock)
+#endif
 
+#endif /* _RODNIX_FABRIC_SPIN_H */
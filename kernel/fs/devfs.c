@@ -13,7 +13,7 @@ typedef struct {
 } devfs_pending_block_t;
 
 static vfs_node_t* g_devfs_root = NULL;
-static devfs_pending_block_t g_pending_blocks[16];
+static devfs_pending_block_t g_pending_blocks[32];
 static uint32_t g_pending_block_count = 0;
 
 static vfs_node_t* devfs_find_child(vfs_node_t* root, const char* name)
@@ -96,6 +96,12 @@ static int devfs_mount(const char* source, vfs_node_t** out_root)
     if (devfs_add_chardev(root, "zero", VFS_INODE_DEV_ZERO) != RDNX_OK) {
         return RDNX_E_NOMEM;
     }
+    if (devfs_add_chardev(root, "random", VFS_INODE_DEV_RANDOM) != RDNX_OK) {
+        return RDNX_E_NOMEM;
+    }
+    if (devfs_add_chardev(root, "urandom", VFS_INODE_DEV_URANDOM) != RDNX_OK) {
+        return RDNX_E_NOMEM;
+    }
     for (uint32_t i = 0; i < g_pending_block_count; i++) {
         if (devfs_add_blockdev(root, g_pending_blocks[i].name) != RDNX_OK) {
             return RDNX_E_NOMEM;
@@ -142,3 +148,20 @@ int devfs_register_blockdev(const char* name)
     g_pending_block_count++;
     return RDNX_OK;
 }
+
+int devfs_unregister_blockdev(const char* name)
+{
+    if (!name || !name[0]) {
+        return RDNX_E_INVALID;
+    }
+    for (uint32_t i = 0; i < g_pending_block_count; i++) {
+        if (strcmp(g_pending_blocks[i].name, name) == 0) {
+            g_pending_blocks[i] = g_pending_blocks[--g_pending_block_count];
+            break;
+        }
+    }
+    if (g_devfs_root) {
+        return vfs_fs_remove_child(g_devfs_root, name);
+    }
+    return RDNX_OK;
+}
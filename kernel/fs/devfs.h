@@ -7,3 +7,4 @@
 
 int devfs_fs_init(void);
 int devfs_register_blockdev(const char* name);
+int devfs_unregister_blockdev(const char* name);
@@ -1,16 +1,19 @@
 /**
  * @file ext2.c
- * @brief Read-only EXT2 mount driver (inode/dir traversal)
+ * @brief EXT2 mount driver with ext4 extent and sparse/large file support
  *
  * Structures and traversal follow a compact loader-oriented EXT2 layout
- * adapted for RodNIX.
+ * adapted for RodNIX. Regular file data is not preloaded at mount: reads
+ * stream from the block device through the inode's block map or extent
+ * tree, and holes / unwritten extents read as zeros.
  */
 
 #include "ext2.h"
 #include "vfs.h"
 #include "../common/heap.h"
 #include "../common/kmod.h"
-#include "../fabric/spin.h"
+#include "../common/mutex.h"
+#include "../common/preempt.h"
 #include "../fabric/service/block_service.h"
 #include "../../../include/common.h"
 #include "../../include/console.h"
@@ -25,15 +28,46 @@
 #define EXT2_S_IFDIR 0x4000u
 #define EXT2_S_IFREG 0x8000u
 #define EXT2_NDIR_BLOCKS 12u
+#define EXT2_IND_BLOCK 12u
+#define EXT2_DIND_BLOCK 13u
+#define EXT2_TIND_BLOCK 14u
 
 #define EXT2_MAX_BLOCK_SIZE 4096u
 #define EXT2_MAX_INODE_SIZE 512u
 #define EXT2_MAX_TREE_DEPTH 4u
 #define EXT2_MAX_TREE_NODES 2048u
-#define EXT2_MAX_FILE_BYTES (64u * 1024u * 1024u) /* preload cap; files > 64 MB truncated at mount */
+#define EXT2_MAX_FILE_BYTES (64u * 1024u * 1024u) /* cap for whole-file loads (mmap) */
+#define EXT2_MAX_IO_BLOCKS 64u                    /* blocks per coalesced device request */
+#define EXT2_META_SLOTS 16u                       /* cached bitmap / map / extent blocks */
 
 #define EXT2_FEATURE_INCOMPAT_FILETYPE 0x0002u
-#define EXT2_FEATURE_INCOMPAT_SUPP (EXT2_FEATURE_INCOMPAT_FILETYPE)
+#define EXT2_FEATURE_INCOMPAT_EXTENTS  0x0040u
+#define EXT2_FEATURE_INCOMPAT_FLEX_BG  0x0200u
+#define EXT2_FEATURE_INCOMPAT_SUPP (EXT2_FEATURE_INCOMPAT_FILETYPE | \
+                                    EXT2_FEATURE_INCOMPAT_EXTENTS | \
+                                    EXT2_FEATURE_INCOMPAT_FLEX_BG)
+
+#define EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER 0x0001u
+#define EXT2_FEATURE_RO_COMPAT_LARGE_FILE   0x0002u
+#define EXT2_FEATURE_RO_COMPAT_HUGE_FILE    0x0008u
+#define EXT2_FEATURE_RO_COMPAT_DIR_NLINK    0x0020u
+#define EXT2_FEATURE_RO_COMPAT_EXTRA_ISIZE  0x0040u
+/* Anything else (group/metadata checksums, quota, ...) mounts read-only. */
+#define EXT2_FEATURE_RO_COMPAT_WRITE_SUPP (EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER | \
+                                           EXT2_FEATURE_RO_COMPAT_LARGE_FILE | \
+                                           EXT2_FEATURE_RO_COMPAT_HUGE_FILE | \
+                                           EXT2_FEATURE_RO_COMPAT_DIR_NLINK | \
+                                           EXT2_FEATURE_RO_COMPAT_EXTRA_ISIZE)
+
+#define EXT4_HUGE_FILE_FL 0x00040000u
+#define EXT4_EXTENTS_FL   0x00080000u
+
+#define EXT4_EXT_MAGIC 0xF30Au
+#define EXT4_EXT_MAX_DEPTH 5u
+#define EXT4_EXT_INIT_MAX_LEN 32768u
+#define EXT4_EXT_UNINIT_MAX_LEN 32767u
+#define EXT4_EXT_ROOT_ENTRIES 4u
+#define EXT4_EXT_RETRY 1 /* tree reshaped; caller re-walks the path */
 
 typedef struct __attribute__((packed)) {
     uint32_t inodes_count;
@@ -108,6 +142,41 @@ typedef struct __attribute__((packed)) {
     uint8_t file_type;
 } ext2_dirent_hdr_t;
 
+/* ext4 extent tree: i_block[] holds the root node (header + 4 entries). */
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint16_t entries;
+    uint16_t max;
+    uint16_t depth;
+    uint32_t generation;
+} ext4_extent_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t block;    /* first logical block */
+    uint16_t len;      /* > EXT4_EXT_INIT_MAX_LEN: unwritten (preallocated) */
+    uint16_t start_hi;
+    uint32_t start_lo;
+} ext4_extent_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t block;    /* first logical block covered by the child */
+    uint32_t leaf_lo;
+    uint16_t leaf_hi;
+    uint16_t unused;
+} ext4_extent_idx_t;
+
+/*
+ * Small write-back cache for metadata the allocator and block mapper touch
+ * on every data block: group bitmaps, indirect tables and extent nodes.
+ * Dirty slots are written by ext2_flush() at the end of each operation.
+ */
+typedef struct {
+    uint32_t block_no; /* 0 = empty */
+    uint32_t last_use;
+    uint8_t dirty;
+    uint8_t* data;
+} ext2_meta_slot_t;
+
 typedef struct {
     fabric_blockdev_t* bdev;
     ext2_superblock_t sb;
@@ -117,24 +186,46 @@ typedef struct {
     uint32_t inode_size;
     uint32_t sector_size;
     uint32_t node_budget;
+    uint8_t read_only;
+    uint8_t super_dirty;
+    uint32_t meta_clock;
+    ext2_meta_slot_t meta[EXT2_META_SLOTS];
 } ext2_mount_ctx_t;
 
+/* One level of an extent tree walk; lv[0] is the in-inode root. */
+typedef struct {
+    uint32_t blk;   /* node block, 0 for the root */
+    uint8_t* node;  /* root: ino->block, otherwise a private copy */
+    int32_t pos;    /* entry followed / found at this level, -1 if none */
+} ext2_ext_level_t;
+
+typedef struct {
+    uint32_t depth;
+    ext2_ext_level_t lv[EXT4_EXT_MAX_DEPTH + 1u];
+} ext2_ext_path_t;
+
 /*
- * LOCKING: g_ext2_rw_lock (spinlock_t)
- *   Protects: g_ext2_live (all fields), g_ext2_live_ready,
- *             ext2_alloc_block, ext2_free_block, ext2_sync_super_and_gdt,
- *             ext2_writeback_file, ext2_resize_file.
+ * LOCKING: g_ext2_rw_lock (mutex_t: held across block I/O, so long
+ *          reads and writes reach cond_resched() with preemption on)
+ *   Protects: g_ext2_live (all fields, including the metadata cache),
+ *             g_ext2_live_ready, ext2_alloc_run, ext2_free_run,
+ *             ext2_flush, ext2_read_file, ext2_writeback_file,
+ *             ext2_resize_file, ext2_fallocate_file, ext2_fsync_file,
+ *             ext2_sync_fs.
  *   Lock order: g_ext2_rw_lock -> (no inner locks held by ext2 code).
- *   Callers of ext2_alloc_block / ext2_free_block / ext2_trim_inode_blocks
+ *   Callers of ext2_alloc_run / ext2_free_run / ext2_trim_inode_blocks
  *   must already hold g_ext2_rw_lock (caller-holds convention).
  */
 static ext2_mount_ctx_t g_ext2_live;
 static int g_ext2_live_ready = 0;
-static spinlock_t g_ext2_rw_lock;
+static mutex_t g_ext2_rw_lock;
 static const ext2_fs_caps_t g_ext2_caps = {
     .write_in_place = 1,
     .write_extend = 1,
     .truncate = 1,
+    .sparse = 1,
+    .extents = 1,
+    .preallocate = 1,
 };
 
 static uint64_t ext2_inode_size_bytes(const ext2_inode_t* ino)
@@ -156,6 +247,16 @@ static uint64_t ext2_inode_size_bytes(const ext2_inode_t* ino)
     return sz;
 }
 
+static void ext2_inode_set_size(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint64_t size)
+{
+    ino->size_lo   = (uint32_t)(size & 0xFFFFFFFFu);
+    ino->size_high = (uint32_t)(size >> 32);
+    if (size > 0x7FFFFFFFull && !(ctx->sb.feature_ro_compat & EXT2_FEATURE_RO_COMPAT_LARGE_FILE)) {
+        ctx->sb.feature_ro_compat |= EXT2_FEATURE_RO_COMPAT_LARGE_FILE;
+        ctx->super_dirty = 1;
+    }
+}
+
 static int ext2_is_dir(const ext2_inode_t* ino)
 {
     return ino && ((ino->mode & 0xF000u) == EXT2_S_IFDIR);
@@ -166,6 +267,11 @@ static int ext2_is_reg(const ext2_inode_t* ino)
     return ino && ((ino->mode & 0xF000u) == EXT2_S_IFREG);
 }
 
+static int ext2_has_extents(const ext2_inode_t* ino)
+{
+    return ino && (ino->flags & EXT4_EXTENTS_FL) != 0;
+}
+
 static void ext2_mark_node(vfs_node_t* node, uint32_t ino_num)
 {
     if (!node || !node->inode) {
@@ -175,12 +281,18 @@ static void ext2_mark_node(vfs_node_t* node, uint32_t ino_num)
     node->inode->fs_ino = (uint64_t)ino_num;
 }
 
-static int ext2_read_bytes(ext2_mount_ctx_t* ctx, uint64_t offset, void* out, uint32_t len)
+static int ext2_dev_read(ext2_mount_ctx_t* ctx, uint64_t offset, void* out, uint32_t len)
 {
     if (!ctx || !ctx->bdev || !out || len == 0 || ctx->sector_size == 0) {
         return RDNX_E_INVALID;
     }
 
+    /* Whole sectors go straight to the device as one request. */
+    if ((offset % ctx->sector_size) == 0 && (len % ctx->sector_size) == 0) {
+        return fabric_blockdev_read(ctx->bdev, offset / ctx->sector_size,
+                                    len / ctx->sector_size, out);
+    }
+
     uint8_t secbuf[512];
     if (ctx->sector_size > sizeof(secbuf)) {
         return RDNX_E_UNSUPPORTED;
@@ -209,12 +321,22 @@ static int ext2_read_bytes(ext2_mount_ctx_t* ctx, uint64_t offset, void* out, ui
     return RDNX_OK;
 }
 
-static int ext2_write_bytes(ext2_mount_ctx_t* ctx, uint64_t offset, const void* in, uint32_t len)
+/*
+ * req_flags are FABRIC_BLOCKDEV_REQ_*: PREFLUSH goes with the first sector
+ * written, FUA with the last, so a partial-sector write keeps both.
+ */
+static int ext2_dev_write_req(ext2_mount_ctx_t* ctx, uint64_t offset, const void* in, uint32_t len,
+                              uint32_t req_flags)
 {
     if (!ctx || !ctx->bdev || !in || len == 0 || ctx->sector_size == 0) {
         return RDNX_E_INVALID;
     }
 
+    if ((offset % ctx->sector_size) == 0 && (len % ctx->sector_size) == 0) {
+        return fabric_blockdev_write_req(ctx->bdev, offset / ctx->sector_size,
+                                         len / ctx->sector_size, in, req_flags);
+    }
+
     uint8_t secbuf[512];
     if (ctx->sector_size > sizeof(secbuf)) {
         return RDNX_E_UNSUPPORTED;
@@ -241,7 +363,14 @@ static int ext2_write_bytes(ext2_mount_ctx_t* ctx, uint64_t offset, const void*
         }
         memcpy(&secbuf[sec_off], src, chunk);
 
-        int wrc = fabric_blockdev_write(ctx->bdev, sec, 1, secbuf);
+        uint32_t flags = req_flags;
+        if (cur != offset) {
+            flags &= ~(uint32_t)FABRIC_BLOCKDEV_REQ_PREFLUSH;
+        }
+        if (chunk < left) {
+            flags &= ~(uint32_t)FABRIC_BLOCKDEV_REQ_FUA;
+        }
+        int wrc = fabric_blockdev_write_req(ctx->bdev, sec, 1, secbuf, flags);
         if (wrc != RDNX_OK) {
             return wrc;
         }
@@ -253,11 +382,226 @@ static int ext2_write_bytes(ext2_mount_ctx_t* ctx, uint64_t offset, const void*
     return RDNX_OK;
 }
 
+static ext2_meta_slot_t* ext2_meta_find(ext2_mount_ctx_t* ctx, uint32_t block_no)
+{
+    if (block_no == 0) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < EXT2_META_SLOTS; i++) {
+        ext2_meta_slot_t* s = &ctx->meta[i];
+        if (s->block_no == block_no && s->data) {
+            s->last_use = ++ctx->meta_clock;
+            return s;
+        }
+    }
+    return NULL;
+}
+
+static int ext2_meta_writeback(ext2_mount_ctx_t* ctx, ext2_meta_slot_t* s)
+{
+    if (!s->dirty) {
+        return RDNX_OK;
+    }
+    int rc = ext2_dev_write_req(ctx, (uint64_t)s->block_no * ctx->block_size, s->data, ctx->block_size, 0);
+    if (rc == RDNX_OK) {
+        s->dirty = 0;
+    }
+    return rc;
+}
+
+/* Take the least recently used slot for block_no; contents are undefined. */
+static int ext2_meta_claim(ext2_mount_ctx_t* ctx, uint32_t block_no, ext2_meta_slot_t** out)
+{
+    ext2_meta_slot_t* victim = &ctx->meta[0];
+    for (uint32_t i = 0; i < EXT2_META_SLOTS; i++) {
+        ext2_meta_slot_t* s = &ctx->meta[i];
+        if (s->block_no == 0 || !s->data) {
+            victim = s;
+            break;
+        }
+        if (s->last_use < victim->last_use) {
+            victim = s;
+        }
+    }
+    if (victim->block_no != 0) {
+        int rc = ext2_meta_writeback(ctx, victim);
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+    }
+    if (!victim->data) {
+        victim->data = (uint8_t*)kmalloc(ctx->block_size);
+        if (!victim->data) {
+            return RDNX_E_NOMEM;
+        }
+    }
+    victim->block_no = block_no;
+    victim->dirty = 0;
+    victim->last_use = ++ctx->meta_clock;
+    *out = victim;
+    return RDNX_OK;
+}
+
+/*
+ * Return a cached copy of a metadata block. The pointer stays valid only
+ * until the next ext2_meta_* call; mark it dirty after modifying it.
+ */
+static int ext2_meta_get(ext2_mount_ctx_t* ctx, uint32_t block_no, uint8_t** out)
+{
+    if (block_no == 0 || block_no >= ctx->sb.blocks_count) {
+        return RDNX_E_INVALID;
+    }
+    ext2_meta_slot_t* s = ext2_meta_find(ctx, block_no);
+    if (!s) {
+        int rc = ext2_meta_claim(ctx, block_no, &s);
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+        rc = ext2_dev_read(ctx, (uint64_t)block_no * ctx->block_size, s->data, ctx->block_size);
+        if (rc != RDNX_OK) {
+            s->block_no = 0;
+            return rc;
+        }
+    }
+    *out = s->data;
+    return RDNX_OK;
+}
+
+static void ext2_meta_mark_dirty(ext2_mount_ctx_t* ctx, uint32_t block_no)
+{
+    for (uint32_t i = 0; i < EXT2_META_SLOTS; i++) {
+        if (ctx->meta[i].block_no == block_no && ctx->meta[i].data) {
+            ctx->meta[i].dirty = 1;
+            return;
+        }
+    }
+}
+
+/* Replace a metadata block's contents in the cache; written by ext2_flush(). */
+static int ext2_meta_store(ext2_mount_ctx_t* ctx, uint32_t block_no, const void* data)
+{
+    ext2_meta_slot_t* s = ext2_meta_find(ctx, block_no);
+    if (!s) {
+        int rc = ext2_meta_claim(ctx, block_no, &s);
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+    }
+    if (s->data != data) {
+        memcpy(s->data, data, ctx->block_size);
+    }
+    s->dirty = 1;
+    return RDNX_OK;
+}
+
+/* Drop a freed block from the cache without writing it. */
+static void ext2_meta_forget(ext2_mount_ctx_t* ctx, uint32_t block_no)
+{
+    for (uint32_t i = 0; i < EXT2_META_SLOTS; i++) {
+        if (ctx->meta[i].block_no == block_no) {
+            ctx->meta[i].block_no = 0;
+            ctx->meta[i].dirty = 0;
+        }
+    }
+}
+
+static int ext2_meta_flush(ext2_mount_ctx_t* ctx)
+{
+    int result = RDNX_OK;
+    for (uint32_t i = 0; i < EXT2_META_SLOTS; i++) {
+        ext2_meta_slot_t* s = &ctx->meta[i];
+        if (s->block_no != 0 && s->dirty) {
+            int rc = ext2_meta_writeback(ctx, s);
+            if (rc != RDNX_OK && result == RDNX_OK) {
+                result = rc;
+            }
+        }
+    }
+    return result;
+}
+
+static void ext2_meta_release(ext2_mount_ctx_t* ctx)
+{
+    for (uint32_t i = 0; i < EXT2_META_SLOTS; i++) {
+        if (ctx->meta[i].data) {
+            kfree(ctx->meta[i].data);
+        }
+        ctx->meta[i].data = NULL;
+        ctx->meta[i].block_no = 0;
+        ctx->meta[i].dirty = 0;
+    }
+}
+
+static int ext2_read_bytes(ext2_mount_ctx_t* ctx, uint64_t offset, void* out, uint32_t len)
+{
+    if (!ctx || !out || len == 0) {
+        return RDNX_E_INVALID;
+    }
+    /* Cached metadata may be newer than the disk copy. */
+    if (ctx->block_size != 0) {
+        for (uint32_t i = 0; i < EXT2_META_SLOTS; i++) {
+            ext2_meta_slot_t* s = &ctx->meta[i];
+            uint64_t b0 = (uint64_t)s->block_no * ctx->block_size;
+            if (s->block_no != 0 && s->dirty && b0 < offset + len && offset < b0 + ctx->block_size) {
+                int rc = ext2_meta_writeback(ctx, s);
+                if (rc != RDNX_OK) {
+                    return rc;
+                }
+            }
+        }
+    }
+    return ext2_dev_read(ctx, offset, out, len);
+}
+
+static int ext2_write_bytes_req(ext2_mount_ctx_t* ctx, uint64_t offset, const void* in, uint32_t len,
+                                uint32_t req_flags)
+{
+    if (!ctx || !in || len == 0) {
+        return RDNX_E_INVALID;
+    }
+    uint64_t end = offset + len;
+    if (ctx->block_size != 0) {
+        for (uint32_t i = 0; i < EXT2_META_SLOTS; i++) {
+            ext2_meta_slot_t* s = &ctx->meta[i];
+            uint64_t b0 = (uint64_t)s->block_no * ctx->block_size;
+            uint64_t b1 = b0 + ctx->block_size;
+            if (s->block_no == 0 || b0 >= end || offset >= b1) {
+                continue;
+            }
+            if (offset <= b0 && end >= b1) {
+                /* Fully overwritten: keep the slot coherent with the new data. */
+                const uint8_t* src = (const uint8_t*)in + (b0 - offset);
+                if (s->data != src) {
+                    memcpy(s->data, src, ctx->block_size);
+                }
+                s->dirty = 0;
+            } else {
+                int rc = ext2_meta_writeback(ctx, s);
+                if (rc != RDNX_OK) {
+                    return rc;
+                }
+                s->block_no = 0;
+            }
+        }
+    }
+    return ext2_dev_write_req(ctx, offset, in, len, req_flags);
+}
+
+static int ext2_write_bytes(ext2_mount_ctx_t* ctx, uint64_t offset, const void* in, uint32_t len)
+{
+    return ext2_write_bytes_req(ctx, offset, in, len, 0);
+}
+
 static int ext2_read_block(ext2_mount_ctx_t* ctx, uint32_t block_no, void* out)
 {
     if (!ctx || !out || ctx->block_size == 0) {
         return RDNX_E_INVALID;
     }
+    ext2_meta_slot_t* s = ext2_meta_find(ctx, block_no);
+    if (s) {
+        memcpy(out, s->data, ctx->block_size);
+        return RDNX_OK;
+    }
     uint64_t byte_off = (uint64_t)block_no * (uint64_t)ctx->block_size;
     return ext2_read_bytes(ctx, byte_off, out, ctx->block_size);
 }
@@ -271,20 +615,42 @@ static int ext2_write_block(ext2_mount_ctx_t* ctx, uint32_t block_no, const void
     return ext2_write_bytes(ctx, byte_off, in, ctx->block_size);
 }
 
-static int ext2_sync_super_and_gdt(ext2_mount_ctx_t* ctx)
+/*
+ * GDT first, superblock last. With commit the superblock is written
+ * PREFLUSH|FUA: everything written before it (data, metadata, GDT) reaches
+ * the medium first, and the superblock itself is durable on return, so
+ * the device cache is only drained when a sync asks for it.
+ */
+static int ext2_sync_super_and_gdt(ext2_mount_ctx_t* ctx, bool commit)
 {
     if (!ctx || !ctx->gdt || ctx->group_count == 0) {
         return RDNX_E_INVALID;
     }
 
-    int rc = ext2_write_bytes(ctx, 1024u, &ctx->sb, sizeof(ctx->sb));
+    uint64_t gdt_off = (uint64_t)(ctx->sb.first_data_block + 1u) * ctx->block_size;
+    uint32_t gdt_size = ctx->group_count * (uint32_t)sizeof(ext2_group_desc_t);
+    int rc = ext2_write_bytes(ctx, gdt_off, ctx->gdt, gdt_size);
     if (rc != RDNX_OK) {
         return rc;
     }
+    const uint32_t flags = commit ? (FABRIC_BLOCKDEV_REQ_PREFLUSH | FABRIC_BLOCKDEV_REQ_FUA) : 0u;
+    return ext2_write_bytes_req(ctx, 1024u, &ctx->sb, sizeof(ctx->sb), flags);
+}
 
-    uint64_t gdt_off = (uint64_t)(ctx->sb.first_data_block + 1u) * ctx->block_size;
-    uint32_t gdt_size = ctx->group_count * (uint32_t)sizeof(ext2_group_desc_t);
-    return ext2_write_bytes(ctx, gdt_off, ctx->gdt, gdt_size);
+/* Write cached metadata and, if counters changed, the superblock and GDT. */
+static int ext2_flush(ext2_mount_ctx_t* ctx)
+{
+    int rc = ext2_meta_flush(ctx);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    if (ctx->super_dirty) {
+        rc = ext2_sync_super_and_gdt(ctx, false);
+        if (rc == RDNX_OK) {
+            ctx->super_dirty = 0;
+        }
+    }
+    return rc;
 }
 
 static int ext2_read_inode(ext2_mount_ctx_t* ctx, uint32_t ino_num, ext2_inode_t* out)
@@ -350,782 +716,1159 @@ static int ext2_write_inode(ext2_mount_ctx_t* ctx, uint32_t ino_num, const ext2_
     return ext2_write_bytes(ctx, inode_off, raw, ctx->inode_size);
 }
 
-static int ext2_alloc_block(ext2_mount_ctx_t* ctx, uint32_t* out_blk)
+static uint32_t ext2_group_blocks(const ext2_mount_ctx_t* ctx, uint32_t g)
+{
+    uint32_t total_data_blocks = ctx->sb.blocks_count - ctx->sb.first_data_block;
+    uint32_t gbase = g * ctx->sb.blocks_per_group;
+    if (gbase >= total_data_blocks) {
+        return 0;
+    }
+    uint32_t n = total_data_blocks - gbase;
+    return (n > ctx->sb.blocks_per_group) ? ctx->sb.blocks_per_group : n;
+}
+
+/* Allocation goal for an inode with no blocks yet: the start of its group. */
+static uint32_t ext2_inode_goal(const ext2_mount_ctx_t* ctx, uint32_t ino_num)
 {
-    if (!ctx || !ctx->gdt || !out_blk || ctx->block_size == 0) {
+    uint32_t g = (ino_num - 1u) / ctx->sb.inodes_per_group;
+    if (g >= ctx->group_count) {
+        g = 0;
+    }
+    return ctx->sb.first_data_block + g * ctx->sb.blocks_per_group;
+}
+
+/*
+ * Allocate up to max_count contiguous free blocks. The search starts at
+ * goal (normally the block after the file's previous one) so sequential
+ * writes stay physically contiguous and extents can merge.
+ */
+static int ext2_alloc_run(ext2_mount_ctx_t* ctx, uint32_t goal, uint32_t max_count,
+                          uint32_t* out_start, uint32_t* out_count)
+{
+    if (!ctx || !ctx->gdt || !out_start || !out_count || max_count == 0 || ctx->block_size == 0) {
         return RDNX_E_INVALID;
     }
     if (ctx->sb.free_blocks_count == 0) {
         return RDNX_E_GENERIC;
     }
-
-    uint8_t* bmap = (uint8_t*)kmalloc(ctx->block_size);
-    if (!bmap) {
-        return RDNX_E_NOMEM;
+    if (goal < ctx->sb.first_data_block || goal >= ctx->sb.blocks_count) {
+        goal = ctx->sb.first_data_block;
     }
 
-    uint32_t total_data_blocks = ctx->sb.blocks_count - ctx->sb.first_data_block;
-    for (uint32_t g = 0; g < ctx->group_count; g++) {
-        if (ctx->gdt[g].free_blocks_count == 0 || ctx->gdt[g].block_bitmap == 0) {
-            continue;
+    uint32_t rel = goal - ctx->sb.first_data_block;
+    uint32_t gstart = rel / ctx->sb.blocks_per_group;
+    uint32_t bstart = rel % ctx->sb.blocks_per_group;
+    for (uint32_t k = 0; k <= ctx->group_count; k++) {
+        uint32_t g = (gstart + k) % ctx->group_count;
+        uint32_t from = (k == 0) ? bstart : 0;
+        uint32_t to = ext2_group_blocks(ctx, g);
+        if (k == ctx->group_count) {
+            /* Wrapped around: the part of the first group before goal. */
+            if (bstart == 0) {
+                break;
+            }
+            to = bstart;
         }
-
-        uint32_t gbase = g * ctx->sb.blocks_per_group;
-        if (gbase >= total_data_blocks) {
+        if (ctx->gdt[g].free_blocks_count == 0 || ctx->gdt[g].block_bitmap == 0 || from >= to) {
             continue;
         }
-        uint32_t group_blocks = total_data_blocks - gbase;
-        if (group_blocks > ctx->sb.blocks_per_group) {
-            group_blocks = ctx->sb.blocks_per_group;
-        }
 
-        int rc = ext2_read_block(ctx, ctx->gdt[g].block_bitmap, bmap);
+        uint8_t* bmap = NULL;
+        int rc = ext2_meta_get(ctx, ctx->gdt[g].block_bitmap, &bmap);
         if (rc != RDNX_OK) {
-            kfree(bmap);
             return rc;
         }
 
-        for (uint32_t bi = 0; bi < group_blocks; bi++) {
-            uint32_t byte = bi >> 3;
-            uint8_t mask = (uint8_t)(1u << (bi & 7u));
-            if ((bmap[byte] & mask) != 0) {
+        uint32_t bi = from;
+        while (bi < to) {
+            if ((bi & 7u) == 0 && bmap[bi >> 3] == 0xFFu) {
+                bi += 8u;
                 continue;
             }
-
-            bmap[byte] |= mask;
-            rc = ext2_write_block(ctx, ctx->gdt[g].block_bitmap, bmap);
-            if (rc != RDNX_OK) {
-                kfree(bmap);
-                return rc;
-            }
-
-            if (ctx->gdt[g].free_blocks_count > 0) {
-                ctx->gdt[g].free_blocks_count--;
-            }
-            if (ctx->sb.free_blocks_count > 0) {
-                ctx->sb.free_blocks_count--;
-            }
-            rc = ext2_sync_super_and_gdt(ctx);
-            if (rc != RDNX_OK) {
-                kfree(bmap);
-                return rc;
+            if ((bmap[bi >> 3] & (uint8_t)(1u << (bi & 7u))) == 0) {
+                break;
             }
+            bi++;
+        }
+        if (bi >= to) {
+            continue;
+        }
 
-            *out_blk = ctx->sb.first_data_block + gbase + bi;
-            kfree(bmap);
-            return RDNX_OK;
+        uint32_t n = 0;
+        while (bi + n < to && n < max_count &&
+               (bmap[(bi + n) >> 3] & (uint8_t)(1u << ((bi + n) & 7u))) == 0) {
+            bmap[(bi + n) >> 3] |= (uint8_t)(1u << ((bi + n) & 7u));
+            n++;
         }
-    }
+        ext2_meta_mark_dirty(ctx, ctx->gdt[g].block_bitmap);
+
+        ctx->gdt[g].free_blocks_count = (ctx->gdt[g].free_blocks_count > n)
+                                        ? (uint16_t)(ctx->gdt[g].free_blocks_count - n) : 0;
+        ctx->sb.free_blocks_count = (ctx->sb.free_blocks_count > n) ? ctx->sb.free_blocks_count - n : 0;
+        ctx->super_dirty = 1;
 
-    kfree(bmap);
+        *out_start = ctx->sb.first_data_block + g * ctx->sb.blocks_per_group + bi;
+        *out_count = n;
+        return RDNX_OK;
+    }
     return RDNX_E_GENERIC;
 }
 
-static int ext2_free_block(ext2_mount_ctx_t* ctx, uint32_t blk)
+static int ext2_alloc_block(ext2_mount_ctx_t* ctx, uint32_t goal, uint32_t* out_blk)
+{
+    uint32_t count = 0;
+    return ext2_alloc_run(ctx, goal, 1, out_blk, &count);
+}
+
+static int ext2_free_run(ext2_mount_ctx_t* ctx, uint32_t start, uint32_t count)
 {
-    if (!ctx || !ctx->gdt || ctx->block_size == 0) {
+    if (!ctx || !ctx->gdt || ctx->block_size == 0 || ctx->sb.blocks_per_group == 0) {
         return RDNX_E_INVALID;
     }
-    if (blk < ctx->sb.first_data_block || blk >= ctx->sb.blocks_count) {
+    if (start < ctx->sb.first_data_block || start >= ctx->sb.blocks_count ||
+        count > ctx->sb.blocks_count - start) {
         return RDNX_E_INVALID;
     }
 
-    uint32_t rel = blk - ctx->sb.first_data_block;
-    uint32_t total_data_blocks = ctx->sb.blocks_count - ctx->sb.first_data_block;
-    if (rel >= total_data_blocks || ctx->sb.blocks_per_group == 0) {
-        return RDNX_E_INVALID;
-    }
+    while (count > 0) {
+        uint32_t rel = start - ctx->sb.first_data_block;
+        uint32_t g = rel / ctx->sb.blocks_per_group;
+        uint32_t bi = rel % ctx->sb.blocks_per_group;
+        if (g >= ctx->group_count || ctx->gdt[g].block_bitmap == 0) {
+            return RDNX_E_INVALID;
+        }
+        uint32_t n = ext2_group_blocks(ctx, g) - bi;
+        if (n > count) {
+            n = count;
+        }
 
-    uint32_t g = rel / ctx->sb.blocks_per_group;
-    uint32_t bi = rel % ctx->sb.blocks_per_group;
-    if (g >= ctx->group_count || ctx->gdt[g].block_bitmap == 0) {
-        return RDNX_E_INVALID;
-    }
+        uint8_t* bmap = NULL;
+        int rc = ext2_meta_get(ctx, ctx->gdt[g].block_bitmap, &bmap);
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+        uint32_t cleared = 0;
+        for (uint32_t i = bi; i < bi + n; i++) {
+            uint8_t mask = (uint8_t)(1u << (i & 7u));
+            if (bmap[i >> 3] & mask) {
+                bmap[i >> 3] &= (uint8_t)~mask;
+                cleared++;
+            }
+        }
+        ext2_meta_mark_dirty(ctx, ctx->gdt[g].block_bitmap);
+        for (uint32_t i = 0; i < n; i++) {
+            ext2_meta_forget(ctx, start + i);
+        }
 
-    uint8_t* bmap = (uint8_t*)kmalloc(ctx->block_size);
-    if (!bmap) {
-        return RDNX_E_NOMEM;
+        uint32_t gfree = (uint32_t)ctx->gdt[g].free_blocks_count + cleared;
+        ctx->gdt[g].free_blocks_count = (gfree > UINT16_MAX) ? UINT16_MAX : (uint16_t)gfree;
+        ctx->sb.free_blocks_count = (ctx->sb.free_blocks_count > UINT32_MAX - cleared)
+                                    ? UINT32_MAX : ctx->sb.free_blocks_count + cleared;
+        ctx->super_dirty = 1;
+        start += n;
+        count -= n;
     }
+    return RDNX_OK;
+}
 
-    int rc = ext2_read_block(ctx, ctx->gdt[g].block_bitmap, bmap);
-    if (rc != RDNX_OK) {
-        kfree(bmap);
-        return rc;
-    }
+static int ext2_free_block(ext2_mount_ctx_t* ctx, uint32_t blk)
+{
+    return ext2_free_run(ctx, blk, 1);
+}
+
+static uint32_t ext2_sectors_per_block(const ext2_mount_ctx_t* ctx)
+{
+    return ctx->block_size / 512u;
+}
+
+static void ext2_inode_add_blocks(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint32_t nblocks)
+{
+    ino->blocks += nblocks * ext2_sectors_per_block(ctx);
+}
 
-    uint32_t byte = bi >> 3;
-    uint8_t mask = (uint8_t)(1u << (bi & 7u));
-    if ((bmap[byte] & mask) == 0) {
-        kfree(bmap);
+static void ext2_inode_sub_blocks(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint32_t nblocks)
+{
+    uint32_t sectors = nblocks * ext2_sectors_per_block(ctx);
+    ino->blocks = (ino->blocks > sectors) ? ino->blocks - sectors : 0;
+}
+
+/* ---- classic block maps: direct, single, double and triple indirect ---- */
+
+/*
+ * Split lbn into the i_block[] slot and per-level table indices.
+ * *out_depth is the number of indirect tables between slot and data.
+ */
+static int ext2_bmap_path(const ext2_mount_ctx_t* ctx, uint32_t lbn,
+                          uint32_t* out_slot, uint32_t idx[3], uint32_t* out_depth)
+{
+    uint64_t per = ctx->block_size / sizeof(uint32_t);
+    uint64_t rel = lbn;
+
+    if (rel < EXT2_NDIR_BLOCKS) {
+        *out_slot = (uint32_t)rel;
+        *out_depth = 0;
         return RDNX_OK;
     }
-    bmap[byte] &= (uint8_t)~mask;
+    rel -= EXT2_NDIR_BLOCKS;
+    if (rel < per) {
+        *out_slot = EXT2_IND_BLOCK;
+        *out_depth = 1;
+        idx[0] = (uint32_t)rel;
+        return RDNX_OK;
+    }
+    rel -= per;
+    if (rel < per * per) {
+        *out_slot = EXT2_DIND_BLOCK;
+        *out_depth = 2;
+        idx[0] = (uint32_t)(rel / per);
+        idx[1] = (uint32_t)(rel % per);
+        return RDNX_OK;
+    }
+    rel -= per * per;
+    if (rel < per * per * per) {
+        *out_slot = EXT2_TIND_BLOCK;
+        *out_depth = 3;
+        idx[0] = (uint32_t)(rel / (per * per));
+        idx[1] = (uint32_t)((rel / per) % per);
+        idx[2] = (uint32_t)(rel % per);
+        return RDNX_OK;
+    }
+    return RDNX_E_UNSUPPORTED;
+}
 
-    rc = ext2_write_block(ctx, ctx->gdt[g].block_bitmap, bmap);
-    kfree(bmap);
+static int ext2_bmap_lookup(ext2_mount_ctx_t* ctx, const ext2_inode_t* ino, uint32_t lbn, uint32_t* out_blk)
+{
+    uint32_t slot = 0;
+    uint32_t depth = 0;
+    uint32_t idx[3];
+    int rc = ext2_bmap_path(ctx, lbn, &slot, idx, &depth);
     if (rc != RDNX_OK) {
         return rc;
     }
 
-    if (ctx->gdt[g].free_blocks_count != UINT16_MAX) {
-        ctx->gdt[g].free_blocks_count++;
-    }
-    if (ctx->sb.free_blocks_count != UINT32_MAX) {
-        ctx->sb.free_blocks_count++;
+    uint32_t blk = ino->block[slot];
+    for (uint32_t l = 0; l < depth && blk != 0; l++) {
+        uint8_t* table = NULL;
+        rc = ext2_meta_get(ctx, blk, &table);
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+        blk = ((const uint32_t*)table)[idx[l]];
     }
-    return ext2_sync_super_and_gdt(ctx);
+    *out_blk = blk;
+    return RDNX_OK;
 }
 
-static int ext2_zero_block(ext2_mount_ctx_t* ctx, uint32_t block_no)
+/*
+ * Map lbn, allocating missing tables and the data block. *out_fresh is set
+ * when the data block is new: its on-disk contents are undefined and the
+ * caller must write the whole block.
+ */
+static int ext2_bmap_alloc(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint32_t lbn, uint32_t goal,
+                           uint32_t* out_blk, int* out_fresh, int* out_inode_dirty)
 {
-    if (!ctx || block_no == 0) {
-        return RDNX_E_INVALID;
-    }
-    uint8_t* zero = (uint8_t*)kmalloc(ctx->block_size);
-    if (!zero) {
-        return RDNX_E_NOMEM;
+    uint32_t slot = 0;
+    uint32_t depth = 0;
+    uint32_t idx[3];
+    int rc = ext2_bmap_path(ctx, lbn, &slot, idx, &depth);
+    if (rc != RDNX_OK) {
+        return rc;
     }
-    memset(zero, 0, ctx->block_size);
-    int rc = ext2_write_block(ctx, block_no, zero);
-    kfree(zero);
-    return rc;
-}
 
-static int ext2_inode_get_block(ext2_mount_ctx_t* ctx,
-                                const ext2_inode_t* ino,
-                                uint32_t lbn,
-                                uint32_t* out_blk)
-{
-    if (!ctx || !ino || !out_blk) {
-        return RDNX_E_INVALID;
-    }
-    if (lbn < EXT2_NDIR_BLOCKS) {
-        *out_blk = ino->block[lbn];
-        return RDNX_OK;
-    }
-
-    uint32_t per_block = ctx->block_size / sizeof(uint32_t);
-    uint32_t idx = lbn - EXT2_NDIR_BLOCKS;
-
-    /* Single indirect: block[12] */
-    if (idx < per_block) {
-        if (ino->block[12] == 0) {
-            *out_blk = 0;
-            return RDNX_OK;
-        }
-        uint8_t* ibuf = (uint8_t*)kmalloc(ctx->block_size);
-        if (!ibuf) {
-            return RDNX_E_NOMEM;
+    *out_fresh = 0;
+    uint32_t blk = ino->block[slot];
+    if (blk == 0) {
+        rc = ext2_alloc_block(ctx, goal, &blk);
+        if (rc != RDNX_OK) {
+            return rc;
         }
-        int rc = ext2_read_block(ctx, ino->block[12], ibuf);
-        if (rc == RDNX_OK) {
-            *out_blk = ((const uint32_t*)ibuf)[idx];
+        if (depth > 0) {
+            ext2_meta_slot_t* s = NULL;
+            rc = ext2_meta_claim(ctx, blk, &s);
+            if (rc != RDNX_OK) {
+                (void)ext2_free_block(ctx, blk);
+                return rc;
+            }
+            memset(s->data, 0, ctx->block_size);
+            s->dirty = 1;
+        } else {
+            *out_fresh = 1;
         }
-        kfree(ibuf);
-        return rc;
+        ino->block[slot] = blk;
+        ext2_inode_add_blocks(ctx, ino, 1);
+        *out_inode_dirty = 1;
     }
 
-    /* Double indirect: block[13] */
-    idx -= per_block;
-    if (idx < per_block * per_block) {
-        if (ino->block[13] == 0) {
-            *out_blk = 0;
-            return RDNX_OK;
-        }
-        uint8_t* ibuf = (uint8_t*)kmalloc(ctx->block_size);
-        if (!ibuf) {
-            return RDNX_E_NOMEM;
-        }
-        int rc = ext2_read_block(ctx, ino->block[13], ibuf);
+    for (uint32_t l = 0; l < depth; l++) {
+        uint8_t* table = NULL;
+        rc = ext2_meta_get(ctx, blk, &table);
         if (rc != RDNX_OK) {
-            kfree(ibuf);
             return rc;
         }
-        uint32_t di_blk = ((const uint32_t*)ibuf)[idx / per_block];
-        if (di_blk == 0) {
-            kfree(ibuf);
-            *out_blk = 0;
-            return RDNX_OK;
-        }
-        rc = ext2_read_block(ctx, di_blk, ibuf);
-        if (rc == RDNX_OK) {
-            *out_blk = ((const uint32_t*)ibuf)[idx % per_block];
-        }
-        kfree(ibuf);
-        return rc;
-    }
-
-    return RDNX_E_UNSUPPORTED;
-}
-
-static int ext2_inode_get_or_alloc_block(ext2_mount_ctx_t* ctx,
-                                         uint32_t ino_num,
-                                         ext2_inode_t* ino,
-                                         uint32_t lbn,
-                                         int alloc,
-                                         uint32_t* out_blk,
-                                         int* out_inode_dirty)
-{
-    if (!ctx || !ino || !out_blk || !out_inode_dirty) {
-        return RDNX_E_INVALID;
-    }
-    *out_blk = 0;
-
-    uint32_t sectors_per_block = ctx->block_size / 512u;
-    if (sectors_per_block == 0) {
-        return RDNX_E_UNSUPPORTED;
-    }
-
-    if (lbn < EXT2_NDIR_BLOCKS) {
-        uint32_t blk = ino->block[lbn];
-        if (blk == 0 && alloc) {
-            int rc = ext2_alloc_block(ctx, &blk);
+        uint32_t child = ((const uint32_t*)table)[idx[l]];
+        if (child == 0) {
+            int is_table = (l + 1u < depth);
+            rc = ext2_alloc_block(ctx, goal, &child);
             if (rc != RDNX_OK) {
                 return rc;
             }
-            rc = ext2_zero_block(ctx, blk);
-            if (rc != RDNX_OK) {
-                return rc;
+            if (is_table) {
+                ext2_meta_slot_t* s = NULL;
+                rc = ext2_meta_claim(ctx, child, &s);
+                if (rc != RDNX_OK) {
+                    (void)ext2_free_block(ctx, child);
+                    return rc;
+                }
+                memset(s->data, 0, ctx->block_size);
+                s->dirty = 1;
+            } else {
+                *out_fresh = 1;
             }
-            ino->block[lbn] = blk;
-            ino->blocks += sectors_per_block;
-            *out_inode_dirty = 1;
-            rc = ext2_write_inode(ctx, ino_num, ino);
+            /* The claim above may have evicted the parent table. */
+            rc = ext2_meta_get(ctx, blk, &table);
             if (rc != RDNX_OK) {
                 return rc;
             }
+            ((uint32_t*)table)[idx[l]] = child;
+            ext2_meta_mark_dirty(ctx, blk);
+            ext2_inode_add_blocks(ctx, ino, 1);
+            *out_inode_dirty = 1;
         }
-        *out_blk = blk;
-        return RDNX_OK;
+        blk = child;
     }
+    *out_blk = blk;
+    return RDNX_OK;
+}
 
-    uint32_t per_block = ctx->block_size / sizeof(uint32_t);
-    uint32_t idx = lbn - EXT2_NDIR_BLOCKS;
+/* Free everything at or beyond keep inside one indirect table. */
+static int ext2_bmap_trim_table(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint32_t table_blk,
+                                uint32_t level, uint64_t base, uint64_t keep, int* out_empty)
+{
+    uint32_t per = ctx->block_size / sizeof(uint32_t);
+    uint64_t span = 1;
+    for (uint32_t i = 1; i < level; i++) {
+        span *= per;
+    }
 
-    /* Single indirect: block[12] */
-    if (idx < per_block) {
-        if (ino->block[12] == 0) {
-            if (!alloc) {
-                return RDNX_OK;
-            }
-            uint32_t ind_blk = 0;
-            int rc = ext2_alloc_block(ctx, &ind_blk);
-            if (rc != RDNX_OK) {
-                return rc;
-            }
-            rc = ext2_zero_block(ctx, ind_blk);
+    uint32_t* table = (uint32_t*)kmalloc(ctx->block_size);
+    if (!table) {
+        return RDNX_E_NOMEM;
+    }
+    int rc = ext2_read_block(ctx, table_blk, table);
+    if (rc != RDNX_OK) {
+        kfree(table);
+        return rc;
+    }
+
+    int dirty = 0;
+    int any = 0;
+    for (uint32_t i = 0; i < per; i++) {
+        uint32_t child = table[i];
+        if (child == 0) {
+            continue;
+        }
+        uint64_t cbase = base + (uint64_t)i * span;
+        if (cbase + span <= keep) {
+            any = 1;
+            continue;
+        }
+        if (level > 1u) {
+            int empty = 0;
+            rc = ext2_bmap_trim_table(ctx, ino, child, level - 1u, cbase, keep, &empty);
             if (rc != RDNX_OK) {
+                kfree(table);
                 return rc;
             }
-            ino->block[12] = ind_blk;
-            ino->blocks += sectors_per_block;
-            *out_inode_dirty = 1;
-            rc = ext2_write_inode(ctx, ino_num, ino);
-            if (rc != RDNX_OK) {
-                return rc;
+            if (!empty) {
+                any = 1;
+                continue;
             }
         }
-
-        uint8_t* ibuf = (uint8_t*)kmalloc(ctx->block_size);
-        if (!ibuf) {
-            return RDNX_E_NOMEM;
-        }
-        int rc = ext2_read_block(ctx, ino->block[12], ibuf);
+        rc = ext2_free_block(ctx, child);
         if (rc != RDNX_OK) {
-            kfree(ibuf);
+            kfree(table);
             return rc;
         }
-        uint32_t* table = (uint32_t*)ibuf;
-        uint32_t blk = table[idx];
-        if (blk == 0 && alloc) {
-            rc = ext2_alloc_block(ctx, &blk);
-            if (rc != RDNX_OK) {
-                kfree(ibuf);
-                return rc;
-            }
-            rc = ext2_zero_block(ctx, blk);
+        ext2_inode_sub_blocks(ctx, ino, 1);
+        table[i] = 0;
+        dirty = 1;
+    }
+
+    if (any && dirty) {
+        rc = ext2_meta_store(ctx, table_blk, table);
+    }
+    kfree(table);
+    *out_empty = !any;
+    return rc;
+}
+
+static int ext2_bmap_trim(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint32_t target_blocks)
+{
+    for (uint32_t i = target_blocks; i < EXT2_NDIR_BLOCKS; i++) {
+        if (ino->block[i] != 0) {
+            int rc = ext2_free_block(ctx, ino->block[i]);
             if (rc != RDNX_OK) {
-                kfree(ibuf);
                 return rc;
             }
-            table[idx] = blk;
-            rc = ext2_write_block(ctx, ino->block[12], ibuf);
+            ext2_inode_sub_blocks(ctx, ino, 1);
+            ino->block[i] = 0;
+        }
+    }
+
+    uint64_t per = ctx->block_size / sizeof(uint32_t);
+    uint64_t base = EXT2_NDIR_BLOCKS;
+    uint64_t span = per;
+    for (uint32_t slot = EXT2_IND_BLOCK; slot <= EXT2_TIND_BLOCK; slot++) {
+        uint32_t level = slot - EXT2_IND_BLOCK + 1u;
+        if (ino->block[slot] != 0 && base + span > target_blocks) {
+            int empty = 0;
+            int rc = ext2_bmap_trim_table(ctx, ino, ino->block[slot], level, base, target_blocks, &empty);
             if (rc != RDNX_OK) {
-                kfree(ibuf);
                 return rc;
             }
-            ino->blocks += sectors_per_block;
-            *out_inode_dirty = 1;
-            rc = ext2_write_inode(ctx, ino_num, ino);
-            if (rc != RDNX_OK) {
-                kfree(ibuf);
-                return rc;
+            if (empty) {
+                rc = ext2_free_block(ctx, ino->block[slot]);
+                if (rc != RDNX_OK) {
+                    return rc;
+                }
+                ext2_inode_sub_blocks(ctx, ino, 1);
+                ino->block[slot] = 0;
             }
         }
-        *out_blk = blk;
-        kfree(ibuf);
-        return RDNX_OK;
+        base += span;
+        span *= per;
     }
+    return RDNX_OK;
+}
 
-    /* Double indirect: block[13] */
-    uint32_t idx2  = idx - per_block;
-    uint32_t di_idx = idx2 / per_block;
-    uint32_t si_idx = idx2 % per_block;
-    if (idx2 >= per_block * per_block) {
-        return RDNX_E_UNSUPPORTED;
+/* ---- ext4 extent trees ---- */
+
+static ext4_extent_header_t* ext2_ext_header(uint8_t* node)
+{
+    return (ext4_extent_header_t*)node;
+}
+
+static uint8_t* ext2_ext_entry(uint8_t* node, uint32_t i)
+{
+    return node + sizeof(ext4_extent_header_t) + (size_t)i * sizeof(ext4_extent_t);
+}
+
+static uint32_t ext2_ext_key(const uint8_t* entry)
+{
+    return ((const ext4_extent_t*)entry)->block;
+}
+
+static uint32_t ext2_ext_len(const ext4_extent_t* e)
+{
+    return (e->len > EXT4_EXT_INIT_MAX_LEN) ? (uint32_t)e->len - EXT4_EXT_INIT_MAX_LEN : e->len;
+}
+
+static int ext2_ext_unwritten(const ext4_extent_t* e)
+{
+    return e->len > EXT4_EXT_INIT_MAX_LEN;
+}
+
+static void ext2_ext_set(ext4_extent_t* e, uint32_t block, uint32_t len, uint32_t start, int unwritten)
+{
+    e->block = block;
+    e->len = (uint16_t)(unwritten ? len + EXT4_EXT_INIT_MAX_LEN : len);
+    e->start_hi = 0;
+    e->start_lo = start;
+}
+
+static uint32_t ext2_ext_block_max(const ext2_mount_ctx_t* ctx)
+{
+    return (ctx->block_size - (uint32_t)sizeof(ext4_extent_header_t)) / (uint32_t)sizeof(ext4_extent_t);
+}
+
+static int ext2_ext_check(const ext2_mount_ctx_t* ctx, uint8_t* node, uint32_t blk, uint32_t depth)
+{
+    const ext4_extent_header_t* h = ext2_ext_header(node);
+    uint32_t limit = (blk == 0) ? EXT4_EXT_ROOT_ENTRIES : ext2_ext_block_max(ctx);
+    if (h->magic != EXT4_EXT_MAGIC || h->max == 0 || h->max > limit || h->entries > h->max ||
+        h->depth != depth) {
+        return RDNX_E_INVALID;
     }
+    return RDNX_OK;
+}
 
-    /* Ensure double indirect table block exists */
-    if (ino->block[13] == 0) {
-        if (!alloc) {
+/* Index of the last entry whose first block is <= lbn, or -1. */
+static int32_t ext2_ext_search(uint8_t* node, uint32_t lbn)
+{
+    const ext4_extent_header_t* h = ext2_ext_header(node);
+    int32_t lo = 0;
+    int32_t hi = (int32_t)h->entries - 1;
+    int32_t found = -1;
+    while (lo <= hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        if (ext2_ext_key(ext2_ext_entry(node, (uint32_t)mid)) <= lbn) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+/*
+ * Read-side lookup through the metadata cache: O(depth * log entries).
+ * *out_run is how many blocks from lbn map the same way (contiguous data,
+ * or hole up to the next extent in this leaf).
+ */
+static int ext2_ext_map(ext2_mount_ctx_t* ctx, const ext2_inode_t* ino, uint32_t lbn,
+                        uint32_t* out_blk, uint32_t* out_run, int* out_unwritten)
+{
+    uint8_t* node = (uint8_t*)ino->block;
+    uint32_t depth = ext2_ext_header(node)->depth;
+    if (depth > EXT4_EXT_MAX_DEPTH || ext2_ext_check(ctx, node, 0, depth) != RDNX_OK) {
+        return RDNX_E_INVALID;
+    }
+
+    /* First block of the next subtree: bounds a hole at the end of a leaf. */
+    uint32_t bound = UINT32_MAX;
+    *out_blk = 0;
+    *out_run = 1;
+    *out_unwritten = 0;
+    for (;;) {
+        ext4_extent_header_t* h = ext2_ext_header(node);
+        int32_t pos = ext2_ext_search(node, lbn);
+        if (h->depth == 0) {
+            if (pos >= 0) {
+                const ext4_extent_t* e = (const ext4_extent_t*)ext2_ext_entry(node, (uint32_t)pos);
+                uint32_t len = ext2_ext_len(e);
+                if (lbn - e->block < len) {
+                    if (e->start_hi != 0) {
+                        return RDNX_E_UNSUPPORTED;
+                    }
+                    *out_blk = e->start_lo + (lbn - e->block);
+                    *out_run = len - (lbn - e->block);
+                    *out_unwritten = ext2_ext_unwritten(e);
+                    return RDNX_OK;
+                }
+            }
+            if ((uint32_t)(pos + 1) < h->entries) {
+                bound = ext2_ext_key(ext2_ext_entry(node, (uint32_t)(pos + 1)));
+            }
+            if (bound > lbn) {
+                *out_run = bound - lbn;
+            }
             return RDNX_OK;
         }
-        uint32_t dind_blk = 0;
-        int rc = ext2_alloc_block(ctx, &dind_blk);
-        if (rc != RDNX_OK) {
-            return rc;
+        if (pos < 0) {
+            if (h->entries > 0 && ext2_ext_key(ext2_ext_entry(node, 0)) > lbn) {
+                *out_run = ext2_ext_key(ext2_ext_entry(node, 0)) - lbn;
+            }
+            return RDNX_OK;
         }
-        rc = ext2_zero_block(ctx, dind_blk);
-        if (rc != RDNX_OK) {
-            return rc;
+        if ((uint32_t)(pos + 1) < h->entries) {
+            bound = ext2_ext_key(ext2_ext_entry(node, (uint32_t)(pos + 1)));
         }
-        ino->block[13] = dind_blk;
-        ino->blocks += sectors_per_block;
-        *out_inode_dirty = 1;
-        rc = ext2_write_inode(ctx, ino_num, ino);
+        const ext4_extent_idx_t* ix = (const ext4_extent_idx_t*)ext2_ext_entry(node, (uint32_t)pos);
+        if (ix->leaf_hi != 0) {
+            return RDNX_E_UNSUPPORTED;
+        }
+        uint32_t child_depth = h->depth - 1u;
+        int rc = ext2_meta_get(ctx, ix->leaf_lo, &node);
         if (rc != RDNX_OK) {
             return rc;
         }
+        if (ext2_ext_check(ctx, node, ix->leaf_lo, child_depth) != RDNX_OK) {
+            return RDNX_E_INVALID;
+        }
     }
+}
 
-    uint8_t* ibuf = (uint8_t*)kmalloc(ctx->block_size);
-    if (!ibuf) {
-        return RDNX_E_NOMEM;
+static void ext2_ext_path_free(ext2_ext_path_t* path)
+{
+    for (uint32_t l = 1; l <= path->depth && l <= EXT4_EXT_MAX_DEPTH; l++) {
+        if (path->lv[l].node) {
+            kfree(path->lv[l].node);
+            path->lv[l].node = NULL;
+        }
     }
+}
 
-    /* Read double indirect table */
-    int rc = ext2_read_block(ctx, ino->block[13], ibuf);
-    if (rc != RDNX_OK) {
-        kfree(ibuf);
-        return rc;
+/* Walk root to leaf for lbn, keeping private copies of every node. */
+static int ext2_ext_find(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint32_t lbn, ext2_ext_path_t* path)
+{
+    memset(path, 0, sizeof(*path));
+    uint8_t* root = (uint8_t*)ino->block;
+    path->depth = ext2_ext_header(root)->depth;
+    if (path->depth > EXT4_EXT_MAX_DEPTH || ext2_ext_check(ctx, root, 0, path->depth) != RDNX_OK) {
+        return RDNX_E_INVALID;
     }
-    uint32_t* di_table = (uint32_t*)ibuf;
-    uint32_t si_blk = di_table[di_idx];
+    path->lv[0].node = root;
 
-    /* Ensure single indirect sub-block exists */
-    if (si_blk == 0) {
-        if (!alloc) {
-            kfree(ibuf);
+    for (uint32_t l = 0;; l++) {
+        uint8_t* node = path->lv[l].node;
+        int32_t pos = ext2_ext_search(node, lbn);
+        path->lv[l].pos = pos;
+        if (l == path->depth) {
             return RDNX_OK;
         }
-        rc = ext2_alloc_block(ctx, &si_blk);
-        if (rc != RDNX_OK) {
-            kfree(ibuf);
-            return rc;
+        if (ext2_ext_header(node)->entries == 0) {
+            ext2_ext_path_free(path);
+            return RDNX_E_INVALID;
         }
-        rc = ext2_zero_block(ctx, si_blk);
-        if (rc != RDNX_OK) {
-            kfree(ibuf);
-            return rc;
+        if (pos < 0) {
+            /* lbn precedes every key: descend leftmost, keys get lowered on insert. */
+            pos = 0;
+            path->lv[l].pos = 0;
         }
-        di_table[di_idx] = si_blk;
-        rc = ext2_write_block(ctx, ino->block[13], ibuf);
-        if (rc != RDNX_OK) {
-            kfree(ibuf);
-            return rc;
+        const ext4_extent_idx_t* ix = (const ext4_extent_idx_t*)ext2_ext_entry(node, (uint32_t)pos);
+        if (ix->leaf_hi != 0) {
+            ext2_ext_path_free(path);
+            return RDNX_E_UNSUPPORTED;
+        }
+        uint8_t* child = (uint8_t*)kmalloc(ctx->block_size);
+        if (!child) {
+            ext2_ext_path_free(path);
+            return RDNX_E_NOMEM;
+        }
+        path->lv[l + 1u].blk = ix->leaf_lo;
+        path->lv[l + 1u].node = child;
+        int rc = ext2_read_block(ctx, ix->leaf_lo, child);
+        if (rc == RDNX_OK && ext2_ext_check(ctx, child, ix->leaf_lo, path->depth - l - 1u) != RDNX_OK) {
+            rc = RDNX_E_INVALID;
         }
-        ino->blocks += sectors_per_block;
-        *out_inode_dirty = 1;
-        rc = ext2_write_inode(ctx, ino_num, ino);
         if (rc != RDNX_OK) {
-            kfree(ibuf);
+            ext2_ext_path_free(path);
             return rc;
         }
     }
+}
 
-    /* Read single indirect sub-table */
-    rc = ext2_read_block(ctx, si_blk, ibuf);
-    if (rc != RDNX_OK) {
-        kfree(ibuf);
-        return rc;
+static int ext2_ext_store(ext2_mount_ctx_t* ctx, ext2_ext_path_t* path, uint32_t l, int* inode_dirty)
+{
+    if (l == 0) {
+        *inode_dirty = 1;
+        return RDNX_OK;
     }
-    uint32_t* si_table = (uint32_t*)ibuf;
-    uint32_t blk = si_table[si_idx];
+    return ext2_meta_store(ctx, path->lv[l].blk, path->lv[l].node);
+}
 
-    if (blk == 0 && alloc) {
-        rc = ext2_alloc_block(ctx, &blk);
-        if (rc != RDNX_OK) {
-            kfree(ibuf);
-            return rc;
+/* Keep parent keys <= the first key of each child after inserting at slot 0. */
+static int ext2_ext_lower_keys(ext2_mount_ctx_t* ctx, ext2_ext_path_t* path, uint32_t l,
+                               uint32_t key, int* inode_dirty)
+{
+    while (l > 0) {
+        l--;
+        ext4_extent_idx_t* ix = (ext4_extent_idx_t*)ext2_ext_entry(path->lv[l].node, (uint32_t)path->lv[l].pos);
+        if (ix->block <= key) {
+            return RDNX_OK;
         }
-        rc = ext2_zero_block(ctx, blk);
-        if (rc != RDNX_OK) {
-            kfree(ibuf);
+        ix->block = key;
+        int rc = ext2_ext_store(ctx, path, l, inode_dirty);
+        if (rc != RDNX_OK || path->lv[l].pos != 0) {
             return rc;
         }
-        si_table[si_idx] = blk;
-        rc = ext2_write_block(ctx, si_blk, ibuf);
+    }
+    return RDNX_OK;
+}
+
+/*
+ * Node at level l is full. Grow the tree (root) or split the node into a
+ * new sibling; either way the path is stale afterwards.
+ */
+static int ext2_ext_make_room(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, ext2_ext_path_t* path,
+                              uint32_t l, uint32_t goal, int* inode_dirty)
+{
+    uint32_t nb = 0;
+    if (l == 0) {
+        if (path->depth >= EXT4_EXT_MAX_DEPTH) {
+            return RDNX_E_UNSUPPORTED;
+        }
+        int rc = ext2_alloc_block(ctx, goal, &nb);
         if (rc != RDNX_OK) {
-            kfree(ibuf);
             return rc;
         }
-        ino->blocks += sectors_per_block;
-        *out_inode_dirty = 1;
-        rc = ext2_write_inode(ctx, ino_num, ino);
+        ext4_extent_header_t* root = ext2_ext_header(path->lv[0].node);
+        uint8_t* child = (uint8_t*)kmalloc(ctx->block_size);
+        if (!child) {
+            (void)ext2_free_block(ctx, nb);
+            return RDNX_E_NOMEM;
+        }
+        memset(child, 0, ctx->block_size);
+        ext4_extent_header_t* ch = ext2_ext_header(child);
+        ch->magic = EXT4_EXT_MAGIC;
+        ch->entries = root->entries;
+        ch->max = (uint16_t)ext2_ext_block_max(ctx);
+        ch->depth = root->depth;
+        memcpy(ext2_ext_entry(child, 0), ext2_ext_entry(path->lv[0].node, 0),
+               (size_t)root->entries * sizeof(ext4_extent_t));
+        rc = ext2_meta_store(ctx, nb, child);
+        kfree(child);
         if (rc != RDNX_OK) {
-            kfree(ibuf);
+            (void)ext2_free_block(ctx, nb);
             return rc;
         }
-    }
-
-    *out_blk = blk;
-    kfree(ibuf);
-    return RDNX_OK;
-}
 
-static uint32_t ext2_count_allocated_blocks(ext2_mount_ctx_t* ctx, const ext2_inode_t* ino)
-{
-    if (!ctx || !ino) {
-        return 0;
+        ext4_extent_idx_t* ix = (ext4_extent_idx_t*)ext2_ext_entry(path->lv[0].node, 0);
+        uint32_t first = ext2_ext_key((const uint8_t*)ix);
+        memset(ix, 0, sizeof(*ix));
+        ix->block = first;
+        ix->leaf_lo = nb;
+        root->entries = 1;
+        root->depth++;
+        ext2_inode_add_blocks(ctx, ino, 1);
+        *inode_dirty = 1;
+        return EXT4_EXT_RETRY;
     }
 
-    uint32_t total = 0;
-    for (uint32_t i = 0; i < EXT2_NDIR_BLOCKS; i++) {
-        if (ino->block[i] != 0) {
-            total++;
-        }
+    if (ext2_ext_header(path->lv[l - 1u].node)->entries >= ext2_ext_header(path->lv[l - 1u].node)->max) {
+        return ext2_ext_make_room(ctx, ino, path, l - 1u, goal, inode_dirty);
     }
 
-    uint32_t per_block = ctx->block_size / sizeof(uint32_t);
+    int rc = ext2_alloc_block(ctx, goal, &nb);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    uint8_t* node = path->lv[l].node;
+    ext4_extent_header_t* h = ext2_ext_header(node);
+    uint8_t* sib = (uint8_t*)kmalloc(ctx->block_size);
+    if (!sib) {
+        (void)ext2_free_block(ctx, nb);
+        return RDNX_E_NOMEM;
+    }
+    uint32_t split = h->entries / 2u;
+    memset(sib, 0, ctx->block_size);
+    ext4_extent_header_t* sh = ext2_ext_header(sib);
+    sh->magic = EXT4_EXT_MAGIC;
+    sh->entries = (uint16_t)(h->entries - split);
+    sh->max = h->max;
+    sh->depth = h->depth;
+    memcpy(ext2_ext_entry(sib, 0), ext2_ext_entry(node, split), (size_t)sh->entries * sizeof(ext4_extent_t));
+    h->entries = (uint16_t)split;
+
+    rc = ext2_meta_store(ctx, nb, sib);
+    if (rc == RDNX_OK) {
+        rc = ext2_ext_store(ctx, path, l, inode_dirty);
+    }
+    if (rc != RDNX_OK) {
+        kfree(sib);
+        return rc;
+    }
+    ext2_inode_add_blocks(ctx, ino, 1);
+
+    /* Link the sibling right after the node in the parent (which has room). */
+    uint8_t* parent = path->lv[l - 1u].node;
+    ext4_extent_header_t* ph = ext2_ext_header(parent);
+    uint32_t at = (uint32_t)path->lv[l - 1u].pos + 1u;
+    memmove(ext2_ext_entry(parent, at + 1u), ext2_ext_entry(parent, at),
+            (size_t)(ph->entries - at) * sizeof(ext4_extent_idx_t));
+    ext4_extent_idx_t* ix = (ext4_extent_idx_t*)ext2_ext_entry(parent, at);
+    memset(ix, 0, sizeof(*ix));
+    ix->block = ext2_ext_key(ext2_ext_entry(sib, 0));
+    ix->leaf_lo = nb;
+    ph->entries++;
+    kfree(sib);
+    rc = ext2_ext_store(ctx, path, l - 1u, inode_dirty);
+    return (rc == RDNX_OK) ? EXT4_EXT_RETRY : rc;
+}
 
-    if (ino->block[12] != 0) {
-        total++; /* single indirect block itself */
-        uint8_t* ibuf = (uint8_t*)kmalloc(ctx->block_size);
-        if (!ibuf) {
-            return total;
+/*
+ * Map [ext->block, +len) in the tree. The range must be a hole. With merge,
+ * an adjacent extent of the same kind that ends where this one starts
+ * (logically and physically) is extended instead of adding an entry.
+ */
+static int ext2_ext_insert(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, const ext4_extent_t* ext,
+                           int merge, uint32_t goal, int* inode_dirty)
+{
+    for (uint32_t tries = 0; tries < 4u * EXT4_EXT_MAX_DEPTH; tries++) {
+        ext2_ext_path_t path;
+        int rc = ext2_ext_find(ctx, ino, ext->block, &path);
+        if (rc != RDNX_OK) {
+            return rc;
         }
-        if (ext2_read_block(ctx, ino->block[12], ibuf) == RDNX_OK) {
-            const uint32_t* table = (const uint32_t*)ibuf;
-            for (uint32_t i = 0; i < per_block; i++) {
-                if (table[i] != 0) {
-                    total++;
-                }
+        uint32_t l = path.depth;
+        uint8_t* leaf = path.lv[l].node;
+        ext4_extent_header_t* h = ext2_ext_header(leaf);
+        int32_t pos = path.lv[l].pos;
+
+        if (merge && pos >= 0) {
+            ext4_extent_t* prev = (ext4_extent_t*)ext2_ext_entry(leaf, (uint32_t)pos);
+            uint32_t plen = ext2_ext_len(prev);
+            uint32_t nlen = ext2_ext_len(ext);
+            uint32_t cap = ext2_ext_unwritten(ext) ? EXT4_EXT_UNINIT_MAX_LEN : EXT4_EXT_INIT_MAX_LEN;
+            if (ext2_ext_unwritten(prev) == ext2_ext_unwritten(ext) && prev->start_hi == 0 &&
+                prev->block + plen == ext->block && prev->start_lo + plen == ext->start_lo &&
+                plen + nlen <= cap) {
+                ext2_ext_set(prev, prev->block, plen + nlen, prev->start_lo, ext2_ext_unwritten(ext));
+                rc = ext2_ext_store(ctx, &path, l, inode_dirty);
+                ext2_ext_path_free(&path);
+                return rc;
             }
         }
-        kfree(ibuf);
-    }
 
-    if (ino->block[13] != 0) {
-        total++; /* double indirect table itself */
-        uint8_t* di_buf = (uint8_t*)kmalloc(ctx->block_size);
-        if (!di_buf) {
-            return total;
-        }
-        if (ext2_read_block(ctx, ino->block[13], di_buf) == RDNX_OK) {
-            const uint32_t* di_table = (const uint32_t*)di_buf;
-            uint8_t* si_buf = (uint8_t*)kmalloc(ctx->block_size);
-            if (si_buf) {
-                for (uint32_t i = 0; i < per_block; i++) {
-                    if (di_table[i] == 0) {
-                        continue;
-                    }
-                    total++; /* single indirect sub-block */
-                    if (ext2_read_block(ctx, di_table[i], si_buf) == RDNX_OK) {
-                        const uint32_t* si_table = (const uint32_t*)si_buf;
-                        for (uint32_t j = 0; j < per_block; j++) {
-                            if (si_table[j] != 0) {
-                                total++;
-                            }
-                        }
-                    }
-                }
-                kfree(si_buf);
+        if (h->entries < h->max) {
+            uint32_t at = (uint32_t)(pos + 1);
+            memmove(ext2_ext_entry(leaf, at + 1u), ext2_ext_entry(leaf, at),
+                    (size_t)(h->entries - at) * sizeof(ext4_extent_t));
+            memcpy(ext2_ext_entry(leaf, at), ext, sizeof(*ext));
+            h->entries++;
+            rc = ext2_ext_store(ctx, &path, l, inode_dirty);
+            if (rc == RDNX_OK && at == 0) {
+                rc = ext2_ext_lower_keys(ctx, &path, l, ext->block, inode_dirty);
             }
+            ext2_ext_path_free(&path);
+            return rc;
         }
-        kfree(di_buf);
-    }
 
-    return total;
+        rc = ext2_ext_make_room(ctx, ino, &path, l, goal, inode_dirty);
+        ext2_ext_path_free(&path);
+        if (rc != EXT4_EXT_RETRY) {
+            return (rc == RDNX_OK) ? RDNX_E_GENERIC : rc;
+        }
+    }
+    return RDNX_E_GENERIC;
 }
 
-static int ext2_trim_inode_blocks(ext2_mount_ctx_t* ctx, uint32_t ino_num, ext2_inode_t* ino, uint32_t target_blocks)
+/* First write into an unwritten extent: split out lbn as a written block. */
+static int ext2_ext_convert(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint32_t lbn, uint32_t goal, int* inode_dirty)
 {
-    if (!ctx || !ino) {
+    ext2_ext_path_t path;
+    int rc = ext2_ext_find(ctx, ino, lbn, &path);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    uint32_t l = path.depth;
+    uint8_t* leaf = path.lv[l].node;
+    int32_t pos = path.lv[l].pos;
+    if (pos < 0) {
+        ext2_ext_path_free(&path);
+        return RDNX_E_INVALID;
+    }
+    ext4_extent_t* e = (ext4_extent_t*)ext2_ext_entry(leaf, (uint32_t)pos);
+    uint32_t b = e->block;
+    uint32_t len = ext2_ext_len(e);
+    uint32_t start = e->start_lo;
+    uint32_t off = lbn - b;
+    if (!ext2_ext_unwritten(e) || off >= len) {
+        ext2_ext_path_free(&path);
         return RDNX_E_INVALID;
     }
 
-    uint32_t per_block = ctx->block_size / sizeof(uint32_t);
-    uint32_t direct_keep = (target_blocks < EXT2_NDIR_BLOCKS) ? target_blocks : EXT2_NDIR_BLOCKS;
-
-    for (int i = (int)EXT2_NDIR_BLOCKS - 1; i >= 0; i--) {
-        if ((uint32_t)i < direct_keep) {
-            continue;
-        }
-        uint32_t blk = ino->block[(uint32_t)i];
-        if (blk != 0) {
-            int frc = ext2_free_block(ctx, blk);
-            if (frc != RDNX_OK) {
-                return frc;
+    if (off == 0 && pos > 0) {
+        ext4_extent_t* prev = (ext4_extent_t*)ext2_ext_entry(leaf, (uint32_t)(pos - 1));
+        uint32_t plen = ext2_ext_len(prev);
+        if (!ext2_ext_unwritten(prev) && prev->block + plen == lbn &&
+            prev->start_lo + plen == start && plen < EXT4_EXT_INIT_MAX_LEN) {
+            /* Sequential writes: grow the written extent, shrink the unwritten one. */
+            ext2_ext_set(prev, prev->block, plen + 1u, prev->start_lo, 0);
+            if (len == 1u) {
+                ext4_extent_header_t* h = ext2_ext_header(leaf);
+                memmove(e, (uint8_t*)e + sizeof(*e), (size_t)(h->entries - (uint32_t)pos - 1u) * sizeof(*e));
+                h->entries--;
+            } else {
+                ext2_ext_set(e, b + 1u, len - 1u, start + 1u, 1);
             }
-            ino->block[(uint32_t)i] = 0;
+            rc = ext2_ext_store(ctx, &path, l, inode_dirty);
+            ext2_ext_path_free(&path);
+            return rc;
         }
     }
 
-    if (ino->block[12] != 0) {
-        uint8_t* ibuf = (uint8_t*)kmalloc(ctx->block_size);
-        if (!ibuf) {
-            return RDNX_E_NOMEM;
-        }
-        int rc = ext2_read_block(ctx, ino->block[12], ibuf);
-        if (rc != RDNX_OK) {
-            kfree(ibuf);
-            return rc;
-        }
+    ext4_extent_t written;
+    ext4_extent_t tail;
+    ext2_ext_set(&written, lbn, 1, start + off, 0);
+    ext2_ext_set(&tail, lbn + 1u, len - off - 1u, start + off + 1u, 1);
+    if (off == 0) {
+        *e = written;
+    } else {
+        ext2_ext_set(e, b, off, start, 1);
+    }
+    rc = ext2_ext_store(ctx, &path, l, inode_dirty);
+    ext2_ext_path_free(&path);
+    if (rc == RDNX_OK && off != 0) {
+        rc = ext2_ext_insert(ctx, ino, &written, 0, goal, inode_dirty);
+    }
+    if (rc == RDNX_OK && off + 1u < len) {
+        rc = ext2_ext_insert(ctx, ino, &tail, 0, goal, inode_dirty);
+    }
+    return rc;
+}
 
-        uint32_t* table = (uint32_t*)ibuf;
-        uint32_t indir_keep = (target_blocks > EXT2_NDIR_BLOCKS) ? (target_blocks - EXT2_NDIR_BLOCKS) : 0;
-        if (indir_keep > per_block) {
-            indir_keep = per_block;
-        }
-        int dirty = 0;
-        for (int i = (int)per_block - 1; i >= 0; i--) {
-            if ((uint32_t)i < indir_keep) {
-                continue;
+/* Free extents at or beyond keep below node; *dirty when node changed. */
+static int ext2_ext_trim_node(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint8_t* node, uint32_t blk,
+                              uint32_t keep, int* dirty)
+{
+    ext4_extent_header_t* h = ext2_ext_header(node);
+    if (h->depth == 0) {
+        while (h->entries > 0) {
+            ext4_extent_t* e = (ext4_extent_t*)ext2_ext_entry(node, h->entries - 1u);
+            uint32_t len = ext2_ext_len(e);
+            if (e->block + len <= keep) {
+                break;
             }
-            uint32_t blk = table[(uint32_t)i];
-            if (blk != 0) {
-                int frc = ext2_free_block(ctx, blk);
-                if (frc != RDNX_OK) {
-                    kfree(ibuf);
-                    return frc;
-                }
-                table[(uint32_t)i] = 0;
-                dirty = 1;
+            uint32_t cut = (e->block >= keep) ? 0 : keep - e->block;
+            int rc = ext2_free_run(ctx, e->start_lo + cut, len - cut);
+            if (rc != RDNX_OK) {
+                return rc;
             }
-        }
-
-        int any = 0;
-        for (uint32_t i = 0; i < per_block; i++) {
-            if (table[i] != 0) {
-                any = 1;
+            ext2_inode_sub_blocks(ctx, ino, len - cut);
+            *dirty = 1;
+            if (cut == 0) {
+                h->entries--;
+            } else {
+                ext2_ext_set(e, e->block, cut, e->start_lo, ext2_ext_unwritten(e));
                 break;
             }
         }
-        if (!any) {
-            uint32_t ind = ino->block[12];
-            ino->block[12] = 0;
-            rc = ext2_free_block(ctx, ind);
+        return RDNX_OK;
+    }
+
+    uint32_t child_depth = h->depth - 1u;
+    uint8_t* child = (uint8_t*)kmalloc(ctx->block_size);
+    if (!child) {
+        return RDNX_E_NOMEM;
+    }
+    while (h->entries > 0) {
+        ext4_extent_idx_t* ix = (ext4_extent_idx_t*)ext2_ext_entry(node, h->entries - 1u);
+        uint32_t key = ix->block;
+        uint32_t cblk = ix->leaf_lo;
+        int rc = ext2_read_block(ctx, cblk, child);
+        if (rc == RDNX_OK && ext2_ext_check(ctx, child, cblk, child_depth) != RDNX_OK) {
+            rc = RDNX_E_INVALID;
+        }
+        int cdirty = 0;
+        if (rc == RDNX_OK) {
+            rc = ext2_ext_trim_node(ctx, ino, child, cblk, keep, &cdirty);
+        }
+        if (rc != RDNX_OK) {
+            kfree(child);
+            return rc;
+        }
+        if (ext2_ext_header(child)->entries == 0) {
+            rc = ext2_free_block(ctx, cblk);
             if (rc != RDNX_OK) {
-                kfree(ibuf);
+                kfree(child);
                 return rc;
             }
-        } else if (dirty) {
-            rc = ext2_write_block(ctx, ino->block[12], ibuf);
+            ext2_inode_sub_blocks(ctx, ino, 1);
+            h->entries--;
+            *dirty = 1;
+        } else if (cdirty) {
+            rc = ext2_meta_store(ctx, cblk, child);
             if (rc != RDNX_OK) {
-                kfree(ibuf);
+                kfree(child);
                 return rc;
             }
         }
-        kfree(ibuf);
+        /* Children to the left only hold blocks below key. */
+        if (key < keep) {
+            break;
+        }
+    }
+    kfree(child);
+    (void)blk;
+    return RDNX_OK;
+}
+
+static int ext2_ext_trim(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint32_t keep)
+{
+    uint8_t* root = (uint8_t*)ino->block;
+    ext4_extent_header_t* h = ext2_ext_header(root);
+    if (h->depth > EXT4_EXT_MAX_DEPTH || ext2_ext_check(ctx, root, 0, h->depth) != RDNX_OK) {
+        return RDNX_E_INVALID;
     }
+    int dirty = 0;
+    int rc = ext2_ext_trim_node(ctx, ino, root, 0, keep, &dirty);
+    if (rc == RDNX_OK && h->entries == 0 && h->depth != 0) {
+        h->depth = 0;
+        h->max = EXT4_EXT_ROOT_ENTRIES;
+    }
+    return rc;
+}
 
-    /* Double indirect: block[13] */
-    if (ino->block[13] != 0) {
-        uint32_t di_data_keep = (target_blocks > EXT2_NDIR_BLOCKS + per_block)
-                                ? (target_blocks - EXT2_NDIR_BLOCKS - per_block) : 0;
+/* ---- format-independent mapping ---- */
 
-        uint8_t* di_buf = (uint8_t*)kmalloc(ctx->block_size);
-        if (!di_buf) {
-            return RDNX_E_NOMEM;
-        }
-        int rc = ext2_read_block(ctx, ino->block[13], di_buf);
-        if (rc != RDNX_OK) {
-            kfree(di_buf);
-            return rc;
+/*
+ * Map lbn for reading. *out_blk == 0 is a hole; *out_unwritten marks a
+ * preallocated extent. Both read as zeros. *out_run (>= 1) counts blocks
+ * from lbn that map the same way, extended up to max for block maps.
+ */
+static int ext2_map_block(ext2_mount_ctx_t* ctx, const ext2_inode_t* ino, uint32_t lbn, uint32_t max,
+                          uint32_t* out_blk, uint32_t* out_run, int* out_unwritten)
+{
+    if (ext2_has_extents(ino)) {
+        return ext2_ext_map(ctx, ino, lbn, out_blk, out_run, out_unwritten);
+    }
+    *out_unwritten = 0;
+    *out_run = 1;
+    int rc = ext2_bmap_lookup(ctx, ino, lbn, out_blk);
+    while (rc == RDNX_OK && *out_run < max) {
+        uint32_t next = 0;
+        if (ext2_bmap_lookup(ctx, ino, lbn + *out_run, &next) != RDNX_OK) {
+            break;
         }
-        uint32_t* di_table = (uint32_t*)di_buf;
-        int di_dirty = 0;
-
-        uint8_t* si_buf = (uint8_t*)kmalloc(ctx->block_size);
-        if (!si_buf) {
-            kfree(di_buf);
-            return RDNX_E_NOMEM;
+        if ((*out_blk == 0) ? (next != 0) : (next != *out_blk + *out_run)) {
+            break;
         }
+        (*out_run)++;
+    }
+    return rc;
+}
 
-        for (int di_i = (int)per_block - 1; di_i >= 0; di_i--) {
-            uint32_t si_blk = di_table[(uint32_t)di_i];
-            if (si_blk == 0) {
-                continue;
-            }
-            uint32_t di_base = (uint32_t)di_i * per_block;
-
-            if (di_data_keep <= di_base) {
-                /* Free entire sub-table */
-                if (ext2_read_block(ctx, si_blk, si_buf) == RDNX_OK) {
-                    uint32_t* si_table = (uint32_t*)si_buf;
-                    for (uint32_t si_i = 0; si_i < per_block; si_i++) {
-                        if (si_table[si_i] != 0) {
-                            int frc = ext2_free_block(ctx, si_table[si_i]);
-                            if (frc != RDNX_OK) {
-                                kfree(si_buf);
-                                kfree(di_buf);
-                                return frc;
-                            }
-                            si_table[si_i] = 0;
-                        }
-                    }
-                }
-                int frc = ext2_free_block(ctx, si_blk);
-                if (frc != RDNX_OK) {
-                    kfree(si_buf);
-                    kfree(di_buf);
-                    return frc;
-                }
-                di_table[(uint32_t)di_i] = 0;
-                di_dirty = 1;
-            } else if (di_data_keep < di_base + per_block) {
-                /* Partial trim of sub-table */
-                uint32_t si_keep = di_data_keep - di_base;
-                rc = ext2_read_block(ctx, si_blk, si_buf);
-                if (rc != RDNX_OK) {
-                    kfree(si_buf);
-                    kfree(di_buf);
-                    return rc;
-                }
-                uint32_t* si_table = (uint32_t*)si_buf;
-                int si_dirty = 0;
-                for (int si_i = (int)per_block - 1; si_i >= 0; si_i--) {
-                    if ((uint32_t)si_i < si_keep) {
-                        continue;
-                    }
-                    if (si_table[(uint32_t)si_i] != 0) {
-                        int frc = ext2_free_block(ctx, si_table[(uint32_t)si_i]);
-                        if (frc != RDNX_OK) {
-                            kfree(si_buf);
-                            kfree(di_buf);
-                            return frc;
-                        }
-                        si_table[(uint32_t)si_i] = 0;
-                        si_dirty = 1;
-                    }
-                }
-                if (si_dirty) {
-                    int wrc = ext2_write_block(ctx, si_blk, si_buf);
-                    if (wrc != RDNX_OK) {
-                        kfree(si_buf);
-                        kfree(di_buf);
-                        return wrc;
-                    }
-                }
-            }
-            /* else: keep entire sub-table */
-        }
+static int ext2_inode_get_block(ext2_mount_ctx_t* ctx,
+                                const ext2_inode_t* ino,
+                                uint32_t lbn,
+                                uint32_t* out_blk)
+{
+    if (!ctx || !ino || !out_blk) {
+        return RDNX_E_INVALID;
+    }
+    uint32_t run = 0;
+    int unwritten = 0;
+    int rc = ext2_map_block(ctx, ino, lbn, 1, out_blk, &run, &unwritten);
+    if (rc == RDNX_OK && unwritten) {
+        *out_blk = 0;
+    }
+    return rc;
+}
 
-        kfree(si_buf);
+/*
+ * Map lbn for writing, allocating near goal. *out_fresh: the block holds no
+ * file data yet (new or unwritten), so partial writes must zero-fill.
+ */
+static int ext2_map_block_for_write(ext2_mount_ctx_t* ctx, ext2_inode_t* ino, uint32_t lbn, uint32_t goal,
+                                    uint32_t* out_blk, int* out_fresh, int* out_inode_dirty)
+{
+    if (!ext2_has_extents(ino)) {
+        return ext2_bmap_alloc(ctx, ino, lbn, goal, out_blk, out_fresh, out_inode_dirty);
+    }
 
-        /* Free double indirect table if now empty */
-        int any = 0;
-        for (uint32_t i = 0; i < per_block; i++) {
-            if (di_table[i] != 0) {
-                any = 1;
-                break;
-            }
-        }
-        if (!any) {
-            uint32_t dind = ino->block[13];
-            ino->block[13] = 0;
-            int frc = ext2_free_block(ctx, dind);
-            if (frc != RDNX_OK) {
-                kfree(di_buf);
-                return frc;
-            }
-        } else if (di_dirty) {
-            int wrc = ext2_write_block(ctx, ino->block[13], di_buf);
-            if (wrc != RDNX_OK) {
-                kfree(di_buf);
-                return wrc;
-            }
-        }
-        kfree(di_buf);
+    uint32_t blk = 0;
+    uint32_t run = 0;
+    int unwritten = 0;
+    int rc = ext2_ext_map(ctx, ino, lbn, &blk, &run, &unwritten);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    if (blk != 0) {
+        *out_blk = blk;
+        *out_fresh = unwritten;
+        return unwritten ? ext2_ext_convert(ctx, ino, lbn, goal, out_inode_dirty) : RDNX_OK;
     }
 
-    uint32_t sectors_per_block = ctx->block_size / 512u;
-    uint32_t alloc_blocks = ext2_count_allocated_blocks(ctx, ino);
-    ino->blocks = alloc_blocks * sectors_per_block;
-    return ext2_write_inode(ctx, ino_num, ino);
+    rc = ext2_alloc_block(ctx, goal, &blk);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    ext4_extent_t ext;
+    ext2_ext_set(&ext, lbn, 1, blk, 0);
+    rc = ext2_ext_insert(ctx, ino, &ext, 1, blk + 1u, out_inode_dirty);
+    if (rc != RDNX_OK) {
+        (void)ext2_free_block(ctx, blk);
+        return rc;
+    }
+    ext2_inode_add_blocks(ctx, ino, 1);
+    *out_inode_dirty = 1;
+    *out_blk = blk;
+    *out_fresh = 1;
+    return RDNX_OK;
 }
 
-static int ext2_load_file(ext2_mount_ctx_t* ctx, uint32_t ino_num, const ext2_inode_t* ino, vfs_node_t* node)
+static int ext2_trim_inode_blocks(ext2_mount_ctx_t* ctx, uint32_t ino_num, ext2_inode_t* ino, uint32_t target_blocks)
 {
-    if (!ctx || !ino || !node) {
+    if (!ctx || !ino) {
         return RDNX_E_INVALID;
     }
+    int rc = ext2_has_extents(ino) ? ext2_ext_trim(ctx, ino, target_blocks)
+                                   : ext2_bmap_trim(ctx, ino, target_blocks);
+    int wrc = ext2_write_inode(ctx, ino_num, ino);
+    return (rc != RDNX_OK) ? rc : wrc;
+}
 
-    uint64_t fsize64 = ext2_inode_size_bytes(ino);
-    uint32_t fsize = (fsize64 > UINT32_MAX) ? UINT32_MAX : (uint32_t)fsize64;
-    if (fsize > EXT2_MAX_FILE_BYTES) {
-        fsize = EXT2_MAX_FILE_BYTES;
-    }
-
-    if (fsize == 0) {
-        int zrc = vfs_fs_set_file_data(node, NULL, 0);
-        if (zrc == RDNX_OK) {
-            ext2_mark_node(node, ino_num);
+/* Goal for extending a file at lbn: right after the block before it. */
+static uint32_t ext2_write_goal(ext2_mount_ctx_t* ctx, uint32_t ino_num, const ext2_inode_t* ino, uint32_t lbn)
+{
+    if (lbn > 0) {
+        uint32_t blk = 0;
+        uint32_t run = 0;
+        int unwritten = 0;
+        if (ext2_map_block(ctx, ino, lbn - 1u, 1, &blk, &run, &unwritten) == RDNX_OK && blk != 0) {
+            return blk + 1u;
         }
-        return zrc;
     }
+    return ext2_inode_goal(ctx, ino_num);
+}
 
-    uint8_t* data = (uint8_t*)kmalloc(fsize);
-    uint8_t* blk = (uint8_t*)kmalloc(ctx->block_size);
-    if (!data || !blk) {
-        if (data) {
-            kfree(data);
-        }
-        if (blk) {
-            kfree(blk);
+/* Copy [off, off+len) of a file into out; caller checked the bounds. */
+static int ext2_read_range(ext2_mount_ctx_t* ctx, const ext2_inode_t* ino, uint64_t off, uint8_t* out, size_t len)
+{
+    uint8_t* bounce = NULL;
+    size_t done = 0;
+    int rc = RDNX_OK;
+    while (done < len) {
+        cond_resched();
+        uint64_t abs = off + done;
+        uint32_t lbn = (uint32_t)(abs / ctx->block_size);
+        uint32_t boff = (uint32_t)(abs % ctx->block_size);
+        size_t chunk = len - done;
+        uint32_t want = (uint32_t)((chunk + boff + ctx->block_size - 1u) / ctx->block_size);
+        if (want > EXT2_MAX_IO_BLOCKS) {
+            want = EXT2_MAX_IO_BLOCKS;
         }
-        return RDNX_E_NOMEM;
-    }
 
-    uint32_t done = 0;
-    uint32_t lbn = 0;
-    while (done < fsize) {
-        uint32_t pblk = 0;
-        int rc = ext2_inode_get_block(ctx, ino, lbn, &pblk);
+        uint32_t blk = 0;
+        uint32_t run = 0;
+        int unwritten = 0;
+        rc = ext2_map_block(ctx, ino, lbn, want, &blk, &run, &unwritten);
         if (rc != RDNX_OK) {
-            kfree(blk);
-            kfree(data);
-            return rc;
+            break;
         }
-        if (pblk == 0) {
-            memset(blk, 0, ctx->block_size);
+        if (run > want) {
+            run = want;
+        }
+        uint64_t span = (uint64_t)run * ctx->block_size - boff;
+        if (chunk > span) {
+            chunk = (size_t)span;
+        }
+
+        if (blk == 0 || unwritten) {
+            memset(out + done, 0, chunk);
+        } else if (boff == 0 && chunk >= ctx->block_size) {
+            /* Whole contiguous blocks: one device request into the caller's buffer. */
+            chunk -= chunk % ctx->block_size;
+            rc = ext2_read_bytes(ctx, (uint64_t)blk * ctx->block_size, out + done, (uint32_t)chunk);
+            if (rc != RDNX_OK) {
+                break;
+            }
         } else {
-            rc = ext2_read_block(ctx, pblk, blk);
+            if (!bounce) {
+                bounce = (uint8_t*)kmalloc(ctx->block_size);
+                if (!bounce) {
+                    rc = RDNX_E_NOMEM;
+                    break;
+                }
+            }
+            if (chunk > ctx->block_size - boff) {
+                chunk = ctx->block_size - boff;
+            }
+            rc = ext2_read_block(ctx, blk, bounce);
             if (rc != RDNX_OK) {
-                kfree(blk);
-                kfree(data);
-                return rc;
+                break;
             }
+            memcpy(out + done, bounce + boff, chunk);
         }
-
-        uint32_t chunk = ctx->block_size;
-        if (chunk > (fsize - done)) {
-            chunk = fsize - done;
-        }
-        memcpy(&data[done], blk, chunk);
         done += chunk;
-        lbn++;
     }
-
-    int rc = vfs_fs_set_file_data(node, data, fsize);
-    if (rc == RDNX_OK) {
-        ext2_mark_node(node, ino_num);
+    if (bounce) {
+        kfree(bounce);
     }
-    kfree(blk);
-    kfree(data);
     return rc;
 }
 
+static void ext2_mark_file(vfs_node_t* node, uint32_t ino_num, const ext2_inode_t* ino)
+{
+    ext2_mark_node(node, ino_num);
+    if (node && node->inode) {
+        /* Data is streamed on read; only the size is known up front. */
+        node->inode->size = (size_t)ext2_inode_size_bytes(ino);
+    }
+}
+
 static int ext2_build_dir(ext2_mount_ctx_t* ctx,
                           vfs_node_t* parent,
                           uint32_t dir_ino_num,
@@ -1198,7 +1941,7 @@ static int ext2_build_dir(ext2_mount_ctx_t* ctx,
                                     if (nt == VFS_NODE_DIR) {
                                         (void)ext2_build_dir(ctx, child, de->inode, &child_ino, depth + 1u);
                                     } else if (ext2_is_reg(&child_ino)) {
-                                        (void)ext2_load_file(ctx, de->inode, &child_ino, child);
+                                        ext2_mark_file(child, de->inode, &child_ino);
                                     }
                                 }
                             }
@@ -1218,110 +1961,204 @@ static int ext2_build_dir(ext2_mount_ctx_t* ctx,
     return RDNX_OK;
 }
 
-int ext2_writeback_file(vfs_node_t* node, size_t off, const void* data, size_t len, size_t final_size)
+/* Caller holds g_ext2_rw_lock. Resolve a VFS node to its regular-file inode. */
+static int ext2_live_file(vfs_node_t* node, ext2_inode_t* out)
 {
-    spinlock_lock(&g_ext2_rw_lock);
-    if (!node || !node->inode || !data) {
-        spinlock_unlock(&g_ext2_rw_lock);
+    if (!node || !node->inode) {
         return RDNX_E_INVALID;
     }
     if (!g_ext2_live_ready || !g_ext2_live.bdev || !g_ext2_live.gdt) {
-        spinlock_unlock(&g_ext2_rw_lock);
         return RDNX_E_UNSUPPORTED;
     }
     if (node->inode->fs_tag != VFS_FS_TAG_EXT2 || node->inode->fs_ino == 0) {
-        spinlock_unlock(&g_ext2_rw_lock);
         return RDNX_E_UNSUPPORTED;
     }
+    int rc = ext2_read_inode(&g_ext2_live, (uint32_t)node->inode->fs_ino, out);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    return ext2_is_reg(out) ? RDNX_OK : RDNX_E_UNSUPPORTED;
+}
+
+/*
+ * Checksummed metadata we cannot update mounts read-only; huge_file inodes
+ * count i_blocks in filesystem blocks, which the allocator does not track.
+ */
+static int ext2_file_writable(const ext2_inode_t* ino)
+{
+    if (g_ext2_live.read_only || (ino->flags & EXT4_HUGE_FILE_FL) != 0) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    return RDNX_OK;
+}
+
+int ext2_read_file(vfs_node_t* node, size_t off, void* buf, size_t len)
+{
+    if (!buf) {
+        return RDNX_E_INVALID;
+    }
     if (len == 0) {
-        spinlock_unlock(&g_ext2_rw_lock);
         return RDNX_OK;
     }
+    mutex_lock(&g_ext2_rw_lock);
+    ext2_inode_t ino;
+    int rc = ext2_live_file(node, &ino);
+    if (rc == RDNX_OK) {
+        rc = ext2_read_range(&g_ext2_live, &ino, (uint64_t)off, (uint8_t*)buf, len);
+    }
+    mutex_unlock(&g_ext2_rw_lock);
+    return rc;
+}
 
+int ext2_load_file_data(vfs_node_t* node)
+{
+    mutex_lock(&g_ext2_rw_lock);
     ext2_inode_t ino;
-    int irc = ext2_read_inode(&g_ext2_live, (uint32_t)node->inode->fs_ino, &ino);
-    if (irc != RDNX_OK) {
-        spinlock_unlock(&g_ext2_rw_lock);
-        return irc;
+    int rc = ext2_live_file(node, &ino);
+    if (rc != RDNX_OK) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return rc;
     }
-    if (!ext2_is_reg(&ino)) {
-        spinlock_unlock(&g_ext2_rw_lock);
-        return RDNX_E_UNSUPPORTED;
+    uint64_t fsize = ext2_inode_size_bytes(&ino);
+    if (fsize > EXT2_MAX_FILE_BYTES) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return RDNX_E_NOMEM;
     }
 
-    uint64_t disk_size = ext2_inode_size_bytes(&ino);
-    if ((uint64_t)off + (uint64_t)len > (uint64_t)final_size) {
-        spinlock_unlock(&g_ext2_rw_lock);
-        return RDNX_E_UNSUPPORTED;
+    uint8_t* data = NULL;
+    if (fsize > 0) {
+        data = (uint8_t*)kmalloc((size_t)fsize);
+        if (!data) {
+            mutex_unlock(&g_ext2_rw_lock);
+            return RDNX_E_NOMEM;
+        }
+        rc = ext2_read_range(&g_ext2_live, &ino, 0, data, (size_t)fsize);
     }
+    mutex_unlock(&g_ext2_rw_lock);
 
-    uint8_t* blk = (uint8_t*)kmalloc(g_ext2_live.block_size);
-    if (!blk) {
-        spinlock_unlock(&g_ext2_rw_lock);
-        return RDNX_E_NOMEM;
+    if (rc == RDNX_OK) {
+        rc = vfs_fs_set_file_data(node, data, (size_t)fsize);
+    }
+    if (data) {
+        kfree(data);
+    }
+    return rc;
+}
+
+int ext2_writeback_file(vfs_node_t* node, size_t off, const void* data, size_t len, size_t final_size)
+{
+    if (!data) {
+        return RDNX_E_INVALID;
+    }
+    mutex_lock(&g_ext2_rw_lock);
+    ext2_inode_t ino;
+    int rc = ext2_live_file(node, &ino);
+    if (rc == RDNX_OK) {
+        rc = ext2_file_writable(&ino);
+    }
+    if (rc != RDNX_OK || len == 0) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return rc;
+    }
+    if ((uint64_t)off + (uint64_t)len > (uint64_t)final_size) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return RDNX_E_UNSUPPORTED;
     }
 
+    ext2_mount_ctx_t* ctx = &g_ext2_live;
+    uint32_t ino_num = (uint32_t)node->inode->fs_ino;
+    uint32_t bs = ctx->block_size;
     const uint8_t* src = (const uint8_t*)data;
+    uint8_t* blk = NULL;
     size_t done = 0;
     int inode_dirty = 0;
+    uint32_t goal = ext2_write_goal(ctx, ino_num, &ino, (uint32_t)(off / bs));
     while (done < len) {
+        cond_resched();
         uint64_t abs = (uint64_t)off + (uint64_t)done;
-        uint32_t lbn = (uint32_t)(abs / g_ext2_live.block_size);
-        uint32_t boff = (uint32_t)(abs % g_ext2_live.block_size);
-        size_t chunk = len - done;
-        size_t room = (size_t)g_ext2_live.block_size - (size_t)boff;
-        if (chunk > room) {
-            chunk = room;
-        }
+        uint32_t lbn = (uint32_t)(abs / bs);
+        uint32_t boff = (uint32_t)(abs % bs);
 
         uint32_t pblk = 0;
-        int brc = ext2_inode_get_or_alloc_block(&g_ext2_live,
-                                                (uint32_t)node->inode->fs_ino,
-                                                &ino, lbn, 1, &pblk, &inode_dirty);
-        if (brc != RDNX_OK || pblk == 0) {
-            kfree(blk);
-            spinlock_unlock(&g_ext2_rw_lock);
-            return RDNX_E_UNSUPPORTED;
+        int fresh = 0;
+        rc = ext2_map_block_for_write(ctx, &ino, lbn, goal, &pblk, &fresh, &inode_dirty);
+        if (rc != RDNX_OK) {
+            break;
+        }
+
+        if (boff == 0 && len - done >= bs) {
+            /* Full blocks: extend the run while the mapping stays contiguous. */
+            uint32_t n = 1;
+            while (n < EXT2_MAX_IO_BLOCKS && len - done >= (size_t)(n + 1u) * bs) {
+                uint32_t next = 0;
+                int next_fresh = 0;
+                rc = ext2_map_block_for_write(ctx, &ino, lbn + n, pblk + n, &next, &next_fresh, &inode_dirty);
+                if (rc != RDNX_OK || next != pblk + n) {
+                    break;
+                }
+                n++;
+            }
+            if (rc != RDNX_OK) {
+                break;
+            }
+            rc = ext2_write_bytes(ctx, (uint64_t)pblk * bs, src + done, n * bs);
+            if (rc != RDNX_OK) {
+                break;
+            }
+            done += (size_t)n * bs;
+            goal = pblk + n;
+            continue;
         }
 
-        if (chunk == g_ext2_live.block_size && boff == 0) {
-            memset(blk, 0, g_ext2_live.block_size);
+        size_t chunk = len - done;
+        if (chunk > (size_t)(bs - boff)) {
+            chunk = bs - boff;
+        }
+        if (!blk) {
+            blk = (uint8_t*)kmalloc(bs);
+            if (!blk) {
+                rc = RDNX_E_NOMEM;
+                break;
+            }
+        }
+        if (fresh) {
+            memset(blk, 0, bs);
         } else {
-            brc = ext2_read_block(&g_ext2_live, pblk, blk);
-            if (brc != RDNX_OK) {
-                kfree(blk);
-                spinlock_unlock(&g_ext2_rw_lock);
-                return brc;
+            rc = ext2_read_block(ctx, pblk, blk);
+            if (rc != RDNX_OK) {
+                break;
             }
         }
         memcpy(blk + boff, src + done, chunk);
-        brc = ext2_write_bytes(&g_ext2_live, (uint64_t)pblk * (uint64_t)g_ext2_live.block_size,
-                               blk, g_ext2_live.block_size);
-        if (brc != RDNX_OK) {
-            kfree(blk);
-            spinlock_unlock(&g_ext2_rw_lock);
-            return brc;
+        rc = ext2_write_block(ctx, pblk, blk);
+        if (rc != RDNX_OK) {
+            break;
         }
         done += chunk;
+        goal = pblk + 1u;
     }
 
-    if ((uint64_t)final_size > disk_size) {
-        ino.size_lo   = (uint32_t)(final_size & 0xFFFFFFFFu);
-        ino.size_high = (uint32_t)(final_size >> 32);
+    if (rc == RDNX_OK && (uint64_t)final_size > ext2_inode_size_bytes(&ino)) {
+        ext2_inode_set_size(ctx, &ino, (uint64_t)final_size);
         inode_dirty = 1;
     }
+    /* Record whatever was allocated, even after a failed write. */
     if (inode_dirty) {
-        int wrc = ext2_write_inode(&g_ext2_live, (uint32_t)node->inode->fs_ino, &ino);
-        if (wrc != RDNX_OK) {
-            kfree(blk);
-            spinlock_unlock(&g_ext2_rw_lock);
-            return wrc;
+        int wrc = ext2_write_inode(ctx, ino_num, &ino);
+        if (rc == RDNX_OK) {
+            rc = wrc;
         }
     }
+    int frc = ext2_flush(ctx);
+    if (rc == RDNX_OK) {
+        rc = frc;
+    }
 
-    kfree(blk);
-    spinlock_unlock(&g_ext2_rw_lock);
-    return RDNX_OK;
+    if (blk) {
+        kfree(blk);
+    }
+    mutex_unlock(&g_ext2_rw_lock);
+    return rc;
 }
 
 int ext2_query_caps(ext2_fs_caps_t* out_caps)
@@ -1335,80 +2172,228 @@ int ext2_query_caps(ext2_fs_caps_t* out_caps)
 
 int ext2_resize_file(vfs_node_t* node, size_t new_size)
 {
-    spinlock_lock(&g_ext2_rw_lock);
-    if (!node || !node->inode) {
-        spinlock_unlock(&g_ext2_rw_lock);
-        return RDNX_E_INVALID;
-    }
-    if (!g_ext2_live_ready || !g_ext2_live.bdev || !g_ext2_live.gdt) {
-        spinlock_unlock(&g_ext2_rw_lock);
-        return RDNX_E_UNSUPPORTED;
-    }
-    if (node->inode->fs_tag != VFS_FS_TAG_EXT2 || node->inode->fs_ino == 0) {
-        spinlock_unlock(&g_ext2_rw_lock);
-        return RDNX_E_UNSUPPORTED;
-    }
-
+    mutex_lock(&g_ext2_rw_lock);
     ext2_inode_t ino;
-    int irc = ext2_read_inode(&g_ext2_live, (uint32_t)node->inode->fs_ino, &ino);
-    if (irc != RDNX_OK) {
-        spinlock_unlock(&g_ext2_rw_lock);
-        return irc;
+    int rc = ext2_live_file(node, &ino);
+    if (rc == RDNX_OK) {
+        rc = ext2_file_writable(&ino);
     }
-    if (!ext2_is_reg(&ino)) {
-        spinlock_unlock(&g_ext2_rw_lock);
-        return RDNX_E_UNSUPPORTED;
+    if (rc != RDNX_OK) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return rc;
     }
 
+    ext2_mount_ctx_t* ctx = &g_ext2_live;
+    uint32_t ino_num = (uint32_t)node->inode->fs_ino;
     uint64_t disk_size = ext2_inode_size_bytes(&ino);
     if ((uint64_t)new_size == disk_size) {
-        spinlock_unlock(&g_ext2_rw_lock);
+        mutex_unlock(&g_ext2_rw_lock);
         return RDNX_OK;
     }
 
-    uint32_t old_blocks = (uint32_t)((disk_size + g_ext2_live.block_size - 1u) / g_ext2_live.block_size);
-    uint32_t new_blocks = (uint32_t)(((uint64_t)new_size + g_ext2_live.block_size - 1u) / g_ext2_live.block_size);
+    /* Growing leaves a hole; shrinking writes the size first (crash-safer). */
+    ext2_inode_set_size(ctx, &ino, (uint64_t)new_size);
+    rc = ext2_write_inode(ctx, ino_num, &ino);
+    if (rc == RDNX_OK && (uint64_t)new_size < disk_size) {
+        uint32_t bs = ctx->block_size;
+        uint32_t new_blocks = (uint32_t)(((uint64_t)new_size + bs - 1u) / bs);
+        rc = ext2_trim_inode_blocks(ctx, ino_num, &ino, new_blocks);
 
-    if ((uint64_t)new_size > disk_size) {
-        int inode_dirty = 0;
-        for (uint32_t lbn = old_blocks; lbn < new_blocks; lbn++) {
+        /* Zero the tail of the last block so a later grow reads zeros. */
+        uint32_t tail = (uint32_t)(new_size % bs);
+        if (rc == RDNX_OK && tail != 0) {
             uint32_t pblk = 0;
-            int rc = ext2_inode_get_or_alloc_block(&g_ext2_live,
-                                                   (uint32_t)node->inode->fs_ino,
-                                                   &ino, lbn, 1, &pblk, &inode_dirty);
-            if (rc != RDNX_OK || pblk == 0) {
-                int trim_rc = ext2_trim_inode_blocks(&g_ext2_live,
-                    (uint32_t)node->inode->fs_ino, &ino, old_blocks);
-                if (trim_rc != RDNX_OK) {
-                    kprintf("[EXT2] resize rollback failed: alloc_err=%d trim_err=%d ino=%u\n",
-                            rc, trim_rc, (uint32_t)node->inode->fs_ino);
+            uint32_t run = 0;
+            int unwritten = 0;
+            rc = ext2_map_block(ctx, &ino, new_blocks - 1u, 1, &pblk, &run, &unwritten);
+            if (rc == RDNX_OK && pblk != 0 && !unwritten) {
+                uint8_t* blk = (uint8_t*)kmalloc(bs);
+                if (!blk) {
+                    rc = RDNX_E_NOMEM;
+                } else {
+                    rc = ext2_read_block(ctx, pblk, blk);
+                    if (rc == RDNX_OK) {
+                        memset(blk + tail, 0, bs - tail);
+                        rc = ext2_write_block(ctx, pblk, blk);
+                    }
+                    kfree(blk);
                 }
-                spinlock_unlock(&g_ext2_rw_lock);
-                return (rc != RDNX_OK) ? rc : RDNX_E_UNSUPPORTED;
             }
         }
+    }
+    int frc = ext2_flush(ctx);
+    mutex_unlock(&g_ext2_rw_lock);
+    return (rc != RDNX_OK) ? rc : frc;
+}
 
-        ino.size_lo   = (uint32_t)(new_size & 0xFFFFFFFFu);
-        ino.size_high = (uint32_t)(new_size >> 32);
-        uint32_t sectors_per_block = g_ext2_live.block_size / 512u;
-        uint32_t alloc_blocks = ext2_count_allocated_blocks(&g_ext2_live, &ino);
-        ino.blocks = alloc_blocks * sectors_per_block;
-        int rc = ext2_write_inode(&g_ext2_live, (uint32_t)node->inode->fs_ino, &ino);
-        spinlock_unlock(&g_ext2_rw_lock);
+/*
+ * Reserve blocks for [off, off + len). Extent files get unwritten extents
+ * (no data I/O, reads return zeros); block-mapped files have no such state,
+ * so their new blocks are zero-filled on disk, and they cannot own blocks
+ * past i_size, which rules out keep_size beyond EOF.
+ */
+int ext2_fallocate_file(vfs_node_t* node, size_t off, size_t len, int keep_size)
+{
+    if (len == 0 || (uint64_t)off + (uint64_t)len < (uint64_t)off) {
+        return RDNX_E_INVALID;
+    }
+    mutex_lock(&g_ext2_rw_lock);
+    ext2_inode_t ino;
+    int rc = ext2_live_file(node, &ino);
+    if (rc == RDNX_OK) {
+        rc = ext2_file_writable(&ino);
+    }
+    if (rc != RDNX_OK) {
+        mutex_unlock(&g_ext2_rw_lock);
         return rc;
+    }
+
+    ext2_mount_ctx_t* ctx = &g_ext2_live;
+    uint32_t ino_num = (uint32_t)node->inode->fs_ino;
+    uint32_t bs = ctx->block_size;
+    uint64_t end = (uint64_t)off + (uint64_t)len;
+    uint64_t last64 = (end + bs - 1u) / bs;
+    if (last64 > UINT32_MAX) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return RDNX_E_INVALID;
+    }
+    if (keep_size && !ext2_has_extents(&ino) && end > ext2_inode_size_bytes(&ino)) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return RDNX_E_UNSUPPORTED;
+    }
+    uint32_t lbn = (uint32_t)(off / bs);
+    uint32_t last = (uint32_t)last64;
+    uint32_t goal = ext2_write_goal(ctx, ino_num, &ino, lbn);
+    int inode_dirty = 0;
+
+    if (ext2_has_extents(&ino)) {
+        while (lbn < last) {
+            cond_resched();
+            uint32_t pblk = 0;
+            uint32_t run = 0;
+            int unwritten = 0;
+            rc = ext2_map_block(ctx, &ino, lbn, last - lbn, &pblk, &run, &unwritten);
+            if (rc != RDNX_OK) {
+                break;
+            }
+            if (run > last - lbn) {
+                run = last - lbn;
+            }
+            if (pblk != 0) {
+                lbn += run;
+                continue;
+            }
+            if (run > EXT4_EXT_UNINIT_MAX_LEN) {
+                run = EXT4_EXT_UNINIT_MAX_LEN;
+            }
+            uint32_t start = 0;
+            uint32_t count = 0;
+            rc = ext2_alloc_run(ctx, goal, run, &start, &count);
+            if (rc != RDNX_OK) {
+                break;
+            }
+            ext4_extent_t ext;
+            ext2_ext_set(&ext, lbn, count, start, 1);
+            rc = ext2_ext_insert(ctx, &ino, &ext, 1, start + count, &inode_dirty);
+            if (rc != RDNX_OK) {
+                (void)ext2_free_run(ctx, start, count);
+                break;
+            }
+            ext2_inode_add_blocks(ctx, &ino, count);
+            inode_dirty = 1;
+            goal = start + count;
+            lbn += count;
+        }
     } else {
-        /* Crash-safer shrink: size first, then free tail blocks. */
-        ino.size_lo   = (uint32_t)(new_size & 0xFFFFFFFFu);
-        ino.size_high = (uint32_t)(new_size >> 32);
-        int rc = ext2_write_inode(&g_ext2_live, (uint32_t)node->inode->fs_ino, &ino);
-        if (rc != RDNX_OK) {
-            spinlock_unlock(&g_ext2_rw_lock);
-            return rc;
+        uint8_t* zero = (uint8_t*)kmalloc(bs);
+        if (!zero) {
+            rc = RDNX_E_NOMEM;
+        } else {
+            memset(zero, 0, bs);
+            for (; lbn < last; lbn++) {
+                cond_resched();
+                uint32_t pblk = 0;
+                int fresh = 0;
+                rc = ext2_bmap_alloc(ctx, &ino, lbn, goal, &pblk, &fresh, &inode_dirty);
+                if (rc == RDNX_OK && fresh) {
+                    rc = ext2_write_block(ctx, pblk, zero);
+                }
+                if (rc != RDNX_OK) {
+                    break;
+                }
+                goal = pblk + 1u;
+            }
+            kfree(zero);
         }
-        rc = ext2_trim_inode_blocks(&g_ext2_live, (uint32_t)node->inode->fs_ino, &ino, new_blocks);
-        spinlock_unlock(&g_ext2_rw_lock);
-        return rc;
     }
+
+    if (rc == RDNX_OK && !keep_size && end > ext2_inode_size_bytes(&ino)) {
+        ext2_inode_set_size(ctx, &ino, end);
+        inode_dirty = 1;
+    }
+    if (inode_dirty) {
+        int wrc = ext2_write_inode(ctx, ino_num, &ino);
+        if (rc == RDNX_OK) {
+            rc = wrc;
+        }
+    }
+    int frc = ext2_flush(ctx);
+    mutex_unlock(&g_ext2_rw_lock);
+    return (rc != RDNX_OK) ? rc : frc;
+}
+
+/*
+ * Every ext2 operation ends with ext2_flush(), so durability only needs the
+ * device write cache drained: by the superblock commit write when counters
+ * changed, by a plain flush otherwise. data_only (fdatasync) is accepted
+ * for API symmetry: there is no deferred inode state that fsync would have
+ * to write.
+ */
+int ext2_fsync_file(vfs_node_t* node, int data_only)
+{
+    (void)data_only;
+    mutex_lock(&g_ext2_rw_lock);
+    if (!node || !node->inode) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return RDNX_E_INVALID;
+    }
+    if (!g_ext2_live_ready || !g_ext2_live.bdev) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return RDNX_E_UNSUPPORTED;
+    }
+    if (node->inode->fs_tag != VFS_FS_TAG_EXT2) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return RDNX_E_UNSUPPORTED;
+    }
+    int rc = ext2_meta_flush(&g_ext2_live);
+    if (rc == RDNX_OK && g_ext2_live.super_dirty) {
+        rc = ext2_sync_super_and_gdt(&g_ext2_live, true);
+        if (rc == RDNX_OK) {
+            g_ext2_live.super_dirty = 0;
+        }
+    } else if (rc == RDNX_OK) {
+        rc = fabric_blockdev_flush(g_ext2_live.bdev);
+    }
+    mutex_unlock(&g_ext2_rw_lock);
+    return rc;
+}
+
+int ext2_sync_fs(void)
+{
+    mutex_lock(&g_ext2_rw_lock);
+    if (!g_ext2_live_ready || !g_ext2_live.bdev || !g_ext2_live.gdt || g_ext2_live.read_only) {
+        mutex_unlock(&g_ext2_rw_lock);
+        return RDNX_OK;
+    }
+    int rc = ext2_meta_flush(&g_ext2_live);
+    if (rc == RDNX_OK) {
+        rc = ext2_sync_super_and_gdt(&g_ext2_live, true);
+    }
+    if (rc == RDNX_OK) {
+        g_ext2_live.super_dirty = 0;
+    }
+    mutex_unlock(&g_ext2_rw_lock);
+    return rc;
 }
 
 static int ext2_mount(const char* source, vfs_node_t** out_root)
@@ -1448,6 +2433,11 @@ static int ext2_mount(const char* source, vfs_node_t** out_root)
     if (ctx.block_size < 1024u || ctx.block_size > EXT2_MAX_BLOCK_SIZE) {
         return RDNX_E_UNSUPPORTED;
     }
+    /* Group bitmaps are a single block; allocators scan them by group size. */
+    if (ctx.sb.blocks_per_group > ctx.block_size * 8u ||
+        ctx.sb.inodes_per_group > ctx.block_size * 8u) {
+        return RDNX_E_UNSUPPORTED;
+    }
 
     if (ctx.sb.rev_level == 0) {
         ctx.inode_size = 128u;
@@ -1475,6 +2465,11 @@ static int ext2_mount(const char* source, vfs_node_t** out_root)
         kfree(ctx.gdt);
         return rc;
     }
+    if (ctx.sb.feature_ro_compat & ~EXT2_FEATURE_RO_COMPAT_WRITE_SUPP) {
+        ctx.read_only = 1;
+        kprintf("[EXT2] %s: ro_compat 0x%x not writable, mounting read-only\n",
+                disk_name, (unsigned)(ctx.sb.feature_ro_compat & ~EXT2_FEATURE_RO_COMPAT_WRITE_SUPP));
+    }
 
     ext2_inode_t root_ino;
     rc = ext2_read_inode(&ctx, EXT2_ROOT_INO, &root_ino);
@@ -1495,13 +2490,18 @@ static int ext2_mount(const char* source, vfs_node_t** out_root)
     ext2_mark_node(root, EXT2_ROOT_INO);
     *out_root = root;
 
-    spinlock_lock(&g_ext2_rw_lock);
+    /* The mounted device must not go away under us (partition rescan). */
+    fabric_blockdev_retain(ctx.bdev);
+    mutex_lock(&g_ext2_rw_lock);
     if (g_ext2_live_ready && g_ext2_live.gdt) {
+        (void)ext2_flush(&g_ext2_live);
+        ext2_meta_release(&g_ext2_live);
         kfree(g_ext2_live.gdt);
+        fabric_blockdev_release(g_ext2_live.bdev);
     }
     g_ext2_live = ctx;
     g_ext2_live_ready = 1;
-    spinlock_unlock(&g_ext2_rw_lock);
+    mutex_unlock(&g_ext2_rw_lock);
     return RDNX_OK;
 }
 
@@ -1512,7 +2512,7 @@ static const vfs_fs_driver_t ext2_driver = {
 
 int ext2_fs_init(void)
 {
-    spinlock_init(&g_ext2_rw_lock);
+    mutex_init(&g_ext2_rw_lock, "ext2");
     (void)kmod_register_builtin("fs.ext2", "fs", "0.1", 0);
     return vfs_register_fs(&ext2_driver);
 }
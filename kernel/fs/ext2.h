@@ -12,9 +12,17 @@ typedef struct ext2_fs_caps {
     int write_in_place;
     int write_extend;
     int truncate;
+    int sparse;      /* holes read as zeros, truncate-up does not allocate */
+    int extents;     /* ext4 extent-mapped files (read and write) */
+    int preallocate; /* ext2_fallocate_file */
 } ext2_fs_caps_t;
 
 int ext2_fs_init(void);
 int ext2_query_caps(ext2_fs_caps_t* out_caps);
+int ext2_read_file(vfs_node_t* node, size_t off, void* buf, size_t len);
+int ext2_load_file_data(vfs_node_t* node);
 int ext2_writeback_file(vfs_node_t* node, size_t off, const void* data, size_t len, size_t final_size);
 int ext2_resize_file(vfs_node_t* node, size_t new_size);
+int ext2_fallocate_file(vfs_node_t* node, size_t off, size_t len, int keep_size);
+int ext2_fsync_file(vfs_node_t* node, int data_only);
+int ext2_sync_fs(void);
@@ -7,9 +7,18 @@
 #include "initrd.h"
 #include "ext2.h"
 #include "devfs.h"
+#include "vfs_bdev.h"
 #include "../fabric/service/block_service.h"
+#include "../vm/vm_object.h"
+#include "../vm/vm_reclaim.h"
 #include "../common/tty_console.h"
 #include "../common/heap.h"
+#include "../common/cgroup.h"
+#include "../common/rculist.h"
+#include "../common/preempt.h"
+#include "../common/random.h"
+#include "../fabric/spin.h"
+#include "../core/task.h"
 #include "../../include/common.h"
 #include "../../include/console.h"
 #include "../../include/error.h"
@@ -20,8 +29,8 @@
 typedef struct vfs_cache_entry {
     char path[64];
     vfs_node_t* node;
-    uint32_t gen;
     uint32_t node_gen; /* snapshot of node->inode->node_gen at insert time */
+    rcu_head_t rcu;
 } vfs_cache_entry_t;
 
 /*
@@ -29,19 +38,32 @@ typedef struct vfs_cache_entry {
  *   Protects: vfs_mounts, vfs_root_mount, vfs_root, vfs_ready.
  *   TODO: add a vfs_lock (rwlock or spinlock) before enabling concurrent VFS callers.
  *
- * LOCKING: VFS path cache (vfs_cache[], vfs_cache_gen, vfs_cache_rr).
- *   Currently unprotected — safe because all VFS mutations (vfs_mkdir, vfs_create,
- *   vfs_unlink) call vfs_cache_reset() and the cache is advisory (miss = re-lookup).
- *   On SMP or preemptible kernel: protect with a dedicated spinlock.
- *   cache entries include a node_gen stamp (P1-6A) to detect stale pointers on free.
+ * LOCKING: VFS path cache (vfs_cache[]) — RCU.
+ *   Direct-mapped by path hash. Entries are immutable once published:
+ *   vfs_cache_insert and vfs_cache_reset replace slots under vfs_cache_lock
+ *   and free the old entries with call_rcu, so vfs_cache_lookup needs only
+ *   rcu_read_lock(). All VFS mutations (vfs_mkdir, vfs_create, vfs_unlink)
+ *   call vfs_cache_reset() and the cache is advisory (miss = re-lookup).
+ *   Cache entries include a node_gen stamp (P1-6A) to detect stale pointers;
+ *   vfs_free_node defers the actual kfree by a grace period so the stamp
+ *   check never reads freed memory.
+ *
+ * LOCKING: vfs_node_lock (spinlock_t, irqsave: the reclaim shrinker runs from
+ *          the allocation path)
+ *   Protects: vfs_node_t::ref_count, and the ext2 inode data cache against
+ *             the shrinker. Holders of a node reference (open files, mmap)
+ *             may use inode->data without it: vfs_shrink_tree detaches the
+ *             cache only from linked nodes that the tree alone references,
+ *             and decides that under this lock, so it cannot race
+ *             vfs_node_retain.
  */
 static vfs_mount_t* vfs_mounts = NULL;
 static vfs_mount_t* vfs_root_mount = NULL;
 static vfs_node_t* vfs_root = NULL;
 static int vfs_ready = 0;
-static uint32_t vfs_cache_gen = 1;
-static uint32_t vfs_cache_rr = 0;
-static vfs_cache_entry_t vfs_cache[VFS_CACHE_SIZE];
+static vfs_cache_entry_t* vfs_cache[VFS_CACHE_SIZE];
+static spinlock_t vfs_cache_lock;
+static spinlock_t vfs_node_lock;
 
 static const void* vfs_initrd_data = NULL;
 static size_t vfs_initrd_size = 0;
@@ -60,15 +82,22 @@ static vfs_mount_t* vfs_find_mount_at(const vfs_node_t* node)
     return NULL;
 }
 
+static void vfs_cache_entry_free_rcu(rcu_head_t* head)
+{
+    kfree(rcu_entry(head, vfs_cache_entry_t, rcu));
+}
+
 static void vfs_cache_reset(void)
 {
-    vfs_cache_gen++;
+    spinlock_lock(&vfs_cache_lock);
     for (size_t i = 0; i < VFS_CACHE_SIZE; i++) {
-        vfs_cache[i].path[0] = '\0';
-        vfs_cache[i].node = NULL;
-        vfs_cache[i].gen = 0;
+        vfs_cache_entry_t* e = vfs_cache[i];
+        if (e) {
+            rcu_assign_pointer(vfs_cache[i], NULL);
+            call_rcu(&e->rcu, vfs_cache_entry_free_rcu);
+        }
     }
-    vfs_cache_rr = 0;
+    spinlock_unlock(&vfs_cache_lock);
 }
 
 static vfs_node_t* vfs_cache_lookup(const char* path)
@@ -76,20 +105,18 @@ static vfs_node_t* vfs_cache_lookup(const char* path)
     if (!path) {
         return NULL;
     }
-    for (size_t i = 0; i < VFS_CACHE_SIZE; i++) {
-        if (vfs_cache[i].gen != vfs_cache_gen) {
-            continue;
-        }
-        if (vfs_cache[i].path[0] != '\0' && strcmp(vfs_cache[i].path, path) == 0) {
-            /* Validate that the node has not been freed and reallocated (P1-6A) */
-            vfs_node_t* n = vfs_cache[i].node;
-            if (n && n->inode && n->inode->node_gen != vfs_cache[i].node_gen) {
-                continue; /* stale entry — node was freed and inode reused */
-            }
-            return n;
+    vfs_node_t* n = NULL;
+    rcu_read_lock();
+    vfs_cache_entry_t* e = rcu_dereference(vfs_cache[rcu_hash_str(path) & (VFS_CACHE_SIZE - 1)]);
+    if (e && strcmp(e->path, path) == 0) {
+        n = e->node;
+        /* Validate that the node has not been freed and reallocated (P1-6A) */
+        if (n && n->inode && n->inode->node_gen != e->node_gen) {
+            n = NULL; /* stale entry — node was freed and inode reused */
         }
     }
-    return NULL;
+    rcu_read_unlock();
+    return n;
 }
 
 static void vfs_cache_insert(const char* path, vfs_node_t* node)
@@ -97,12 +124,25 @@ static void vfs_cache_insert(const char* path, vfs_node_t* node)
     if (!path || !node) {
         return;
     }
-    size_t slot = vfs_cache_rr++ % VFS_CACHE_SIZE;
-    strncpy(vfs_cache[slot].path, path, sizeof(vfs_cache[slot].path) - 1);
-    vfs_cache[slot].path[sizeof(vfs_cache[slot].path) - 1] = '\0';
-    vfs_cache[slot].node = node;
-    vfs_cache[slot].gen = vfs_cache_gen;
-    vfs_cache[slot].node_gen = node->inode ? node->inode->node_gen : 0;
+    size_t len = strlen(path);
+    if (len >= sizeof(((vfs_cache_entry_t*)0)->path)) {
+        return; /* would be stored truncated and never match */
+    }
+    vfs_cache_entry_t* e = (vfs_cache_entry_t*)kmalloc(sizeof(*e));
+    if (!e) {
+        return;
+    }
+    memcpy(e->path, path, len + 1);
+    e->node = node;
+    e->node_gen = node->inode ? node->inode->node_gen : 0;
+    size_t slot = rcu_hash_str(path) & (VFS_CACHE_SIZE - 1);
+    spinlock_lock(&vfs_cache_lock);
+    vfs_cache_entry_t* old = vfs_cache[slot];
+    rcu_assign_pointer(vfs_cache[slot], e);
+    spinlock_unlock(&vfs_cache_lock);
+    if (old) {
+        call_rcu(&old->rcu, vfs_cache_entry_free_rcu);
+    }
 }
 
 static vfs_inode_t* vfs_alloc_inode(vfs_node_type_t type)
@@ -137,6 +177,13 @@ static vfs_node_t* vfs_alloc_node(const char* name, vfs_node_type_t type)
     return node;
 }
 
+static void vfs_node_free_rcu(rcu_head_t* head)
+{
+    vfs_node_t* node = rcu_entry(head, vfs_node_t, rcu);
+    kfree(node->inode);
+    kfree(node);
+}
+
 static void vfs_free_node(vfs_node_t* node)
 {
     if (!node) {
@@ -147,9 +194,13 @@ static void vfs_free_node(vfs_node_t* node)
         if (node->inode->data) {
             kfree(node->inode->data);
         }
-        kfree(node->inode);
+        if (node->inode->mem_cg) {
+            cgroup_mem_uncharge(node->inode->mem_cg, node->inode->mem_cg_pages, CGROUP_MEM_FILE);
+            cgroup_put(node->inode->mem_cg);
+        }
     }
-    kfree(node);
+    /* A path cache reader may still hold the pointer. */
+    call_rcu(&node->rcu, vfs_node_free_rcu);
 }
 
 /* Increment the reference count of a node.
@@ -157,7 +208,9 @@ static void vfs_free_node(vfs_node_t* node)
 static void vfs_node_retain(vfs_node_t* node)
 {
     if (node) {
+        irql_t irql = spinlock_lock_irqsave(&vfs_node_lock);
         node->ref_count++;
+        spinlock_unlock_irqrestore(&vfs_node_lock, irql);
     }
 }
 
@@ -169,14 +222,17 @@ static void vfs_node_release(vfs_node_t* node)
     if (!node) {
         return;
     }
+    irql_t irql = spinlock_lock_irqsave(&vfs_node_lock);
     if (node->ref_count == 0) {
+        spinlock_unlock_irqrestore(&vfs_node_lock, irql);
         /* Double-release bug — log and bail rather than underflow. */
         kprintf("[VFS] vfs_node_release: ref_count already 0 on node '%s'\n",
                 node->name);
         return;
     }
-    node->ref_count--;
-    if (node->ref_count == 0) {
+    uint32_t refs = --node->ref_count;
+    spinlock_unlock_irqrestore(&vfs_node_lock, irql);
+    if (refs == 0) {
         vfs_free_node(node);
     }
 }
@@ -295,6 +351,27 @@ static vfs_node_t* vfs_lookup(const char* path)
     return current;
 }
 
+/*
+ * File data is charged to the cgroup of the task that first grew it, in
+ * whole pages, and stays charged until the inode is freed.
+ */
+static int vfs_charge_data(vfs_inode_t* inode, size_t new_cap)
+{
+    uint64_t pages = ((uint64_t)new_cap + 4095u) / 4096u;
+    if (pages <= inode->mem_cg_pages) {
+        return RDNX_OK;
+    }
+    if (!inode->mem_cg) {
+        inode->mem_cg = cgroup_of(task_get_current());
+        cgroup_get(inode->mem_cg);
+    }
+    int rc = cgroup_mem_charge(inode->mem_cg, pages - inode->mem_cg_pages, CGROUP_MEM_FILE);
+    if (rc == RDNX_OK) {
+        inode->mem_cg_pages = pages;
+    }
+    return rc;
+}
+
 static int vfs_grow_file(vfs_node_t* node, size_t needed)
 {
     if (!node || node->type != VFS_NODE_FILE || !node->inode) {
@@ -307,6 +384,9 @@ static int vfs_grow_file(vfs_node_t* node, size_t needed)
     while (new_cap < needed) {
         new_cap *= 2;
     }
+    if (vfs_charge_data(node->inode, new_cap) != RDNX_OK) {
+        return -1;
+    }
     uint8_t* new_buf = (uint8_t*)kmalloc(new_cap);
     if (!new_buf) {
         return -1;
@@ -460,6 +540,7 @@ static int vfs_mount_devfs(void)
 }
 
 static int vfs_import_initrd(void);
+static uint64_t vfs_reclaim_file_data(uint64_t target_bytes);
 
 int vfs_mount_initrd_root(void)
 {
@@ -570,6 +651,7 @@ static int vfs_import_initrd(void)
 
     const initrd_entry_t* entries = (const initrd_entry_t*)(base + sizeof(initrd_header_t));
     for (uint32_t i = 0; i < hdr->entry_count; i++) {
+        cond_resched();
         const initrd_entry_t* e = &entries[i];
         if (e->path[0] == '\0') {
             continue;
@@ -631,6 +713,8 @@ int vfs_init(void)
         return RDNX_OK;
     }
     TRACE_EVENT("vfs_init");
+    spinlock_init(&vfs_cache_lock);
+    spinlock_init(&vfs_node_lock);
     (void)vfs_register_fs(&vfs_ramfs_driver);
     (void)devfs_fs_init();
     (void)ext2_fs_init();
@@ -642,6 +726,7 @@ int vfs_init(void)
         kputs("[VFS] initrd import failed\n");
     }
     tty_console_init();
+    (void)vm_reclaim_register_shrinker(vfs_reclaim_file_data);
     vfs_ready = 1;
     if (vfs_mount_devfs() != 0) {
         kputs("[VFS] devfs mount failed\n");
@@ -676,25 +761,10 @@ int vfs_mkdir(const char* path)
     return vfs_create_node(parent, leaf, VFS_NODE_DIR) ? RDNX_OK : RDNX_E_NOMEM;
 }
 
-int vfs_unlink(const char* path)
+/* Unlink node from its parent and drop the tree's reference. */
+static void vfs_detach_node(vfs_node_t* node)
 {
-    if (!path || !vfs_ready) {
-        return RDNX_E_INVALID;
-    }
-    vfs_node_t* node = vfs_lookup(path);
-    if (!node || node == vfs_root) {
-        return RDNX_E_NOTFOUND;
-    }
-    if (node->inode && node->inode->fs_tag == VFS_FS_TAG_EXT2) {
-        return RDNX_E_UNSUPPORTED;
-    }
-    if (node->type == VFS_NODE_DIR && node->children) {
-        return RDNX_E_BUSY;
-    }
     vfs_node_t* parent = node->parent;
-    if (!parent) {
-        return RDNX_E_INVALID;
-    }
     vfs_node_t* prev = NULL;
     for (vfs_node_t* it = parent->children; it; it = it->sibling) {
         if (it == node) {
@@ -713,6 +783,27 @@ int vfs_unlink(const char* path)
     node->parent = NULL;
     vfs_cache_reset();
     vfs_node_release(node); /* drop tree's reference; frees immediately if no open files */
+}
+
+int vfs_unlink(const char* path)
+{
+    if (!path || !vfs_ready) {
+        return RDNX_E_INVALID;
+    }
+    vfs_node_t* node = vfs_lookup(path);
+    if (!node || node == vfs_root) {
+        return RDNX_E_NOTFOUND;
+    }
+    if (node->inode && node->inode->fs_tag == VFS_FS_TAG_EXT2) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    if (node->type == VFS_NODE_DIR && node->children) {
+        return RDNX_E_BUSY;
+    }
+    if (!node->parent) {
+        return RDNX_E_INVALID;
+    }
+    vfs_detach_node(node);
     return RDNX_OK;
 }
 
@@ -827,10 +918,30 @@ int vfs_open(const char* path, int flags, vfs_file_t* out_file)
     if (node->type != VFS_NODE_FILE || !node->inode) {
         return RDNX_E_INVALID;
     }
+    bool is_bdev = (node->inode->flags & VFS_INODE_BLOCKDEV) != 0;
+    if ((flags & VFS_OPEN_DIRECT) && !is_bdev && node->inode->fs_tag != VFS_FS_TAG_EXT2) {
+        return RDNX_E_INVALID; /* RAM-backed nodes have no device to go direct to */
+    }
     vfs_node_retain(node);   /* file descriptor holds a reference */
     out_file->node = node;
     out_file->pos = 0;
     out_file->writable = (flags & VFS_OPEN_WRITE) != 0;
+    out_file->direct = (flags & VFS_OPEN_DIRECT) != 0;
+    out_file->bdev = NULL;
+    out_file->ra_buf = NULL;
+    out_file->ra_lba = 0;
+    out_file->ra_sectors = 0;
+    out_file->ra_window = 0;
+    out_file->ra_gen = 0;
+    out_file->ra_next = 0;
+    if (is_bdev) {
+        int brc = vfs_bdev_open(out_file);
+        if (brc != RDNX_OK) {
+            vfs_node_release(node);
+            out_file->node = NULL;
+            return brc;
+        }
+    }
     if (flags & VFS_OPEN_TRUNC) {
         int trc = vfs_resize_file(out_file, 0);
         if (trc != RDNX_OK) {
@@ -849,12 +960,14 @@ int vfs_close(vfs_file_t* file)
     if (!file) {
         return RDNX_E_INVALID;
     }
+    vfs_bdev_close(file);
     if (file->node) {
         vfs_node_release(file->node); /* drops the reference taken in vfs_open */
         file->node = NULL;
     }
     file->pos = 0;
     file->writable = false;
+    file->direct = false;
     return RDNX_OK;
 }
 
@@ -864,7 +977,10 @@ int vfs_file_dup(const vfs_file_t* src, vfs_file_t* dst)
         return RDNX_E_INVALID;
     }
     *dst = *src;                   /* shallow copy — position, flags, node ptr */
+    dst->ra_buf = NULL;            /* read-ahead buffer stays with src */
+    dst->ra_sectors = 0;
     vfs_node_retain(dst->node);    /* dst now holds its own reference */
+    vfs_bdev_dup(dst);
     return RDNX_OK;
 }
 
@@ -884,48 +1000,36 @@ int vfs_read(vfs_file_t* file, void* buffer, size_t size)
         memset(buffer, 0, size);
         return (int)size;
     }
+    if (inode->flags & (VFS_INODE_DEV_RANDOM | VFS_INODE_DEV_URANDOM)) {
+        /* Short reads above RANDOM_GET_MAX, like getrandom(). */
+        uint32_t rflags = (inode->flags & VFS_INODE_DEV_URANDOM) ? RANDOM_F_INSECURE : 0u;
+        return random_get_bytes(buffer, size, rflags);
+    }
     if (inode->flags & VFS_INODE_BLOCKDEV) {
-        fabric_blockdev_t* bdev = fabric_blockdev_find(file->node->name);
-        if (!bdev || bdev->sector_size == 0) {
-            return RDNX_E_NOTFOUND;
-        }
-        if (size == 0) {
-            return 0;
-        }
-        uint8_t* out = (uint8_t*)buffer;
-        uint32_t sector_size = bdev->sector_size;
-        uint8_t* bounce = (uint8_t*)kmalloc(sector_size);
-        if (!bounce) {
-            return RDNX_E_NOMEM;
-        }
-        size_t done = 0;
-        while (done < size) {
-            uint64_t abs_off = (uint64_t)file->pos + (uint64_t)done;
-            uint64_t lba = abs_off / (uint64_t)sector_size;
-            uint32_t in_sector_off = (uint32_t)(abs_off % (uint64_t)sector_size);
-            size_t chunk = size - done;
-            size_t max_chunk = (size_t)sector_size - (size_t)in_sector_off;
-            if (chunk > max_chunk) {
-                chunk = max_chunk;
-            }
-
-            int rc = fabric_blockdev_read(bdev, lba, 1, bounce);
-            if (rc != RDNX_OK) {
-                kfree(bounce);
-                return rc;
+        if (!file->bdev) {
+            int brc = vfs_bdev_open(file);
+            if (brc != RDNX_OK) {
+                return brc;
             }
-            memcpy(out + done, bounce + in_sector_off, chunk);
-            done += chunk;
         }
-        kfree(bounce);
-        file->pos += size;
-        return (int)size;
+        return vfs_bdev_read(file, buffer, size);
     }
     if (file->pos >= inode->size) {
         return 0;
     }
     size_t avail = inode->size - file->pos;
     size_t to_read = size < avail ? size : avail;
+    if (inode->fs_tag == VFS_FS_TAG_EXT2 && (file->direct || !inode->data)) {
+        if (file->direct && ((file->pos | size) % VFS_DIRECT_ALIGN) != 0) {
+            return RDNX_E_INVALID;
+        }
+        int rc = ext2_read_file(file->node, file->pos, buffer, to_read);
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+        file->pos += to_read;
+        return (int)to_read;
+    }
     memcpy(buffer, inode->data + file->pos, to_read);
     file->pos += to_read;
     return (int)to_read;
@@ -946,7 +1050,15 @@ int vfs_write(vfs_file_t* file, const void* buffer, size_t size)
     if (inode->flags & VFS_INODE_DEV_ZERO) {
         return (int)size;
     }
+    if (inode->flags & (VFS_INODE_DEV_RANDOM | VFS_INODE_DEV_URANDOM)) {
+        /* Written data is mixed into the pool without entropy credit. */
+        random_add_entropy(buffer, size, 0);
+        return (int)size;
+    }
     if (inode->fs_tag == VFS_FS_TAG_EXT2) {
+        if (file->direct && ((file->pos | size) % VFS_DIRECT_ALIGN) != 0) {
+            return RDNX_E_INVALID;
+        }
         size_t end = file->pos + size;
         size_t final_size = (end > inode->size) ? end : inode->size;
         int wrc = ext2_writeback_file(file->node, file->pos, buffer, size, final_size);
@@ -972,24 +1084,13 @@ int vfs_write(vfs_file_t* file, const void* buffer, size_t size)
         return (int)size;
     }
     if (inode->flags & VFS_INODE_BLOCKDEV) {
-        fabric_blockdev_t* bdev = fabric_blockdev_find(file->node->name);
-        if (!bdev || bdev->sector_size == 0) {
-            return RDNX_E_NOTFOUND;
-        }
-        if (size == 0) {
-            return 0;
-        }
-        if ((file->pos % bdev->sector_size) != 0 || (size % bdev->sector_size) != 0) {
-            return RDNX_E_INVALID;
-        }
-        uint64_t lba = (uint64_t)file->pos / (uint64_t)bdev->sector_size;
-        uint32_t count = (uint32_t)(size / bdev->sector_size);
-        int rc = fabric_blockdev_write(bdev, lba, count, buffer);
-        if (rc != RDNX_OK) {
-            return rc;
+        if (!file->bdev) {
+            int brc = vfs_bdev_open(file);
+            if (brc != RDNX_OK) {
+                return brc;
+            }
         }
-        file->pos += size;
-        return (int)size;
+        return vfs_bdev_write(file, buffer, size);
     }
     size_t end = file->pos + size;
     if (vfs_grow_file(file->node, end) != 0) {
@@ -1018,6 +1119,9 @@ int vfs_seek(vfs_file_t* file, int64_t off, int whence, uint64_t* out_pos)
 
     base = 0;
     end = (uint64_t)file->node->inode->size;
+    if (file->node->inode->flags & VFS_INODE_BLOCKDEV) {
+        end = vfs_bdev_size(file);
+    }
     switch (whence) {
         case 0: /* SEEK_SET */
             base = 0;
@@ -1073,6 +1177,210 @@ int vfs_ftruncate(vfs_file_t* file, uint64_t size)
     return vfs_resize_file(file, (size_t)size);
 }
 
+int vfs_fallocate(vfs_file_t* file, int mode, uint64_t off, uint64_t len)
+{
+    if (!file || !file->node || file->node->type != VFS_NODE_FILE || !file->node->inode || !file->writable) {
+        return RDNX_E_INVALID;
+    }
+    if ((mode & ~VFS_FALLOC_KEEP_SIZE) != 0) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    if (len == 0 || off + len < off || off + len > (uint64_t)SIZE_MAX) {
+        return RDNX_E_INVALID;
+    }
+    vfs_inode_t* inode = file->node->inode;
+    if ((inode->flags & (VFS_INODE_CONSOLE | VFS_INODE_CHARDEV | VFS_INODE_BLOCKDEV)) != 0) {
+        return RDNX_E_UNSUPPORTED;
+    }
+
+    int keep_size = (mode & VFS_FALLOC_KEEP_SIZE) != 0;
+    size_t end = (size_t)(off + len);
+    if (inode->fs_tag == VFS_FS_TAG_EXT2) {
+        int rc = ext2_fallocate_file(file->node, (size_t)off, (size_t)len, keep_size);
+        if (rc != RDNX_OK || keep_size || end <= inode->size) {
+            return rc;
+        }
+        if (inode->data && end > inode->capacity) {
+            if (vfs_grow_file(file->node, end) != 0) {
+                return RDNX_E_NOMEM;
+            }
+        }
+        if (inode->data) {
+            memset(inode->data + inode->size, 0, end - inode->size);
+        }
+        inode->size = end;
+        return RDNX_OK;
+    }
+
+    /* RAM-backed: reserve capacity now so later writes cannot fail for space. */
+    if (vfs_grow_file(file->node, end) != 0) {
+        return RDNX_E_NOMEM;
+    }
+    if (!keep_size && end > inode->size) {
+        memset(inode->data + inode->size, 0, end - inode->size);
+        inode->size = end;
+    }
+    return RDNX_OK;
+}
+
+/*
+ * MAP_SHARED pages land in inode->data on msync; ext2 only sees them once
+ * they are written back here.
+ */
+static int vfs_persist_mmap(vfs_node_t* node)
+{
+    vfs_inode_t* inode = node->inode;
+    if (!inode || inode->fs_tag != VFS_FS_TAG_EXT2 || !inode->mmap_object) {
+        return RDNX_OK;
+    }
+    vm_file_backing_t* fb = (vm_file_backing_t*)inode->mmap_object->pager_private;
+    if (!fb || !fb->dirty || !inode->data || inode->size == 0) {
+        return RDNX_OK;
+    }
+    int rc = ext2_writeback_file(node, 0, inode->data, inode->size, inode->size);
+    if (rc == RDNX_OK) {
+        fb->dirty = 0;
+    }
+    return rc;
+}
+
+int vfs_fsync(vfs_file_t* file, bool data_only)
+{
+    if (!file || !file->node || !file->node->inode) {
+        return RDNX_E_INVALID;
+    }
+    vfs_inode_t* inode = file->node->inode;
+    if (inode->flags & VFS_INODE_BLOCKDEV) {
+        fabric_blockdev_t* bdev = file->bdev ? file->bdev : fabric_blockdev_find(file->node->name);
+        return bdev ? fabric_blockdev_flush(bdev) : RDNX_E_NOTFOUND;
+    }
+    if (inode->fs_tag != VFS_FS_TAG_EXT2) {
+        /* RAM-backed nodes are always "on stable storage". */
+        return RDNX_OK;
+    }
+    int rc = vfs_persist_mmap(file->node);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    return ext2_fsync_file(file->node, data_only ? 1 : 0);
+}
+
+static int vfs_sync_tree(vfs_node_t* node, uint32_t depth)
+{
+    int result = RDNX_OK;
+    if (!node || depth > 32u) {
+        return result;
+    }
+    if (node->type == VFS_NODE_FILE) {
+        return vfs_persist_mmap(node);
+    }
+    for (vfs_node_t* child = node->children; child; child = child->sibling) {
+        int rc = vfs_sync_tree(child, depth + 1u);
+        if (rc != RDNX_OK && result == RDNX_OK) {
+            result = rc;
+        }
+    }
+    return result;
+}
+
+/*
+ * Reclaim shrinker: ext2 writes are write-through, so inode->data is a clean
+ * cache that ext2 streams around when it is NULL. Drop it for files that are
+ * neither open nor mapped. The walk runs under rcu_read_lock (nodes are
+ * freed after a grace period); the cache is detached under vfs_node_lock and
+ * freed after it is dropped.
+ */
+static uint64_t vfs_shrink_node(vfs_node_t* node)
+{
+    vfs_inode_t* inode = node->inode;
+    uint8_t* data = NULL;
+    uint64_t released = 0;
+    struct cgroup* cg = NULL;
+    uint64_t cg_pages = 0;
+
+    irql_t irql = spinlock_lock_irqsave(&vfs_node_lock);
+    if (inode && inode->fs_tag == VFS_FS_TAG_EXT2 && inode->data && !inode->mmap_object &&
+        !node->unlinked && node->ref_count == 1u && !vm_object_backing_in_use(inode->data)) {
+        data = inode->data;
+        released = inode->capacity ? (uint64_t)inode->capacity : (uint64_t)inode->size;
+        cg = inode->mem_cg;
+        cg_pages = inode->mem_cg_pages;
+        inode->data = NULL;
+        inode->capacity = 0;
+        inode->mem_cg = NULL;
+        inode->mem_cg_pages = 0;
+    }
+    spinlock_unlock_irqrestore(&vfs_node_lock, irql);
+
+    if (!data) {
+        return 0;
+    }
+    kfree(data);
+    if (cg) {
+        cgroup_mem_uncharge(cg, cg_pages, CGROUP_MEM_FILE);
+        cgroup_put(cg);
+    }
+    return released;
+}
+
+static uint64_t vfs_shrink_tree(vfs_node_t* node, uint32_t depth, uint64_t target)
+{
+    uint64_t released = 0;
+    if (!node || depth > 32u) {
+        return 0;
+    }
+    if (node->type == VFS_NODE_FILE) {
+        return vfs_shrink_node(node);
+    }
+    for (vfs_node_t* child = node->children; child && released < target; child = child->sibling) {
+        released += vfs_shrink_tree(child, depth + 1u, target - released);
+    }
+    return released;
+}
+
+static uint64_t vfs_reclaim_file_data(uint64_t target_bytes)
+{
+    if (!vfs_ready) {
+        return 0;
+    }
+    rcu_read_lock();
+    uint64_t released = vfs_shrink_tree(vfs_root, 0, target_bytes);
+    for (vfs_mount_t* it = vfs_mounts; it && released < target_bytes; it = it->next) {
+        if (it->root == vfs_root) {
+            continue;
+        }
+        released += vfs_shrink_tree(it->root, 0, target_bytes - released);
+    }
+    rcu_read_unlock();
+    return released;
+}
+
+int vfs_sync(void)
+{
+    if (!vfs_ready) {
+        return RDNX_E_INVALID;
+    }
+    int result = vfs_sync_tree(vfs_root, 0);
+    for (vfs_mount_t* it = vfs_mounts; it; it = it->next) {
+        if (it->root == vfs_root) {
+            continue;
+        }
+        int rc = vfs_sync_tree(it->root, 0);
+        if (rc != RDNX_OK && result == RDNX_OK) {
+            result = rc;
+        }
+    }
+    int rc = ext2_sync_fs();
+    if (rc != RDNX_OK && result == RDNX_OK) {
+        result = rc;
+    }
+    rc = fabric_blockdev_sync_all();
+    if (rc != RDNX_OK && result == RDNX_OK) {
+        result = rc;
+    }
+    return result;
+}
+
 int vfs_stat(const char* path, vfs_stat_t* out_stat)
 {
     vfs_node_t* node;
@@ -1114,6 +1422,22 @@ int vfs_fs_add_child(vfs_node_t* parent, vfs_node_t* child)
     return (vfs_add_child(parent, child) == 0) ? RDNX_OK : RDNX_E_INVALID;
 }
 
+int vfs_fs_remove_child(vfs_node_t* parent, const char* name)
+{
+    if (!parent || !name) {
+        return RDNX_E_INVALID;
+    }
+    vfs_node_t* node = vfs_find_child(parent, name);
+    if (!node) {
+        return RDNX_E_NOTFOUND;
+    }
+    if (node->type == VFS_NODE_DIR && node->children) {
+        return RDNX_E_BUSY;
+    }
+    vfs_detach_node(node);
+    return RDNX_OK;
+}
+
 int vfs_fs_set_file_data(vfs_node_t* node, const void* data, size_t size)
 {
     if (!node || node->type != VFS_NODE_FILE || !node->inode) {
@@ -1132,6 +1456,20 @@ int vfs_fs_set_file_data(vfs_node_t* node, const void* data, size_t size)
     return RDNX_OK;
 }
 
+int vfs_node_materialize(vfs_node_t* node)
+{
+    if (!node || node->type != VFS_NODE_FILE || !node->inode) {
+        return RDNX_E_INVALID;
+    }
+    if (node->inode->data || node->inode->size == 0) {
+        return RDNX_OK;
+    }
+    if (node->inode->fs_tag == VFS_FS_TAG_EXT2) {
+        return ext2_load_file_data(node);
+    }
+    return RDNX_OK;
+}
+
 void vfs_fs_free_node(vfs_node_t* node)
 {
     vfs_node_release(node);
@@ -8,8 +8,10 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include "../common/rcu.h"
 
 typedef struct vm_object vm_object_t;
+struct cgroup;
 
 typedef enum {
     VFS_NODE_FILE = 0,
@@ -26,6 +28,8 @@ typedef struct vfs_inode {
     size_t capacity;
     uint8_t* data;
     vm_object_t* mmap_object;
+    struct cgroup* mem_cg;    /* group charged for data (first writer), page granular */
+    uint64_t mem_cg_pages;
     uint32_t node_gen; /* incremented on vfs_free_node; cache uses this to detect stale entries */
 } vfs_inode_t;
 
@@ -43,9 +47,11 @@ typedef struct vfs_node {
      *   vfs_unlink drops the tree reference; the node is freed when
      *   the last vfs_file_t holding it is closed.
      *   unlinked = true once the node has been removed from the namespace.
+     *   ref_count is updated under vfs_node_lock (vfs.c).
      */
     uint32_t ref_count;
     bool     unlinked;
+    rcu_head_t rcu;   /* kfree deferred past path cache readers */
 } vfs_node_t;
 
 typedef struct vfs_mount {
@@ -55,10 +61,21 @@ typedef struct vfs_mount {
     struct vfs_mount* next;
 } vfs_mount_t;
 
+struct fabric_blockdev;
+
 typedef struct vfs_file {
     vfs_node_t* node;
     size_t pos;
     bool writable;
+    bool direct;                  /* VFS_OPEN_DIRECT: no read-ahead / in-memory copy */
+    struct fabric_blockdev* bdev; /* VFS_INODE_BLOCKDEV: resolved once at open */
+    /* Block-device read-ahead window, private to this open file. */
+    uint8_t* ra_buf;
+    uint64_t ra_lba;
+    uint32_t ra_sectors;          /* valid sectors in ra_buf */
+    uint32_t ra_window;           /* next fill size in sectors while sequential */
+    uint32_t ra_gen;              /* bdev->write_gen when ra_buf was filled */
+    uint64_t ra_next;             /* offset a sequential reader asks for next */
 } vfs_file_t;
 
 typedef struct vfs_stat {
@@ -78,7 +95,15 @@ enum {
     VFS_OPEN_READ   = 1 << 0,
     VFS_OPEN_WRITE  = 1 << 1,
     VFS_OPEN_CREATE = 1 << 2,
-    VFS_OPEN_TRUNC  = 1 << 3
+    VFS_OPEN_TRUNC  = 1 << 3,
+    VFS_OPEN_DIRECT = 1 << 4  /* O_DIRECT: sector-aligned I/O straight to the device */
+};
+
+/* O_DIRECT offset/length granularity on filesystem files (one 512-byte sector). */
+#define VFS_DIRECT_ALIGN 512u
+
+enum {
+    VFS_FALLOC_KEEP_SIZE = 1 << 0
 };
 
 enum {
@@ -86,7 +111,9 @@ enum {
     VFS_INODE_DEV_NULL = 1u << 1,
     VFS_INODE_DEV_ZERO = 1u << 2,
     VFS_INODE_CHARDEV = 1u << 3,
-    VFS_INODE_BLOCKDEV = 1u << 4
+    VFS_INODE_BLOCKDEV = 1u << 4,
+    VFS_INODE_DEV_RANDOM = 1u << 5,   /* blocks until the entropy pool is seeded */
+    VFS_INODE_DEV_URANDOM = 1u << 6   /* never blocks */
 };
 
 enum {
@@ -106,7 +133,12 @@ int vfs_mount_initrd_root(void);
 
 vfs_node_t* vfs_fs_alloc_node(const char* name, vfs_node_type_t type);
 int vfs_fs_add_child(vfs_node_t* parent, vfs_node_t* child);
+/* Take a child out of a filesystem's tree; open files keep the node alive. */
+int vfs_fs_remove_child(vfs_node_t* parent, const char* name);
 int vfs_fs_set_file_data(vfs_node_t* node, const void* data, size_t size);
+/* Ensure inode->data holds the whole file (mmap). ext2 files are otherwise
+ * read from disk on demand and have no in-memory copy. */
+int vfs_node_materialize(vfs_node_t* node);
 /* Release a node allocated with vfs_fs_alloc_node that was never added to the
  * tree (or was added and later removed). Drops the tree reference. */
 void vfs_fs_free_node(vfs_node_t* node);
@@ -126,5 +158,8 @@ int vfs_write(vfs_file_t* file, const void* buffer, size_t size);
 int vfs_seek(vfs_file_t* file, int64_t off, int whence, uint64_t* out_pos);
 int vfs_truncate(const char* path, uint64_t size);
 int vfs_ftruncate(vfs_file_t* file, uint64_t size);
+int vfs_fallocate(vfs_file_t* file, int mode, uint64_t off, uint64_t len);
+int vfs_fsync(vfs_file_t* file, bool data_only);
+int vfs_sync(void);
 int vfs_stat(const char* path, vfs_stat_t* out_stat);
 int vfs_fstat(const vfs_file_t* file, vfs_stat_t* out_stat);
@@ -0,0 +1,279 @@
+/**
+ * @file vfs_bdev.c
+ * @brief File I/O on block-device nodes (VFS_INODE_BLOCKDEV)
+ *
+ * Sector-aligned spans go to the driver as multi-sector requests straight
+ * into / out of the caller's buffer. Unaligned edges use one sector-sized
+ * bounce: reads through the read-ahead buffer, writes as read-modify-write.
+ * Sequential readers get a read-ahead window that doubles up to
+ * VFS_BDEV_RA_MAX sectors; any device write invalidates it via write_gen.
+ * O_DIRECT files skip read-ahead and must be sector aligned.
+ */
+
+#include "vfs_bdev.h"
+#include "../common/heap.h"
+#include "../fabric/service/block_service.h"
+#include "../../include/common.h"
+#include "../../include/error.h"
+
+#define VFS_BDEV_RA_MIN 32u       /* sectors: first window of a sequential stream */
+#define VFS_BDEV_RA_MAX 256u      /* sectors: largest window (128 KB at 512 B) */
+#define VFS_BDEV_MAX_XFER 1024u   /* sectors per driver request */
+#define VFS_BDEV_MAX_IO 0x7FFFF000u
+
+int vfs_bdev_open(vfs_file_t* file)
+{
+    if (!file || !file->node) {
+        return RDNX_E_INVALID;
+    }
+    fabric_blockdev_t* bdev = fabric_blockdev_acquire(file->node->name);
+    if (!bdev || bdev->sector_size == 0) {
+        fabric_blockdev_release(bdev);
+        return RDNX_E_NOTFOUND;
+    }
+    file->bdev = bdev;
+    file->ra_buf = NULL;
+    file->ra_sectors = 0;
+    file->ra_window = VFS_BDEV_RA_MIN;
+    file->ra_next = 0;
+    return RDNX_OK;
+}
+
+void vfs_bdev_close(vfs_file_t* file)
+{
+    if (!file) {
+        return;
+    }
+    if (file->ra_buf) {
+        kfree(file->ra_buf);
+    }
+    file->ra_buf = NULL;
+    file->ra_sectors = 0;
+    fabric_blockdev_release(file->bdev);
+    file->bdev = NULL;
+}
+
+void vfs_bdev_dup(vfs_file_t* file)
+{
+    if (file && file->bdev) {
+        fabric_blockdev_retain(file->bdev);
+    }
+}
+
+uint64_t vfs_bdev_size(const vfs_file_t* file)
+{
+    if (!file || !file->bdev) {
+        return 0;
+    }
+    return file->bdev->sector_count * (uint64_t)file->bdev->sector_size;
+}
+
+/* Clamp [pos, pos + size) to the device; 0 means EOF. */
+static size_t vfs_bdev_clamp(const vfs_file_t* file, size_t size)
+{
+    uint64_t dev_bytes = vfs_bdev_size(file);
+    if ((uint64_t)file->pos >= dev_bytes) {
+        return 0;
+    }
+    if ((uint64_t)size > dev_bytes - (uint64_t)file->pos) {
+        size = (size_t)(dev_bytes - (uint64_t)file->pos);
+    }
+    if (size > VFS_BDEV_MAX_IO) {
+        size = VFS_BDEV_MAX_IO;
+    }
+    return size;
+}
+
+static int vfs_bdev_xfer(fabric_blockdev_t* bdev, uint64_t lba, uint64_t count, uint8_t* buf, int write)
+{
+    while (count > 0) {
+        uint32_t n = (count > VFS_BDEV_MAX_XFER) ? VFS_BDEV_MAX_XFER : (uint32_t)count;
+        int rc = write ? fabric_blockdev_write(bdev, lba, n, buf)
+                       : fabric_blockdev_read(bdev, lba, n, buf);
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+        lba += n;
+        count -= n;
+        buf += (size_t)n * bdev->sector_size;
+    }
+    return RDNX_OK;
+}
+
+static int vfs_bdev_ra_fill(vfs_file_t* file, uint64_t lba, uint32_t count)
+{
+    fabric_blockdev_t* bdev = file->bdev;
+    if (!file->ra_buf) {
+        file->ra_buf = (uint8_t*)kmalloc((size_t)VFS_BDEV_RA_MAX * bdev->sector_size);
+        if (!file->ra_buf) {
+            return RDNX_E_NOMEM;
+        }
+    }
+    if (count > VFS_BDEV_RA_MAX) {
+        count = VFS_BDEV_RA_MAX;
+    }
+    if (count > bdev->sector_count - lba) {
+        count = (uint32_t)(bdev->sector_count - lba);
+    }
+    file->ra_sectors = 0;
+    file->ra_gen = bdev->write_gen;
+    int rc = fabric_blockdev_read(bdev, lba, count, file->ra_buf);
+    if (rc != RDNX_OK) {
+        return rc;
+    }
+    file->ra_lba = lba;
+    file->ra_sectors = count;
+    return RDNX_OK;
+}
+
+int vfs_bdev_read(vfs_file_t* file, void* buffer, size_t size)
+{
+    if (!file || !file->bdev || !buffer) {
+        return RDNX_E_INVALID;
+    }
+    fabric_blockdev_t* bdev = file->bdev;
+    uint32_t ss = bdev->sector_size;
+    size = vfs_bdev_clamp(file, size);
+    if (size == 0) {
+        return 0;
+    }
+
+    uint8_t* out = (uint8_t*)buffer;
+    if (file->direct) {
+        if ((file->pos % ss) != 0 || (size % ss) != 0) {
+            return RDNX_E_INVALID;
+        }
+        int rc = vfs_bdev_xfer(bdev, (uint64_t)file->pos / ss, size / ss, out, 0);
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+        file->pos += size;
+        return (int)size;
+    }
+
+    int sequential = ((uint64_t)file->pos == file->ra_next);
+    if (!sequential) {
+        file->ra_window = VFS_BDEV_RA_MIN;
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        uint64_t cur = (uint64_t)file->pos + done;
+        uint64_t lba = cur / ss;
+        uint32_t soff = (uint32_t)(cur % ss);
+        size_t left = size - done;
+
+        if (file->ra_sectors != 0 && file->ra_gen == bdev->write_gen &&
+            lba >= file->ra_lba && lba < file->ra_lba + file->ra_sectors) {
+            uint64_t base = file->ra_lba * ss;
+            uint64_t avail = base + (uint64_t)file->ra_sectors * ss - cur;
+            size_t n = ((uint64_t)left < avail) ? left : (size_t)avail;
+            memcpy(out + done, file->ra_buf + (cur - base), n);
+            done += n;
+            continue;
+        }
+
+        /*
+         * Whole sectors go straight into the caller's buffer unless the
+         * stream is sequential and the request is smaller than the window,
+         * in which case a larger read-ahead request serves it and the next
+         * few reads.
+         */
+        if (soff == 0 && left >= ss && (!sequential || left >= (size_t)file->ra_window * ss)) {
+            uint64_t count = left / ss;
+            int rc = vfs_bdev_xfer(bdev, lba, count, out + done, 0);
+            if (rc != RDNX_OK) {
+                return rc;
+            }
+            done += (size_t)count * ss;
+            continue;
+        }
+
+        int rc = vfs_bdev_ra_fill(file, lba, sequential ? file->ra_window : 1u);
+        if (rc != RDNX_OK) {
+            return rc;
+        }
+        if (sequential && file->ra_window < VFS_BDEV_RA_MAX) {
+            file->ra_window *= 2u;
+        }
+    }
+
+    file->pos += size;
+    file->ra_next = (uint64_t)file->pos;
+    return (int)size;
+}
+
+int vfs_bdev_write(vfs_file_t* file, const void* buffer, size_t size)
+{
+    if (!file || !file->bdev || !buffer) {
+        return RDNX_E_INVALID;
+    }
+    fabric_blockdev_t* bdev = file->bdev;
+    uint32_t ss = bdev->sector_size;
+    if (size == 0) {
+        return 0;
+    }
+    if ((uint64_t)file->pos >= vfs_bdev_size(file) ||
+        (uint64_t)size > vfs_bdev_size(file) - (uint64_t)file->pos) {
+        return RDNX_E_INVALID;
+    }
+    if (size > VFS_BDEV_MAX_IO) {
+        size = VFS_BDEV_MAX_IO;
+    }
+
+    const uint8_t* in = (const uint8_t*)buffer;
+    if (file->direct && ((file->pos % ss) != 0 || (size % ss) != 0)) {
+        return RDNX_E_INVALID;
+    }
+
+    uint8_t* bounce = NULL;
+    size_t done = 0;
+    int rc = RDNX_OK;
+    while (done < size) {
+        uint64_t cur = (uint64_t)file->pos + done;
+        uint64_t lba = cur / ss;
+        uint32_t soff = (uint32_t)(cur % ss);
+        size_t left = size - done;
+
+        if (soff == 0 && left >= ss) {
+            uint64_t count = left / ss;
+            rc = vfs_bdev_xfer(bdev, lba, count, (uint8_t*)(uintptr_t)(in + done), 1);
+            if (rc != RDNX_OK) {
+                break;
+            }
+            done += (size_t)count * ss;
+            continue;
+        }
+
+        /* Partial sector: read-modify-write through one bounce sector. */
+        size_t n = ss - soff;
+        if (n > left) {
+            n = left;
+        }
+        if (!bounce) {
+            bounce = (uint8_t*)kmalloc(ss);
+            if (!bounce) {
+                rc = RDNX_E_NOMEM;
+                break;
+            }
+        }
+        rc = fabric_blockdev_read(bdev, lba, 1, bounce);
+        if (rc != RDNX_OK) {
+            break;
+        }
+        memcpy(bounce + soff, in + done, n);
+        rc = fabric_blockdev_write(bdev, lba, 1, bounce);
+        if (rc != RDNX_OK) {
+            break;
+        }
+        done += n;
+    }
+    if (bounce) {
+        kfree(bounce);
+    }
+    if (done == 0) {
+        return rc;
+    }
+    file->pos += done;
+    return (int)done;
+}
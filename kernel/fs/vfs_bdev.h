@@ -0,0 +1,18 @@
+/**
+ * @file vfs_bdev.h
+ * @brief File I/O on block-device nodes (VFS_INODE_BLOCKDEV)
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vfs.h"
+
+int vfs_bdev_open(vfs_file_t* file);
+void vfs_bdev_close(vfs_file_t* file);
+/* A dup of an open block-device file holds the device too. */
+void vfs_bdev_dup(vfs_file_t* file);
+uint64_t vfs_bdev_size(const vfs_file_t* file);
+int vfs_bdev_read(vfs_file_t* file, void* buffer, size_t size);
+int vfs_bdev_write(vfs_file_t* file, const void* buffer, size_t size);
@@ -23,6 +23,8 @@ void input_init_keyboard(void);
 
 /* Entry point for drivers: raw events */
 void input_push_scancode(uint16_t scancode, bool pressed);
+/* Entry point for character devices (virtio-console); non-IRQ context */
+void input_push_char(uint8_t c);
 
 /* API for consumers (shell, console) */
 bool input_has_char(void);
@@ -389,6 +389,21 @@ void input_push_scancode(uint16_t scancode, bool pressed)
     spinlock_unlock(&input_state.lock);
 }
 
+/**
+ * @function input_push_char
+ * @brief Add an already translated character (serial-style devices)
+ *
+ * @param c Character from the device
+ *
+ * @note Called from non-IRQ context, like input_push_scancode()
+ */
+void input_push_char(uint8_t c)
+{
+    spinlock_lock(&input_state.lock);
+    (void)input_buffer_put(c);
+    spinlock_unlock(&input_state.lock);
+}
+
 /* ============================================================================
  * Helper: poll the PS/2 keyboard in polling mode
  * ============================================================================
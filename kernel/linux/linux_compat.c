@@ -10,6 +10,7 @@
 #include "../unix/unix_layer.h"
 #include "../arch/pmm.h"
 #include "../vm/vm_map.h"
+#include "../common/rusage.h"
 #include "../../include/error.h"
 #include "../../include/common.h"
 #include "../../include/console.h"
@@ -26,6 +27,7 @@ enum {
     LINUX_O_CREAT = 00000100,
     LINUX_O_TRUNC = 00001000,
     LINUX_O_APPEND = 00002000,
+    LINUX_O_DIRECT = 00040000,
     LINUX_AT_FDCWD = -100,
     LINUX_PAGE_SIZE = 4096,
     LINUX_DT_DIR = 4,
@@ -62,6 +64,11 @@ typedef struct linux_sysinfo_u {
     uint8_t _f[4];
 } linux_sysinfo_u_t;
 
+typedef struct linux_rlimit_u {
+    uint64_t rlim_cur;
+    uint64_t rlim_max;
+} linux_rlimit_u_t;
+
 typedef struct linux_iovec_u {
     uint64_t iov_base;
     uint64_t iov_len;
@@ -351,6 +358,63 @@ static inline uint64_t linux_ret(uint64_t native_ret)
     return (uint64_t)(-(long)linux_errno_from_rdnx((int)r));
 }
 
+/*
+ * Linux numbers NPROC/NOFILE/MEMLOCK/AS as 6/7/8/9; native numbering is
+ * FreeBSD's. Resources with no native counterpart (LOCKS..RTTIME) read back
+ * as unlimited and ignore updates. Returns -1 for out-of-range numbers.
+ */
+static int linux_rlimit_resource(uint64_t lres)
+{
+    static const int8_t map[16] = {
+        TASK_RLIMIT_CPU, TASK_RLIMIT_FSIZE, TASK_RLIMIT_DATA, TASK_RLIMIT_STACK,
+        TASK_RLIMIT_CORE, TASK_RLIMIT_RSS, TASK_RLIMIT_NPROC, TASK_RLIMIT_NOFILE,
+        TASK_RLIMIT_MEMLOCK, TASK_RLIMIT_AS, TASK_RLIMIT_COUNT, TASK_RLIMIT_COUNT,
+        TASK_RLIMIT_COUNT, TASK_RLIMIT_COUNT, TASK_RLIMIT_COUNT, TASK_RLIMIT_COUNT
+    };
+    return (lres < 16u) ? map[lres] : -1;
+}
+
+static uint64_t linux_rlim_out(uint64_t v)
+{
+    return (v == TASK_RLIM_INFINITY) ? ~0ULL : v;
+}
+
+static uint64_t linux_rlim_in(uint64_t v)
+{
+    return (v >= TASK_RLIM_INFINITY) ? TASK_RLIM_INFINITY : v;
+}
+
+static uint64_t linux_prlimit(uint64_t lres, const linux_rlimit_u_t* new_lim, linux_rlimit_u_t* old_lim)
+{
+    task_t* t = task_get_current();
+    int res = linux_rlimit_resource(lres);
+    if (!t || res < 0) {
+        return (uint64_t)(-LINUX_EINVAL);
+    }
+    if ((new_lim && !unix_user_range_ok(new_lim, sizeof(*new_lim))) ||
+        (old_lim && !unix_user_range_ok(old_lim, sizeof(*old_lim)))) {
+        return (uint64_t)(-LINUX_EFAULT);
+    }
+    task_rlimit_t cur = { TASK_RLIM_INFINITY, TASK_RLIM_INFINITY };
+    if (res < TASK_RLIMIT_COUNT) {
+        (void)rusage_getrlimit(t, res, &cur);
+    }
+    if (new_lim && res < TASK_RLIMIT_COUNT) {
+        task_rlimit_t want;
+        want.cur = linux_rlim_in(new_lim->rlim_cur);
+        want.max = linux_rlim_in(new_lim->rlim_max);
+        int rc = rusage_setrlimit(t, res, &want);
+        if (rc != RDNX_OK) {
+            return linux_ret((uint64_t)(int64_t)rc);
+        }
+    }
+    if (old_lim) {
+        old_lim->rlim_cur = linux_rlim_out(cur.cur);
+        old_lim->rlim_max = linux_rlim_out(cur.max);
+    }
+    return 0;
+}
+
 static int linux_to_rdnx_open_flags(int linux_flags)
 {
     int out = 0;
@@ -368,6 +432,9 @@ static int linux_to_rdnx_open_flags(int linux_flags)
     if (linux_flags & LINUX_O_TRUNC) {
         out |= VFS_OPEN_TRUNC;
     }
+    if (linux_flags & LINUX_O_DIRECT) {
+        out |= VFS_OPEN_DIRECT;
+    }
     return out;
 }
 
@@ -823,11 +890,19 @@ uint64_t linux_compat_dispatch(uint64_t num,
         }
         return (uint64_t)(-LINUX_ENOSYS);
     }
+    case 144: /* sched_setscheduler */
+        return linux_ret(posix_sched_setscheduler(a1, a2, a3, 0, 0, 0));
+    case 145: /* sched_getscheduler */
+        return linux_ret(posix_sched_getscheduler(a1, 0, 0, 0, 0, 0));
+    case 314: /* sched_setattr */
+        return linux_ret(posix_sched_setattr(a1, a2, a3, 0, 0, 0));
+    case 315: /* sched_getattr */
+        return linux_ret(posix_sched_getattr(a1, a2, a3, a4, 0, 0));
     case 186: /* gettid */
-        return linux_ret(posix_getpid(0, 0, 0, 0, 0, 0));
+        return linux_ret(posix_gettid(0, 0, 0, 0, 0, 0));
     case 218: /* set_tid_address */
         /* Minimal compatibility: accept pointer and return caller tid. */
-        return linux_ret(posix_getpid(0, 0, 0, 0, 0, 0));
+        return linux_ret(posix_gettid(0, 0, 0, 0, 0, 0));
     case 228: /* clock_gettime */
         return linux_ret(posix_clock_gettime(a1, a2, 0, 0, 0, 0));
     case 231: /* exit_group */
@@ -926,8 +1001,32 @@ uint64_t linux_compat_dispatch(uint64_t num,
         return total;
     }
     case 74: /* fsync */
+        return linux_ret(posix_fsync(a1, 0, 0, 0, 0, 0));
     case 75: /* fdatasync */
+        return linux_ret(posix_fdatasync(a1, 0, 0, 0, 0, 0));
+    case 162: /* sync */
+        (void)posix_sync(0, 0, 0, 0, 0, 0);
         return 0;
+    case 285: /* fallocate */
+        return linux_ret(posix_fallocate(a1, a2, a3, a4, 0, 0));
+    case 97: /* getrlimit */
+        return linux_prlimit(a1, NULL, (linux_rlimit_u_t*)(uintptr_t)a2);
+    case 160: /* setrlimit */
+        if (!a2) {
+            return (uint64_t)(-LINUX_EFAULT);
+        }
+        return linux_prlimit(a1, (const linux_rlimit_u_t*)(uintptr_t)a2, NULL);
+    case 302: { /* prlimit64 (calling process only) */
+        task_t* t = task_get_current();
+        if (a1 != 0 && (!t || a1 != t->task_id)) {
+            return (uint64_t)(-LINUX_ESRCH);
+        }
+        return linux_prlimit(a2,
+                             (const linux_rlimit_u_t*)(uintptr_t)a3,
+                             (linux_rlimit_u_t*)(uintptr_t)a4);
+    }
+    case 98: /* getrusage: struct rusage and RUSAGE_* match the native ABI */
+        return linux_ret(posix_getrusage(a1, a2, 0, 0, 0, 0));
     case 78: { /* getdents (legacy linux_dirent) */
         task_t* t = task_get_current();
         int fd = (int)a1;
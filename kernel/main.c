@@ -21,6 +21,13 @@
 #include "common/bootlog.h"
 #include "common/startup_trace.h"
 #include "common/idl_demo.h"
+#include "common/locktest.h"
+#include "common/rcu.h"
+#include "common/random.h"
+#include "common/preempt.h"
+#include "common/lattrace.h"
+#include "common/gcov.h"
+#include "vm/vm_reclaim.h"
 #include "core/boot.h"
 #include "arch/config.h"
 #include "arch/acpi.h"
@@ -310,12 +317,19 @@ static int sysinit_fabric(void)
     extern void ps2_bus_init(void);
     extern void hid_kbd_init(void);
     extern void virtio_net_stub_init(void);
+    extern void virtio_console_init(void);
+    extern void virtio_rng_init(void);
     extern void e1000_net_stub_init(void);
     extern void vga_display_stub_init(void);
     extern void ide_storage_stub_init(void);
+    extern void nvme_storage_init(void);
+    extern void ahci_storage_init(void);
     extern int fabric_block_service_init(void);
     extern void fabric_platform_services_init(void);
 
+    /* Before the drivers: virtio-rng seeds the pool during attach. */
+    random_init();
+    kputs("[INIT-9.0] Entropy pool initialized\n");
     fabric_init();
     kputs("[INIT-9.1] Fabric initialized\n");
     virt_bus_init();
@@ -327,7 +341,11 @@ static int sysinit_fabric(void)
     hid_kbd_init();
     kputs("[INIT-9.5] HID keyboard driver initialized\n");
     virtio_net_stub_init();
-    kputs("[INIT-9.5a] Virtio-net stub driver initialized\n");
+    kputs("[INIT-9.5a] Virtio-net driver initialized\n");
+    virtio_console_init();
+    kputs("[INIT-9.5a] Virtio-console driver initialized\n");
+    virtio_rng_init();
+    kputs("[INIT-9.5a] Virtio-rng driver initialized\n");
     e1000_net_stub_init();
     kputs("[INIT-9.5b] e1000-net stub driver initialized\n");
     vga_display_stub_init();
@@ -341,6 +359,10 @@ static int sysinit_fabric(void)
 
     ide_storage_stub_init();
     kputs("[INIT-9.5e] IDE storage stub driver initialized\n");
+    nvme_storage_init();
+    kputs("[INIT-9.5e] NVMe storage driver initialized\n");
+    ahci_storage_init();
+    kputs("[INIT-9.5e] AHCI storage driver initialized\n");
     fabric_platform_services_init();
     kputs("[INIT-9.5f] Platform services initialized\n");
     kputs("[INIT-9-OK] Fabric initialization complete\n");
@@ -392,6 +414,7 @@ void kmain(uint32_t magic, void* mbi)
     console_set_vga_buffer((void*)0xB8000);
     console_init();
     console_set_log_prefix_enabled(false);
+    gcov_init();
     
     /* Print welcome message */
     kputs("========================================\n");
@@ -571,11 +594,21 @@ void kmain(uint32_t magic, void* mbi)
     __asm__ volatile ("" ::: "memory");
     
     bool force_kernel_shell = false;
+    bool run_locktest = false;
     boot_info_t* boot_cfg = boot_get_info();
     if (boot_cfg) {
         force_kernel_shell =
             bootarg_has_token(boot_cfg->cmdline, "rdnx.shell=1") ||
             bootarg_has_token(boot_cfg->cmdline, "shell=1");
+        run_locktest = bootarg_has_token(boot_cfg->cmdline, "locktest=1");
+        if (bootarg_has_token(boot_cfg->cmdline, "preempt=voluntary")) {
+            preempt_set_mode(PREEMPT_MODE_VOLUNTARY);
+            kputs("[INIT-10.8] Preemption: voluntary\n");
+        }
+        if (bootarg_has_token(boot_cfg->cmdline, "lattrace=1")) {
+            lattrace_start();
+            kputs("[INIT-10.8] Latency tracer on\n");
+        }
     }
     bootarg_pick_init_path(g_user_init_path, sizeof(g_user_init_path));
 
@@ -628,6 +661,17 @@ void kmain(uint32_t magic, void* mbi)
         idle->priority = PRIORITY_MIN;
     }
     bootstrap_start();
+    vm_reclaim_start();
+    rcu_start();
+    extern void ahci_storage_start(void);
+    ahci_storage_start();
+    extern void virtio_console_start(void);
+    virtio_console_start();
+    extern void fabric_netif_napi_start(void);
+    fabric_netif_napi_start();
+    if (run_locktest) {
+        locktest_start();
+    }
     /* Keep IDL demo disabled in baseline boot path; it perturbs contract CI. */
     /* idl_demo_start(); */
     if (!primary || !idle) {
@@ -1,8 +1,15 @@
 #include "bsd_ifnet.h"
 #include "../fabric/spin.h"
+#include "../common/rcu.h"
 #include "../../include/common.h"
 #include <stddef.h>
 
+/*
+ * Interfaces are attached once and never detached: g_ifnet_lock only
+ * serializes attach, and lookups read g_ifnets[] lock-free. A slot is
+ * published before the count that covers it, so a reader that sees the
+ * count also sees the pointer.
+ */
 static bsd_ifnet_t* g_ifnets[BSD_IFNET_MAX];
 static uint32_t g_ifnet_count = 0;
 static spinlock_t g_ifnet_lock;
@@ -39,7 +46,8 @@ int bsd_ifnet_attach(bsd_ifnet_t* ifp)
     }
 
     ifp->if_index = g_ifnet_count + 1u;
-    g_ifnets[g_ifnet_count++] = ifp;
+    rcu_assign_pointer(g_ifnets[g_ifnet_count], ifp);
+    __atomic_store_n(&g_ifnet_count, g_ifnet_count + 1u, __ATOMIC_RELEASE);
 
     spinlock_unlock(&g_ifnet_lock);
     return 0;
@@ -51,13 +59,9 @@ bsd_ifnet_t* bsd_ifnet_byindex(uint32_t ifindex)
     if (ifindex == 0) {
         return NULL;
     }
-    bsd_ifnet_init_once();
-
-    spinlock_lock(&g_ifnet_lock);
-    if (ifindex <= g_ifnet_count) {
-        out = g_ifnets[ifindex - 1u];
+    if (ifindex <= __atomic_load_n(&g_ifnet_count, __ATOMIC_ACQUIRE)) {
+        out = rcu_dereference(g_ifnets[ifindex - 1u]);
     }
-    spinlock_unlock(&g_ifnet_lock);
     return out;
 }
 
@@ -68,16 +72,14 @@ bsd_ifnet_t* bsd_ifnet_byname(const char* ifname)
     }
 
     bsd_ifnet_t* out = NULL;
-    bsd_ifnet_init_once();
-
-    spinlock_lock(&g_ifnet_lock);
-    for (uint32_t i = 0; i < g_ifnet_count; i++) {
-        if (strncmp(g_ifnets[i]->if_xname, ifname, BSD_IFNAMSIZ) == 0) {
-            out = g_ifnets[i];
+    uint32_t count = __atomic_load_n(&g_ifnet_count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < count; i++) {
+        bsd_ifnet_t* ifp = rcu_dereference(g_ifnets[i]);
+        if (strncmp(ifp->if_xname, ifname, BSD_IFNAMSIZ) == 0) {
+            out = ifp;
             break;
         }
     }
-    spinlock_unlock(&g_ifnet_lock);
 
     return out;
 }
@@ -89,27 +89,15 @@ static uint16_t cksum_finalize(uint32_t sum)
     return (uint16_t)(~sum & 0xFFFFu);
 }
 
-uint16_t bsd_in_pseudo(uint32_t src_host, uint32_t dst_host, uint16_t proto_len_host)
+uint16_t bsd_in_pseudo(uint32_t src_host, uint32_t dst_host, uint8_t proto, uint16_t l4_len)
 {
-    uint8_t ph[12];
-    uint32_t src_be = bsd_htonl(src_host);
-    uint32_t dst_be = bsd_htonl(dst_host);
-    uint16_t len_be = bsd_htons(proto_len_host);
-
-    ph[0] = (uint8_t)((src_be >> 24) & 0xFFu);
-    ph[1] = (uint8_t)((src_be >> 16) & 0xFFu);
-    ph[2] = (uint8_t)((src_be >> 8) & 0xFFu);
-    ph[3] = (uint8_t)(src_be & 0xFFu);
-    ph[4] = (uint8_t)((dst_be >> 24) & 0xFFu);
-    ph[5] = (uint8_t)((dst_be >> 16) & 0xFFu);
-    ph[6] = (uint8_t)((dst_be >> 8) & 0xFFu);
-    ph[7] = (uint8_t)(dst_be & 0xFFu);
-    ph[8] = 0;
-    ph[9] = (uint8_t)BSD_IPPROTO_UDP;
-    ph[10] = (uint8_t)((len_be >> 8) & 0xFFu);
-    ph[11] = (uint8_t)(len_be & 0xFFu);
-
-    return (uint16_t)(~cksum_add_buf(0, ph, sizeof(ph)) & 0xFFFFu);
+    uint32_t sum = (src_host >> 16) + (src_host & 0xFFFFu) +
+                   (dst_host >> 16) + (dst_host & 0xFFFFu) +
+                   (uint32_t)proto + (uint32_t)l4_len;
+    while (sum >> 16) {
+        sum = (sum & 0xFFFFu) + (sum >> 16);
+    }
+    return (uint16_t)sum;
 }
 
 uint16_t bsd_udp4_checksum(uint32_t src_host,
@@ -10,6 +10,7 @@
  */
 
 #define BSD_IPPROTO_ICMP 1u
+#define BSD_IPPROTO_TCP 6u
 #define BSD_IPPROTO_UDP 17u
 #define BSD_IPVERSION   4u
 #define BSD_IP_DF       0x4000u
@@ -51,9 +52,18 @@ uint16_t bsd_ntohs(uint16_t v);
 uint32_t bsd_htonl(uint32_t v);
 uint32_t bsd_ntohl(uint32_t v);
 
+/*
+ * Checksums are returned in host order: store them with bsd_htons() and
+ * compare received fields after bsd_ntohs().
+ */
 uint16_t bsd_in_cksum(const void* data, size_t len);
 uint16_t bsd_icmp_checksum(const void* data, size_t len);
-uint16_t bsd_in_pseudo(uint32_t src_host, uint32_t dst_host, uint16_t proto_len_host);
+/*
+ * Folded, not complemented, IPv4 pseudo-header sum. This is the seed a NIC
+ * expects in the TCP/UDP checksum field when it completes the checksum;
+ * l4_len is 0 for TCP segmentation offload, where every segment differs.
+ */
+uint16_t bsd_in_pseudo(uint32_t src_host, uint32_t dst_host, uint8_t proto, uint16_t l4_len);
 uint16_t bsd_udp4_checksum(uint32_t src_host, uint32_t dst_host, const bsd_udphdr_t* uh, const void* payload, size_t payload_len);
 
 #endif /* _RODNIX_BSD_INET_H */
@@ -1,14 +1,110 @@
 #include "bsd_mbuf.h"
 #include "../common/heap.h"
+#include "../core/config.h"
+#include "../fabric/spin.h"
+#include "../arch/config.h"
+#include "../arch/pmm.h"
 #include "../../include/common.h"
 
+#define BSD_MBUF_POOL_STRIDE ((sizeof(bsd_mbuf_t) + 63u) & ~(size_t)63u)
+
+/* Zero-initialized: usable from the first allocation, IRQ-safe. */
+static spinlock_t g_pool_lock;
+static bsd_mbuf_t* g_pool_free = NULL;
+static uint32_t g_pool_total = 0;
+static uint32_t g_pool_nfree = 0;
+
+/* Add one BSD_MBUF_POOL_CHUNK of mbufs from contiguous physical pages. */
+static int bsd_m_pool_grow(void)
+{
+    const uint32_t pages = (uint32_t)((BSD_MBUF_POOL_CHUNK * BSD_MBUF_POOL_STRIDE + PAGE_SIZE - 1u) / PAGE_SIZE);
+
+    irql_t irql = spinlock_lock_irqsave(&g_pool_lock);
+    if (g_pool_total + BSD_MBUF_POOL_CHUNK > BSD_MBUF_POOL_MAX) {
+        spinlock_unlock_irqrestore(&g_pool_lock, irql);
+        return -1;
+    }
+    g_pool_total += BSD_MBUF_POOL_CHUNK;
+    spinlock_unlock_irqrestore(&g_pool_lock, irql);
+
+    uint64_t phys = pmm_alloc_pages(pages);
+    if (!phys) {
+        irql = spinlock_lock_irqsave(&g_pool_lock);
+        g_pool_total -= BSD_MBUF_POOL_CHUNK;
+        spinlock_unlock_irqrestore(&g_pool_lock, irql);
+        return -1;
+    }
+
+    uint8_t* base = (uint8_t*)ARCH_PHYS_TO_VIRT(phys);
+    bsd_mbuf_t* head = NULL;
+    bsd_mbuf_t* last = NULL;
+    for (uint32_t i = BSD_MBUF_POOL_CHUNK; i > 0; i--) {
+        bsd_mbuf_t* m = (bsd_mbuf_t*)(base + (size_t)(i - 1u) * BSD_MBUF_POOL_STRIDE);
+        m->m_flags = BSD_M_DMA;
+        m->m_next = head;
+        head = m;
+        if (!last) {
+            last = m;
+        }
+    }
+
+    irql = spinlock_lock_irqsave(&g_pool_lock);
+    last->m_next = g_pool_free;
+    g_pool_free = head;
+    g_pool_nfree += BSD_MBUF_POOL_CHUNK;
+    spinlock_unlock_irqrestore(&g_pool_lock, irql);
+    return 0;
+}
+
+static bsd_mbuf_t* bsd_m_pool_take(void)
+{
+    for (;;) {
+        irql_t irql = spinlock_lock_irqsave(&g_pool_lock);
+        bsd_mbuf_t* m = g_pool_free;
+        if (m) {
+            g_pool_free = m->m_next;
+            g_pool_nfree--;
+        }
+        spinlock_unlock_irqrestore(&g_pool_lock, irql);
+        if (m || bsd_m_pool_grow() != 0) {
+            return m;
+        }
+    }
+}
+
+uint32_t bsd_m_pool_reserve(uint32_t count)
+{
+    for (;;) {
+        irql_t irql = spinlock_lock_irqsave(&g_pool_lock);
+        uint32_t nfree = g_pool_nfree;
+        spinlock_unlock_irqrestore(&g_pool_lock, irql);
+        if (nfree >= count || bsd_m_pool_grow() != 0) {
+            return nfree;
+        }
+    }
+}
+
+uint64_t bsd_m_dma_addr(const bsd_mbuf_t* m)
+{
+    if (!m || (m->m_flags & BSD_M_DMA) == 0) {
+        return 0;
+    }
+    return (uint64_t)ARCH_VIRT_TO_PHYS(m->m_dat);
+}
+
 static bsd_mbuf_t* bsd_m_alloc(short type, uint16_t flags)
 {
-    bsd_mbuf_t* m = (bsd_mbuf_t*)kmalloc(sizeof(bsd_mbuf_t));
-    if (!m) {
-        return NULL;
+    bsd_mbuf_t* m = bsd_m_pool_take();
+    if (m) {
+        flags |= BSD_M_DMA;
+    } else {
+        m = (bsd_mbuf_t*)kmalloc(sizeof(bsd_mbuf_t));
+        if (!m) {
+            return NULL;
+        }
     }
-    memset(m, 0, sizeof(*m));
+    /* The payload area is overwritten by whoever fills the mbuf. */
+    memset(m, 0, offsetof(bsd_mbuf_t, m_dat));
     m->m_type = (uint8_t)type;
     m->m_flags = flags;
     m->m_data = m->m_dat;
@@ -33,6 +129,14 @@ bsd_mbuf_t* bsd_m_free(bsd_mbuf_t* m)
         return NULL;
     }
     bsd_mbuf_t* next = m->m_next;
+    if ((m->m_flags & BSD_M_DMA) != 0) {
+        irql_t irql = spinlock_lock_irqsave(&g_pool_lock);
+        m->m_next = g_pool_free;
+        g_pool_free = m;
+        g_pool_nfree++;
+        spinlock_unlock_irqrestore(&g_pool_lock, irql);
+        return next;
+    }
     kfree(m);
     return next;
 }
@@ -13,11 +13,40 @@
 #define BSD_MT_DATA 1
 
 #define BSD_M_PKTHDR 0x0001
+#define BSD_M_DMA    0x0100  /* from the DMA pool: bsd_m_dma_addr() is valid */
+
+/*
+ * m_pkthdr.csum_flags. Receive: set by a NIC that verified checksums; the
+ * stack skips its own check when *_CALC and *_VALID are both set and drops
+ * the packet when only *_CALC is. Transmit offload requests travel in
+ * fabric_netif_tx_req_t instead.
+ */
+#define BSD_CSUM_L3_CALC  0x0001u   /* IPv4 header checksum checked */
+#define BSD_CSUM_L3_VALID 0x0002u
+#define BSD_CSUM_L4_CALC  0x0004u   /* TCP/UDP checksum checked */
+#define BSD_CSUM_L4_VALID 0x0008u
+
+/*
+ * DMA pool: mbufs carved from physically contiguous pages, so drivers can
+ * point receive descriptors straight at m_dat. bsd_m_get*() take from the
+ * pool first and fall back to the heap once it reaches BSD_MBUF_POOL_MAX.
+ */
+#define BSD_MBUF_POOL_CHUNK 32u
+#define BSD_MBUF_POOL_MAX   8192u
+
+/* m_pkthdr.hashtype: what m_pkthdr.flowid was computed over. */
+#define BSD_M_HASHTYPE_NONE     0u
+#define BSD_M_HASHTYPE_IPV4     1u   /* Toeplitz over the address pair */
+#define BSD_M_HASHTYPE_TCP_IPV4 2u   /* Toeplitz over addresses and ports */
+#define BSD_M_HASHTYPE_UDP_IPV4 3u
+#define BSD_M_HASHTYPE_OPAQUE   4u   /* NIC hash of unknown kind */
 
 typedef struct bsd_pkthdr {
     void* rcvif;
     int len;
     uint32_t flowid;
+    uint32_t csum_flags;
+    uint16_t hashtype;
 } bsd_pkthdr_t;
 
 typedef struct bsd_mbuf {
@@ -38,6 +67,10 @@ bsd_mbuf_t* bsd_m_free(bsd_mbuf_t* m);
 void bsd_m_freem(bsd_mbuf_t* m);
 int bsd_m_append(bsd_mbuf_t* m, const void* data, size_t len);
 int bsd_m_copydata(const bsd_mbuf_t* m, size_t off, size_t len, void* out);
+/* Grow the DMA pool so that at least count mbufs are free; returns the free count. */
+uint32_t bsd_m_pool_reserve(uint32_t count);
+/* Bus address of m_dat, or 0 for a heap mbuf. */
+uint64_t bsd_m_dma_addr(const bsd_mbuf_t* m);
 
 /* Compatibility aliases retained for imported driver code. */
 typedef bsd_pkthdr_t pkthdr_t;
@@ -1,34 +1,54 @@
 #include "bsd_netisr.h"
+#include "bsd_rss.h"
+#include "../core/cpu.h"
 #include "../fabric/spin.h"
+#include "../../include/common.h"
 #include <stddef.h>
 
-typedef struct bsd_netisr_slot {
+typedef struct bsd_netisr_work {
     bsd_mbuf_t* q[BSD_NETISR_QDEPTH];
     uint32_t head;
     uint32_t tail;
     uint32_t count;
-    bsd_netisr_handler_t handler;
     spinlock_t lock;
-} bsd_netisr_slot_t;
+} bsd_netisr_work_t;
 
-static bsd_netisr_slot_t g_isr[BSD_NETISR_MAX];
+/* One workstream per CPU, with a queue per protocol. */
+typedef struct bsd_netisr_ws {
+    bsd_netisr_work_t work[BSD_NETISR_MAX];
+    bsd_netisr_stats_t stats;
+} bsd_netisr_ws_t;
+
+static bsd_netisr_handler_t g_handlers[BSD_NETISR_MAX];
+static spinlock_t g_handlers_lock;
+static bsd_netisr_ws_t g_ws[BSD_NETISR_MAXCPU];
 static int g_netisr_inited = 0;
 
+static uint32_t netisr_curcpu(void)
+{
+    return cpu_get_id() % BSD_NETISR_MAXCPU;
+}
+
 int bsd_netisr_init(void)
 {
     if (g_netisr_inited) {
         return 0;
     }
 
+    spinlock_init(&g_handlers_lock);
     for (uint32_t i = 0; i < BSD_NETISR_MAX; i++) {
-        g_isr[i].head = 0;
-        g_isr[i].tail = 0;
-        g_isr[i].count = 0;
-        g_isr[i].handler.nh_name = NULL;
-        g_isr[i].handler.nh_handler = NULL;
-        g_isr[i].handler.nh_proto = i;
-        g_isr[i].handler.nh_qlimit = BSD_NETISR_QDEPTH;
-        spinlock_init(&g_isr[i].lock);
+        memset(&g_handlers[i], 0, sizeof(g_handlers[i]));
+        g_handlers[i].nh_proto = i;
+        g_handlers[i].nh_qlimit = BSD_NETISR_QDEPTH;
+    }
+    for (uint32_t c = 0; c < BSD_NETISR_MAXCPU; c++) {
+        memset(&g_ws[c].stats, 0, sizeof(g_ws[c].stats));
+        for (uint32_t i = 0; i < BSD_NETISR_MAX; i++) {
+            g_ws[c].work[i].head = 0;
+            g_ws[c].work[i].tail = 0;
+            g_ws[c].work[i].count = 0;
+            spinlock_init(&g_ws[c].work[i].lock);
+        }
     }
 
     g_netisr_inited = 1;
@@ -43,38 +63,49 @@ int bsd_netisr_register(const bsd_netisr_handler_t* nh)
 
     (void)bsd_netisr_init();
 
-    bsd_netisr_slot_t* slot = &g_isr[nh->nh_proto];
-    spinlock_lock(&slot->lock);
-    slot->handler = *nh;
-    if (slot->handler.nh_qlimit == 0 || slot->handler.nh_qlimit > BSD_NETISR_QDEPTH) {
-        slot->handler.nh_qlimit = BSD_NETISR_QDEPTH;
+    spinlock_lock(&g_handlers_lock);
+    bsd_netisr_handler_t* h = &g_handlers[nh->nh_proto];
+    *h = *nh;
+    if (h->nh_qlimit == 0 || h->nh_qlimit > BSD_NETISR_QDEPTH) {
+        h->nh_qlimit = BSD_NETISR_QDEPTH;
     }
-    spinlock_unlock(&slot->lock);
+    spinlock_unlock(&g_handlers_lock);
 
     return 0;
 }
 
-static int bsd_netisr_enqueue_locked(bsd_netisr_slot_t* slot, bsd_mbuf_t* m)
+static int bsd_netisr_get_handler(uint32_t proto, bsd_netisr_handler_t* out)
 {
-    if (slot->count >= slot->handler.nh_qlimit) {
-        return -1;
-    }
-
-    slot->q[slot->tail] = m;
-    slot->tail = (slot->tail + 1u) % BSD_NETISR_QDEPTH;
-    slot->count++;
-    return 0;
+    spinlock_lock(&g_handlers_lock);
+    *out = g_handlers[proto];
+    spinlock_unlock(&g_handlers_lock);
+    return out->nh_handler ? 0 : -1;
 }
 
-static bsd_mbuf_t* bsd_netisr_dequeue_locked(bsd_netisr_slot_t* slot)
+static int bsd_netisr_enqueue(bsd_netisr_work_t* w, uint32_t qlimit, bsd_mbuf_t* m)
 {
-    if (slot->count == 0) {
-        return NULL;
+    int rc = -1;
+    spinlock_lock(&w->lock);
+    if (w->count < qlimit) {
+        w->q[w->tail] = m;
+        w->tail = (w->tail + 1u) % BSD_NETISR_QDEPTH;
+        w->count++;
+        rc = 0;
     }
+    spinlock_unlock(&w->lock);
+    return rc;
+}
 
-    bsd_mbuf_t* item = slot->q[slot->head];
-    slot->head = (slot->head + 1u) % BSD_NETISR_QDEPTH;
-    slot->count--;
+static bsd_mbuf_t* bsd_netisr_dequeue(bsd_netisr_work_t* w)
+{
+    bsd_mbuf_t* item = NULL;
+    spinlock_lock(&w->lock);
+    if (w->count > 0) {
+        item = w->q[w->head];
+        w->head = (w->head + 1u) % BSD_NETISR_QDEPTH;
+        w->count--;
+    }
+    spinlock_unlock(&w->lock);
     return item;
 }
 
@@ -86,16 +117,31 @@ int bsd_netisr_queue(uint32_t proto, bsd_mbuf_t* m)
 
     (void)bsd_netisr_init();
 
-    bsd_netisr_slot_t* slot = &g_isr[proto];
-    int rc = -1;
-
-    spinlock_lock(&slot->lock);
-    if (slot->handler.nh_handler) {
-        rc = bsd_netisr_enqueue_locked(slot, m);
+    bsd_netisr_handler_t h;
+    if (bsd_netisr_get_handler(proto, &h) != 0) {
+        return -1;
+    }
+    bsd_netisr_ws_t* ws = &g_ws[netisr_curcpu()];
+    if (bsd_netisr_enqueue(&ws->work[proto], h.nh_qlimit, m) != 0) {
+        ws->stats.drops++;
+        return -1;
     }
-    spinlock_unlock(&slot->lock);
+    return 0;
+}
 
-    return rc;
+static uint32_t bsd_netisr_drain(bsd_netisr_ws_t* ws, uint32_t proto,
+                                 bsd_netisr_handler_fn_t handler, uint32_t budget)
+{
+    uint32_t n = 0;
+    while (budget == 0 || n < budget) {
+        bsd_mbuf_t* item = bsd_netisr_dequeue(&ws->work[proto]);
+        if (!item) {
+            break;
+        }
+        handler(item);
+        n++;
+    }
+    return n;
 }
 
 int bsd_netisr_dispatch(uint32_t proto, bsd_mbuf_t* m)
@@ -106,30 +152,72 @@ int bsd_netisr_dispatch(uint32_t proto, bsd_mbuf_t* m)
 
     (void)bsd_netisr_init();
 
-    bsd_netisr_slot_t* slot = &g_isr[proto];
-    bsd_netisr_handler_fn_t handler = NULL;
+    bsd_netisr_handler_t h;
+    if (bsd_netisr_get_handler(proto, &h) != 0) {
+        return -1;
+    }
 
-    spinlock_lock(&slot->lock);
-    if (!slot->handler.nh_handler || bsd_netisr_enqueue_locked(slot, m) != 0) {
-        spinlock_unlock(&slot->lock);
+    const uint32_t self = netisr_curcpu();
+    uint32_t cpu = self;
+    if (h.nh_policy == BSD_NETISR_POLICY_FLOW) {
+        if (m->m_pkthdr.hashtype == BSD_M_HASHTYPE_NONE && h.nh_m2flow) {
+            m = h.nh_m2flow(m);
+            if (!m) {
+                return 0;
+            }
+        }
+        if (m->m_pkthdr.hashtype != BSD_M_HASHTYPE_NONE) {
+            cpu = bsd_rss_hash2cpu(m->m_pkthdr.flowid) % BSD_NETISR_MAXCPU;
+        }
+    }
+
+    bsd_netisr_ws_t* ws = &g_ws[cpu];
+    if (bsd_netisr_enqueue(&ws->work[proto], h.nh_qlimit, m) != 0) {
+        ws->stats.drops++;
         return -1;
     }
-    handler = slot->handler.nh_handler;
-    spinlock_unlock(&slot->lock);
+    if (cpu != self) {
+        ws->stats.queued++;
+        return 0;
+    }
 
-    /* MVP: drain synchronously; queue semantics are kept for compatibility. */
-    for (;;) {
-        bsd_mbuf_t* item = NULL;
+    /* Direct dispatch: drain this CPU's queue, including anything handlers add. */
+    ws->stats.handled += bsd_netisr_drain(ws, proto, h.nh_handler, 0);
+    return 0;
+}
 
-        spinlock_lock(&slot->lock);
-        item = bsd_netisr_dequeue_locked(slot);
-        spinlock_unlock(&slot->lock);
+uint32_t bsd_netisr_poll(uint32_t budget)
+{
+    if (!g_netisr_inited) {
+        return 0;
+    }
 
-        if (!item) {
+    bsd_netisr_ws_t* ws = &g_ws[netisr_curcpu()];
+    uint32_t n = 0;
+    for (uint32_t proto = 0; proto < BSD_NETISR_MAX; proto++) {
+        if (budget != 0 && n >= budget) {
             break;
         }
-        handler(item);
+        if (__atomic_load_n(&ws->work[proto].count, __ATOMIC_RELAXED) == 0) {
+            continue;
+        }
+        bsd_netisr_handler_t h;
+        if (bsd_netisr_get_handler(proto, &h) != 0) {
+            continue;
+        }
+        n += bsd_netisr_drain(ws, proto, h.nh_handler, budget ? budget - n : 0);
     }
+    ws->stats.handled += n;
+    return n;
+}
 
-    return 0;
+void bsd_netisr_get_stats(uint32_t cpu, bsd_netisr_stats_t* out)
+{
+    if (!out) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (cpu < BSD_NETISR_MAXCPU) {
+        *out = g_ws[cpu].stats;
+    }
 }
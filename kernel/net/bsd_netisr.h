@@ -6,23 +6,55 @@
 
 #define BSD_NETISR_MAX 16
 #define BSD_NETISR_QDEPTH 64
+#define BSD_NETISR_MAXCPU 8u
 
 /* Keep protocol ids aligned with the imported compatibility subset. */
 #define BSD_NETISR_IP 1u
 
+/*
+ * Work placement. SOURCE runs packets on the CPU that received them.
+ * FLOW runs them on bsd_rss_hash2cpu(m_pkthdr.flowid); packets arriving
+ * without a hash get one from nh_m2flow first (software RPS).
+ */
+#define BSD_NETISR_POLICY_SOURCE 0u
+#define BSD_NETISR_POLICY_FLOW   1u
+
 typedef void (*bsd_netisr_handler_fn_t)(bsd_mbuf_t* m);
+/* Set flowid/hashtype; returns the mbuf, or NULL after freeing it. */
+typedef bsd_mbuf_t* (*bsd_netisr_m2flow_fn_t)(bsd_mbuf_t* m);
 
 typedef struct bsd_netisr_handler {
     const char* nh_name;
     bsd_netisr_handler_fn_t nh_handler;
     uint32_t nh_proto;
     uint32_t nh_qlimit;
+    uint32_t nh_policy;               /* BSD_NETISR_POLICY_* */
+    bsd_netisr_m2flow_fn_t nh_m2flow; /* optional */
 } bsd_netisr_handler_t;
 
+/* Per-CPU workstream counters, summed over protocols. */
+typedef struct bsd_netisr_stats {
+    uint64_t handled;    /* run on the dispatching CPU */
+    uint64_t queued;     /* steered to another CPU's workstream */
+    uint64_t drops;      /* workstream full */
+} bsd_netisr_stats_t;
+
 int bsd_netisr_init(void);
 int bsd_netisr_register(const bsd_netisr_handler_t* nh);
+/*
+ * Run the packet now when its policy places it on this CPU, otherwise
+ * queue it for the target CPU. Takes ownership of m either way except on
+ * failure (-1), where the caller still owns it.
+ */
 int bsd_netisr_dispatch(uint32_t proto, bsd_mbuf_t* m);
 int bsd_netisr_queue(uint32_t proto, bsd_mbuf_t* m);
+/*
+ * Run up to budget packets queued for the calling CPU (0 = no limit).
+ * There are no inter-processor wakeups: each CPU drains its workstreams
+ * from its receive paths. Returns the number of packets handled.
+ */
+uint32_t bsd_netisr_poll(uint32_t budget);
+void bsd_netisr_get_stats(uint32_t cpu, bsd_netisr_stats_t* out);
 
 /* Compatibility aliases retained for imported driver code. */
 typedef bsd_netisr_handler_t netisr_handler_t;
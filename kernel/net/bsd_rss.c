@@ -0,0 +1,144 @@
+#include "bsd_rss.h"
+#include "bsd_ether.h"
+#include "bsd_inet.h"
+#include "bsd_mbuf.h"
+#include "../core/cpu.h"
+#include "../../include/common.h"
+#include <stdbool.h>
+
+/* Default key of the Microsoft RSS specification, also FreeBSD's default. */
+static const uint8_t g_rss_key[BSD_RSS_KEYLEN] = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+    0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+    0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+    0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+    0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa
+};
+
+const uint8_t* bsd_rss_key(void)
+{
+    return g_rss_key;
+}
+
+/*
+ * For every set input bit, XOR in the 32-bit window of the key that starts
+ * at that bit position. Input longer than keylen - 4 bytes is not hashed.
+ */
+uint32_t bsd_toeplitz_hash(const uint8_t* key, size_t keylen, const void* data, size_t len)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    if (!key || keylen < 4u || !p) {
+        return 0;
+    }
+    if (len > keylen - 4u) {
+        len = keylen - 4u;
+    }
+
+    uint32_t hash = 0;
+    uint32_t window = ((uint32_t)key[0] << 24) | ((uint32_t)key[1] << 16) |
+                      ((uint32_t)key[2] << 8) | key[3];
+    for (size_t i = 0; i < len; i++) {
+        uint8_t next = (i + 4u < keylen) ? key[i + 4u] : 0;
+        for (int b = 7; b >= 0; b--) {
+            if (p[i] & (1u << b)) {
+                hash ^= window;
+            }
+            window = (window << 1) | ((next >> b) & 1u);
+        }
+    }
+    return hash;
+}
+
+uint32_t bsd_rss_hash_frame(const void* frame, size_t len, uint16_t* type)
+{
+    const uint8_t* f = (const uint8_t*)frame;
+    uint16_t t = BSD_M_HASHTYPE_NONE;
+    uint32_t hash = 0;
+
+    if (f && len >= sizeof(bsd_ether_header_t) + sizeof(bsd_ip_t)) {
+        const bsd_ether_header_t* eh = (const bsd_ether_header_t*)f;
+        const bsd_ip_t* ip = (const bsd_ip_t*)(f + sizeof(*eh));
+        const size_t ihl = (size_t)(ip->ip_vhl & 0x0Fu) * 4u;
+        if (bsd_ntohs(eh->ether_type) == BSD_ETHERTYPE_IP && (ip->ip_vhl >> 4) == BSD_IPVERSION &&
+            ihl >= sizeof(bsd_ip_t)) {
+            /* Addresses and ports are hashed in wire order. */
+            uint8_t in[12];
+            size_t n = 8;
+            memcpy(in, &ip->ip_src, 4);
+            memcpy(in + 4, &ip->ip_dst, 4);
+            t = BSD_M_HASHTYPE_IPV4;
+
+            const bool frag = (bsd_ntohs(ip->ip_off) & 0x3FFFu) != 0;
+            const size_t l4 = sizeof(*eh) + ihl;
+            if (!frag && len >= l4 + 4u &&
+                (ip->ip_p == BSD_IPPROTO_TCP || ip->ip_p == BSD_IPPROTO_UDP)) {
+                memcpy(in + 8, f + l4, 4);
+                n = 12;
+                t = (ip->ip_p == BSD_IPPROTO_TCP) ? BSD_M_HASHTYPE_TCP_IPV4 : BSD_M_HASHTYPE_UDP_IPV4;
+            }
+            hash = bsd_toeplitz_hash(g_rss_key, sizeof(g_rss_key), in, n);
+        }
+    }
+    if (type) {
+        *type = t;
+    }
+    return hash;
+}
+
+static uint32_t rss_ncpus(void)
+{
+    uint32_t n = cpu_get_count();
+    if (n == 0) {
+        return 1;
+    }
+    return (n > BSD_RSS_MAXCPU) ? BSD_RSS_MAXCPU : n;
+}
+
+uint32_t bsd_rss_getcpu(uint32_t bucket)
+{
+    return (bucket & (BSD_RSS_INDIR_SIZE - 1u)) % rss_ncpus();
+}
+
+uint32_t bsd_rss_getqueue(uint32_t bucket, uint32_t nqueues)
+{
+    return (nqueues > 1u) ? bsd_rss_getcpu(bucket) % nqueues : 0;
+}
+
+/* hash << 32 | (cpu + 1); 0 is an empty slot. */
+static uint64_t g_rss_flows[BSD_RSS_FLOW_TABLE];
+
+void bsd_rss_flow_record(uint32_t hash, uint32_t cpu)
+{
+    uint64_t* slot = &g_rss_flows[hash & (BSD_RSS_FLOW_TABLE - 1u)];
+    uint64_t v = ((uint64_t)hash << 32) | (uint64_t)(cpu + 1u);
+    if (__atomic_load_n(slot, __ATOMIC_RELAXED) != v) {
+        __atomic_store_n(slot, v, __ATOMIC_RELAXED);
+    }
+}
+
+uint32_t bsd_rss_hash2cpu(uint32_t hash)
+{
+    uint64_t v = __atomic_load_n(&g_rss_flows[hash & (BSD_RSS_FLOW_TABLE - 1u)], __ATOMIC_RELAXED);
+    if (v != 0 && (uint32_t)(v >> 32) == hash) {
+        uint32_t cpu = (uint32_t)v - 1u;
+        if (cpu < rss_ncpus()) {
+            return cpu;
+        }
+    }
+    return bsd_rss_getcpu(bsd_rss_getbucket(hash));
+}
+
+int bsd_rss_selftest(void)
+{
+    /* 66.9.149.187:2794 -> 161.142.100.80:1766 */
+    static const uint8_t in[12] = {
+        66, 9, 149, 187, 161, 142, 100, 80, 0x0a, 0xea, 0x06, 0xe6
+    };
+    if (bsd_toeplitz_hash(g_rss_key, sizeof(g_rss_key), in, 8) != 0x323e8fc2u) {
+        return -1;
+    }
+    if (bsd_toeplitz_hash(g_rss_key, sizeof(g_rss_key), in, 12) != 0x51ccc178u) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef _RODNIX_BSD_RSS_H
+#define _RODNIX_BSD_RSS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Receive-side scaling hash (Toeplitz). One system key is shared by NICs
+ * that hash in hardware and by software RPS, so both place a flow on the
+ * same CPU. Input order follows the Microsoft RSS specification: source
+ * address, destination address, then source and destination port.
+ */
+
+#define BSD_RSS_KEYLEN     40u
+#define BSD_RSS_INDIR_SIZE 128u   /* buckets; also the NIC indirection table length */
+#define BSD_RSS_MAXCPU     8u
+#define BSD_RSS_FLOW_TABLE 256u   /* RFS entries, power of two */
+
+const uint8_t* bsd_rss_key(void);
+uint32_t bsd_toeplitz_hash(const uint8_t* key, size_t keylen, const void* data, size_t len);
+/*
+ * Hash of an Ethernet frame: 4-tuple for unfragmented TCP/UDP over IPv4,
+ * address pair for other IPv4. Stores a BSD_M_HASHTYPE_* in *type and
+ * returns 0 with BSD_M_HASHTYPE_NONE for anything else.
+ */
+uint32_t bsd_rss_hash_frame(const void* frame, size_t len, uint16_t* type);
+
+/*
+ * CPU steering. The low hash bits pick one of BSD_RSS_INDIR_SIZE buckets;
+ * buckets are spread round-robin over the online CPUs. A NIC with fewer
+ * queues than CPUs sends a bucket to queue bsd_rss_getqueue() and software
+ * moves the packet on from there.
+ */
+static inline uint32_t bsd_rss_getbucket(uint32_t hash)
+{
+    return hash & (BSD_RSS_INDIR_SIZE - 1u);
+}
+uint32_t bsd_rss_getcpu(uint32_t bucket);
+uint32_t bsd_rss_getqueue(uint32_t bucket, uint32_t nqueues);
+/*
+ * Receive flow steering: remember that the reader of flow hash last ran on
+ * cpu, so later packets of the flow are processed there. Entries are
+ * overwritten on collision; a stale entry only costs locality.
+ */
+void bsd_rss_flow_record(uint32_t hash, uint32_t cpu);
+/* CPU for a packet with this hash: the flow's reader CPU when known, else its bucket's. */
+uint32_t bsd_rss_hash2cpu(uint32_t hash);
+
+/* Check the Toeplitz code against the specification's IPv4 vectors; 0 on success. */
+int bsd_rss_selftest(void);
+
+#endif /* _RODNIX_BSD_RSS_H */
@@ -1,5 +1,6 @@
 #include "net.h"
 #include "socket.h"
+#include "bsd_rss.h"
 #include "../fabric/service/net_service.h"
 #include "../fabric/spin.h"
 #include "../common/heap.h"
@@ -145,6 +146,9 @@ int net_init(void)
         }
     }
     net_register_loopback_iface_once();
+    if (bsd_rss_selftest() != 0) {
+        kputs("[NET] RSS Toeplitz self-test failed\n");
+    }
     kputs("[NET] Loopback ready\n");
     return 0;
 }
@@ -4,19 +4,28 @@
 #include "bsd_ifnet.h"
 #include "bsd_mbuf.h"
 #include "bsd_netisr.h"
+#include "bsd_rss.h"
+#include "../core/cpu.h"
 #include "../fabric/service/net_service.h"
 #include "../fabric/spin.h"
 #include "../common/heap.h"
 #include "../common/scheduler.h"
+#include "../common/random.h"
 #include "../../include/common.h"
+#include "../../include/console.h"
 #include "../../include/error.h"
 
 #define NET_MAX_SOCKETS 1024
+/* Ephemeral ports: bind(port 0) and the implicit bind of an unbound sendto(). */
+#define NET_EPHEMERAL_FIRST 512u
 #define NET_PING_ID 0x524Eu
 
 typedef struct udp_msg {
     size_t frame_len;
     uint8_t* frame;
+    uint32_t csum_flags;         /* m_pkthdr.csum_flags of the received frame */
+    uint32_t flowid;             /* m_pkthdr.flowid, valid unless hashtype is NONE */
+    uint16_t hashtype;
     struct udp_msg* next;
 } udp_msg_t;
 
@@ -35,6 +44,7 @@ typedef struct net_socket {
     int bound;
     uint16_t connected_port;
     int connected;
+    uint32_t busy_poll_us;       /* SO_BUSY_POLL */
     udp_queue_t queue;
 } net_socket_t;
 
@@ -60,17 +70,31 @@ static bsd_ifnet_t g_lo_ifp;
 static ping_state_t g_ping;
 
 static void netisr_ip_handler(bsd_mbuf_t* m);
+static bsd_mbuf_t* netisr_ip_m2flow(bsd_mbuf_t* m);
 
+/* IP work follows the flow hash: RSS from the NIC, RPS in software otherwise. */
 static const bsd_netisr_handler_t g_ip_netisr_handler = {
     .nh_name = "ip",
     .nh_handler = netisr_ip_handler,
     .nh_proto = BSD_NETISR_IP,
     .nh_qlimit = BSD_NETISR_QDEPTH,
+    .nh_policy = BSD_NETISR_POLICY_FLOW,
+    .nh_m2flow = netisr_ip_m2flow,
 };
 
-static int udp_queue_push_frame(udp_queue_t* q, const void* frame, size_t frame_len);
+static int udp_queue_push_frame(udp_queue_t* q, const void* frame, size_t frame_len, const bsd_pkthdr_t* ph);
 static int net_ensure_dispatch_path(void);
 
+/*
+ * Receive work for a waiting reader: poll the NICs, then run packets that
+ * RPS/RFS steered to this CPU.
+ */
+static void net_rx_poll(void)
+{
+    fabric_netif_poll_all();
+    (void)bsd_netisr_poll(BSD_NETISR_QDEPTH);
+}
+
 static uint64_t ticks_to_ms(uint64_t ticks)
 {
     return ticks * (uint64_t)SCHEDULER_TIME_SLICE_MS;
@@ -171,13 +195,57 @@ static int net_resolve_arp(fabric_netif_t* iface, uint32_t target_ip, uint8_t ma
         if (bsd_arp_lookup(target_ip, mac_out) == 0) {
             return 0;
         }
-        fabric_netif_poll_all();
+        net_rx_poll();
         scheduler_yield();
     }
 
     return -1;
 }
 
+/*
+ * Send a finished IPv4 frame. The IPv4 header checksum and a UDP checksum
+ * are filled in here: by the interface when it offloads them (the UDP field
+ * is seeded with the pseudo-header sum), otherwise in software. Other
+ * protocols carry their own checksum already.
+ */
+static int net_ip_output(fabric_netif_t* iface, uint8_t* frame, size_t frame_len)
+{
+    const size_t eth_len = sizeof(bsd_ether_header_t);
+    bsd_ip_t* ip = (bsd_ip_t*)(frame + eth_len);
+    const size_t ihl = (size_t)(ip->ip_vhl & 0x0Fu) * 4u;
+
+    fabric_netif_tx_req_t req;
+    memset(&req, 0, sizeof(req));
+    req.frame = frame;
+    req.len = (uint32_t)frame_len;
+    req.l3_off = (uint16_t)eth_len;
+    req.l4_off = (uint16_t)(eth_len + ihl);
+
+    ip->ip_sum = 0;
+    if (iface->caps & FABRIC_NETIF_CAP_TXCSUM_IP4) {
+        req.flags |= FABRIC_NETIF_TX_CSUM_IP4;
+    } else {
+        ip->ip_sum = bsd_htons(bsd_in_cksum(ip, ihl));
+    }
+
+    if (ip->ip_p == BSD_IPPROTO_UDP) {
+        bsd_udphdr_t* uh = (bsd_udphdr_t*)(frame + req.l4_off);
+        const uint16_t udp_len = bsd_ntohs(uh->uh_ulen);
+        const uint32_t src_host = bsd_ntohl(ip->ip_src);
+        const uint32_t dst_host = bsd_ntohl(ip->ip_dst);
+        if (iface->caps & FABRIC_NETIF_CAP_TXCSUM_L4) {
+            uh->uh_sum = bsd_htons(bsd_in_pseudo(src_host, dst_host, BSD_IPPROTO_UDP, udp_len));
+            req.flags |= FABRIC_NETIF_TX_CSUM_UDP;
+        } else {
+            uh->uh_sum = 0;
+            uh->uh_sum = bsd_htons(bsd_udp4_checksum(src_host, dst_host, uh, (const void*)(uh + 1),
+                                                     (size_t)udp_len - sizeof(*uh)));
+        }
+    }
+
+    return fabric_netif_tx_offload(iface, &req);
+}
+
 static int net_send_icmp_echo_reply(fabric_netif_t* iface,
                                     const bsd_ether_header_t* rx_eh,
                                     const bsd_ip_t* rx_ip,
@@ -213,8 +281,6 @@ static int net_send_icmp_echo_reply(fabric_netif_t* iface,
     ip->ip_p = BSD_IPPROTO_ICMP;
     ip->ip_src = rx_ip->ip_dst;
     ip->ip_dst = rx_ip->ip_src;
-    ip->ip_sum = 0;
-    ip->ip_sum = bsd_in_cksum(ip, sizeof(*ip));
 
     uint8_t* icmp = frame + eth_len + ip_len;
     memcpy(icmp, rx_icmp, icmp_len);
@@ -222,9 +288,9 @@ static int net_send_icmp_echo_reply(fabric_netif_t* iface,
     echo->type = BSD_ICMP_ECHOREPLY;
     echo->code = 0;
     echo->cksum = 0;
-    echo->cksum = bsd_icmp_checksum(icmp, icmp_len);
+    echo->cksum = bsd_htons(bsd_icmp_checksum(icmp, icmp_len));
 
-    int rc = fabric_netif_tx(iface, frame, (uint32_t)frame_len);
+    int rc = net_ip_output(iface, frame, frame_len);
     kfree(frame);
     return (rc == RDNX_OK) ? 0 : -1;
 }
@@ -350,11 +416,13 @@ static void netisr_ip_handler(bsd_mbuf_t* m)
         return;
     }
 
-    bsd_ip_t ip_hdr;
-    memcpy(&ip_hdr, ip, sizeof(ip_hdr));
-    const uint16_t ip_sum_wire = ip_hdr.ip_sum;
-    ip_hdr.ip_sum = 0;
-    if (bsd_in_cksum(&ip_hdr, sizeof(ip_hdr)) != ip_sum_wire) {
+    const uint32_t csum = m->m_pkthdr.csum_flags;
+    if ((csum & BSD_CSUM_L3_CALC) != 0) {
+        if ((csum & BSD_CSUM_L3_VALID) == 0) {
+            bsd_m_freem(m);
+            return;
+        }
+    } else if (bsd_in_cksum(ip, ihl) != 0) {
         bsd_m_freem(m);
         return;
     }
@@ -378,7 +446,7 @@ static void netisr_ip_handler(bsd_mbuf_t* m)
         spinlock_unlock(&udp_port_lock);
 
         if (dest) {
-            (void)udp_queue_push_frame(&dest->queue, frame, m->m_len);
+            (void)udp_queue_push_frame(&dest->queue, frame, m->m_len, &m->m_pkthdr);
         }
         bsd_m_freem(m);
         return;
@@ -428,6 +496,17 @@ static void netisr_ip_handler(bsd_mbuf_t* m)
     bsd_m_freem(m);
 }
 
+static bsd_mbuf_t* netisr_ip_m2flow(bsd_mbuf_t* m)
+{
+    uint16_t type = BSD_M_HASHTYPE_NONE;
+    uint32_t hash = bsd_rss_hash_frame(m->m_data, m->m_len, &type);
+    if (type != BSD_M_HASHTYPE_NONE) {
+        m->m_pkthdr.flowid = hash;
+        m->m_pkthdr.hashtype = type;
+    }
+    return m;
+}
+
 static int net_ensure_dispatch_path(void)
 {
     net_link_init_once();
@@ -444,12 +523,21 @@ static int net_ensure_dispatch_path(void)
     return 0;
 }
 
-int net_ingress_frame(const void* frame, uint32_t len, void* ifp_hint)
+int net_ingress_mbuf(bsd_mbuf_t* m)
 {
-    if (!frame || len == 0 || len > BSD_MBUF_DATA_MAX) {
+    if (!m) {
         return -1;
     }
-    if (net_ensure_dispatch_path() != 0) {
+    if (net_ensure_dispatch_path() != 0 || bsd_netisr_dispatch(BSD_NETISR_IP, m) != 0) {
+        bsd_m_freem(m);
+        return -1;
+    }
+    return 0;
+}
+
+int net_ingress_frame(const void* frame, uint32_t len, void* ifp_hint)
+{
+    if (!frame || len == 0 || len > BSD_MBUF_DATA_MAX) {
         return -1;
     }
 
@@ -462,11 +550,7 @@ int net_ingress_frame(const void* frame, uint32_t len, void* ifp_hint)
         bsd_m_freem(m);
         return -1;
     }
-    if (bsd_netisr_dispatch(BSD_NETISR_IP, m) != 0) {
-        bsd_m_freem(m);
-        return -1;
-    }
-    return 0;
+    return net_ingress_mbuf(m);
 }
 
 static void udp_queue_init(udp_queue_t* q)
@@ -477,7 +561,7 @@ static void udp_queue_init(udp_queue_t* q)
     spinlock_init(&q->lock);
 }
 
-static int udp_queue_push_frame(udp_queue_t* q, const void* frame, size_t frame_len)
+static int udp_queue_push_frame(udp_queue_t* q, const void* frame, size_t frame_len, const bsd_pkthdr_t* ph)
 {
     if (!q || !frame || frame_len == 0) {
         return -1;
@@ -494,6 +578,9 @@ static int udp_queue_push_frame(udp_queue_t* q, const void* frame, size_t frame_
     }
     memcpy(msg->frame, frame, frame_len);
     msg->frame_len = frame_len;
+    msg->csum_flags = ph->csum_flags;
+    msg->flowid = ph->flowid;
+    msg->hashtype = ph->hashtype;
     msg->next = NULL;
 
     spinlock_lock(&q->lock);
@@ -553,16 +640,6 @@ static int udp_queue_pop(udp_queue_t* q, void* buf, size_t len, sockaddr_in_t* s
         return -1;
     }
 
-    bsd_ip_t ip_hdr;
-    memcpy(&ip_hdr, ip, sizeof(ip_hdr));
-    const uint16_t ip_sum_wire = ip_hdr.ip_sum;
-    ip_hdr.ip_sum = 0;
-    if (bsd_in_cksum(&ip_hdr, sizeof(ip_hdr)) != ip_sum_wire) {
-        kfree(msg->frame);
-        kfree(msg);
-        return -1;
-    }
-
     const bsd_udphdr_t* uh = (const bsd_udphdr_t*)((const uint8_t*)ip + ihl);
     const uint16_t udp_len = bsd_ntohs(uh->uh_ulen);
     if (udp_len < sizeof(bsd_udphdr_t) || sizeof(bsd_ether_header_t) + ihl + udp_len > msg->frame_len) {
@@ -574,13 +651,14 @@ static int udp_queue_pop(udp_queue_t* q, void* buf, size_t len, sockaddr_in_t* s
     const uint8_t* payload = (const uint8_t*)(uh + 1);
     const size_t payload_len = (size_t)udp_len - sizeof(bsd_udphdr_t);
 
-    if (uh->uh_sum != 0) {
+    const uint32_t l4_ok = BSD_CSUM_L4_CALC | BSD_CSUM_L4_VALID;
+    if (uh->uh_sum != 0 && (msg->csum_flags & l4_ok) != l4_ok) {
         uint16_t udp_sum_calc = bsd_udp4_checksum(bsd_ntohl(ip->ip_src),
                                                   bsd_ntohl(ip->ip_dst),
                                                   uh,
                                                   payload,
                                                   payload_len);
-        if (udp_sum_calc != uh->uh_sum) {
+        if (udp_sum_calc != bsd_ntohs(uh->uh_sum)) {
             kfree(msg->frame);
             kfree(msg);
             return -1;
@@ -590,6 +668,11 @@ static int udp_queue_pop(udp_queue_t* q, void* buf, size_t len, sockaddr_in_t* s
     size_t to_copy = (payload_len < len) ? payload_len : len;
     memcpy(buf, payload, to_copy);
 
+    /* RFS: the flow's next packets are processed on the reader's CPU. */
+    if (msg->hashtype != BSD_M_HASHTYPE_NONE) {
+        bsd_rss_flow_record(msg->flowid, cpu_get_id());
+    }
+
     if (src) {
         src->sin_family = AF_INET;
         src->sin_port = bsd_ntohs(uh->uh_sport);
@@ -639,11 +722,30 @@ net_socket_t* net_socket_create(int domain, int type, int protocol)
     sock->bound = 0;
     sock->connected_port = 0;
     sock->connected = 0;
+    sock->busy_poll_us = 0;
     udp_queue_init(&sock->queue);
 
     return sock;
 }
 
+/*
+ * Random start, then the first free port (RFC 6056 algorithm 1): a peer
+ * cannot predict the port from the previous one. 0 when the range is full.
+ * Caller holds udp_port_lock.
+ */
+static uint16_t udp_pick_ephemeral_locked(void)
+{
+    const uint32_t span = NET_MAX_SOCKETS - NET_EPHEMERAL_FIRST;
+    uint32_t start = random_get_below(span);
+    for (uint32_t i = 0; i < span; i++) {
+        uint16_t port = (uint16_t)(NET_EPHEMERAL_FIRST + (start + i) % span);
+        if (!udp_port_table[port]) {
+            return port;
+        }
+    }
+    return 0;
+}
+
 int net_socket_bind(net_socket_t* sock, const sockaddr_in_t* addr)
 {
     if (!sock || !addr) {
@@ -654,12 +756,19 @@ int net_socket_bind(net_socket_t* sock, const sockaddr_in_t* addr)
     }
 
     uint16_t port = addr->sin_port;
-    if (port == 0 || port >= NET_MAX_SOCKETS) {
+    if (port >= NET_MAX_SOCKETS) {
         return -1;
     }
 
     spinlock_lock(&udp_port_lock);
-    if (udp_port_table[port]) {
+    if (sock->bound) {
+        spinlock_unlock(&udp_port_lock);
+        return -1;
+    }
+    if (port == 0) {
+        port = udp_pick_ephemeral_locked();
+    }
+    if (port == 0 || udp_port_table[port]) {
         spinlock_unlock(&udp_port_lock);
         return -1;
     }
@@ -790,6 +899,13 @@ int net_socket_sendto(net_socket_t* sock, const void* buf, size_t len, const soc
     }
     memset(frame, 0, frame_len);
 
+    if (!sock->bound) {
+        /* Implicit bind so replies can reach this socket. */
+        sockaddr_in_t any;
+        memset(&any, 0, sizeof(any));
+        any.sin_family = AF_INET;
+        (void)net_socket_bind(sock, &any);
+    }
     uint16_t sport = sock->bound ? sock->bound_port : 0;
 
     bsd_ether_header_t* eh = (bsd_ether_header_t*)frame;
@@ -807,18 +923,14 @@ int net_socket_sendto(net_socket_t* sock, const void* buf, size_t len, const soc
     ip->ip_p = BSD_IPPROTO_UDP;
     ip->ip_src = bsd_htonl(src_host);
     ip->ip_dst = bsd_htonl(dst_host);
-    ip->ip_sum = 0;
-    ip->ip_sum = bsd_in_cksum(ip, sizeof(*ip));
 
     bsd_udphdr_t* uh = (bsd_udphdr_t*)(frame + eth_len + ip_len);
     uh->uh_sport = bsd_htons(sport);
     uh->uh_dport = bsd_htons(dport);
     uh->uh_ulen = bsd_htons((uint16_t)udp_len);
-    uh->uh_sum = 0;
     memcpy((uint8_t*)(uh + 1), buf, len);
-    uh->uh_sum = bsd_udp4_checksum(src_host, dst_host, uh, (const void*)(uh + 1), len);
 
-    int tx_rc = fabric_netif_tx(tx_iface, frame, (uint32_t)frame_len);
+    int tx_rc = net_ip_output(tx_iface, frame, frame_len);
     kfree(frame);
     return (tx_rc == RDNX_OK) ? (int)len : -1;
 }
@@ -849,6 +961,23 @@ int net_socket_recvfrom(net_socket_t* sock, void* buf, size_t len, sockaddr_in_t
     }
 
     uint64_t deadline = udp_deadline(timeout_ms);
+    if (sock->busy_poll_us) {
+        /* Spin on the rings instead of waiting for the poll thread. */
+        const uint64_t stop = console_get_uptime_us() + sock->busy_poll_us;
+        for (;;) {
+            int ret = udp_queue_pop(&sock->queue, buf, len, src);
+            if (ret >= 0) {
+                return ret;
+            }
+            if (console_get_uptime_us() >= stop ||
+                (deadline && scheduler_get_ticks() >= deadline)) {
+                break;
+            }
+            (void)fabric_netif_busy_poll();
+            (void)bsd_netisr_poll(BSD_NETISR_QDEPTH);
+            __asm__ volatile("pause");
+        }
+    }
     for (;;) {
         int ret = udp_queue_pop(&sock->queue, buf, len, src);
         if (ret >= 0) {
@@ -857,11 +986,37 @@ int net_socket_recvfrom(net_socket_t* sock, void* buf, size_t len, sockaddr_in_t
         if (deadline && scheduler_get_ticks() >= deadline) {
             return -1;
         }
-        fabric_netif_poll_all();
+        net_rx_poll();
         scheduler_yield();
     }
 }
 
+int net_socket_setsockopt(net_socket_t* sock, int level, int optname, const void* optval, size_t optlen)
+{
+    if (!sock || !optval) {
+        return RDNX_E_INVALID;
+    }
+    if (level != SOL_SOCKET) {
+        return RDNX_E_UNSUPPORTED;
+    }
+    switch (optname) {
+    case SO_BUSY_POLL: {
+        int us = 0;
+        if (optlen < sizeof(us)) {
+            return RDNX_E_INVALID;
+        }
+        memcpy(&us, optval, sizeof(us));
+        if (us < 0 || (uint32_t)us > NET_BUSY_POLL_MAX_US) {
+            return RDNX_E_INVALID;
+        }
+        sock->busy_poll_us = (uint32_t)us;
+        return RDNX_OK;
+    }
+    default:
+        return RDNX_E_UNSUPPORTED;
+    }
+}
+
 int net_socket_recv(net_socket_t* sock, void* buf, size_t len, uint64_t timeout_ms)
 {
     return net_socket_recvfrom(sock, buf, len, NULL, timeout_ms);
@@ -947,8 +1102,6 @@ int net_ping_ipv4(uint32_t dst_host, uint32_t timeout_ms, uint32_t* out_rtt_ms)
     ip->ip_p = BSD_IPPROTO_ICMP;
     ip->ip_src = bsd_htonl(src_host);
     ip->ip_dst = bsd_htonl(dst_host);
-    ip->ip_sum = 0;
-    ip->ip_sum = bsd_in_cksum(ip, sizeof(*ip));
 
     uint8_t* icmp_buf = frame + sizeof(*eh) + sizeof(*ip);
     bsd_icmp_echo_t* icmp = (bsd_icmp_echo_t*)icmp_buf;
@@ -958,9 +1111,9 @@ int net_ping_ipv4(uint32_t dst_host, uint32_t timeout_ms, uint32_t* out_rtt_ms)
     icmp->id = bsd_htons(NET_PING_ID);
     icmp->seq = bsd_htons(seq);
     memcpy(icmp_buf + sizeof(*icmp), payload, sizeof(payload));
-    icmp->cksum = bsd_icmp_checksum(icmp_buf, icmp_len);
+    icmp->cksum = bsd_htons(bsd_icmp_checksum(icmp_buf, icmp_len));
 
-    int tx_rc = fabric_netif_tx(tx_iface, frame, (uint32_t)frame_len);
+    int tx_rc = net_ip_output(tx_iface, frame, frame_len);
     kfree(frame);
     if (tx_rc != RDNX_OK) {
         spinlock_lock(&g_ping.lock);
@@ -1002,7 +1155,7 @@ int net_ping_ipv4(uint32_t dst_host, uint32_t timeout_ms, uint32_t* out_rtt_ms)
             return -1;
         }
 
-        fabric_netif_poll_all();
+        net_rx_poll();
         scheduler_yield();
     }
 }
@@ -10,6 +10,11 @@
 
 #define NET_LOOPBACK_ADDR 0x7F000001u
 
+/* Socket options; values match Linux. */
+#define SOL_SOCKET   0xFFFF
+#define SO_BUSY_POLL 46               /* int, microseconds */
+#define NET_BUSY_POLL_MAX_US 100000u
+
 typedef struct sockaddr_in {
     uint16_t sin_family;
     uint16_t sin_port;
@@ -17,8 +22,11 @@ typedef struct sockaddr_in {
 } sockaddr_in_t;
 
 typedef struct net_socket net_socket_t;
+struct bsd_mbuf;
 
 int net_ingress_frame(const void* frame, uint32_t len, void* ifp_hint);
+/* Zero-copy ingress: takes ownership of a packet-header mbuf (freed on failure). */
+int net_ingress_mbuf(struct bsd_mbuf* m);
 
 net_socket_t* net_socket_create(int domain, int type, int protocol);
 int net_socket_bind(net_socket_t* sock, const sockaddr_in_t* addr);
@@ -27,6 +35,12 @@ int net_socket_sendto(net_socket_t* sock, const void* buf, size_t len, const soc
 int net_socket_recvfrom(net_socket_t* sock, void* buf, size_t len, sockaddr_in_t* src, uint64_t timeout_ms);
 int net_socket_send(net_socket_t* sock, const void* buf, size_t len);
 int net_socket_recv(net_socket_t* sock, void* buf, size_t len, uint64_t timeout_ms);
+/*
+ * SO_BUSY_POLL: a receive with nothing queued first polls this CPU's NIC
+ * queues directly for up to that many microseconds before sleeping.
+ * RDNX_E_INVALID for a bad value, RDNX_E_UNSUPPORTED for other options.
+ */
+int net_socket_setsockopt(net_socket_t* sock, int level, int optname, const void* optval, size_t optlen);
 void net_socket_close(net_socket_t* sock);
 int net_ping_ipv4(uint32_t dst_host, uint32_t timeout_ms, uint32_t* out_rtt_ms);
 
@@ -121,6 +121,17 @@ uint64_t posix_recvfrom(uint64_t a1,
     return unix_fs_recvfrom(a1, a2, a3, a4, a5, a6);
 }
 
+uint64_t posix_setsockopt(uint64_t a1,
+                          uint64_t a2,
+                          uint64_t a3,
+                          uint64_t a4,
+                          uint64_t a5,
+                          uint64_t a6)
+{
+    (void)a6;
+    return unix_fs_setsockopt(a1, a2, a3, a4, a5);
+}
+
 uint64_t posix_poll(uint64_t a1,
                            uint64_t a2,
                            uint64_t a3,
@@ -373,6 +384,64 @@ uint64_t posix_ftruncate(uint64_t a1,
     return unix_fs_ftruncate(a1, a2);
 }
 
+uint64_t posix_fsync(uint64_t a1,
+                            uint64_t a2,
+                            uint64_t a3,
+                            uint64_t a4,
+                            uint64_t a5,
+                            uint64_t a6)
+{
+    (void)a2;
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    return unix_fs_fsync(a1, 0);
+}
+
+uint64_t posix_fdatasync(uint64_t a1,
+                                uint64_t a2,
+                                uint64_t a3,
+                                uint64_t a4,
+                                uint64_t a5,
+                                uint64_t a6)
+{
+    (void)a2;
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    return unix_fs_fsync(a1, 1);
+}
+
+uint64_t posix_sync(uint64_t a1,
+                           uint64_t a2,
+                           uint64_t a3,
+                           uint64_t a4,
+                           uint64_t a5,
+                           uint64_t a6)
+{
+    (void)a1;
+    (void)a2;
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    return unix_fs_sync();
+}
+
+uint64_t posix_fallocate(uint64_t a1,
+                                uint64_t a2,
+                                uint64_t a3,
+                                uint64_t a4,
+                                uint64_t a5,
+                                uint64_t a6)
+{
+    (void)a5;
+    (void)a6;
+    return unix_fs_fallocate(a1, a2, a3, a4);
+}
+
 uint64_t posix_read(uint64_t a1,
                            uint64_t a2,
                            uint64_t a3,
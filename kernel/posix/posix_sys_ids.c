@@ -42,6 +42,23 @@ uint64_t posix_getpid(uint64_t a1,
     return task ? task->task_id : 0;
 }
 
+uint64_t posix_gettid(uint64_t a1,
+                             uint64_t a2,
+                             uint64_t a3,
+                             uint64_t a4,
+                             uint64_t a5,
+                             uint64_t a6)
+{
+    (void)a1;
+    (void)a2;
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    thread_t* thread = thread_get_current();
+    return thread ? thread->thread_id : 0;
+}
+
 uint64_t posix_getuid(uint64_t a1,
                              uint64_t a2,
                              uint64_t a3,
@@ -5,6 +5,19 @@
 #include "../core/memory.h"
 #include "../common/syscall.h"
 #include "../common/kmod.h"
+#include "../common/heap.h"
+#include "../common/rusage.h"
+#include "../common/cgroup.h"
+#include "../common/prof.h"
+#include "../common/lockstat.h"
+#include "../common/lattrace.h"
+#include "../common/gcov.h"
+#include "../common/kasan.h"
+#include "../common/kmemleak.h"
+#include "../common/random.h"
+#include "../common/security.h"
+#include "../vm/vm_map.h"
+#include "../vm/vm_reclaim.h"
 #include "../fabric/fabric.h"
 #include "../fabric/device/device.h"
 #include "../fabric/service/net_service.h"
@@ -323,6 +336,21 @@ uint64_t posix_sysinfo(uint64_t a1,
     out->syscall_int80_count = syscall_get_int80_count();
     out->syscall_fast_count = syscall_get_fast_count();
 
+    vm_reclaim_stats_t rstats;
+    vm_reclaim_get_stats(&rstats);
+    out->lru_active_pages = rstats.active_pages;
+    out->lru_inactive_pages = rstats.inactive_pages;
+    out->reclaim_scanned = rstats.scanned;
+    out->reclaim_evicted = rstats.evicted;
+    out->reclaim_writeback = rstats.writeback;
+    out->reclaim_refaults = rstats.refaults;
+    out->reclaim_kswapd_wakeups = rstats.kswapd_wakeups;
+    out->reclaim_direct = rstats.direct_runs;
+    out->reclaim_shrunk_bytes = rstats.shrunk_bytes;
+    out->wmark_min_pages = rstats.wmark_min;
+    out->wmark_low_pages = rstats.wmark_low;
+    out->wmark_high_pages = rstats.wmark_high;
+
     return (uint64_t)RDNX_OK;
 }
 
@@ -408,6 +436,7 @@ uint64_t posix_blocklist(uint64_t a1,
         out.sector_size = info.sector_size;
         out.sector_count = info.sector_count;
         out.flags = info.flags;
+        out.queue_depth = info.queue_depth;
         user_entries[i] = out;
     }
     if (user_count) {
@@ -416,6 +445,100 @@ uint64_t posix_blocklist(uint64_t a1,
     return (uint64_t)n;
 }
 
+#define POSIX_PROCSTAT_MAX 256u
+
+typedef struct posix_procstat_ctx {
+    rodnix_procstat_t* out;
+    uint32_t cap;
+    uint32_t n;
+} posix_procstat_ctx_t;
+
+static void posix_procstat_one(task_t* task, void* arg)
+{
+    posix_procstat_ctx_t* ctx = (posix_procstat_ctx_t*)arg;
+    if (ctx->n >= ctx->cap) {
+        return;
+    }
+    rodnix_procstat_t* e = &ctx->out[ctx->n++];
+    memset(e, 0, sizeof(*e));
+    e->pid = task->task_id;
+    e->ppid = task->parent_task_id;
+    e->uid = task->uid;
+    e->state = (uint32_t)task->state;
+    e->threads = task->thread_count;
+    e->cgroup = cgroup_of(task)->id;
+    memcpy(e->comm, task->comm, sizeof(e->comm));
+    e->comm[sizeof(e->comm) - 1] = '\0';
+
+    task_rusage_t ru;
+    rusage_task_sum(task, &ru);
+    e->utime_ns = rusage_cycles_to_ns(ru.utime_cycles);
+    e->stime_ns = rusage_cycles_to_ns(ru.stime_cycles);
+    e->minflt = ru.minflt;
+    e->majflt = ru.majflt;
+    e->nvcsw = ru.nvcsw;
+    e->nivcsw = ru.nivcsw;
+    e->read_bytes = ru.read_bytes;
+    e->write_bytes = ru.write_bytes;
+    e->maxrss_pages = ru.maxrss_pages;
+    e->cutime_ns = rusage_cycles_to_ns(task->ru_children.utime_cycles);
+    e->cstime_ns = rusage_cycles_to_ns(task->ru_children.stime_cycles);
+
+    const vm_map_t* map = (const vm_map_t*)task->vm_map;
+    if (map) {
+        e->rss_pages = map->resident_pages;
+        for (uint32_t i = 0; i < map->entry_count; i++) {
+            e->vsize_bytes += map->entries[i].end - map->entries[i].start;
+        }
+    }
+}
+
+/*
+ * Snapshot every task in one call (ps/top). Entries are filled into a kernel
+ * buffer under the task registry lock and copied out afterwards, so user
+ * page faults never happen with the registry held.
+ */
+uint64_t posix_procstat(uint64_t a1,
+                        uint64_t a2,
+                        uint64_t a3,
+                        uint64_t a4,
+                        uint64_t a5,
+                        uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+
+    rodnix_procstat_t* user_entries = (rodnix_procstat_t*)(uintptr_t)a1;
+    uint32_t max_entries = (uint32_t)a2;
+    uint32_t* user_count = (uint32_t*)(uintptr_t)a3;
+
+    if (max_entries == 0 || !user_entries) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (!unix_user_range_ok(user_entries, (size_t)max_entries * sizeof(*user_entries))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (user_count && !unix_user_range_ok(user_count, sizeof(uint32_t))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+
+    posix_procstat_ctx_t ctx;
+    ctx.cap = (max_entries < POSIX_PROCSTAT_MAX) ? max_entries : POSIX_PROCSTAT_MAX;
+    ctx.n = 0;
+    ctx.out = (rodnix_procstat_t*)kmalloc((size_t)ctx.cap * sizeof(rodnix_procstat_t));
+    if (!ctx.out) {
+        return (uint64_t)RDNX_E_NOMEM;
+    }
+    uint32_t total = task_foreach(posix_procstat_one, &ctx);
+    memcpy(user_entries, ctx.out, (size_t)ctx.n * sizeof(rodnix_procstat_t));
+    kfree(ctx.out);
+    if (user_count) {
+        *user_count = total;
+    }
+    return (uint64_t)ctx.n;
+}
+
 uint64_t posix_blockread(uint64_t a1,
                                 uint64_t a2,
                                 uint64_t a3,
@@ -438,21 +561,24 @@ uint64_t posix_blockread(uint64_t a1,
         return (uint64_t)RDNX_E_INVALID;
     }
 
-    fabric_blockdev_t* dev = fabric_blockdev_find(name);
+    fabric_blockdev_t* dev = fabric_blockdev_acquire(name);
     if (!dev) {
         return (uint64_t)RDNX_E_NOTFOUND;
     }
-    if (dev->sector_size == 0 || dev->sector_size > out_len || dev->sector_size > 4096u) {
+    uint32_t sector_size = dev->sector_size;
+    if (sector_size == 0 || sector_size > out_len || sector_size > 4096u) {
+        fabric_blockdev_release(dev);
         return (uint64_t)RDNX_E_INVALID;
     }
 
     uint8_t bounce[4096];
     int rc = fabric_blockdev_read(dev, lba, 1, bounce);
+    fabric_blockdev_release(dev);
     if (rc != RDNX_OK) {
         return (uint64_t)rc;
     }
-    memcpy(out, bounce, dev->sector_size);
-    return (uint64_t)dev->sector_size;
+    memcpy(out, bounce, sector_size);
+    return (uint64_t)sector_size;
 }
 
 uint64_t posix_blockwrite(uint64_t a1,
@@ -477,21 +603,24 @@ uint64_t posix_blockwrite(uint64_t a1,
         return (uint64_t)RDNX_E_INVALID;
     }
 
-    fabric_blockdev_t* dev = fabric_blockdev_find(name);
+    fabric_blockdev_t* dev = fabric_blockdev_acquire(name);
     if (!dev) {
         return (uint64_t)RDNX_E_NOTFOUND;
     }
-    if (dev->sector_size == 0 || dev->sector_size > in_len || dev->sector_size > 4096u) {
+    uint32_t sector_size = dev->sector_size;
+    if (sector_size == 0 || sector_size > in_len || sector_size > 4096u) {
+        fabric_blockdev_release(dev);
         return (uint64_t)RDNX_E_INVALID;
     }
 
     uint8_t bounce[4096];
-    memcpy(bounce, in, dev->sector_size);
+    memcpy(bounce, in, sector_size);
     int rc = fabric_blockdev_write(dev, lba, 1, bounce);
+    fabric_blockdev_release(dev);
     if (rc != RDNX_OK) {
         return (uint64_t)rc;
     }
-    return (uint64_t)dev->sector_size;
+    return (uint64_t)sector_size;
 }
 
 uint64_t posix_kmodls(uint64_t a1,
@@ -534,6 +663,8 @@ uint64_t posix_kmodls(uint64_t a1,
         out.flags = ki.flags;
         out.builtin = ki.builtin;
         out.loaded = ki.loaded;
+        out.refs = ki.refs;
+        out.ndeps = ki.ndeps;
         user_entries[i] = out;
     }
     if (user_count) {
@@ -580,6 +711,321 @@ uint64_t posix_kmodunload(uint64_t a1,
     return (uint64_t)kmod_unload(name);
 }
 
+/*
+ * Task groups (POSIX 77-81). Creating, removing, moving tasks and changing
+ * limits requires euid 0; cgstat is open to everyone like procstat.
+ */
+uint64_t posix_cgcreate(uint64_t a1,
+                        uint64_t a2,
+                        uint64_t a3,
+                        uint64_t a4,
+                        uint64_t a5,
+                        uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    uint32_t parent_id = (uint32_t)a1;
+    const char* user_name = (const char*)(uintptr_t)a2;
+    uint32_t* user_id = (uint32_t*)(uintptr_t)a3;
+
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    if (!user_name || !user_id || !unix_user_range_ok(user_id, sizeof(uint32_t))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    char name[CGROUP_NAME_MAX];
+    uint32_t i = 0;
+    for (; i < sizeof(name); i++) {
+        if (!unix_user_range_ok(user_name + i, 1)) {
+            return (uint64_t)RDNX_E_INVALID;
+        }
+        name[i] = user_name[i];
+        if (name[i] == '\0') {
+            break;
+        }
+    }
+    if (i == sizeof(name)) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    uint32_t id = 0;
+    int rc = cgroup_create(parent_id, name, &id);
+    if (rc != RDNX_OK) {
+        return (uint64_t)rc;
+    }
+    *user_id = id;
+    return (uint64_t)RDNX_OK;
+}
+
+uint64_t posix_cgdestroy(uint64_t a1,
+                         uint64_t a2,
+                         uint64_t a3,
+                         uint64_t a4,
+                         uint64_t a5,
+                         uint64_t a6)
+{
+    (void)a2;
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    return (uint64_t)cgroup_destroy((uint32_t)a1);
+}
+
+/* cgattach(pid, id): pid 0 moves the calling process. */
+uint64_t posix_cgattach(uint64_t a1,
+                        uint64_t a2,
+                        uint64_t a3,
+                        uint64_t a4,
+                        uint64_t a5,
+                        uint64_t a6)
+{
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    task_t* task = (a1 == 0) ? task_get(task_get_current()) : task_find_by_id(a1);
+    if (!task) {
+        return (uint64_t)RDNX_E_NOTFOUND;
+    }
+    uint64_t rc = (uint64_t)RDNX_E_NOTFOUND;
+    if (task->state != TASK_STATE_ZOMBIE && task->state != TASK_STATE_DEAD) {
+        rc = (uint64_t)cgroup_attach(task, (uint32_t)a2);
+    }
+    task_put(task);
+    return rc;
+}
+
+uint64_t posix_cgset(uint64_t a1,
+                     uint64_t a2,
+                     uint64_t a3,
+                     uint64_t a4,
+                     uint64_t a5,
+                     uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    return (uint64_t)cgroup_set((uint32_t)a1, (uint32_t)a2, a3);
+}
+
+uint64_t posix_cgstat(uint64_t a1,
+                      uint64_t a2,
+                      uint64_t a3,
+                      uint64_t a4,
+                      uint64_t a5,
+                      uint64_t a6)
+{
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    rodnix_cgstat_t* out = (rodnix_cgstat_t*)(uintptr_t)a2;
+    if (!out || !unix_user_range_ok(out, sizeof(*out))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    cgroup_stat_t st;
+    int rc = cgroup_get_stat((uint32_t)a1, &st);
+    if (rc != RDNX_OK) {
+        return (uint64_t)rc;
+    }
+    _Static_assert(sizeof(rodnix_cgstat_t) == sizeof(cgroup_stat_t), "cgstat layout");
+    memcpy(out, &st, sizeof(*out));
+    return (uint64_t)RDNX_OK;
+}
+
+/*
+ * profctl(op, flags, period, status*) / profread(buf, max, dropped*): the
+ * sampling profiler (kernel/common/prof.c). Samples expose kernel addresses
+ * and other processes' stacks, so both require euid 0.
+ */
+uint64_t posix_profctl(uint64_t a1,
+                       uint64_t a2,
+                       uint64_t a3,
+                       uint64_t a4,
+                       uint64_t a5,
+                       uint64_t a6)
+{
+    (void)a5;
+    (void)a6;
+    rodnix_profstat_t* out = (rodnix_profstat_t*)(uintptr_t)a4;
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    if (out && !unix_user_range_ok(out, sizeof(*out))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    int rc;
+    switch ((uint32_t)a1) {
+    case PROF_OP_START:
+        rc = prof_start((uint32_t)a2, a3);
+        break;
+    case PROF_OP_STOP:
+        rc = prof_stop();
+        break;
+    case PROF_OP_STATUS:
+        rc = RDNX_OK;
+        break;
+    default:
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (rc == RDNX_OK && out) {
+        prof_status_t st;
+        prof_get_status(&st);
+        _Static_assert(sizeof(rodnix_profstat_t) == sizeof(prof_status_t), "profstat layout");
+        memcpy(out, &st, sizeof(*out));
+    }
+    return (uint64_t)rc;
+}
+
+uint64_t posix_profread(uint64_t a1,
+                        uint64_t a2,
+                        uint64_t a3,
+                        uint64_t a4,
+                        uint64_t a5,
+                        uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    rodnix_prof_sample_t* out = (rodnix_prof_sample_t*)(uintptr_t)a1;
+    uint32_t max = (uint32_t)a2;
+    uint64_t* user_dropped = (uint64_t*)(uintptr_t)a3;
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    if (!out || max == 0 || (uint64_t)max * sizeof(*out) > 0x100000ULL ||
+        !unix_user_range_ok(out, (size_t)max * sizeof(*out))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (user_dropped && !unix_user_range_ok(user_dropped, sizeof(*user_dropped))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    _Static_assert(sizeof(rodnix_prof_sample_t) == sizeof(prof_sample_t), "prof sample layout");
+    /* prof_read() drains under IRQL_HIGH; bounce through the kernel stack so user faults stay outside. */
+    prof_sample_t chunk[8];
+    uint32_t total = 0;
+    while (total < max) {
+        uint32_t want = max - total;
+        if (want > sizeof(chunk) / sizeof(chunk[0])) {
+            want = sizeof(chunk) / sizeof(chunk[0]);
+        }
+        uint32_t got = prof_read(chunk, want);
+        if (got == 0) {
+            break;
+        }
+        memcpy(&out[total], chunk, (size_t)got * sizeof(chunk[0]));
+        total += got;
+        if (got < want) {
+            break;
+        }
+    }
+    if (user_dropped) {
+        prof_status_t st;
+        prof_get_status(&st);
+        *user_dropped = st.dropped;
+    }
+    return (uint64_t)total;
+}
+
+/*
+ * lockstat(op, buf, max, first): lock class statistics from a LOCKSTAT=1 /
+ * LOCKDEP=1 kernel. INFO is open to everyone and returns the feature mask
+ * (0 on production builds); READ and RESET expose kernel call sites and
+ * require euid 0.
+ */
+uint64_t posix_lockstat(uint64_t a1,
+                        uint64_t a2,
+                        uint64_t a3,
+                        uint64_t a4,
+                        uint64_t a5,
+                        uint64_t a6)
+{
+    (void)a5;
+    (void)a6;
+    uint32_t op = (uint32_t)a1;
+    if (op == LOCKSTAT_OP_INFO) {
+        return (uint64_t)lockstat_features();
+    }
+    if (op != LOCKSTAT_OP_READ && op != LOCKSTAT_OP_RESET) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (lockstat_features() == 0) {
+        return (uint64_t)RDNX_E_UNSUPPORTED;
+    }
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    if (op == LOCKSTAT_OP_RESET) {
+        lockstat_reset();
+        return (uint64_t)RDNX_OK;
+    }
+    rodnix_lockstat_t* out = (rodnix_lockstat_t*)(uintptr_t)a2;
+    uint32_t max = (uint32_t)a3;
+    if (!out || max == 0 || max > LOCK_CLASS_MAX ||
+        !unix_user_range_ok(out, (size_t)max * sizeof(*out))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    _Static_assert(sizeof(rodnix_lockstat_t) == sizeof(lockstat_info_t), "lockstat layout");
+    return (uint64_t)lockstat_snapshot((lockstat_info_t*)out, (uint32_t)a4, max);
+}
+
+/*
+ * lattrace(op, buf): latency tracer control and report. The report holds
+ * kernel addresses, so every op requires euid 0.
+ */
+uint64_t posix_lattrace(uint64_t a1,
+                        uint64_t a2,
+                        uint64_t a3,
+                        uint64_t a4,
+                        uint64_t a5,
+                        uint64_t a6)
+{
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    uint32_t op = (uint32_t)a1;
+    if (op < LATTRACE_OP_READ || op > LATTRACE_OP_RESET) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    switch (op) {
+    case LATTRACE_OP_START:
+        lattrace_start();
+        return (uint64_t)RDNX_OK;
+    case LATTRACE_OP_STOP:
+        lattrace_stop();
+        return (uint64_t)RDNX_OK;
+    case LATTRACE_OP_RESET:
+        lattrace_reset();
+        return (uint64_t)RDNX_OK;
+    default:
+        break;
+    }
+    rodnix_lattrace_t* out = (rodnix_lattrace_t*)(uintptr_t)a2;
+    if (!out || !unix_user_range_ok(out, sizeof(*out))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    _Static_assert(sizeof(rodnix_lattrace_t) == sizeof(lattrace_report_t), "lattrace layout");
+    lattrace_report_t rep;
+    lattrace_snapshot(&rep);
+    memcpy(out, &rep, sizeof(rep));
+    return (uint64_t)RDNX_OK;
+}
+
 uint64_t posix_clock_gettime(uint64_t a1,
                                     uint64_t a2,
                                     uint64_t a3,
@@ -658,3 +1104,220 @@ uint64_t posix_ping(uint64_t a1,
     }
     return (uint64_t)RDNX_OK;
 }
+
+uint64_t posix_gcov(uint64_t a1,
+                    uint64_t a2,
+                    uint64_t a3,
+                    uint64_t a4,
+                    uint64_t a5,
+                    uint64_t a6)
+{
+    (void)a5;
+    (void)a6;
+    uint32_t op = (uint32_t)a1;
+    switch (op) {
+    case GCOV_OP_INFO:
+        return (uint64_t)gcov_object_count();
+    case GCOV_OP_DUMP:
+    case GCOV_OP_RESET:
+        if (security_check_euid(0) != SEC_OK) {
+            return (uint64_t)RDNX_E_DENIED;
+        }
+        return (uint64_t)(op == GCOV_OP_DUMP ? gcov_dump() : gcov_reset());
+    case GCOV_OP_EMIT:
+        break;
+    default:
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    /* Any process may frame its own profile: it is only serial output. */
+    const char* user_path = (const char*)(uintptr_t)a2;
+    const void* data = (const void*)(uintptr_t)a3;
+    size_t len = (size_t)a4;
+    if (!user_path || len > GCOV_EMIT_MAX || (len && (!data || !unix_user_range_ok(data, len)))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    char path[GCOV_PATH_MAX];
+    uint32_t i = 0;
+    for (; i < sizeof(path); i++) {
+        if (!unix_user_range_ok(user_path + i, 1)) {
+            return (uint64_t)RDNX_E_INVALID;
+        }
+        path[i] = user_path[i];
+        if (path[i] == '\0') {
+            break;
+        }
+        /* The path ends the BEGIN line; keep the framing one line per record. */
+        if ((unsigned char)path[i] < 0x20) {
+            return (uint64_t)RDNX_E_INVALID;
+        }
+    }
+    if (i == sizeof(path)) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    return (uint64_t)gcov_emit(path, data, len);
+}
+
+/*
+ * kasan(op, buf, max): sanitizer statistics, self-test and kmemleak scan
+ * of a KASAN=1 kernel; RDNX_E_UNSUPPORTED otherwise. Reports carry kernel
+ * addresses, so every op requires euid 0.
+ */
+uint64_t posix_kasan(uint64_t a1,
+                     uint64_t a2,
+                     uint64_t a3,
+                     uint64_t a4,
+                     uint64_t a5,
+                     uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    uint32_t op = (uint32_t)a1;
+    if (op < KASAN_OP_INFO || op > KASAN_OP_LEAK_CLEAR) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    switch (op) {
+    case KASAN_OP_INFO: {
+        rodnix_kasan_stats_t* out = (rodnix_kasan_stats_t*)(uintptr_t)a2;
+        if (!out || !unix_user_range_ok(out, sizeof(*out))) {
+            return (uint64_t)RDNX_E_INVALID;
+        }
+        _Static_assert(sizeof(rodnix_kasan_stats_t) == sizeof(kasan_stats_t), "kasan stats layout");
+        kasan_stats_t st;
+        int rc = kasan_get_stats(&st);
+        if (rc == RDNX_OK) {
+            memcpy(out, &st, sizeof(st));
+        }
+        return (uint64_t)rc;
+    }
+    case KASAN_OP_SELFTEST:
+        return (uint64_t)kasan_selftest();
+    case KASAN_OP_LEAK_CLEAR:
+        return (uint64_t)kmemleak_clear();
+    default:
+        break;
+    }
+    rodnix_kmemleak_record_t* out = (rodnix_kmemleak_record_t*)(uintptr_t)a2;
+    uint32_t max = (uint32_t)a3;
+    if (max > KASAN_LEAK_SCAN_MAX) {
+        max = KASAN_LEAK_SCAN_MAX;
+    }
+    if (max && (!out || !unix_user_range_ok(out, (size_t)max * sizeof(*out)))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    _Static_assert(sizeof(rodnix_kmemleak_record_t) == sizeof(kmemleak_record_t), "kmemleak record layout");
+    kmemleak_record_t* recs = NULL;
+    if (max) {
+        recs = (kmemleak_record_t*)kmalloc((size_t)max * sizeof(*recs));
+        if (!recs) {
+            return (uint64_t)RDNX_E_NOMEM;
+        }
+    }
+    int found = kmemleak_scan(recs, max);
+    if (found > 0 && max) {
+        memcpy(out, recs, (size_t)((uint32_t)found < max ? (uint32_t)found : max) * sizeof(*recs));
+    }
+    kfree(recs);
+    return (uint64_t)(int64_t)found;
+}
+
+uint64_t posix_getrandom(uint64_t a1,
+                         uint64_t a2,
+                         uint64_t a3,
+                         uint64_t a4,
+                         uint64_t a5,
+                         uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    void* buf = (void*)(uintptr_t)a1;
+    size_t len = (size_t)a2;
+    uint32_t flags = (uint32_t)a3;
+    if ((a3 >> 32) != 0 || (flags & ~RANDOM_F_MASK) != 0) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    /* Short read: one call returns at most RANDOM_GET_MAX bytes. */
+    if (len > RANDOM_GET_MAX) {
+        len = RANDOM_GET_MAX;
+    }
+    if (len > 0 && (!buf || !unix_user_range_ok(buf, len))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (len == 0) {
+        return (uint64_t)(int64_t)random_get_bytes(NULL, 0, flags);
+    }
+    /* Generate into a kernel bounce buffer; copy out with interrupts on. */
+    uint8_t bounce[256];
+    size_t done = 0;
+    int rc = RDNX_OK;
+    while (done < len) {
+        size_t n = len - done;
+        if (n > sizeof(bounce)) {
+            n = sizeof(bounce);
+        }
+        rc = random_get_bytes(bounce, n, flags);
+        if (rc < 0) {
+            break;
+        }
+        rc = unix_copy_to_user((uint8_t*)buf + done, bounce, n);
+        if (rc != RDNX_OK) {
+            break;
+        }
+        done += n;
+    }
+    memset(bounce, 0, sizeof(bounce));
+    if (done == 0 && rc < 0) {
+        return (uint64_t)(int64_t)rc;
+    }
+    return (uint64_t)done;
+}
+
+uint64_t posix_netqstat(uint64_t a1,
+                        uint64_t a2,
+                        uint64_t a3,
+                        uint64_t a4,
+                        uint64_t a5,
+                        uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    fabric_netif_qstat_t* user_entries = (fabric_netif_qstat_t*)(uintptr_t)a1;
+    uint32_t max_entries = (uint32_t)a2;
+    uint32_t* user_count = (uint32_t*)(uintptr_t)a3;
+
+    if (max_entries > 0 &&
+        (!user_entries ||
+         !unix_user_range_ok(user_entries, (size_t)max_entries * sizeof(fabric_netif_qstat_t)))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (user_count && !unix_user_range_ok(user_count, sizeof(uint32_t))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    uint32_t total = 0;
+    uint32_t n = fabric_netif_get_qstats(max_entries ? user_entries : NULL, max_entries, &total);
+    if (user_count) {
+        *user_count = total;
+    }
+    return (uint64_t)n;
+}
+
+uint64_t posix_netifset(uint64_t a1,
+                        uint64_t a2,
+                        uint64_t a3,
+                        uint64_t a4,
+                        uint64_t a5,
+                        uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    if (security_check_euid(0) != SEC_OK) {
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    return (uint64_t)(int64_t)fabric_netif_set((uint32_t)a1, (uint32_t)a2, a3);
+}
@@ -111,3 +111,98 @@ uint64_t posix_futex(uint64_t a1,
 {
     return unix_proc_futex(a1, a2, a3, a4, a5, a6);
 }
+
+uint64_t posix_getrusage(uint64_t a1,
+                       uint64_t a2,
+                       uint64_t a3,
+                       uint64_t a4,
+                       uint64_t a5,
+                       uint64_t a6)
+{
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    return unix_proc_getrusage(a1, a2);
+}
+
+uint64_t posix_getrlimit(uint64_t a1,
+                       uint64_t a2,
+                       uint64_t a3,
+                       uint64_t a4,
+                       uint64_t a5,
+                       uint64_t a6)
+{
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    return unix_proc_getrlimit(a1, a2);
+}
+
+uint64_t posix_setrlimit(uint64_t a1,
+                       uint64_t a2,
+                       uint64_t a3,
+                       uint64_t a4,
+                       uint64_t a5,
+                       uint64_t a6)
+{
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    return unix_proc_setrlimit(a1, a2);
+}
+
+uint64_t posix_sched_setscheduler(uint64_t a1,
+                                  uint64_t a2,
+                                  uint64_t a3,
+                                  uint64_t a4,
+                                  uint64_t a5,
+                                  uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    return unix_proc_sched_setscheduler(a1, a2, a3);
+}
+
+uint64_t posix_sched_getscheduler(uint64_t a1,
+                                  uint64_t a2,
+                                  uint64_t a3,
+                                  uint64_t a4,
+                                  uint64_t a5,
+                                  uint64_t a6)
+{
+    (void)a2;
+    (void)a3;
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    return unix_proc_sched_getscheduler(a1);
+}
+
+uint64_t posix_sched_setattr(uint64_t a1,
+                             uint64_t a2,
+                             uint64_t a3,
+                             uint64_t a4,
+                             uint64_t a5,
+                             uint64_t a6)
+{
+    (void)a4;
+    (void)a5;
+    (void)a6;
+    return unix_proc_sched_setattr(a1, a2, a3);
+}
+
+uint64_t posix_sched_getattr(uint64_t a1,
+                             uint64_t a2,
+                             uint64_t a3,
+                             uint64_t a4,
+                             uint64_t a5,
+                             uint64_t a6)
+{
+    (void)a5;
+    (void)a6;
+    return unix_proc_sched_getattr(a1, a2, a3, a4);
+}
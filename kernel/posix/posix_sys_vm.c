@@ -80,6 +80,10 @@ uint64_t posix_mmap(uint64_t a1,
     if ((off & (VM_PAGE_SIZE - 1u)) != 0) {
         return (uint64_t)RDNX_E_INVALID;
     }
+    int mrc = vfs_node_materialize(file->node);
+    if (mrc != RDNX_OK) {
+        return (uint64_t)mrc;
+    }
     const uint8_t* data = file->node->inode->data;
     uint64_t data_size = (uint64_t)file->node->inode->size;
     if (!data) {
@@ -100,6 +104,8 @@ uint64_t posix_mmap(uint64_t a1,
             fb->data = data;
             fb->size = data_size;
             fb->file_offset = 0;
+            fb->dirty = 0;
+            fb->shared = 1;
             obj->pager_private = fb;
             file->node->inode->mmap_object = obj;
         }
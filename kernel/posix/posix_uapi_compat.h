@@ -71,6 +71,20 @@ typedef struct rodnix_sysinfo {
 
     uint64_t syscall_int80_count;
     uint64_t syscall_fast_count;
+
+    /* Page reclaim (file pages on the active/inactive LRU). */
+    uint64_t lru_active_pages;
+    uint64_t lru_inactive_pages;
+    uint64_t reclaim_scanned;
+    uint64_t reclaim_evicted;
+    uint64_t reclaim_writeback;
+    uint64_t reclaim_refaults;
+    uint64_t reclaim_kswapd_wakeups;
+    uint64_t reclaim_direct;
+    uint64_t reclaim_shrunk_bytes;
+    uint64_t wmark_min_pages;
+    uint64_t wmark_low_pages;
+    uint64_t wmark_high_pages;
 } rodnix_sysinfo_t;
 
 typedef struct rdnx_timespec {
@@ -91,9 +105,132 @@ typedef struct rodnix_blockdev_info {
     uint32_t sector_size;
     uint64_t sector_count;
     uint32_t flags;
-    uint32_t reserved0;
+    uint32_t queue_depth;   /* commands kept in flight by the driver */
 } rodnix_blockdev_info_t;
 
+/* One task as reported by procstat (POSIX 76); times in nanoseconds. */
+typedef struct rodnix_procstat {
+    uint64_t pid;
+    uint64_t ppid;
+    uint32_t uid;
+    uint32_t state;
+    uint32_t threads;
+    uint32_t cgroup;    /* task group id, 0 = root */
+    char comm[16];
+    uint64_t utime_ns;
+    uint64_t stime_ns;
+    uint64_t minflt;
+    uint64_t majflt;
+    uint64_t nvcsw;
+    uint64_t nivcsw;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t rss_pages;
+    uint64_t maxrss_pages;
+    uint64_t vsize_bytes;
+    uint64_t cutime_ns;
+    uint64_t cstime_ns;
+} rodnix_procstat_t;
+
+/* One task group as reported by cgstat (POSIX 81); limits are CGROUP_UNLIMITED when unset. */
+typedef struct rodnix_cgstat {
+    uint32_t id;
+    uint32_t parent_id;
+    uint32_t depth;
+    uint32_t nr_tasks;
+    uint32_t nr_children;
+    uint32_t dying;
+    char name[16];
+    uint32_t cpu_weight;
+    uint32_t io_weight;
+    uint64_t cpu_max_us;
+    uint64_t cpu_period_us;
+    uint64_t cpu_usage_us;
+    uint64_t cpu_nr_periods;
+    uint64_t cpu_nr_throttled;
+    uint64_t cpu_throttled_us;
+    uint64_t mem_max_bytes;
+    uint64_t mem_bytes;
+    uint64_t mem_anon_bytes;
+    uint64_t mem_file_bytes;
+    uint64_t mem_peak_bytes;
+    uint64_t mem_failcnt;
+    uint64_t mem_oom_kills;
+    uint64_t io_read_bytes;
+    uint64_t io_write_bytes;
+    uint64_t io_delay_us;
+} rodnix_cgstat_t;
+
+/* Profiler state as reported by profctl(PROF_OP_STATUS) (POSIX 82). */
+typedef struct rodnix_profstat {
+    uint32_t mode;           /* 0 off, 1 PMU overflow NMI, 2 timer tick */
+    uint32_t running;
+    uint32_t cpus;
+    uint32_t pmu_version;
+    uint32_t pmu_counters;
+    uint32_t pmu_width;
+    uint64_t period;
+    uint64_t samples;
+    uint64_t dropped;
+    uint64_t pending;
+} rodnix_profstat_t;
+
+/* One profiler sample returned by profread (POSIX 83); kernel frames first, leaf first. */
+typedef struct rodnix_prof_sample {
+    uint32_t pid;
+    uint16_t nr_kernel;
+    uint16_t nr_user;
+    char comm[16];
+    uint64_t ips[24];
+} rodnix_prof_sample_t;
+
+/* One lock class as reported by lockstat(LOCKSTAT_OP_READ) (POSIX 84); times in ns. */
+typedef struct rodnix_lockstat {
+    char name[32];
+    uint32_t id;
+    uint32_t kind;           /* 1 spinlock, 2 wait queue */
+    uint64_t acquired;
+    uint64_t contended;
+    uint64_t spin_ns;
+    uint64_t spin_max_ns;
+    uint64_t hold_ns;
+    uint64_t hold_max_ns;
+    uint64_t waits;
+    uint64_t wakeups;
+    uint64_t timeouts;
+    uint64_t wait_ns;
+    uint64_t wait_max_ns;
+    uint32_t deps;
+    uint32_t violations;
+    uint64_t site_ip[4];
+    uint64_t site_acquired[4];
+    uint64_t site_contended[4];
+} rodnix_lockstat_t;
+
+/* Worst section of one kind as reported by lattrace(LATTRACE_OP_READ) (POSIX 85). */
+typedef struct rodnix_lat_record {
+    uint64_t max_ns;
+    uint64_t start_ip;
+    uint32_t pid;
+    uint32_t nr_ips;
+    char comm[16];
+    uint64_t ips[16];
+} rodnix_lat_record_t;
+
+/* lattrace report: [0] preempt-off, [1] IRQ-off; times in ns. */
+typedef struct rodnix_lattrace {
+    uint32_t enabled;
+    uint32_t preempt_mode;   /* 1 voluntary, 2 full */
+    uint64_t sections[2];
+    uint64_t total_ns[2];
+    uint64_t involuntary;
+    uint64_t deferred;
+    uint64_t enable_resched;
+    uint64_t cond_resched;
+    uint64_t atomic_sleeps;
+    rodnix_lat_record_t worst[2];
+} rodnix_lattrace_t;
+
 typedef struct rodnix_kmod_info {
     char name[32];
     char kind[16];
@@ -101,8 +238,32 @@ typedef struct rodnix_kmod_info {
     uint32_t flags;
     uint8_t builtin;
     uint8_t loaded;
-    uint8_t reserved0;
-    uint8_t reserved1;
+    uint8_t refs;
+    uint8_t ndeps;
 } rodnix_kmod_info_t;
 
+/* kasan(KASAN_OP_INFO) report (POSIX 91); bugs[] by kind: oob, uaf, page uaf, wild, double free. */
+typedef struct rodnix_kasan_stats {
+    uint64_t enabled;
+    uint64_t shadow_start;
+    uint64_t shadow_end;
+    uint64_t shadow_bytes;
+    uint64_t reports;
+    uint64_t bugs[5];
+    uint64_t quarantine_bytes;
+    uint64_t quarantine_objects;
+    uint64_t heap_objects;
+    uint64_t heap_bytes;
+} rodnix_kasan_stats_t;
+
+/* One unreferenced kmalloc block from kasan(KASAN_OP_LEAK_SCAN). */
+typedef struct rodnix_kmemleak_record {
+    uint64_t addr;
+    uint64_t size;
+    uint64_t age_ticks;
+    uint32_t flags;          /* 1: first scan to find it */
+    uint32_t depth;
+    uint64_t ips[8];         /* allocation stack */
+} rodnix_kmemleak_record_t;
+
 #endif /* _RODNIX_POSIX_UAPI_COMPAT_H */
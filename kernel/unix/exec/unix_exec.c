@@ -2,6 +2,8 @@
 #include "../../common/loader.h"
 #include "../../common/scheduler.h"
 #include "../../common/heap.h"
+#include "../../common/rusage.h"
+#include "../../common/cgroup.h"
 #include "../../../include/common.h"
 #include "../../../include/error.h"
 
@@ -219,6 +221,9 @@ uint64_t unix_proc_spawn(uint64_t user_path_ptr, uint64_t user_argv_ptr)
         len--;
     }
 
+    if (!unix_proc_nproc_ok(parent)) {
+        return (uint64_t)RDNX_E_BUSY;
+    }
     task_t* child = task_create();
     if (!child) {
         return (uint64_t)RDNX_E_NOMEM;
@@ -226,6 +231,8 @@ uint64_t unix_proc_spawn(uint64_t user_path_ptr, uint64_t user_argv_ptr)
     child->state = TASK_STATE_READY;
     child->parent_task_id = parent->task_id;
     task_set_ids(child, parent->uid, parent->gid, parent->euid, parent->egid);
+    rusage_task_inherit(child, parent);
+    cgroup_task_inherit(child, parent);
     strncpy(child->cwd, parent->cwd, sizeof(child->cwd) - 1);
     child->cwd[sizeof(child->cwd) - 1] = '\0';
 
@@ -3,9 +3,12 @@
 #include "../../common/heap.h"
 #include "../../common/tty_console.h"
 #include "../../common/scheduler.h"
+#include "../../common/rusage.h"
+#include "../../common/cgroup.h"
 #include "../../core/interrupts.h"
 #include "../../vm/vm_map.h"
 #include "../../net/socket.h"
+#include "../../fabric/service/block_part.h"
 #include "../../../include/common.h"
 #include "../../../include/error.h"
 
@@ -24,6 +27,11 @@ enum {
     UNIX_TTY_IOCTL_SETATTR = 0x7403
 };
 
+enum {
+    UNIX_BLK_IOCTL_RRPART = 0x125F,     /* re-read the partition table */
+    UNIX_BLK_IOCTL_GETSIZE64 = 0x1272   /* device size in bytes (uint64_t) */
+};
+
 enum {
     UNIX_POLLIN = 0x0001,
     UNIX_POLLOUT = 0x0004,
@@ -512,7 +520,8 @@ uint64_t unix_fs_dup(uint64_t oldfd)
     }
 
     int newfd = -1;
-    for (int i = 0; i < TASK_MAX_FD; i++) {
+    int limit = task_fd_limit(task);
+    for (int i = 0; i < limit; i++) {
         if (!task->fd_table[i]) {
             newfd = i;
             break;
@@ -534,7 +543,7 @@ uint64_t unix_fs_dup2(uint64_t oldfd, uint64_t newfd)
     task_t* task = task_get_current();
     int oldi = (int)oldfd;
     int newi = (int)newfd;
-    if (!task || oldi < 0 || oldi >= TASK_MAX_FD || newi < 0 || newi >= TASK_MAX_FD || !task->fd_table[oldi]) {
+    if (!task || oldi < 0 || oldi >= TASK_MAX_FD || newi < 0 || newi >= task_fd_limit(task) || !task->fd_table[oldi]) {
         return (uint64_t)RDNX_E_INVALID;
     }
     if (oldi == newi) {
@@ -556,7 +565,7 @@ uint64_t unix_fs_dup3(uint64_t oldfd, uint64_t newfd, uint64_t flags)
     int oldi = (int)oldfd;
     int newi = (int)newfd;
     uint32_t uflags = (uint32_t)flags;
-    if (!task || oldi < 0 || oldi >= TASK_MAX_FD || newi < 0 || newi >= TASK_MAX_FD || !task->fd_table[oldi]) {
+    if (!task || oldi < 0 || oldi >= TASK_MAX_FD || newi < 0 || newi >= task_fd_limit(task) || !task->fd_table[oldi]) {
         return (uint64_t)RDNX_E_INVALID;
     }
     if (oldi == newi) {
@@ -614,6 +623,10 @@ uint64_t unix_fs_read(uint64_t fd, uint64_t user_buf_ptr, uint64_t len)
     if (task->fd_kind[fdi] == UNIX_FD_KIND_VFS) {
         vfs_file_t* file = (vfs_file_t*)h;
         int ret = vfs_read(file, buf, n);
+        if (ret > 0) {
+            rusage_io(0, (uint64_t)ret);
+        }
+        cgroup_io_balance();
         return (uint64_t)ret;
     }
 
@@ -654,6 +667,7 @@ uint64_t unix_fs_read(uint64_t fd, uint64_t user_buf_ptr, uint64_t len)
             }
             scheduler_yield();
         }
+        rusage_io(0, (uint64_t)done);
         return (uint64_t)done;
     }
 
@@ -685,6 +699,10 @@ uint64_t unix_fs_write(uint64_t fd, uint64_t user_buf_ptr, uint64_t len)
     if (task->fd_kind[fdi] == UNIX_FD_KIND_VFS) {
         vfs_file_t* file = (vfs_file_t*)h;
         int ret = vfs_write(file, buf, n);
+        if (ret > 0) {
+            rusage_io(1, (uint64_t)ret);
+        }
+        cgroup_io_balance();
         return (uint64_t)ret;
     }
 
@@ -713,6 +731,7 @@ uint64_t unix_fs_write(uint64_t fd, uint64_t user_buf_ptr, uint64_t len)
             unix_pipe_unlock(old);
 
             if (readers == 0) {
+                rusage_io(1, (uint64_t)done);
                 return (done > 0) ? (uint64_t)done : (uint64_t)RDNX_E_INVALID;
             }
             if (pushed) {
@@ -724,6 +743,7 @@ uint64_t unix_fs_write(uint64_t fd, uint64_t user_buf_ptr, uint64_t len)
             }
             scheduler_yield();
         }
+        rusage_io(1, (uint64_t)done);
         return (uint64_t)done;
     }
 
@@ -782,6 +802,50 @@ uint64_t unix_fs_ftruncate(uint64_t fd, uint64_t size)
     return (uint64_t)vfs_ftruncate(file, size);
 }
 
+uint64_t unix_fs_fsync(uint64_t fd, uint64_t data_only)
+{
+    task_t* task = task_get_current();
+    vfs_file_t* file;
+
+    if (!task) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if ((int)fd < 0 || (int)fd >= TASK_MAX_FD || task->fd_kind[(int)fd] != UNIX_FD_KIND_VFS) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    file = (vfs_file_t*)task_fd_get(task, (int)fd);
+    if (!file) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    return (uint64_t)vfs_fsync(file, data_only != 0);
+}
+
+uint64_t unix_fs_sync(void)
+{
+    return (uint64_t)vfs_sync();
+}
+
+uint64_t unix_fs_fallocate(uint64_t fd, uint64_t mode, uint64_t off, uint64_t len)
+{
+    task_t* task = task_get_current();
+    vfs_file_t* file;
+
+    if (!task) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if ((int)fd < 0 || (int)fd >= TASK_MAX_FD || task->fd_kind[(int)fd] != UNIX_FD_KIND_VFS) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if ((int64_t)off < 0 || (int64_t)len <= 0) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    file = (vfs_file_t*)task_fd_get(task, (int)fd);
+    if (!file) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    return (uint64_t)vfs_fallocate(file, (int)mode, off, len);
+}
+
 uint64_t unix_fs_chdir(uint64_t user_path_ptr)
 {
     task_t* task = task_get_current();
@@ -874,6 +938,31 @@ uint64_t unix_fs_rename(uint64_t user_old_path_ptr, uint64_t user_new_path_ptr)
     return (uint64_t)vfs_rename(old_path, new_path);
 }
 
+static uint64_t unix_blk_ioctl(task_t* task, vfs_file_t* file, uint64_t request, uint64_t user_arg_ptr)
+{
+    fabric_blockdev_t* bdev = file->bdev;
+    if (!bdev) {
+        return (uint64_t)RDNX_E_NOTFOUND;
+    }
+    switch ((uint32_t)request) {
+        case UNIX_BLK_IOCTL_RRPART:
+            if (task->euid != 0) {
+                return (uint64_t)RDNX_E_DENIED;
+            }
+            return (uint64_t)(int64_t)fabric_blockdev_rescan_partitions(bdev);
+        case UNIX_BLK_IOCTL_GETSIZE64: {
+            uint64_t* out = (uint64_t*)(uintptr_t)user_arg_ptr;
+            if (!out || !unix_user_range_ok(out, sizeof(*out))) {
+                return (uint64_t)RDNX_E_INVALID;
+            }
+            *out = bdev->sector_count * (uint64_t)bdev->sector_size;
+            return (uint64_t)RDNX_OK;
+        }
+        default:
+            return (uint64_t)RDNX_E_UNSUPPORTED;
+    }
+}
+
 uint64_t unix_fs_ioctl(uint64_t fd, uint64_t request, uint64_t user_arg_ptr)
 {
     task_t* task = task_get_current();
@@ -885,6 +974,9 @@ uint64_t unix_fs_ioctl(uint64_t fd, uint64_t request, uint64_t user_arg_ptr)
     if (!file || !file->node || !file->node->inode) {
         return (uint64_t)RDNX_E_INVALID;
     }
+    if (file->node->inode->flags & VFS_INODE_BLOCKDEV) {
+        return unix_blk_ioctl(task, file, request, user_arg_ptr);
+    }
     if ((file->node->inode->flags & VFS_INODE_CONSOLE) == 0) {
         return (uint64_t)RDNX_E_UNSUPPORTED;
     }
@@ -1439,3 +1531,30 @@ uint64_t unix_fs_recvfrom(uint64_t fd,
     }
     return (uint64_t)rc;
 }
+
+uint64_t unix_fs_setsockopt(uint64_t fd,
+                            uint64_t level,
+                            uint64_t optname,
+                            uint64_t user_optval_ptr,
+                            uint64_t optlen)
+{
+    task_t* task = task_get_current();
+    int fdi = (int)fd;
+    const void* optval = (const void*)(uintptr_t)user_optval_ptr;
+    uint8_t kval[16];
+    if (!task || fdi < 0 || fdi >= TASK_MAX_FD || task->fd_kind[fdi] != UNIX_FD_KIND_SOCKET) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (!optval || optlen == 0 || optlen > sizeof(kval) || !unix_user_range_ok(optval, (size_t)optlen)) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (!unix_user_io_range_mapped(task, optval, (size_t)optlen, false)) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    net_socket_t* sock = (net_socket_t*)task_fd_get(task, fdi);
+    if (!sock) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    memcpy(kval, optval, (size_t)optlen);
+    return (uint64_t)(int64_t)net_socket_setsockopt(sock, (int)level, (int)optname, kval, (size_t)optlen);
+}
@@ -0,0 +1,467 @@
+#include "../unix_layer.h"
+#include "../../common/scheduler.h"
+#include "../../common/waitq.h"
+#include "../../fabric/spin.h"
+#include "../../core/task.h"
+#include "../../../include/common.h"
+#include "../../../include/error.h"
+
+/*
+ * futex(2): FUTEX_WAIT/FUTEX_WAKE и PI-futex.
+ *
+ * Ключ — пользовательский адрес слова, у каждого слота своя waitq.
+ * WAIT блокирует поток на waitq слота (проверка слова и постановка в
+ * очередь — под unix_futex_lock, поэтому WAKE между ними не теряется);
+ * WAKE будит до n ожидающих, начиная с самого приоритетного.
+ *
+ * PI-futex (FUTEX_LOCK_PI/UNLOCK_PI/TRYLOCK_PI, раскладка слова как в
+ * Linux): 0 — свободен, иначе TID владельца (у нас pid) и флаг
+ * FUTEX_WAITERS. Ожидающий поднимает владельца до своего уровня через
+ * scheduler_pi_set(), по цепочке pi_blocked_on не глубже
+ * UNIX_FUTEX_PI_DEPTH; UNLOCK_PI передаёт слово самому приоритетному
+ * ожидающему и пересчитывает унаследованный уровень бывшего владельца.
+ */
+
+enum {
+    UNIX_FUTEX_WAIT = 0,
+    UNIX_FUTEX_WAKE = 1,
+    UNIX_FUTEX_LOCK_PI = 6,
+    UNIX_FUTEX_UNLOCK_PI = 7,
+    UNIX_FUTEX_TRYLOCK_PI = 8,
+    UNIX_FUTEX_MAX_SLOTS = 64,
+    UNIX_FUTEX_PI_DEPTH = 8
+};
+
+#define UNIX_FUTEX_WAITERS    0x80000000u
+#define UNIX_FUTEX_OWNER_DIED 0x40000000u
+#define UNIX_FUTEX_TID_MASK   0x3fffffffu
+
+typedef struct unix_futex_timespec {
+    int64_t tv_sec;
+    int64_t tv_nsec;
+} unix_futex_timespec_t;
+
+typedef struct unix_futex_slot {
+    uintptr_t addr;
+    uint32_t pi;        /* слот PI-futex */
+    uint32_t owner;     /* PI: TID владельца, пока есть ожидающие */
+    waitq_t q;
+} unix_futex_slot_t;
+
+static spinlock_t unix_futex_lock;
+static bool unix_futex_lock_inited = false;
+static unix_futex_slot_t unix_futex_slots[UNIX_FUTEX_MAX_SLOTS];
+
+static void unix_futex_init_once(void)
+{
+    if (!unix_futex_lock_inited) {
+        spinlock_init(&unix_futex_lock);
+        for (int i = 0; i < UNIX_FUTEX_MAX_SLOTS; i++) {
+            waitq_init(&unix_futex_slots[i].q, "futex");
+        }
+        unix_futex_lock_inited = true;
+    }
+}
+
+static unix_futex_slot_t* unix_futex_find_slot(uintptr_t addr)
+{
+    for (int i = 0; i < UNIX_FUTEX_MAX_SLOTS; i++) {
+        if (unix_futex_slots[i].addr == addr) {
+            return &unix_futex_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static unix_futex_slot_t* unix_futex_get_slot(uintptr_t addr, bool pi)
+{
+    unix_futex_slot_t* slot = unix_futex_find_slot(addr);
+    if (slot) {
+        return slot->pi == (uint32_t)pi ? slot : NULL;
+    }
+    for (int i = 0; i < UNIX_FUTEX_MAX_SLOTS; i++) {
+        if (unix_futex_slots[i].addr == 0) {
+            unix_futex_slots[i].addr = addr;
+            unix_futex_slots[i].pi = pi ? 1u : 0u;
+            unix_futex_slots[i].owner = 0;
+            return &unix_futex_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static void unix_futex_put_slot(unix_futex_slot_t* slot)
+{
+    if (slot && waitq_count(&slot->q) == 0) {
+        slot->addr = 0;
+        slot->pi = 0;
+        slot->owner = 0;
+    }
+}
+
+/* Первый из ожидающих с наибольшим уровнем планировщика. */
+static thread_t* unix_futex_top_waiter(waitq_t* q)
+{
+    thread_t* top = NULL;
+    int top_level = -1;
+    thread_t* it;
+    TAILQ_FOREACH(it, &q->threads, wait_link) {
+        int level = scheduler_pi_level(it);
+        if (level > top_level) {
+            top = it;
+            top_level = level;
+        }
+    }
+    return top;
+}
+
+static uint64_t unix_futex_deadline(uint64_t user_timeout_ptr, int64_t* timeout_ms, uint64_t* deadline)
+{
+    *timeout_ms = -1;
+    *deadline = 0;
+    if (user_timeout_ptr == 0) {
+        return (uint64_t)RDNX_OK;
+    }
+    const unix_futex_timespec_t* ts = (const unix_futex_timespec_t*)(uintptr_t)user_timeout_ptr;
+    if (!unix_user_range_ok(ts, sizeof(*ts))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000LL) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    uint64_t ms_from_sec = (uint64_t)ts->tv_sec * 1000ULL;
+    uint64_t ms_from_nsec = (uint64_t)ts->tv_nsec / 1000000ULL;
+    *timeout_ms = (int64_t)(ms_from_sec + ms_from_nsec);
+    if ((ts->tv_nsec % 1000000LL) != 0) {
+        (*timeout_ms)++;
+    }
+    if (*timeout_ms > 0) {
+        uint64_t ticks = ((uint64_t)*timeout_ms + (SCHEDULER_TIME_SLICE_MS - 1u)) / SCHEDULER_TIME_SLICE_MS;
+        *deadline = scheduler_get_ticks() + ticks;
+    }
+    return (uint64_t)RDNX_OK;
+}
+
+/* TID слова PI-futex — thread_id потока (gettid), а не pid процесса. */
+static uint32_t unix_futex_self_tid(void)
+{
+    thread_t* thread = thread_get_current();
+    return thread ? (uint32_t)thread->thread_id & UNIX_FUTEX_TID_MASK : 0;
+}
+
+/*
+ * Поток-владелец PI-futex по TID; NULL, если поток или его процесс уже
+ * завершился. *ref — ссылка на задачу владельца (или NULL), вызывающий
+ * отпускает её task_put(), закончив с потоком.
+ */
+static thread_t* unix_futex_owner_thread(uint32_t tid, task_t** ref)
+{
+    thread_t* thread = thread_find_by_id(tid, ref);
+    task_t* task = *ref;
+    if (!thread || task->state == TASK_STATE_ZOMBIE || task->state == TASK_STATE_DEAD) {
+        return NULL;
+    }
+    return thread;
+}
+
+/*
+ * Страница слова должна быть в памяти и доступна на запись до того, как
+ * мы возьмём спинлок: COW и подкачка под ним невозможны.
+ */
+static void unix_futex_prefault(volatile uint32_t* word)
+{
+    (void)__atomic_fetch_or(word, 0u, __ATOMIC_RELAXED);
+}
+
+/* Унаследованный уровень: максимум по ожидающим всех PI-futex владельца. */
+static void unix_futex_pi_recompute(thread_t* t)
+{
+    if (!t || !t->task) {
+        return;
+    }
+    uint32_t tid = (uint32_t)t->task->task_id & UNIX_FUTEX_TID_MASK;
+    int level = 0;
+    for (int i = 0; i < UNIX_FUTEX_MAX_SLOTS; i++) {
+        unix_futex_slot_t* slot = &unix_futex_slots[i];
+        if (slot->addr == 0 || !slot->pi || slot->owner != tid) {
+            continue;
+        }
+        thread_t* top = unix_futex_top_waiter(&slot->q);
+        int top_level = top ? scheduler_pi_level(top) : 0;
+        if (top_level > level) {
+            level = top_level;
+        }
+    }
+    scheduler_pi_set(t, level);
+}
+
+static void unix_futex_pi_propagate(uint32_t owner_tid)
+{
+    for (int depth = 0; owner_tid != 0 && depth < UNIX_FUTEX_PI_DEPTH; depth++) {
+        task_t* ref = NULL;
+        thread_t* t = unix_futex_owner_thread(owner_tid, &ref);
+        unix_futex_slot_t* slot = NULL;
+        if (t) {
+            unix_futex_pi_recompute(t);
+            slot = (unix_futex_slot_t*)t->rt.pi_blocked_on;
+        }
+        task_put(ref);
+        owner_tid = slot ? slot->owner : 0;
+    }
+}
+
+static uint64_t unix_futex_wait(volatile uint32_t* uaddr, uint32_t expected, uint64_t user_timeout_ptr)
+{
+    int64_t timeout_ms;
+    uint64_t deadline;
+    uint64_t rc = unix_futex_deadline(user_timeout_ptr, &timeout_ms, &deadline);
+    if (rc != (uint64_t)RDNX_OK) {
+        return rc;
+    }
+    thread_t* self = thread_get_current();
+    if (!self) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+
+    (void)*uaddr;
+    irql_t old = spinlock_lock_irqsave(&unix_futex_lock);
+    if (*uaddr != expected) {
+        spinlock_unlock_irqrestore(&unix_futex_lock, old);
+        return (uint64_t)RDNX_E_BUSY;
+    }
+    if (timeout_ms == 0) {
+        spinlock_unlock_irqrestore(&unix_futex_lock, old);
+        return (uint64_t)RDNX_E_TIMEOUT;
+    }
+    unix_futex_slot_t* slot = unix_futex_get_slot((uintptr_t)uaddr, false);
+    if (!slot) {
+        spinlock_unlock_irqrestore(&unix_futex_lock, old);
+        return (uint64_t)RDNX_E_BUSY;
+    }
+    waitq_enqueue(&slot->q, self);
+    spinlock_unlock_irqrestore(&unix_futex_lock, old);
+
+    int wrc = waitq_wait_until(&slot->q, deadline);
+
+    old = spinlock_lock_irqsave(&unix_futex_lock);
+    if (waitq_contains(&slot->q, self)) {
+        waitq_remove(&slot->q, self);
+    }
+    unix_futex_put_slot(slot);
+    spinlock_unlock_irqrestore(&unix_futex_lock, old);
+    return wrc == RDNX_E_TIMEOUT ? (uint64_t)RDNX_E_TIMEOUT : (uint64_t)RDNX_OK;
+}
+
+static uint64_t unix_futex_wake(uintptr_t addr, uint32_t wake_n)
+{
+    if (wake_n == 0) {
+        return 0;
+    }
+    uint32_t woke = 0;
+    irql_t old = spinlock_lock_irqsave(&unix_futex_lock);
+    unix_futex_slot_t* slot = unix_futex_find_slot(addr);
+    if (slot && !slot->pi) {
+        while (woke < wake_n) {
+            thread_t* t = unix_futex_top_waiter(&slot->q);
+            if (!t) {
+                break;
+            }
+            waitq_remove(&slot->q, t);
+            scheduler_wake(t);
+            woke++;
+        }
+        unix_futex_put_slot(slot);
+    }
+    spinlock_unlock_irqrestore(&unix_futex_lock, old);
+    return (uint64_t)woke;
+}
+
+/*
+ * Захват свободного (или оставшегося от завершившегося процесса) слова
+ * под unix_futex_lock. RDNX_E_BUSY — слово занято живым владельцем.
+ */
+static int unix_futex_pi_take(volatile uint32_t* uaddr, uint32_t self_tid, unix_futex_slot_t* slot)
+{
+    uint32_t v = __atomic_load_n(uaddr, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t owner = v & UNIX_FUTEX_TID_MASK;
+        if (owner == self_tid) {
+            return RDNX_E_INVALID;
+        }
+        if (owner != 0) {
+            task_t* ref = NULL;
+            bool alive = unix_futex_owner_thread(owner, &ref) != NULL;
+            task_put(ref);
+            if (alive) {
+                return RDNX_E_BUSY;
+            }
+        }
+        uint32_t nv = self_tid;
+        if (slot && waitq_count(&slot->q) > 0) {
+            nv |= UNIX_FUTEX_WAITERS;
+        }
+        if (owner != 0) {
+            nv |= UNIX_FUTEX_OWNER_DIED;
+        }
+        if (__atomic_compare_exchange_n(uaddr, &v, nv, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            if (slot) {
+                slot->owner = self_tid;
+            }
+            return RDNX_OK;
+        }
+    }
+}
+
+static uint64_t unix_futex_lock_pi(volatile uint32_t* uaddr, uint64_t user_timeout_ptr, bool try_only)
+{
+    int64_t timeout_ms;
+    uint64_t deadline;
+    uint64_t rc = unix_futex_deadline(user_timeout_ptr, &timeout_ms, &deadline);
+    if (rc != (uint64_t)RDNX_OK) {
+        return rc;
+    }
+    thread_t* self = thread_get_current();
+    uint32_t self_tid = unix_futex_self_tid();
+    if (!self || self_tid == 0) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+
+    for (;;) {
+        unix_futex_prefault(uaddr);
+        irql_t old = spinlock_lock_irqsave(&unix_futex_lock);
+        unix_futex_slot_t* slot = unix_futex_find_slot((uintptr_t)uaddr);
+        if (slot && !slot->pi) {
+            spinlock_unlock_irqrestore(&unix_futex_lock, old);
+            return (uint64_t)RDNX_E_INVALID;
+        }
+        int take = unix_futex_pi_take(uaddr, self_tid, slot);
+        if (take != RDNX_E_BUSY) {
+            if (take == RDNX_OK) {
+                unix_futex_pi_recompute(self);
+            }
+            spinlock_unlock_irqrestore(&unix_futex_lock, old);
+            return (uint64_t)take;
+        }
+        if (try_only || timeout_ms == 0) {
+            spinlock_unlock_irqrestore(&unix_futex_lock, old);
+            return try_only ? (uint64_t)RDNX_E_BUSY : (uint64_t)RDNX_E_TIMEOUT;
+        }
+
+        uint32_t v = __atomic_load_n(uaddr, __ATOMIC_ACQUIRE);
+        if (!(v & UNIX_FUTEX_WAITERS) &&
+            !__atomic_compare_exchange_n(uaddr, &v, v | UNIX_FUTEX_WAITERS, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            spinlock_unlock_irqrestore(&unix_futex_lock, old);
+            continue;
+        }
+        slot = unix_futex_get_slot((uintptr_t)uaddr, true);
+        if (!slot) {
+            spinlock_unlock_irqrestore(&unix_futex_lock, old);
+            return (uint64_t)RDNX_E_BUSY;
+        }
+        uint32_t owner_tid = v & UNIX_FUTEX_TID_MASK;
+        slot->owner = owner_tid;
+        waitq_enqueue(&slot->q, self);
+        self->rt.pi_blocked_on = slot;
+        unix_futex_pi_propagate(owner_tid);
+        spinlock_unlock_irqrestore(&unix_futex_lock, old);
+
+        int wrc = waitq_wait_until(&slot->q, deadline);
+
+        old = spinlock_lock_irqsave(&unix_futex_lock);
+        self->rt.pi_blocked_on = NULL;
+        if ((__atomic_load_n(uaddr, __ATOMIC_ACQUIRE) & UNIX_FUTEX_TID_MASK) == self_tid) {
+            /* UNLOCK_PI передал слово нам. */
+            spinlock_unlock_irqrestore(&unix_futex_lock, old);
+            return (uint64_t)RDNX_OK;
+        }
+        if (waitq_contains(&slot->q, self)) {
+            waitq_remove(&slot->q, self);
+        }
+        if (slot->owner != 0) {
+            unix_futex_pi_propagate(slot->owner);
+        }
+        unix_futex_put_slot(slot);
+        spinlock_unlock_irqrestore(&unix_futex_lock, old);
+        if (wrc == RDNX_E_TIMEOUT) {
+            return (uint64_t)RDNX_E_TIMEOUT;
+        }
+    }
+}
+
+static uint64_t unix_futex_unlock_pi(volatile uint32_t* uaddr)
+{
+    thread_t* self = thread_get_current();
+    uint32_t self_tid = unix_futex_self_tid();
+    if (!self || self_tid == 0) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+
+    unix_futex_prefault(uaddr);
+    irql_t old = spinlock_lock_irqsave(&unix_futex_lock);
+    uint32_t v = __atomic_load_n(uaddr, __ATOMIC_ACQUIRE);
+    if ((v & UNIX_FUTEX_TID_MASK) != self_tid) {
+        spinlock_unlock_irqrestore(&unix_futex_lock, old);
+        return (uint64_t)RDNX_E_DENIED;
+    }
+    unix_futex_slot_t* slot = unix_futex_find_slot((uintptr_t)uaddr);
+    if (slot && !slot->pi) {
+        spinlock_unlock_irqrestore(&unix_futex_lock, old);
+        return (uint64_t)RDNX_E_INVALID;
+    }
+
+    thread_t* next = slot ? unix_futex_top_waiter(&slot->q) : NULL;
+    if (next && next->task) {
+        uint32_t next_tid = (uint32_t)next->task->task_id & UNIX_FUTEX_TID_MASK;
+        waitq_remove(&slot->q, next);
+        next->rt.pi_blocked_on = NULL;
+        uint32_t nv = next_tid;
+        if (waitq_count(&slot->q) > 0) {
+            nv |= UNIX_FUTEX_WAITERS;
+        }
+        __atomic_store_n(uaddr, nv, __ATOMIC_RELEASE);
+        slot->owner = next_tid;
+        unix_futex_pi_recompute(next);
+        unix_futex_put_slot(slot);
+        scheduler_wake(next);
+    } else {
+        __atomic_store_n(uaddr, 0u, __ATOMIC_RELEASE);
+        unix_futex_put_slot(slot);
+    }
+    /* Унаследованный от этого futex уровень больше не нужен. */
+    unix_futex_pi_recompute(self);
+    spinlock_unlock_irqrestore(&unix_futex_lock, old);
+    return (uint64_t)RDNX_OK;
+}
+
+uint64_t unix_proc_futex(uint64_t user_uaddr_ptr,
+                         uint64_t op,
+                         uint64_t val,
+                         uint64_t user_timeout_ptr,
+                         uint64_t user_uaddr2_ptr,
+                         uint64_t val3)
+{
+    (void)user_uaddr2_ptr;
+    (void)val3;
+
+    volatile uint32_t* uaddr = (volatile uint32_t*)(uintptr_t)user_uaddr_ptr;
+    if (!uaddr || ((uintptr_t)uaddr & 3u) != 0 || !unix_user_range_ok((const void*)uaddr, sizeof(*uaddr))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    unix_futex_init_once();
+
+    switch ((uint32_t)op) {
+    case UNIX_FUTEX_WAIT:
+        return unix_futex_wait(uaddr, (uint32_t)val, user_timeout_ptr);
+    case UNIX_FUTEX_WAKE:
+        return unix_futex_wake((uintptr_t)uaddr, (uint32_t)val);
+    case UNIX_FUTEX_LOCK_PI:
+        return unix_futex_lock_pi(uaddr, user_timeout_ptr, false);
+    case UNIX_FUTEX_TRYLOCK_PI:
+        return unix_futex_lock_pi(uaddr, 0, true);
+    case UNIX_FUTEX_UNLOCK_PI:
+        return unix_futex_unlock_pi(uaddr);
+    default:
+        return (uint64_t)RDNX_E_UNSUPPORTED;
+    }
+}
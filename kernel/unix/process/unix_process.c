@@ -1,6 +1,9 @@
 #include "../unix_layer.h"
 #include "../../common/bootlog.h"
 #include "../../common/scheduler.h"
+#include "../../common/rusage.h"
+#include "../../common/cgroup.h"
+#include "../../common/security.h"
 #include "../../fabric/spin.h"
 #include "../../core/interrupts.h"
 #include "../../arch/interrupt_frame.h"
@@ -22,6 +25,47 @@ typedef struct unix_sigaction_u {
     uint64_t sa_mask;
 } unix_sigaction_u_t;
 
+/* struct rusage as laid out by both Linux and FreeBSD on LP64. */
+typedef struct unix_rusage_u {
+    int64_t utime_sec;
+    int64_t utime_usec;
+    int64_t stime_sec;
+    int64_t stime_usec;
+    int64_t maxrss;   /* KiB */
+    int64_t ixrss;
+    int64_t idrss;
+    int64_t isrss;
+    int64_t minflt;
+    int64_t majflt;
+    int64_t nswap;
+    int64_t inblock;  /* 512-byte units of read() traffic */
+    int64_t oublock;  /* 512-byte units of write() traffic */
+    int64_t msgsnd;
+    int64_t msgrcv;
+    int64_t nsignals;
+    int64_t nvcsw;
+    int64_t nivcsw;
+} unix_rusage_u_t;
+
+typedef struct unix_rlimit_u {
+    uint64_t rlim_cur;
+    uint64_t rlim_max;
+} unix_rlimit_u_t;
+
+/* struct sched_attr (Linux, SCHED_ATTR_SIZE_VER0). */
+typedef struct unix_sched_attr_u {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+} unix_sched_attr_u_t;
+
+_Static_assert(sizeof(unix_sched_attr_u_t) == 48, "sched_attr layout");
+
 enum {
     UNIX_SIG_DFL = 0,
     UNIX_SIG_IGN = 1,
@@ -29,53 +73,6 @@ enum {
     UNIX_SIGKILL = 9
 };
 
-enum {
-    UNIX_FUTEX_WAIT = 0,
-    UNIX_FUTEX_WAKE = 1,
-    UNIX_FUTEX_MAX_SLOTS = 64
-};
-
-typedef struct unix_futex_slot {
-    uintptr_t addr;
-    uint32_t waiters;
-    uint32_t gen;
-} unix_futex_slot_t;
-
-static spinlock_t unix_futex_lock;
-static bool unix_futex_lock_inited = false;
-static unix_futex_slot_t unix_futex_slots[UNIX_FUTEX_MAX_SLOTS];
-
-static void unix_futex_init_once(void)
-{
-    if (!unix_futex_lock_inited) {
-        spinlock_init(&unix_futex_lock);
-        unix_futex_lock_inited = true;
-    }
-}
-
-static int unix_futex_find_slot(uintptr_t addr)
-{
-    for (int i = 0; i < UNIX_FUTEX_MAX_SLOTS; i++) {
-        if (unix_futex_slots[i].addr == addr) {
-            return i;
-        }
-    }
-    return -1;
-}
-
-static int unix_futex_alloc_slot(uintptr_t addr)
-{
-    for (int i = 0; i < UNIX_FUTEX_MAX_SLOTS; i++) {
-        if (unix_futex_slots[i].addr == 0) {
-            unix_futex_slots[i].addr = addr;
-            unix_futex_slots[i].waiters = 0;
-            unix_futex_slots[i].gen = 1;
-            return i;
-        }
-    }
-    return -1;
-}
-
 static int unix_frame_on_thread_stack(const thread_t* t, const interrupt_frame_t* frame)
 {
     if (!t || !t->stack || t->stack_size < sizeof(interrupt_frame_t) || !frame) {
@@ -251,18 +248,19 @@ uint64_t unix_proc_kill(uint64_t pid, uint64_t signum)
     if (!target) {
         return (uint64_t)RDNX_E_NOTFOUND;
     }
-    if (!unix_signal_may_send(self, target)) {
-        return (uint64_t)RDNX_E_DENIED;
-    }
-    if (sig == 0) {
-        return (uint64_t)RDNX_OK;
+    uint64_t rc = (uint64_t)RDNX_OK;
+    if (target->state == TASK_STATE_DEAD) {
+        rc = (uint64_t)RDNX_E_NOTFOUND;
+    } else if (!unix_signal_may_send(self, target)) {
+        rc = (uint64_t)RDNX_E_DENIED;
+    } else if (sig != 0) {
+        target->sig_pending = (uint32_t)sig;
     }
-
-    target->sig_pending = (uint32_t)sig;
-    if (target == self) {
+    task_put(target);
+    if (rc == (uint64_t)RDNX_OK && sig != 0 && target == self) {
         unix_proc_signal_checkpoint();
     }
-    return (uint64_t)RDNX_OK;
+    return rc;
 }
 
 uint64_t unix_proc_sigaction(uint64_t signum, uint64_t user_act_ptr, uint64_t user_oldact_ptr)
@@ -327,6 +325,7 @@ uint64_t unix_proc_waitpid(uint64_t pid, uint64_t user_status_ptr)
         return (uint64_t)RDNX_E_NOTFOUND;
     }
     if (child->parent_task_id != self->task_id) {
+        task_put(child);
         return (uint64_t)RDNX_E_DENIED;
     }
 
@@ -334,9 +333,11 @@ uint64_t unix_proc_waitpid(uint64_t pid, uint64_t user_status_ptr)
                         (child->state == TASK_STATE_ZOMBIE) ||
                         (child->state == TASK_STATE_DEAD);
     if (!child_exited) {
+        task_put(child);
         return (uint64_t)RDNX_E_BUSY;
     }
     if (child->waited) {
+        task_put(child);
         return (uint64_t)RDNX_E_NOTFOUND;
     }
 
@@ -344,14 +345,25 @@ uint64_t unix_proc_waitpid(uint64_t pid, uint64_t user_status_ptr)
     if (user_status) {
         *user_status = child->exit_code;
     }
+    rusage_reap_child(self, child);
     bool destroy_now = (child->thread_count == 0);
     if (destroy_now) {
         child->state = TASK_STATE_DEAD;
         task_destroy(child);
     }
+    task_put(child);
     return pid;
 }
 
+bool unix_proc_nproc_ok(const task_t* parent)
+{
+    uint64_t limit = rusage_rlimit_cur(parent, TASK_RLIMIT_NPROC);
+    if (!parent || parent->euid == 0 || limit == TASK_RLIM_INFINITY) {
+        return true;
+    }
+    return (uint64_t)task_count_by_uid(parent->uid) < limit;
+}
+
 uint64_t unix_proc_fork(void)
 {
     task_t* parent = task_get_current();
@@ -367,6 +379,9 @@ uint64_t unix_proc_fork(void)
         return (uint64_t)RDNX_E_GENERIC;
     }
 
+    if (!unix_proc_nproc_ok(parent)) {
+        return (uint64_t)RDNX_E_BUSY;
+    }
     task_t* child = task_create();
     if (!child) {
         return (uint64_t)RDNX_E_NOMEM;
@@ -374,6 +389,8 @@ uint64_t unix_proc_fork(void)
     child->state = TASK_STATE_READY;
     child->parent_task_id = parent->task_id;
     task_set_ids(child, parent->uid, parent->gid, parent->euid, parent->egid);
+    rusage_task_inherit(child, parent);
+    cgroup_task_inherit(child, parent);
     task_set_abi(child, task_get_abi(parent));
     child->tls_fs_base = parent->tls_fs_base;
     child->umask = parent->umask;
@@ -408,6 +425,200 @@ uint64_t unix_proc_fork(void)
     return (uint64_t)child->task_id;
 }
 
+uint64_t unix_proc_getrusage(uint64_t who, uint64_t user_ru_ptr)
+{
+    task_t* task = task_get_current();
+    thread_t* thr = thread_get_current();
+    unix_rusage_u_t* out = (unix_rusage_u_t*)(uintptr_t)user_ru_ptr;
+    if (!task || !thr || !out || !unix_user_range_ok(out, sizeof(*out))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+
+    task_rusage_t ru;
+    switch ((int)who) {
+        case RUSAGE_WHO_SELF:
+            rusage_task_sum(task, &ru);
+            break;
+        case RUSAGE_WHO_CHILDREN:
+            ru = task->ru_children;
+            break;
+        case RUSAGE_WHO_THREAD:
+            ru = thr->ru;
+            ru.maxrss_pages = task->maxrss_pages;
+            break;
+        default:
+            return (uint64_t)RDNX_E_INVALID;
+    }
+
+    uint64_t uns = rusage_cycles_to_ns(ru.utime_cycles);
+    uint64_t sns = rusage_cycles_to_ns(ru.stime_cycles);
+    unix_rusage_u_t r;
+    memset(&r, 0, sizeof(r));
+    r.utime_sec = (int64_t)(uns / 1000000000ULL);
+    r.utime_usec = (int64_t)((uns % 1000000000ULL) / 1000ULL);
+    r.stime_sec = (int64_t)(sns / 1000000000ULL);
+    r.stime_usec = (int64_t)((sns % 1000000000ULL) / 1000ULL);
+    r.maxrss = (int64_t)(ru.maxrss_pages * (VM_PAGE_SIZE / 1024u));
+    r.minflt = (int64_t)ru.minflt;
+    r.majflt = (int64_t)ru.majflt;
+    r.inblock = (int64_t)(ru.read_bytes / 512u);
+    r.oublock = (int64_t)(ru.write_bytes / 512u);
+    r.nvcsw = (int64_t)ru.nvcsw;
+    r.nivcsw = (int64_t)ru.nivcsw;
+    *out = r;
+    return (uint64_t)RDNX_OK;
+}
+
+uint64_t unix_proc_getrlimit(uint64_t resource, uint64_t user_rlim_ptr)
+{
+    task_t* task = task_get_current();
+    unix_rlimit_u_t* out = (unix_rlimit_u_t*)(uintptr_t)user_rlim_ptr;
+    if (!task || !out || !unix_user_range_ok(out, sizeof(*out))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    task_rlimit_t lim;
+    int rc = rusage_getrlimit(task, (int)resource, &lim);
+    if (rc != RDNX_OK) {
+        return (uint64_t)rc;
+    }
+    out->rlim_cur = lim.cur;
+    out->rlim_max = lim.max;
+    return (uint64_t)RDNX_OK;
+}
+
+uint64_t unix_proc_setrlimit(uint64_t resource, uint64_t user_rlim_ptr)
+{
+    task_t* task = task_get_current();
+    const unix_rlimit_u_t* in = (const unix_rlimit_u_t*)(uintptr_t)user_rlim_ptr;
+    if (!task || !in || !unix_user_range_ok(in, sizeof(*in))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    task_rlimit_t lim;
+    lim.cur = in->rlim_cur;
+    lim.max = in->rlim_max;
+    return (uint64_t)rusage_setrlimit(task, (int)resource, &lim);
+}
+
+/*
+ * Поток, чьей политикой управляют: pid 0 — вызывающий. Менять чужую
+ * политику может владелец (тот же euid) или root. При успехе *ref держит
+ * ссылку на задачу потока; вызывающий отпускает её task_put().
+ */
+static thread_t* unix_sched_target(uint64_t pid, bool modify, uint64_t* err, task_t** ref)
+{
+    task_t* self = task_get_current();
+    task_t* task = (pid == 0 || (self && pid == self->task_id)) ? task_get(self) : task_find_by_id(pid);
+    *ref = NULL;
+    if (!task || task->state == TASK_STATE_ZOMBIE || task->state == TASK_STATE_DEAD || !task->main_thread) {
+        task_put(task);
+        *err = (uint64_t)RDNX_E_NOTFOUND;
+        return NULL;
+    }
+    if (modify && task != self && self && self->euid != 0 && self->euid != task->euid) {
+        task_put(task);
+        *err = (uint64_t)RDNX_E_DENIED;
+        return NULL;
+    }
+    *ref = task;
+    return task == self ? thread_get_current() : task->main_thread;
+}
+
+static uint64_t unix_sched_apply(uint64_t pid, const sched_params_t* p)
+{
+    uint64_t err = (uint64_t)RDNX_E_INVALID;
+    task_t* ref = NULL;
+    thread_t* t = unix_sched_target(pid, true, &err, &ref);
+    if (!t) {
+        return err;
+    }
+    uint64_t rc = (uint64_t)RDNX_E_DENIED;
+    if (p->policy == SCHED_OTHER || security_check_euid(0) == SEC_OK) {
+        rc = (uint64_t)(int64_t)scheduler_setattr(t, p);
+    }
+    task_put(ref);
+    return rc;
+}
+
+uint64_t unix_proc_sched_setscheduler(uint64_t pid, uint64_t policy, uint64_t user_param_ptr)
+{
+    const int32_t* prio = (const int32_t*)(uintptr_t)user_param_ptr;
+    if (!prio || !unix_user_range_ok(prio, sizeof(*prio))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    /* DEADLINE задаётся только через sched_setattr. */
+    if (policy == SCHED_DEADLINE || *prio < 0) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    sched_params_t p;
+    memset(&p, 0, sizeof(p));
+    p.policy = (uint32_t)policy;
+    p.priority = (uint32_t)*prio;
+    return unix_sched_apply(pid, &p);
+}
+
+uint64_t unix_proc_sched_getscheduler(uint64_t pid)
+{
+    uint64_t err = (uint64_t)RDNX_E_INVALID;
+    task_t* ref = NULL;
+    thread_t* t = unix_sched_target(pid, false, &err, &ref);
+    if (!t) {
+        return err;
+    }
+    sched_params_t p;
+    (void)scheduler_getattr(t, &p);
+    task_put(ref);
+    return (uint64_t)p.policy;
+}
+
+uint64_t unix_proc_sched_setattr(uint64_t pid, uint64_t user_attr_ptr, uint64_t flags)
+{
+    const unix_sched_attr_u_t* in = (const unix_sched_attr_u_t*)(uintptr_t)user_attr_ptr;
+    if (!in || flags != 0 || !unix_user_range_ok(in, sizeof(*in))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    if (in->size != 0 && in->size < sizeof(*in)) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    /* sched_flags (reset-on-fork и пр.) и nice для SCHED_OTHER не поддерживаются. */
+    if (in->sched_flags != 0) {
+        return (uint64_t)RDNX_E_UNSUPPORTED;
+    }
+    sched_params_t p;
+    p.policy = in->sched_policy;
+    p.priority = in->sched_priority;
+    p.runtime_ns = in->sched_runtime;
+    p.deadline_ns = in->sched_deadline;
+    p.period_ns = in->sched_period;
+    return unix_sched_apply(pid, &p);
+}
+
+uint64_t unix_proc_sched_getattr(uint64_t pid, uint64_t user_attr_ptr, uint64_t size, uint64_t flags)
+{
+    unix_sched_attr_u_t* out = (unix_sched_attr_u_t*)(uintptr_t)user_attr_ptr;
+    if (!out || flags != 0 || size < sizeof(*out) || !unix_user_range_ok(out, sizeof(*out))) {
+        return (uint64_t)RDNX_E_INVALID;
+    }
+    uint64_t err = (uint64_t)RDNX_E_INVALID;
+    task_t* ref = NULL;
+    thread_t* t = unix_sched_target(pid, false, &err, &ref);
+    if (!t) {
+        return err;
+    }
+    sched_params_t p;
+    (void)scheduler_getattr(t, &p);
+    task_put(ref);
+    unix_sched_attr_u_t a;
+    memset(&a, 0, sizeof(a));
+    a.size = (uint32_t)sizeof(a);
+    a.sched_policy = p.policy;
+    a.sched_priority = p.priority;
+    a.sched_runtime = p.runtime_ns;
+    a.sched_deadline = p.deadline_ns;
+    a.sched_period = p.period_ns;
+    *out = a;
+    return (uint64_t)RDNX_OK;
+}
+
 uint64_t unix_time_nanosleep(uint64_t user_req_ptr, uint64_t user_rem_ptr)
 {
     const unix_timespec_u_t* req = (const unix_timespec_u_t*)(uintptr_t)user_req_ptr;
@@ -442,121 +653,3 @@ uint64_t unix_time_nanosleep(uint64_t user_req_ptr, uint64_t user_rem_ptr)
     return (uint64_t)RDNX_OK;
 }
 
-uint64_t unix_proc_futex(uint64_t user_uaddr_ptr,
-                         uint64_t op,
-                         uint64_t val,
-                         uint64_t user_timeout_ptr,
-                         uint64_t user_uaddr2_ptr,
-                         uint64_t val3)
-{
-    (void)user_uaddr2_ptr;
-    (void)val3;
-
-    int32_t* uaddr = (int32_t*)(uintptr_t)user_uaddr_ptr;
-    if (!uaddr || !unix_user_range_ok(uaddr, sizeof(*uaddr))) {
-        return (uint64_t)RDNX_E_INVALID;
-    }
-    unix_futex_init_once();
-
-    if ((uint32_t)op == UNIX_FUTEX_WAIT) {
-        int32_t expected = (int32_t)val;
-        if (*uaddr != expected) {
-            return (uint64_t)RDNX_E_BUSY;
-        }
-
-        int64_t timeout_ms = -1;
-        if (user_timeout_ptr != 0) {
-            const unix_timespec_u_t* ts = (const unix_timespec_u_t*)(uintptr_t)user_timeout_ptr;
-            if (!unix_user_range_ok(ts, sizeof(*ts))) {
-                return (uint64_t)RDNX_E_INVALID;
-            }
-            if (ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000LL) {
-                return (uint64_t)RDNX_E_INVALID;
-            }
-            uint64_t ms_from_sec = (uint64_t)ts->tv_sec * 1000ULL;
-            uint64_t ms_from_nsec = (uint64_t)ts->tv_nsec / 1000000ULL;
-            timeout_ms = (int64_t)(ms_from_sec + ms_from_nsec);
-            if ((ts->tv_nsec % 1000000LL) != 0) {
-                timeout_ms++;
-            }
-        }
-
-        uint64_t deadline = 0;
-        if (timeout_ms >= 0) {
-            uint64_t now = scheduler_get_ticks();
-            uint64_t ticks = ((uint64_t)timeout_ms + (SCHEDULER_TIME_SLICE_MS - 1u)) / SCHEDULER_TIME_SLICE_MS;
-            deadline = now + ticks;
-        }
-
-        uint32_t wait_gen = 0;
-        int slot = -1;
-        spinlock_lock(&unix_futex_lock);
-        slot = unix_futex_find_slot((uintptr_t)uaddr);
-        if (slot < 0) {
-            slot = unix_futex_alloc_slot((uintptr_t)uaddr);
-        }
-        if (slot < 0) {
-            spinlock_unlock(&unix_futex_lock);
-            return (uint64_t)RDNX_E_BUSY;
-        }
-        unix_futex_slots[slot].waiters++;
-        wait_gen = unix_futex_slots[slot].gen;
-        spinlock_unlock(&unix_futex_lock);
-
-        uint64_t rc = (uint64_t)RDNX_OK;
-        for (;;) {
-            if (*uaddr != expected) {
-                rc = (uint64_t)RDNX_E_BUSY;
-                break;
-            }
-            spinlock_lock(&unix_futex_lock);
-            uint32_t cur_gen = unix_futex_slots[slot].gen;
-            spinlock_unlock(&unix_futex_lock);
-            if (cur_gen != wait_gen) {
-                rc = (uint64_t)RDNX_OK;
-                break;
-            }
-            if (timeout_ms == 0) {
-                rc = (uint64_t)RDNX_E_TIMEOUT;
-                break;
-            }
-            if (timeout_ms > 0 && scheduler_get_ticks() >= deadline) {
-                rc = (uint64_t)RDNX_E_TIMEOUT;
-                break;
-            }
-            scheduler_yield();
-        }
-
-        spinlock_lock(&unix_futex_lock);
-        if (slot >= 0 && slot < UNIX_FUTEX_MAX_SLOTS && unix_futex_slots[slot].waiters > 0) {
-            unix_futex_slots[slot].waiters--;
-            if (unix_futex_slots[slot].waiters == 0) {
-                unix_futex_slots[slot].addr = 0;
-                unix_futex_slots[slot].gen = 0;
-            }
-        }
-        spinlock_unlock(&unix_futex_lock);
-        return rc;
-    }
-
-    if ((uint32_t)op == UNIX_FUTEX_WAKE) {
-        uint32_t wake_n = (uint32_t)val;
-        if (wake_n == 0) {
-            return 0;
-        }
-        uint32_t ready = 0;
-        spinlock_lock(&unix_futex_lock);
-        int slot = unix_futex_find_slot((uintptr_t)uaddr);
-        if (slot >= 0) {
-            uint32_t waiters = unix_futex_slots[slot].waiters;
-            ready = (wake_n < waiters) ? wake_n : waiters;
-            if (waiters > 0) {
-                unix_futex_slots[slot].gen++;
-            }
-        }
-        spinlock_unlock(&unix_futex_lock);
-        return (uint64_t)ready;
-    }
-
-    return (uint64_t)RDNX_E_UNSUPPORTED;
-}
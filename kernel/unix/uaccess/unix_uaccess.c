@@ -1,5 +1,6 @@
 #include "../unix_layer.h"
 #include "../../arch/config.h"
+#include "../../../include/common.h"
 #include "../../../include/error.h"
 
 #define UNIX_USER_MIN_VA 0x1000ULL
@@ -25,6 +26,18 @@ bool unix_user_range_ok(const void* ptr, size_t len)
     return end <= ARCH_USER_CANON_MAX && end < ARCH_KERNEL_VIRT_BASE;
 }
 
+int unix_copy_to_user(void* user_dst, const void* src, size_t len)
+{
+    if (len == 0) {
+        return RDNX_OK;
+    }
+    if (!src || !unix_user_range_ok(user_dst, len)) {
+        return RDNX_E_INVALID;
+    }
+    memcpy(user_dst, src, len);
+    return RDNX_OK;
+}
+
 int unix_copy_user_cstr(char* dst, size_t dst_size, const char* user_src)
 {
     if (!dst || dst_size == 0 || !user_src) {
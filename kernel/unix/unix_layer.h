@@ -30,6 +30,7 @@ enum {
 
 bool unix_user_range_ok(const void* ptr, size_t len);
 int unix_copy_user_cstr(char* dst, size_t dst_size, const char* user_src);
+int unix_copy_to_user(void* user_dst, const void* src, size_t len);
 int unix_resolve_path(const task_t* task, const char* in, char* out, size_t out_sz);
 int unix_resolve_user_path(const char* user_src, char* out, size_t out_sz);
 
@@ -62,6 +63,9 @@ uint64_t unix_fs_write(uint64_t fd, uint64_t user_buf_ptr, uint64_t len);
 uint64_t unix_fs_lseek(uint64_t fd, uint64_t off, uint64_t whence);
 uint64_t unix_fs_truncate(uint64_t user_path_ptr, uint64_t size);
 uint64_t unix_fs_ftruncate(uint64_t fd, uint64_t size);
+uint64_t unix_fs_fsync(uint64_t fd, uint64_t data_only);
+uint64_t unix_fs_sync(void);
+uint64_t unix_fs_fallocate(uint64_t fd, uint64_t mode, uint64_t off, uint64_t len);
 uint64_t unix_fs_chdir(uint64_t user_path_ptr);
 uint64_t unix_fs_getcwd(uint64_t user_buf_ptr, uint64_t size);
 uint64_t unix_fs_mkdir(uint64_t user_path_ptr);
@@ -89,6 +93,11 @@ uint64_t unix_fs_recvfrom(uint64_t fd,
                           uint64_t flags,
                           uint64_t user_src_addr_ptr,
                           uint64_t timeout_ms);
+uint64_t unix_fs_setsockopt(uint64_t fd,
+                            uint64_t level,
+                            uint64_t optname,
+                            uint64_t user_optval_ptr,
+                            uint64_t optlen);
 uint64_t unix_fs_poll(uint64_t user_fds_ptr, uint64_t nfds, int64_t timeout_ms);
 uint64_t unix_fs_select(uint64_t nfds,
                         uint64_t user_readfds_ptr,
@@ -117,6 +126,17 @@ void unix_proc_signal_checkpoint(void);
 /* CT-004/CT-005/CT-006 */
 uint64_t unix_proc_waitpid(uint64_t pid, uint64_t user_status_ptr);
 uint64_t unix_time_nanosleep(uint64_t user_req_ptr, uint64_t user_rem_ptr);
+/* Resource accounting and limits (kernel/common/rusage.c) */
+uint64_t unix_proc_getrusage(uint64_t who, uint64_t user_ru_ptr);
+uint64_t unix_proc_getrlimit(uint64_t resource, uint64_t user_rlim_ptr);
+uint64_t unix_proc_setrlimit(uint64_t resource, uint64_t user_rlim_ptr);
+/* Real-time scheduling classes (kernel/common/scheduler/rt.c) */
+uint64_t unix_proc_sched_setscheduler(uint64_t pid, uint64_t policy, uint64_t user_param_ptr);
+uint64_t unix_proc_sched_getscheduler(uint64_t pid);
+uint64_t unix_proc_sched_setattr(uint64_t pid, uint64_t user_attr_ptr, uint64_t flags);
+uint64_t unix_proc_sched_getattr(uint64_t pid, uint64_t user_attr_ptr, uint64_t size, uint64_t flags);
+/* RLIMIT_NPROC gate for fork/spawn (root is exempt). */
+bool unix_proc_nproc_ok(const task_t* parent);
 void unix_proc_notify_waiters(uint64_t parent_task_id);
 void unix_proc_close_fds(task_t* task);
 
@@ -4,6 +4,8 @@
 #include "vm_page_ref.h"
 #include "../arch/paging.h"
 #include "../arch/config.h"
+#include "../common/rusage.h"
+#include "../common/cgroup.h"
 #include "../../include/common.h"
 #include "../../include/error.h"
 
@@ -60,12 +62,21 @@ int vm_fault_handle(task_t* task, uint64_t fault_addr, uint64_t err_code, uint64
         if (!new_phys) {
             return RDNX_E_NOMEM;
         }
+        irql_t old = vm_map_lock(map);
+        if ((paging_get_physical(va) & ~(VM_PAGE_SIZE - 1u)) != current_phys) {
+            /* Reclaim ran during the allocation and unmapped the source page: retry. */
+            vm_map_unlock(map, old);
+            (void)vm_page_ref_release(new_phys);
+            return RDNX_OK;
+        }
         memcpy(ARCH_PHYS_TO_VIRT(new_phys), ARCH_PHYS_TO_VIRT(current_phys), VM_PAGE_SIZE);
         (void)paging_map_page_4kb_pml4((uint64_t)(uintptr_t)task->address_space,
                                        va,
                                        new_phys,
                                        vm_pte_flags_from_prot(e->prot));
         (void)vm_page_ref_release(current_phys); /* Drop this mapping's old COW reference. */
+        vm_map_unlock(map, old);
+        rusage_fault(task, 0);
         return RDNX_OK;
     }
 
@@ -73,6 +84,13 @@ int vm_fault_handle(task_t* task, uint64_t fault_addr, uint64_t err_code, uint64
         uint64_t phys = 0;
         uint64_t obj_page_idx = 0;
         int has_obj_page = 0;
+        int major = 0;
+        int kind = vm_map_entry_mem_kind(e);
+
+        /* Charge first: a group at memory.max fails the fault (OOM kill). */
+        if (vm_map_charge(task, map, 1, kind) != RDNX_OK) {
+            return RDNX_E_NOMEM;
+        }
 
         if (e->object) {
             obj_page_idx = (e->object_offset + (va - e->start)) / VM_PAGE_SIZE;
@@ -85,6 +103,7 @@ int vm_fault_handle(task_t* task, uint64_t fault_addr, uint64_t err_code, uint64
         if (!has_obj_page) {
             phys = vm_pager_alloc_zero_page();
             if (!phys) {
+                cgroup_mem_uncharge(map->mem_cg, 1, kind);
                 return RDNX_E_NOMEM;
             }
             if (e->object && e->object->type == VM_OBJECT_FILE && e->object->pager_private) {
@@ -96,6 +115,7 @@ int vm_fault_handle(task_t* task, uint64_t fault_addr, uint64_t err_code, uint64
                         uint64_t avail = fb->size - off;
                         uint64_t copy = (avail > VM_PAGE_SIZE) ? VM_PAGE_SIZE : avail;
                         memcpy(ARCH_PHYS_TO_VIRT(phys), fb->data + off, (size_t)copy);
+                        major = 1;
                     }
                 }
             }
@@ -103,13 +123,28 @@ int vm_fault_handle(task_t* task, uint64_t fault_addr, uint64_t err_code, uint64
                 (void)vm_object_set_resident_page(e->object, obj_page_idx, phys);
             }
         }
+        irql_t old = vm_map_lock(map);
+        if ((paging_get_physical(va) & ~(VM_PAGE_SIZE - 1u)) != 0) {
+            /* Another thread faulted the page in while we slept in the allocator. */
+            vm_map_unlock(map, old);
+            (void)vm_page_ref_release(phys);
+            cgroup_mem_uncharge(map->mem_cg, 1, kind);
+            return RDNX_OK;
+        }
         int rc = paging_map_page_4kb_pml4((uint64_t)(uintptr_t)task->address_space,
                                           va,
                                           phys,
                                           vm_pte_flags_from_prot(e->prot));
+        if (rc == RDNX_OK) {
+            vm_map_account_locked(map, kind, 1);
+        }
+        vm_map_unlock(map, old);
         if (rc != RDNX_OK) {
+            cgroup_mem_uncharge(map->mem_cg, 1, kind);
             return rc;
         }
+        rusage_rss_update(task, map->resident_pages);
+        rusage_fault(task, major);
         return RDNX_OK;
     }
 
@@ -4,6 +4,9 @@
 #include "../arch/paging.h"
 #include "../arch/config.h"
 #include "../common/heap.h"
+#include "../common/rusage.h"
+#include "../common/cgroup.h"
+#include "../common/preempt.h"
 #include "../../include/common.h"
 #include "../../include/error.h"
 
@@ -28,10 +31,17 @@ static vm_map_t* vm_map_create(uint64_t pml4_phys)
         return NULL;
     }
     memset(map, 0, sizeof(*map));
+    spinlock_init(&map->lock);
     map->pml4_phys = pml4_phys;
     return map;
 }
 
+static void vm_map_uncharge_all(vm_map_t* map, cgroup_t* cg)
+{
+    cgroup_mem_uncharge(cg, map->resident_pages - map->file_pages, CGROUP_MEM_ANON);
+    cgroup_mem_uncharge(cg, map->file_pages, CGROUP_MEM_FILE);
+}
+
 static void vm_map_destroy(vm_map_t* map)
 {
     if (!map) {
@@ -43,9 +53,105 @@ static void vm_map_destroy(vm_map_t* map)
             map->entries[i].object = NULL;
         }
     }
+    if (map->mem_cg) {
+        vm_map_uncharge_all(map, map->mem_cg);
+        cgroup_put(map->mem_cg);
+    }
     kfree(map);
 }
 
+int vm_map_charge(task_t* task, vm_map_t* map, uint64_t pages, int kind)
+{
+    if (!map) {
+        return RDNX_E_INVALID;
+    }
+    cgroup_t* cg = cgroup_of(task);
+    int rc = RDNX_OK;
+    irql_t old = vm_map_lock(map);
+    if (map->mem_cg && map->mem_cg != cg) {
+        /* The task moved (cgattach): its resident set follows on the next charge. */
+        uint64_t file = map->file_pages + ((kind == CGROUP_MEM_FILE) ? pages : 0);
+        uint64_t anon = map->resident_pages - map->file_pages + ((kind == CGROUP_MEM_FILE) ? 0 : pages);
+        rc = cgroup_mem_charge(cg, anon, CGROUP_MEM_ANON);
+        if (rc == RDNX_OK) {
+            rc = cgroup_mem_charge(cg, file, CGROUP_MEM_FILE);
+            if (rc != RDNX_OK) {
+                cgroup_mem_uncharge(cg, anon, CGROUP_MEM_ANON);
+            }
+        }
+        if (rc == RDNX_OK) {
+            vm_map_uncharge_all(map, map->mem_cg);
+            cgroup_put(map->mem_cg);
+            cgroup_get(cg);
+            map->mem_cg = cg;
+        }
+        vm_map_unlock(map, old);
+        return rc;
+    }
+    if (!map->mem_cg) {
+        cgroup_get(cg);
+        map->mem_cg = cg;
+    }
+    rc = cgroup_mem_charge(cg, pages, kind);
+    vm_map_unlock(map, old);
+    return rc;
+}
+
+void vm_map_account_locked(vm_map_t* map, int kind, int add)
+{
+    if (add) {
+        map->resident_pages++;
+        if (kind == CGROUP_MEM_FILE) {
+            map->file_pages++;
+        }
+        return;
+    }
+    if (map->resident_pages == 0) {
+        return;
+    }
+    map->resident_pages--;
+    if (kind == CGROUP_MEM_FILE && map->file_pages > 0) {
+        map->file_pages--;
+    }
+    cgroup_mem_uncharge(map->mem_cg, 1, kind);
+}
+
+uint64_t vm_map_rmap_object_page(vm_map_t* map, const vm_object_t* obj, uint64_t page_index,
+                                 uint64_t phys, uint32_t op)
+{
+    uint64_t bits = 0;
+    if (!map || !obj || !phys) {
+        return 0;
+    }
+    irql_t old = vm_map_lock(map);
+    for (uint32_t i = 0; i < map->entry_count; i++) {
+        const vm_map_entry_t* e = &map->entries[i];
+        uint64_t first = e->object_offset / VM_PAGE_SIZE;
+        if (e->object != obj || page_index < first ||
+            page_index - first >= (e->end - e->start) / VM_PAGE_SIZE) {
+            continue;
+        }
+        uint64_t va = e->start + (page_index - first) * VM_PAGE_SIZE;
+        if ((paging_get_physical_pml4(map->pml4_phys, va) & ~(VM_PAGE_SIZE - 1u)) != phys) {
+            continue; /* not faulted in, or replaced by a private copy */
+        }
+        uint64_t clear = 0;
+        if (op == VM_RMAP_CLEAR_REF) {
+            clear = PTE_ACCESSED;
+        } else if (op == VM_RMAP_CLEAR_DIRTY) {
+            clear = PTE_DIRTY;
+        }
+        bits |= paging_pte_clear_bits_pml4(map->pml4_phys, va, clear) & (PTE_ACCESSED | PTE_DIRTY);
+        if (op == VM_RMAP_UNMAP) {
+            (void)paging_unmap_page_pml4(map->pml4_phys, va);
+            (void)vm_page_ref_release(phys); /* Drop this mapping's reference. */
+            vm_map_account_locked(map, vm_map_entry_mem_kind(e), 0);
+        }
+    }
+    vm_map_unlock(map, old);
+    return bits;
+}
+
 static int vm_range_valid(uint64_t start, uint64_t end)
 {
     if (start < VM_USER_MIN || end <= start || end > VM_USER_MAX) {
@@ -94,10 +200,9 @@ static int vm_map_add(vm_map_t* map,
     if (!map || len == 0 || !vm_range_valid(s, e)) {
         return RDNX_E_INVALID;
     }
-    if (map->entry_count >= VM_MAP_MAX_ENTRIES) {
-        return RDNX_E_BUSY;
-    }
-    if (vm_map_overlap(map, s, e)) {
+    irql_t old = vm_map_lock(map);
+    if (map->entry_count >= VM_MAP_MAX_ENTRIES || vm_map_overlap(map, s, e)) {
+        vm_map_unlock(map, old);
         return RDNX_E_BUSY;
     }
 
@@ -112,6 +217,7 @@ static int vm_map_add(vm_map_t* map,
     if (obj) {
         vm_object_ref(obj);
     }
+    vm_map_unlock(map, old);
     return RDNX_OK;
 }
 
@@ -123,6 +229,7 @@ static int vm_map_remove(vm_map_t* map, uint64_t start, uint64_t len, uint64_t p
         return RDNX_E_INVALID;
     }
     int removed = 0;
+    irql_t old = vm_map_lock(map);
     for (uint32_t i = 0; i < map->entry_count;) {
         vm_map_entry_t* cur = &map->entries[i];
         uint64_t rs = (s > cur->start) ? s : cur->start;
@@ -138,6 +245,7 @@ static int vm_map_remove(vm_map_t* map, uint64_t start, uint64_t len, uint64_t p
                 if (phys != 0) {
                     (void)paging_unmap_page_pml4(pml4_phys, va);
                     (void)vm_page_ref_release(phys);
+                    vm_map_account_locked(map, vm_map_entry_mem_kind(cur), 0);
                 }
             }
         }
@@ -168,6 +276,7 @@ static int vm_map_remove(vm_map_t* map, uint64_t start, uint64_t len, uint64_t p
         }
 
         if (map->entry_count >= VM_MAP_MAX_ENTRIES) {
+            vm_map_unlock(map, old);
             return RDNX_E_BUSY;
         }
         vm_map_entry_t tail = *cur;
@@ -185,6 +294,7 @@ static int vm_map_remove(vm_map_t* map, uint64_t start, uint64_t len, uint64_t p
         map->entry_count++;
         i += 2;
     }
+    vm_map_unlock(map, old);
     return removed ? RDNX_OK : RDNX_E_NOTFOUND;
 }
 
@@ -202,6 +312,37 @@ vm_map_entry_t* vm_map_lookup(vm_map_t* map, uint64_t addr)
     return NULL;
 }
 
+/*
+ * RLIMIT_AS caps every mapping; RLIMIT_DATA caps brk plus anonymous
+ * non-stack mappings. A MAP_FIXED request is checked before the range it
+ * replaces is unmapped, so it is judged conservatively.
+ */
+static int vm_task_rlimit_ok(const task_t* task, const vm_map_t* map, uint64_t add, int is_data)
+{
+    uint64_t as_cur = rusage_rlimit_cur(task, TASK_RLIMIT_AS);
+    uint64_t data_cur = is_data ? rusage_rlimit_cur(task, TASK_RLIMIT_DATA) : TASK_RLIM_INFINITY;
+    if (as_cur == TASK_RLIM_INFINITY && data_cur == TASK_RLIM_INFINITY) {
+        return 1;
+    }
+    uint64_t total = 0;
+    uint64_t data = 0;
+    for (uint32_t i = 0; i < map->entry_count; i++) {
+        const vm_map_entry_t* e = &map->entries[i];
+        uint64_t len = e->end - e->start;
+        total += len;
+        if ((e->flags & VM_MAP_F_ANON) && (e->flags & VM_MAP_F_STACK) == 0) {
+            data += len;
+        }
+    }
+    if (as_cur != TASK_RLIM_INFINITY && (add > as_cur || total > as_cur - add)) {
+        return 0;
+    }
+    if (data_cur != TASK_RLIM_INFINITY && (add > data_cur || data > data_cur - add)) {
+        return 0;
+    }
+    return 1;
+}
+
 static uint64_t vm_find_gap(vm_map_t* map, uint64_t hint, uint64_t len)
 {
     uint64_t s = vm_align_up(hint);
@@ -252,7 +393,21 @@ int vm_task_map_fixed(task_t* task, uint64_t start, uint64_t len, uint32_t prot,
     if (!task || !task->vm_map) {
         return RDNX_E_INVALID;
     }
-    return vm_map_add((vm_map_t*)task->vm_map, start, len, prot, flags | VM_MAP_F_FIXED, NULL, 0);
+    vm_map_t* map = (vm_map_t*)task->vm_map;
+    int rc = vm_map_add(map, start, len, prot, flags | VM_MAP_F_FIXED, NULL, 0);
+    if (rc == RDNX_OK) {
+        /* Loader segments and the initial stack are mapped eagerly. */
+        uint64_t pages = (vm_align_up(start + len) - vm_align_down(start)) / VM_PAGE_SIZE;
+        if (vm_map_charge(task, map, pages, CGROUP_MEM_ANON) != RDNX_OK) {
+            (void)vm_map_remove(map, start, len, 0);
+            return RDNX_E_NOMEM;
+        }
+        irql_t old = vm_map_lock(map);
+        map->resident_pages += pages;
+        vm_map_unlock(map, old);
+        rusage_rss_update(task, map->resident_pages);
+    }
+    return rc;
 }
 
 int vm_task_set_brk_base(task_t* task, uint64_t brk_base)
@@ -274,6 +429,9 @@ long vm_task_mmap(task_t* task, uint64_t addr_hint, uint64_t len, uint32_t prot,
     uint64_t alen = vm_align_up(len);
     vm_map_t* map = (vm_map_t*)task->vm_map;
     uint64_t addr = 0;
+    if (!vm_task_rlimit_ok(task, map, alen, (flags & VM_MAP_F_STACK) == 0)) {
+        return (long)RDNX_E_NOMEM;
+    }
 
     if ((flags & VM_MAP_F_FIXED) != 0) {
         addr = vm_align_down(addr_hint);
@@ -314,6 +472,9 @@ long vm_task_mmap_object(task_t* task,
     uint64_t alen = vm_align_up(len);
     vm_map_t* map = (vm_map_t*)task->vm_map;
     uint64_t addr = 0;
+    if (!vm_task_rlimit_ok(task, map, alen, 0)) {
+        return (long)RDNX_E_NOMEM;
+    }
 
     if ((flags & VM_MAP_F_FIXED) != 0) {
         addr = vm_align_down(addr_hint);
@@ -349,6 +510,9 @@ long vm_task_mmap_file(task_t* task,
     uint64_t alen = vm_align_up(len);
     vm_map_t* map = (vm_map_t*)task->vm_map;
     uint64_t addr = 0;
+    if (!vm_task_rlimit_ok(task, map, alen, 0)) {
+        return (long)RDNX_E_NOMEM;
+    }
 
     if ((flags & VM_MAP_F_FIXED) != 0) {
         addr = vm_align_down(addr_hint);
@@ -374,6 +538,8 @@ long vm_task_mmap_file(task_t* task,
     fb->data = data;
     fb->size = data_size;
     fb->file_offset = 0;
+    fb->dirty = 0;
+    fb->shared = 0;
     obj->pager_private = fb;
 
     int rc = vm_map_add(map, addr, alen, prot, flags | VM_MAP_F_LAZY, obj, file_offset);
@@ -412,6 +578,9 @@ long vm_task_brk(task_t* task, uint64_t new_break)
     vm_map_t* map = (vm_map_t*)task->vm_map;
     if (new_end > task->vm_brk_end) {
         uint64_t len = new_end - task->vm_brk_end;
+        if (!vm_task_rlimit_ok(task, map, len, 1)) {
+            return (long)RDNX_E_NOMEM;
+        }
         if (len > 0) {
             vm_object_t* obj = vm_object_create(VM_OBJECT_ANON, len);
             if (!obj) {
@@ -461,8 +630,17 @@ int vm_task_fork_clone(task_t* parent, task_t* child, uint64_t child_pml4_phys)
         return RDNX_E_NOMEM;
     }
 
-    for (uint32_t i = 0; i < pmap->entry_count; i++) {
+    /* Per-class counts: the child is charged anon and file pages separately. */
+    uint64_t anon_pages = 0;
+    uint64_t file_pages = 0;
+    for (uint32_t i = 0;; i++) {
+        irql_t pold = vm_map_lock(pmap);
+        if (i >= pmap->entry_count) {
+            vm_map_unlock(pmap, pold);
+            break;
+        }
         if (cmap->entry_count >= VM_MAP_MAX_ENTRIES) {
+            vm_map_unlock(pmap, pold);
             vm_map_destroy(cmap);
             return RDNX_E_BUSY;
         }
@@ -480,6 +658,12 @@ int vm_task_fork_clone(task_t* parent, task_t* child, uint64_t child_pml4_phys)
         }
 
         for (uint64_t va = pe.start; va < pe.end; va += VM_PAGE_SIZE) {
+            /* Large parents: let others run every 64 pages. */
+            if (((va - pe.start) / VM_PAGE_SIZE) % 64u == 63u) {
+                vm_map_unlock(pmap, pold);
+                cond_resched();
+                pold = vm_map_lock(pmap);
+            }
             uint64_t phys = paging_get_physical(va) & ~(VM_PAGE_SIZE - 1u);
             if (!phys) {
                 continue;
@@ -497,18 +681,37 @@ int vm_task_fork_clone(task_t* parent, task_t* child, uint64_t child_pml4_phys)
             }
 
             if (paging_map_page_4kb_pml4(child_pml4_phys, va, phys, flags) != RDNX_OK) {
+                vm_map_unlock(pmap, pold);
                 vm_map_destroy(cmap);
                 return RDNX_E_GENERIC;
             }
             (void)vm_page_ref_retain(phys); /* Child mapping reference. */
+            if (vm_map_entry_mem_kind(&pe) == CGROUP_MEM_FILE) {
+                file_pages++;
+            } else {
+                anon_pages++;
+            }
 
             if (cow) {
                 (void)paging_map_page_4kb_pml4((uint64_t)(uintptr_t)parent->address_space, va, phys, flags);
             }
         }
+        vm_map_unlock(pmap, pold);
     }
 
+    if (vm_map_charge(child, cmap, anon_pages, CGROUP_MEM_ANON) != RDNX_OK) {
+        vm_map_destroy(cmap);
+        return RDNX_E_NOMEM;
+    }
+    cmap->resident_pages = anon_pages;
+    if (vm_map_charge(child, cmap, file_pages, CGROUP_MEM_FILE) != RDNX_OK) {
+        vm_map_destroy(cmap);
+        return RDNX_E_NOMEM;
+    }
+    cmap->resident_pages += file_pages;
+    cmap->file_pages = file_pages;
     child->vm_map = cmap;
+    rusage_rss_update(child, cmap->resident_pages);
     child->vm_brk_base = parent->vm_brk_base;
     child->vm_brk_end = parent->vm_brk_end;
     child->vm_mmap_base = parent->vm_mmap_base;
@@ -584,6 +787,7 @@ int vm_task_msync(task_t* task, uint64_t addr, uint64_t len, uint32_t flags)
             uint64_t avail = fb->size - off;
             uint64_t copy = (avail > VM_PAGE_SIZE) ? VM_PAGE_SIZE : avail;
             memcpy(dst + off, ARCH_PHYS_TO_VIRT(phys), (size_t)copy);
+            fb->dirty = 1;
             did = 1;
         }
     }
@@ -607,6 +811,7 @@ int vm_task_mprotect(task_t* task, uint64_t addr, uint64_t len, uint32_t prot)
     }
 
     int changed = 0;
+    irql_t old = vm_map_lock(map);
     for (uint32_t i = 0; i < map->entry_count; i++) {
         vm_map_entry_t* me = &map->entries[i];
         uint64_t rs = (s > me->start) ? s : me->start;
@@ -615,6 +820,7 @@ int vm_task_mprotect(task_t* task, uint64_t addr, uint64_t len, uint32_t prot)
             continue;
         }
         if (rs != me->start || re != me->end) {
+            vm_map_unlock(map, old);
             return RDNX_E_UNSUPPORTED;
         }
 
@@ -630,6 +836,7 @@ int vm_task_mprotect(task_t* task, uint64_t addr, uint64_t len, uint32_t prot)
         }
         changed = 1;
     }
+    vm_map_unlock(map, old);
 
     return changed ? RDNX_OK : RDNX_E_NOTFOUND;
 }
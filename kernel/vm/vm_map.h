@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include "../core/task.h"
 #include "vm_object.h"
+#include "../common/cgroup.h"
+#include "../fabric/spin.h"
 
 #define VM_PAGE_SIZE 0x1000ULL
 #define VM_MAP_MAX_ENTRIES 128
@@ -29,12 +31,58 @@ typedef struct vm_map_entry {
     uint64_t object_offset;
 } vm_map_entry_t;
 
+/*
+ * LOCKING: vm_map_t::lock (spinlock_t, irqsave)
+ *   Protects: entries[], entry_count, resident_pages, file_pages and the
+ *             PTEs of the map's entries. The owning task changes them under
+ *             it; kswapd takes it to walk another task's map (rmap).
+ *   Lock order: lock -> reclaim_spin, cgroup_spin, heap_spin. Never held
+ *   across vm_pager_alloc_zero_page (direct reclaim walks maps).
+ */
 typedef struct vm_map {
+    spinlock_t lock;
     uint64_t pml4_phys;
     uint32_t entry_count;
+    uint64_t resident_pages; /* present user PTEs (RSS), maintained by map/fault/unmap */
+    uint64_t file_pages;     /* ... of which pages of file objects (CGROUP_MEM_FILE) */
+    struct cgroup* mem_cg;   /* group resident_pages are charged to (set on first charge) */
     vm_map_entry_t entries[VM_MAP_MAX_ENTRIES];
 } vm_map_t;
 
+static inline irql_t vm_map_lock(vm_map_t* map)
+{
+    return spinlock_lock_irqsave(&map->lock);
+}
+
+static inline void vm_map_unlock(vm_map_t* map, irql_t old)
+{
+    spinlock_unlock_irqrestore(&map->lock, old);
+}
+
+/* cgroup memory class of a page mapped by e: file object pages are file memory. */
+static inline int vm_map_entry_mem_kind(const vm_map_entry_t* e)
+{
+    return (e->object && e->object->type == VM_OBJECT_FILE) ? CGROUP_MEM_FILE : CGROUP_MEM_ANON;
+}
+
+/* vm_map_rmap_object_page() operations. */
+enum {
+    VM_RMAP_CLEAR_REF   = 1, /* test and clear the accessed bit */
+    VM_RMAP_CLEAR_DIRTY = 2, /* test and clear the dirty bit (after writeback) */
+    VM_RMAP_UNMAP       = 3, /* remove every mapping of the page */
+};
+
+/*
+ * Reverse map for one object page within map: applies op to each mapping of
+ * phys at object page page_index and returns the OR of their PTE
+ * accessed/dirty bits.
+ */
+uint64_t vm_map_rmap_object_page(vm_map_t* map, const vm_object_t* obj, uint64_t page_index,
+                                 uint64_t phys, uint32_t op);
+/* Charge pages of kind (CGROUP_MEM_*) about to become resident in map to the task's cgroup. */
+int vm_map_charge(task_t* task, vm_map_t* map, uint64_t pages, int kind);
+/* A page charged with vm_map_charge became resident / stopped being resident; map->lock held. */
+void vm_map_account_locked(vm_map_t* map, int kind, int add);
 int vm_task_prepare_exec(task_t* task, uint64_t user_pml4_phys);
 int vm_task_map_fixed(task_t* task, uint64_t start, uint64_t len, uint32_t prot, uint32_t flags);
 int vm_task_set_brk_base(task_t* task, uint64_t brk_base);
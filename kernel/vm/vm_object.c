@@ -1,10 +1,13 @@
 #include "vm_object.h"
 #include "vm_page_ref.h"
+#include "vm_reclaim.h"
 #include "../common/heap.h"
 #include "../arch/config.h"
 #include "../../include/common.h"
 #include "../../include/error.h"
 
+static vm_object_t* g_vm_file_objects = NULL;
+
 static uint64_t vm_object_align_up(uint64_t value)
 {
     return (value + VM_OBJECT_PAGE_SIZE - 1u) & ~(VM_OBJECT_PAGE_SIZE - 1u);
@@ -27,6 +30,18 @@ vm_object_t* vm_object_create(vm_object_type_t type, uint64_t size)
         return NULL;
     }
     memset(obj->resident_pages, 0, (size_t)(obj->page_count * sizeof(uint64_t)));
+    if (type == VM_OBJECT_FILE) {
+        size_t lru_bytes = (size_t)(obj->page_count * sizeof(vm_lru_page_t));
+        obj->lru = (vm_lru_page_t*)kmalloc(lru_bytes);
+        if (!obj->lru) {
+            kfree(obj->resident_pages);
+            kfree(obj);
+            return NULL;
+        }
+        memset(obj->lru, 0, lru_bytes);
+        obj->file_next = g_vm_file_objects;
+        g_vm_file_objects = obj;
+    }
     obj->ref_count = 1;
     return obj;
 }
@@ -68,6 +83,7 @@ void vm_object_unref(vm_object_t* obj)
         if (obj->resident_pages) {
             for (uint64_t i = 0; i < obj->page_count; i++) {
                 uint64_t phys = obj->resident_pages[i];
+                vm_reclaim_page_removed(obj, i);
                 if (phys) {
                     (void)vm_page_ref_release(phys); /* Drop vm_object ownership ref. */
                     obj->resident_pages[i] = 0;
@@ -76,6 +92,16 @@ void vm_object_unref(vm_object_t* obj)
             kfree(obj->resident_pages);
             obj->resident_pages = NULL;
         }
+        if (obj->lru) {
+            for (vm_object_t** it = &g_vm_file_objects; *it; it = &(*it)->file_next) {
+                if (*it == obj) {
+                    *it = obj->file_next;
+                    break;
+                }
+            }
+            kfree(obj->lru);
+            obj->lru = NULL;
+        }
         if (obj->pager_private) {
             kfree(obj->pager_private);
             obj->pager_private = NULL;
@@ -102,9 +128,38 @@ int vm_object_set_resident_page(vm_object_t* obj, uint64_t page_index, uint64_t
         return RDNX_OK;
     }
     if (old) {
+        vm_reclaim_page_removed(obj, page_index);
         (void)vm_page_ref_release(old);
     }
     (void)vm_page_ref_retain(phys);
     obj->resident_pages[page_index] = phys;
+    vm_reclaim_page_added(obj, page_index);
     return RDNX_OK;
 }
+
+void vm_object_evict_page(vm_object_t* obj, uint64_t page_index)
+{
+    if (!obj || !obj->resident_pages || page_index >= obj->page_count) {
+        return;
+    }
+    uint64_t phys = obj->resident_pages[page_index];
+    if (!phys) {
+        return;
+    }
+    obj->resident_pages[page_index] = 0;
+    (void)vm_page_ref_release(phys); /* Drop vm_object ownership ref. */
+}
+
+int vm_object_backing_in_use(const void* data)
+{
+    if (!data) {
+        return 0;
+    }
+    for (const vm_object_t* it = g_vm_file_objects; it; it = it->file_next) {
+        const vm_file_backing_t* fb = (const vm_file_backing_t*)it->pager_private;
+        if (fb && fb->data == data) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -10,6 +10,8 @@ typedef enum {
     VM_OBJECT_FILE = 2
 } vm_object_type_t;
 
+struct vm_lru_page;
+
 typedef struct vm_object {
     vm_object_type_t type;
     uint32_t ref_count;
@@ -17,12 +19,16 @@ typedef struct vm_object {
     uint64_t page_count;
     uint64_t* resident_pages;
     void* pager_private;
+    struct vm_lru_page* lru;       /* FILE: per-page LRU linkage, see vm_reclaim.c */
+    struct vm_object* file_next;   /* FILE: list of live file objects */
 } vm_object_t;
 
 typedef struct vm_file_backing {
     const uint8_t* data;
     uint64_t size;
     uint64_t file_offset;
+    uint32_t dirty; /* msync copied pages into data; fsync must persist them */
+    uint32_t shared; /* MAP_SHARED: dirty pages may be written back into data */
 } vm_file_backing_t;
 
 vm_object_t* vm_object_create(vm_object_type_t type, uint64_t size);
@@ -30,5 +36,9 @@ void vm_object_ref(vm_object_t* obj);
 void vm_object_unref(vm_object_t* obj);
 uint64_t vm_object_get_resident_page(const vm_object_t* obj, uint64_t page_index);
 int vm_object_set_resident_page(vm_object_t* obj, uint64_t page_index, uint64_t phys);
+/* Drop the object's reference to a resident page; mappings must be gone already. */
+void vm_object_evict_page(vm_object_t* obj, uint64_t page_index);
+/* 1 if a live file object still reads from data (mmap of inode->data). */
+int vm_object_backing_in_use(const void* data);
 
 #endif /* _RODNIX_VM_OBJECT_H */
@@ -1,5 +1,6 @@
 #include "vm_pager.h"
 #include "vm_page_ref.h"
+#include "vm_reclaim.h"
 #include "../arch/pmm.h"
 #include "../arch/config.h"
 #include "../../include/common.h"
@@ -7,9 +8,13 @@
 uint64_t vm_pager_alloc_zero_page(void)
 {
     uint64_t phys = pmm_alloc_page_in_zone(PMM_ZONE_NORMAL);
+    if (!phys && vm_reclaim_direct(32) > 0) {
+        phys = pmm_alloc_page_in_zone(PMM_ZONE_NORMAL);
+    }
     if (!phys) {
         return 0;
     }
+    vm_reclaim_wakeup_if_low();
     void* dst = ARCH_PHYS_TO_VIRT(phys);
     memset(dst, 0, ARCH_PAGE_SIZE_4KB);
     (void)vm_page_ref_add_new(phys);
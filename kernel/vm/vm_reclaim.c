@@ -0,0 +1,494 @@
+/**
+ * @file vm_reclaim.c
+ * @brief Page reclaim: active/inactive LRU over file pages, kswapd, shrinkers
+ *
+ * Pages of VM_OBJECT_FILE objects are the page cache: their contents can be
+ * rebuilt from vm_file_backing_t::data, so they are the only user pages that
+ * may be dropped (anonymous memory has no swap). New pages start on the
+ * inactive list; an inactive page seen accessed twice is activated, an
+ * unaccessed one is evicted. Dirty MAP_SHARED pages are copied back into the
+ * backing (as msync does) first; dirty private pages stay resident.
+ *
+ * There is no per-page reverse map: mappings of a page are found by walking
+ * every task's vm_map for entries of the owning object.
+ *
+ * LOCKING: reclaim_spin (spinlock_t, irqsave)
+ *   Protects: lru_active, lru_inactive, vm_lru_page_t linkage, reclaim_stats.
+ *   The scanners isolate a page under it (VM_LRU_ISOLATED, object and
+ *   physical page pinned) and run the rmap walk, which takes the task
+ *   registry lock, without it.
+ *
+ * kswapd sleeps until an allocation leaves PMM_ZONE_NORMAL below the low
+ * watermark and reclaims until the high watermark. An allocation that finds
+ * the zone empty reclaims directly before failing with RDNX_E_NOMEM.
+ */
+
+#include "vm_reclaim.h"
+#include "vm_map.h"
+#include "vm_page_ref.h"
+#include "../arch/pmm.h"
+#include "../arch/config.h"
+#include "../arch/paging.h"
+#include "../common/scheduler.h"
+#include "../common/waitq.h"
+#include "../core/interrupts.h"
+#include "../core/task.h"
+#include "../fabric/spin.h"
+#include "../../include/common.h"
+#include "../../include/error.h"
+
+#define VM_RECLAIM_BATCH 32u
+#define VM_RECLAIM_WMARK_DIV 256u      /* min = 1/256 of the zone */
+#define VM_RECLAIM_WMARK_FLOOR 32u
+#define VM_RECLAIM_KSWAPD_PERIOD_MS 1000u
+#define VM_RECLAIM_MAX_SHRINKERS 4u
+
+TAILQ_HEAD(vm_lru_head, vm_lru_page);
+
+static struct vm_lru_head lru_active = TAILQ_HEAD_INITIALIZER(lru_active);
+static struct vm_lru_head lru_inactive = TAILQ_HEAD_INITIALIZER(lru_inactive);
+static vm_reclaim_stats_t reclaim_stats;
+static vm_shrinker_fn reclaim_shrinkers[VM_RECLAIM_MAX_SHRINKERS];
+static uint32_t reclaim_nr_shrinkers = 0;
+
+static spinlock_t reclaim_spin;
+
+static waitq_t kswapd_wq;
+static thread_t* kswapd_thread = NULL;
+static int kswapd_running = 0;
+
+static inline irql_t reclaim_lock(void)
+{
+    return spinlock_lock_irqsave(&reclaim_spin);
+}
+
+static inline void reclaim_unlock(irql_t old)
+{
+    spinlock_unlock_irqrestore(&reclaim_spin, old);
+}
+
+/* ============================================================================
+ * LRU lists
+ * ============================================================================ */
+
+static void lru_del(vm_lru_page_t* p)
+{
+    if (p->list == VM_LRU_ACTIVE) {
+        TAILQ_REMOVE(&lru_active, p, link);
+        reclaim_stats.active_pages--;
+    } else if (p->list == VM_LRU_INACTIVE) {
+        TAILQ_REMOVE(&lru_inactive, p, link);
+        reclaim_stats.inactive_pages--;
+    }
+    p->list = VM_LRU_NONE;
+}
+
+static void lru_add_tail(vm_lru_page_t* p, uint8_t list)
+{
+    lru_del(p);
+    p->list = list;
+    if (list == VM_LRU_ACTIVE) {
+        TAILQ_INSERT_TAIL(&lru_active, p, link);
+        reclaim_stats.active_pages++;
+    } else {
+        TAILQ_INSERT_TAIL(&lru_inactive, p, link);
+        reclaim_stats.inactive_pages++;
+    }
+}
+
+void vm_reclaim_page_added(vm_object_t* obj, uint64_t page_index)
+{
+    if (!obj || !obj->lru || page_index >= obj->page_count) {
+        return;
+    }
+    vm_lru_page_t* p = &obj->lru[page_index];
+    irql_t old = reclaim_lock();
+    p->object = obj;
+    p->index = page_index;
+    p->referenced = 0;
+    if (p->list == VM_LRU_EVICTED) {
+        /* Evicted while still in use: bring it back straight to the active list. */
+        reclaim_stats.refaults++;
+        p->list = VM_LRU_NONE;
+        lru_add_tail(p, VM_LRU_ACTIVE);
+    } else if (p->list == VM_LRU_NONE) {
+        lru_add_tail(p, VM_LRU_INACTIVE);
+    }
+    reclaim_unlock(old);
+}
+
+void vm_reclaim_page_removed(vm_object_t* obj, uint64_t page_index)
+{
+    if (!obj || !obj->lru || page_index >= obj->page_count) {
+        return;
+    }
+    irql_t old = reclaim_lock();
+    vm_lru_page_t* p = &obj->lru[page_index];
+    lru_del(p);
+    p->referenced = 0;
+    reclaim_unlock(old);
+}
+
+/* A page taken off the LRU for scanning, see lru_isolate. */
+typedef struct vm_lru_scan {
+    vm_lru_page_t* page;
+    vm_object_t* obj;
+    uint64_t index;
+    uint64_t phys;
+} vm_lru_scan_t;
+
+/*
+ * Take the head of a list for scanning: 1 with *s filled in, 0 if the list
+ * is empty, -1 if the head was dropped (no longer resident, or its object is
+ * being torn down). The object and the physical page stay pinned until
+ * lru_putback/lru_unpin, so the page can be examined without reclaim_spin.
+ */
+static int lru_isolate(struct vm_lru_head* head, vm_lru_scan_t* s)
+{
+    irql_t old = reclaim_lock();
+    vm_lru_page_t* p = TAILQ_FIRST(head);
+    if (!p) {
+        reclaim_unlock(old);
+        return 0;
+    }
+    reclaim_stats.scanned++;
+    uint64_t phys = vm_object_get_resident_page(p->object, p->index);
+    lru_del(p);
+    if (!phys || p->object->ref_count == 0) {
+        reclaim_unlock(old);
+        return -1;
+    }
+    p->list = VM_LRU_ISOLATED;
+    vm_object_ref(p->object);
+    /* The object holds a reference, so this only bumps the existing count. */
+    (void)vm_page_ref_retain(phys);
+    s->page = p;
+    s->obj = p->object;
+    s->index = p->index;
+    s->phys = phys;
+    reclaim_unlock(old);
+    return 1;
+}
+
+static void lru_unpin(vm_lru_scan_t* s)
+{
+    (void)vm_page_ref_release(s->phys);
+    vm_object_unref(s->obj);
+}
+
+/*
+ * Return an isolated page to list, unless it was removed or re-added
+ * meanwhile; stat (optional) is counted under the lock.
+ */
+static void lru_putback(vm_lru_scan_t* s, uint8_t list, uint8_t referenced, uint64_t* stat)
+{
+    irql_t old = reclaim_lock();
+    if (s->page->list == VM_LRU_ISOLATED) {
+        s->page->referenced = referenced;
+        lru_add_tail(s->page, list);
+    }
+    if (stat) {
+        (*stat)++;
+    }
+    reclaim_unlock(old);
+    lru_unpin(s);
+}
+
+/* ============================================================================
+ * Reverse mapping (walk all address spaces)
+ * ============================================================================ */
+
+typedef struct vm_rmap_ctx {
+    const vm_object_t* obj;
+    uint64_t index;
+    uint64_t phys;
+    uint32_t op;
+    uint64_t bits;
+} vm_rmap_ctx_t;
+
+static void vm_rmap_one(task_t* task, void* arg)
+{
+    vm_rmap_ctx_t* ctx = (vm_rmap_ctx_t*)arg;
+    if (task->vm_map) {
+        ctx->bits |= vm_map_rmap_object_page((vm_map_t*)task->vm_map, ctx->obj, ctx->index,
+                                             ctx->phys, ctx->op);
+    }
+}
+
+static uint64_t vm_rmap(const vm_object_t* obj, uint64_t index, uint64_t phys, uint32_t op)
+{
+    vm_rmap_ctx_t ctx;
+    ctx.obj = obj;
+    ctx.index = index;
+    ctx.phys = phys;
+    ctx.op = op;
+    ctx.bits = 0;
+    (void)task_foreach(vm_rmap_one, &ctx);
+    return ctx.bits;
+}
+
+/* Copy a dirty shared page into the backing store, like msync. */
+static int vm_reclaim_writeback(vm_object_t* obj, uint64_t index, uint64_t phys)
+{
+    vm_file_backing_t* fb = (vm_file_backing_t*)obj->pager_private;
+    if (!fb || !fb->shared || !fb->data) {
+        return RDNX_E_BUSY;
+    }
+    uint64_t off = fb->file_offset + index * VM_OBJECT_PAGE_SIZE;
+    if (off < fb->size) {
+        uint64_t avail = fb->size - off;
+        uint64_t copy = (avail > VM_OBJECT_PAGE_SIZE) ? VM_OBJECT_PAGE_SIZE : avail;
+        memcpy((uint8_t*)fb->data + off, ARCH_PHYS_TO_VIRT(phys), (size_t)copy);
+        fb->dirty = 1;
+    }
+    (void)vm_rmap(obj, index, phys, VM_RMAP_CLEAR_DIRTY);
+    irql_t old = reclaim_lock();
+    reclaim_stats.writeback++;
+    reclaim_unlock(old);
+    return RDNX_OK;
+}
+
+/* ============================================================================
+ * Scanning
+ * ============================================================================ */
+
+/* Age the active list: unaccessed pages move to the inactive tail. */
+static void vm_shrink_active(uint32_t nr_scan)
+{
+    for (uint32_t i = 0; i < nr_scan; i++) {
+        vm_lru_scan_t s;
+        int rc = lru_isolate(&lru_active, &s);
+        if (rc == 0) {
+            break;
+        }
+        if (rc < 0) {
+            continue;
+        }
+        if (vm_rmap(s.obj, s.index, s.phys, VM_RMAP_CLEAR_REF) & PTE_ACCESSED) {
+            lru_putback(&s, VM_LRU_ACTIVE, 0, NULL);
+        } else {
+            lru_putback(&s, VM_LRU_INACTIVE, 0, &reclaim_stats.deactivated);
+        }
+    }
+}
+
+/* Evict cold inactive pages; returns pages freed. */
+static uint64_t vm_shrink_inactive(uint32_t nr_scan)
+{
+    uint64_t freed = 0;
+    for (uint32_t i = 0; i < nr_scan; i++) {
+        vm_lru_scan_t s;
+        int rc = lru_isolate(&lru_inactive, &s);
+        if (rc == 0) {
+            break;
+        }
+        if (rc < 0) {
+            continue;
+        }
+        uint64_t bits = vm_rmap(s.obj, s.index, s.phys, VM_RMAP_CLEAR_REF);
+        if (bits & PTE_ACCESSED) {
+            if (s.page->referenced) {
+                lru_putback(&s, VM_LRU_ACTIVE, 0, &reclaim_stats.activated);
+            } else {
+                lru_putback(&s, VM_LRU_INACTIVE, 1, NULL);
+            }
+            continue;
+        }
+        if ((bits & PTE_DIRTY) && vm_reclaim_writeback(s.obj, s.index, s.phys) != RDNX_OK) {
+            /* Private modifications have nowhere to go without swap. */
+            lru_putback(&s, VM_LRU_ACTIVE, 0, &reclaim_stats.activated);
+            continue;
+        }
+        /*
+         * A mapping may have touched the page since the CLEAR_REF walk. The
+         * page stays resident in the object either way, so a putback only
+         * costs the unmapped users a minor fault.
+         */
+        bits = vm_rmap(s.obj, s.index, s.phys, VM_RMAP_UNMAP);
+        if ((bits & PTE_DIRTY) && vm_reclaim_writeback(s.obj, s.index, s.phys) != RDNX_OK) {
+            lru_putback(&s, VM_LRU_ACTIVE, 0, &reclaim_stats.activated);
+            continue;
+        }
+        if (bits & PTE_ACCESSED) {
+            lru_putback(&s, VM_LRU_ACTIVE, 0, &reclaim_stats.activated);
+            continue;
+        }
+        irql_t old = reclaim_lock();
+        /* Skip it if the page was replaced or dropped while isolated. */
+        if (s.page->list == VM_LRU_ISOLATED &&
+            vm_object_get_resident_page(s.obj, s.index) == s.phys) {
+            s.page->referenced = 0;
+            s.page->list = VM_LRU_EVICTED;
+            vm_object_evict_page(s.obj, s.index); /* our pin keeps the frame */
+            reclaim_stats.evicted++;
+            freed++;
+        }
+        reclaim_unlock(old);
+        lru_unpin(&s);
+    }
+    return freed;
+}
+
+static uint64_t vm_reclaim_run_shrinkers(uint64_t target_bytes)
+{
+    uint64_t released = 0;
+    for (uint32_t i = 0; i < reclaim_nr_shrinkers && released < target_bytes; i++) {
+        released += reclaim_shrinkers[i](target_bytes - released);
+    }
+    irql_t old = reclaim_lock();
+    reclaim_stats.shrunk_bytes += released;
+    reclaim_unlock(old);
+    return released;
+}
+
+static uint64_t vm_zone_free_pages(void)
+{
+    pmm_zone_stats_t zs;
+    if (pmm_get_zone_stats(PMM_ZONE_NORMAL, &zs) != RDNX_OK) {
+        return 0;
+    }
+    return zs.free_pages;
+}
+
+/*
+ * Free up to nr_pages: keep the inactive list at least as long as the active
+ * one, evict from it, and fall back to shrinkers when the LRU is exhausted.
+ * Returns the evicted pages plus whatever the zone gained while the
+ * shrinkers ran: heap memory they release stays in the heap and is not
+ * counted.
+ */
+static uint64_t vm_reclaim_pages(uint64_t nr_pages)
+{
+    uint64_t freed = 0;
+    uint64_t budget = (reclaim_stats.active_pages + reclaim_stats.inactive_pages) * 2u +
+                      VM_RECLAIM_BATCH;
+    uint64_t scanned_start = reclaim_stats.scanned;
+    while (freed < nr_pages && reclaim_stats.scanned - scanned_start < budget) {
+        if (reclaim_stats.active_pages == 0 && reclaim_stats.inactive_pages == 0) {
+            break;
+        }
+        if (reclaim_stats.inactive_pages < reclaim_stats.active_pages) {
+            vm_shrink_active(VM_RECLAIM_BATCH);
+        }
+        freed += vm_shrink_inactive(VM_RECLAIM_BATCH);
+    }
+    if (freed < nr_pages) {
+        uint64_t zone_before = vm_zone_free_pages();
+        (void)vm_reclaim_run_shrinkers((nr_pages - freed) * VM_OBJECT_PAGE_SIZE);
+        uint64_t zone_after = vm_zone_free_pages();
+        if (zone_after > zone_before) {
+            freed += zone_after - zone_before;
+        }
+    }
+    return freed;
+}
+
+/* ============================================================================
+ * Watermarks, kswapd, direct reclaim
+ * ============================================================================ */
+
+static void vm_reclaim_update_wmarks(void)
+{
+    pmm_zone_stats_t zs;
+    if (pmm_get_zone_stats(PMM_ZONE_NORMAL, &zs) != RDNX_OK) {
+        return;
+    }
+    uint64_t min = zs.total_pages / VM_RECLAIM_WMARK_DIV;
+    if (min < VM_RECLAIM_WMARK_FLOOR) {
+        min = VM_RECLAIM_WMARK_FLOOR;
+    }
+    reclaim_stats.wmark_min = min;
+    reclaim_stats.wmark_low = min * 2u;
+    reclaim_stats.wmark_high = min * 3u;
+}
+
+static void vm_kswapd_main(void* arg)
+{
+    (void)arg;
+    for (;;) {
+        (void)waitq_wait(&kswapd_wq, VM_RECLAIM_KSWAPD_PERIOD_MS);
+        vm_reclaim_update_wmarks();
+        if (vm_zone_free_pages() >= reclaim_stats.wmark_low) {
+            continue;
+        }
+        kswapd_running = 1;
+        reclaim_stats.kswapd_runs++;
+        while (vm_zone_free_pages() < reclaim_stats.wmark_high) {
+            if (vm_reclaim_pages(VM_RECLAIM_BATCH) == 0) {
+                break;
+            }
+            scheduler_yield();
+        }
+        kswapd_running = 0;
+    }
+}
+
+void vm_reclaim_start(void)
+{
+    if (kswapd_thread) {
+        return;
+    }
+    task_t* kernel_task = task_get_current();
+    if (!kernel_task) {
+        return;
+    }
+    waitq_init(&kswapd_wq, "kswapd");
+    vm_reclaim_update_wmarks();
+    kswapd_thread = thread_create(kernel_task, vm_kswapd_main, NULL);
+    if (!kswapd_thread) {
+        return;
+    }
+    kswapd_thread->priority = 16;
+    scheduler_set_bucket(kswapd_thread, SCHED_BUCKET_UTILITY);
+    scheduler_add_thread(kswapd_thread);
+}
+
+void vm_reclaim_wakeup_if_low(void)
+{
+    if (!kswapd_thread || kswapd_running) {
+        return;
+    }
+    if (vm_zone_free_pages() >= reclaim_stats.wmark_low) {
+        return;
+    }
+    if (waitq_wake_one(&kswapd_wq)) {
+        reclaim_stats.kswapd_wakeups++;
+    }
+}
+
+uint64_t vm_reclaim_direct(uint64_t nr_pages)
+{
+    uint64_t freed = vm_reclaim_pages(nr_pages ? nr_pages : 1u);
+    irql_t old = reclaim_lock();
+    reclaim_stats.direct_runs++;
+    if (freed == 0) {
+        reclaim_stats.direct_failed++;
+    }
+    reclaim_unlock(old);
+    return freed;
+}
+
+int vm_reclaim_register_shrinker(vm_shrinker_fn fn)
+{
+    if (!fn) {
+        return RDNX_E_INVALID;
+    }
+    if (reclaim_nr_shrinkers >= VM_RECLAIM_MAX_SHRINKERS) {
+        return RDNX_E_BUSY;
+    }
+    reclaim_shrinkers[reclaim_nr_shrinkers++] = fn;
+    return RDNX_OK;
+}
+
+void vm_reclaim_get_stats(vm_reclaim_stats_t* out)
+{
+    if (!out) {
+        return;
+    }
+    if (reclaim_stats.wmark_min == 0) {
+        vm_reclaim_update_wmarks();
+    }
+    irql_t old = reclaim_lock();
+    *out = reclaim_stats;
+    reclaim_unlock(old);
+}
@@ -0,0 +1,61 @@
+#ifndef _RODNIX_VM_RECLAIM_H
+#define _RODNIX_VM_RECLAIM_H
+
+#include "vm_object.h"
+#include "../../include/bsd/sys/queue.h"
+#include <stdint.h>
+
+/* vm_lru_page_t::list */
+enum {
+    VM_LRU_NONE     = 0,
+    VM_LRU_INACTIVE = 1,
+    VM_LRU_ACTIVE   = 2,
+    VM_LRU_EVICTED  = 3, /* shadow entry: the next fault of this page is a refault */
+    VM_LRU_ISOLATED = 4, /* off the lists while a scanner examines it */
+};
+
+/* One resident page of a file object (vm_object_t::lru[page_index]). */
+typedef struct vm_lru_page {
+    TAILQ_ENTRY(vm_lru_page) link;
+    vm_object_t* object;
+    uint64_t index;
+    uint8_t list;
+    uint8_t referenced; /* accessed once while inactive; a second access activates */
+} vm_lru_page_t;
+
+typedef struct vm_reclaim_stats {
+    uint64_t active_pages;
+    uint64_t inactive_pages;
+    uint64_t scanned;
+    uint64_t activated;
+    uint64_t deactivated;
+    uint64_t evicted;        /* clean (or written back) file pages dropped */
+    uint64_t writeback;      /* dirty MAP_SHARED pages copied back before eviction */
+    uint64_t refaults;       /* evicted pages faulted in again */
+    uint64_t kswapd_wakeups;
+    uint64_t kswapd_runs;
+    uint64_t direct_runs;    /* allocation failed and reclaimed synchronously */
+    uint64_t direct_failed;  /* ... without freeing anything */
+    uint64_t shrunk_bytes;   /* released by shrinkers (ext2 inode data cache) */
+    uint64_t wmark_min;      /* PMM_ZONE_NORMAL watermarks, pages */
+    uint64_t wmark_low;
+    uint64_t wmark_high;
+} vm_reclaim_stats_t;
+
+/* Releases up to target_bytes of cached kernel data; returns bytes released. */
+typedef uint64_t (*vm_shrinker_fn)(uint64_t target_bytes);
+
+/* vm_object hooks: a file object page became resident / stopped being resident. */
+void vm_reclaim_page_added(vm_object_t* obj, uint64_t page_index);
+void vm_reclaim_page_removed(vm_object_t* obj, uint64_t page_index);
+
+/* Start the background reclaimer (kswapd). */
+void vm_reclaim_start(void);
+/* Allocation path: wake kswapd once free pages drop below the low watermark. */
+void vm_reclaim_wakeup_if_low(void);
+/* Allocation failed: reclaim synchronously, returns pages given back to the zone. */
+uint64_t vm_reclaim_direct(uint64_t nr_pages);
+int vm_reclaim_register_shrinker(vm_shrinker_fn fn);
+void vm_reclaim_get_stats(vm_reclaim_stats_t* out);
+
+#endif /* _RODNIX_VM_RECLAIM_H */
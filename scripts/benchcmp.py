@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Compare in-guest benchmark results against a checked-in baseline.
+
+Results are the "[BENCH] <name> <value> <unit>" lines printed by /bin/bench
+on the serial console (the boot log can be passed as is). The baseline has
+one benchmark per line:
+
+    <name> <unit> <lower|higher> <tolerance-%> <value|->
+
+"lower"/"higher" says which direction is better; "-" means no reference
+value has been recorded yet. A result worse than the baseline by more than
+the tolerance is a regression and makes the exit status 1. A result with no
+recorded value is reported as UNRECORDED with a warning; --strict turns that
+into a failure too, for CI once the reference run exists. --update rewrites the baseline
+values from the results, keeping units, directions and tolerances, and
+records --host in a "# recorded on:" line.
+"""
+
+import argparse
+import datetime
+import sys
+
+RECORDED_PREFIX = "# recorded on:"
+
+
+def parse_results(path):
+    results = {}
+    skipped = {}
+    done = False
+    with open(path, "r", encoding="utf-8", errors="replace") as f:
+        for raw in f:
+            line = raw.strip()
+            if not line.startswith("[BENCH] "):
+                continue
+            parts = line.split()
+            if len(parts) == 2 and parts[1] == "DONE":
+                done = True
+                continue
+            if len(parts) < 3 or parts[1] == "BEGIN":
+                continue
+            name = parts[1]
+            if parts[2] == "SKIP":
+                skipped[name] = " ".join(parts[3:])
+                continue
+            try:
+                results[name] = (int(parts[2]), parts[3] if len(parts) > 3 else "")
+            except ValueError:
+                continue
+    return results, skipped, done
+
+
+def parse_baseline(path):
+    entries = []
+    with open(path, "r", encoding="utf-8") as f:
+        for lineno, raw in enumerate(f, 1):
+            line = raw.split("#", 1)[0].strip()
+            if not line:
+                entries.append((None, raw.rstrip("\n")))
+                continue
+            parts = line.split()
+            if len(parts) != 5 or parts[2] not in ("lower", "higher"):
+                raise SystemExit(f"{path}:{lineno}: expected '<name> <unit> <lower|higher> <tol%> <value|->'")
+            value = None if parts[4] == "-" else int(parts[4])
+            entries.append(({
+                "name": parts[0],
+                "unit": parts[1],
+                "better": parts[2],
+                "tol": float(parts[3]),
+                "value": value,
+            }, raw.rstrip("\n")))
+    return entries
+
+
+def write_baseline(path, entries, results, host):
+    out = []
+    stamp = "{} {} {}".format(RECORDED_PREFIX, datetime.date.today().isoformat(), host or "unknown host")
+    stamped = False
+    for entry, raw in entries:
+        if entry is None:
+            if raw.startswith(RECORDED_PREFIX):
+                out.append(stamp)
+                stamped = True
+            else:
+                out.append(raw)
+            continue
+        if not stamped:
+            out.append(stamp)
+            stamped = True
+        value = entry["value"]
+        if entry["name"] in results:
+            value = results[entry["name"]][0]
+        out.append("{:<20} {:<5} {:<6} {:>4g} {}".format(
+            entry["name"], entry["unit"], entry["better"], entry["tol"],
+            "-" if value is None else value))
+    with open(path, "w", encoding="utf-8") as f:
+        f.write("\n".join(out) + "\n")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("baseline")
+    ap.add_argument("results", help="serial log or extracted [BENCH] lines")
+    ap.add_argument("--update", action="store_true", help="record results as the new baseline")
+    ap.add_argument("--host", default="", help="reference host description stored by --update")
+    ap.add_argument("--strict", action="store_true",
+                    help="fail on benchmarks whose baseline value is '-'")
+    args = ap.parse_args()
+
+    results, skipped, done = parse_results(args.results)
+    entries = parse_baseline(args.baseline)
+    if not done:
+        print("[bench] results are incomplete: no '[BENCH] DONE' marker")
+        return 1
+
+    if args.update:
+        write_baseline(args.baseline, entries, results, args.host)
+        print(f"[bench] baseline updated: {args.baseline}")
+        return 0
+
+    regressions = 0
+    unrecorded = 0
+    known = set()
+    print("{:<20} {:>12} {:>12} {:>8}  {}".format("benchmark", "baseline", "result", "delta", "verdict"))
+    for entry, _ in entries:
+        if entry is None:
+            continue
+        name = entry["name"]
+        known.add(name)
+        base = entry["value"]
+        if name not in results:
+            verdict = "SKIP (" + skipped[name] + ")" if name in skipped else "MISSING"
+            if base is not None and name not in skipped:
+                regressions += 1
+                verdict += " REGRESSION"
+            print("{:<20} {:>12} {:>12} {:>8}  {}".format(name, "-" if base is None else base, "-", "", verdict))
+            continue
+        value, unit = results[name]
+        if unit and unit != entry["unit"]:
+            print(f"[bench] {name}: unit mismatch ({unit} vs baseline {entry['unit']})")
+            regressions += 1
+            continue
+        if base is None:
+            unrecorded += 1
+            print("{:<20} {:>12} {:>12} {:>8}  {}".format(name, "-", value, "", "UNRECORDED"))
+            continue
+        delta = (value - base) * 100.0 / base if base else 0.0
+        worse = delta if entry["better"] == "lower" else -delta
+        verdict = "ok"
+        if worse > entry["tol"]:
+            verdict = "REGRESSION"
+            regressions += 1
+        elif worse < -entry["tol"]:
+            verdict = "improved"
+        print("{:<20} {:>12} {:>12} {:>+7.1f}%  {}".format(name, base, value, delta, verdict))
+
+    for name in sorted(set(results) - known):
+        print(f"[bench] {name}: not in baseline ({results[name][0]} {results[name][1]})")
+
+    if regressions:
+        print(f"[bench] {regressions} regression(s) beyond tolerance")
+        return 1
+    if unrecorded:
+        print(f"[bench] warning: {unrecorded} benchmark(s) have no baseline value; "
+              "record them with 'make bench-baseline' on the reference host")
+        if args.strict:
+            return 1
+    print("[bench] no regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
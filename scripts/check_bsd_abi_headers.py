@@ -109,8 +109,8 @@ def main() -> int:
     ]
     fcntl_names = [
         "O_RDONLY", "O_WRONLY", "O_RDWR", "O_ACCMODE", "O_NONBLOCK", "O_APPEND", "O_SYNC",
-        "O_NOFOLLOW", "O_CREAT", "O_TRUNC", "O_EXCL", "O_NOCTTY", "F_GETFD", "F_SETFD",
-        "F_GETFL", "F_SETFL", "FD_CLOEXEC", "AT_FDCWD",
+        "O_NOFOLLOW", "O_CREAT", "O_TRUNC", "O_EXCL", "O_NOCTTY", "O_DIRECT", "F_GETFD",
+        "F_SETFD", "F_GETFL", "F_SETFL", "FD_CLOEXEC", "AT_FDCWD",
     ]
     wait_names = [
         "WNOHANG", "WUNTRACED", "WCONTINUED", "WNOWAIT", "WEXITED", "WTRAPPED",
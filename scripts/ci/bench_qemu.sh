@@ -0,0 +1,129 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
+cd "$ROOT_DIR"
+
+LOG_FILE="${LOG_FILE:-bench.log}"
+TIMEOUT_SEC="${TIMEOUT_SEC:-180}"
+QEMU_BIN="${QEMU_BIN:-qemu-system-x86_64}"
+QEMU_NET_FLAGS="${QEMU_NET_FLAGS:--netdev user,id=net0,restrict=on -device e1000,netdev=net0}"
+QEMU_EXTRA_FLAGS="${QEMU_EXTRA_FLAGS:-}"
+ARCH="${ARCH:-x86_64}"
+BUILD_ROOT="${BUILD_ROOT:-build}"
+BUILD_DIR="${BUILD_DIR:-${BUILD_ROOT}/${ARCH}}"
+ISO_PATH="${ISO_PATH:-${BUILD_DIR}/rodnix.iso}"
+DISK_IMG="${DISK_IMG:-${BUILD_DIR}/rodnix-bench-disk.img}"
+DISK_MB="${DISK_MB:-128}"
+# Scratch NVMe namespace for the nvme_qd* block benchmarks; NVME_MB=0 drops it.
+NVME_IMG="${NVME_IMG:-${BUILD_DIR}/rodnix-bench-nvme.img}"
+NVME_MB="${NVME_MB:-64}"
+BASELINE="${BASELINE:-scripts/ci/bench_baseline.txt}"
+RESULTS="${RESULTS:-${BUILD_DIR}/bench-results.txt}"
+BENCH_UPDATE="${BENCH_UPDATE:-0}"
+# BENCH_STRICT=1: benchmarks without a baseline value fail the run instead of warning.
+BENCH_STRICT="${BENCH_STRICT:-0}"
+# Extra make variables for the image, e.g. MAKE_FLAGS="LTO=1 PGO=use".
+MAKE_FLAGS="${MAKE_FLAGS:-}"
+# PGO_COLLECT=1: after the suite init dumps the profile counters to serial
+# and the run ends at [PGO] DONE instead of being compared with the baseline.
+PGO_COLLECT="${PGO_COLLECT:-0}"
+FLAG_FILE="userland/rootfs/etc/bench.auto"
+PGO_FLAG_FILE="userland/rootfs/etc/pgo.auto"
+DONE_MARK="^\[BENCH\] DONE"
+if [ "$PGO_COLLECT" = "1" ]; then
+  DONE_MARK="^\[PGO\] DONE"
+fi
+
+cleanup() {
+  rm -f "$FLAG_FILE" "$PGO_FLAG_FILE"
+}
+trap cleanup EXIT
+
+dump_diag() {
+  if [ ! -f "$LOG_FILE" ]; then
+    echo "[bench] no log file: $LOG_FILE"
+    return
+  fi
+  echo "[bench] recent [BENCH] markers:"
+  grep "^\[BENCH\]\|^\[PGO\]" "$LOG_FILE" | tail -n 20 || true
+  echo "[bench] last boot log lines:"
+  tail -n 40 "$LOG_FILE" || true
+}
+
+touch "$FLAG_FILE"
+if [ "$PGO_COLLECT" = "1" ]; then
+  touch "$PGO_FLAG_FILE"
+else
+  rm -f "$PGO_FLAG_FILE"
+fi
+rm -f "$LOG_FILE"
+
+# shellcheck disable=SC2086
+make iso ARCH="$ARCH" BUILD_ROOT="$BUILD_ROOT" ${MAKE_FLAGS}
+mkdir -p "$(dirname "$DISK_IMG")"
+# Fresh filesystem every run so file benchmarks start from the same state.
+rm -f "$DISK_IMG"
+dd if=/dev/zero of="$DISK_IMG" bs=1m count="$DISK_MB" status=none
+python3 scripts/mkext2_demo.py --output "$DISK_IMG" --size-mb "$DISK_MB"
+QEMU_NVME_FLAGS=""
+if [ "$NVME_MB" != "0" ]; then
+  rm -f "$NVME_IMG"
+  dd if=/dev/zero of="$NVME_IMG" bs=1m count="$NVME_MB" status=none
+  QEMU_NVME_FLAGS="-drive file=$NVME_IMG,if=none,format=raw,id=nvm0 -device nvme,serial=rodnixbench,drive=nvm0"
+fi
+
+if ! command -v "$QEMU_BIN" >/dev/null 2>&1; then
+  echo "[bench] qemu not found: $QEMU_BIN"
+  exit 1
+fi
+
+set +e
+"$QEMU_BIN" -m 1G -display none -boot d -cdrom "$ISO_PATH" -serial file:"$LOG_FILE" -no-reboot -no-shutdown \
+  -drive file="$DISK_IMG",if=ide,format=raw,index=0,media=disk ${QEMU_NVME_FLAGS} ${QEMU_NET_FLAGS} ${QEMU_EXTRA_FLAGS} &
+QEMU_PID=$!
+set -e
+
+deadline=$((SECONDS + TIMEOUT_SEC))
+found=0
+while [ $SECONDS -lt $deadline ]; do
+  if [ -f "$LOG_FILE" ]; then
+    if grep -q "$DONE_MARK" "$LOG_FILE"; then
+      found=1
+      break
+    fi
+    if grep -q "^\[BENCH\] FAIL\|^\[PGO\] FAIL" "$LOG_FILE"; then
+      echo "[bench] benchmark suite reported FAIL"
+      dump_diag
+      kill "$QEMU_PID" >/dev/null 2>&1 || true
+      exit 1
+    fi
+  fi
+  sleep 1
+done
+
+kill "$QEMU_PID" >/dev/null 2>&1 || true
+wait "$QEMU_PID" 2>/dev/null || true
+
+if [ $found -ne 1 ]; then
+  echo "[bench] timeout waiting for $(echo "${DONE_MARK#^}" | tr -d '\\')"
+  dump_diag
+  exit 1
+fi
+
+grep "^\[BENCH\]" "$LOG_FILE" | tr -d '\r' > "$RESULTS"
+echo "[bench] results: $RESULTS"
+if [ "$PGO_COLLECT" = "1" ]; then
+  # Instrumented timings say nothing about the optimized build.
+  echo "[bench] profile log: $LOG_FILE"
+  exit 0
+fi
+if [ "$BENCH_UPDATE" = "1" ]; then
+  BENCH_HOST="$(uname -n) $(uname -m), $("$QEMU_BIN" --version | head -n 1)"
+  exec python3 scripts/benchcmp.py --update --host "$BENCH_HOST" "$BASELINE" "$RESULTS"
+fi
+CMP_FLAGS=""
+if [ "$BENCH_STRICT" = "1" ]; then
+  CMP_FLAGS="--strict"
+fi
+exec python3 scripts/benchcmp.py ${CMP_FLAGS} "$BASELINE" "$RESULTS"
@@ -8,13 +8,16 @@ LOG_FILE="${LOG_FILE:-boot.log}"
 TIMEOUT_SEC="${TIMEOUT_SEC:-20}"
 QEMU_BIN="${QEMU_BIN:-qemu-system-x86_64}"
 ARCH="${ARCH:-x86_64}"
-BUILD_DIR="${BUILD_DIR:-build/${ARCH}}"
+BUILD_ROOT="${BUILD_ROOT:-build}"
+BUILD_DIR="${BUILD_DIR:-${BUILD_ROOT}/${ARCH}}"
 ISO_PATH="${ISO_PATH:-${BUILD_DIR}/rodnix.iso}"
 DISK_IMG="${DISK_IMG:-${BUILD_DIR}/rodnix-disk.img}"
 DISK_MB="${DISK_MB:-128}"
 DISK_FS_STAMP="${DISK_FS_STAMP:-${BUILD_DIR}/rodnix-disk.ext2.stamp}"
 FRESH_DISK="${FRESH_DISK:-1}"
 FLAG_FILE="userland/rootfs/etc/contract.auto"
+# Extra make variables for the image, e.g. MAKE_FLAGS="KASAN=1".
+MAKE_FLAGS="${MAKE_FLAGS:-}"
 
 cleanup() {
   rm -f "$FLAG_FILE"
@@ -35,7 +38,7 @@ dump_diag() {
 touch "$FLAG_FILE"
 rm -f "$LOG_FILE"
 
-make iso ARCH="$ARCH"
+make iso ARCH="$ARCH" BUILD_ROOT="$BUILD_ROOT" ${MAKE_FLAGS}
 mkdir -p "$(dirname "$DISK_IMG")"
 if [ "$FRESH_DISK" = "1" ]; then
   rm -f "$DISK_IMG" "$DISK_FS_STAMP"
@@ -55,7 +58,7 @@ fi
 
 set +e
 "$QEMU_BIN" -m 1G -boot d -cdrom "$ISO_PATH" -serial file:"$LOG_FILE" -no-reboot -no-shutdown \
-  -drive file="$DISK_IMG",if=ide,format=raw,index=0,media=disk &
+  -drive file="$DISK_IMG",if=ide,format=raw,index=0,media=disk -device virtio-rng-pci &
 QEMU_PID=$!
 set -e
 
@@ -80,6 +83,17 @@ done
 if [ $found -eq 1 ]; then
   echo "[contract] contract markers detected: ALL PASS"
   kill "$QEMU_PID" >/dev/null 2>&1 || true
+  wait "$QEMU_PID" 2>/dev/null || true
+  # KASAN=1 images report bad accesses and keep running; any report fails the run.
+  if grep -q "^\[KASAN\] BUG" "$LOG_FILE"; then
+    echo "[contract] KASAN reported memory errors:"
+    grep -A 24 "^\[KASAN\] BUG" "$LOG_FILE" | head -n 200 || true
+    exit 1
+  fi
+  if ! python3 scripts/fsck_ext2.py -n "$DISK_IMG"; then
+    echo "[contract] offline fsck of $DISK_IMG reported problems"
+    exit 1
+  fi
   exit 0
 fi
 
@@ -15,6 +15,11 @@ DISK_IMG="${DISK_IMG:-${BUILD_DIR}/rodnix-disk.img}"
 DISK_MB="${DISK_MB:-128}"
 DISK_FS_STAMP="${DISK_FS_STAMP:-${BUILD_DIR}/rodnix-disk.ext2.stamp}"
 FLAG_FILE="userland/rootfs/etc/smoke.ifconfig.auto"
+# With an e1000 on the command line the driver must attach, not just ifconfig exit 0.
+NEED_E1000=0
+case "$QEMU_NET_FLAGS" in
+  *e1000*) NEED_E1000=1 ;;
+esac
 
 cleanup() {
   rm -f "$FLAG_FILE"
@@ -28,6 +33,7 @@ dump_diag() {
   fi
   echo "[smoke-ifconfig] recent markers:"
   grep "^\[SMK\]" "$LOG_FILE" | tail -n 20 || true
+  grep "^\[E1000\]" "$LOG_FILE" | tail -n 20 || true
   echo "[smoke-ifconfig] last boot log lines:"
   tail -n 80 "$LOG_FILE" || true
 }
@@ -59,6 +65,7 @@ set -e
 deadline=$((SECONDS + TIMEOUT_SEC))
 pass=0
 prompt=0
+nic=$((1 - NEED_E1000))
 while [ $SECONDS -lt $deadline ]; do
   if [ -f "$LOG_FILE" ]; then
     if grep -q "^\[SMK\] IFCONFIG PASS" "$LOG_FILE"; then
@@ -67,26 +74,33 @@ while [ $SECONDS -lt $deadline ]; do
     if grep -q "sh> " "$LOG_FILE" || grep -q " # " "$LOG_FILE"; then
       prompt=1
     fi
+    if grep -q "^\[E1000\] attached" "$LOG_FILE"; then
+      nic=1
+    fi
     if grep -q "^\[SMK\] IFCONFIG FAIL" "$LOG_FILE"; then
       echo "[smoke-ifconfig] scenario reported FAIL"
       dump_diag
       kill "$QEMU_PID" >/dev/null 2>&1 || true
       exit 1
     fi
-    if [ $pass -eq 1 ] && [ $prompt -eq 1 ]; then
+    if [ $pass -eq 1 ] && [ $prompt -eq 1 ] && [ $nic -eq 1 ]; then
       break
     fi
   fi
   sleep 1
 done
 
-if [ $pass -eq 1 ] && [ $prompt -eq 1 ]; then
+if [ $pass -eq 1 ] && [ $prompt -eq 1 ] && [ $nic -eq 1 ]; then
   echo "[smoke-ifconfig] PASS: ifconfig completed and shell prompt reached"
   kill "$QEMU_PID" >/dev/null 2>&1 || true
   exit 0
 fi
 
-echo "[smoke-ifconfig] timeout waiting for pass markers"
+if [ $pass -eq 1 ] && [ $nic -eq 0 ]; then
+  echo "[smoke-ifconfig] e1000 on the QEMU command line but the driver never attached"
+else
+  echo "[smoke-ifconfig] timeout waiting for pass markers"
+fi
 dump_diag
 kill "$QEMU_PID" >/dev/null 2>&1 || true
 exit 1
@@ -59,6 +59,11 @@ done
 if [ $found -eq 1 ]; then
   echo "${status_msg:-[smoke] boot marker detected}"
   kill "$QEMU_PID" >/dev/null 2>&1 || true
+  wait "$QEMU_PID" 2>/dev/null || true
+  if ! python3 scripts/fsck_ext2.py -n "$DISK_IMG"; then
+    echo "[smoke] offline fsck of $DISK_IMG reported problems"
+    exit 1
+  fi
   exit 0
 fi
 
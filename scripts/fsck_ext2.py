@@ -0,0 +1,711 @@
+#!/usr/bin/env python3
+"""
+Offline ext2 consistency checker for RodNIX disk images.
+
+Mirrors the checks of the in-guest /bin/fsck_ext2 so CI can verify the image
+the kernel wrote after QEMU exits:
+
+  pass 1  superblock/group descriptors, inode block maps and extent trees,
+          i_blocks
+  pass 2  directory structure ('.', '..', rec_len, file types, targets)
+  pass 3  reachability from the root and link counts
+  pass 4  block and inode bitmaps against what is actually referenced
+  pass 5  group descriptor and superblock free/used counters
+
+Exit status follows e2fsck: 0 clean, 1 errors corrected, 4 errors left
+uncorrected, 8 operational error.
+
+Extent-mapped inodes are walked node by node; index and leaf blocks count
+toward i_blocks and the block bitmap like indirect tables. flex_bg only moves
+bitmaps and inode tables out of their own group, which build_metadata
+already allows. Extent damage is reported but not repaired.
+"""
+
+from __future__ import annotations
+
+import argparse
+import struct
+import sys
+import time
+
+
+EXT2_MAGIC = 0xEF53
+ROOT_INO = 2
+NDIR_BLOCKS = 12
+IND_BLOCK = 12
+DIND_BLOCK = 13
+TIND_BLOCK = 14
+
+S_IFMT = 0xF000
+S_IFSOCK = 0xC000
+S_IFLNK = 0xA000
+S_IFREG = 0x8000
+S_IFBLK = 0x6000
+S_IFDIR = 0x4000
+S_IFCHR = 0x2000
+S_IFIFO = 0x1000
+
+FT_BY_MODE = {
+    S_IFREG: 1, S_IFDIR: 2, S_IFCHR: 3, S_IFBLK: 4,
+    S_IFIFO: 5, S_IFSOCK: 6, S_IFLNK: 7,
+}
+
+INCOMPAT_FILETYPE = 0x0002
+INCOMPAT_EXTENTS = 0x0040
+INCOMPAT_FLEX_BG = 0x0200
+INCOMPAT_SUPP = INCOMPAT_FILETYPE | INCOMPAT_EXTENTS | INCOMPAT_FLEX_BG  # same set the kernel driver mounts
+RO_COMPAT_SPARSE_SUPER = 0x0001
+RO_COMPAT_HUGE_FILE = 0x0008
+
+HUGE_FILE_FL = 0x00040000
+EXTENTS_FL = 0x00080000
+
+EXT_MAGIC = 0xF30A
+EXT_ROOT_ENTRIES = 4
+EXT_MAX_DEPTH = 5
+EXT_INIT_MAX_LEN = 32768  # longer lengths mark unwritten extents
+
+EXIT_OK = 0
+EXIT_FIXED = 1
+EXIT_UNCORRECTED = 4
+EXIT_OPERATIONAL = 8
+
+MAX_REPORT = 20  # per-category cap for repetitive bitmap diffs
+
+
+class FsckError(Exception):
+    pass
+
+
+class Inode:
+    __slots__ = ("raw", "mode", "size", "dtime", "links", "blocks", "blocks_hi", "flags",
+                 "file_acl", "block")
+
+    def __init__(self, raw: bytes) -> None:
+        self.raw = bytearray(raw)
+        self.mode, = struct.unpack_from("<H", raw, 0)
+        size_lo, = struct.unpack_from("<I", raw, 4)
+        self.dtime, = struct.unpack_from("<I", raw, 20)
+        self.links, = struct.unpack_from("<H", raw, 26)
+        self.blocks, = struct.unpack_from("<I", raw, 28)
+        self.flags, = struct.unpack_from("<I", raw, 32)
+        self.blocks_hi, = struct.unpack_from("<H", raw, 116)
+        self.block = list(struct.unpack_from("<15I", raw, 40))
+        self.file_acl, = struct.unpack_from("<I", raw, 104)
+        size_high, = struct.unpack_from("<I", raw, 108)
+        self.size = size_lo
+        if (self.mode & S_IFMT) == S_IFREG:
+            self.size |= size_high << 32
+
+    def pack(self) -> bytes:
+        struct.pack_into("<H", self.raw, 0, self.mode)
+        struct.pack_into("<I", self.raw, 20, self.dtime)
+        struct.pack_into("<H", self.raw, 26, self.links)
+        struct.pack_into("<I", self.raw, 28, self.blocks)
+        struct.pack_into("<H", self.raw, 116, self.blocks_hi)
+        struct.pack_into("<15I", self.raw, 40, *self.block)
+        return bytes(self.raw)
+
+    @property
+    def kind(self) -> int:
+        return self.mode & S_IFMT
+
+
+class Checker:
+    def __init__(self, path: str, repair: bool, verbose: bool) -> None:
+        self.path = path
+        self.repair = repair
+        self.verbose = verbose
+        self.errors = 0
+        self.fixed = 0
+        mode = "r+b" if repair else "rb"
+        try:
+            self.f = open(path, mode)
+        except OSError as exc:
+            raise FsckError(f"cannot open {path}: {exc}") from exc
+
+    # ------------------------------------------------------------------ I/O
+
+    def read_at(self, off: int, length: int) -> bytes:
+        self.f.seek(off)
+        data = self.f.read(length)
+        if len(data) != length:
+            raise FsckError(f"short read at offset {off}")
+        return data
+
+    def write_at(self, off: int, data: bytes) -> None:
+        self.f.seek(off)
+        self.f.write(data)
+
+    def read_block(self, blk: int) -> bytes:
+        return self.read_at(blk * self.bs, self.bs)
+
+    def write_block(self, blk: int, data: bytes) -> None:
+        self.write_at(blk * self.bs, data)
+
+    # ------------------------------------------------------------ reporting
+
+    def problem(self, msg: str, fixable: bool) -> bool:
+        """Record a problem; return True when the caller should fix it."""
+        self.errors += 1
+        do_fix = self.repair and fixable
+        if do_fix:
+            self.fixed += 1
+        suffix = " [fixed]" if do_fix else ""
+        print(f"fsck_ext2: {msg}{suffix}")
+        return do_fix
+
+    def info(self, msg: str) -> None:
+        if self.verbose:
+            print(f"fsck_ext2: {msg}")
+
+    # ----------------------------------------------------------- geometry
+
+    def load_super(self) -> None:
+        sb = bytearray(self.read_at(1024, 1024))
+        self.sb = sb
+        (self.inodes_count, self.blocks_count, _r, self.sb_free_blocks,
+         self.sb_free_inodes, self.first_data_block, log_bs) = struct.unpack_from("<7I", sb, 0)
+        self.bpg, = struct.unpack_from("<I", sb, 0x20)
+        self.ipg, = struct.unpack_from("<I", sb, 0x28)
+        magic, = struct.unpack_from("<H", sb, 0x38)
+        rev, = struct.unpack_from("<I", sb, 0x4C)
+        self.feature_compat, self.feature_incompat, self.feature_ro_compat = \
+            struct.unpack_from("<III", sb, 0x5C)
+        if magic != EXT2_MAGIC:
+            raise FsckError("bad superblock magic")
+        if log_bs > 2:
+            raise FsckError(f"unsupported block size 1024<<{log_bs}")
+        self.bs = 1024 << log_bs
+        if rev == 0:
+            self.first_ino, self.inode_size = 11, 128
+        else:
+            self.first_ino, = struct.unpack_from("<I", sb, 0x54)
+            self.inode_size, = struct.unpack_from("<H", sb, 0x58)
+        if self.feature_incompat & ~INCOMPAT_SUPP:
+            raise FsckError(f"unsupported incompat features 0x{self.feature_incompat:x}")
+        if self.inode_size < 128 or self.inode_size > self.bs or self.inode_size & (self.inode_size - 1):
+            raise FsckError(f"bad inode size {self.inode_size}")
+        if self.bpg == 0 or self.ipg == 0:
+            raise FsckError("zero blocks/inodes per group")
+        # A group's bitmap is one block; larger groups overrun it.
+        if self.bpg > self.bs * 8:
+            raise FsckError(f"blocks_per_group {self.bpg} exceeds bitmap capacity {self.bs * 8}")
+        if self.ipg > self.bs * 8:
+            raise FsckError(f"inodes_per_group {self.ipg} exceeds bitmap capacity {self.bs * 8}")
+        expect_first = 1 if self.bs == 1024 else 0
+        if self.first_data_block != expect_first:
+            raise FsckError(f"first_data_block {self.first_data_block}, expected {expect_first}")
+        self.groups = (self.blocks_count - self.first_data_block + self.bpg - 1) // self.bpg
+        if self.groups == 0:
+            raise FsckError("no block groups")
+        if self.inodes_count != self.ipg * self.groups:
+            self.problem(f"superblock inodes_count {self.inodes_count} != "
+                         f"{self.ipg} * {self.groups} groups", False)
+        self.inodes_count = min(self.inodes_count, self.ipg * self.groups)
+        self.itable_blocks = (self.ipg * self.inode_size + self.bs - 1) // self.bs
+        self.gdt_blocks = (self.groups * 32 + self.bs - 1) // self.bs
+        self.gdt_off = (self.first_data_block + 1) * self.bs
+        self.gdt = bytearray(self.read_at(self.gdt_off, self.groups * 32))
+
+    def gd(self, g: int) -> tuple[int, int, int, int, int, int]:
+        return struct.unpack_from("<IIIHHH", self.gdt, g * 32)
+
+    def group_first(self, g: int) -> int:
+        return self.first_data_block + g * self.bpg
+
+    def group_len(self, g: int) -> int:
+        return min(self.bpg, self.blocks_count - self.group_first(g))
+
+    def group_has_super(self, g: int) -> bool:
+        if not (self.feature_ro_compat & RO_COMPAT_SPARSE_SUPER) or g <= 1:
+            return True
+        for base in (3, 5, 7):
+            n = base
+            while n < g:
+                n *= base
+            if n == g:
+                return True
+        return False
+
+    def build_metadata(self) -> None:
+        self.meta = bytearray(self.blocks_count)
+        for g in range(self.groups):
+            first = self.group_first(g)
+            if self.group_has_super(g):
+                for b in range(first, min(first + 1 + self.gdt_blocks, self.blocks_count)):
+                    self.meta[b] = 1
+            bbm, ibm, itab, _fb, _fi, _ud = self.gd(g)
+            for name, start, count in (("block bitmap", bbm, 1), ("inode bitmap", ibm, 1),
+                                       ("inode table", itab, self.itable_blocks)):
+                if start < self.first_data_block or start + count > self.blocks_count:
+                    raise FsckError(f"group {g}: {name} at {start} out of range")
+                for b in range(start, start + count):
+                    if self.meta[b]:
+                        raise FsckError(f"group {g}: {name} block {b} overlaps other metadata")
+                    self.meta[b] = 1
+
+    # ------------------------------------------------------------- inodes
+
+    def inode_off(self, ino: int) -> int:
+        g, idx = divmod(ino - 1, self.ipg)
+        itab = self.gd(g)[2]
+        return itab * self.bs + idx * self.inode_size
+
+    def read_inode(self, ino: int) -> Inode:
+        return Inode(self.read_at(self.inode_off(ino), 128))
+
+    def write_inode(self, ino: int, inode: Inode) -> None:
+        self.write_at(self.inode_off(ino), inode.pack())
+
+    def inode_in_use(self, ino: int, inode: Inode) -> bool:
+        if ino < self.first_ino:
+            return True
+        return inode.mode != 0 and inode.links > 0 and inode.dtime == 0
+
+    def has_block_map(self, inode: Inode) -> bool:
+        kind = inode.kind
+        if kind in (S_IFREG, S_IFDIR):
+            return True
+        if kind == S_IFLNK:
+            acl_sectors = (self.bs // 512) if inode.file_acl else 0
+            return inode.blocks > acl_sectors  # fast symlinks keep the target in block[]
+        if inode.mode == 0:
+            if inode.flags & EXTENTS_FL:
+                return struct.unpack_from("<H", inode.raw, 42)[0] != 0
+            return any(inode.block)  # reserved inodes (bad blocks list etc.)
+        return False
+
+    def claim(self, blk: int, ino: int) -> None:
+        if self.owner[blk]:
+            self.problem(f"inode {ino}: block {blk} already claimed by inode {self.owner[blk]}",
+                         False)
+            self.dup[blk] = 1
+            return
+        self.owner[blk] = ino
+        self.cur_claims.append(blk)
+
+    def bad_pointer(self, blk: int) -> bool:
+        return blk < self.first_data_block or blk >= self.blocks_count or self.meta[blk] != 0
+
+    def walk(self, ino: int, blk: int, level: int, data_out: list[int] | None) -> tuple[int, bool]:
+        """Claim blk and everything under it. Returns (claimed, cleared_any)."""
+        self.claim(blk, ino)
+        claimed = 1
+        if level == 0:
+            if data_out is not None:
+                data_out.append(blk)
+            return claimed, False
+        table = bytearray(self.read_block(blk))
+        entries = list(struct.unpack_from(f"<{self.bs // 4}I", table, 0))
+        dirty = False
+        for i, child in enumerate(entries):
+            if child == 0:
+                continue
+            if self.bad_pointer(child):
+                if self.problem(f"inode {ino}: illegal block {child} in indirect block {blk}", True):
+                    struct.pack_into("<I", table, i * 4, 0)
+                    dirty = True
+                continue
+            c, _ = self.walk(ino, child, level - 1, data_out)
+            claimed += c
+        if dirty:
+            self.write_block(blk, bytes(table))
+        return claimed, dirty
+
+    def walk_extents(self, ino: int, node: bytes, depth: int, limit: int, lo: int,
+                     nxt: list[int], data_out: list[int]) -> int:
+        """Claim the blocks under one extent node. The root lives in i_block[]
+        and is not claimed here; nxt[0] is the first logical block the next
+        extent may start at, so keys ascend across the whole tree."""
+        magic, entries, emax, edepth = struct.unpack_from("<4H", node, 0)
+        if magic != EXT_MAGIC or emax == 0 or emax > limit or entries > emax or edepth != depth:
+            self.problem(f"inode {ino}: bad extent header at depth {depth}", False)
+            return 0
+        claimed = 0
+        for i in range(entries):
+            off = 12 + i * 12
+            key, = struct.unpack_from("<I", node, off)
+            if key < lo or key < nxt[0]:
+                self.problem(f"inode {ino}: extent key {key} out of order", False)
+                break
+            if depth > 0:
+                child, child_hi = struct.unpack_from("<IH", node, off + 4)
+                if child_hi or self.bad_pointer(child):
+                    self.problem(f"inode {ino}: illegal extent index block {child}", False)
+                    continue
+                self.claim(child, ino)
+                claimed += 1
+                claimed += self.walk_extents(ino, self.read_block(child), depth - 1,
+                                             (self.bs - 12) // 12, key, nxt, data_out)
+                continue
+            length, start_hi, start = struct.unpack_from("<HHI", node, off + 4)
+            unwritten = length > EXT_INIT_MAX_LEN
+            if unwritten:
+                length -= EXT_INIT_MAX_LEN
+            if length == 0 or start_hi:
+                self.problem(f"inode {ino}: bad extent at logical block {key}", False)
+                continue
+            nxt[0] = key + length
+            for blk in range(start, start + length):
+                if self.bad_pointer(blk):
+                    self.problem(f"inode {ino}: illegal block {blk} in extent at {key}", False)
+                    break
+                self.claim(blk, ino)
+                claimed += 1
+                if not unwritten:  # unwritten extents read as zeros: not directory data
+                    data_out.append(blk)
+        return claimed
+
+    def pass1(self) -> None:
+        self.owner = [0] * self.blocks_count
+        self.dup = bytearray(self.blocks_count)
+        self.used = bytearray(self.inodes_count + 1)
+        self.is_dir = bytearray(self.inodes_count + 1)
+        self.links = [0] * (self.inodes_count + 1)
+        self.dir_blocks: dict[int, list[int]] = {}
+        self.inode_blocks: dict[int, list[int]] = {}
+        acl_owner: dict[int, int] = {}
+        spb = self.bs // 512
+
+        for ino in range(1, self.inodes_count + 1):
+            inode = self.read_inode(ino)
+            if not self.inode_in_use(ino, inode):
+                continue
+            self.used[ino] = 1
+            self.links[ino] = inode.links
+            if inode.kind == S_IFDIR:
+                self.is_dir[ino] = 1
+            if ino == ROOT_INO and inode.kind != S_IFDIR:
+                raise FsckError("root inode is not a directory")
+            if not self.has_block_map(inode):
+                continue
+
+            self.cur_claims = []
+            data: list[int] = []
+            claimed = 0
+            inode_dirty = False
+            if inode.flags & EXTENTS_FL:
+                root = bytes(inode.raw[40:100])
+                depth, = struct.unpack_from("<H", root, 6)
+                if depth > EXT_MAX_DEPTH:
+                    self.problem(f"inode {ino}: extent tree depth {depth}", False)
+                else:
+                    claimed += self.walk_extents(ino, root, depth, EXT_ROOT_ENTRIES, 0, [0], data)
+            else:
+                for idx in range(15):
+                    blk = inode.block[idx]
+                    if blk == 0:
+                        continue
+                    if self.bad_pointer(blk):
+                        if self.problem(f"inode {ino}: illegal block {blk} at slot {idx}", True):
+                            inode.block[idx] = 0
+                            inode_dirty = True
+                        continue
+                    level = 0 if idx < NDIR_BLOCKS else idx - NDIR_BLOCKS + 1
+                    c, _ = self.walk(ino, blk, level, data)
+                    claimed += c
+            self.inode_blocks[ino] = self.cur_claims
+
+            if inode.file_acl:
+                if self.bad_pointer(inode.file_acl):
+                    self.problem(f"inode {ino}: illegal xattr block {inode.file_acl}", False)
+                else:
+                    claimed += 1
+                    if inode.file_acl not in acl_owner:
+                        acl_owner[inode.file_acl] = ino
+                        self.owner[inode.file_acl] = self.owner[inode.file_acl] or ino
+
+            # huge_file: 48-bit i_blocks, in fs blocks when the inode says so.
+            huge = bool(self.feature_ro_compat & RO_COMPAT_HUGE_FILE)
+            have = inode.blocks
+            unit = spb
+            if huge:
+                have |= inode.blocks_hi << 32
+                if inode.flags & HUGE_FILE_FL:
+                    unit = 1
+            expect = claimed * unit
+            if not huge and expect > 0xFFFFFFFF:
+                self.problem(f"inode {ino}: {claimed} blocks overflow i_blocks", False)
+            elif have != expect:
+                if self.problem(f"inode {ino}: i_blocks is {have}, should be {expect}", True):
+                    inode.blocks = expect & 0xFFFFFFFF
+                    if huge:
+                        inode.blocks_hi = expect >> 32
+                    inode_dirty = True
+            if inode.kind == S_IFDIR:
+                if inode.size % self.bs != 0:
+                    self.problem(f"directory inode {ino}: size {inode.size} not block aligned", False)
+                self.dir_blocks[ino] = data
+            if inode_dirty:
+                self.write_inode(ino, inode)
+
+    # ---------------------------------------------------------- directories
+
+    def pass2(self) -> None:
+        self.parent: dict[int, int] = {}
+        self.dotdot: dict[int, int] = {}
+        self.children: dict[int, list[int]] = {}
+        has_ft = bool(self.feature_incompat & INCOMPAT_FILETYPE)
+
+        for dino, blocks in self.dir_blocks.items():
+            kids: list[int] = []
+            self.children[dino] = kids
+            if not blocks:
+                self.problem(f"directory inode {dino}: no data blocks", False)
+                continue
+            for bidx, blk in enumerate(blocks):
+                buf = bytearray(self.read_block(blk))
+                dirty = False
+                pos = 0
+                prev = -1
+                entry_no = 0
+                while pos < self.bs:
+                    if pos + 8 > self.bs:
+                        break
+                    ino, rec_len, name_len, ftype = struct.unpack_from("<IHBB", buf, pos)
+                    if (rec_len < 8 or rec_len % 4 or pos + rec_len > self.bs
+                            or 8 + name_len > rec_len):
+                        msg = f"directory inode {dino} block {blk}: bad rec_len {rec_len} at {pos}"
+                        if self.problem(msg, True):
+                            if prev >= 0:
+                                struct.pack_into("<H", buf, prev + 4, self.bs - prev)
+                            else:
+                                struct.pack_into("<IHBB", buf, pos, 0, self.bs - pos, 0, 0)
+                            dirty = True
+                        break
+                    name = bytes(buf[pos + 8:pos + 8 + name_len])
+                    first_block = bidx == 0
+                    if first_block and entry_no == 0:
+                        if name != b"." or ino != dino:
+                            self.problem(f"directory inode {dino}: first entry is not '.'", False)
+                    elif first_block and entry_no == 1:
+                        if name != b"..":
+                            self.problem(f"directory inode {dino}: second entry is not '..'", False)
+                        else:
+                            self.dotdot[dino] = ino
+                    if ino != 0:
+                        if ino > self.inodes_count or not self.used[ino]:
+                            msg = (f"directory inode {dino}: entry '{name.decode(errors='replace')}' "
+                                   f"-> unused inode {ino}")
+                            if self.problem(msg, True):
+                                struct.pack_into("<I", buf, pos, 0)
+                                dirty = True
+                            ino = 0
+                    if ino != 0:
+                        if has_ft:
+                            kind = self.read_inode(ino).kind
+                            want = FT_BY_MODE.get(kind, 0)
+                            if ftype != want:
+                                msg = (f"directory inode {dino}: entry '{name.decode(errors='replace')}' "
+                                       f"file type {ftype}, should be {want}")
+                                if self.problem(msg, True):
+                                    buf[pos + 7] = want
+                                    dirty = True
+                        if name not in (b".", b".."):
+                            kids.append(ino)
+                            if self.is_dir[ino]:
+                                if ino in self.parent:
+                                    self.problem(f"directory inode {ino} has multiple parents "
+                                                 f"({self.parent[ino]}, {dino})", False)
+                                else:
+                                    self.parent[ino] = dino
+                    prev = pos
+                    pos += rec_len
+                    entry_no += 1
+                if dirty:
+                    self.write_block(blk, bytes(buf))
+
+    # ------------------------------------------------- reachability, links
+
+    def pass3(self) -> None:
+        reach = bytearray(self.inodes_count + 1)
+        refs = [0] * (self.inodes_count + 1)
+        reach[ROOT_INO] = 1
+        queue = [ROOT_INO]
+        while queue:
+            d = queue.pop()
+            refs[d] += 1  # '.'
+            if d == ROOT_INO:
+                refs[ROOT_INO] += 1  # root '..' points at itself
+            for k in self.children.get(d, []):
+                refs[k] += 1
+                if self.is_dir[k]:
+                    refs[d] += 1  # child's '..'
+                    if not reach[k]:
+                        reach[k] = 1
+                        queue.append(k)
+                else:
+                    reach[k] = 1
+
+        for d in range(1, self.inodes_count + 1):
+            if not self.is_dir[d] or not reach[d]:
+                continue
+            want = ROOT_INO if d == ROOT_INO else self.parent.get(d, 0)
+            got = self.dotdot.get(d)
+            if got is not None and want and got != want:
+                self.problem(f"directory inode {d}: '..' is {got}, should be {want}", False)
+
+        for ino in range(self.first_ino, self.inodes_count + 1):
+            if not self.used[ino] or ino == ROOT_INO:
+                continue
+            if not reach[ino]:
+                if self.problem(f"unattached inode {ino}", True):
+                    inode = self.read_inode(ino)
+                    inode.links = 0
+                    # dtime below inodes_count would read as an orphan-list link
+                    inode.dtime = max(int(time.time()), self.inodes_count + 1)
+                    self.write_inode(ino, inode)
+                    self.release_inode(ino)
+                continue
+            if refs[ino] != self.links[ino]:
+                if self.problem(f"inode {ino}: link count {self.links[ino]}, should be {refs[ino]}",
+                                True):
+                    inode = self.read_inode(ino)
+                    inode.links = refs[ino]
+                    self.write_inode(ino, inode)
+        if refs[ROOT_INO] != self.links[ROOT_INO]:
+            if self.problem(f"root inode: link count {self.links[ROOT_INO]}, "
+                            f"should be {refs[ROOT_INO]}", True):
+                inode = self.read_inode(ROOT_INO)
+                inode.links = refs[ROOT_INO]
+                self.write_inode(ROOT_INO, inode)
+
+    def release_inode(self, ino: int) -> None:
+        self.used[ino] = 0
+        self.is_dir[ino] = 0
+        for b in self.inode_blocks.get(ino, []):
+            if self.owner[b] == ino and not self.dup[b]:
+                self.owner[b] = 0
+
+    # ------------------------------------------------------------- bitmaps
+
+    def pass4(self) -> None:
+        self.group_free_blocks = [0] * self.groups
+        self.group_free_inodes = [0] * self.groups
+        self.group_dirs = [0] * self.groups
+        for g in range(self.groups):
+            bbm, ibm, _itab, _fb, _fi, _ud = self.gd(g)
+            first = self.group_first(g)
+            glen = self.group_len(g)
+
+            bmap = bytearray(self.read_block(bbm))
+            plus: list[int] = []
+            minus: list[int] = []
+            free = 0
+            for i in range(glen):
+                blk = first + i
+                want = 1 if (self.meta[blk] or self.owner[blk]) else 0
+                have = (bmap[i >> 3] >> (i & 7)) & 1
+                if not want:
+                    free += 1
+                if want != have:
+                    (plus if want else minus).append(blk)
+                    if want:
+                        bmap[i >> 3] |= 1 << (i & 7)
+                    else:
+                        bmap[i >> 3] &= ~(1 << (i & 7)) & 0xFF
+            self.group_free_blocks[g] = free
+            if plus or minus:
+                shown = " ".join([f"+{b}" for b in plus[:MAX_REPORT]] + [f"-{b}" for b in minus[:MAX_REPORT]])
+                more = "" if len(plus) + len(minus) <= 2 * MAX_REPORT else " ..."
+                if self.problem(f"group {g}: block bitmap differences: {shown}{more}", True):
+                    self.write_block(bbm, bytes(bmap))
+
+            imap = bytearray(self.read_block(ibm))
+            plus, minus = [], []
+            free = 0
+            dirs = 0
+            for i in range(self.ipg):
+                ino = g * self.ipg + i + 1
+                if ino > self.inodes_count:
+                    break
+                want = self.used[ino]
+                have = (imap[i >> 3] >> (i & 7)) & 1
+                if not want:
+                    free += 1
+                elif self.is_dir[ino]:
+                    dirs += 1
+                if want != have:
+                    (plus if want else minus).append(ino)
+                    if want:
+                        imap[i >> 3] |= 1 << (i & 7)
+                    else:
+                        imap[i >> 3] &= ~(1 << (i & 7)) & 0xFF
+            self.group_free_inodes[g] = free
+            self.group_dirs[g] = dirs
+            if plus or minus:
+                shown = " ".join([f"+{i}" for i in plus[:MAX_REPORT]] + [f"-{i}" for i in minus[:MAX_REPORT]])
+                more = "" if len(plus) + len(minus) <= 2 * MAX_REPORT else " ..."
+                if self.problem(f"group {g}: inode bitmap differences: {shown}{more}", True):
+                    self.write_block(ibm, bytes(imap))
+
+    # ------------------------------------------------------------ counters
+
+    def pass5(self) -> None:
+        gdt_dirty = False
+        for g in range(self.groups):
+            bbm, ibm, itab, fb, fi, ud = self.gd(g)
+            nfb, nfi, nud = self.group_free_blocks[g], self.group_free_inodes[g], self.group_dirs[g]
+            if (fb, fi, ud) != (nfb, nfi, nud):
+                msg = (f"group {g}: counters free_blocks/free_inodes/dirs {fb}/{fi}/{ud}, "
+                       f"should be {nfb}/{nfi}/{nud}")
+                if self.problem(msg, True):
+                    struct.pack_into("<IIIHHH", self.gdt, g * 32, bbm, ibm, itab, nfb, nfi, nud)
+                    gdt_dirty = True
+        if gdt_dirty:
+            self.write_at(self.gdt_off, bytes(self.gdt))
+
+        total_fb = sum(self.group_free_blocks)
+        total_fi = sum(self.group_free_inodes)
+        if self.sb_free_blocks != total_fb:
+            if self.problem(f"superblock free_blocks {self.sb_free_blocks}, should be {total_fb}", True):
+                struct.pack_into("<I", self.sb, 0x0C, total_fb)
+                self.write_at(1024, bytes(self.sb))
+        if self.sb_free_inodes != total_fi:
+            if self.problem(f"superblock free_inodes {self.sb_free_inodes}, should be {total_fi}", True):
+                struct.pack_into("<I", self.sb, 0x10, total_fi)
+                self.write_at(1024, bytes(self.sb))
+
+    # ----------------------------------------------------------------- run
+
+    def run(self) -> int:
+        self.load_super()
+        self.build_metadata()
+        self.info(f"{self.path}: {self.blocks_count} blocks x {self.bs}, "
+                  f"{self.inodes_count} inodes, {self.groups} groups")
+        self.pass1()
+        self.pass2()
+        self.pass3()
+        self.pass4()
+        self.pass5()
+        used_inodes = self.inodes_count - sum(self.group_free_inodes)
+        used_blocks = self.blocks_count - sum(self.group_free_blocks)
+        print(f"fsck_ext2: {self.path}: {used_inodes}/{self.inodes_count} inodes, "
+              f"{used_blocks}/{self.blocks_count} blocks, {self.errors} problem(s), {self.fixed} fixed")
+        self.f.close()
+        if self.errors == 0:
+            return EXIT_OK
+        if self.errors == self.fixed:
+            return EXIT_FIXED
+        return EXIT_UNCORRECTED
+
+
+def main() -> int:
+    ap = argparse.ArgumentParser(description="Check (and optionally repair) a RodNIX ext2 image")
+    ap.add_argument("image", help="disk image path")
+    mode = ap.add_mutually_exclusive_group()
+    mode.add_argument("-n", dest="repair", action="store_false", help="check only (default)")
+    mode.add_argument("-y", dest="repair", action="store_true", help="repair problems in place")
+    ap.set_defaults(repair=False)
+    ap.add_argument("-v", dest="verbose", action="store_true", help="print geometry")
+    args = ap.parse_args()
+    try:
+        return Checker(args.image, args.repair, args.verbose).run()
+    except FsckError as exc:
+        print(f"fsck_ext2: {args.image}: {exc}", file=sys.stderr)
+        return EXIT_OPERATIONAL
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+
+"""
+Generate the version and dependency tables of a loadable kernel module.
+
+Reads the undefined symbols of a module object (ET_REL, x86_64) and looks
+each one up in the symvers headers written by scripts/mkksymvers.py: the
+kernel's include/kmod_symvers.h and those of modules it imports from. The
+output C file puts one kmod_modversion_t per import in .rodnix_versions and
+one kmod_dep_t per providing module in .rodnix_deps; compile it and link it
+into the module with ld -r. A symbol nobody exports is an error here rather
+than at load time.
+
+  kmodpost.py --symvers <h> [--symvers <h>]... --output <mod.c> <module.o>
+"""
+
+import argparse
+import re
+import struct
+import sys
+from pathlib import Path
+
+SHT_SYMTAB = 2
+SHN_UNDEF = 0
+STB_GLOBAL = 1
+STB_WEAK = 2
+SYM_NAME_MAX = 60
+
+CRC_RE = re.compile(r"^#define KSYMCRC_(\w+) (0x[0-9a-fA-F]+)u?$")
+MOD_RE = re.compile(r'^#define KSYMVERS_MODULE "([^"]+)"$')
+
+
+def undefined_symbols(path: Path):
+    data = path.read_bytes()
+    if data[:4] != b"\x7fELF" or data[4] != 2 or data[5] != 1:
+        raise SystemExit(f"kmodpost: {path}: not an ELF64 little-endian object")
+    e_type, e_machine = struct.unpack_from("<HH", data, 16)
+    if e_type != 1 or e_machine != 62:
+        raise SystemExit(f"kmodpost: {path}: not an x86_64 relocatable object")
+    e_shoff, = struct.unpack_from("<Q", data, 40)
+    e_shentsize, e_shnum = struct.unpack_from("<HH", data, 58)
+    secs = [struct.unpack_from("<IIQQQQIIQQ", data, e_shoff + i * e_shentsize) for i in range(e_shnum)]
+    names = []
+    for sec in secs:
+        if sec[1] != SHT_SYMTAB:
+            continue
+        off, size, link, entsize = sec[4], sec[5], sec[6], sec[9]
+        str_off = secs[link][4]
+        for i in range(1, size // entsize):
+            st_name, st_info, _, st_shndx = struct.unpack_from("<IBBH", data, off + i * entsize)
+            if st_shndx != SHN_UNDEF or (st_info >> 4) not in (STB_GLOBAL, STB_WEAK):
+                continue
+            end = data.index(b"\0", str_off + st_name)
+            name = data[str_off + st_name:end].decode()
+            if name and name not in names:
+                names.append(name)
+    return names
+
+
+def load_symvers(paths):
+    table = {}
+    for p in paths:
+        owner = None
+        for line in Path(p).read_text(encoding="utf-8").splitlines():
+            m = MOD_RE.match(line.strip())
+            if m:
+                owner = m.group(1)
+                continue
+            m = CRC_RE.match(line.strip())
+            if m:
+                table[m.group(1)] = (int(m.group(2), 16), owner)
+    return table
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("object")
+    ap.add_argument("--symvers", action="append", default=[], required=True)
+    ap.add_argument("--output", required=True)
+    args = ap.parse_args()
+
+    table = load_symvers(args.symvers)
+    imports = []
+    deps = []
+    for name in undefined_symbols(Path(args.object)):
+        if name not in table:
+            raise SystemExit(f"kmodpost: {args.object}: '{name}' is not exported by the kernel or a known module")
+        if len(name) >= SYM_NAME_MAX:
+            raise SystemExit(f"kmodpost: {args.object}: symbol name '{name}' too long")
+        crc, owner = table[name]
+        imports.append((name, crc))
+        if owner and owner not in deps:
+            deps.append(owner)
+
+    out = [f"/* Auto-generated by scripts/kmodpost.py for {Path(args.object).name}. Do not edit. */",
+           '#include "kmod_abi.h"',
+           ""]
+    if imports:
+        out.append('__attribute__((used, section(".rodnix_versions")))')
+        out.append("static const kmod_modversion_t __kmod_versions[] = {")
+        for name, crc in sorted(imports):
+            out.append(f'    {{ 0x{crc:08x}u, "{name}" }},')
+        out.append("};")
+        out.append("")
+    if deps:
+        out.append('__attribute__((used, section(".rodnix_deps")))')
+        out.append("static const kmod_dep_t __kmod_deps[] = {")
+        for d in deps:
+            out.append(f'    {{ "{d}" }},')
+        out.append("};")
+        out.append("")
+    Path(args.output).write_text("\n".join(out), encoding="utf-8")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -13,6 +13,8 @@ import struct
 BLOCK_SIZE = 1024
 INODE_SIZE = 128
 INODES_PER_GROUP = 128
+BLOCKS_PER_GROUP = BLOCK_SIZE * 8  # one block bitmap per group
+INODE_TABLE_BLOCKS = (INODES_PER_GROUP * INODE_SIZE) // BLOCK_SIZE
 
 EXT2_S_IFDIR = 0x4000
 EXT2_S_IFREG = 0x8000
@@ -44,8 +46,8 @@ def dirent(ino: int, name: bytes, ftype: int, reclen: int | None = None) -> byte
 
 def inode_pack(mode: int, size: int, block0: int, links: int = 1) -> bytes:
     # ext2 inode (128 bytes)
-    # blocks field is number of 512-byte sectors
-    blocks_512 = ((size + 511) // 512)
+    # blocks field counts 512-byte sectors of allocated blocks, not bytes
+    blocks_512 = BLOCK_SIZE // 512
     fields = [
         mode,              # i_mode (H)
         0,                 # i_uid (H)
@@ -72,13 +74,33 @@ def build_image(path: str, size_mb: int) -> None:
     if total_blocks < 4096:
         raise ValueError("image too small; use at least 4MB")
 
-    # Layout (single block group)
+    # Groups of BLOCKS_PER_GROUP blocks starting at block 1. Every group
+    # carries a superblock + GDT copy (no sparse_super), its bitmaps and
+    # inode table. A runt last group too small for its own metadata is cut.
+    first_data_block = 1
+    group_count = (total_blocks - first_data_block + BLOCKS_PER_GROUP - 1) // BLOCKS_PER_GROUP
+    gdt_blocks = (group_count * 32 + BLOCK_SIZE - 1) // BLOCK_SIZE
+    overhead = 1 + gdt_blocks + 2 + INODE_TABLE_BLOCKS
+    last_len = total_blocks - first_data_block - (group_count - 1) * BLOCKS_PER_GROUP
+    if group_count > 1 and last_len < overhead + 16:
+        group_count -= 1
+        total_blocks = first_data_block + group_count * BLOCKS_PER_GROUP
+        gdt_blocks = (group_count * 32 + BLOCK_SIZE - 1) // BLOCK_SIZE
+        overhead = 1 + gdt_blocks + 2 + INODE_TABLE_BLOCKS
+
+    def group_first(g: int) -> int:
+        return first_data_block + g * BLOCKS_PER_GROUP
+
+    def group_len(g: int) -> int:
+        return min(BLOCKS_PER_GROUP, total_blocks - group_first(g))
+
+    # Layout of group 0
     sb_block = 1
     gdt_block = 2
-    bmap_block = 3
-    imap_block = 4
-    inode_table_block = 5
-    inode_table_blocks = (INODES_PER_GROUP * INODE_SIZE) // BLOCK_SIZE  # 16
+    bmap_block = gdt_block + gdt_blocks
+    imap_block = bmap_block + 1
+    inode_table_block = imap_block + 1
+    inode_table_blocks = INODE_TABLE_BLOCKS
     data_start = inode_table_block + inode_table_blocks
     root_block = data_start + 0
     hello_block = data_start + 1
@@ -87,58 +109,85 @@ def build_image(path: str, size_mb: int) -> None:
     info_block = data_start + 4
     used_upto = info_block
 
+    inodes_count = INODES_PER_GROUP * group_count
+    # Reserved inodes 1..10 plus the demo files; inode 11 (first_ino) stays free.
+    used_inode_list = list(range(1, 11)) + [HELLO_INO, README_INO, DOCS_INO, INFO_INO]
+    used_inodes = len(used_inode_list)
+
+    group_used = []
+    for g in range(group_count):
+        used = overhead if g > 0 else (used_upto - first_data_block + 1)
+        group_used.append(used)
+    free_blocks = sum(group_len(g) - group_used[g] for g in range(group_count))
+    free_inodes = inodes_count - used_inodes
+
     os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
     with open(path, "wb") as f:
         f.truncate(size_bytes)
 
     with open(path, "r+b") as f:
-        # Superblock @ 1024
-        free_blocks = total_blocks - (used_upto + 1)
-        free_inodes = INODES_PER_GROUP - 15  # reserve up to inode 15
         sb = bytearray(1024)
-        struct.pack_into("<I", sb, 0x00, INODES_PER_GROUP)   # inodes_count
+        struct.pack_into("<I", sb, 0x00, inodes_count)       # inodes_count
         struct.pack_into("<I", sb, 0x04, total_blocks)       # blocks_count
         struct.pack_into("<I", sb, 0x0C, free_blocks)        # free_blocks_count
         struct.pack_into("<I", sb, 0x10, free_inodes)        # free_inodes_count
-        struct.pack_into("<I", sb, 0x14, sb_block)           # first_data_block
+        struct.pack_into("<I", sb, 0x14, first_data_block)   # first_data_block
         struct.pack_into("<I", sb, 0x18, 0)                  # log_block_size=1024
-        struct.pack_into("<I", sb, 0x20, total_blocks - 1)   # blocks_per_group
+        struct.pack_into("<I", sb, 0x20, BLOCKS_PER_GROUP)   # blocks_per_group
+        struct.pack_into("<I", sb, 0x24, BLOCKS_PER_GROUP)   # frags_per_group
         struct.pack_into("<I", sb, 0x28, INODES_PER_GROUP)   # inodes_per_group
         struct.pack_into("<H", sb, 0x38, 0xEF53)             # magic
+        struct.pack_into("<H", sb, 0x3A, 1)                  # state: clean
         struct.pack_into("<I", sb, 0x4C, 1)                  # rev_level
         struct.pack_into("<I", sb, 0x54, 11)                 # first_ino
         struct.pack_into("<H", sb, 0x58, INODE_SIZE)         # inode_size
-        struct.pack_into("<I", sb, 0x5C, 0)                  # bg nr
-        struct.pack_into("<I", sb, 0x60, 0)                  # feature_compat
-        struct.pack_into("<I", sb, 0x64, 0x0002)             # feature_incompat: filetype
-        struct.pack_into("<I", sb, 0x68, 0)                  # feature_ro_compat
-        f.seek(BLOCK_SIZE)
-        f.write(sb)
-
-        # Group descriptor table @ block 2
-        gdt = bytearray(BLOCK_SIZE)
-        struct.pack_into("<I", gdt, 0x00, bmap_block)
-        struct.pack_into("<I", gdt, 0x04, imap_block)
-        struct.pack_into("<I", gdt, 0x08, inode_table_block)
-        struct.pack_into("<H", gdt, 0x0C, free_blocks & 0xFFFF)
-        struct.pack_into("<H", gdt, 0x0E, free_inodes & 0xFFFF)
-        struct.pack_into("<H", gdt, 0x10, 2)  # root + docs dirs
-        f.seek(gdt_block * BLOCK_SIZE)
-        f.write(gdt)
-
-        # Block bitmap
-        bmap = bytearray(BLOCK_SIZE)
-        for b in range(0, used_upto + 1):
-            set_bit(bmap, b)
-        f.seek(bmap_block * BLOCK_SIZE)
-        f.write(bmap)
-
-        # Inode bitmap
-        imap = bytearray(BLOCK_SIZE)
-        for i in range(1, 16):  # mark inodes 1..15 used
-            set_bit(imap, i - 1)
-        f.seek(imap_block * BLOCK_SIZE)
-        f.write(imap)
+        struct.pack_into("<I", sb, 0x5C, 0)                  # feature_compat
+        struct.pack_into("<I", sb, 0x60, 0x0002)             # feature_incompat: filetype
+        struct.pack_into("<I", sb, 0x64, 0)                  # feature_ro_compat
+
+        gdt = bytearray(gdt_blocks * BLOCK_SIZE)
+        for g in range(group_count):
+            first = group_first(g)
+            g_bmap = bmap_block if g == 0 else first + 1 + gdt_blocks
+            g_imap = g_bmap + 1
+            g_itab = g_imap + 1
+            g_free_inodes = INODES_PER_GROUP - (used_inodes if g == 0 else 0)
+            struct.pack_into("<I", gdt, g * 32 + 0x00, g_bmap)
+            struct.pack_into("<I", gdt, g * 32 + 0x04, g_imap)
+            struct.pack_into("<I", gdt, g * 32 + 0x08, g_itab)
+            struct.pack_into("<H", gdt, g * 32 + 0x0C, group_len(g) - group_used[g])
+            struct.pack_into("<H", gdt, g * 32 + 0x0E, g_free_inodes)
+            struct.pack_into("<H", gdt, g * 32 + 0x10, 2 if g == 0 else 0)  # root + docs dirs
+
+        for g in range(group_count):
+            first = group_first(g)
+            glen = group_len(g)
+            # Superblock (primary at byte 1024) and GDT copies
+            struct.pack_into("<H", sb, 0x5A, g)              # block_group_nr
+            f.seek(first * BLOCK_SIZE)
+            f.write(sb)
+            f.seek((first + 1) * BLOCK_SIZE)
+            f.write(gdt)
+
+            # Block bitmap: bit i is block first + i; bits past the group end stay set
+            g_bmap, g_imap, _ = struct.unpack_from("<III", gdt, g * 32)
+            bmap = bytearray(BLOCK_SIZE)
+            for i in range(group_used[g]):
+                set_bit(bmap, i)
+            for i in range(glen, BLOCK_SIZE * 8):
+                set_bit(bmap, i)
+            f.seek(g_bmap * BLOCK_SIZE)
+            f.write(bmap)
+
+            # Inode bitmap
+            imap = bytearray(BLOCK_SIZE)
+            if g == 0:
+                for ino in used_inode_list:
+                    set_bit(imap, ino - 1)
+            for i in range(INODES_PER_GROUP, BLOCK_SIZE * 8):
+                set_bit(imap, i)
+            f.seek(g_imap * BLOCK_SIZE)
+            f.write(imap)
 
         # Inode table
         itab = bytearray(inode_table_blocks * BLOCK_SIZE)
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+
+"""
+Generate symbol version headers (KSYMCRC_<sym>) for kernel module exports.
+
+Every EXPORT_SYMBOL(sym) in the scanned sources needs the declaration of
+sym from one of the scanned headers. The version is the CRC-32 of that
+declaration with comments and redundant whitespace removed, so changing a
+prototype changes the CRC and modules built against the old one are
+refused at load time. Several identical declarations are fine; declarations
+that disagree are an error.
+
+  mkksymvers.py <root>
+      kernel exports: kernel/ and drivers/ sources, headers from include/,
+      kernel/ and drivers/; writes include/kmod_symvers.h.
+
+  mkksymvers.py --module <name> --output <file> [--header <h>]... <src>...
+      exports of a loadable module; the header also records the module
+      name so scripts/kmodpost.py can turn imports into dependencies.
+"""
+
+import argparse
+import re
+import sys
+import zlib
+from pathlib import Path
+
+EXPORT_RE = re.compile(r"\bEXPORT_SYMBOL\s*\(\s*([A-Za-z_]\w*)\s*\)")
+
+
+def strip_comments(text: str) -> str:
+    text = re.sub(r"/\*.*?\*/", " ", text, flags=re.S)
+    return re.sub(r"//[^\n]*", " ", text)
+
+
+def top_level_statements(text: str):
+    """Split a header into top-level declarations (brace bodies dropped)."""
+    text = strip_comments(text)
+    text = "\n".join(l for l in text.splitlines() if not l.lstrip().startswith("#"))
+    cur = []
+    depth = 0
+    for ch in text:
+        if ch == "{":
+            depth += 1
+            continue
+        if ch == "}":
+            depth = max(depth - 1, 0)
+            if depth == 0:
+                cur = []
+            continue
+        if depth:
+            continue
+        if ch == ";":
+            yield "".join(cur)
+            cur = []
+        else:
+            cur.append(ch)
+
+
+def normalise(decl: str) -> str:
+    decl = re.sub(r"\s+", " ", decl).strip()
+    decl = re.sub(r"^extern ", "", decl)
+    decl = re.sub(r" ?([*(),\[\]]) ?", r"\1", decl)
+    return decl
+
+
+def find_declarations(headers, names):
+    found = {n: set() for n in names}
+    pats = {n: re.compile(r"\b" + re.escape(n) + r"\b") for n in names}
+    for h in headers:
+        for stmt in top_level_statements(h.read_text(encoding="utf-8", errors="replace")):
+            s = stmt.strip()
+            if not s or s.startswith("typedef"):
+                continue
+            for n, pat in pats.items():
+                m = pat.search(s)
+                if not m:
+                    continue
+                rest = s[m.end():].lstrip()
+                # A prototype, or an extern object declaration.
+                if rest.startswith("(") or (s.startswith("extern") and rest in ("", "[]")):
+                    found[n].add(normalise(s))
+    return found
+
+
+def collect_exports(sources):
+    names = []
+    for src in sources:
+        text = strip_comments(src.read_text(encoding="utf-8", errors="replace"))
+        for m in EXPORT_RE.finditer(text):
+            if m.group(1) not in names:
+                names.append(m.group(1))
+    return names
+
+
+def gen_header(rows, module, guard, origin):
+    out = [f"/* Auto-generated by scripts/mkksymvers.py from {origin}. Do not edit. */",
+           f"#ifndef {guard}",
+           f"#define {guard}",
+           ""]
+    if module:
+        out.append(f'#define KSYMVERS_MODULE "{module}"')
+        out.append("")
+    for name, crc, decl in rows:
+        out.append(f"/* {decl} */")
+        out.append(f"#define KSYMCRC_{name} 0x{crc:08x}u")
+    out.append("")
+    out.append(f"#endif /* {guard} */")
+    out.append("")
+    return "\n".join(out)
+
+
+def write_if_changed(path: Path, text: str):
+    if path.exists() and path.read_text(encoding="utf-8") == text:
+        return
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_text(text, encoding="utf-8")
+
+
+def versions(sources, headers):
+    names = collect_exports(sources)
+    decls = find_declarations(headers, names)
+    rows = []
+    for n in sorted(names):
+        d = sorted(decls[n])
+        if not d:
+            raise SystemExit(f"mkksymvers: no declaration for exported symbol '{n}'")
+        if len(d) > 1:
+            raise SystemExit(f"mkksymvers: conflicting declarations of '{n}': " + " | ".join(d))
+        rows.append((n, zlib.crc32(d[0].encode()) & 0xFFFFFFFF, d[0]))
+    return rows
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("paths", nargs="*")
+    ap.add_argument("--module")
+    ap.add_argument("--output")
+    ap.add_argument("--header", action="append", default=[])
+    args = ap.parse_args()
+
+    if args.module:
+        if not args.output or not args.paths:
+            ap.error("--module needs --output and at least one source")
+        sources = [Path(p) for p in args.paths]
+        headers = [Path(h) for h in args.header]
+        out = Path(args.output)
+        guard = "_" + re.sub(r"\W", "_", out.name.upper())
+        rows = versions(sources, headers)
+        write_if_changed(out, gen_header(rows, args.module, guard, ", ".join(args.paths)))
+        return 0
+
+    root = Path(args.paths[0] if args.paths else ".")
+    sources = sorted(p for d in ("kernel", "drivers") for p in (root / d).rglob("*.c"))
+    headers = sorted(p for d in ("include", "kernel", "drivers") for p in (root / d).rglob("*.h")
+                     if p.name != "kmod_symvers.h")
+    rows = versions(sources, headers)
+    write_if_changed(root / "include" / "kmod_symvers.h",
+                     gen_header(rows, None, "_RODNIX_KMOD_SYMVERS_H", "kernel EXPORT_SYMBOL()s"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
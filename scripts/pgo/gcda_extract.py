@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""Rebuild .gcda profile files from a RodNIX serial log.
+
+A PGO=gen kernel writes every instrumented object as a framed record
+(kernel/common/gcov.h); userland programs use the same framing through
+gcov(GCOV_OP_EMIT):
+
+    [GCOV] BEGIN <bytes> <path of the .gcda>
+    [GCOV] D <hex>
+    [GCOV] END <sum>
+
+Paths are the absolute .gcda names the instrumented build recorded.
+--map OLD=NEW rewrites a path prefix (first match wins); records outside
+every mapped prefix are skipped. Records whose length or byte sum do not
+check out are dropped with a warning.
+
+The same object can show up many times: libc is linked into every
+program and a program dumps again on every exit and exec. Such records
+are merged the way libgcov merges runs: arc counters are added up, the
+run count summed and sum_max kept as the maximum.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+GCOV_DATA_MAGIC = 0x67636461
+TAG_FUNCTION = 0x01000000
+TAG_OBJECT_SUMMARY = 0xA1000000
+TAG_COUNTER_BASE = 0x01A10000
+
+
+def parse_log(path):
+    """Yield (gcda_path, data) for every complete, verified record."""
+    cur = None
+    with open(path, "r", encoding="utf-8", errors="replace") as f:
+        for lineno, raw in enumerate(f, 1):
+            line = raw.strip()
+            if not line.startswith("[GCOV] "):
+                continue
+            parts = line.split(" ", 3)
+            kind = parts[1] if len(parts) > 1 else ""
+            if kind == "BEGIN" and len(parts) == 4:
+                if cur:
+                    print(f"{path}:{lineno}: record for {cur[1]} not terminated", file=sys.stderr)
+                try:
+                    cur = (int(parts[2]), parts[3], bytearray())
+                except ValueError:
+                    cur = None
+            elif kind == "D" and cur and len(parts) >= 3:
+                try:
+                    cur[2].extend(bytes.fromhex(parts[2]))
+                except ValueError:
+                    print(f"{path}:{lineno}: bad data line", file=sys.stderr)
+                    cur = None
+            elif kind == "END" and cur and len(parts) >= 3:
+                size, name, data = cur
+                cur = None
+                try:
+                    want = int(parts[2], 16)
+                except ValueError:
+                    want = -1
+                if len(data) != size or (sum(data) & 0xFFFFFFFF) != want:
+                    print(f"{path}:{lineno}: {name}: length or checksum mismatch, dropped", file=sys.stderr)
+                    continue
+                yield name, bytes(data)
+
+
+class Gcda:
+    """Parsed .gcda: header words, summary and per-function counter records."""
+
+    def __init__(self, data):
+        words = struct.unpack(f"<{len(data) // 4}I", data[: len(data) // 4 * 4])
+        if len(words) < 4 or words[0] != GCOV_DATA_MAGIC:
+            raise ValueError("not a gcda image")
+        # GCC 12 added a checksum word to the header and counts record
+        # lengths in bytes instead of 32-bit words.
+        if words[3] in (TAG_FUNCTION, TAG_OBJECT_SUMMARY):
+            pos, self.unit = 3, 1
+        else:
+            pos, self.unit = 4, 4
+        self.header = list(words[:pos])
+        self.runs = 0
+        self.sum_max = 0
+        self.has_summary = False
+        self.records = []  # [tag, payload words]
+        while pos + 2 <= len(words):
+            tag, length = words[pos], words[pos + 1]
+            nwords = length // self.unit
+            payload = list(words[pos + 2 : pos + 2 + nwords])
+            if len(payload) != nwords:
+                raise ValueError("truncated record")
+            pos += 2 + nwords
+            if tag == TAG_OBJECT_SUMMARY:
+                self.has_summary = True
+                self.runs, self.sum_max = payload[0], payload[1]
+                continue
+            self.records.append([tag, payload])
+
+    def merge(self, other):
+        if self.header != other.header or len(self.records) != len(other.records):
+            raise ValueError("profiles of different builds")
+        for mine, theirs in zip(self.records, other.records):
+            if mine[0] != theirs[0] or len(mine[1]) != len(theirs[1]):
+                raise ValueError("record layout differs")
+            if mine[0] == TAG_FUNCTION:
+                if mine[1] != theirs[1]:
+                    raise ValueError("function checksum differs")
+                continue
+            vals = mine[1]
+            for i in range(0, len(vals) - 1, 2):
+                a = vals[i] | (vals[i + 1] << 32)
+                b = theirs[1][i] | (theirs[1][i + 1] << 32)
+                s = (a + b) & 0xFFFFFFFFFFFFFFFF
+                vals[i], vals[i + 1] = s & 0xFFFFFFFF, s >> 32
+        self.runs += other.runs
+        self.sum_max = max(self.sum_max, other.sum_max)
+
+    def encode(self):
+        words = list(self.header)
+        if self.has_summary:
+            words += [TAG_OBJECT_SUMMARY, 2 * self.unit, self.runs, self.sum_max]
+        for tag, payload in self.records:
+            words += [tag, len(payload) * self.unit] + payload
+        return struct.pack(f"<{len(words)}I", *words)
+
+
+def map_path(name, maps):
+    for old, new in maps:
+        if name.startswith(old):
+            return os.path.join(new, name[len(old) :].lstrip("/"))
+    return None
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("log", help="serial log of a PGO=gen run")
+    ap.add_argument("--map", action="append", default=[], metavar="OLD=NEW",
+                    help="rewrite the .gcda path prefix OLD to directory NEW")
+    ap.add_argument("--list", action="store_true", help="only list the records found")
+    args = ap.parse_args()
+
+    maps = []
+    for m in args.map:
+        if "=" not in m:
+            raise SystemExit(f"--map expects OLD=NEW, got '{m}'")
+        old, new = m.split("=", 1)
+        maps.append((old, new))
+
+    profiles = {}
+    dumps = 0
+    for name, data in parse_log(args.log):
+        dumps += 1
+        if args.list:
+            print(f"{len(data):8d} {name}")
+            continue
+        out = map_path(name, maps) if maps else name
+        if out is None:
+            continue
+        try:
+            gcda = Gcda(data)
+        except (ValueError, struct.error) as e:
+            print(f"{name}: {e}, dropped", file=sys.stderr)
+            continue
+        if out in profiles:
+            try:
+                profiles[out].merge(gcda)
+            except ValueError as e:
+                print(f"{name}: {e}, later copy dropped", file=sys.stderr)
+            continue
+        profiles[out] = gcda
+
+    for out, gcda in sorted(profiles.items()):
+        os.makedirs(os.path.dirname(out) or ".", exist_ok=True)
+        with open(out, "wb") as f:
+            f.write(gcda.encode())
+    if not args.list:
+        print(f"[pgo] {dumps} records, {len(profiles)} .gcda files written")
+    if dumps == 0:
+        print("[pgo] no [GCOV] records in the log (not a PGO=gen build?)", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,81 @@
+#!/usr/bin/env bash
+# Size and speed of the optimization modes side by side: every variant is
+# built into its own BUILD_ROOT and runs the QEMU bench suite; the report
+# lists kernel and userland section sizes and compares each variant's bench
+# results with the plain build. PGO variants reuse the profile in PGO_DIR,
+# collecting one first (scripts/pgo/pgo.sh collect) if there is none.
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
+cd "$ROOT_DIR"
+
+ARCH="${ARCH:-x86_64}"
+REPORT_ROOT="${REPORT_ROOT:-build/opt-report}"
+PGO_DIR="${PGO_DIR:-build/pgo/${ARCH}}"
+VARIANTS="${VARIANTS:-base lto pgo lto+pgo}"
+SIZE="${SIZE:-size}"
+REPORT="${REPORT:-${REPORT_ROOT}/report.txt}"
+
+variant_flags() {
+  case "$1" in
+    base) echo "" ;;
+    lto) echo "LTO=1" ;;
+    pgo) echo "PGO=use PGO_DIR=$PGO_ABS" ;;
+    lto+pgo) echo "LTO=1 PGO=use PGO_DIR=$PGO_ABS" ;;
+    *) echo "[opt-report] unknown variant: $1" >&2; exit 2 ;;
+  esac
+}
+
+# text data bss of one ELF, or of all userland programs together.
+elf_size() {
+  "$SIZE" "$@" | awk 'NR > 1 { t += $1; d += $2; b += $3 } END { printf "%10d %10d %10d\n", t, d, b }'
+}
+
+mkdir -p "$REPORT_ROOT" "$PGO_DIR"
+PGO_ABS="$(cd "$PGO_DIR" && pwd)"
+case " $VARIANTS " in
+  *pgo*)
+    if [ -z "$(find "$PGO_ABS" -name '*.gcda' -print -quit)" ]; then
+      PGO_DIR="$PGO_DIR" ARCH="$ARCH" bash scripts/pgo/pgo.sh collect
+    fi
+    ;;
+esac
+
+BASELINE_TMP="$(mktemp)"
+SCRATCH="$(mktemp)"
+trap 'rm -f "$BASELINE_TMP" "$SCRATCH"' EXIT
+cp scripts/ci/bench_baseline.txt "$BASELINE_TMP"
+
+for v in $VARIANTS; do
+  root="${REPORT_ROOT}/${v}"
+  echo "[opt-report] building and running: $v"
+  rm -rf userland/rootfs/bin
+  cp scripts/ci/bench_baseline.txt "$SCRATCH"
+  # Results only; comparisons happen below against the base variant.
+  ARCH="$ARCH" BUILD_ROOT="$root" BASELINE="$SCRATCH" BENCH_UPDATE=1 \
+    LOG_FILE="${root}/bench.log" MAKE_FLAGS="$(variant_flags "$v")" bash scripts/ci/bench_qemu.sh
+done
+
+{
+  echo "Build optimization report ($(date -u +%Y-%m-%dT%H:%M:%SZ), $(git rev-parse --short HEAD 2>/dev/null || echo unknown))"
+  echo ""
+  printf "%-10s %-9s %10s %10s %10s\n" variant image text data bss
+  for v in $VARIANTS; do
+    root="${REPORT_ROOT}/${v}"
+    printf "%-10s %-9s %s\n" "$v" kernel "$(elf_size "${root}/${ARCH}/rodnix.kernel")"
+    printf "%-10s %-9s %s\n" "$v" userland "$(elf_size "${root}"/userland/"${ARCH}"/*.elf)"
+  done
+  first=""
+  for v in $VARIANTS; do
+    results="${REPORT_ROOT}/${v}/${ARCH}/bench-results.txt"
+    if [ -z "$first" ]; then
+      first="$v"
+      python3 scripts/benchcmp.py --update "$BASELINE_TMP" "$results" >/dev/null
+      continue
+    fi
+    echo ""
+    echo "== $v vs $first =="
+    python3 scripts/benchcmp.py "$BASELINE_TMP" "$results" || true
+  done
+} | tee "$REPORT"
+echo "[opt-report] report: $REPORT"
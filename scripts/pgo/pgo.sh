@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+# Profile-guided build of kernel and userland.
+#
+#   collect: PGO=gen image, QEMU bench run, .gcda files extracted to PGO_DIR
+#   build:   PGO=use image from PGO_DIR, bench run compared with the baseline
+#   all:     both (default)
+#
+# LTO=1 adds link-time optimization to the PGO=use build. Each stage has its
+# own BUILD_ROOT so the instrumented objects never mix with the final ones.
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/../.." && pwd)"
+cd "$ROOT_DIR"
+
+STAGE="${1:-all}"
+ARCH="${ARCH:-x86_64}"
+LTO="${LTO:-0}"
+GEN_ROOT="${GEN_ROOT:-build/pgo-gen}"
+USE_ROOT="${USE_ROOT:-build/pgo-use}"
+PGO_DIR="${PGO_DIR:-build/pgo/${ARCH}}"
+PGO_LOG="${PGO_LOG:-${GEN_ROOT}/pgo.log}"
+# The instrumented run is slower and ends with the profile dump.
+PGO_TIMEOUT_SEC="${PGO_TIMEOUT_SEC:-900}"
+
+case "$STAGE" in
+  collect|build|all) ;;
+  *) echo "usage: $0 [collect|build|all]"; exit 2 ;;
+esac
+
+mkdir -p "$GEN_ROOT" "$PGO_DIR"
+GEN_ABS="$(cd "$GEN_ROOT" && pwd)"
+PGO_ABS="$(cd "$PGO_DIR" && pwd)"
+
+if [ "$STAGE" != "build" ]; then
+  echo "[pgo] instrumented build and profile run"
+  # rootfs/bin is shared by all builds; start from the instrumented programs.
+  rm -rf userland/rootfs/bin
+  PGO_COLLECT=1 ARCH="$ARCH" BUILD_ROOT="$GEN_ROOT" LOG_FILE="$PGO_LOG" TIMEOUT_SEC="$PGO_TIMEOUT_SEC" \
+    MAKE_FLAGS="PGO=gen" bash scripts/ci/bench_qemu.sh
+  rm -rf "$PGO_ABS"
+  python3 scripts/pgo/gcda_extract.py "$PGO_LOG" \
+    --map "${GEN_ABS}/${ARCH}/=${PGO_ABS}" \
+    --map "${GEN_ABS}/userland/${ARCH}/=${PGO_ABS}/userland"
+fi
+
+if [ "$STAGE" != "collect" ]; then
+  if [ -z "$(find "$PGO_ABS" -name '*.gcda' -print -quit 2>/dev/null)" ]; then
+    echo "[pgo] no profile in $PGO_DIR; run '$0 collect' first"
+    exit 1
+  fi
+  echo "[pgo] optimized build (PGO=use LTO=$LTO)"
+  rm -rf userland/rootfs/bin
+  ARCH="$ARCH" BUILD_ROOT="$USE_ROOT" MAKE_FLAGS="PGO=use LTO=$LTO PGO_DIR=$PGO_ABS" \
+    bash scripts/ci/bench_qemu.sh
+fi
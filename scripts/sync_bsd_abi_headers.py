@@ -134,6 +134,7 @@ def render_fcntl(vals: dict[str, int]) -> str:
         f"#define O_TRUNC    {fmt_hex(vals['O_TRUNC'])}",
         f"#define O_EXCL     {fmt_hex(vals['O_EXCL'])}",
         f"#define O_NOCTTY   {fmt_hex(vals['O_NOCTTY'])}",
+        f"#define O_DIRECT   0x{vals['O_DIRECT']:08x}",
         "",
         f"#define F_GETFD {vals['F_GETFD']}",
         f"#define F_SETFD {vals['F_SETFD']}",
@@ -272,8 +273,8 @@ def main() -> int:
     ]
     fcntl_names = [
         "O_RDONLY", "O_WRONLY", "O_RDWR", "O_ACCMODE", "O_NONBLOCK", "O_APPEND", "O_SYNC",
-        "O_NOFOLLOW", "O_CREAT", "O_TRUNC", "O_EXCL", "O_NOCTTY", "F_GETFD", "F_SETFD",
-        "F_GETFL", "F_SETFL", "FD_CLOEXEC", "AT_FDCWD",
+        "O_NOFOLLOW", "O_CREAT", "O_TRUNC", "O_EXCL", "O_NOCTTY", "O_DIRECT", "F_GETFD",
+        "F_SETFD", "F_GETFL", "F_SETFL", "FD_CLOEXEC", "AT_FDCWD",
     ]
     wait_names = ["WNOHANG", "WUNTRACED", "WCONTINUED", "WNOWAIT", "WEXITED", "WTRAPPED"]
     signal_names = ["SIG2STR_MAX"]
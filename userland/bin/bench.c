@@ -0,0 +1,698 @@
+/*
+ * bench.c
+ * In-guest benchmark suite (make bench): lmbench-style latency/bandwidth
+ * probes, a build-like file workload and fio-style random reads on NVMe. One result per line on stdout:
+ *
+ *   [BENCH] <name> <value> <unit>
+ *   [BENCH] <name> SKIP <reason>
+ *
+ * framed by "[BENCH] BEGIN <version>" and "[BENCH] DONE". scripts/benchcmp.py
+ * compares the lines against scripts/ci/bench_baseline.txt.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "posix_syscall.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "sys/stat.h"
+#include "sys/wait.h"
+#include "sys/mman.h"
+#include "time.h"
+
+#define BENCH_VERSION 1
+#define BENCH_MIN_NS 200000000ULL  /* each timed loop runs at least 200 ms */
+#define BENCH_PAGE 4096u
+
+#define AF_INET 2
+#define SOCK_DGRAM 2
+#define NET_NET0_ADDR 0x0A00020Fu
+
+typedef struct sockaddr_in {
+    uint16_t sin_family;
+    uint16_t sin_port;
+    uint32_t sin_addr;
+} sockaddr_in_t;
+
+static uint8_t bench_buf[64u * 1024u];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void report(const char* name, uint64_t value, const char* unit)
+{
+    printf("[BENCH] %s %llu %s\n", name, (unsigned long long)value, unit);
+    fflush(stdout);
+}
+
+static void skip(const char* name, const char* why)
+{
+    printf("[BENCH] %s SKIP %s\n", name, why);
+    fflush(stdout);
+}
+
+/* Run op() until BENCH_MIN_NS elapsed (at least min_iters times); ns per op, 0 on failure. */
+static uint64_t time_loop(int (*op)(void* ctx), void* ctx, uint32_t min_iters)
+{
+    uint64_t iters = 0;
+    uint64_t t0 = now_ns();
+    uint64_t t1 = t0;
+    while (iters < min_iters || t1 - t0 < BENCH_MIN_NS) {
+        if (op(ctx) != 0) {
+            return 0;
+        }
+        iters++;
+        t1 = now_ns();
+    }
+    return iters ? (t1 - t0) / iters : 0;
+}
+
+/* ============================================================================
+ * Syscalls
+ * ============================================================================ */
+
+static int op_getpid(void* ctx)
+{
+    (void)ctx;
+    (void)getpid();
+    return 0;
+}
+
+static int op_write_null(void* ctx)
+{
+    int fd = *(int*)ctx;
+    return write(fd, bench_buf, 1) == 1 ? 0 : -1;
+}
+
+static void bench_syscalls(void)
+{
+    uint64_t ns = time_loop(op_getpid, NULL, 1000);
+    if (ns) {
+        report("lat_syscall_null", ns, "ns");
+    } else {
+        skip("lat_syscall_null", "getpid");
+    }
+
+    int fd = open("/dev/null", O_WRONLY);
+    ns = (fd >= 0) ? time_loop(op_write_null, &fd, 1000) : 0;
+    if (ns) {
+        report("lat_syscall_write", ns, "ns");
+    } else {
+        skip("lat_syscall_write", "/dev/null");
+    }
+    if (fd >= 0) {
+        (void)close(fd);
+    }
+}
+
+/* ============================================================================
+ * Pipes and context switches
+ * ============================================================================ */
+
+typedef struct pingpong {
+    int to_child;
+    int from_child;
+} pingpong_t;
+
+static int op_pingpong(void* ctx)
+{
+    pingpong_t* pp = (pingpong_t*)ctx;
+    char c = 'x';
+    if (write(pp->to_child, &c, 1) != 1 || read(pp->from_child, &c, 1) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Token passed back and forth between two processes: one round trip = two switches. */
+static void bench_ctx(void)
+{
+    int a[2] = {-1, -1};
+    int b[2] = {-1, -1};
+    if (pipe(a) != 0 || pipe(b) != 0) {
+        skip("lat_pipe", "pipe");
+        skip("lat_ctx", "pipe");
+        return;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        char c;
+        (void)close(a[1]);
+        (void)close(b[0]);
+        while (read(a[0], &c, 1) == 1) {
+            if (write(b[1], &c, 1) != 1) {
+                break;
+            }
+        }
+        _exit(0);
+    }
+    (void)close(a[0]);
+    (void)close(b[1]);
+    pingpong_t pp = { a[1], b[0] };
+    uint64_t ns = (pid > 0) ? time_loop(op_pingpong, &pp, 100) : 0;
+    (void)close(a[1]);
+    (void)close(b[0]);
+    if (pid > 0) {
+        int status = 0;
+        (void)waitpid(pid, &status, 0);
+    }
+    if (ns) {
+        report("lat_pipe", ns, "ns");
+        report("lat_ctx", ns / 2u, "ns");
+    } else {
+        skip("lat_pipe", "fork");
+        skip("lat_ctx", "fork");
+    }
+}
+
+static void bench_pipe_bw(void)
+{
+    const uint64_t total = 4u * 1024u * 1024u;
+    int p[2] = {-1, -1};
+    if (pipe(p) != 0) {
+        skip("bw_pipe", "pipe");
+        return;
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        (void)close(p[0]);
+        for (uint64_t sent = 0; sent < total;) {
+            ssize_t n = write(p[1], bench_buf, sizeof(bench_buf));
+            if (n <= 0) {
+                break;
+            }
+            sent += (uint64_t)n;
+        }
+        _exit(0);
+    }
+    (void)close(p[1]);
+    uint64_t got = 0;
+    uint64_t t0 = now_ns();
+    while (pid > 0 && got < total) {
+        ssize_t n = read(p[0], bench_buf, sizeof(bench_buf));
+        if (n <= 0) {
+            break;
+        }
+        got += (uint64_t)n;
+    }
+    uint64_t dt = now_ns() - t0;
+    (void)close(p[0]);
+    if (pid > 0) {
+        int status = 0;
+        (void)waitpid(pid, &status, 0);
+    }
+    if (got == total && dt > 0) {
+        report("bw_pipe", got * 1000000ULL / dt, "KB/s");  /* bytes/ns * 1e9 / 1e3 */
+    } else {
+        skip("bw_pipe", "short transfer");
+    }
+}
+
+/* ============================================================================
+ * Processes
+ * ============================================================================ */
+
+static int op_fork(void* ctx)
+{
+    (void)ctx;
+    int status = 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(0);
+    }
+    return (pid > 0 && waitpid(pid, &status, 0) == pid) ? 0 : -1;
+}
+
+static int op_fork_exec(void* ctx)
+{
+    (void)ctx;
+    int status = 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        char* av[2] = { (char*)"/bin/true", NULL };
+        (void)execv("/bin/true", av);
+        _exit(127);
+    }
+    return (pid > 0 && waitpid(pid, &status, 0) == pid && status == 0) ? 0 : -1;
+}
+
+static int op_spawn(void* ctx)
+{
+    (void)ctx;
+    int status = 0;
+    char* av[2] = { (char*)"/bin/true", NULL };
+    pid_t pid = spawnv("/bin/true", av);
+    return (pid > 0 && waitpid(pid, &status, 0) == pid && status == 0) ? 0 : -1;
+}
+
+static void bench_proc(void)
+{
+    static const struct {
+        const char* name;
+        int (*op)(void*);
+    } kProcs[] = {
+        { "lat_proc_fork", op_fork },
+        { "lat_proc_exec", op_fork_exec },
+        { "lat_proc_spawn", op_spawn },
+    };
+    for (size_t i = 0; i < sizeof(kProcs) / sizeof(kProcs[0]); i++) {
+        uint64_t ns = time_loop(kProcs[i].op, NULL, 10);
+        if (ns) {
+            report(kProcs[i].name, ns / 1000u, "us");
+        } else {
+            skip(kProcs[i].name, "fork/exec failed");
+        }
+    }
+}
+
+/* ============================================================================
+ * Memory
+ * ============================================================================ */
+
+static void bench_pagefault(void)
+{
+    const size_t len = 4u * 1024u * 1024u;
+    void* p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (p == MAP_FAILED) {
+        skip("lat_pagefault", "mmap");
+        return;
+    }
+    uint64_t t0 = now_ns();
+    for (size_t off = 0; off < len; off += BENCH_PAGE) {
+        ((volatile uint8_t*)p)[off] = 1;
+    }
+    uint64_t dt = now_ns() - t0;
+    (void)munmap(p, len);
+    report("lat_pagefault", dt / (len / BENCH_PAGE), "ns");
+}
+
+/* ============================================================================
+ * Files
+ * ============================================================================ */
+
+static const char* bench_dir(void)
+{
+    struct stat st;
+    if (stat("/mnt", &st) == 0) {
+        return "/mnt";
+    }
+    return "/tmp";
+}
+
+static int write_file(const char* path, const uint8_t* data, size_t len, size_t chunk)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0) {
+        return -1;
+    }
+    for (size_t off = 0; off < len; off += chunk) {
+        size_t n = (len - off < chunk) ? len - off : chunk;
+        if (write(fd, data + off % sizeof(bench_buf), n) != (ssize_t)n) {
+            (void)close(fd);
+            return -1;
+        }
+    }
+    return close(fd);
+}
+
+static int read_file(const char* path, size_t chunk, uint64_t* out_len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    uint64_t total = 0;
+    for (;;) {
+        ssize_t n = read(fd, bench_buf, chunk);
+        if (n < 0) {
+            (void)close(fd);
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += (uint64_t)n;
+    }
+    if (out_len) {
+        *out_len = total;
+    }
+    return close(fd);
+}
+
+static void bench_file_bw(const char* dir)
+{
+    const size_t len = 1024u * 1024u;
+    char path[64];
+    snprintf(path, sizeof(path), "%s/bench.dat", dir);
+
+    uint64_t t0 = now_ns();
+    int rc = write_file(path, bench_buf, len, 4096u);
+    int fd = (rc == 0) ? open(path, O_RDWR) : -1;
+    if (fd >= 0) {
+        (void)fsync(fd);
+        (void)close(fd);
+    }
+    uint64_t dt = now_ns() - t0;
+    if (rc == 0 && dt > 0) {
+        report("bw_file_write", (uint64_t)len * 1000000ULL / dt, "KB/s");
+    } else {
+        skip("bw_file_write", "write failed");
+    }
+
+    uint64_t got = 0;
+    t0 = now_ns();
+    rc = (rc == 0) ? read_file(path, 4096u, &got) : -1;
+    dt = now_ns() - t0;
+    if (rc == 0 && got == len && dt > 0) {
+        report("bw_file_read", got * 1000000ULL / dt, "KB/s");
+    } else {
+        skip("bw_file_read", "read failed");
+    }
+    (void)unlink(path);
+}
+
+typedef struct file_op_ctx {
+    const char* dir;
+    uint32_t seq;
+} file_op_ctx_t;
+
+/* lmbench lat_fs: create a small file, then remove it. */
+static int op_create_unlink(void* arg)
+{
+    file_op_ctx_t* ctx = (file_op_ctx_t*)arg;
+    char path[64];
+    snprintf(path, sizeof(path), "%s/bf%u", ctx->dir, (unsigned)(ctx->seq++ % 64u));
+    if (write_file(path, bench_buf, 1024u, 1024u) != 0) {
+        return -1;
+    }
+    return unlink(path);
+}
+
+/*
+ * Build-like workload: 32 "sources" of 2 KiB are each read and turned into a
+ * 3 KiB "object", the objects are read and concatenated into one "binary",
+ * every file is stat'ed, then the tree is removed.
+ */
+static int build_workload(const char* dir)
+{
+    enum { NSRC = 32 };
+    char root[48];
+    char path[64];
+    char out[64];
+    struct stat st;
+    snprintf(root, sizeof(root), "%s/bbuild", dir);
+    (void)mkdir(root, 0755);
+
+    for (int i = 0; i < NSRC; i++) {
+        snprintf(path, sizeof(path), "%s/s%d.c", root, i);
+        if (write_file(path, bench_buf, 2048u, 512u) != 0) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < NSRC; i++) {
+        snprintf(path, sizeof(path), "%s/s%d.c", root, i);
+        snprintf(out, sizeof(out), "%s/s%d.o", root, i);
+        if (read_file(path, 512u, NULL) != 0 || write_file(out, bench_buf, 3072u, 1024u) != 0) {
+            return -1;
+        }
+    }
+    snprintf(out, sizeof(out), "%s/a.out", root);
+    int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0) {
+        return -1;
+    }
+    for (int i = 0; i < NSRC; i++) {
+        int in;
+        ssize_t n;
+        snprintf(path, sizeof(path), "%s/s%d.o", root, i);
+        in = open(path, O_RDONLY);
+        if (in < 0) {
+            (void)close(fd);
+            return -1;
+        }
+        while ((n = read(in, bench_buf, 1024u)) > 0) {
+            (void)write(fd, bench_buf, (size_t)n);
+        }
+        (void)close(in);
+    }
+    (void)close(fd);
+
+    int rc = 0;
+    for (int i = 0; i < NSRC; i++) {
+        snprintf(path, sizeof(path), "%s/s%d.c", root, i);
+        rc |= stat(path, &st);
+        rc |= unlink(path);
+        snprintf(path, sizeof(path), "%s/s%d.o", root, i);
+        rc |= stat(path, &st);
+        rc |= unlink(path);
+    }
+    rc |= unlink(out);
+    rc |= rmdir(root);
+    return rc;
+}
+
+static void bench_files(void)
+{
+    const char* dir = bench_dir();
+    bench_file_bw(dir);
+
+    file_op_ctx_t ctx = { dir, 0 };
+    uint64_t ns = time_loop(op_create_unlink, &ctx, 32);
+    if (ns) {
+        report("lat_fs_create", ns / 1000u, "us");
+    } else {
+        skip("lat_fs_create", "create failed");
+    }
+
+    uint64_t t0 = now_ns();
+    int rc = build_workload(dir);
+    uint64_t dt = now_ns() - t0;
+    if (rc == 0) {
+        report("build_workload", dt / 1000000u, "ms");
+    } else {
+        skip("build_workload", "file op failed");
+    }
+}
+
+/* ============================================================================
+ * Block devices
+ * ============================================================================ */
+
+#define BLK_DEV "/dev/nvme0n1"
+#define BLK_BS 4096u
+#define BLK_RUN_NS 2000000000ULL  /* every job issues reads for 2 s */
+#define BLK_QD_MAX 32u
+#define BLK_HIST 32u              /* log2(ns) latency buckets */
+
+typedef struct blk_job_stats {
+    uint64_t ops;
+    uint64_t lat_sum_ns;
+    uint32_t hist[BLK_HIST];
+} blk_job_stats_t;
+
+static uint8_t blk_buf[BLK_BS] __attribute__((aligned(BLK_BS)));
+
+/* One job = one process with its own descriptor doing O_DIRECT random 4K reads. */
+static void blk_job(uint64_t blocks, uint32_t seed, int out)
+{
+    blk_job_stats_t st;
+    memset(&st, 0, sizeof(st));
+    int fd = open(BLK_DEV, O_RDONLY | O_DIRECT);
+    uint64_t x = 0x9E3779B97F4A7C15ULL ^ seed;
+    uint64_t t_end = now_ns() + BLK_RUN_NS;
+    while (fd >= 0) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        uint64_t t0 = now_ns();
+        if (t0 >= t_end ||
+            lseek(fd, (off_t)((x % blocks) * BLK_BS), SEEK_SET) < 0 ||
+            read(fd, blk_buf, BLK_BS) != (ssize_t)BLK_BS) {
+            break;
+        }
+        uint64_t lat = now_ns() - t0;
+        uint32_t b = 0;
+        while (b + 1u < BLK_HIST && (lat >> (b + 1u)) != 0) {
+            b++;
+        }
+        st.ops++;
+        st.lat_sum_ns += lat;
+        st.hist[b]++;
+    }
+    (void)write(out, &st, sizeof(st));
+    _exit(fd >= 0 ? 0 : 1);
+}
+
+/* Queue depth qd = qd concurrent jobs (the block layer is synchronous per caller). */
+static int blk_run(uint64_t blocks, uint32_t qd, blk_job_stats_t* total, uint64_t* elapsed_ns)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+    memset(total, 0, sizeof(*total));
+    pid_t pids[BLK_QD_MAX];
+    uint64_t t0 = now_ns();
+    uint32_t started = 0;
+    for (; started < qd && started < BLK_QD_MAX; started++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            (void)close(fds[0]);
+            blk_job(blocks, started * 2654435761u + 1u, fds[1]);
+        }
+        if (pid < 0) {
+            break;
+        }
+        pids[started] = pid;
+    }
+    (void)close(fds[1]);
+    int ok = (started == qd) ? 0 : -1;
+    for (uint32_t i = 0; i < started; i++) {
+        blk_job_stats_t st;
+        if (read(fds[0], &st, sizeof(st)) != (ssize_t)sizeof(st)) {
+            ok = -1;
+            continue;
+        }
+        total->ops += st.ops;
+        total->lat_sum_ns += st.lat_sum_ns;
+        for (uint32_t b = 0; b < BLK_HIST; b++) {
+            total->hist[b] += st.hist[b];
+        }
+    }
+    for (uint32_t i = 0; i < started; i++) {
+        int status = 0;
+        if (waitpid(pids[i], &status, 0) != pids[i] || status != 0) {
+            ok = -1;
+        }
+    }
+    *elapsed_ns = now_ns() - t0;
+    (void)close(fds[0]);
+    return (ok == 0 && total->ops > 0) ? 0 : -1;
+}
+
+/* Upper bound of the bucket holding the 99th percentile, in ns. */
+static uint64_t blk_p99(const blk_job_stats_t* st)
+{
+    uint64_t need = st->ops - st->ops / 100u;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < BLK_HIST; b++) {
+        seen += st->hist[b];
+        if (seen >= need) {
+            return 2ULL << b;
+        }
+    }
+    return 0;
+}
+
+static void bench_blockdev(void)
+{
+    static const struct {
+        uint32_t qd;
+        const char* iops;
+        const char* lat;
+        const char* p99;
+    } kRuns[] = {
+        { 1, "nvme_qd1_iops", "nvme_qd1_lat", "nvme_qd1_p99" },
+        { BLK_QD_MAX, "nvme_qd32_iops", "nvme_qd32_lat", "nvme_qd32_p99" },
+    };
+    int fd = open(BLK_DEV, O_RDONLY | O_DIRECT);
+    off_t size = (fd >= 0) ? lseek(fd, 0, SEEK_END) : -1;
+    if (fd >= 0) {
+        (void)close(fd);
+    }
+    for (size_t i = 0; i < sizeof(kRuns) / sizeof(kRuns[0]); i++) {
+        blk_job_stats_t st;
+        uint64_t dt = 0;
+        if (size < (off_t)BLK_BS) {
+            skip(kRuns[i].iops, "no " BLK_DEV);
+            skip(kRuns[i].lat, "no " BLK_DEV);
+            skip(kRuns[i].p99, "no " BLK_DEV);
+        } else if (blk_run((uint64_t)size / BLK_BS, kRuns[i].qd, &st, &dt) != 0 || dt == 0) {
+            skip(kRuns[i].iops, "read failed");
+            skip(kRuns[i].lat, "read failed");
+            skip(kRuns[i].p99, "read failed");
+        } else {
+            report(kRuns[i].iops, st.ops * 1000000000ULL / dt, "IOPS");
+            report(kRuns[i].lat, st.lat_sum_ns / st.ops / 1000u, "us");
+            report(kRuns[i].p99, blk_p99(&st) / 1000u, "us");
+        }
+    }
+}
+
+/* ============================================================================
+ * Network
+ * ============================================================================ */
+
+typedef struct udp_ctx {
+    int srv;
+    int cli;
+    sockaddr_in_t dst;
+} udp_ctx_t;
+
+static int op_udp_rtt(void* arg)
+{
+    udp_ctx_t* u = (udp_ctx_t*)arg;
+    sockaddr_in_t src;
+    if (posix_sendto(u->cli, bench_buf, 64, 0, &u->dst, sizeof(u->dst)) != 64) {
+        return -1;
+    }
+    return posix_recvfrom(u->srv, bench_buf, sizeof(bench_buf), 0, &src, 500) == 64 ? 0 : -1;
+}
+
+static void bench_udp(void)
+{
+    udp_ctx_t u;
+    memset(&u, 0, sizeof(u));
+    long srv = posix_socket(AF_INET, SOCK_DGRAM, 0);
+    long cli = posix_socket(AF_INET, SOCK_DGRAM, 0);
+    u.dst.sin_family = AF_INET;
+    u.dst.sin_port = 101;
+    u.dst.sin_addr = NET_NET0_ADDR;
+    if (srv < 0 || cli < 0 || posix_bind((int)srv, &u.dst) < 0) {
+        skip("lat_udp", "no net0");
+    } else {
+        u.srv = (int)srv;
+        u.cli = (int)cli;
+        uint64_t ns = time_loop(op_udp_rtt, &u, 100);
+        if (ns) {
+            report("lat_udp", ns / 1000u, "us");
+        } else {
+            skip("lat_udp", "send/recv failed");
+        }
+    }
+    if (srv >= 0) {
+        (void)posix_close((int)srv);
+    }
+    if (cli >= 0) {
+        (void)posix_close((int)cli);
+    }
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < sizeof(bench_buf); i++) {
+        bench_buf[i] = (uint8_t)(i * 31u + 7u);
+    }
+    printf("[BENCH] BEGIN %d\n", BENCH_VERSION);
+    fflush(stdout);
+
+    bench_syscalls();
+    bench_ctx();
+    bench_pipe_bw();
+    bench_proc();
+    bench_pagefault();
+    bench_files();
+    bench_blockdev();
+    bench_udp();
+
+    printf("[BENCH] DONE\n");
+    fflush(stdout);
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * cgctl.c
+ * Task group control: list groups, create/destroy them, set limits and
+ * move processes between them (cgcreate/cgdestroy/cgattach/cgset/cgstat).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "posix_syscall.h"
+#include "cgstat.h"
+
+#define CG_SCAN_MAX 16u
+
+static void usage(void)
+{
+    fputs("usage:\n"
+          "  cgctl ls\n"
+          "  cgctl create <parent-id> <name>\n"
+          "  cgctl destroy <id>\n"
+          "  cgctl attach <id> [pid]\n"
+          "  cgctl set <id> cpu.weight|cpu.max|cpu.period|mem.max|io.weight <value|max>\n",
+          stdout);
+}
+
+static int parse_u64(const char* s, uint64_t* out)
+{
+    if (!s || !s[0]) {
+        return 0;
+    }
+    if (strcmp(s, "max") == 0) {
+        *out = CG_UNLIMITED;
+        return 1;
+    }
+    char* end = NULL;
+    unsigned long v = strtoul(s, &end, 0);
+    if (!end || *end != '\0') {
+        return 0;
+    }
+    *out = (uint64_t)v;
+    return 1;
+}
+
+static const char* limit_str(uint64_t v, char* buf, size_t len)
+{
+    if (v == CG_UNLIMITED) {
+        return "max";
+    }
+    snprintf(buf, len, "%llu", (unsigned long long)v);
+    return buf;
+}
+
+static void print_group(const rodnix_cgstat_t* st)
+{
+    char a[24];
+    char b[24];
+    printf("%u %s parent=%u depth=%u tasks=%u children=%u%s\n",
+           (unsigned)st->id, st->name, (unsigned)st->parent_id, (unsigned)st->depth,
+           (unsigned)st->nr_tasks, (unsigned)st->nr_children, st->dying ? " dying" : "");
+    printf("  cpu: weight=%u max=%s/%llu usage_us=%llu periods=%llu throttled=%llu throttled_us=%llu\n",
+           (unsigned)st->cpu_weight, limit_str(st->cpu_max_us, a, sizeof(a)),
+           (unsigned long long)st->cpu_period_us, (unsigned long long)st->cpu_usage_us,
+           (unsigned long long)st->cpu_nr_periods, (unsigned long long)st->cpu_nr_throttled,
+           (unsigned long long)st->cpu_throttled_us);
+    printf("  mem: max=%s current=%llu anon=%llu file=%llu peak=%llu failcnt=%llu oom_kills=%llu\n",
+           limit_str(st->mem_max_bytes, b, sizeof(b)), (unsigned long long)st->mem_bytes,
+           (unsigned long long)st->mem_anon_bytes, (unsigned long long)st->mem_file_bytes,
+           (unsigned long long)st->mem_peak_bytes, (unsigned long long)st->mem_failcnt,
+           (unsigned long long)st->mem_oom_kills);
+    printf("  io: weight=%u rbytes=%llu wbytes=%llu delay_us=%llu\n",
+           (unsigned)st->io_weight, (unsigned long long)st->io_read_bytes,
+           (unsigned long long)st->io_write_bytes, (unsigned long long)st->io_delay_us);
+}
+
+static int set_key(const char* name, uint32_t* key)
+{
+    static const struct {
+        const char* name;
+        uint32_t key;
+    } kKeys[] = {
+        { "cpu.weight", CG_KEY_CPU_WEIGHT },
+        { "cpu.max", CG_KEY_CPU_MAX },
+        { "cpu.period", CG_KEY_CPU_PERIOD },
+        { "mem.max", CG_KEY_MEM_MAX },
+        { "io.weight", CG_KEY_IO_WEIGHT },
+    };
+    for (size_t i = 0; i < sizeof(kKeys) / sizeof(kKeys[0]); i++) {
+        if (strcmp(name, kKeys[i].name) == 0) {
+            *key = kKeys[i].key;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int fail(const char* what, long rc)
+{
+    printf("cgctl: %s failed (%ld)\n", what, rc);
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || !argv || !argv[1]) {
+        usage();
+        return 1;
+    }
+    const char* cmd = argv[1];
+    uint64_t id = 0;
+
+    if (strcmp(cmd, "ls") == 0) {
+        for (uint32_t i = 0; i < CG_SCAN_MAX; i++) {
+            rodnix_cgstat_t st;
+            if (posix_cgstat(i, &st) == 0) {
+                print_group(&st);
+            }
+        }
+        fflush(stdout);
+        return 0;
+    }
+
+    if (strcmp(cmd, "create") == 0 && argc >= 4 && parse_u64(argv[2], &id)) {
+        uint32_t new_id = 0;
+        long rc = posix_cgcreate((uint32_t)id, argv[3], &new_id);
+        if (rc < 0) {
+            return fail("create", rc);
+        }
+        printf("%u\n", (unsigned)new_id);
+        fflush(stdout);
+        return 0;
+    }
+
+    if (strcmp(cmd, "destroy") == 0 && argc >= 3 && parse_u64(argv[2], &id)) {
+        long rc = posix_cgdestroy((uint32_t)id);
+        return rc < 0 ? fail("destroy", rc) : 0;
+    }
+
+    if (strcmp(cmd, "attach") == 0 && argc >= 3 && parse_u64(argv[2], &id)) {
+        uint64_t pid = 0;
+        if (argc >= 4 && !parse_u64(argv[3], &pid)) {
+            usage();
+            return 1;
+        }
+        long rc = posix_cgattach((long)pid, (uint32_t)id);
+        return rc < 0 ? fail("attach", rc) : 0;
+    }
+
+    if (strcmp(cmd, "set") == 0 && argc >= 5 && parse_u64(argv[2], &id)) {
+        uint32_t key = 0;
+        uint64_t value = 0;
+        if (!set_key(argv[3], &key) || !parse_u64(argv[4], &value)) {
+            usage();
+            return 1;
+        }
+        long rc = posix_cgset((uint32_t)id, key, value);
+        return rc < 0 ? fail("set", rc) : 0;
+    }
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,187 @@
+/*
+ * cyclictest.c
+ * Wake-up latency benchmark in the spirit of rt-tests' cyclictest: a
+ * thread (optionally SCHED_FIFO) sleeps until the next period boundary and
+ * records how late it woke up against CLOCK_MONOTONIC. Optional forked
+ * SCHED_OTHER spinners provide CPU load. Prints min/avg/max and a latency
+ * histogram.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <signal.h>
+#include "unistd.h"
+
+#define CT_MAX_LOAD    8
+#define CT_HIST_BUCKETS 64
+
+static void usage(void)
+{
+    fputs("usage: cyclictest [-p prio] [-i interval_us] [-l loops] [-L spinners] [-b bucket_us]\n"
+          "  -p prio      SCHED_FIFO priority 1..99, 0 keeps SCHED_OTHER (default 80)\n"
+          "  -i us        wake-up period (default 10000)\n"
+          "  -l loops     number of wake-ups (default 1000)\n"
+          "  -L n         fork n busy SCHED_OTHER spinners as load (default 0, max 8)\n"
+          "  -b us        histogram bucket width (default 100)\n",
+          stdout);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t target)
+{
+    uint64_t now = now_ns();
+    if (now >= target) {
+        return;
+    }
+    uint64_t d = target - now;
+    struct timespec req;
+    req.tv_sec = (time_t)(d / 1000000000ULL);
+    req.tv_nsec = (long)(d % 1000000000ULL);
+    nanosleep(&req, NULL);
+}
+
+static int arg_u32(int argc, char** argv, int* i, uint32_t* out)
+{
+    if (*i + 1 >= argc) {
+        return -1;
+    }
+    char* end = NULL;
+    unsigned long v = strtoul(argv[++(*i)], &end, 10);
+    if (!end || *end != '\0') {
+        return -1;
+    }
+    *out = (uint32_t)v;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t prio = 80;
+    uint32_t interval_us = 10000;
+    uint32_t loops = 1000;
+    uint32_t nload = 0;
+    uint32_t bucket_us = 100;
+
+    for (int i = 1; i < argc; i++) {
+        uint32_t* dst = NULL;
+        if (strcmp(argv[i], "-p") == 0) {
+            dst = &prio;
+        } else if (strcmp(argv[i], "-i") == 0) {
+            dst = &interval_us;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            dst = &loops;
+        } else if (strcmp(argv[i], "-L") == 0) {
+            dst = &nload;
+        } else if (strcmp(argv[i], "-b") == 0) {
+            dst = &bucket_us;
+        }
+        if (!dst || arg_u32(argc, argv, &i, dst) != 0) {
+            usage();
+            return 1;
+        }
+    }
+    if (prio > 99 || interval_us == 0 || loops == 0 || nload > CT_MAX_LOAD || bucket_us == 0) {
+        usage();
+        return 1;
+    }
+
+    pid_t load[CT_MAX_LOAD];
+    for (uint32_t i = 0; i < nload; i++) {
+        load[i] = fork();
+        if (load[i] == 0) {
+            volatile uint64_t spin = 0;
+            for (;;) {
+                spin++;
+            }
+        }
+        if (load[i] < 0) {
+            fprintf(stderr, "cyclictest: fork failed\n");
+            nload = i;
+            break;
+        }
+    }
+
+    if (prio > 0) {
+        struct sched_param sp;
+        sp.sched_priority = (int)prio;
+        if (sched_setscheduler(0, SCHED_FIFO, &sp) != 0) {
+            fprintf(stderr, "cyclictest: SCHED_FIFO %u failed (errno %d)%s\n", (unsigned)prio, errno,
+                    errno == 6 ? ": must run as root" : "");
+            for (uint32_t i = 0; i < nload; i++) {
+                kill(load[i], SIGKILL);
+                waitpid(load[i], NULL, 0);
+            }
+            return 1;
+        }
+    }
+
+    static uint64_t hist[CT_HIST_BUCKETS + 1];
+    memset(hist, 0, sizeof(hist));
+    uint64_t min_ns = UINT64_MAX;
+    uint64_t max_ns = 0;
+    uint64_t sum_ns = 0;
+    uint64_t overruns = 0;
+    uint64_t period = (uint64_t)interval_us * 1000ULL;
+    uint64_t next = now_ns() + period;
+
+    for (uint32_t n = 0; n < loops; n++) {
+        sleep_until(next);
+        uint64_t woke = now_ns();
+        uint64_t lat = woke > next ? woke - next : 0;
+        if (lat < min_ns) {
+            min_ns = lat;
+        }
+        if (lat > max_ns) {
+            max_ns = lat;
+        }
+        sum_ns += lat;
+        uint64_t b = lat / 1000ULL / bucket_us;
+        hist[b < CT_HIST_BUCKETS ? b : CT_HIST_BUCKETS]++;
+        /* Keep the absolute schedule; skip periods we already missed. */
+        next += period;
+        while (next <= woke) {
+            next += period;
+            overruns++;
+        }
+    }
+
+    if (prio > 0) {
+        struct sched_param sp;
+        sp.sched_priority = 0;
+        sched_setscheduler(0, SCHED_OTHER, &sp);
+    }
+    for (uint32_t i = 0; i < nload; i++) {
+        kill(load[i], SIGKILL);
+        waitpid(load[i], NULL, 0);
+    }
+
+    printf("cyclictest: %s prio %u, interval %uus, %u loops, %u spinners\n",
+           prio ? "SCHED_FIFO" : "SCHED_OTHER", (unsigned)prio, (unsigned)interval_us,
+           (unsigned)loops, (unsigned)nload);
+    printf("latency us: min %llu avg %llu max %llu, overruns %llu\n",
+           (unsigned long long)(min_ns / 1000ULL),
+           (unsigned long long)(sum_ns / loops / 1000ULL),
+           (unsigned long long)(max_ns / 1000ULL),
+           (unsigned long long)overruns);
+    for (uint32_t b = 0; b < CT_HIST_BUCKETS; b++) {
+        if (hist[b]) {
+            printf("  %6u-%6u us: %llu\n", (unsigned)(b * bucket_us),
+                   (unsigned)((b + 1) * bucket_us - 1), (unsigned long long)hist[b]);
+        }
+    }
+    if (hist[CT_HIST_BUCKETS]) {
+        printf("  >=%6u us:      %llu\n", (unsigned)(CT_HIST_BUCKETS * bucket_us),
+               (unsigned long long)hist[CT_HIST_BUCKETS]);
+    }
+    return 0;
+}
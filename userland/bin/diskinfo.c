@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include "posix_syscall.h"
 #include "diskinfo.h"
+#include "sys/ioctl.h"
 
 #define FD_STDOUT 1
 
@@ -227,6 +228,7 @@ static void print_usage(void)
     (void)write_str("  diskinfo -r <device> <lba>\n");
     (void)write_str("  diskinfo -w <device> <lba> <byte(0..255|0xNN)>\n");
     (void)write_str("  diskinfo -x <device|/path> <offset> <len>\n");
+    (void)write_str("  diskinfo -p <device>   (re-read partition table)\n");
 }
 
 static void dump_sector_prefix(const uint8_t* data, uint32_t count)
@@ -252,9 +254,9 @@ static void dump_sector_prefix(const uint8_t* data, uint32_t count)
 
 int main(int argc, char** argv)
 {
-    rodnix_blockdev_info_t devs[16];
+    rodnix_blockdev_info_t devs[32];
     uint32_t total = 0;
-    long n = posix_blocklist(devs, 16, &total);
+    long n = posix_blocklist(devs, 32, &total);
     if (n < 0) {
         (void)write_str("diskinfo: blocklist syscall failed\n");
         return 1;
@@ -338,6 +340,29 @@ int main(int argc, char** argv)
         return hexdump_path(path, parse_u64(argv[3]), parse_u64(argv[4]));
     }
 
+    if (argc == 3 && streq(argv[1], "-p")) {
+        enum { VFS_OPEN_READ = 1 };
+        char path[64];
+        join_dev_path(path, sizeof(path), argv[2]);
+        long fd = posix_open(path, VFS_OPEN_READ);
+        if (fd < 0) {
+            (void)write_str("diskinfo: open failed\n");
+            return 1;
+        }
+        long parts = posix_ioctl((int)fd, RDNX_BLK_IOCTL_RRPART, 0);
+        (void)posix_close((int)fd);
+        if (parts < 0) {
+            (void)write_str((parts == -5) ? "diskinfo: partition in use\n" : "diskinfo: rescan failed\n");
+            return 1;
+        }
+        (void)write_str("diskinfo: ");
+        (void)write_str(path);
+        (void)write_str(" partitions=");
+        write_u64((uint64_t)parts);
+        (void)write_str("\n");
+        return 0;
+    }
+
     if (argc != 1) {
         print_usage();
         return 1;
@@ -364,6 +389,11 @@ int main(int argc, char** argv)
         } else {
             (void)write_str(" rw");
         }
+        if (devs[i].flags & 8u) {
+            (void)write_str(" part");
+        }
+        (void)write_str(" qd=");
+        write_u64((uint64_t)devs[i].queue_depth);
         (void)write_str("\n");
     }
 
@@ -0,0 +1,1204 @@
+/*
+ * fsck_ext2.c
+ * ext2 consistency checker for block device nodes (/dev/diskN) and images.
+ *
+ * Runs the same passes as scripts/fsck_ext2.py:
+ *   1. superblock/GDT geometry, inode block maps and extent trees, i_blocks
+ *   2. directory structure ('.', '..', rec_len, file types, targets)
+ *   3. reachability from the root and link counts
+ *   4. block/inode bitmaps against what is actually referenced
+ *   5. group and superblock free/used counters
+ *
+ * Exit status follows e2fsck: 0 clean, 1 corrected, 4 uncorrected,
+ * 8 operational error. Repair (-y) rewrites whole blocks only, so it works
+ * through the sector-aligned block device write path. Repairing a volume
+ * that is currently mounted is unsafe: the kernel keeps its own copy of the
+ * superblock and group descriptors and will write it back on next alloc.
+ *
+ * Extent-mapped inodes (ext4 EXTENTS) are walked node by node: index and
+ * leaf blocks count toward i_blocks and the block bitmap like indirect
+ * tables do. flex_bg only moves bitmaps and inode tables out of their own
+ * group, which the metadata map already allows. Extent damage is reported
+ * but not repaired.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FD_STDOUT 1
+
+#define EXT2_MAGIC 0xEF53u
+#define EXT2_ROOT_INO 2u
+#define EXT2_NDIR_BLOCKS 12u
+#define EXT2_MAX_BLOCK_SIZE 4096u
+
+#define EXT2_S_IFMT   0xF000u
+#define EXT2_S_IFSOCK 0xC000u
+#define EXT2_S_IFLNK  0xA000u
+#define EXT2_S_IFREG  0x8000u
+#define EXT2_S_IFBLK  0x6000u
+#define EXT2_S_IFDIR  0x4000u
+#define EXT2_S_IFCHR  0x2000u
+#define EXT2_S_IFIFO  0x1000u
+
+#define EXT2_FEATURE_INCOMPAT_FILETYPE 0x0002u
+#define EXT2_FEATURE_INCOMPAT_EXTENTS  0x0040u
+#define EXT2_FEATURE_INCOMPAT_FLEX_BG  0x0200u
+/* Same set the kernel driver mounts. */
+#define EXT2_FEATURE_INCOMPAT_SUPP (EXT2_FEATURE_INCOMPAT_FILETYPE | \
+                                    EXT2_FEATURE_INCOMPAT_EXTENTS | \
+                                    EXT2_FEATURE_INCOMPAT_FLEX_BG)
+#define EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER 0x0001u
+#define EXT2_FEATURE_RO_COMPAT_HUGE_FILE    0x0008u
+
+#define EXT4_HUGE_FILE_FL 0x00040000u
+#define EXT4_EXTENTS_FL   0x00080000u
+
+#define EXT4_EXT_MAGIC 0xF30Au
+#define EXT4_EXT_ROOT_ENTRIES 4u
+#define EXT4_EXT_MAX_DEPTH 5u
+#define EXT4_EXT_INIT_MAX_LEN 32768u /* longer lengths mark unwritten extents */
+
+#define INODE_RAW_SIZE 128u
+#define MAX_REPORT 20u
+
+enum {
+    FSCK_EXIT_OK = 0,
+    FSCK_EXIT_FIXED = 1,
+    FSCK_EXIT_UNCORRECTED = 4,
+    FSCK_EXIT_OPERATIONAL = 8
+};
+
+typedef struct {
+    int fd;
+    int repair;
+    int verbose;
+    const char* path;
+    uint32_t errors;
+    uint32_t fixed;
+
+    uint8_t sb[1024];
+    uint32_t inodes_count;
+    uint32_t blocks_count;
+    uint32_t sb_free_blocks;
+    uint32_t sb_free_inodes;
+    uint32_t first_data_block;
+    uint32_t bs;
+    uint32_t bpg;
+    uint32_t ipg;
+    uint32_t first_ino;
+    uint32_t inode_size;
+    uint32_t feature_incompat;
+    uint32_t feature_ro_compat;
+    uint32_t groups;
+    uint32_t itable_blocks;
+    uint32_t gdt_blocks;
+    uint8_t* gdt;
+
+    uint8_t* meta;     /* block bitmap: filesystem metadata */
+    uint8_t* claimed;  /* block bitmap: referenced by some inode */
+    uint8_t* dup;      /* block bitmap: referenced twice */
+    uint8_t* used;     /* per-inode: in use */
+    uint8_t* is_dir;
+    uint8_t* ftype;    /* per-inode: dirent file type implied by mode */
+    uint8_t* reach;
+    uint16_t* links;
+    uint16_t* refs;
+    uint32_t* parent;
+    uint32_t* dotdot;
+    uint32_t* group_free_blocks;
+    uint32_t* group_free_inodes;
+    uint32_t* group_dirs;
+
+    uint8_t* level_buf[EXT4_EXT_MAX_DEPTH + 1u]; /* one indirect table / extent node per walk depth */
+    uint8_t* dir_buf;
+    uint8_t* io_buf;
+    uint8_t* ino_buf;      /* cached inode table block */
+    uint32_t ino_buf_blk;
+} fsck_t;
+
+typedef enum {
+    WALK_CLAIM,
+    WALK_RELEASE,
+    WALK_DIR_CHECK,
+    WALK_DIR_COUNT
+} walk_op_t;
+
+typedef struct {
+    fsck_t* fs;
+    uint32_t ino;
+    walk_op_t op;
+    uint32_t claimed;
+    uint32_t data_index;
+} walk_t;
+
+static void out(const char* fmt, ...)
+{
+    char line[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return;
+    }
+    if ((size_t)n >= sizeof(line)) {
+        n = (int)sizeof(line) - 1;
+    }
+    (void)posix_write(FD_STDOUT, line, (uint64_t)n);
+}
+
+/* Record a problem; returns 1 when the caller should repair it. */
+static int problem(fsck_t* fs, int fixable, const char* fmt, ...)
+{
+    char line[224];
+    va_list ap;
+    va_start(ap, fmt);
+    (void)vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    int do_fix = fs->repair && fixable;
+    fs->errors++;
+    if (do_fix) {
+        fs->fixed++;
+    }
+    out("fsck_ext2: %s%s\n", line, do_fix ? " [fixed]" : "");
+    return do_fix;
+}
+
+static uint16_t rd16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void wr16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void wr32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static int bit_get(const uint8_t* map, uint32_t i)
+{
+    return (map[i >> 3] >> (i & 7u)) & 1;
+}
+
+static void bit_set(uint8_t* map, uint32_t i)
+{
+    map[i >> 3] |= (uint8_t)(1u << (i & 7u));
+}
+
+static void bit_clr(uint8_t* map, uint32_t i)
+{
+    map[i >> 3] &= (uint8_t)~(1u << (i & 7u));
+}
+
+/* ------------------------------------------------------------------ I/O */
+
+static int read_at(fsck_t* fs, uint64_t off, void* buf, uint32_t len)
+{
+    if (lseek(fs->fd, (off_t)off, SEEK_SET) < 0) {
+        return -1;
+    }
+    uint32_t done = 0;
+    while (done < len) {
+        ssize_t n = read(fs->fd, (uint8_t*)buf + done, len - done);
+        if (n <= 0) {
+            return -1;
+        }
+        done += (uint32_t)n;
+    }
+    return 0;
+}
+
+static int write_at(fsck_t* fs, uint64_t off, const void* buf, uint32_t len)
+{
+    if (lseek(fs->fd, (off_t)off, SEEK_SET) < 0) {
+        return -1;
+    }
+    ssize_t n = write(fs->fd, buf, len);
+    return (n == (ssize_t)len) ? 0 : -1;
+}
+
+static int read_block(fsck_t* fs, uint32_t blk, uint8_t* buf)
+{
+    return read_at(fs, (uint64_t)blk * fs->bs, buf, fs->bs);
+}
+
+static int write_block(fsck_t* fs, uint32_t blk, const uint8_t* buf)
+{
+    if (write_at(fs, (uint64_t)blk * fs->bs, buf, fs->bs) != 0) {
+        out("fsck_ext2: write of block %u failed\n", blk);
+        return -1;
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------- geometry */
+
+static uint32_t gd_field(const fsck_t* fs, uint32_t g, uint32_t off)
+{
+    return rd32(fs->gdt + g * 32u + off);
+}
+
+static uint32_t gd_block_bitmap(const fsck_t* fs, uint32_t g) { return gd_field(fs, g, 0); }
+static uint32_t gd_inode_bitmap(const fsck_t* fs, uint32_t g) { return gd_field(fs, g, 4); }
+static uint32_t gd_inode_table(const fsck_t* fs, uint32_t g) { return gd_field(fs, g, 8); }
+
+static uint32_t group_first(const fsck_t* fs, uint32_t g)
+{
+    return fs->first_data_block + g * fs->bpg;
+}
+
+static uint32_t group_len(const fsck_t* fs, uint32_t g)
+{
+    uint32_t rem = fs->blocks_count - group_first(fs, g);
+    return (rem < fs->bpg) ? rem : fs->bpg;
+}
+
+static int group_has_super(const fsck_t* fs, uint32_t g)
+{
+    if (!(fs->feature_ro_compat & EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER) || g <= 1u) {
+        return 1;
+    }
+    static const uint32_t bases[3] = {3u, 5u, 7u};
+    for (uint32_t i = 0; i < 3; i++) {
+        uint32_t n = bases[i];
+        while (n < g) {
+            n *= bases[i];
+        }
+        if (n == g) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int load_super(fsck_t* fs)
+{
+    if (read_at(fs, 1024u, fs->sb, sizeof(fs->sb)) != 0) {
+        out("fsck_ext2: %s: cannot read superblock\n", fs->path);
+        return -1;
+    }
+    const uint8_t* sb = fs->sb;
+    fs->inodes_count = rd32(sb + 0x00);
+    fs->blocks_count = rd32(sb + 0x04);
+    fs->sb_free_blocks = rd32(sb + 0x0C);
+    fs->sb_free_inodes = rd32(sb + 0x10);
+    fs->first_data_block = rd32(sb + 0x14);
+    uint32_t log_bs = rd32(sb + 0x18);
+    fs->bpg = rd32(sb + 0x20);
+    fs->ipg = rd32(sb + 0x28);
+    uint32_t rev = rd32(sb + 0x4C);
+    fs->feature_incompat = rd32(sb + 0x60);
+    fs->feature_ro_compat = rd32(sb + 0x64);
+
+    if (rd16(sb + 0x38) != EXT2_MAGIC) {
+        out("fsck_ext2: %s: bad superblock magic\n", fs->path);
+        return -1;
+    }
+    if (log_bs > 2u) {
+        out("fsck_ext2: %s: unsupported block size\n", fs->path);
+        return -1;
+    }
+    fs->bs = 1024u << log_bs;
+    if (rev == 0) {
+        fs->first_ino = 11u;
+        fs->inode_size = 128u;
+    } else {
+        fs->first_ino = rd32(sb + 0x54);
+        fs->inode_size = rd16(sb + 0x58);
+    }
+    if (fs->feature_incompat & ~EXT2_FEATURE_INCOMPAT_SUPP) {
+        out("fsck_ext2: %s: unsupported incompat features 0x%x\n", fs->path, fs->feature_incompat);
+        return -1;
+    }
+    if (fs->inode_size < 128u || fs->inode_size > fs->bs || (fs->inode_size & (fs->inode_size - 1u))) {
+        out("fsck_ext2: %s: bad inode size %u\n", fs->path, fs->inode_size);
+        return -1;
+    }
+    if (fs->bpg == 0 || fs->ipg == 0) {
+        out("fsck_ext2: %s: zero blocks/inodes per group\n", fs->path);
+        return -1;
+    }
+    /* A group's bitmap is one block; larger groups overrun it. */
+    if (fs->bpg > fs->bs * 8u || fs->ipg > fs->bs * 8u) {
+        out("fsck_ext2: %s: group size %u/%u exceeds bitmap capacity %u\n",
+            fs->path, fs->bpg, fs->ipg, fs->bs * 8u);
+        return -1;
+    }
+    uint32_t expect_first = (fs->bs == 1024u) ? 1u : 0u;
+    if (fs->first_data_block != expect_first || fs->blocks_count <= fs->first_data_block) {
+        out("fsck_ext2: %s: bad first_data_block %u\n", fs->path, fs->first_data_block);
+        return -1;
+    }
+    fs->groups = (fs->blocks_count - fs->first_data_block + fs->bpg - 1u) / fs->bpg;
+    uint32_t max_inodes = fs->ipg * fs->groups;
+    if (fs->inodes_count != max_inodes) {
+        (void)problem(fs, 0, "superblock inodes_count %u != %u * %u groups",
+                      fs->inodes_count, fs->ipg, fs->groups);
+        if (fs->inodes_count > max_inodes) {
+            fs->inodes_count = max_inodes;
+        }
+    }
+    fs->itable_blocks = (fs->ipg * fs->inode_size + fs->bs - 1u) / fs->bs;
+    fs->gdt_blocks = (fs->groups * 32u + fs->bs - 1u) / fs->bs;
+    fs->gdt = (uint8_t*)malloc((size_t)fs->gdt_blocks * fs->bs);
+    if (!fs->gdt) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < fs->gdt_blocks; i++) {
+        if (read_block(fs, fs->first_data_block + 1u + i, fs->gdt + (size_t)i * fs->bs) != 0) {
+            out("fsck_ext2: %s: cannot read group descriptors\n", fs->path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int alloc_state(fsck_t* fs)
+{
+    size_t bmap = ((size_t)fs->blocks_count + 7u) / 8u;
+    size_t n = (size_t)fs->inodes_count + 1u;
+    fs->meta = (uint8_t*)calloc(bmap, 1);
+    fs->claimed = (uint8_t*)calloc(bmap, 1);
+    fs->dup = (uint8_t*)calloc(bmap, 1);
+    fs->used = (uint8_t*)calloc(n, 1);
+    fs->is_dir = (uint8_t*)calloc(n, 1);
+    fs->ftype = (uint8_t*)calloc(n, 1);
+    fs->reach = (uint8_t*)calloc(n, 1);
+    fs->links = (uint16_t*)calloc(n, sizeof(uint16_t));
+    fs->refs = (uint16_t*)calloc(n, sizeof(uint16_t));
+    fs->parent = (uint32_t*)calloc(n, sizeof(uint32_t));
+    fs->dotdot = (uint32_t*)calloc(n, sizeof(uint32_t));
+    fs->group_free_blocks = (uint32_t*)calloc(fs->groups, sizeof(uint32_t));
+    fs->group_free_inodes = (uint32_t*)calloc(fs->groups, sizeof(uint32_t));
+    fs->group_dirs = (uint32_t*)calloc(fs->groups, sizeof(uint32_t));
+    int bufs_ok = 1;
+    for (uint32_t i = 0; i <= EXT4_EXT_MAX_DEPTH; i++) {
+        fs->level_buf[i] = (uint8_t*)malloc(fs->bs);
+        bufs_ok = bufs_ok && fs->level_buf[i] != NULL;
+    }
+    fs->dir_buf = (uint8_t*)malloc(fs->bs);
+    fs->io_buf = (uint8_t*)malloc(fs->bs);
+    fs->ino_buf = (uint8_t*)malloc(fs->bs);
+    fs->ino_buf_blk = 0;
+    if (!fs->meta || !fs->claimed || !fs->dup || !fs->used || !fs->is_dir || !fs->ftype ||
+        !fs->reach || !fs->links || !fs->refs || !fs->parent || !fs->dotdot ||
+        !fs->group_free_blocks || !fs->group_free_inodes || !fs->group_dirs ||
+        !bufs_ok || !fs->dir_buf || !fs->io_buf || !fs->ino_buf) {
+        out("fsck_ext2: out of memory\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int mark_meta(fsck_t* fs, uint32_t g, const char* what, uint32_t start, uint32_t count)
+{
+    if (start < fs->first_data_block || start >= fs->blocks_count ||
+        count > fs->blocks_count - start) {
+        out("fsck_ext2: group %u: %s at %u out of range\n", g, what, start);
+        return -1;
+    }
+    for (uint32_t b = start; b < start + count; b++) {
+        if (bit_get(fs->meta, b)) {
+            out("fsck_ext2: group %u: %s block %u overlaps other metadata\n", g, what, b);
+            return -1;
+        }
+        bit_set(fs->meta, b);
+    }
+    return 0;
+}
+
+static int build_metadata(fsck_t* fs)
+{
+    for (uint32_t g = 0; g < fs->groups; g++) {
+        uint32_t first = group_first(fs, g);
+        if (group_has_super(fs, g)) {
+            uint32_t n = 1u + fs->gdt_blocks;
+            if (n > group_len(fs, g)) {
+                n = group_len(fs, g);
+            }
+            if (mark_meta(fs, g, "superblock", first, n) != 0) {
+                return -1;
+            }
+        }
+        if (mark_meta(fs, g, "block bitmap", gd_block_bitmap(fs, g), 1) != 0 ||
+            mark_meta(fs, g, "inode bitmap", gd_inode_bitmap(fs, g), 1) != 0 ||
+            mark_meta(fs, g, "inode table", gd_inode_table(fs, g), fs->itable_blocks) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* --------------------------------------------------------------- inodes */
+
+static uint64_t inode_off(const fsck_t* fs, uint32_t ino)
+{
+    uint32_t g = (ino - 1u) / fs->ipg;
+    uint32_t idx = (ino - 1u) % fs->ipg;
+    return (uint64_t)gd_inode_table(fs, g) * fs->bs + (uint64_t)idx * fs->inode_size;
+}
+
+static int read_inode(fsck_t* fs, uint32_t ino, uint8_t* raw)
+{
+    uint64_t off = inode_off(fs, ino);
+    uint32_t blk = (uint32_t)(off / fs->bs);
+    if (fs->ino_buf_blk != blk) {
+        if (read_block(fs, blk, fs->ino_buf) != 0) {
+            fs->ino_buf_blk = 0;
+            return -1;
+        }
+        fs->ino_buf_blk = blk;
+    }
+    memcpy(raw, fs->ino_buf + (off % fs->bs), INODE_RAW_SIZE);
+    return 0;
+}
+
+static int write_inode(fsck_t* fs, uint32_t ino, const uint8_t* raw)
+{
+    uint64_t off = inode_off(fs, ino);
+    uint32_t blk = (uint32_t)(off / fs->bs);
+    if (fs->ino_buf_blk != blk) {
+        if (read_block(fs, blk, fs->ino_buf) != 0) {
+            fs->ino_buf_blk = 0;
+            return -1;
+        }
+        fs->ino_buf_blk = blk;
+    }
+    memcpy(fs->ino_buf + (off % fs->bs), raw, INODE_RAW_SIZE);
+    return write_block(fs, blk, fs->ino_buf);
+}
+
+static uint8_t ftype_from_mode(uint16_t mode)
+{
+    switch (mode & EXT2_S_IFMT) {
+        case EXT2_S_IFREG: return 1;
+        case EXT2_S_IFDIR: return 2;
+        case EXT2_S_IFCHR: return 3;
+        case EXT2_S_IFBLK: return 4;
+        case EXT2_S_IFIFO: return 5;
+        case EXT2_S_IFSOCK: return 6;
+        case EXT2_S_IFLNK: return 7;
+        default: return 0;
+    }
+}
+
+static int inode_in_use(const fsck_t* fs, uint32_t ino, const uint8_t* raw)
+{
+    if (ino < fs->first_ino) {
+        return 1;
+    }
+    return rd16(raw + 0) != 0 && rd16(raw + 26) != 0 && rd32(raw + 20) == 0;
+}
+
+static int has_block_map(const fsck_t* fs, const uint8_t* raw)
+{
+    uint16_t mode = rd16(raw + 0);
+    uint16_t kind = (uint16_t)(mode & EXT2_S_IFMT);
+    if (kind == EXT2_S_IFREG || kind == EXT2_S_IFDIR) {
+        return 1;
+    }
+    if (kind == EXT2_S_IFLNK) {
+        /* Fast symlinks keep the target inside block[]. */
+        uint32_t acl_sectors = rd32(raw + 104) ? fs->bs / 512u : 0u;
+        return rd32(raw + 28) > acl_sectors;
+    }
+    if (mode == 0) {
+        if (rd32(raw + 32) & EXT4_EXTENTS_FL) {
+            return rd16(raw + 40 + 2) != 0;
+        }
+        for (uint32_t i = 0; i < 15; i++) {
+            if (rd32(raw + 40 + i * 4u)) {
+                return 1; /* reserved inode with blocks (bad-block list) */
+            }
+        }
+    }
+    return 0;
+}
+
+static int bad_pointer(const fsck_t* fs, uint32_t blk)
+{
+    return blk < fs->first_data_block || blk >= fs->blocks_count || bit_get(fs->meta, blk);
+}
+
+/* ---------------------------------------------------------- directories */
+
+static void dir_block(walk_t* w, uint32_t blk);
+
+static void walk_claim(walk_t* w, uint32_t blk)
+{
+    fsck_t* fs = w->fs;
+    if (w->op == WALK_CLAIM) {
+        if (bit_get(fs->claimed, blk)) {
+            (void)problem(fs, 0, "inode %u: block %u claimed twice", w->ino, blk);
+            bit_set(fs->dup, blk);
+        }
+        bit_set(fs->claimed, blk);
+        w->claimed++;
+    } else if (w->op == WALK_RELEASE) {
+        if (!bit_get(fs->dup, blk)) {
+            bit_clr(fs->claimed, blk);
+        }
+    }
+}
+
+static void walk_block(walk_t* w, uint32_t blk, uint32_t level)
+{
+    fsck_t* fs = w->fs;
+    walk_claim(w, blk);
+    if (level == 0) {
+        if (w->op == WALK_DIR_CHECK || w->op == WALK_DIR_COUNT) {
+            dir_block(w, blk);
+        }
+        w->data_index++;
+        return;
+    }
+
+    uint8_t* table = fs->level_buf[level];
+    if (read_block(fs, blk, table) != 0) {
+        (void)problem(fs, 0, "inode %u: cannot read indirect block %u", w->ino, blk);
+        return;
+    }
+    int dirty = 0;
+    for (uint32_t i = 0; i < fs->bs / 4u; i++) {
+        uint32_t child = rd32(table + i * 4u);
+        if (child == 0) {
+            continue;
+        }
+        if (bad_pointer(fs, child)) {
+            if (w->op == WALK_CLAIM &&
+                problem(fs, 1, "inode %u: illegal block %u in indirect block %u", w->ino, child, blk)) {
+                wr32(table + i * 4u, 0);
+                dirty = 1;
+            }
+            continue;
+        }
+        walk_block(w, child, level - 1u);
+        /* Recursion may have reused lower-level buffers only; ours is intact. */
+    }
+    if (dirty) {
+        (void)write_block(fs, blk, table);
+    }
+}
+
+/*
+ * Walk one extent node. The root lives in i_block[] and is not claimed; the
+ * caller claims and reads every lower node into level_buf[depth]. *next is
+ * the first logical block the next extent may start at, so keys must ascend
+ * across the whole tree and ranges cannot overlap. Structural damage is
+ * only reported on the claiming pass; later passes skip the same entries.
+ */
+static void walk_extents(walk_t* w, const uint8_t* node, uint32_t depth, uint32_t limit,
+                         uint32_t lo, uint64_t* next)
+{
+    fsck_t* fs = w->fs;
+    int report = (w->op == WALK_CLAIM);
+    uint32_t entries = rd16(node + 2);
+    uint32_t max = rd16(node + 4);
+    if (rd16(node + 0) != EXT4_EXT_MAGIC || max == 0 || max > limit || entries > max ||
+        rd16(node + 6) != depth) {
+        if (report) {
+            (void)problem(fs, 0, "inode %u: bad extent header at depth %u", w->ino, depth);
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < entries; i++) {
+        const uint8_t* e = node + 12u + i * 12u;
+        uint32_t key = rd32(e + 0);
+        if (key < lo || (uint64_t)key < *next) {
+            if (report) {
+                (void)problem(fs, 0, "inode %u: extent key %u out of order", w->ino, key);
+            }
+            return;
+        }
+        if (depth > 0) {
+            uint32_t child = rd32(e + 4);
+            if (rd16(e + 8) != 0 || bad_pointer(fs, child)) {
+                if (report) {
+                    (void)problem(fs, 0, "inode %u: illegal extent index block %u", w->ino, child);
+                }
+                continue;
+            }
+            walk_claim(w, child);
+            uint8_t* buf = fs->level_buf[depth - 1u];
+            if (read_block(fs, child, buf) != 0) {
+                (void)problem(fs, 0, "inode %u: cannot read extent block %u", w->ino, child);
+                continue;
+            }
+            walk_extents(w, buf, depth - 1u, (fs->bs - 12u) / 12u, key, next);
+            continue;
+        }
+        uint32_t len = rd16(e + 4);
+        int unwritten = len > EXT4_EXT_INIT_MAX_LEN;
+        if (unwritten) {
+            len -= EXT4_EXT_INIT_MAX_LEN;
+        }
+        uint32_t start = rd32(e + 8);
+        if (len == 0 || rd16(e + 6) != 0) {
+            if (report) {
+                (void)problem(fs, 0, "inode %u: bad extent at logical block %u", w->ino, key);
+            }
+            continue;
+        }
+        *next = (uint64_t)key + len;
+        for (uint32_t b = 0; b < len; b++) {
+            uint32_t blk = start + b;
+            if (blk < start || bad_pointer(fs, blk)) {
+                if (report) {
+                    (void)problem(fs, 0, "inode %u: illegal block %u in extent at %u", w->ino, blk, key);
+                }
+                break;
+            }
+            if (unwritten && w->op != WALK_CLAIM && w->op != WALK_RELEASE) {
+                continue; /* reads as zeros: not directory data */
+            }
+            walk_block(w, blk, 0);
+        }
+    }
+}
+
+static void walk_inode(walk_t* w, uint8_t* raw, int* inode_dirty)
+{
+    if (rd32(raw + 32) & EXT4_EXTENTS_FL) {
+        uint32_t depth = rd16(raw + 40 + 6);
+        if (depth > EXT4_EXT_MAX_DEPTH) {
+            if (w->op == WALK_CLAIM) {
+                (void)problem(w->fs, 0, "inode %u: extent tree depth %u", w->ino, depth);
+            }
+            return;
+        }
+        uint64_t next = 0;
+        walk_extents(w, raw + 40, depth, EXT4_EXT_ROOT_ENTRIES, 0, &next);
+        return;
+    }
+    for (uint32_t slot = 0; slot < 15; slot++) {
+        uint32_t blk = rd32(raw + 40 + slot * 4u);
+        if (blk == 0) {
+            continue;
+        }
+        if (bad_pointer(w->fs, blk)) {
+            if (w->op == WALK_CLAIM &&
+                problem(w->fs, 1, "inode %u: illegal block %u at slot %u", w->ino, blk, slot)) {
+                wr32(raw + 40 + slot * 4u, 0);
+                *inode_dirty = 1;
+            }
+            continue;
+        }
+        uint32_t level = (slot < EXT2_NDIR_BLOCKS) ? 0u : slot - EXT2_NDIR_BLOCKS + 1u;
+        walk_block(w, blk, level);
+    }
+}
+
+static void dir_block(walk_t* w, uint32_t blk)
+{
+    fsck_t* fs = w->fs;
+    uint32_t dino = w->ino;
+    uint8_t* buf = fs->dir_buf;
+    int check = (w->op == WALK_DIR_CHECK);
+    int has_ft = (fs->feature_incompat & EXT2_FEATURE_INCOMPAT_FILETYPE) != 0;
+
+    if (read_block(fs, blk, buf) != 0) {
+        (void)problem(fs, 0, "directory inode %u: cannot read block %u", dino, blk);
+        return;
+    }
+    int dirty = 0;
+    uint32_t pos = 0;
+    int32_t prev = -1;
+    uint32_t entry_no = 0;
+    while (pos + 8u <= fs->bs) {
+        uint32_t ino = rd32(buf + pos);
+        uint16_t rec_len = rd16(buf + pos + 4);
+        uint8_t name_len = buf[pos + 6];
+        uint8_t ft = buf[pos + 7];
+        if (rec_len < 8u || (rec_len & 3u) || pos + rec_len > fs->bs || 8u + name_len > rec_len) {
+            if (check && problem(fs, 1, "directory inode %u block %u: bad rec_len %u at %u",
+                                 dino, blk, rec_len, pos)) {
+                if (prev >= 0) {
+                    wr16(buf + prev + 4, (uint16_t)(fs->bs - (uint32_t)prev));
+                } else {
+                    wr32(buf + pos, 0);
+                    wr16(buf + pos + 4, (uint16_t)(fs->bs - pos));
+                    buf[pos + 6] = 0;
+                    buf[pos + 7] = 0;
+                }
+                dirty = 1;
+            }
+            break;
+        }
+        const char* name = (const char*)(buf + pos + 8);
+        int is_dot = (name_len == 1 && name[0] == '.');
+        int is_dotdot = (name_len == 2 && name[0] == '.' && name[1] == '.');
+
+        if (check && w->data_index == 0) {
+            if (entry_no == 0 && (!is_dot || ino != dino)) {
+                (void)problem(fs, 0, "directory inode %u: first entry is not '.'", dino);
+            } else if (entry_no == 1) {
+                if (!is_dotdot) {
+                    (void)problem(fs, 0, "directory inode %u: second entry is not '..'", dino);
+                } else {
+                    fs->dotdot[dino] = ino;
+                }
+            }
+        }
+        if (ino != 0 && (ino > fs->inodes_count || !fs->used[ino])) {
+            if (check && problem(fs, 1, "directory inode %u: entry at %u -> unused inode %u",
+                                 dino, pos, ino)) {
+                wr32(buf + pos, 0);
+                dirty = 1;
+            }
+            ino = 0;
+        }
+        if (ino != 0) {
+            if (check && has_ft && ft != fs->ftype[ino]) {
+                if (problem(fs, 1, "directory inode %u: entry for inode %u file type %u, should be %u",
+                            dino, ino, ft, fs->ftype[ino])) {
+                    buf[pos + 7] = fs->ftype[ino];
+                    dirty = 1;
+                }
+            }
+            if (!is_dot && !is_dotdot) {
+                if (check && fs->is_dir[ino]) {
+                    if (fs->parent[ino]) {
+                        (void)problem(fs, 0, "directory inode %u has multiple parents (%u, %u)",
+                                      ino, fs->parent[ino], dino);
+                    } else {
+                        fs->parent[ino] = dino;
+                    }
+                }
+                if (!check) {
+                    fs->refs[ino]++;
+                    if (fs->is_dir[ino]) {
+                        fs->refs[dino]++; /* child's '..' */
+                    } else {
+                        fs->reach[ino] = 1;
+                    }
+                }
+            }
+        }
+        prev = (int32_t)pos;
+        pos += rec_len;
+        entry_no++;
+    }
+    if (dirty) {
+        (void)write_block(fs, blk, buf);
+    }
+}
+
+/* --------------------------------------------------------------- passes */
+
+static int pass1(fsck_t* fs)
+{
+    uint8_t raw[INODE_RAW_SIZE];
+    uint32_t spb = fs->bs / 512u;
+    for (uint32_t ino = 1; ino <= fs->inodes_count; ino++) {
+        if (read_inode(fs, ino, raw) != 0) {
+            out("fsck_ext2: cannot read inode %u\n", ino);
+            return -1;
+        }
+        if (!inode_in_use(fs, ino, raw)) {
+            continue;
+        }
+        uint16_t mode = rd16(raw + 0);
+        fs->used[ino] = 1;
+        fs->links[ino] = rd16(raw + 26);
+        fs->ftype[ino] = ftype_from_mode(mode);
+        if ((mode & EXT2_S_IFMT) == EXT2_S_IFDIR) {
+            fs->is_dir[ino] = 1;
+        }
+        if (ino == EXT2_ROOT_INO && !fs->is_dir[ino]) {
+            out("fsck_ext2: root inode is not a directory\n");
+            return -1;
+        }
+        if (!has_block_map(fs, raw)) {
+            continue;
+        }
+
+        int dirty = 0;
+        walk_t w = { .fs = fs, .ino = ino, .op = WALK_CLAIM, .claimed = 0, .data_index = 0 };
+        walk_inode(&w, raw, &dirty);
+
+        uint32_t acl = rd32(raw + 104);
+        if (acl) {
+            if (bad_pointer(fs, acl)) {
+                (void)problem(fs, 0, "inode %u: illegal xattr block %u", ino, acl);
+            } else {
+                w.claimed++;
+                bit_set(fs->claimed, acl); /* xattr blocks may be shared */
+            }
+        }
+
+        /* huge_file: 48-bit i_blocks, in fs blocks when the inode says so. */
+        int huge = (fs->feature_ro_compat & EXT2_FEATURE_RO_COMPAT_HUGE_FILE) != 0;
+        uint64_t have = rd32(raw + 28);
+        uint32_t unit = spb;
+        if (huge) {
+            have |= (uint64_t)rd16(raw + 116) << 32;
+            if (rd32(raw + 32) & EXT4_HUGE_FILE_FL) {
+                unit = 1u;
+            }
+        }
+        uint64_t expect = (uint64_t)w.claimed * unit;
+        if (!huge && expect > UINT32_MAX) {
+            (void)problem(fs, 0, "inode %u: %u blocks overflow i_blocks", ino, w.claimed);
+        } else if (have != expect &&
+                   problem(fs, 1, "inode %u: i_blocks is %llu, should be %llu", ino,
+                           (unsigned long long)have, (unsigned long long)expect)) {
+            wr32(raw + 28, (uint32_t)expect);
+            if (huge) {
+                wr16(raw + 116, (uint16_t)(expect >> 32));
+            }
+            dirty = 1;
+        }
+        if (fs->is_dir[ino] && (rd32(raw + 4) % fs->bs) != 0) {
+            (void)problem(fs, 0, "directory inode %u: size %u not block aligned", ino, rd32(raw + 4));
+        }
+        if (dirty) {
+            (void)write_inode(fs, ino, raw);
+        }
+    }
+    return 0;
+}
+
+static void pass2(fsck_t* fs)
+{
+    uint8_t raw[INODE_RAW_SIZE];
+    for (uint32_t ino = 1; ino <= fs->inodes_count; ino++) {
+        if (!fs->is_dir[ino] || read_inode(fs, ino, raw) != 0) {
+            continue;
+        }
+        int dirty = 0;
+        walk_t w = { .fs = fs, .ino = ino, .op = WALK_DIR_CHECK, .claimed = 0, .data_index = 0 };
+        walk_inode(&w, raw, &dirty);
+        if (w.data_index == 0) {
+            (void)problem(fs, 0, "directory inode %u: no data blocks", ino);
+        }
+    }
+}
+
+static int dir_reachable(const fsck_t* fs, uint32_t d)
+{
+    uint32_t cur = d;
+    for (uint32_t steps = 0; steps <= fs->inodes_count; steps++) {
+        if (cur == EXT2_ROOT_INO) {
+            return 1;
+        }
+        if (cur == 0 || !fs->is_dir[cur]) {
+            return 0;
+        }
+        cur = fs->parent[cur];
+    }
+    return 0; /* parent cycle */
+}
+
+static void clear_inode(fsck_t* fs, uint32_t ino, uint32_t now)
+{
+    uint8_t raw[INODE_RAW_SIZE];
+    if (read_inode(fs, ino, raw) != 0) {
+        return;
+    }
+    if (has_block_map(fs, raw)) {
+        int dirty = 0;
+        walk_t w = { .fs = fs, .ino = ino, .op = WALK_RELEASE, .claimed = 0, .data_index = 0 };
+        walk_inode(&w, raw, &dirty);
+    }
+    wr16(raw + 26, 0);
+    /* dtime below inodes_count would read as an orphan-list link. */
+    wr32(raw + 20, (now > fs->inodes_count) ? now : fs->inodes_count + 1u);
+    (void)write_inode(fs, ino, raw);
+    fs->used[ino] = 0;
+    fs->is_dir[ino] = 0;
+}
+
+static void pass3(fsck_t* fs)
+{
+    uint8_t raw[INODE_RAW_SIZE];
+    for (uint32_t d = 1; d <= fs->inodes_count; d++) {
+        if (fs->is_dir[d] && dir_reachable(fs, d)) {
+            fs->reach[d] = 1;
+        }
+    }
+    for (uint32_t d = 1; d <= fs->inodes_count; d++) {
+        if (!fs->is_dir[d] || !fs->reach[d] || read_inode(fs, d, raw) != 0) {
+            continue;
+        }
+        fs->refs[d]++; /* '.' */
+        if (d == EXT2_ROOT_INO) {
+            fs->refs[d]++; /* root '..' points at itself */
+        }
+        int dirty = 0;
+        walk_t w = { .fs = fs, .ino = d, .op = WALK_DIR_COUNT, .claimed = 0, .data_index = 0 };
+        walk_inode(&w, raw, &dirty);
+
+        uint32_t want = (d == EXT2_ROOT_INO) ? EXT2_ROOT_INO : fs->parent[d];
+        if (fs->dotdot[d] && want && fs->dotdot[d] != want) {
+            (void)problem(fs, 0, "directory inode %u: '..' is %u, should be %u", d, fs->dotdot[d], want);
+        }
+    }
+
+    struct timespec ts;
+    uint32_t now = (clock_gettime(CLOCK_REALTIME, &ts) == 0) ? (uint32_t)ts.tv_sec : 0u;
+    for (uint32_t ino = 1; ino <= fs->inodes_count; ino++) {
+        if (!fs->used[ino] || (ino < fs->first_ino && ino != EXT2_ROOT_INO)) {
+            continue;
+        }
+        if (!fs->reach[ino]) {
+            if (problem(fs, 1, "unattached inode %u", ino)) {
+                clear_inode(fs, ino, now);
+            }
+            continue;
+        }
+        if (fs->refs[ino] != fs->links[ino] &&
+            problem(fs, 1, "inode %u: link count %u, should be %u", ino, fs->links[ino], fs->refs[ino])) {
+            if (read_inode(fs, ino, raw) == 0) {
+                wr16(raw + 26, fs->refs[ino]);
+                (void)write_inode(fs, ino, raw);
+            }
+        }
+    }
+}
+
+static void report_diff(fsck_t* fs, uint32_t g, const char* what,
+                        const uint32_t* plus, uint32_t np, const uint32_t* minus, uint32_t nm,
+                        uint32_t total, const uint8_t* map, uint32_t map_blk)
+{
+    char list[160];
+    size_t len = 0;
+    list[0] = '\0';
+    for (uint32_t i = 0; i < np && len + 12u < sizeof(list); i++) {
+        len += (size_t)snprintf(list + len, sizeof(list) - len, " +%u", plus[i]);
+    }
+    for (uint32_t i = 0; i < nm && len + 12u < sizeof(list); i++) {
+        len += (size_t)snprintf(list + len, sizeof(list) - len, " -%u", minus[i]);
+    }
+    if (problem(fs, 1, "group %u: %s bitmap differences (%u):%s%s", g, what, total, list,
+                (total > np + nm) ? " ..." : "")) {
+        (void)write_block(fs, map_blk, map);
+    }
+}
+
+static void pass4(fsck_t* fs)
+{
+    uint32_t plus[MAX_REPORT];
+    uint32_t minus[MAX_REPORT];
+    uint8_t* map = fs->io_buf;
+
+    for (uint32_t g = 0; g < fs->groups; g++) {
+        uint32_t first = group_first(fs, g);
+        uint32_t glen = group_len(fs, g);
+        uint32_t np = 0, nm = 0, total = 0, free = 0;
+
+        uint32_t bbm = gd_block_bitmap(fs, g);
+        if (read_block(fs, bbm, map) == 0) {
+            for (uint32_t i = 0; i < glen; i++) {
+                uint32_t blk = first + i;
+                int want = bit_get(fs->meta, blk) || bit_get(fs->claimed, blk);
+                int have = bit_get(map, i);
+                if (!want) {
+                    free++;
+                }
+                if (want == have) {
+                    continue;
+                }
+                total++;
+                if (want) {
+                    if (np < MAX_REPORT) plus[np++] = blk;
+                    bit_set(map, i);
+                } else {
+                    if (nm < MAX_REPORT) minus[nm++] = blk;
+                    bit_clr(map, i);
+                }
+            }
+            if (total) {
+                report_diff(fs, g, "block", plus, np, minus, nm, total, map, bbm);
+            }
+        }
+        fs->group_free_blocks[g] = free;
+
+        np = nm = total = free = 0;
+        uint32_t dirs = 0;
+        uint32_t ibm = gd_inode_bitmap(fs, g);
+        if (read_block(fs, ibm, map) == 0) {
+            for (uint32_t i = 0; i < fs->ipg; i++) {
+                uint32_t ino = g * fs->ipg + i + 1u;
+                if (ino > fs->inodes_count) {
+                    break;
+                }
+                int want = fs->used[ino];
+                int have = bit_get(map, i);
+                if (!want) {
+                    free++;
+                } else if (fs->is_dir[ino]) {
+                    dirs++;
+                }
+                if (want == have) {
+                    continue;
+                }
+                total++;
+                if (want) {
+                    if (np < MAX_REPORT) plus[np++] = ino;
+                    bit_set(map, i);
+                } else {
+                    if (nm < MAX_REPORT) minus[nm++] = ino;
+                    bit_clr(map, i);
+                }
+            }
+            if (total) {
+                report_diff(fs, g, "inode", plus, np, minus, nm, total, map, ibm);
+            }
+        }
+        fs->group_free_inodes[g] = free;
+        fs->group_dirs[g] = dirs;
+    }
+}
+
+static void pass5(fsck_t* fs)
+{
+    int gdt_dirty = 0;
+    uint32_t total_fb = 0;
+    uint32_t total_fi = 0;
+    for (uint32_t g = 0; g < fs->groups; g++) {
+        uint8_t* gd = fs->gdt + g * 32u;
+        uint32_t fb = rd16(gd + 12), fi = rd16(gd + 14), ud = rd16(gd + 16);
+        uint32_t nfb = fs->group_free_blocks[g];
+        uint32_t nfi = fs->group_free_inodes[g];
+        uint32_t nud = fs->group_dirs[g];
+        total_fb += nfb;
+        total_fi += nfi;
+        if ((fb != nfb || fi != nfi || ud != nud) &&
+            problem(fs, 1, "group %u: counters free_blocks/free_inodes/dirs %u/%u/%u, should be %u/%u/%u",
+                    g, fb, fi, ud, nfb, nfi, nud)) {
+            wr16(gd + 12, (uint16_t)nfb);
+            wr16(gd + 14, (uint16_t)nfi);
+            wr16(gd + 16, (uint16_t)nud);
+            gdt_dirty = 1;
+        }
+    }
+    if (gdt_dirty) {
+        for (uint32_t i = 0; i < fs->gdt_blocks; i++) {
+            (void)write_block(fs, fs->first_data_block + 1u + i, fs->gdt + (size_t)i * fs->bs);
+        }
+    }
+
+    int sb_dirty = 0;
+    if (fs->sb_free_blocks != total_fb &&
+        problem(fs, 1, "superblock free_blocks %u, should be %u", fs->sb_free_blocks, total_fb)) {
+        wr32(fs->sb + 0x0C, total_fb);
+        sb_dirty = 1;
+    }
+    if (fs->sb_free_inodes != total_fi &&
+        problem(fs, 1, "superblock free_inodes %u, should be %u", fs->sb_free_inodes, total_fi)) {
+        wr32(fs->sb + 0x10, total_fi);
+        sb_dirty = 1;
+    }
+    if (sb_dirty && write_at(fs, 1024u, fs->sb, sizeof(fs->sb)) != 0) {
+        out("fsck_ext2: superblock write failed\n");
+    }
+}
+
+static void usage(void)
+{
+    out("usage: fsck_ext2 [-n|-y] [-v] <device|/path>\n");
+    out("  -n  check only (default)\n");
+    out("  -y  repair in place (do not use on a mounted volume)\n");
+    out("  -v  print geometry\n");
+}
+
+int main(int argc, char** argv)
+{
+    fsck_t fs;
+    memset(&fs, 0, sizeof(fs));
+    const char* target = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        if (a[0] == '-' && a[1] && !a[2]) {
+            if (a[1] == 'n') {
+                fs.repair = 0;
+            } else if (a[1] == 'y') {
+                fs.repair = 1;
+            } else if (a[1] == 'v') {
+                fs.verbose = 1;
+            } else {
+                usage();
+                return FSCK_EXIT_OPERATIONAL;
+            }
+        } else if (!target) {
+            target = a;
+        } else {
+            usage();
+            return FSCK_EXIT_OPERATIONAL;
+        }
+    }
+    if (!target) {
+        usage();
+        return FSCK_EXIT_OPERATIONAL;
+    }
+
+    char path[64];
+    if (strchr(target, '/')) {
+        snprintf(path, sizeof(path), "%s", target);
+    } else {
+        snprintf(path, sizeof(path), "/dev/%s", target);
+    }
+    fs.path = path;
+    fs.fd = open(path, fs.repair ? O_RDWR : O_RDONLY);
+    if (fs.fd < 0) {
+        out("fsck_ext2: cannot open %s\n", path);
+        return FSCK_EXIT_OPERATIONAL;
+    }
+
+    if (load_super(&fs) != 0 || alloc_state(&fs) != 0 || build_metadata(&fs) != 0) {
+        (void)close(fs.fd);
+        return FSCK_EXIT_OPERATIONAL;
+    }
+    if (fs.verbose) {
+        out("fsck_ext2: %s: %u blocks x %u, %u inodes, %u groups\n",
+            path, fs.blocks_count, fs.bs, fs.inodes_count, fs.groups);
+    }
+    if (pass1(&fs) != 0) {
+        (void)close(fs.fd);
+        return FSCK_EXIT_OPERATIONAL;
+    }
+    pass2(&fs);
+    pass3(&fs);
+    pass4(&fs);
+    pass5(&fs);
+
+    uint32_t free_blocks = 0;
+    uint32_t free_inodes = 0;
+    for (uint32_t g = 0; g < fs.groups; g++) {
+        free_blocks += fs.group_free_blocks[g];
+        free_inodes += fs.group_free_inodes[g];
+    }
+    out("fsck_ext2: %s: %u/%u inodes, %u/%u blocks, %u problem(s), %u fixed\n",
+        path, fs.inodes_count - free_inodes, fs.inodes_count,
+        fs.blocks_count - free_blocks, fs.blocks_count, fs.errors, fs.fixed);
+    if (fs.repair && fs.fixed) {
+        (void)fsync(fs.fd);
+    }
+    (void)close(fs.fd);
+
+    if (fs.errors == 0) {
+        return FSCK_EXIT_OK;
+    }
+    return (fs.errors == fs.fixed) ? FSCK_EXIT_FIXED : FSCK_EXIT_UNCORRECTED;
+}
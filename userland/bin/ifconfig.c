@@ -1,9 +1,14 @@
 /*
  * ifconfig.c
  * Minimal interface list utility for Rodnix.
+ *
+ *   ifconfig                  interfaces and per-queue poll statistics
+ *   ifconfig <if> budget <n>  frames per queue per poll pass (0 = default)
  */
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include "unistd.h"
 #include "posix_syscall.h"
 #include "netif.h"
@@ -12,6 +17,7 @@
 
 #define FD_STDOUT 1
 #define NETIF_MAX_QUERY 16
+#define NETIF_QSTAT_QUERY 128
 
 static long write_buf(const char* s, uint64_t len)
 {
@@ -86,7 +92,67 @@ static void write_ipv4(uint32_t ip_host_order)
     write_u64((uint64_t)(ip_host_order & 0xFFu));
 }
 
-int main(void)
+static netif_qstat_t g_qs[NETIF_QSTAT_QUERY];
+
+static void write_queues(const char* name, const netif_qstat_t* qs, long nq)
+{
+    for (long i = 0; i < nq; i++) {
+        const netif_qstat_t* q = &qs[i];
+        if (strcmp(q->name, name) != 0) {
+            continue;
+        }
+        (void)write_str("  rxq");
+        write_u64(q->queue);
+        (void)write_str(" cpu ");
+        write_u64(q->cpu);
+        (void)write_str((q->flags & NETIF_QSTAT_NAPI) ? " napi" : " polled");
+        (void)write_str(" budget ");
+        write_u64(q->budget);
+        (void)write_str(" irqs=");
+        write_u64(q->irqs);
+        (void)write_str(" polls=");
+        write_u64(q->polls);
+        (void)write_str(" pkts=");
+        write_u64(q->rx_frames);
+        (void)write_str(" pkts/poll=");
+        uint64_t tenths = q->polls ? (q->rx_frames * 10u) / q->polls : 0u;
+        write_u64(tenths / 10u);
+        (void)write_buf(".", 1);
+        write_u64(tenths % 10u);
+        (void)write_str("\n    budget_hits=");
+        write_u64(q->budget_hits);
+        (void)write_str(" rearms=");
+        write_u64(q->rearms);
+        (void)write_str(" busy_polls=");
+        write_u64(q->busy_polls);
+        (void)write_str("\n");
+    }
+}
+
+static int set_budget(const netif_info_t* ifs, long n, const char* name, const char* value)
+{
+    char* end = NULL;
+    unsigned long v = strtoul(value, &end, 0);
+    if (!end || *end != '\0' || end == value) {
+        (void)write_str("ifconfig: bad budget\n");
+        return 2;
+    }
+    for (long i = 0; i < n; i++) {
+        if (strcmp(ifs[i].name, name) != 0) {
+            continue;
+        }
+        long rc = posix_netifset((uint32_t)i, NETIF_SET_POLL_BUDGET, (uint64_t)v);
+        if (rc < 0) {
+            (void)write_str("ifconfig: netifset failed\n");
+            return 1;
+        }
+        return 0;
+    }
+    (void)write_str("ifconfig: no such interface\n");
+    return 1;
+}
+
+int main(int argc, char** argv)
 {
     netif_info_t ifs[NETIF_MAX_QUERY];
     uint32_t total = 0;
@@ -95,6 +161,18 @@ int main(void)
         (void)write_str("ifconfig: netiflist failed\n");
         return 1;
     }
+    if (argc >= 2) {
+        if (argc == 4 && strcmp(argv[2], "budget") == 0) {
+            return set_budget(ifs, n, argv[1], argv[3]);
+        }
+        (void)write_str("usage: ifconfig [<if> budget <n>]\n");
+        return 2;
+    }
+    uint32_t qtotal = 0;
+    long nq = posix_netqstat(g_qs, NETIF_QSTAT_QUERY, &qtotal);
+    if (nq < 0) {
+        nq = 0;
+    }
 
     (void)write_str("ifconfig: interfaces=");
     write_u64((uint64_t)total);
@@ -126,6 +204,7 @@ int main(void)
         (void)write_str(" drops=");
         write_u64(ifs[i].stats.drops);
         (void)write_str("\n");
+        write_queues(ifs[i].name, g_qs, nq);
     }
 
     if (total > (uint32_t)n) {
@@ -0,0 +1,210 @@
+/*
+ * kasan.c
+ * Kernel address sanitizer control (kasan syscall, KASAN=1 kernels):
+ * report counters, heap quarantine and shadow size, the in-kernel
+ * self-test and kmemleak scans. Allocation stacks are resolved with
+ * /boot/kernel.syms when present.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "posix_syscall.h"
+#include "kasan.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "sys/stat.h"
+
+#define KS_KSYMS_PATH "/boot/kernel.syms"
+
+typedef struct ksym {
+    uint64_t addr;
+    const char* name;
+} ksym_t;
+
+static ksym_t* g_ksyms = NULL;
+static uint32_t g_nksyms = 0;
+
+static void usage(void)
+{
+    fputs("usage: kasan [info|selftest|leaks|clear]\n"
+          "  info      report counters, quarantine and heap totals (default)\n"
+          "  selftest  make deliberate bad accesses, check each is reported\n"
+          "  leaks     scan for unreferenced kmalloc blocks\n"
+          "  clear     stop reporting the blocks that are live now\n",
+          stdout);
+}
+
+/* nm -n output: "<hex> <type> <name>", already sorted by address. */
+static void load_ksyms(void)
+{
+    int fd = open(KS_KSYMS_PATH, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return;
+    }
+    char* buf = (char*)malloc((size_t)st.st_size + 1);
+    if (!buf) {
+        close(fd);
+        return;
+    }
+    size_t len = 0;
+    while (len < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + len, (size_t)st.st_size - len);
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+    }
+    close(fd);
+    buf[len] = '\0';
+    uint32_t lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        lines += buf[i] == '\n';
+    }
+    g_ksyms = (ksym_t*)malloc(sizeof(ksym_t) * (lines + 1));
+    if (!g_ksyms) {
+        return;
+    }
+    char* p = buf;
+    while (*p) {
+        char* line = p;
+        while (*p && *p != '\n') {
+            p++;
+        }
+        if (*p) {
+            *p++ = '\0';
+        }
+        char* end = NULL;
+        unsigned long addr = strtoul(line, &end, 16);
+        if (!end || end == line || end[0] != ' ' || !end[1] || end[2] != ' ') {
+            continue;
+        }
+        if (end[1] != 'T' && end[1] != 't' && end[1] != 'W' && end[1] != 'w') {
+            continue;
+        }
+        g_ksyms[g_nksyms].addr = (uint64_t)addr;
+        g_ksyms[g_nksyms].name = end + 3;
+        g_nksyms++;
+    }
+}
+
+static const char* ksym_name(uint64_t ip, uint64_t* off)
+{
+    if (g_nksyms == 0 || ip < g_ksyms[0].addr) {
+        return NULL;
+    }
+    uint32_t lo = 0;
+    uint32_t hi = g_nksyms;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (g_ksyms[mid].addr <= ip) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    *off = ip - g_ksyms[lo].addr;
+    return g_ksyms[lo].name;
+}
+
+static void print_ip(const char* prefix, uint64_t ip)
+{
+    uint64_t off = 0;
+    const char* sym = ksym_name(ip, &off);
+    if (sym) {
+        printf("%s%s+0x%llx\n", prefix, sym, (unsigned long long)off);
+    } else {
+        printf("%s0x%llx\n", prefix, (unsigned long long)ip);
+    }
+}
+
+static int fail(const char* cmd, long rc)
+{
+    fprintf(stderr, "kasan: %s failed (%ld)%s\n", cmd, rc,
+            rc == -7 ? ": kernel not built with KASAN=1" : rc == -6 ? ": must run as root" : "");
+    return 1;
+}
+
+static int cmd_info(void)
+{
+    rodnix_kasan_stats_t st;
+    memset(&st, 0, sizeof(st));
+    long rc = posix_kasan(KASAN_OP_INFO, &st, 0);
+    if (rc != 0) {
+        return fail("info", rc);
+    }
+    printf("kasan: %s, shadow %llu KB for 0x%llx-0x%llx\n", st.enabled ? "on" : "off",
+           (unsigned long long)(st.shadow_bytes / 1024u), (unsigned long long)st.shadow_start,
+           (unsigned long long)st.shadow_end);
+    printf("  reports %llu: out-of-bounds %llu, use-after-free %llu, page use-after-free %llu, "
+           "wild %llu, double free %llu\n",
+           (unsigned long long)st.reports, (unsigned long long)st.bugs[KASAN_BUG_OOB],
+           (unsigned long long)st.bugs[KASAN_BUG_UAF], (unsigned long long)st.bugs[KASAN_BUG_PAGE_UAF],
+           (unsigned long long)st.bugs[KASAN_BUG_WILD], (unsigned long long)st.bugs[KASAN_BUG_DOUBLE_FREE]);
+    printf("  heap: %llu objects, %llu bytes; quarantine: %llu objects, %llu bytes\n",
+           (unsigned long long)st.heap_objects, (unsigned long long)st.heap_bytes,
+           (unsigned long long)st.quarantine_objects, (unsigned long long)st.quarantine_bytes);
+    return 0;
+}
+
+static int cmd_leaks(void)
+{
+    rodnix_kmemleak_record_t* recs =
+        (rodnix_kmemleak_record_t*)malloc(sizeof(rodnix_kmemleak_record_t) * KASAN_LEAK_SCAN_MAX);
+    if (!recs) {
+        fputs("kasan: out of memory\n", stderr);
+        return 1;
+    }
+    long n = posix_kasan(KASAN_OP_LEAK_SCAN, recs, KASAN_LEAK_SCAN_MAX);
+    if (n < 0) {
+        free(recs);
+        return fail("leaks", n);
+    }
+    load_ksyms();
+    printf("kmemleak: %ld unreferenced object%s\n", n, n == 1 ? "" : "s");
+    for (long i = 0; i < n && i < (long)KASAN_LEAK_SCAN_MAX; i++) {
+        const rodnix_kmemleak_record_t* r = &recs[i];
+        printf("object 0x%llx size %llu age %llums%s\n", (unsigned long long)r->addr,
+               (unsigned long long)r->size, (unsigned long long)(r->age_ticks * 10u),
+               (r->flags & KMEMLEAK_REC_NEW) ? " (new)" : "");
+        for (uint32_t k = 0; k < r->depth && k < KASAN_STACK_DEPTH; k++) {
+            print_ip("    ", r->ips[k]);
+        }
+    }
+    free(recs);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* cmd = argc > 1 ? argv[1] : "info";
+    if (argc > 2) {
+        usage();
+        return 1;
+    }
+    if (strcmp(cmd, "info") == 0) {
+        return cmd_info();
+    }
+    if (strcmp(cmd, "leaks") == 0) {
+        return cmd_leaks();
+    }
+    long rc;
+    if (strcmp(cmd, "selftest") == 0) {
+        rc = posix_kasan(KASAN_OP_SELFTEST, NULL, 0);
+        if (rc == 0) {
+            puts("kasan: self-test passed");
+        }
+    } else if (strcmp(cmd, "clear") == 0) {
+        rc = posix_kasan(KASAN_OP_LEAK_CLEAR, NULL, 0);
+    } else {
+        usage();
+        return 1;
+    }
+    return rc == 0 ? 0 : fail(cmd, rc);
+}
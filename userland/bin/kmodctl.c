@@ -95,6 +95,10 @@ int main(int argc, char** argv)
             (void)write_str(mods[i].builtin ? "builtin" : "loadable");
             (void)write_str(" ");
             (void)write_str(mods[i].loaded ? "loaded" : "unloaded");
+            (void)write_str(" refs=");
+            write_u64(mods[i].refs);
+            (void)write_str(" deps=");
+            write_u64(mods[i].ndeps);
             (void)write_str("\n");
         }
         return 0;
@@ -122,6 +126,10 @@ int main(int argc, char** argv)
             return 1;
         }
         long rc = posix_kmodunload(argv[2]);
+        if (rc == -5) {
+            (void)write_str("kmodctl: module in use\n");
+            return 1;
+        }
         if (rc < 0) {
             (void)write_str("kmodctl: unload failed\n");
             return 1;
@@ -0,0 +1,190 @@
+/*
+ * lattrace.c
+ * Latency tracer control (lattrace syscall): start/stop/reset the tracer
+ * and report the worst preempt-off and IRQ-off sections with the call site
+ * that opened them and the kernel stack where they closed, plus kernel
+ * preemption counters. Addresses are resolved with /boot/kernel.syms when
+ * present.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "posix_syscall.h"
+#include "lattrace.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "sys/stat.h"
+
+#define LT_KSYMS_PATH "/boot/kernel.syms"
+
+typedef struct ksym {
+    uint64_t addr;
+    const char* name;
+} ksym_t;
+
+static ksym_t* g_ksyms = NULL;
+static uint32_t g_nksyms = 0;
+
+static void usage(void)
+{
+    fputs("usage: lattrace [on|off|reset|report]\n"
+          "  on      start tracing (clears nothing; see reset)\n"
+          "  off     stop tracing, keep the results\n"
+          "  reset   clear the worst sections and totals\n"
+          "  report  print the worst sections (default)\n",
+          stdout);
+}
+
+/* nm -n output: "<hex> <type> <name>", already sorted by address. */
+static void load_ksyms(void)
+{
+    int fd = open(LT_KSYMS_PATH, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return;
+    }
+    char* buf = (char*)malloc((size_t)st.st_size + 1);
+    if (!buf) {
+        close(fd);
+        return;
+    }
+    size_t len = 0;
+    while (len < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + len, (size_t)st.st_size - len);
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+    }
+    close(fd);
+    buf[len] = '\0';
+    uint32_t lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        lines += buf[i] == '\n';
+    }
+    g_ksyms = (ksym_t*)malloc(sizeof(ksym_t) * (lines + 1));
+    if (!g_ksyms) {
+        return;
+    }
+    char* p = buf;
+    while (*p) {
+        char* line = p;
+        while (*p && *p != '\n') {
+            p++;
+        }
+        if (*p) {
+            *p++ = '\0';
+        }
+        char* end = NULL;
+        unsigned long addr = strtoul(line, &end, 16);
+        if (!end || end == line || end[0] != ' ' || !end[1] || end[2] != ' ') {
+            continue;
+        }
+        if (end[1] != 'T' && end[1] != 't' && end[1] != 'W' && end[1] != 'w') {
+            continue;
+        }
+        g_ksyms[g_nksyms].addr = (uint64_t)addr;
+        g_ksyms[g_nksyms].name = end + 3;
+        g_nksyms++;
+    }
+}
+
+static const char* ksym_name(uint64_t ip, uint64_t* off)
+{
+    if (g_nksyms == 0 || ip < g_ksyms[0].addr) {
+        return NULL;
+    }
+    uint32_t lo = 0;
+    uint32_t hi = g_nksyms;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (g_ksyms[mid].addr <= ip) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    *off = ip - g_ksyms[lo].addr;
+    return g_ksyms[lo].name;
+}
+
+static void print_ip(const char* prefix, uint64_t ip)
+{
+    uint64_t off = 0;
+    const char* sym = ksym_name(ip, &off);
+    if (sym) {
+        printf("%s%s+0x%llx\n", prefix, sym, (unsigned long long)off);
+    } else {
+        printf("%s0x%llx\n", prefix, (unsigned long long)ip);
+    }
+}
+
+static void print_kind(const rodnix_lattrace_t* r, uint32_t kind, const char* title)
+{
+    const rodnix_lat_record_t* w = &r->worst[kind];
+    uint64_t n = r->sections[kind];
+    printf("%s: %llu sections, avg %lluus, max %lluus\n", title,
+           (unsigned long long)n,
+           (unsigned long long)(n ? r->total_ns[kind] / n / 1000u : 0),
+           (unsigned long long)(w->max_ns / 1000u));
+    if (w->max_ns == 0) {
+        return;
+    }
+    printf("  pid %u (%s)\n", (unsigned)w->pid, w->comm[0] ? w->comm : "kernel");
+    print_ip("  opened at ", w->start_ip);
+    printf("  closed at:\n");
+    for (uint32_t i = 0; i < w->nr_ips && i < LATTRACE_MAX_DEPTH; i++) {
+        print_ip("    ", w->ips[i]);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* cmd = argc > 1 ? argv[1] : "report";
+    if (argc > 2) {
+        usage();
+        return 1;
+    }
+    uint32_t op;
+    if (strcmp(cmd, "on") == 0) {
+        op = LATTRACE_OP_START;
+    } else if (strcmp(cmd, "off") == 0) {
+        op = LATTRACE_OP_STOP;
+    } else if (strcmp(cmd, "reset") == 0) {
+        op = LATTRACE_OP_RESET;
+    } else if (strcmp(cmd, "report") == 0) {
+        op = LATTRACE_OP_READ;
+    } else {
+        usage();
+        return 1;
+    }
+
+    rodnix_lattrace_t rep;
+    memset(&rep, 0, sizeof(rep));
+    long rc = posix_lattrace(op, op == LATTRACE_OP_READ ? &rep : NULL);
+    if (rc != 0) {
+        fprintf(stderr, "lattrace: %s failed (%ld)%s\n", cmd, rc, rc == -6 ? ": must run as root" : "");
+        return 1;
+    }
+    if (op != LATTRACE_OP_READ) {
+        return 0;
+    }
+
+    load_ksyms();
+    printf("preemption: %s, tracer %s\n",
+           rep.preempt_mode == PREEMPT_MODE_VOLUNTARY ? "voluntary" : "full",
+           rep.enabled ? "on" : "off");
+    printf("  preempted %llu, deferred %llu, at preempt_enable %llu, at cond_resched %llu, atomic sleeps %llu\n",
+           (unsigned long long)rep.involuntary, (unsigned long long)rep.deferred,
+           (unsigned long long)rep.enable_resched, (unsigned long long)rep.cond_resched,
+           (unsigned long long)rep.atomic_sleeps);
+    print_kind(&rep, LAT_PREEMPTOFF, "preempt-off");
+    print_kind(&rep, LAT_IRQSOFF, "irq-off");
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * lockstat.c
+ * Lock contention report (lockstat syscall): per lock class acquisitions,
+ * contention, spin and hold times, wait queue sleeps and the busiest call
+ * sites, plus lockdep dependency/violation counts. Needs a kernel built
+ * with LOCKSTAT=1 and/or LOCKDEP=1. Call sites are resolved with
+ * /boot/kernel.syms when present.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "posix_syscall.h"
+#include "lockstat.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "sys/stat.h"
+
+#define LS_MAX_CLASSES 128u
+#define LS_KSYMS_PATH "/boot/kernel.syms"
+
+typedef struct ksym {
+    uint64_t addr;
+    const char* name;
+} ksym_t;
+
+static ksym_t* g_ksyms = NULL;
+static uint32_t g_nksyms = 0;
+
+static void usage(void)
+{
+    fputs("usage: lockstat [-s acquired|contended|spin|hold|wait] [-n top] [-r]\n"
+          "  -s  sort key (default contended)\n"
+          "  -n  show call sites for the top N classes (default 5)\n"
+          "  -r  reset the statistics\n",
+          stdout);
+}
+
+/* nm -n output: "<hex> <type> <name>", already sorted by address. */
+static void load_ksyms(void)
+{
+    int fd = open(LS_KSYMS_PATH, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return;
+    }
+    char* buf = (char*)malloc((size_t)st.st_size + 1);
+    if (!buf) {
+        close(fd);
+        return;
+    }
+    size_t len = 0;
+    while (len < (size_t)st.st_size) {
+        ssize_t n = read(fd, buf + len, (size_t)st.st_size - len);
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+    }
+    close(fd);
+    buf[len] = '\0';
+    uint32_t lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        lines += buf[i] == '\n';
+    }
+    g_ksyms = (ksym_t*)malloc(sizeof(ksym_t) * (lines + 1));
+    if (!g_ksyms) {
+        return;
+    }
+    char* p = buf;
+    while (*p) {
+        char* line = p;
+        while (*p && *p != '\n') {
+            p++;
+        }
+        if (*p) {
+            *p++ = '\0';
+        }
+        char* end = NULL;
+        unsigned long addr = strtoul(line, &end, 16);
+        if (!end || end == line || end[0] != ' ' || !end[1] || end[2] != ' ') {
+            continue;
+        }
+        if (end[1] != 'T' && end[1] != 't' && end[1] != 'W' && end[1] != 'w') {
+            continue;
+        }
+        g_ksyms[g_nksyms].addr = (uint64_t)addr;
+        g_ksyms[g_nksyms].name = end + 3;
+        g_nksyms++;
+    }
+}
+
+static const char* ksym_name(uint64_t ip, uint64_t* off)
+{
+    if (g_nksyms == 0 || ip < g_ksyms[0].addr) {
+        return NULL;
+    }
+    uint32_t lo = 0;
+    uint32_t hi = g_nksyms;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (g_ksyms[mid].addr <= ip) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    *off = ip - g_ksyms[lo].addr;
+    return g_ksyms[lo].name;
+}
+
+static uint64_t sort_key(const rodnix_lockstat_t* s, const char* key)
+{
+    if (strcmp(key, "acquired") == 0) {
+        return s->kind == LOCK_KIND_WAITQ ? s->waits : s->acquired;
+    }
+    if (strcmp(key, "spin") == 0) {
+        return s->spin_ns;
+    }
+    if (strcmp(key, "hold") == 0) {
+        return s->hold_ns;
+    }
+    if (strcmp(key, "wait") == 0) {
+        return s->wait_ns;
+    }
+    return s->kind == LOCK_KIND_WAITQ ? s->waits : s->contended;
+}
+
+static uint64_t avg(uint64_t total, uint64_t n)
+{
+    return n ? total / n : 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* key = "contended";
+    uint32_t top = 5;
+    int reset = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            key = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            top = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-r") == 0) {
+            reset = 1;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    long features = posix_lockstat(LOCKSTAT_OP_INFO, NULL, 0, 0);
+    if (features <= 0) {
+        fputs("lockstat: kernel built without LOCKSTAT=1 / LOCKDEP=1\n", stderr);
+        return 1;
+    }
+    if (reset) {
+        long rc = posix_lockstat(LOCKSTAT_OP_RESET, NULL, 0, 0);
+        if (rc != 0) {
+            fprintf(stderr, "lockstat: reset failed (%ld)\n", rc);
+            return 1;
+        }
+        return 0;
+    }
+
+    rodnix_lockstat_t* st = (rodnix_lockstat_t*)malloc(sizeof(*st) * LS_MAX_CLASSES);
+    if (!st) {
+        fputs("lockstat: out of memory\n", stderr);
+        return 1;
+    }
+    long n = posix_lockstat(LOCKSTAT_OP_READ, st, LS_MAX_CLASSES, 0);
+    if (n < 0) {
+        fprintf(stderr, "lockstat: read failed (%ld)%s\n", n, n == -6 ? ": must run as root" : "");
+        return 1;
+    }
+    /* Insertion sort, descending: at most LS_MAX_CLASSES entries. */
+    for (long i = 1; i < n; i++) {
+        rodnix_lockstat_t v = st[i];
+        long j = i;
+        while (j > 0 && sort_key(&st[j - 1], key) < sort_key(&v, key)) {
+            st[j] = st[j - 1];
+            j--;
+        }
+        st[j] = v;
+    }
+    load_ksyms();
+
+    printf("%-28s %10s %10s %6s %9s %9s %9s %9s",
+           "spinlock class", "acquired", "contended", "cont%", "spin-avg", "spin-max", "hold-avg", "hold-max");
+    if (features & LOCKSTAT_F_LOCKDEP) {
+        printf(" %5s %5s", "deps", "viol");
+    }
+    printf("\n");
+    for (long i = 0; i < n; i++) {
+        const rodnix_lockstat_t* s = &st[i];
+        if (s->kind != LOCK_KIND_SPIN) {
+            continue;
+        }
+        printf("%-28s %10llu %10llu %5llu%% %7lluus %7lluus %7lluus %7lluus",
+               s->name, (unsigned long long)s->acquired, (unsigned long long)s->contended,
+               (unsigned long long)avg(s->contended * 100u, s->acquired),
+               (unsigned long long)(avg(s->spin_ns, s->contended) / 1000u),
+               (unsigned long long)(s->spin_max_ns / 1000u),
+               (unsigned long long)(avg(s->hold_ns, s->acquired) / 1000u),
+               (unsigned long long)(s->hold_max_ns / 1000u));
+        if (features & LOCKSTAT_F_LOCKDEP) {
+            printf(" %5u %5u", (unsigned)s->deps, (unsigned)s->violations);
+        }
+        printf("\n");
+    }
+
+    printf("\n%-28s %10s %10s %10s %11s %11s\n",
+           "wait queue", "waits", "wakeups", "timeouts", "wait-avg", "wait-max");
+    for (long i = 0; i < n; i++) {
+        const rodnix_lockstat_t* s = &st[i];
+        if (s->kind != LOCK_KIND_WAITQ) {
+            continue;
+        }
+        printf("%-28s %10llu %10llu %10llu %9llums %9llums\n",
+               s->name, (unsigned long long)s->waits, (unsigned long long)s->wakeups,
+               (unsigned long long)s->timeouts,
+               (unsigned long long)(avg(s->wait_ns, s->waits) / 1000000u),
+               (unsigned long long)(s->wait_max_ns / 1000000u));
+    }
+
+    printf("\ncall sites (top %u by %s):\n", (unsigned)top, key);
+    for (long i = 0; i < n && (uint32_t)i < top; i++) {
+        const rodnix_lockstat_t* s = &st[i];
+        if (sort_key(s, key) == 0) {
+            break;
+        }
+        printf("  %s\n", s->name);
+        for (uint32_t k = 0; k < LOCKSTAT_SITES; k++) {
+            if (!s->site_ip[k]) {
+                continue;
+            }
+            uint64_t off = 0;
+            const char* sym = ksym_name(s->site_ip[k], &off);
+            if (sym) {
+                printf("    %-40s+0x%-6llx %10llu acq %10llu cont\n", sym, (unsigned long long)off,
+                       (unsigned long long)s->site_acquired[k], (unsigned long long)s->site_contended[k]);
+            } else {
+                printf("    0x%-45llx %10llu acq %10llu cont\n", (unsigned long long)s->site_ip[k],
+                       (unsigned long long)s->site_acquired[k], (unsigned long long)s->site_contended[k]);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,459 @@
+/*
+ * prof.c
+ * Sampling profiler front end (profctl/profread): starts the kernel
+ * profiler, optionally runs a command, drains the per-CPU sample buffers
+ * and prints folded stacks for flamegraph.pl / speedscope:
+ *
+ *   comm;user_root;...;user_leaf;kfunc_root_[k];...;kfunc_leaf_[k] <count>
+ *
+ * Kernel addresses are resolved with /boot/kernel.syms (nm -n output of the
+ * kernel ELF, put into the initrd by the build), user addresses with the
+ * ELF symbol table of /bin/<comm>. Unresolved frames print as hex.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "posix_syscall.h"
+#include "prof.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "sys/stat.h"
+#include "sys/wait.h"
+#include "time.h"
+
+#define PROF_KSYMS_PATH "/boot/kernel.syms"
+#define PROF_DRAIN_MS 100u
+#define PROF_CHUNK 64u
+#define PROF_MAX_IMAGES 16u
+#define PROF_FOLD_BUCKETS 1024u
+#define PROF_LINE_MAX 2048u
+
+typedef struct sym {
+    uint64_t addr;
+    const char* name;
+} sym_t;
+
+typedef struct symtab {
+    char comm[16];
+    sym_t* syms;
+    uint32_t count;
+    char* strings;   /* backing storage for names */
+} symtab_t;
+
+typedef struct fold {
+    struct fold* next;
+    uint64_t count;
+    char line[];
+} fold_t;
+
+/* Minimal ELF64 view for symbol tables. */
+typedef struct {
+    unsigned char e_ident[16];
+    uint16_t e_type, e_machine;
+    uint32_t e_version;
+    uint64_t e_entry, e_phoff, e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize, e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx;
+} elf64_ehdr_t;
+
+typedef struct {
+    uint32_t sh_name, sh_type;
+    uint64_t sh_flags, sh_addr, sh_offset, sh_size;
+    uint32_t sh_link, sh_info;
+    uint64_t sh_addralign, sh_entsize;
+} elf64_shdr_t;
+
+typedef struct {
+    uint32_t st_name;
+    unsigned char st_info, st_other;
+    uint16_t st_shndx;
+    uint64_t st_value, st_size;
+} elf64_sym_t;
+
+#define SHT_SYMTAB 2u
+#define STT_FUNC 2u
+
+static symtab_t g_ksyms;
+static symtab_t g_images[PROF_MAX_IMAGES];
+static uint32_t g_nimages = 0;
+static fold_t* g_folds[PROF_FOLD_BUCKETS];
+static uint64_t g_total = 0;
+
+static void usage(void)
+{
+    fputs("usage: prof [-t] [-p period] [-s seconds] [cmd [args...]]\n"
+          "  -t  sample on the timer tick even if a PMU is available\n"
+          "  -p  cycles between PMU samples (ticks in timer mode)\n"
+          "  -s  seconds to profile when no command is given (default 5)\n",
+          stdout);
+}
+
+static char* read_file(const char* path, size_t* len_out)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t len = (size_t)st.st_size;
+    char* buf = (char*)malloc(len + 1);
+    if (!buf) {
+        close(fd);
+        return NULL;
+    }
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = read(fd, buf + off, len - off);
+        if (n <= 0) {
+            break;
+        }
+        off += (size_t)n;
+    }
+    close(fd);
+    buf[off] = '\0';
+    *len_out = off;
+    return buf;
+}
+
+static void sort_syms(sym_t* s, uint32_t n)
+{
+    /* Shell sort: symbol tables here are a few thousand entries at most. */
+    for (uint32_t gap = n / 2; gap > 0; gap /= 2) {
+        for (uint32_t i = gap; i < n; i++) {
+            sym_t v = s[i];
+            uint32_t j = i;
+            while (j >= gap && s[j - gap].addr > v.addr) {
+                s[j] = s[j - gap];
+                j -= gap;
+            }
+            s[j] = v;
+        }
+    }
+}
+
+static uint64_t parse_hex(const char* s, const char** end)
+{
+    uint64_t v = 0;
+    for (;; s++) {
+        char c = *s;
+        if (c >= '0' && c <= '9') {
+            v = (v << 4) | (uint64_t)(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            v = (v << 4) | (uint64_t)(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            v = (v << 4) | (uint64_t)(c - 'A' + 10);
+        } else {
+            break;
+        }
+    }
+    *end = s;
+    return v;
+}
+
+/* "<hex> <type> <name>" per line; keeps text symbols only. */
+static void load_kernel_syms(void)
+{
+    size_t len = 0;
+    char* buf = read_file(PROF_KSYMS_PATH, &len);
+    if (!buf) {
+        fprintf(stderr, "prof: %s not found, kernel frames stay unresolved\n", PROF_KSYMS_PATH);
+        return;
+    }
+    uint32_t cap = 0;
+    for (size_t i = 0; i < len; i++) {
+        cap += buf[i] == '\n';
+    }
+    g_ksyms.syms = (sym_t*)malloc(sizeof(sym_t) * (cap + 1));
+    if (!g_ksyms.syms) {
+        free(buf);
+        return;
+    }
+    g_ksyms.strings = buf;
+    char* p = buf;
+    while (*p) {
+        char* line = p;
+        while (*p && *p != '\n') {
+            p++;
+        }
+        if (*p) {
+            *p++ = '\0';
+        }
+        const char* q = line;
+        uint64_t addr = parse_hex(line, &q);
+        if (q == line || q[0] != ' ' || !q[1] || q[2] != ' ') {
+            continue;
+        }
+        char type = q[1];
+        if (type != 'T' && type != 't' && type != 'W' && type != 'w') {
+            continue;
+        }
+        g_ksyms.syms[g_ksyms.count].addr = addr;
+        g_ksyms.syms[g_ksyms.count].name = q + 3;
+        g_ksyms.count++;
+    }
+    sort_syms(g_ksyms.syms, g_ksyms.count);
+}
+
+static void load_elf_syms(symtab_t* t)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/bin/%s", t->comm);
+    size_t len = 0;
+    char* img = read_file(path, &len);
+    if (!img) {
+        return;
+    }
+    const elf64_ehdr_t* eh = (const elf64_ehdr_t*)img;
+    if (len < sizeof(*eh) || memcmp(eh->e_ident, "\177ELF", 4) != 0 || eh->e_ident[4] != 2 ||
+        eh->e_shentsize != sizeof(elf64_shdr_t) ||
+        eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(elf64_shdr_t) > len) {
+        free(img);
+        return;
+    }
+    const elf64_shdr_t* sh = (const elf64_shdr_t*)(img + eh->e_shoff);
+    for (uint32_t i = 0; i < eh->e_shnum; i++) {
+        if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum) {
+            continue;
+        }
+        const elf64_shdr_t* strsh = &sh[sh[i].sh_link];
+        if (sh[i].sh_offset + sh[i].sh_size > len || strsh->sh_offset + strsh->sh_size > len) {
+            break;
+        }
+        const elf64_sym_t* syms = (const elf64_sym_t*)(img + sh[i].sh_offset);
+        uint32_t n = (uint32_t)(sh[i].sh_size / sizeof(elf64_sym_t));
+        const char* strs = img + strsh->sh_offset;
+        t->syms = (sym_t*)malloc(sizeof(sym_t) * (n + 1));
+        if (!t->syms) {
+            break;
+        }
+        for (uint32_t k = 0; k < n; k++) {
+            if ((syms[k].st_info & 0xFu) != STT_FUNC || syms[k].st_value == 0 ||
+                syms[k].st_name >= strsh->sh_size) {
+                continue;
+            }
+            t->syms[t->count].addr = syms[k].st_value;
+            t->syms[t->count].name = strs + syms[k].st_name;
+            t->count++;
+        }
+        sort_syms(t->syms, t->count);
+        t->strings = img;
+        return;
+    }
+    free(img);
+}
+
+static symtab_t* image_for(const char* comm)
+{
+    for (uint32_t i = 0; i < g_nimages; i++) {
+        if (strcmp(g_images[i].comm, comm) == 0) {
+            return &g_images[i];
+        }
+    }
+    if (g_nimages == PROF_MAX_IMAGES || !comm[0]) {
+        return NULL;
+    }
+    symtab_t* t = &g_images[g_nimages++];
+    strncpy(t->comm, comm, sizeof(t->comm) - 1);
+    load_elf_syms(t);
+    return t;
+}
+
+static const char* lookup(const symtab_t* t, uint64_t addr)
+{
+    if (!t || t->count == 0 || addr < t->syms[0].addr) {
+        return NULL;
+    }
+    uint32_t lo = 0;
+    uint32_t hi = t->count;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (t->syms[mid].addr <= addr) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return t->syms[lo].name;
+}
+
+static size_t append(char* line, size_t off, const char* s)
+{
+    while (*s && off + 1 < PROF_LINE_MAX) {
+        line[off++] = *s++;
+    }
+    line[off] = '\0';
+    return off;
+}
+
+static size_t append_frame(char* line, size_t off, const symtab_t* t, uint64_t ip, int leaf, int kernel)
+{
+    char hex[24];
+    /* Return addresses point past the call: step back into it. */
+    const char* name = lookup(t, leaf ? ip : ip - 1);
+    if (!name) {
+        snprintf(hex, sizeof(hex), "0x%llx", (unsigned long long)ip);
+        name = hex;
+    }
+    off = append(line, off, ";");
+    off = append(line, off, name);
+    if (kernel) {
+        off = append(line, off, "_[k]");
+    }
+    return off;
+}
+
+static uint32_t hash_str(const char* s)
+{
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    }
+    return h;
+}
+
+static void fold_add(const char* line)
+{
+    uint32_t b = hash_str(line) % PROF_FOLD_BUCKETS;
+    for (fold_t* f = g_folds[b]; f; f = f->next) {
+        if (strcmp(f->line, line) == 0) {
+            f->count++;
+            return;
+        }
+    }
+    size_t len = strlen(line);
+    fold_t* f = (fold_t*)malloc(sizeof(fold_t) + len + 1);
+    if (!f) {
+        return;
+    }
+    memcpy(f->line, line, len + 1);
+    f->count = 1;
+    f->next = g_folds[b];
+    g_folds[b] = f;
+}
+
+static void fold_sample(const rodnix_prof_sample_t* s)
+{
+    static char line[PROF_LINE_MAX];
+    uint32_t nk = s->nr_kernel;
+    uint32_t nu = s->nr_user;
+    if (nk + nu > PROF_MAX_DEPTH) {
+        return;
+    }
+    char comm[17];
+    memcpy(comm, s->comm, 16);
+    comm[16] = '\0';
+    size_t off = append(line, 0, comm[0] ? comm : "[kernel]");
+    const symtab_t* img = image_for(comm);
+    /* ips: kernel leaf..root, then user leaf..root; folded output is root first. */
+    for (uint32_t i = nu; i > 0; i--) {
+        off = append_frame(line, off, img, s->ips[nk + i - 1], i == 1, 0);
+    }
+    for (uint32_t i = nk; i > 0; i--) {
+        off = append_frame(line, off, &g_ksyms, s->ips[i - 1], i == 1, 1);
+    }
+    fold_add(line);
+    g_total++;
+}
+
+static uint64_t drain(rodnix_prof_sample_t* buf, uint64_t* dropped)
+{
+    uint64_t n = 0;
+    for (;;) {
+        long r = posix_profread(buf, PROF_CHUNK, dropped);
+        if (r <= 0) {
+            break;
+        }
+        for (long i = 0; i < r; i++) {
+            fold_sample(&buf[i]);
+        }
+        n += (uint64_t)r;
+        if ((uint32_t)r < PROF_CHUNK) {
+            break;
+        }
+    }
+    return n;
+}
+
+static void sleep_ms(uint32_t ms)
+{
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ms / 1000u);
+    ts.tv_nsec = (long)(ms % 1000u) * 1000000L;
+    (void)nanosleep(&ts, NULL);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t flags = 0;
+    uint64_t period = 0;
+    uint32_t seconds = 5;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-t") == 0) {
+            flags |= PROF_F_TIMER;
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            period = (uint64_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seconds = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    rodnix_prof_sample_t* buf = (rodnix_prof_sample_t*)malloc(sizeof(*buf) * PROF_CHUNK);
+    if (!buf) {
+        fputs("prof: out of memory\n", stderr);
+        return 1;
+    }
+    load_kernel_syms();
+
+    rodnix_profstat_t st;
+    long rc = posix_profctl(PROF_OP_START, flags, period, &st);
+    if (rc != 0) {
+        fprintf(stderr, "prof: profctl start failed (%ld)%s\n", rc,
+                rc == -6 ? ": must run as root" : "");
+        return 1;
+    }
+    fprintf(stderr, "prof: %s sampling, period %llu %s\n",
+            st.mode == PROF_MODE_PMU ? "PMU" : "timer",
+            (unsigned long long)st.period, st.mode == PROF_MODE_PMU ? "cycles" : "ticks");
+
+    uint64_t dropped = 0;
+    if (i < argc) {
+        pid_t pid = spawnv(argv[i], &argv[i]);
+        if (pid < 0) {
+            fprintf(stderr, "prof: cannot run %s\n", argv[i]);
+            (void)posix_profctl(PROF_OP_STOP, 0, 0, NULL);
+            return 1;
+        }
+        int status = 0;
+        while (waitpid(pid, &status, WNOHANG) == 0) {
+            sleep_ms(PROF_DRAIN_MS);
+            (void)drain(buf, &dropped);
+        }
+    } else {
+        for (uint32_t t = 0; t < seconds * (1000u / PROF_DRAIN_MS); t++) {
+            sleep_ms(PROF_DRAIN_MS);
+            (void)drain(buf, &dropped);
+        }
+    }
+    (void)posix_profctl(PROF_OP_STOP, 0, 0, &st);
+    (void)drain(buf, &dropped);
+
+    for (uint32_t b = 0; b < PROF_FOLD_BUCKETS; b++) {
+        for (fold_t* f = g_folds[b]; f; f = f->next) {
+            printf("%s %llu\n", f->line, (unsigned long long)f->count);
+        }
+    }
+    fflush(stdout);
+    fprintf(stderr, "prof: %llu samples, %llu dropped\n",
+            (unsigned long long)g_total, (unsigned long long)st.dropped);
+    return 0;
+}
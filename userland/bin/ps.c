@@ -0,0 +1,119 @@
+/*
+ * ps.c
+ * Process list from one procstat(2) snapshot: ids, state, memory, faults,
+ * CPU time. -l adds context switches, read/write bytes and the task group.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "posix_syscall.h"
+#include "procstat.h"
+
+#define PS_CAP 64
+#define PS_PAGE_KB 4u
+
+static const char kStates[] = "NRRBSZD"; /* task_state_t: new ready running blocked sleeping zombie dead */
+
+static void put_col(const char* s, int width, int right)
+{
+    int len = (int)strlen(s);
+    if (right) {
+        for (int i = len; i < width; i++) {
+            fputs(" ", stdout);
+        }
+    }
+    fputs(s, stdout);
+    if (!right) {
+        for (int i = len; i < width; i++) {
+            fputs(" ", stdout);
+        }
+    }
+    fputs(" ", stdout);
+}
+
+static void put_u64(uint64_t v, int width)
+{
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+    put_col(buf, width, 1);
+}
+
+/* CPU time as M:SS.cc */
+static void put_time(uint64_t ns)
+{
+    char buf[24];
+    uint64_t cs = ns / 10000000ULL;
+    uint64_t sec = cs / 100u;
+    uint64_t frac = cs % 100u;
+    snprintf(buf, sizeof(buf), "%llu:%s%llu.%s%llu",
+             (unsigned long long)(sec / 60u),
+             (sec % 60u) < 10u ? "0" : "", (unsigned long long)(sec % 60u),
+             frac < 10u ? "0" : "", (unsigned long long)frac);
+    put_col(buf, 9, 1);
+}
+
+int main(int argc, char** argv)
+{
+    int longfmt = (argc > 1 && argv && argv[1] && strcmp(argv[1], "-l") == 0);
+    static rodnix_procstat_t procs[PS_CAP];
+    uint32_t total = 0;
+    long n = posix_procstat(procs, PS_CAP, &total);
+    if (n < 0) {
+        printf("ps: procstat failed (%ld)\n", n);
+        return 1;
+    }
+
+    put_col("PID", 5, 1);
+    put_col("PPID", 5, 1);
+    put_col("UID", 4, 1);
+    put_col("S", 1, 0);
+    put_col("THR", 3, 1);
+    put_col("RSS", 7, 1);
+    put_col("MAXRSS", 7, 1);
+    put_col("VSZ", 8, 1);
+    put_col("MINFLT", 7, 1);
+    put_col("MAJFLT", 6, 1);
+    put_col("TIME", 9, 1);
+    if (longfmt) {
+        put_col("VCSW", 7, 1);
+        put_col("IVCSW", 7, 1);
+        put_col("RDBYTES", 10, 1);
+        put_col("WRBYTES", 10, 1);
+        put_col("CG", 2, 1);
+    }
+    fputs("COMMAND\n", stdout);
+
+    for (long i = 0; i < n; i++) {
+        const rodnix_procstat_t* p = &procs[i];
+        char state[2] = { '?', '\0' };
+        if (p->state < sizeof(kStates) - 1u) {
+            state[0] = kStates[p->state];
+        }
+        put_u64(p->pid, 5);
+        put_u64(p->ppid, 5);
+        put_u64(p->uid, 4);
+        put_col(state, 1, 0);
+        put_u64(p->threads, 3);
+        put_u64(p->rss_pages * PS_PAGE_KB, 7);
+        put_u64(p->maxrss_pages * PS_PAGE_KB, 7);
+        put_u64(p->vsize_bytes / 1024u, 8);
+        put_u64(p->minflt, 7);
+        put_u64(p->majflt, 6);
+        put_time(p->utime_ns + p->stime_ns);
+        if (longfmt) {
+            put_u64(p->nvcsw, 7);
+            put_u64(p->nivcsw, 7);
+            put_u64(p->read_bytes, 10);
+            put_u64(p->write_bytes, 10);
+            put_u64(p->cgroup, 2);
+        }
+        fputs(p->comm[0] ? p->comm : "[kernel]", stdout);
+        fputs("\n", stdout);
+    }
+    if ((uint32_t)n < total) {
+        printf("ps: %ld of %u tasks shown\n", n, (unsigned)total);
+    }
+    fflush(stdout);
+    return 0;
+}
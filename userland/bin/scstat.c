@@ -56,7 +56,13 @@ static const char* syscall_name(uint32_t n)
         "kill", "sigaction", "sigreturn", "blocklist", "blockread",
         "kmodls", "kmodload", "kmodunload", "blockwrite", "truncate",
         "ftruncate", "poll", "select", "dup3", "pipe2", "futex", "msync",
-        "socket", "bind", "connect", "sendto", "recvfrom", "ping"
+        "socket", "bind", "connect", "sendto", "recvfrom", "ping",
+        "fsync", "fdatasync", "sync", "fallocate", "getrusage", "getrlimit", "setrlimit",
+        "procstat", "cgcreate", "cgdestroy", "cgattach", "cgset", "cgstat",
+        "profctl", "profread", "lockstat", "lattrace",
+        "sched_setscheduler", "sched_getscheduler", "sched_setattr", "sched_getattr",
+        "gcov", "kasan", "getrandom", "setsockopt", "netqstat", "netifset",
+        "gettid"
     };
     if (n < (uint32_t)(sizeof(kNames) / sizeof(kNames[0]))) {
         return kNames[n];
@@ -183,6 +183,31 @@ int main(void)
     (void)write_str("/");
     write_u64(s.oom_heap);
 
+    (void)write_str("\n\nReclaim:\n  lru active/inactive: ");
+    write_u64(s.lru_active_pages);
+    (void)write_str("/");
+    write_u64(s.lru_inactive_pages);
+    (void)write_str("\n  watermarks min/low/high: ");
+    write_u64(s.wmark_min_pages);
+    (void)write_str("/");
+    write_u64(s.wmark_low_pages);
+    (void)write_str("/");
+    write_u64(s.wmark_high_pages);
+    (void)write_str("\n  scanned/evicted/writeback/refaults: ");
+    write_u64(s.reclaim_scanned);
+    (void)write_str("/");
+    write_u64(s.reclaim_evicted);
+    (void)write_str("/");
+    write_u64(s.reclaim_writeback);
+    (void)write_str("/");
+    write_u64(s.reclaim_refaults);
+    (void)write_str("\n  kswapd wakeups/direct: ");
+    write_u64(s.reclaim_kswapd_wakeups);
+    (void)write_str("/");
+    write_u64(s.reclaim_direct);
+    (void)write_str("\n  shrunk: ");
+    write_mem_dynamic(s.reclaim_shrunk_bytes);
+
     (void)write_str("\n\nInterrupts:\n  apic: ");
     write_u64((uint64_t)s.apic_available);
     (void)write_str("\n  ioapic: ");
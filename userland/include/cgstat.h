@@ -0,0 +1,46 @@
+#ifndef _RODNIX_USERLAND_CGSTAT_H
+#define _RODNIX_USERLAND_CGSTAT_H
+
+#include <stdint.h>
+
+#define CG_ROOT_ID 0u
+#define CG_NAME_MAX 16
+#define CG_UNLIMITED 0x7fffffffffffffffULL
+
+/* cgset(2) keys. */
+#define CG_KEY_CPU_WEIGHT 1   /* 1..10000, default 100 */
+#define CG_KEY_CPU_MAX    2   /* quota in us per period, CG_UNLIMITED = none */
+#define CG_KEY_CPU_PERIOD 3   /* us, 10000..1000000 */
+#define CG_KEY_MEM_MAX    4   /* bytes, CG_UNLIMITED = none */
+#define CG_KEY_IO_WEIGHT  5   /* 1..10000, default 100 */
+
+/* One task group as reported by cgstat(2). */
+typedef struct rodnix_cgstat {
+    uint32_t id;
+    uint32_t parent_id;
+    uint32_t depth;
+    uint32_t nr_tasks;
+    uint32_t nr_children;
+    uint32_t dying;
+    char name[16];
+    uint32_t cpu_weight;
+    uint32_t io_weight;
+    uint64_t cpu_max_us;
+    uint64_t cpu_period_us;
+    uint64_t cpu_usage_us;
+    uint64_t cpu_nr_periods;
+    uint64_t cpu_nr_throttled;
+    uint64_t cpu_throttled_us;
+    uint64_t mem_max_bytes;
+    uint64_t mem_bytes;
+    uint64_t mem_anon_bytes;
+    uint64_t mem_file_bytes;
+    uint64_t mem_peak_bytes;
+    uint64_t mem_failcnt;
+    uint64_t mem_oom_kills;
+    uint64_t io_read_bytes;
+    uint64_t io_write_bytes;
+    uint64_t io_delay_us;
+} rodnix_cgstat_t;
+
+#endif /* _RODNIX_USERLAND_CGSTAT_H */
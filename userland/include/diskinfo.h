@@ -8,7 +8,7 @@ typedef struct rodnix_blockdev_info {
     uint32_t sector_size;
     uint64_t sector_count;
     uint32_t flags;
-    uint32_t reserved0;
+    uint32_t queue_depth;   /* commands kept in flight by the driver */
 } rodnix_blockdev_info_t;
 
 #endif /* _RODNIX_USERLAND_DISKINFO_H */
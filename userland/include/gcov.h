@@ -0,0 +1,25 @@
+#ifndef _RODNIX_USERLAND_GCOV_H
+#define _RODNIX_USERLAND_GCOV_H
+
+#include <stdint.h>
+
+/* gcov(2) ops; DUMP and RESET act on the kernel's counters and need root. */
+#define GCOV_OP_INFO  1
+#define GCOV_OP_DUMP  2
+#define GCOV_OP_RESET 3
+#define GCOV_OP_EMIT  4
+
+#define GCOV_EMIT_MAX (4u * 1024u * 1024u)
+
+#ifdef CONFIG_GCOV
+/*
+ * Profile runtime of a PGO=gen userland (libc/gcov.c). crt0 registers the
+ * counters before main and dumps them after it returns; _exit() and
+ * execve() dump as well, and a forked child starts from zero. A dump zeroes
+ * the counters it wrote, so the host can simply add up every dump.
+ */
+void __gcov_dump(void);
+void __gcov_reset(void);
+#endif
+
+#endif /* _RODNIX_USERLAND_GCOV_H */
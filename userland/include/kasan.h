@@ -0,0 +1,48 @@
+#ifndef _RODNIX_USERLAND_KASAN_H
+#define _RODNIX_USERLAND_KASAN_H
+
+#include <stdint.h>
+
+/* kasan(2) ops; all of them require root and a KASAN=1 kernel. */
+#define KASAN_OP_INFO       1
+#define KASAN_OP_SELFTEST   2
+#define KASAN_OP_LEAK_SCAN  3
+#define KASAN_OP_LEAK_CLEAR 4
+
+#define KASAN_LEAK_SCAN_MAX 256u
+#define KASAN_STACK_DEPTH   8
+
+#define KASAN_BUG_OOB         0
+#define KASAN_BUG_UAF         1
+#define KASAN_BUG_PAGE_UAF    2
+#define KASAN_BUG_WILD        3
+#define KASAN_BUG_DOUBLE_FREE 4
+#define KASAN_BUG_KINDS       5
+
+#define KMEMLEAK_REC_NEW 0x1u
+
+/* Sanitizer totals; reports are counted even past the printed maximum. */
+typedef struct rodnix_kasan_stats {
+    uint64_t enabled;
+    uint64_t shadow_start;
+    uint64_t shadow_end;
+    uint64_t shadow_bytes;
+    uint64_t reports;
+    uint64_t bugs[KASAN_BUG_KINDS];
+    uint64_t quarantine_bytes;
+    uint64_t quarantine_objects;
+    uint64_t heap_objects;
+    uint64_t heap_bytes;
+} rodnix_kasan_stats_t;
+
+/* Unreferenced kmalloc block: address, size, age (100 Hz ticks) and allocation stack. */
+typedef struct rodnix_kmemleak_record {
+    uint64_t addr;
+    uint64_t size;
+    uint64_t age_ticks;
+    uint32_t flags;
+    uint32_t depth;
+    uint64_t ips[KASAN_STACK_DEPTH];
+} rodnix_kmemleak_record_t;
+
+#endif /* _RODNIX_USERLAND_KASAN_H */
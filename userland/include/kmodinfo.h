@@ -10,8 +10,8 @@ typedef struct rodnix_kmod_info {
     uint32_t flags;
     uint8_t builtin;
     uint8_t loaded;
-    uint8_t reserved0;
-    uint8_t reserved1;
+    uint8_t refs;       /* loaded modules bound to this one */
+    uint8_t ndeps;      /* modules this one is bound to */
 } rodnix_kmod_info_t;
 
 #endif /* _RODNIX_USERLAND_KMODINFO_H */
@@ -0,0 +1,44 @@
+#ifndef _RODNIX_USERLAND_LATTRACE_H
+#define _RODNIX_USERLAND_LATTRACE_H
+
+#include <stdint.h>
+
+/* lattrace(2) ops; all of them require root. */
+#define LATTRACE_OP_READ  1
+#define LATTRACE_OP_START 2
+#define LATTRACE_OP_STOP  3
+#define LATTRACE_OP_RESET 4
+
+#define LAT_PREEMPTOFF 0
+#define LAT_IRQSOFF    1
+#define LAT_KINDS      2
+#define LATTRACE_MAX_DEPTH 16
+
+#define PREEMPT_MODE_VOLUNTARY 1
+#define PREEMPT_MODE_FULL      2
+
+/* Worst section of one kind: where it was opened and the stack where it closed. */
+typedef struct rodnix_lat_record {
+    uint64_t max_ns;
+    uint64_t start_ip;
+    uint32_t pid;
+    uint32_t nr_ips;
+    char comm[16];
+    uint64_t ips[LATTRACE_MAX_DEPTH];
+} rodnix_lat_record_t;
+
+/* lattrace(2) report: tracer totals per kind plus kernel preemption counters. */
+typedef struct rodnix_lattrace {
+    uint32_t enabled;
+    uint32_t preempt_mode;
+    uint64_t sections[LAT_KINDS];
+    uint64_t total_ns[LAT_KINDS];
+    uint64_t involuntary;       /* running threads preempted */
+    uint64_t deferred;          /* preemptions postponed by a preempt-off section */
+    uint64_t enable_resched;    /* ... and carried out by preempt_enable() */
+    uint64_t cond_resched;      /* switches at cond_resched() / syscall exit */
+    uint64_t atomic_sleeps;     /* threads that blocked with preemption disabled */
+    rodnix_lat_record_t worst[LAT_KINDS];
+} rodnix_lattrace_t;
+
+#endif /* _RODNIX_USERLAND_LATTRACE_H */
@@ -0,0 +1,41 @@
+#ifndef _RODNIX_USERLAND_LOCKSTAT_H
+#define _RODNIX_USERLAND_LOCKSTAT_H
+
+#include <stdint.h>
+
+/* lockstat(2) ops; LOCKSTAT_OP_INFO returns the LOCKSTAT_F_* mask of the running kernel. */
+#define LOCKSTAT_OP_INFO  1
+#define LOCKSTAT_OP_READ  2
+#define LOCKSTAT_OP_RESET 3
+
+#define LOCKSTAT_F_STATS   0x1u   /* built with LOCKSTAT=1 */
+#define LOCKSTAT_F_LOCKDEP 0x2u   /* built with LOCKDEP=1 */
+
+#define LOCK_KIND_SPIN  1
+#define LOCK_KIND_WAITQ 2
+#define LOCKSTAT_SITES  4
+
+/* One lock class as reported by lockstat(2); times in ns. */
+typedef struct rodnix_lockstat {
+    char name[32];
+    uint32_t id;
+    uint32_t kind;
+    uint64_t acquired;
+    uint64_t contended;
+    uint64_t spin_ns;
+    uint64_t spin_max_ns;
+    uint64_t hold_ns;
+    uint64_t hold_max_ns;
+    uint64_t waits;          /* wait queues: sleeps, wakeups, timeouts, time asleep */
+    uint64_t wakeups;
+    uint64_t timeouts;
+    uint64_t wait_ns;
+    uint64_t wait_max_ns;
+    uint32_t deps;           /* lockdep: classes taken while holding this one */
+    uint32_t violations;     /* lockdep: order inversions/recursion reported */
+    uint64_t site_ip[LOCKSTAT_SITES];
+    uint64_t site_acquired[LOCKSTAT_SITES];
+    uint64_t site_contended[LOCKSTAT_SITES];
+} rodnix_lockstat_t;
+
+#endif /* _RODNIX_USERLAND_LOCKSTAT_H */
@@ -29,4 +29,30 @@ _Static_assert(offsetof(netif_info_t, flags) == 28, "netif_info_t.flags ABI mism
 _Static_assert(offsetof(netif_info_t, ipv4_addr) == 32, "netif_info_t.ipv4_addr ABI mismatch");
 _Static_assert(offsetof(netif_info_t, stats) == 48, "netif_info_t.stats ABI mismatch");
 
+/* netif_qstat_t.flags */
+#define NETIF_QSTAT_NAPI  0x1u   /* interrupt driven, polled by netpolld */
+#define NETIF_QSTAT_SCHED 0x2u   /* poll pending */
+
+/* netifset() keys */
+#define NETIF_SET_POLL_BUDGET 1u /* frames per queue per poll pass; 0 = default */
+#define NETIF_BUDGET_MAX      256u
+
+typedef struct netif_qstat {
+    char name[16];
+    uint16_t queue;
+    uint16_t cpu;
+    int32_t vector;
+    uint32_t budget;
+    uint32_t flags;
+    uint64_t irqs;
+    uint64_t polls;
+    uint64_t rx_frames;
+    uint64_t budget_hits;
+    uint64_t rearms;
+    uint64_t busy_polls;
+} netif_qstat_t;
+
+_Static_assert(sizeof(netif_qstat_t) == 80, "netif_qstat_t ABI size mismatch");
+_Static_assert(offsetof(netif_qstat_t, irqs) == 32, "netif_qstat_t.irqs ABI mismatch");
+
 #endif /* _RODNIX_USERLAND_NETIF_H */
@@ -12,6 +12,13 @@
 #include "scstat.h"
 #include "diskinfo.h"
 #include "kmodinfo.h"
+#include "procstat.h"
+#include "cgstat.h"
+#include "prof.h"
+#include "lockstat.h"
+#include "lattrace.h"
+#include "gcov.h"
+#include "kasan.h"
 
 #ifndef RDNX_STDIN_INT80_READ_WORKAROUND
 #define RDNX_STDIN_INT80_READ_WORKAROUND 1
@@ -43,6 +50,11 @@ static inline long posix_getpid(void)
     return rdnx_syscall0(POSIX_SYS_GETPID);
 }
 
+static inline long posix_gettid(void)
+{
+    return rdnx_syscall0(POSIX_SYS_GETTID);
+}
+
 static inline long posix_write(int fd, const void* buf, uint64_t len)
 {
     return rdnx_syscall3(POSIX_SYS_WRITE, fd, (long)(uintptr_t)buf, (long)len);
@@ -125,6 +137,16 @@ static inline long posix_recvfrom(int fd,
                          (long)timeout_ms);
 }
 
+static inline long posix_setsockopt(int fd, int level, int optname, const void* optval, uint32_t optlen)
+{
+    return rdnx_syscall5(POSIX_SYS_SETSOCKOPT,
+                         (long)fd,
+                         (long)level,
+                         (long)optname,
+                         (long)(uintptr_t)optval,
+                         (long)optlen);
+}
+
 static inline long posix_ping(uint32_t dst_ip_host_order, uint32_t timeout_ms, uint32_t* out_rtt_ms)
 {
     return rdnx_syscall3(POSIX_SYS_PING,
@@ -228,6 +250,41 @@ static inline long posix_ftruncate(int fd, uint64_t size)
     return rdnx_syscall2(POSIX_SYS_FTRUNCATE, (long)fd, (long)size);
 }
 
+static inline long posix_fsync(int fd)
+{
+    return rdnx_syscall1(POSIX_SYS_FSYNC, (long)fd);
+}
+
+static inline long posix_fdatasync(int fd)
+{
+    return rdnx_syscall1(POSIX_SYS_FDATASYNC, (long)fd);
+}
+
+static inline long posix_sync(void)
+{
+    return rdnx_syscall0(POSIX_SYS_SYNC);
+}
+
+static inline long posix_fallocate(int fd, int mode, uint64_t off, uint64_t len)
+{
+    return rdnx_syscall4(POSIX_SYS_FALLOCATE, (long)fd, (long)mode, (long)off, (long)len);
+}
+
+static inline long posix_getrusage(int who, void* ru)
+{
+    return rdnx_syscall2(POSIX_SYS_GETRUSAGE, (long)who, (long)(uintptr_t)ru);
+}
+
+static inline long posix_getrlimit(int resource, void* rlim)
+{
+    return rdnx_syscall2(POSIX_SYS_GETRLIMIT, (long)resource, (long)(uintptr_t)rlim);
+}
+
+static inline long posix_setrlimit(int resource, const void* rlim)
+{
+    return rdnx_syscall2(POSIX_SYS_SETRLIMIT, (long)resource, (long)(uintptr_t)rlim);
+}
+
 static inline long posix_uname(void* u)
 {
     return rdnx_syscall1(POSIX_SYS_UNAME, (long)(uintptr_t)u);
@@ -274,6 +331,19 @@ static inline long posix_netiflist(void* entries, uint64_t max_entries, uint32_t
                          (long)(uintptr_t)out_total);
 }
 
+static inline long posix_netqstat(void* entries, uint64_t max_entries, uint32_t* out_total)
+{
+    return rdnx_syscall3(POSIX_SYS_NETQSTAT,
+                         (long)(uintptr_t)entries,
+                         (long)max_entries,
+                         (long)(uintptr_t)out_total);
+}
+
+static inline long posix_netifset(uint32_t index, uint32_t key, uint64_t value)
+{
+    return rdnx_syscall3(POSIX_SYS_NETIFSET, (long)index, (long)key, (long)value);
+}
+
 static inline long posix_hwlist(void* entries, uint64_t max_entries, uint32_t* out_total)
 {
     return rdnx_syscall3(POSIX_SYS_HWLIST,
@@ -395,6 +465,14 @@ static inline long posix_blocklist(rodnix_blockdev_info_t* entries, uint64_t max
                          (long)(uintptr_t)out_total);
 }
 
+static inline long posix_procstat(rodnix_procstat_t* entries, uint64_t max_entries, uint32_t* out_total)
+{
+    return rdnx_syscall3(POSIX_SYS_PROCSTAT,
+                         (long)(uintptr_t)entries,
+                         (long)max_entries,
+                         (long)(uintptr_t)out_total);
+}
+
 static inline long posix_blockread(const char* dev_name, uint64_t lba, void* out, uint64_t out_len)
 {
     return rdnx_syscall4(POSIX_SYS_BLOCKREAD,
@@ -431,4 +509,87 @@ static inline long posix_kmodunload(const char* name)
     return rdnx_syscall1(POSIX_SYS_KMODUNLOAD, (long)(uintptr_t)name);
 }
 
+static inline long posix_cgcreate(uint32_t parent_id, const char* name, uint32_t* out_id)
+{
+    return rdnx_syscall3(POSIX_SYS_CGCREATE,
+                         (long)parent_id,
+                         (long)(uintptr_t)name,
+                         (long)(uintptr_t)out_id);
+}
+
+static inline long posix_cgdestroy(uint32_t id)
+{
+    return rdnx_syscall1(POSIX_SYS_CGDESTROY, (long)id);
+}
+
+static inline long posix_cgattach(long pid, uint32_t id)
+{
+    return rdnx_syscall2(POSIX_SYS_CGATTACH, pid, (long)id);
+}
+
+static inline long posix_cgset(uint32_t id, uint32_t key, uint64_t value)
+{
+    return rdnx_syscall3(POSIX_SYS_CGSET, (long)id, (long)key, (long)value);
+}
+
+static inline long posix_cgstat(uint32_t id, rodnix_cgstat_t* out)
+{
+    return rdnx_syscall2(POSIX_SYS_CGSTAT, (long)id, (long)(uintptr_t)out);
+}
+
+static inline long posix_profctl(uint32_t op, uint32_t flags, uint64_t period, rodnix_profstat_t* st)
+{
+    return rdnx_syscall4(POSIX_SYS_PROFCTL, (long)op, (long)flags, (long)period, (long)(uintptr_t)st);
+}
+
+static inline long posix_profread(rodnix_prof_sample_t* buf, uint32_t max, uint64_t* dropped)
+{
+    return rdnx_syscall3(POSIX_SYS_PROFREAD, (long)(uintptr_t)buf, (long)max, (long)(uintptr_t)dropped);
+}
+
+static inline long posix_lockstat(uint32_t op, rodnix_lockstat_t* buf, uint32_t max, uint32_t first)
+{
+    return rdnx_syscall4(POSIX_SYS_LOCKSTAT, (long)op, (long)(uintptr_t)buf, (long)max, (long)first);
+}
+
+static inline long posix_lattrace(uint32_t op, rodnix_lattrace_t* buf)
+{
+    return rdnx_syscall2(POSIX_SYS_LATTRACE, (long)op, (long)(uintptr_t)buf);
+}
+
+static inline long posix_sched_setscheduler(long pid, int policy, const void* param)
+{
+    return rdnx_syscall3(POSIX_SYS_SCHED_SETSCHEDULER, pid, (long)policy, (long)(uintptr_t)param);
+}
+
+static inline long posix_sched_getscheduler(long pid)
+{
+    return rdnx_syscall1(POSIX_SYS_SCHED_GETSCHEDULER, pid);
+}
+
+static inline long posix_sched_setattr(long pid, const void* attr, uint32_t flags)
+{
+    return rdnx_syscall3(POSIX_SYS_SCHED_SETATTR, pid, (long)(uintptr_t)attr, (long)flags);
+}
+
+static inline long posix_sched_getattr(long pid, void* attr, uint32_t size, uint32_t flags)
+{
+    return rdnx_syscall4(POSIX_SYS_SCHED_GETATTR, pid, (long)(uintptr_t)attr, (long)size, (long)flags);
+}
+
+static inline long posix_gcov(uint32_t op, long a2, long a3, long a4)
+{
+    return rdnx_syscall4(POSIX_SYS_GCOV, (long)op, a2, a3, a4);
+}
+
+static inline long posix_kasan(uint32_t op, void* buf, uint32_t max)
+{
+    return rdnx_syscall3(POSIX_SYS_KASAN, (long)op, (long)(uintptr_t)buf, (long)max);
+}
+
+static inline long posix_getrandom(void* buf, uint64_t len, uint32_t flags)
+{
+    return rdnx_syscall3(POSIX_SYS_GETRANDOM, (long)(uintptr_t)buf, (long)len, (long)flags);
+}
+
 #endif /* _RODNIX_USERLAND_POSIX_SYSCALL_H */
@@ -72,8 +72,36 @@ enum {
     POSIX_SYS_SENDTO = 66,
     POSIX_SYS_RECVFROM = 67,
     POSIX_SYS_PING = 68,
+    POSIX_SYS_FSYNC = 69,
+    POSIX_SYS_FDATASYNC = 70,
+    POSIX_SYS_SYNC = 71,
+    POSIX_SYS_FALLOCATE = 72,
+    POSIX_SYS_GETRUSAGE = 73,
+    POSIX_SYS_GETRLIMIT = 74,
+    POSIX_SYS_SETRLIMIT = 75,
+    POSIX_SYS_PROCSTAT = 76,
+    POSIX_SYS_CGCREATE = 77,
+    POSIX_SYS_CGDESTROY = 78,
+    POSIX_SYS_CGATTACH = 79,
+    POSIX_SYS_CGSET = 80,
+    POSIX_SYS_CGSTAT = 81,
+    POSIX_SYS_PROFCTL = 82,
+    POSIX_SYS_PROFREAD = 83,
+    POSIX_SYS_LOCKSTAT = 84,
+    POSIX_SYS_LATTRACE = 85,
+    POSIX_SYS_SCHED_SETSCHEDULER = 86,
+    POSIX_SYS_SCHED_GETSCHEDULER = 87,
+    POSIX_SYS_SCHED_SETATTR = 88,
+    POSIX_SYS_SCHED_GETATTR = 89,
+    POSIX_SYS_GCOV = 90,
+    POSIX_SYS_KASAN = 91,
+    POSIX_SYS_GETRANDOM = 92,
+    POSIX_SYS_SETSOCKOPT = 93,
+    POSIX_SYS_NETQSTAT = 94,
+    POSIX_SYS_NETIFSET = 95,
+    POSIX_SYS_GETTID = 96,
 };
 
-#define POSIX_SYS_LAST 68
+#define POSIX_SYS_LAST 96
 
 #endif /* _RODNIX_USERLAND_POSIX_SYSNUMS_H */
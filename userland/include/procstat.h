@@ -0,0 +1,30 @@
+#ifndef _RODNIX_USERLAND_PROCSTAT_H
+#define _RODNIX_USERLAND_PROCSTAT_H
+
+#include <stdint.h>
+
+/* One task as reported by procstat(2); times in nanoseconds. */
+typedef struct rodnix_procstat {
+    uint64_t pid;
+    uint64_t ppid;
+    uint32_t uid;
+    uint32_t state;
+    uint32_t threads;
+    uint32_t cgroup;    /* task group id, 0 = root */
+    char comm[16];
+    uint64_t utime_ns;
+    uint64_t stime_ns;
+    uint64_t minflt;
+    uint64_t majflt;
+    uint64_t nvcsw;
+    uint64_t nivcsw;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t rss_pages;
+    uint64_t maxrss_pages;
+    uint64_t vsize_bytes;
+    uint64_t cutime_ns;
+    uint64_t cstime_ns;
+} rodnix_procstat_t;
+
+#endif /* _RODNIX_USERLAND_PROCSTAT_H */
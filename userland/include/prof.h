@@ -0,0 +1,41 @@
+#ifndef _RODNIX_USERLAND_PROF_H
+#define _RODNIX_USERLAND_PROF_H
+
+#include <stdint.h>
+
+/* profctl(2) ops and flags. */
+#define PROF_OP_START  1
+#define PROF_OP_STOP   2
+#define PROF_OP_STATUS 3
+#define PROF_F_TIMER   0x1u   /* sample on the timer tick even if a PMU is present */
+
+#define PROF_MODE_OFF   0
+#define PROF_MODE_PMU   1
+#define PROF_MODE_TIMER 2
+
+#define PROF_MAX_DEPTH 24
+
+/* Profiler state as reported by profctl(PROF_OP_STATUS). */
+typedef struct rodnix_profstat {
+    uint32_t mode;
+    uint32_t running;
+    uint32_t cpus;
+    uint32_t pmu_version;    /* architectural perfmon version, 0 = no usable PMU */
+    uint32_t pmu_counters;
+    uint32_t pmu_width;
+    uint64_t period;         /* cycles (PMU) or ticks (timer) per sample */
+    uint64_t samples;
+    uint64_t dropped;
+    uint64_t pending;
+} rodnix_profstat_t;
+
+/* One sample from profread(2): ips[0..nr_kernel) kernel, then nr_user user frames; leaf first. */
+typedef struct rodnix_prof_sample {
+    uint32_t pid;
+    uint16_t nr_kernel;
+    uint16_t nr_user;
+    char comm[16];
+    uint64_t ips[PROF_MAX_DEPTH];
+} rodnix_prof_sample_t;
+
+#endif /* _RODNIX_USERLAND_PROF_H */
@@ -0,0 +1,69 @@
+#ifndef _RODNIX_USERLAND_SCHED_H
+#define _RODNIX_USERLAND_SCHED_H
+
+#include <stdint.h>
+#include <errno.h>
+#include "posix_syscall.h"
+
+/* Policies; FIFO/RR and DEADLINE (and any change of another process) need root. */
+#define SCHED_OTHER    0
+#define SCHED_FIFO     1
+#define SCHED_RR       2
+#define SCHED_DEADLINE 6
+
+struct sched_param {
+    int sched_priority;         /* 1..99 for FIFO/RR, 0 for OTHER */
+};
+
+/* Linux struct sched_attr (SCHED_ATTR_SIZE_VER0); DEADLINE times in ns. */
+struct sched_attr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;       /* must be 0 */
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;      /* 0: same as sched_deadline */
+};
+
+static inline int sched_ret(long r)
+{
+    if (r < 0) {
+        errno = (int)(-r);
+        return -1;
+    }
+    return (int)r;
+}
+
+static inline int sched_get_priority_min(int policy)
+{
+    return (policy == SCHED_FIFO || policy == SCHED_RR) ? 1 : 0;
+}
+
+static inline int sched_get_priority_max(int policy)
+{
+    return (policy == SCHED_FIFO || policy == SCHED_RR) ? 99 : 0;
+}
+
+static inline int sched_setscheduler(int pid, int policy, const struct sched_param* param)
+{
+    return sched_ret(posix_sched_setscheduler(pid, policy, param));
+}
+
+static inline int sched_getscheduler(int pid)
+{
+    return sched_ret(posix_sched_getscheduler(pid));
+}
+
+static inline int sched_setattr(int pid, const struct sched_attr* attr, unsigned int flags)
+{
+    return sched_ret(posix_sched_setattr(pid, attr, flags));
+}
+
+static inline int sched_getattr(int pid, struct sched_attr* attr, unsigned int size, unsigned int flags)
+{
+    return sched_ret(posix_sched_getattr(pid, attr, size, flags));
+}
+
+#endif /* _RODNIX_USERLAND_SCHED_H */
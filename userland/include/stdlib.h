@@ -2,6 +2,7 @@
 #define _RODNIX_USERLAND_STDLIB_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 int atoi(const char* nptr);
 long strtol(const char* nptr, char** endptr, int base);
@@ -12,4 +13,9 @@ void free(void* ptr);
 void* realloc(void* ptr, size_t size);
 void* calloc(size_t nmemb, size_t size);
 
+/* Kernel CRNG through getrandom(GRND_INSECURE): never blocks; aborts if getrandom fails. */
+uint32_t arc4random(void);
+void arc4random_buf(void* buf, size_t nbytes);
+uint32_t arc4random_uniform(uint32_t upper_bound);
+
 #endif /* _RODNIX_USERLAND_STDLIB_H */
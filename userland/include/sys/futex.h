@@ -7,6 +7,14 @@
 
 #define FUTEX_WAIT 0
 #define FUTEX_WAKE 1
+/* Priority-inheritance mutex: the word holds the owner tid, gettid() (0 = free). */
+#define FUTEX_LOCK_PI    6
+#define FUTEX_UNLOCK_PI  7
+#define FUTEX_TRYLOCK_PI 8
+
+#define FUTEX_WAITERS    0x80000000u
+#define FUTEX_OWNER_DIED 0x40000000u
+#define FUTEX_TID_MASK   0x3fffffffu
 
 static inline int futex(int* uaddr,
                         int op,
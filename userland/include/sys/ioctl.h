@@ -8,4 +8,12 @@
 #define RDNX_TTY_IOCTL_GETATTR 0x7402u
 #define RDNX_TTY_IOCTL_SETATTR 0x7403u
 
+/*
+ * Block device nodes (/dev/disk0, /dev/nvme0n1, ...).
+ * RRPART re-reads the partition table (root only) and returns the number of
+ * partitions found; it fails with RDNX_E_BUSY while a partition is in use.
+ */
+#define RDNX_BLK_IOCTL_RRPART    0x125Fu
+#define RDNX_BLK_IOCTL_GETSIZE64 0x1272u   /* arg: uint64_t*, size in bytes */
+
 #endif /* _RODNIX_USERLAND_SYS_IOCTL_H */
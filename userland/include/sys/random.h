@@ -0,0 +1,24 @@
+#ifndef _RODNIX_USERLAND_SYS_RANDOM_H
+#define _RODNIX_USERLAND_SYS_RANDOM_H
+
+#include <sys/types.h>
+#include <errno.h>
+#include "posix_syscall.h"
+
+/* Same values as the kernel RANDOM_F_* flags. */
+#define GRND_NONBLOCK  0x1u   /* fail instead of waiting for the pool seed */
+#define GRND_RANDOM    0x2u   /* accepted; there is a single pool */
+#define GRND_INSECURE  0x4u   /* never wait; output may predate the seed */
+
+/* At most 1 MiB per call; shorter counts are not errors. */
+static inline ssize_t getrandom(void* buf, size_t buflen, unsigned int flags)
+{
+    long r = posix_getrandom(buf, (uint64_t)buflen, (uint32_t)flags);
+    if (r < 0) {
+        errno = (int)(-r);
+        return -1;
+    }
+    return (ssize_t)r;
+}
+
+#endif /* _RODNIX_USERLAND_SYS_RANDOM_H */
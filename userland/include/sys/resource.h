@@ -0,0 +1,86 @@
+#ifndef _RODNIX_USERLAND_SYS_RESOURCE_H
+#define _RODNIX_USERLAND_SYS_RESOURCE_H
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <errno.h>
+#include "posix_syscall.h"
+
+typedef uint64_t rlim_t;
+
+/* Resource numbers follow FreeBSD; the Linux ABI remaps its own. */
+#define RLIMIT_CPU     0   /* seconds: soft -> SIGXCPU, hard -> SIGKILL */
+#define RLIMIT_FSIZE   1
+#define RLIMIT_DATA    2   /* brk + anonymous mmap, bytes */
+#define RLIMIT_STACK   3
+#define RLIMIT_CORE    4
+#define RLIMIT_RSS     5
+#define RLIMIT_MEMLOCK 6
+#define RLIMIT_NPROC   7   /* processes per real UID */
+#define RLIMIT_NOFILE  8   /* descriptor numbers, at most 32 */
+#define RLIMIT_SBSIZE  9
+#define RLIMIT_AS      10  /* total mapped address space, bytes */
+#define RLIMIT_VMEM    RLIMIT_AS
+#define RLIM_NLIMITS   11
+
+#define RLIM_INFINITY  ((rlim_t)0x7fffffffffffffffULL)
+
+struct rlimit {
+    rlim_t rlim_cur;
+    rlim_t rlim_max;
+};
+
+#define RUSAGE_SELF      0
+#define RUSAGE_CHILDREN  (-1)
+#define RUSAGE_THREAD    1
+
+struct rusage {
+    struct timeval ru_utime;
+    struct timeval ru_stime;
+    long ru_maxrss;    /* KiB */
+    long ru_ixrss;
+    long ru_idrss;
+    long ru_isrss;
+    long ru_minflt;
+    long ru_majflt;
+    long ru_nswap;
+    long ru_inblock;   /* read() bytes / 512 */
+    long ru_oublock;   /* write() bytes / 512 */
+    long ru_msgsnd;
+    long ru_msgrcv;
+    long ru_nsignals;
+    long ru_nvcsw;
+    long ru_nivcsw;
+};
+
+static inline int getrusage(int who, struct rusage* ru)
+{
+    long r = posix_getrusage(who, ru);
+    if (r < 0) {
+        errno = (int)(-r);
+        return -1;
+    }
+    return 0;
+}
+
+static inline int getrlimit(int resource, struct rlimit* rlp)
+{
+    long r = posix_getrlimit(resource, rlp);
+    if (r < 0) {
+        errno = (int)(-r);
+        return -1;
+    }
+    return 0;
+}
+
+static inline int setrlimit(int resource, const struct rlimit* rlp)
+{
+    long r = posix_setrlimit(resource, rlp);
+    if (r < 0) {
+        errno = (int)(-r);
+        return -1;
+    }
+    return 0;
+}
+
+#endif /* _RODNIX_USERLAND_SYS_RESOURCE_H */
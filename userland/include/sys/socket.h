@@ -19,4 +19,7 @@ struct sockaddr {
 #define SOCK_STREAM 1
 #define SOCK_DGRAM  2
 
+#define SOL_SOCKET   0xFFFF
+#define SO_BUSY_POLL 46        /* int, microseconds of busy polling per receive */
+
 #endif /* _RODNIX_USERLAND_SYS_SOCKET_H */
@@ -51,6 +51,20 @@ typedef struct rodnix_sysinfo {
 
     uint64_t syscall_int80_count;
     uint64_t syscall_fast_count;
+
+    /* Page reclaim (file pages on the active/inactive LRU). */
+    uint64_t lru_active_pages;
+    uint64_t lru_inactive_pages;
+    uint64_t reclaim_scanned;
+    uint64_t reclaim_evicted;
+    uint64_t reclaim_writeback;
+    uint64_t reclaim_refaults;
+    uint64_t reclaim_kswapd_wakeups;
+    uint64_t reclaim_direct;
+    uint64_t reclaim_shrunk_bytes;
+    uint64_t wmark_min_pages;
+    uint64_t wmark_low_pages;
+    uint64_t wmark_high_pages;
 } rodnix_sysinfo_t;
 
 #endif /* _RODNIX_USERLAND_SYSINFO_H */
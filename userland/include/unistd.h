@@ -22,6 +22,8 @@ extern "C" {
 #define SEEK_CUR 1
 #define SEEK_END 2
 
+#define FALLOC_FL_KEEP_SIZE 0x01
+
 static inline int rdnx_errno_from_status(long r)
 {
     switch ((int)r) {
@@ -42,7 +44,8 @@ static inline int rdnx_open_flags_from_posix(int flags)
         VFS_OPEN_READ   = 1 << 0,
         VFS_OPEN_WRITE  = 1 << 1,
         VFS_OPEN_CREATE = 1 << 2,
-        VFS_OPEN_TRUNC  = 1 << 3
+        VFS_OPEN_TRUNC  = 1 << 3,
+        VFS_OPEN_DIRECT = 1 << 4
     };
 
     int out = 0;
@@ -60,6 +63,9 @@ static inline int rdnx_open_flags_from_posix(int flags)
     if (flags & O_TRUNC) {
         out |= VFS_OPEN_TRUNC;
     }
+    if (flags & O_DIRECT) {
+        out |= VFS_OPEN_DIRECT;
+    }
     return out;
 }
 
@@ -73,6 +79,16 @@ static inline pid_t getpid(void)
     return (pid_t)r;
 }
 
+static inline pid_t gettid(void)
+{
+    long r = posix_gettid();
+    if (r < 0) {
+        errno = (int)(-r);
+        return (pid_t)-1;
+    }
+    return (pid_t)r;
+}
+
 static inline ssize_t read(int fd, void* buf, size_t len)
 {
     long r = posix_read(fd, buf, (uint64_t)len);
@@ -183,6 +199,42 @@ static inline int ftruncate(int fd, off_t length)
     return 0;
 }
 
+static inline int fsync(int fd)
+{
+    long r = posix_fsync(fd);
+    if (r < 0) {
+        errno = (int)(-r);
+        return -1;
+    }
+    return 0;
+}
+
+static inline int fdatasync(int fd)
+{
+    long r = posix_fdatasync(fd);
+    if (r < 0) {
+        errno = (int)(-r);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void sync(void)
+{
+    (void)posix_sync();
+}
+
+/* Linux-compatible fallocate(2); only FALLOC_FL_KEEP_SIZE is supported. */
+static inline int fallocate(int fd, int mode, off_t off, off_t len)
+{
+    long r = posix_fallocate(fd, mode, (uint64_t)off, (uint64_t)len);
+    if (r < 0) {
+        errno = (int)(-r);
+        return -1;
+    }
+    return 0;
+}
+
 static inline int fcntl(int fd, int cmd, int arg)
 {
     long r = posix_fcntl(fd, cmd, (long)arg);
@@ -286,6 +338,9 @@ static inline int isatty(int fd)
 
 static inline int execve(const char* path, char* const argv[], char* const envp[])
 {
+#ifdef CONFIG_GCOV
+    __gcov_dump();
+#endif
     long r = posix_execve(path, (const char* const*)argv, (const char* const*)envp);
     if (r < 0) {
         errno = (int)(-r);
@@ -343,11 +398,19 @@ static inline pid_t fork(void)
         errno = (int)(-r);
         return (pid_t)-1;
     }
+#ifdef CONFIG_GCOV
+    if (r == 0) {
+        __gcov_reset();
+    }
+#endif
     return (pid_t)r;
 }
 
 static inline void _exit(int status)
 {
+#ifdef CONFIG_GCOV
+    __gcov_dump();
+#endif
     (void)posix_exit(status);
     for (;;) {
         __asm__ volatile ("pause");
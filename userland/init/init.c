@@ -9,11 +9,20 @@
 #include "posix_syscall.h"
 #include "unistd.h"
 #include "sys/wait.h"
+#include "sys/mman.h"
+#include "sys/resource.h"
+#include "sysinfo.h"
 #include "dirent.h"
 #include "time.h"
+#include "sched.h"
+#include "sys/futex.h"
+#include "sys/ioctl.h"
+#include "sys/socket.h"
+#include "netif.h"
 
 #define VFS_OPEN_READ 1
 #define VFS_OPEN_WRITE 2
+#define VFS_OPEN_DIRECT 16
 #define FD_STDOUT 1
 #define SYS_TEST_SLEEP 120
 
@@ -904,6 +913,821 @@ static void run_contract_mode_if_enabled(void)
         }
     }
 
+    {
+        long fd = posix_open("/mnt/README.txt", VFS_OPEN_READ | VFS_OPEN_WRITE);
+        if (fd < 0) {
+            ct_log("CT-029", "FAIL", "open /mnt/README.txt for fsync failed");
+            ok = 0;
+        } else {
+            long r1 = posix_fsync((int)fd);
+            long r2 = posix_fdatasync((int)fd);
+            (void)posix_close((int)fd);
+            long r3 = posix_sync();
+            long rbad = posix_fsync(-1);
+            if (r1 == 0 && r2 == 0 && r3 == 0 && rbad < 0) {
+                ct_log("CT-029", "PASS", "fsync/fdatasync/sync flush ext2 volume");
+            } else {
+                ct_log("CT-029", "FAIL", "fsync/fdatasync/sync contract mismatch");
+                ok = 0;
+            }
+        }
+    }
+
+    {
+        /* Sparse grow, write past a hole, preallocate, then shrink back. */
+        const long hole_size = 3L * 1024L * 1024L;
+        const long pat_off = 2L * 1024L * 1024L + 5L;
+        static const char pat[8] = {'s', 'p', 'a', 'r', 's', 'e', '!', '\n'};
+        int sp_ok = 1;
+        int sp_unavail = 0;
+        long fd = posix_open("/mnt/README.txt", VFS_OPEN_READ | VFS_OPEN_WRITE);
+        if (fd < 0) {
+            sp_ok = 0;
+        } else {
+            long orig = posix_lseek((int)fd, 0, SEEK_END);
+            char chk[8];
+            long tr = (orig < 0) ? -1 : posix_ftruncate((int)fd, (uint64_t)hole_size);
+            if (tr == -7) {
+                sp_unavail = 1;
+            } else if (tr != 0) {
+                sp_ok = 0;
+            }
+            if (sp_ok && !sp_unavail) {
+                (void)posix_lseek((int)fd, pat_off, SEEK_SET);
+                long wn = posix_write((int)fd, pat, sizeof(pat));
+                if (wn == -7) {
+                    sp_unavail = 1;
+                } else if (wn != (long)sizeof(pat)) {
+                    sp_ok = 0;
+                }
+            }
+            if (sp_ok && !sp_unavail) {
+                (void)posix_lseek((int)fd, 1024L * 1024L, SEEK_SET);
+                if (posix_read((int)fd, chk, sizeof(chk)) != (long)sizeof(chk)) {
+                    sp_ok = 0;
+                }
+                for (uint64_t i = 0; sp_ok && i < sizeof(chk); i++) {
+                    if (chk[i] != 0) {
+                        sp_ok = 0;
+                    }
+                }
+                (void)posix_lseek((int)fd, pat_off, SEEK_SET);
+                if (sp_ok && posix_read((int)fd, chk, sizeof(chk)) != (long)sizeof(chk)) {
+                    sp_ok = 0;
+                }
+                for (uint64_t i = 0; sp_ok && i < sizeof(chk); i++) {
+                    if (chk[i] != pat[i]) {
+                        sp_ok = 0;
+                    }
+                }
+            }
+            if (sp_ok && !sp_unavail) {
+                /* KEEP_SIZE stays inside i_size: block-mapped ext2 files cannot own blocks past EOF. */
+                if (posix_fallocate((int)fd, FALLOC_FL_KEEP_SIZE, 512u * 1024u, 8192u) != 0 ||
+                    posix_lseek((int)fd, 0, SEEK_END) != hole_size ||
+                    posix_fallocate((int)fd, 0, (uint64_t)hole_size, 4096u) != 0 ||
+                    posix_lseek((int)fd, 0, SEEK_END) != hole_size + 4096L ||
+                    posix_fallocate((int)fd, 0x10, 0, 4096u) >= 0) {
+                    sp_ok = 0;
+                }
+            }
+            if (tr == 0 && posix_ftruncate((int)fd, (uint64_t)orig) != 0) {
+                sp_ok = 0;
+            }
+            (void)posix_fsync((int)fd);
+            (void)posix_close((int)fd);
+        }
+        if (sp_ok && !sp_unavail) {
+            ct_log("CT-031", "PASS", "ext2 sparse file, hole reads and fallocate");
+        } else if (sp_ok && sp_unavail) {
+            ct_log("CT-031", "PASS", "ext2 sparse write deferred: block write backend unavailable");
+        } else {
+            ct_log("CT-031", "FAIL", "ext2 sparse file / fallocate contract mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Block node: unaligned reads via the bounce, O_DIRECT alignment, SEEK_END = device size. */
+        static char whole[4096];
+        static char part[4096];
+        rodnix_blockdev_info_t dev;
+        uint32_t total = 0;
+        int bd_ok = 1;
+        long n = posix_blocklist(&dev, 1, &total);
+        if (n <= 0 || dev.sector_size == 0 || dev.sector_count * dev.sector_size < sizeof(whole)) {
+            bd_ok = 0;
+        } else {
+            char path[32] = "/dev/";
+            uint64_t p = 5;
+            for (uint64_t i = 0; dev.name[i] && p + 1 < sizeof(path); i++) {
+                path[p++] = dev.name[i];
+            }
+            path[p] = '\0';
+            long fd = posix_open(path, VFS_OPEN_READ);
+            if (fd < 0) {
+                bd_ok = 0;
+            } else {
+                if (posix_read((int)fd, whole, sizeof(whole)) != (long)sizeof(whole) ||
+                    posix_lseek((int)fd, 100, SEEK_SET) != 100 ||
+                    posix_read((int)fd, part, 1000) != 1000) {
+                    bd_ok = 0;
+                }
+                for (uint64_t i = 0; bd_ok && i < 1000; i++) {
+                    if (part[i] != whole[100 + i]) {
+                        bd_ok = 0;
+                    }
+                }
+                if (bd_ok && posix_lseek((int)fd, 0, SEEK_END) != (long)(dev.sector_count * dev.sector_size)) {
+                    bd_ok = 0;
+                }
+                (void)posix_close((int)fd);
+            }
+            fd = bd_ok ? posix_open(path, VFS_OPEN_READ | VFS_OPEN_DIRECT) : -1;
+            if (fd < 0) {
+                bd_ok = 0;
+            } else {
+                if (posix_lseek((int)fd, 100, SEEK_SET) != 100 ||
+                    posix_read((int)fd, part, 512) >= 0 ||
+                    posix_lseek((int)fd, 0, SEEK_SET) != 0 ||
+                    posix_read((int)fd, part, sizeof(part)) != (long)sizeof(part)) {
+                    bd_ok = 0;
+                }
+                for (uint64_t i = 0; bd_ok && i < sizeof(part); i++) {
+                    if (part[i] != whole[i]) {
+                        bd_ok = 0;
+                    }
+                }
+                (void)posix_close((int)fd);
+            }
+        }
+        if (bd_ok) {
+            ct_log("CT-032", "PASS", "block node multi-sector, unaligned and O_DIRECT reads");
+        } else {
+            ct_log("CT-032", "FAIL", "block node read path mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Accounting (getrusage/procstat) and enforced RLIMIT_NOFILE / RLIMIT_AS. */
+        static rodnix_procstat_t procs[64];
+        static char buf[256];
+        struct rusage self_ru;
+        struct rusage child_ru;
+        struct rlimit saved_nofile;
+        struct rlimit saved_as;
+        struct rlimit lim;
+        int ru_ok = 1;
+        long pid = posix_getpid();
+        const rodnix_procstat_t* me = 0;
+        uint64_t rd_before = 0;
+
+        if (getrusage(RUSAGE_SELF, &self_ru) != 0 || getrusage(RUSAGE_CHILDREN, &child_ru) != 0) {
+            ru_ok = 0;
+        } else if (self_ru.ru_utime.tv_sec + self_ru.ru_utime.tv_usec +
+                       self_ru.ru_stime.tv_sec + self_ru.ru_stime.tv_usec == 0 ||
+                   self_ru.ru_maxrss == 0 ||
+                   child_ru.ru_nvcsw + child_ru.ru_nivcsw == 0) {
+            /* Children reaped by CT-001..CT-030 at least switched out on exit. */
+            ru_ok = 0;
+        }
+
+        long n = ru_ok ? posix_procstat(procs, 64, 0) : -1;
+        for (long i = 0; i < n; i++) {
+            if ((long)procs[i].pid == pid) {
+                me = &procs[i];
+            }
+        }
+        if (!me || me->comm[0] != 'i' || me->rss_pages == 0 || me->vsize_bytes == 0) {
+            ru_ok = 0;
+        } else {
+            rd_before = me->read_bytes;
+        }
+        long fd = ru_ok ? posix_open("/etc/motd", VFS_OPEN_READ) : -1;
+        if (fd < 0) {
+            ru_ok = 0;
+        } else {
+            (void)posix_read((int)fd, buf, sizeof(buf));
+            (void)posix_close((int)fd);
+            n = posix_procstat(procs, 64, 0);
+            for (long i = 0; i < n; i++) {
+                if ((long)procs[i].pid == pid && procs[i].read_bytes <= rd_before) {
+                    ru_ok = 0;
+                }
+            }
+        }
+
+        /* NOFILE: lowering the soft limit to the next free slot makes open() fail. */
+        if (ru_ok && getrlimit(RLIMIT_NOFILE, &saved_nofile) == 0 && fd >= 0) {
+            lim.rlim_cur = (rlim_t)fd;
+            lim.rlim_max = saved_nofile.rlim_max;
+            if (setrlimit(RLIMIT_NOFILE, &lim) != 0) {
+                ru_ok = 0;
+            } else {
+                long denied = posix_open("/etc/motd", VFS_OPEN_READ);
+                if (denied >= 0) {
+                    (void)posix_close((int)denied);
+                    ru_ok = 0;
+                }
+                (void)setrlimit(RLIMIT_NOFILE, &saved_nofile);
+            }
+            lim.rlim_cur = saved_nofile.rlim_max;
+            lim.rlim_max = saved_nofile.rlim_max + 1u;
+            if (saved_nofile.rlim_max != RLIM_INFINITY && setrlimit(RLIMIT_NOFILE, &lim) == 0) {
+                ru_ok = 0; /* hard limit beyond the descriptor table */
+            }
+        } else {
+            ru_ok = 0;
+        }
+
+        /* AS: with 64 KiB of headroom a 1 MiB anonymous mmap fails, a 16 KiB one fits. */
+        if (ru_ok && me && getrlimit(RLIMIT_AS, &saved_as) == 0) {
+            lim.rlim_cur = (rlim_t)(me->vsize_bytes + 64u * 1024u);
+            lim.rlim_max = saved_as.rlim_max;
+            if (setrlimit(RLIMIT_AS, &lim) != 0) {
+                ru_ok = 0;
+            } else {
+                long big = posix_mmap(0, 1024u * 1024u, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+                long small = posix_mmap(0, 16u * 1024u, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+                if (big >= 0) {
+                    (void)posix_munmap((void*)big, 1024u * 1024u);
+                    ru_ok = 0;
+                }
+                if (small < 0) {
+                    ru_ok = 0;
+                } else {
+                    (void)posix_munmap((void*)small, 16u * 1024u);
+                }
+                (void)setrlimit(RLIMIT_AS, &saved_as);
+            }
+        } else {
+            ru_ok = 0;
+        }
+
+        if (ru_ok) {
+            ct_log("CT-033", "PASS", "getrusage/procstat accounting, RLIMIT_NOFILE and RLIMIT_AS enforced");
+        } else {
+            ct_log("CT-033", "FAIL", "resource accounting or limit enforcement mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Task groups: cpu.max throttles a busy child, mem.max OOM-kills a growing one. */
+        static rodnix_procstat_t procs[64];
+        rodnix_cgstat_t st;
+        uint32_t cpu_id = 0;
+        uint32_t mem_id = 0;
+        uint64_t rss_bytes = 0;
+        int status = -1;
+        int cg_ok = 1;
+        long self = posix_getpid();
+
+        long n = posix_procstat(procs, 64, 0);
+        for (long i = 0; i < n; i++) {
+            if ((long)procs[i].pid == self) {
+                rss_bytes = procs[i].rss_pages * 4096u;
+                if (procs[i].cgroup != CG_ROOT_ID) {
+                    cg_ok = 0;
+                }
+            }
+        }
+        if (rss_bytes == 0 ||
+            posix_cgcreate(CG_ROOT_ID, "ct-cpu", &cpu_id) != 0 ||
+            posix_cgcreate(CG_ROOT_ID, "ct-mem", &mem_id) != 0 ||
+            posix_cgset(cpu_id, CG_KEY_CPU_MAX, 10000u) != 0 ||
+            posix_cgset(cpu_id, CG_KEY_CPU_PERIOD, 100000u) != 0 ||
+            posix_cgset(mem_id, CG_KEY_MEM_MAX, rss_bytes + 256u * 1024u) != 0 ||
+            posix_cgset(cpu_id, CG_KEY_CPU_MAX, 0) == 0) {
+            cg_ok = 0;
+        }
+
+        /* 10 ms per 100 ms: ~600 ms of spinning gets roughly 60 ms of CPU. */
+        pid_t pid = cg_ok ? fork() : -1;
+        if (pid == 0) {
+            struct timespec t0;
+            struct timespec t1;
+            if (posix_cgattach(0, cpu_id) != 0 || clock_gettime(CLOCK_MONOTONIC, &t0) != 0) {
+                (void)posix_exit(1);
+            }
+            for (;;) {
+                if (clock_gettime(CLOCK_MONOTONIC, &t1) != 0 ||
+                    (int64_t)(t1.tv_sec - t0.tv_sec) * 1000LL +
+                            (int64_t)(t1.tv_nsec - t0.tv_nsec) / 1000000LL >= 600) {
+                    break;
+                }
+            }
+            (void)posix_exit(0);
+        }
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || status != 0 ||
+            posix_cgstat(cpu_id, &st) != 0 ||
+            st.cpu_usage_us == 0 || st.cpu_usage_us >= 300000u || st.cpu_nr_throttled == 0) {
+            cg_ok = 0;
+        }
+
+        /* Touching 1 MiB with 256 KiB of headroom: the fault path kills the child (128 + 9). */
+        pid = cg_ok ? fork() : -1;
+        if (pid == 0) {
+            if (posix_cgattach(0, mem_id) != 0) {
+                (void)posix_exit(1);
+            }
+            long p = posix_mmap(0, 1024u * 1024u, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+            if (p < 0) {
+                (void)posix_exit(2);
+            }
+            for (uint32_t off = 0; off < 1024u * 1024u; off += 4096u) {
+                ((volatile uint8_t*)p)[off] = 1;
+            }
+            (void)posix_exit(0);
+        }
+        status = -1;
+        if (pid < 0 || waitpid(pid, &status, 0) != pid || status != 137 ||
+            posix_cgstat(mem_id, &st) != 0 ||
+            st.mem_oom_kills == 0 || st.mem_failcnt == 0) {
+            cg_ok = 0;
+        }
+
+        /* Reaped children no longer pin the groups; root cannot be removed. */
+        for (int tries = 0; tries < 10; tries++) {
+            long r1 = cpu_id ? posix_cgdestroy(cpu_id) : 0;
+            long r2 = mem_id ? posix_cgdestroy(mem_id) : 0;
+            if (r1 == 0) {
+                cpu_id = 0;
+            }
+            if (r2 == 0) {
+                mem_id = 0;
+            }
+            if (!cpu_id && !mem_id) {
+                break;
+            }
+            (void)rdnx_syscall1(SYS_TEST_SLEEP, 1);
+        }
+        if (cpu_id || mem_id || posix_cgdestroy(CG_ROOT_ID) == 0) {
+            cg_ok = 0;
+        }
+
+        if (cg_ok) {
+            ct_log("CT-034", "PASS", "cgroup cpu.max throttling and mem.max OOM kill");
+        } else {
+            ct_log("CT-034", "FAIL", "cgroup limit enforcement mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Page reclaim: watermarks are ordered, mapped file pages go on the LRU and leave it on munmap. */
+        rodnix_sysinfo_t before;
+        rodnix_sysinfo_t mapped;
+        rodnix_sysinfo_t after;
+        int rc_ok = 1;
+        long fd = posix_open("/bin/init", VFS_OPEN_READ);
+        if (fd < 0 || posix_sysinfo(&before) != 0 ||
+            before.wmark_min_pages == 0 ||
+            before.wmark_min_pages >= before.wmark_low_pages ||
+            before.wmark_low_pages >= before.wmark_high_pages) {
+            rc_ok = 0;
+        }
+        long p = rc_ok ? posix_mmap(0, 4u * 4096u, PROT_READ, MAP_PRIVATE, (int)fd, 0) : -1;
+        if (p < 0) {
+            rc_ok = 0;
+        } else {
+            uint32_t sum = 0;
+            for (uint32_t off = 0; off < 4u * 4096u; off += 4096u) {
+                sum += ((volatile uint8_t*)p)[off];
+            }
+            (void)sum;
+            if (posix_sysinfo(&mapped) != 0 ||
+                mapped.lru_active_pages + mapped.lru_inactive_pages <
+                    before.lru_active_pages + before.lru_inactive_pages + 4u) {
+                rc_ok = 0;
+            }
+            (void)posix_munmap((void*)p, 4u * 4096u);
+            if (posix_sysinfo(&after) != 0 ||
+                after.lru_active_pages + after.lru_inactive_pages + 4u >
+                    mapped.lru_active_pages + mapped.lru_inactive_pages) {
+                rc_ok = 0;
+            }
+        }
+        if (fd >= 0) {
+            (void)posix_close((int)fd);
+        }
+
+        if (rc_ok) {
+            ct_log("CT-035", "PASS", "reclaim watermarks ordered, file pages tracked on LRU");
+        } else {
+            ct_log("CT-035", "FAIL", "reclaim watermark or LRU accounting mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Sampling profiler (timer mode works everywhere): a user busy loop must show up with a user stack. */
+        rodnix_profstat_t st;
+        long mypid = posix_getpid();
+        int rc_ok = posix_profctl(PROF_OP_START, PROF_F_TIMER, 2, &st) == 0 &&
+                    st.running && st.mode == PROF_MODE_TIMER;
+        if (rc_ok) {
+            struct timespec t0;
+            struct timespec t1;
+            volatile uint64_t spin = 0;
+            (void)clock_gettime(CLOCK_MONOTONIC, &t0);
+            do {
+                for (uint32_t i = 0; i < 100000u; i++) {
+                    spin += i;
+                }
+                (void)clock_gettime(CLOCK_MONOTONIC, &t1);
+            } while ((uint64_t)(t1.tv_sec - t0.tv_sec) * 1000ULL +
+                         (uint64_t)(t1.tv_nsec - t0.tv_nsec) / 1000000ULL < 200ULL);
+        }
+        (void)posix_profctl(PROF_OP_STOP, 0, 0, NULL);
+        rodnix_prof_sample_t* samples = (rodnix_prof_sample_t*)malloc(64u * sizeof(rodnix_prof_sample_t));
+        int own_user = 0;
+        if (rc_ok && samples) {
+            long n;
+            uint64_t dropped = 0;
+            while ((n = posix_profread(samples, 64u, &dropped)) > 0) {
+                for (long i = 0; i < n; i++) {
+                    if ((long)samples[i].pid == mypid && samples[i].nr_user > 0) {
+                        own_user = 1;
+                    }
+                }
+            }
+        }
+        free(samples);
+
+        if (rc_ok && own_user) {
+            ct_log("CT-036", "PASS", "profiler timer sampling captured a user stack of init");
+        } else {
+            ct_log("CT-036", "FAIL", "profiler start or sample capture mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Lock statistics: production kernels report no features and refuse READ; debug kernels list classes. */
+        long features = posix_lockstat(LOCKSTAT_OP_INFO, NULL, 0, 0);
+        int rc_ok = features >= 0;
+        if (rc_ok) {
+            rodnix_lockstat_t* st = (rodnix_lockstat_t*)malloc(8u * sizeof(rodnix_lockstat_t));
+            long n = st ? posix_lockstat(LOCKSTAT_OP_READ, st, 8u, 0) : -1;
+            if (features == 0) {
+                rc_ok = n == -7;
+            } else {
+                rc_ok = n > 0 && st[0].name[0] != '\0';
+            }
+            free(st);
+        }
+
+        if (rc_ok) {
+            ct_log("CT-037", "PASS", "lockstat feature mask matches READ behaviour");
+        } else {
+            ct_log("CT-037", "FAIL", "lockstat INFO/READ mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Latency tracer: syscalls take spinlocks, so preempt-off sections must be timed with a stack. */
+        int rc_ok = posix_lattrace(LATTRACE_OP_RESET, NULL) == 0 &&
+                    posix_lattrace(LATTRACE_OP_START, NULL) == 0;
+        if (rc_ok) {
+            for (uint32_t i = 0; i < 64u; i++) {
+                struct timespec ts;
+                (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+                (void)posix_getpid();
+            }
+        }
+        rodnix_lattrace_t rep;
+        rep.enabled = 0;
+        rc_ok = rc_ok && posix_lattrace(LATTRACE_OP_READ, &rep) == 0;
+        (void)posix_lattrace(LATTRACE_OP_STOP, NULL);
+        rc_ok = rc_ok && rep.enabled == 1 && rep.sections[LAT_PREEMPTOFF] > 0 &&
+                rep.worst[LAT_PREEMPTOFF].max_ns > 0 && rep.worst[LAT_PREEMPTOFF].nr_ips > 0 &&
+                (rep.preempt_mode == PREEMPT_MODE_FULL || rep.preempt_mode == PREEMPT_MODE_VOLUNTARY) &&
+                posix_lattrace(5u, NULL) == -2;
+
+        if (rc_ok) {
+            ct_log("CT-038", "PASS", "lattrace timed preempt-off sections and kept a stack");
+        } else {
+            ct_log("CT-038", "FAIL", "lattrace start/read or section accounting mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* RT classes: DEADLINE round trip and admission, FIFO, then an uncontended PI futex. */
+        struct sched_attr a;
+        a.size = (uint32_t)sizeof(a);
+        a.sched_policy = SCHED_DEADLINE;
+        a.sched_flags = 0;
+        a.sched_nice = 0;
+        a.sched_priority = 0;
+        a.sched_runtime = 1000000ULL;
+        a.sched_deadline = 10000000ULL;
+        a.sched_period = 10000000ULL;
+        int rc_ok = posix_sched_setattr(0, &a, 0) == 0;
+        struct sched_attr g;
+        g.sched_policy = 0;
+        g.sched_runtime = 0;
+        g.sched_period = 0;
+        rc_ok = rc_ok && posix_sched_getattr(0, &g, (uint32_t)sizeof(g), 0) == 0 &&
+                g.sched_policy == SCHED_DEADLINE && g.sched_runtime == a.sched_runtime &&
+                g.sched_period == a.sched_period && posix_sched_getscheduler(0) == SCHED_DEADLINE;
+        /* 99% of one CPU is over the 95% DEADLINE bandwidth; runtime > deadline is invalid. */
+        a.sched_runtime = 9900000ULL;
+        rc_ok = rc_ok && posix_sched_setattr(0, &a, 0) == -5;
+        a.sched_runtime = 20000000ULL;
+        rc_ok = rc_ok && posix_sched_setattr(0, &a, 0) == -2;
+        struct sched_param sp;
+        sp.sched_priority = 50;
+        rc_ok = rc_ok && posix_sched_setscheduler(0, SCHED_FIFO, &sp) == 0 &&
+                posix_sched_getscheduler(0) == SCHED_FIFO;
+        sp.sched_priority = 100;
+        rc_ok = rc_ok && posix_sched_setscheduler(0, SCHED_FIFO, &sp) == -2;
+        sp.sched_priority = 0;
+        rc_ok = posix_sched_setscheduler(0, SCHED_OTHER, &sp) == 0 && rc_ok &&
+                posix_sched_getscheduler(0) == SCHED_OTHER;
+
+        int word = 0;
+        long self = posix_gettid();
+        rc_ok = rc_ok && posix_futex(&word, FUTEX_LOCK_PI, 0, 0, 0, 0) == 0 && word == (int)self &&
+                posix_futex(&word, FUTEX_TRYLOCK_PI, 0, 0, 0, 0) == -2 &&
+                posix_futex(&word, FUTEX_UNLOCK_PI, 0, 0, 0, 0) == 0 && word == 0 &&
+                posix_futex(&word, FUTEX_UNLOCK_PI, 0, 0, 0, 0) == -6;
+
+        if (rc_ok) {
+            ct_log("CT-039", "PASS", "sched_setattr/getattr, DEADLINE admission and PI futex ownership");
+        } else {
+            ct_log("CT-039", "FAIL", "RT policy round trip, admission or PI futex mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* gcov(2): argument checks; counters exist only in a PGO=gen build. */
+        static const char bad_path[] = "/tmp/x\n.gcda";
+        long objs = posix_gcov(GCOV_OP_INFO, 0, 0, 0);
+#ifdef CONFIG_GCOV
+        int rc_ok = objs > 0;
+#else
+        int rc_ok = objs == 0 && posix_gcov(GCOV_OP_DUMP, 0, 0, 0) == -7 &&
+                    posix_gcov(GCOV_OP_RESET, 0, 0, 0) == -7;
+#endif
+        rc_ok = rc_ok && posix_gcov(0, 0, 0, 0) == -2 &&
+                posix_gcov(GCOV_OP_EMIT, (long)(uintptr_t)"/tmp/x.gcda", (long)(uintptr_t)bad_path,
+                           (long)GCOV_EMIT_MAX + 1) == -2 &&
+                posix_gcov(GCOV_OP_EMIT, (long)(uintptr_t)bad_path, (long)(uintptr_t)bad_path, 4) == -2;
+        if (rc_ok) {
+            ct_log("CT-040", "PASS", "gcov info/dump availability and EMIT argument checks");
+        } else {
+            ct_log("CT-040", "FAIL", "gcov op result mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* CT-022 left demo.base loaded behind demo.echo; start from a clean registry. */
+        rodnix_kmod_info_t mods[32];
+        uint32_t total = 0;
+        int rc_ok = posix_kmodunload("demo.base") == 0;
+        long n = posix_kmodls(mods, 32, &total);
+        int base = (n < 0) ? -1 : kmod_find(mods, (uint32_t)n, "demo.base");
+        rc_ok = rc_ok && base >= 0 && mods[base].loaded == 0;
+        /* demo.echo imports from demo.base: loading it loads and pins demo.base. */
+        rc_ok = rc_ok && posix_kmodload("/lib/modules/demo.ko") == 0;
+        n = posix_kmodls(mods, 32, &total);
+        base = (n < 0) ? -1 : kmod_find(mods, (uint32_t)n, "demo.base");
+        int echo = (n < 0) ? -1 : kmod_find(mods, (uint32_t)n, "demo.echo");
+        rc_ok = rc_ok && base >= 0 && echo >= 0 && mods[base].loaded == 1 && mods[base].refs == 1 &&
+                mods[echo].ndeps == 1;
+        rc_ok = rc_ok && posix_kmodunload("demo.base") == -5;
+        /* Stale symbol version: refused, and nothing is registered. */
+        rc_ok = rc_ok && posix_kmodload("/lib/modules/demo.stale.ko") == -2;
+        n = posix_kmodls(mods, 32, &total);
+        rc_ok = rc_ok && n >= 0 && kmod_find(mods, (uint32_t)n, "demo.stale") < 0;
+        rc_ok = rc_ok && posix_kmodunload("demo.echo") == 0 && posix_kmodunload("demo.base") == 0;
+        if (rc_ok) {
+            ct_log("CT-041", "PASS", "kmod on-demand dependency, refcounted unload and version check");
+        } else {
+            ct_log("CT-041", "FAIL", "kmod dependency/version contract mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* kasan(2): unsupported in a normal build; a KASAN=1 kernel must catch its own bugs. */
+        rodnix_kasan_stats_t st = {0};
+        long info = posix_kasan(KASAN_OP_INFO, &st, 0);
+        int rc_ok;
+        if (info == -7) {
+            rc_ok = posix_kasan(KASAN_OP_SELFTEST, NULL, 0) == -7 &&
+                    posix_kasan(KASAN_OP_LEAK_SCAN, NULL, 0) == -7;
+        } else {
+            uint64_t before = st.reports;
+            rc_ok = info == 0 && st.enabled && st.shadow_bytes > 0 &&
+                    posix_kasan(KASAN_OP_SELFTEST, NULL, 0) == 0;
+            st.reports = 0;
+            rc_ok = rc_ok && posix_kasan(KASAN_OP_INFO, &st, 0) == 0 && st.reports >= before + 6u &&
+                    posix_kasan(KASAN_OP_LEAK_SCAN, NULL, 0) >= 0;
+        }
+        rc_ok = rc_ok && posix_kasan(0, NULL, 0) == -2;
+        if (rc_ok) {
+            ct_log("CT-042", "PASS", "kasan availability, self-test reports and leak scan");
+        } else {
+            ct_log("CT-042", "FAIL", "kasan op result mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Block ioctls: size query and a partition re-read that keeps the device list intact. */
+        rodnix_blockdev_info_t dev;
+        rodnix_blockdev_info_t after[32];
+        uint32_t total = 0;
+        uint32_t total_after = 0;
+        long n = posix_blocklist(&dev, 1, &total);
+        if (n <= 0) {
+            ct_log("CT-043", "PASS", "block ioctl deferred: no block device");
+        } else {
+            char path[32] = "/dev/";
+            uint64_t p = 5;
+            for (uint64_t i = 0; dev.name[i] && p + 1 < sizeof(path); i++) {
+                path[p++] = dev.name[i];
+            }
+            path[p] = '\0';
+            uint64_t size = 0;
+            long parts = -1;
+            int rc_ok = 0;
+            long fd = posix_open(path, VFS_OPEN_READ);
+            if (fd >= 0) {
+                rc_ok = posix_ioctl((int)fd, RDNX_BLK_IOCTL_GETSIZE64, &size) == 0 &&
+                        size == dev.sector_count * dev.sector_size;
+                parts = posix_ioctl((int)fd, RDNX_BLK_IOCTL_RRPART, 0);
+                /* -5: a partition of this disk is mounted or open. */
+                rc_ok = rc_ok && (parts >= 0 || parts == -5) && posix_ioctl((int)fd, 0x12FFu, 0) == -7;
+                (void)posix_close((int)fd);
+            }
+            /* The rescan re-registers the same partitions: the device count does not change. */
+            rc_ok = rc_ok && posix_blocklist(after, 32, &total_after) >= 0 && total_after == total;
+            long fd_null = posix_open("/dev/null", VFS_OPEN_READ);
+            rc_ok = rc_ok && fd_null >= 0 && posix_ioctl((int)fd_null, RDNX_BLK_IOCTL_RRPART, 0) == -7;
+            if (fd_null >= 0) {
+                (void)posix_close((int)fd_null);
+            }
+            if (rc_ok) {
+                ct_log("CT-043", "PASS", "block size ioctl and partition table re-read");
+            } else {
+                ct_log("CT-043", "FAIL", "block ioctl or partition rescan mismatch");
+                ok = 0;
+            }
+        }
+    }
+
+    {
+        /* INSECURE never blocks; NONBLOCK may report -5 when nothing seeded the pool. */
+        uint8_t a[32];
+        uint8_t b[32];
+        long ra = posix_getrandom(a, sizeof(a), 0x4u);
+        long rb = posix_getrandom(b, sizeof(b), 0x4u);
+        long rn = posix_getrandom(b, sizeof(b), 0x1u);
+        int differ = 0;
+        for (uint64_t i = 0; i < sizeof(a); i++) {
+            differ |= a[i] != b[i];
+        }
+        int rc_ok = ra == 32 && rb == 32 && differ && (rn == 32 || rn == -5) &&
+                    posix_getrandom(a, sizeof(a), 0x80u) == -2 &&
+                    posix_getrandom(a, sizeof(a), 0x6u) == -2 &&
+                    posix_getrandom((void*)0, 16, 0x4u) == -2 &&
+                    posix_getrandom(a, 0, 0x1u) == 0;
+        if (rc_ok) {
+            ct_log("CT-044", "PASS", rn == 32 ? "getrandom: seeded pool" : "getrandom: pool not seeded yet");
+        } else {
+            ct_log("CT-044", "FAIL", "getrandom result mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* /dev/urandom never blocks; /dev/random is only read once the pool is seeded. */
+        uint8_t a[64];
+        uint8_t b[64];
+        long fd = posix_open("/dev/urandom", VFS_OPEN_READ | VFS_OPEN_WRITE);
+        long ra = -1;
+        long rb = -1;
+        long wr = -1;
+        if (fd >= 0) {
+            ra = posix_read((int)fd, a, sizeof(a));
+            wr = posix_write((int)fd, a, sizeof(a));
+            rb = posix_read((int)fd, b, sizeof(b));
+            (void)posix_close((int)fd);
+        }
+        int differ = 0;
+        for (uint64_t i = 0; i < sizeof(a); i++) {
+            differ |= a[i] != b[i];
+        }
+        int rc_ok = ra == 64 && rb == 64 && wr == 64 && differ;
+        if (rc_ok && posix_getrandom(a, 1, 0x1u) == 1) {
+            long rfd = posix_open("/dev/random", VFS_OPEN_READ);
+            rc_ok = rfd >= 0 && posix_read((int)rfd, a, 16) == 16;
+            if (rfd >= 0) {
+                (void)posix_close((int)rfd);
+            }
+        }
+        uint32_t below = arc4random_uniform(10);
+        rc_ok = rc_ok && below < 10 && arc4random_uniform(1) == 0;
+        if (rc_ok) {
+            ct_log("CT-045", "PASS", "/dev/urandom, /dev/random and arc4random");
+        } else {
+            ct_log("CT-045", "FAIL", "random device or arc4random mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Busy-poll socket over loopback; queue statistics and the poll budget knob. */
+        struct {
+            uint16_t family;
+            uint16_t port;
+            uint32_t addr;
+        } sa = { AF_INET, 101, 0x7F000001u };
+        int us = 50;
+        int too_long = 1000000;
+        long fd = posix_socket(AF_INET, SOCK_DGRAM, 0);
+        int rc_ok = fd >= 0;
+        if (rc_ok) {
+            rc_ok = posix_setsockopt((int)fd, SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(us)) == 0 &&
+                    posix_setsockopt((int)fd, SOL_SOCKET, SO_BUSY_POLL, &too_long, sizeof(too_long)) == -2 &&
+                    posix_setsockopt((int)fd, SOL_SOCKET, 9999, &us, sizeof(us)) == -7 &&
+                    posix_bind((int)fd, &sa) == 0;
+        }
+        if (rc_ok) {
+            char rx[8];
+            rc_ok = posix_sendto((int)fd, "napi", 4, 0, &sa, sizeof(sa)) == 4 &&
+                    posix_recvfrom((int)fd, rx, sizeof(rx), 0, (void*)0, 500) == 4 &&
+                    rx[0] == 'n' && rx[3] == 'i';
+        }
+        if (fd >= 0) {
+            (void)posix_close((int)fd);
+        }
+        netif_qstat_t qs[4];
+        uint32_t qtotal = 0;
+        long nq = posix_netqstat(qs, 4, &qtotal);
+        rc_ok = rc_ok && nq >= 0 && (uint32_t)nq <= qtotal &&
+                posix_netqstat((void*)0, 0, &qtotal) == 0 &&
+                posix_netifset(0, NETIF_SET_POLL_BUDGET, NETIF_BUDGET_MAX + 1u) == -2 &&
+                posix_netifset(0, NETIF_SET_POLL_BUDGET, 32) == 0 &&
+                posix_netifset(0, NETIF_SET_POLL_BUDGET, 0) == 0 &&
+                posix_netifset(0, 99, 0) == -7 &&
+                posix_netifset(4096, NETIF_SET_POLL_BUDGET, 0) == -4;
+        if (rc_ok) {
+            ct_log("CT-046", "PASS", "SO_BUSY_POLL loopback, netqstat and poll budget");
+        } else {
+            ct_log("CT-046", "FAIL", "busy poll, netqstat or netifset mismatch");
+            ok = 0;
+        }
+    }
+
+    {
+        /* Runs after the CT-028/CT-031 writes and CT-029 sync: on-disk image must be consistent. */
+        rodnix_blockdev_info_t devs[32];
+        uint32_t total = 0;
+        long n = posix_blocklist(devs, 32, &total);
+        int have_disk = 0;
+        for (long i = 0; i < n && !have_disk; i++) {
+            const char* d = devs[i].name;
+            have_disk = d[0] == 'd' && d[1] == 'i' && d[2] == 's' && d[3] == 'k' &&
+                        d[4] == '0' && d[5] == '\0';
+        }
+        if (!have_disk) {
+            /* Only a missing disk defers the check; any run of fsck must exit 0. */
+            ct_log("CT-030", "PASS", "fsck_ext2 deferred: no disk0 block device");
+        } else {
+            const char* av[4];
+            av[0] = "/bin/fsck_ext2";
+            av[1] = "-n";
+            av[2] = "disk0";
+            av[3] = 0;
+            int status = -1;
+            long pid = posix_spawn("/bin/fsck_ext2", av);
+            if (pid <= 0) {
+                ct_log("CT-030", "FAIL", "fsck_ext2 spawn failed");
+                ok = 0;
+            } else {
+                long wr = waitpid((pid_t)pid, &status, 0);
+                if (wr == pid && status == 0) {
+                    ct_log("CT-030", "PASS", "fsck_ext2 reports clean ext2 volume");
+                } else if (wr == pid && status == 8) {
+                    ct_log("CT-030", "FAIL", "fsck_ext2 could not check the volume");
+                    ok = 0;
+                } else {
+                    ct_log("CT-030", "FAIL", "fsck_ext2 found inconsistencies");
+                    ok = 0;
+                }
+            }
+        }
+    }
+
     if (ok) {
         (void)write_str("[CT] ALL PASS\n");
     } else {
@@ -911,6 +1735,38 @@ static void run_contract_mode_if_enabled(void)
     }
 }
 
+/* make bench: run the benchmark suite and report its exit status on serial. */
+static void run_bench_mode_if_enabled(void)
+{
+    if (!file_exists("/etc/bench.auto")) {
+        return;
+    }
+    const char* av[2];
+    av[0] = "/bin/bench";
+    av[1] = 0;
+    int status = -1;
+    long pid = posix_spawn("/bin/bench", av);
+    if (pid <= 0 || waitpid((pid_t)pid, &status, 0) != (pid_t)pid || status != 0) {
+        (void)write_str("[BENCH] FAIL\n");
+    }
+}
+
+/* After the bench run: dump kernel and init profile counters (PGO=gen). */
+static void run_pgo_dump_if_enabled(void)
+{
+    if (!file_exists("/etc/pgo.auto")) {
+        return;
+    }
+    if (posix_gcov(GCOV_OP_DUMP, 0, 0, 0) < 0) {
+        (void)write_str("[PGO] FAIL kernel is not a PGO=gen build\n");
+        return;
+    }
+#ifdef CONFIG_GCOV
+    __gcov_dump();
+#endif
+    (void)write_str("[PGO] DONE\n");
+}
+
 int main(void)
 {
     (void)write_str("Rodnix userspace init launcher\n");
@@ -920,6 +1776,8 @@ int main(void)
     run_smoke();
     run_ifconfig_smoke_if_enabled();
     run_contract_mode_if_enabled();
+    run_bench_mode_if_enabled();
+    run_pgo_dump_if_enabled();
 
     (void)write_str("[USER] init: exec /bin/sh\n");
     long ret = posix_exec("/bin/sh");
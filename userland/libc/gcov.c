@@ -0,0 +1,229 @@
+/*
+ * gcov.c
+ * Profile runtime for PGO=gen userland builds. Every -fprofile-arcs object
+ * registers its counters through __gcov_init() from a constructor that
+ * crt0 runs before main; __gcov_dump() encodes each object as a .gcda
+ * image and hands it to gcov(GCOV_OP_EMIT), which frames it on the serial
+ * port the same way the kernel dumps its own counters.
+ *
+ * The structures mirror kernel/common/gcov.c and depend on the GCC version.
+ * This file itself is never instrumented (see the Makefile).
+ */
+
+#ifdef CONFIG_GCOV
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "posix_syscall.h"
+
+#define GCOV_DATA_MAGIC         0x67636461u
+#define GCOV_TAG_FUNCTION       0x01000000u
+#define GCOV_TAG_COUNTER_BASE   0x01a10000u
+#define GCOV_TAG_OBJECT_SUMMARY 0xa1000000u
+
+#if __GNUC__ >= 12
+#define GCOV_UNIT_SIZE 4
+#else
+#define GCOV_UNIT_SIZE 1
+#endif
+
+#if __GNUC__ >= 14
+#define GCOV_COUNTERS 9
+#elif __GNUC__ >= 10
+#define GCOV_COUNTERS 8
+#elif __GNUC__ >= 7
+#define GCOV_COUNTERS 9
+#else
+#define GCOV_COUNTERS 10
+#endif
+
+typedef int64_t gcov_type;
+
+struct gcov_info;
+
+typedef struct gcov_ctr_info {
+    unsigned int num;
+    gcov_type* values;
+} gcov_ctr_info_t;
+
+typedef struct gcov_fn_info {
+    const struct gcov_info* key;
+    unsigned int ident;
+    unsigned int lineno_checksum;
+    unsigned int cfg_checksum;
+    gcov_ctr_info_t ctrs[];
+} gcov_fn_info_t;
+
+typedef struct gcov_info {
+    unsigned int version;
+    struct gcov_info* next;
+    unsigned int stamp;
+#if __GNUC__ >= 12
+    unsigned int checksum;
+#endif
+    const char* filename;
+    void (*merge[GCOV_COUNTERS])(gcov_type*, unsigned int);
+    unsigned int n_functions;
+    gcov_fn_info_t** functions;
+} gcov_info_t;
+
+typedef void (*gcov_ctor_t)(void);
+
+/* link.ld */
+extern gcov_ctor_t __init_array_start[];
+extern gcov_ctor_t __init_array_end[];
+
+static gcov_info_t* g_gcov_list = 0;
+
+typedef struct gcov_buf {
+    uint8_t* p;     /* NULL: only count */
+    size_t len;
+} gcov_buf_t;
+
+void __gcov_init(gcov_info_t* info);
+void __gcov_exit(void);
+void __gcov_merge_add(gcov_type* counters, unsigned int n);
+void __gcov_user_init(void);
+
+void __gcov_init(gcov_info_t* info)
+{
+    if (info) {
+        info->next = g_gcov_list;
+        g_gcov_list = info;
+    }
+}
+
+void __gcov_exit(void)
+{
+}
+
+void __gcov_merge_add(gcov_type* counters, unsigned int n)
+{
+    (void)counters;
+    (void)n;
+}
+
+/* Called by crt0 before main. */
+void __gcov_user_init(void)
+{
+    for (gcov_ctor_t* c = __init_array_start; c < __init_array_end; c++) {
+        if (*c && *c != (gcov_ctor_t)(intptr_t)-1) {
+            (*c)();
+        }
+    }
+}
+
+static void gcov_u32(gcov_buf_t* b, uint32_t v)
+{
+    if (b->p) {
+        for (int i = 0; i < 4; i++) {
+            b->p[b->len + (size_t)i] = (uint8_t)(v >> (8 * i));
+        }
+    }
+    b->len += 4;
+}
+
+static void gcov_convert(gcov_buf_t* b, const gcov_info_t* info)
+{
+    gcov_u32(b, GCOV_DATA_MAGIC);
+    gcov_u32(b, info->version);
+    gcov_u32(b, info->stamp);
+#if __GNUC__ >= 12
+    gcov_u32(b, info->checksum);
+#endif
+#if __GNUC__ >= 9
+    uint64_t sum_max = 0;
+    for (unsigned int f = 0; f < info->n_functions; f++) {
+        const gcov_fn_info_t* fn = info->functions[f];
+        if (!fn || fn->key != info || !info->merge[0]) {
+            continue;
+        }
+        for (unsigned int i = 0; i < fn->ctrs[0].num; i++) {
+            uint64_t v = (uint64_t)fn->ctrs[0].values[i];
+            sum_max = v > sum_max ? v : sum_max;
+        }
+    }
+    gcov_u32(b, GCOV_TAG_OBJECT_SUMMARY);
+    gcov_u32(b, 2u * GCOV_UNIT_SIZE);
+    gcov_u32(b, 1u);
+    gcov_u32(b, (uint32_t)sum_max);
+#endif
+    for (unsigned int f = 0; f < info->n_functions; f++) {
+        const gcov_fn_info_t* fn = info->functions[f];
+        gcov_u32(b, GCOV_TAG_FUNCTION);
+        if (!fn || fn->key != info) {
+            gcov_u32(b, 0u);
+            continue;
+        }
+        gcov_u32(b, 3u * GCOV_UNIT_SIZE);
+        gcov_u32(b, fn->ident);
+        gcov_u32(b, fn->lineno_checksum);
+        gcov_u32(b, fn->cfg_checksum);
+        const gcov_ctr_info_t* ctr = fn->ctrs;
+        for (unsigned int t = 0; t < GCOV_COUNTERS; t++) {
+            if (!info->merge[t]) {
+                continue;
+            }
+            gcov_u32(b, GCOV_TAG_COUNTER_BASE + (t << 17));
+            gcov_u32(b, ctr->num * 2u * GCOV_UNIT_SIZE);
+            for (unsigned int i = 0; i < ctr->num; i++) {
+                uint64_t v = (uint64_t)ctr->values[i];
+                gcov_u32(b, (uint32_t)v);
+                gcov_u32(b, (uint32_t)(v >> 32));
+            }
+            ctr++;
+        }
+    }
+}
+
+void __gcov_reset(void)
+{
+    for (gcov_info_t* info = g_gcov_list; info; info = info->next) {
+        for (unsigned int f = 0; f < info->n_functions; f++) {
+            gcov_fn_info_t* fn = info->functions[f];
+            if (!fn || fn->key != info) {
+                continue;
+            }
+            gcov_ctr_info_t* ctr = fn->ctrs;
+            for (unsigned int t = 0; t < GCOV_COUNTERS; t++) {
+                if (!info->merge[t]) {
+                    continue;
+                }
+                for (unsigned int i = 0; i < ctr->num; i++) {
+                    ctr->values[i] = 0;
+                }
+                ctr++;
+            }
+        }
+    }
+}
+
+void __gcov_dump(void)
+{
+    /* One buffer for the largest object; malloc itself is instrumented,
+     * so allocate before encoding anything. */
+    size_t max = 0;
+    for (const gcov_info_t* info = g_gcov_list; info; info = info->next) {
+        gcov_buf_t b = { 0, 0 };
+        gcov_convert(&b, info);
+        max = b.len > max ? b.len : max;
+    }
+    if (max == 0 || max > GCOV_EMIT_MAX) {
+        return;
+    }
+    uint8_t* buf = (uint8_t*)malloc(max);
+    if (!buf) {
+        return;
+    }
+    for (const gcov_info_t* info = g_gcov_list; info; info = info->next) {
+        gcov_buf_t b = { buf, 0 };
+        gcov_convert(&b, info);
+        (void)posix_gcov(GCOV_OP_EMIT, (long)(uintptr_t)info->filename, (long)(uintptr_t)buf,
+                         (long)b.len);
+    }
+    free(buf);
+    __gcov_reset();
+}
+
+#endif /* CONFIG_GCOV */
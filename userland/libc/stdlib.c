@@ -1,5 +1,8 @@
 #include <ctype.h>
+#include <signal.h>
 #include <stdlib.h>
+#include <sys/random.h>
+#include <unistd.h>
 
 static int char_to_digit(int c)
 {
@@ -76,3 +79,50 @@ long strtol(const char* nptr, char** endptr, int base)
 {
     return (long)strtoul(nptr, endptr, base);
 }
+
+/* The CRNG is gone: there is no safe fallback, so do not return at all. */
+static void __attribute__((noreturn)) arc4random_fail(void)
+{
+    static const char msg[] = "arc4random: getrandom failed\n";
+    (void)write(2, msg, sizeof(msg) - 1);
+    (void)kill(getpid(), SIGABRT);
+    for (;;) {
+        (void)posix_exit(128 + SIGABRT);
+    }
+}
+
+void arc4random_buf(void* buf, size_t nbytes)
+{
+    uint8_t* p = (uint8_t*)buf;
+    while (nbytes > 0) {
+        /* Short reads (above the per-call cap) continue; any error is fatal. */
+        long r = posix_getrandom(p, (uint64_t)nbytes, GRND_INSECURE);
+        if (r <= 0) {
+            arc4random_fail();
+        }
+        p += r;
+        nbytes -= (size_t)r;
+    }
+}
+
+uint32_t arc4random(void)
+{
+    uint32_t v;
+    arc4random_buf(&v, sizeof(v));
+    return v;
+}
+
+uint32_t arc4random_uniform(uint32_t upper_bound)
+{
+    if (upper_bound < 2) {
+        return 0;
+    }
+    /* Reject the low 2^32 % upper_bound values so every residue is equally likely. */
+    uint32_t min = (uint32_t)(-upper_bound) % upper_bound;
+    for (;;) {
+        uint32_t r = arc4random();
+        if (r >= min) {
+            return r % upper_bound;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * demo_base.c
+ * Library module: exports a tiny registration API that demo.echo imports,
+ * so loading demo.echo pulls this module in on demand and pins it.
+ */
+
+#include "../../include/console.h"
+#include "../../include/kmod_abi.h"
+#include "demo_base.h"
+#include "demo_base_symvers.h"
+
+__attribute__((used, section(".rodnix_mod")))
+const kmod_image_header_t g_demo_base_kmod = {
+    .magic = KMOD_IMAGE_MAGIC,
+    .name = "demo.base",
+    .kind = "lib",
+    .version = "0.1",
+    .flags = 0,
+    .image_size = sizeof(kmod_image_header_t),
+    .reserved0 = 0,
+    .reserved1 = 0
+};
+
+static int g_users;
+
+int demo_base_register(const char* who)
+{
+    kputs("[demo.base] register ");
+    kputs(who);
+    kputs("\n");
+    return ++g_users;
+}
+EXPORT_SYMBOL(demo_base_register);
+
+void demo_base_unregister(const char* who)
+{
+    kputs("[demo.base] unregister ");
+    kputs(who);
+    kputs("\n");
+    g_users--;
+}
+EXPORT_SYMBOL(demo_base_unregister);
+
+int rodnix_kmod_init(void)
+{
+    g_users = 0;
+    return 0;
+}
+
+void rodnix_kmod_fini(void)
+{
+}
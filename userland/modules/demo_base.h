@@ -0,0 +1,13 @@
+/*
+ * demo_base.h
+ * Interface exported by the demo.base module. Its KSYMCRC_* versions are
+ * generated into demo_base_symvers.h by scripts/mkksymvers.py.
+ */
+
+#ifndef _RODNIX_DEMO_BASE_H
+#define _RODNIX_DEMO_BASE_H
+
+int demo_base_register(const char* who);
+void demo_base_unregister(const char* who);
+
+#endif /* _RODNIX_DEMO_BASE_H */
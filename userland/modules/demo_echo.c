@@ -1,11 +1,12 @@
 #include "../../include/kmod_abi.h"
+#include "demo_base.h"
 
 __attribute__((used, section(".rodnix_mod")))
 const kmod_image_header_t g_demo_kmod = {
     .magic = KMOD_IMAGE_MAGIC,
     .name = "demo.echo",
     .kind = "misc",
-    .version = "0.2",
+    .version = "0.3",
     .flags = 0,
     .image_size = sizeof(kmod_image_header_t),
     .reserved0 = 0,
@@ -14,9 +15,10 @@ const kmod_image_header_t g_demo_kmod = {
 
 int rodnix_kmod_init(void)
 {
-    return 0;
+    return demo_base_register("demo.echo") > 0 ? 0 : -1;
 }
 
 void rodnix_kmod_fini(void)
 {
+    demo_base_unregister("demo.echo");
 }
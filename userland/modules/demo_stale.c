@@ -0,0 +1,32 @@
+/*
+ * demo_stale.c
+ * Stands in for a module built against an older kernel: its version table
+ * is written by hand with a CRC for kputs that no longer matches, so the
+ * loader must refuse it. Built without scripts/kmodpost.py.
+ */
+
+#include "../../include/console.h"
+#include "../../include/kmod_abi.h"
+
+__attribute__((used, section(".rodnix_mod")))
+const kmod_image_header_t g_demo_stale_kmod = {
+    .magic = KMOD_IMAGE_MAGIC,
+    .name = "demo.stale",
+    .kind = "misc",
+    .version = "0.1",
+    .flags = 0,
+    .image_size = sizeof(kmod_image_header_t),
+    .reserved0 = 0,
+    .reserved1 = 0
+};
+
+__attribute__((used, section(".rodnix_versions")))
+static const kmod_modversion_t g_demo_stale_versions[] = {
+    { 0x00000000u, "kputs" },
+};
+
+int rodnix_kmod_init(void)
+{
+    kputs("[demo.stale] must not run\n");
+    return 0;
+}